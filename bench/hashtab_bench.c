@@ -0,0 +1,259 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* The micro-benchmark of the hash tables used by YAEP.  It measures
+   insertion, successful and failed searches, and removal with
+   reinsertion of N elements and prints ns/operation and the number
+   of calls of the equality function per operation in JSON:
+
+     yaep_hashtab_bench [--iterations N] [--elements N]
+
+   The program is built twice: as yaep_hashtab_bench with the default
+   tables probing groups of control bytes and as
+   yaep_hashtab_bench_classic with the tables with double hashing
+   (CLASSIC_HASH_TABLE), so the two can be compared. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "allocate.h"
+#include "hashtab.h"
+
+/* Default number of repetitions of each operation series. */
+#define DEFAULT_ITERATIONS 5
+
+/* Default number of the table elements. */
+#define DEFAULT_ELEMENTS 100000
+
+#ifdef CLASSIC_HASH_TABLE
+#define TABLE_NAME "classic"
+#else
+#define TABLE_NAME "group"
+#endif
+
+/* The table elements.  The hash is a combination of the key parts as
+   the hash functions of the parser sets and cores are. */
+struct el
+{
+  unsigned key1, key2;
+};
+
+/* Number of calls of the equality function. */
+static long n_eqs;
+
+static unsigned
+el_hash (hash_table_entry_t e)
+{
+  const struct el *el = (const struct el *) e;
+
+  return el->key1 * 0x9e3779b1u + el->key2;
+}
+
+static int
+el_eq (hash_table_entry_t e1, hash_table_entry_t e2)
+{
+  const struct el *el1 = (const struct el *) e1;
+  const struct el *el2 = (const struct el *) e2;
+
+  n_eqs++;
+  return el1->key1 == el2->key1 && el1->key2 == el2->key2;
+}
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+/* The operation series. */
+enum op
+{
+  OP_INSERT,
+  OP_FIND,
+  OP_MISS,
+  OP_REMOVE_INSERT,
+  OP_BOUND
+};
+
+static const char *const op_names[OP_BOUND] =
+  {"insert", "find", "miss", "remove_insert"};
+
+/* Best time and equality function calls of the series. */
+struct result
+{
+  double best_ns;
+  long n_eqs;
+};
+
+/* Fill N elements ELS and N absent elements ABSENT. */
+static void
+make_elements (struct el *els, struct el *absent, size_t n)
+{
+  unsigned seed = 12345u;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      /* Sequential first keys as the numbers of the parser
+	 objects. */
+      els[i].key1 = (unsigned) i;
+      els[i].key2 = (seed >> 16) & 0xff;
+      absent[i].key1 = (unsigned) (i + n);
+      absent[i].key2 = els[i].key2;
+    }
+}
+
+/* Run all series on N elements ELS ITERATIONS times and put the best
+   times into RES.  Return FALSE if a search gives a wrong result. */
+static int
+run (YaepAllocator *alloc, struct el *els, struct el *absent, size_t n,
+     int iterations, struct result *res)
+{
+  hash_table_t tab;
+  hash_table_entry_t *entry;
+  double start, ns[OP_BOUND];
+  long eqs[OP_BOUND];
+  size_t i;
+  int it, op;
+
+  for (op = 0; op < OP_BOUND; op++)
+    res[op].best_ns = -1.0;
+  for (it = 0; it < iterations; it++)
+    {
+      tab = create_hash_table (alloc, 1000, el_hash, el_eq);
+
+      n_eqs = 0;
+      start = now_ns ();
+      for (i = 0; i < n; i++)
+	{
+	  entry = find_hash_table_entry (tab, &els[i], 1);
+	  if (*entry != NULL)
+	    return 0;
+	  *entry = &els[i];
+	}
+      ns[OP_INSERT] = now_ns () - start;
+      eqs[OP_INSERT] = n_eqs;
+
+      n_eqs = 0;
+      start = now_ns ();
+      for (i = 0; i < n; i++)
+	if (*find_hash_table_entry (tab, &els[i], 0) != &els[i])
+	  return 0;
+      ns[OP_FIND] = now_ns () - start;
+      eqs[OP_FIND] = n_eqs;
+
+      n_eqs = 0;
+      start = now_ns ();
+      for (i = 0; i < n; i++)
+	if (*find_hash_table_entry (tab, &absent[i], 0) != NULL)
+	  return 0;
+      ns[OP_MISS] = now_ns () - start;
+      eqs[OP_MISS] = n_eqs;
+
+      n_eqs = 0;
+      start = now_ns ();
+      for (i = 0; i < n; i++)
+	{
+	  remove_element_from_hash_table_entry (tab, &els[i]);
+	  entry = find_hash_table_entry (tab, &absent[i], 1);
+	  *entry = &absent[i];
+	}
+      ns[OP_REMOVE_INSERT] = now_ns () - start;
+      eqs[OP_REMOVE_INSERT] = n_eqs;
+
+      if (hash_table_elements_number (tab) != n)
+	return 0;
+      delete_hash_table (tab);
+      for (op = 0; op < OP_BOUND; op++)
+	if (res[op].best_ns < 0 || ns[op] < res[op].best_ns)
+	  {
+	    res[op].best_ns = ns[op];
+	    res[op].n_eqs = eqs[op];
+	  }
+    }
+  return 1;
+}
+
+static void
+usage (void)
+{
+  fprintf (stderr,
+	   "Usage: yaep_hashtab_bench [--iterations N] [--elements N]\n");
+  exit (2);
+}
+
+int
+main (int argc, char **argv)
+{
+  YaepAllocator *alloc;
+  struct el *els, *absent;
+  struct result res[OP_BOUND];
+  long n = DEFAULT_ELEMENTS;
+  int i, iterations = DEFAULT_ITERATIONS;
+
+  for (i = 1; i < argc; i++)
+    if (strcmp (argv[i], "--iterations") == 0 && i + 1 < argc)
+      iterations = atoi (argv[++i]);
+    else if (strcmp (argv[i], "--elements") == 0 && i + 1 < argc)
+      n = atol (argv[++i]);
+    else
+      usage ();
+  if (iterations <= 0 || n <= 0)
+    usage ();
+  els = (struct el *) malloc ((size_t) n * sizeof (struct el));
+  absent = (struct el *) malloc ((size_t) n * sizeof (struct el));
+  alloc = yaep_alloc_new (NULL, NULL, NULL, NULL);
+  if (els == NULL || absent == NULL || alloc == NULL)
+    {
+      fprintf (stderr, "yaep_hashtab_bench: no memory\n");
+      return 1;
+    }
+  make_elements (els, absent, (size_t) n);
+  if (!run (alloc, els, absent, (size_t) n, iterations, res))
+    {
+      fprintf (stderr, "yaep_hashtab_bench: wrong search result\n");
+      return 1;
+    }
+  printf ("{\"table\":\"%s\",\"elements\":%ld,\"iterations\":%d,"
+	  "\"results\":[", TABLE_NAME, n, iterations);
+  for (i = 0; i < OP_BOUND; i++)
+    printf ("%s{\"name\":\"%s\",\"ns_per_op\":%.2f,\"eqs_per_op\":%.3f}",
+	    i == 0 ? "" : ",", op_names[i], res[i].best_ns / (double) n,
+	    (double) res[i].n_eqs / (double) n);
+  printf ("]}\n");
+  yaep_alloc_del (alloc);
+  free (els);
+  free (absent);
+  return 0;
+}
@@ -0,0 +1,878 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* The benchmark harness of YAEP.  It parses several workloads (an
+   expression micro-benchmark, the ANSI C grammar over a preprocessed
+   C file, a highly ambiguous grammar, and an input with many syntax
+   errors) and prints ns/token, Earley's sets/token, the peak heap size
+   and number of allocations of each parse in JSON:
+
+     yaep_bench [--iterations N] [--workload NAME]... [--data-dir DIR]
+		[--baseline FILE] [--compare FILE [--threshold PERCENT]
+		[--no-time]]
+
+   --baseline writes the results into FILE too.  --compare reads the
+   results stored by --baseline and reports the metrics which are
+   worse than the stored ones by more than PERCENT (10 by default).
+   The exit code is 1 in this case.  --no-time excludes the time from
+   the comparison, so only the deterministic metrics can regress.
+
+   The heap is measured only if the program is linked with wrapped
+   malloc, calloc, realloc, and free (YAEP_BENCH_WRAP_ALLOC).
+   Otherwise the heap metrics are null. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "yaep.h"
+
+#ifdef YAEP_BENCH_WRAP_ALLOC
+#include <malloc.h>
+#endif
+
+#define SCHEMA_VERSION 2
+
+/* Default number of parses of each workload. */
+#define DEFAULT_ITERATIONS 5
+
+/* Default regression threshold in percents. */
+#define DEFAULT_THRESHOLD 10.0
+
+#ifndef YAEP_BENCH_DATA_DIR
+#define YAEP_BENCH_DATA_DIR "test/compare_parsers"
+#endif
+
+
+
+/* This page contains accounting of the heap used by the parser. */
+
+/* The following is TRUE if the allocations are counted now. */
+static int alloc_counting_p;
+/* Number of allocations, bytes allocated now, and the maximal number
+   of the allocated bytes since the counting start. */
+static long n_allocs;
+static long live_bytes, peak_bytes;
+
+#ifdef YAEP_BENCH_WRAP_ALLOC
+
+void *__real_malloc (size_t size);
+void *__real_calloc (size_t nmemb, size_t size);
+void *__real_realloc (void *ptr, size_t size);
+void __real_free (void *ptr);
+void *__wrap_malloc (size_t size);
+void *__wrap_calloc (size_t nmemb, size_t size);
+void *__wrap_realloc (void *ptr, size_t size);
+void __wrap_free (void *ptr);
+
+/* Take allocated block PTR into account. */
+static void
+count_alloc (void *ptr)
+{
+  if (ptr == NULL || !alloc_counting_p)
+    return;
+  n_allocs++;
+  live_bytes += (long) malloc_usable_size (ptr);
+  if (live_bytes > peak_bytes)
+    peak_bytes = live_bytes;
+}
+
+/* Take freeing block PTR into account. */
+static void
+count_free (void *ptr)
+{
+  if (ptr != NULL && alloc_counting_p)
+    live_bytes -= (long) malloc_usable_size (ptr);
+}
+
+void *
+__wrap_malloc (size_t size)
+{
+  void *ptr = __real_malloc (size);
+
+  count_alloc (ptr);
+  return ptr;
+}
+
+void *
+__wrap_calloc (size_t nmemb, size_t size)
+{
+  void *ptr = __real_calloc (nmemb, size);
+
+  count_alloc (ptr);
+  return ptr;
+}
+
+void *
+__wrap_realloc (void *ptr, size_t size)
+{
+  void *result;
+
+  count_free (ptr);
+  result = __real_realloc (ptr, size);
+  if (result != NULL)
+    count_alloc (result);
+  else if (ptr != NULL && size != 0 && alloc_counting_p)
+    /* The old block is not freed. */
+    live_bytes += (long) malloc_usable_size (ptr);
+  return result;
+}
+
+void
+__wrap_free (void *ptr)
+{
+  count_free (ptr);
+  __real_free (ptr);
+}
+
+#endif /* #ifdef YAEP_BENCH_WRAP_ALLOC */
+
+/* Start counting the allocations.  Blocks allocated before are not
+   taken into account when they are freed. */
+static void
+alloc_count_start (void)
+{
+  n_allocs = live_bytes = peak_bytes = 0;
+  alloc_counting_p = 1;
+}
+
+static void
+alloc_count_stop (void)
+{
+  alloc_counting_p = 0;
+}
+
+
+
+/* This page contains the workloads. */
+
+/* The following describes a workload: a grammar, parser settings,
+   and token codes of the input. */
+struct workload
+{
+  const char *name;
+  const char *description;
+  int lookahead_level, one_parse_p, error_recovery_p;
+  int n_toks;
+  int *codes;
+};
+
+/* The following vector of token codes is used to form inputs. */
+static int *toks;
+static int toks_len, toks_size;
+
+static void
+tok_add (int code)
+{
+  if (toks_len >= toks_size)
+    {
+      toks_size = toks_size == 0 ? 1024 : 2 * toks_size;
+      toks = (int *) realloc (toks, (size_t) toks_size * sizeof (int));
+      if (toks == NULL)
+	{
+	  fprintf (stderr, "yaep_bench: no memory\n");
+	  exit (2);
+	}
+    }
+  toks[toks_len++] = code;
+}
+
+static void
+toks_add_string (const char *str)
+{
+  for (; *str != '\0'; str++)
+    tok_add (*str);
+}
+
+/* Finish forming the input of workload W. */
+static void
+toks_finish (struct workload *w)
+{
+  w->codes = toks;
+  w->n_toks = toks_len;
+  toks = NULL;
+  toks_len = toks_size = 0;
+}
+
+static const char *expr_description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n";
+
+/* Form expression of at least N_TOKS tokens. */
+static void
+expr_micro_input (struct workload *w, int n_toks)
+{
+  static const char *const pieces[] = {"+a*a", "+(a+a)*a", "*(a*(a+a))"};
+  int i;
+
+  tok_add ('a');
+  for (i = 0; toks_len < n_toks; i++)
+    toks_add_string (pieces[i % 3]);
+  toks_finish (w);
+}
+
+static const char *ambiguous_description =
+"\n"
+"TERM;\n"
+"S : S S # s (0 1)\n"
+"  | 'a' # 0\n"
+"  ;\n";
+
+static void
+ambiguous_input (struct workload *w, int n_toks)
+{
+  int i;
+
+  for (i = 0; i < n_toks; i++)
+    tok_add ('a');
+  toks_finish (w);
+}
+
+static const char *error_recovery_description =
+"\n"
+"TERM;\n"
+"P : S           # 0\n"
+"  ;\n"
+"S : S st        # seq (0 1)\n"
+"  | st          # 0\n"
+"  ;\n"
+"st : E ';'      # 0\n"
+"   | error ';'  # 0\n"
+"   ;\n"
+"E : T           # 0\n"
+"  | E '+' T     # plus (0 2)\n"
+"  ;\n"
+"T : 'a'         # 0\n"
+"  | '(' E ')'   # 1\n"
+"  ;\n";
+
+/* Form statements of at least N_TOKS tokens.  Every third statement
+   contains a syntax error. */
+static void
+error_recovery_input (struct workload *w, int n_toks)
+{
+  int i;
+
+  for (i = 0; toks_len < n_toks; i++)
+    toks_add_string (i % 3 == 2 ? "a+(a+)a;" : "a+(a+a);");
+  toks_finish (w);
+}
+
+/* The following is the ANSI C tokenizer which is equivalent to
+   test/ansic.l for the test files. */
+
+#define IDENTIFIER 1000
+#define CONSTANT 8003
+#define STRING_LITERAL 9003
+#define ELIPSIS 4006
+
+static const struct
+{
+  const char *name;
+  int code;
+} ansic_keywords[] = {
+  {"__signed__", 2000}, {"__signed", 2000}, {"__const", 3000},
+  {"__const__", 3000}, {"__inline", 4000}, {"__inline__", 4000},
+  {"auto", 5000}, {"break", 6000}, {"case", 7000}, {"char", 8000},
+  {"const", 3000}, {"continue", 9000}, {"default", 1001}, {"do", 2001},
+  {"double", 3001}, {"else", 4001}, {"enum", 5001}, {"extern", 6001},
+  {"float", 7001}, {"for", 8001}, {"goto", 9001}, {"if", 1002},
+  {"int", 2002}, {"long", 3002}, {"register", 4002}, {"return", 5002},
+  {"short", 6002}, {"signed", 2000}, {"sizeof", 7002}, {"static", 8002},
+  {"struct", 9002}, {"switch", 1003}, {"typedef", 2003}, {"union", 3003},
+  {"unsigned", 4003}, {"void", 5003}, {"volatile", 6003},
+  {"while", 7003},
+};
+
+static const struct
+{
+  const char *str;
+  int code;
+} ansic_ops[] = {
+  {">>=", 1004}, {"<<=", 2004}, {"...", ELIPSIS}, {"+=", 3004},
+  {"-=", 4004}, {"*=", 5004}, {"/=", 6004}, {"%=", 7004}, {"&=", 8004},
+  {"^=", 9004}, {"|=", 1005}, {">>", 2007}, {"<<", 3005}, {"++", 4005},
+  {"--", 5005}, {"->", 6005}, {"&&", 7005}, {"||", 8005}, {"<=", 9005},
+  {">=", 1006}, {"==", 2006}, {"!=", 3006},
+};
+
+/* Return code of identifier or keyword STR of length LEN. */
+static int
+ansic_word_code (const char *str, size_t len)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof (ansic_keywords) / sizeof (ansic_keywords[0]); i++)
+    if (strlen (ansic_keywords[i].name) == len
+	&& strncmp (ansic_keywords[i].name, str, len) == 0)
+      return ansic_keywords[i].code;
+  return IDENTIFIER;
+}
+
+/* Form the input of workload W from C text STR. */
+static void
+ansic_input (struct workload *w, const char *str)
+{
+  const char *start;
+  size_t i, len;
+  int quote;
+
+  while (*str != '\0')
+    {
+      if (isspace ((unsigned char) *str))
+	str++;
+      else if (str[0] == '/' && str[1] == '*')
+	{
+	  str = strstr (str + 2, "*/");
+	  str = str == NULL ? "" : str + 2;
+	}
+      else if (isalpha ((unsigned char) *str) || *str == '_')
+	{
+	  for (start = str; isalnum ((unsigned char) *str) || *str == '_';)
+	    str++;
+	  tok_add (ansic_word_code (start, (size_t) (str - start)));
+	}
+      else if (isdigit ((unsigned char) *str)
+	       || (*str == '.' && isdigit ((unsigned char) str[1])))
+	{
+	  for (str++; isalnum ((unsigned char) *str) || *str == '.'
+		 || ((*str == '+' || *str == '-')
+		     && (str[-1] == 'e' || str[-1] == 'E')); str++)
+	    ;
+	  tok_add (CONSTANT);
+	}
+      else if (*str == '"' || *str == '\'')
+	{
+	  for (quote = *str++; *str != '\0' && *str != quote; str++)
+	    if (*str == '\\' && str[1] != '\0')
+	      str++;
+	  if (*str != '\0')
+	    str++;
+	  tok_add (quote == '"' ? STRING_LITERAL : CONSTANT);
+	}
+      else
+	{
+	  for (i = 0; i < sizeof (ansic_ops) / sizeof (ansic_ops[0]); i++)
+	    {
+	      len = strlen (ansic_ops[i].str);
+	      if (strncmp (ansic_ops[i].str, str, len) == 0)
+		break;
+	    }
+	  if (i < sizeof (ansic_ops) / sizeof (ansic_ops[0]))
+	    {
+	      tok_add (ansic_ops[i].code);
+	      str += len;
+	    }
+	  else
+	    {
+	      if (strchr (";{},:=()[].&!~-+*/%<>^|?", *str) != NULL)
+		tok_add (*str);
+	      /* Other characters are ignored as by test/ansic.l. */
+	      str++;
+	    }
+	}
+    }
+  toks_finish (w);
+}
+
+/* Return the contents of file PATH allocated by malloc or NULL if the
+   file can not be read. */
+static char *
+read_file (const char *path)
+{
+  FILE *f;
+  long size;
+  char *buf;
+  size_t n;
+
+  if ((f = fopen (path, "rb")) == NULL)
+    return NULL;
+  if (fseek (f, 0, SEEK_END) != 0 || (size = ftell (f)) < 0
+      || fseek (f, 0, SEEK_SET) != 0
+      || (buf = (char *) malloc ((size_t) size + 1)) == NULL)
+    {
+      fclose (f);
+      return NULL;
+    }
+  n = fread (buf, 1, (size_t) size, f);
+  buf[n] = '\0';
+  fclose (f);
+  return buf;
+}
+
+
+
+/* This page contains running the workloads. */
+
+/* The following describes results of a workload. */
+struct result
+{
+  const char *name;
+  int n_toks, iterations, n_errors, ambiguous_p;
+  double best_ns, avg_ns;
+  /* Earley's sets of the parse, the parse heap peak, and number of
+     allocations by the parse (-1 if they are not measured). */
+  long n_sets, peak_bytes, n_allocs;
+};
+
+static int n_syntax_errors;
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  n_syntax_errors++;
+}
+
+static void *
+bench_parse_alloc (int size)
+{
+  return malloc ((size_t) size);
+}
+
+static double
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+/* Parse the input of workload W ITERATIONS times and put the results
+   into *RES.  Return FALSE if the grammar or the parse fails. */
+static int
+run_workload (struct workload *w, int iterations, struct result *res)
+{
+  struct grammar *g;
+  struct yaep_tree_node *root;
+  struct yaep_parse_stats stats;
+  double start, ns, sum = 0.0;
+  int i, code;
+
+  if ((g = yaep_create_grammar ()) == NULL)
+    {
+      fprintf (stderr, "yaep_bench: no memory\n");
+      return 0;
+    }
+  yaep_set_lookahead_level (g, w->lookahead_level);
+  yaep_set_one_parse_flag (g, w->one_parse_p);
+  yaep_set_error_recovery_flag (g, w->error_recovery_p);
+  if (yaep_parse_grammar (g, 1, w->description) != 0)
+    {
+      fprintf (stderr, "yaep_bench: %s: %s\n", w->name,
+	       yaep_error_message (g));
+      yaep_free_grammar (g);
+      return 0;
+    }
+  memset (res, 0, sizeof (struct result));
+  res->name = w->name;
+  res->n_toks = w->n_toks;
+  res->iterations = iterations;
+  res->n_sets = res->peak_bytes = res->n_allocs = -1;
+  for (i = 0; i < iterations; i++)
+    {
+      n_syntax_errors = 0;
+      alloc_count_start ();
+      start = now_ns ();
+      code = yaep_parse_tokens (g, w->n_toks, w->codes, NULL,
+				count_syntax_error, bench_parse_alloc, free,
+				&root, &res->ambiguous_p);
+      ns = now_ns () - start;
+      alloc_count_stop ();
+      if (code != 0)
+	{
+	  fprintf (stderr, "yaep_bench: %s: %s\n", w->name,
+		   yaep_error_message (g));
+	  yaep_free_grammar (g);
+	  return 0;
+	}
+      yaep_free_tree (root, free, NULL);
+      sum += ns;
+      if (i == 0 || ns < res->best_ns)
+	res->best_ns = ns;
+    }
+  res->avg_ns = sum / iterations;
+  res->n_errors = n_syntax_errors;
+  yaep_get_parse_stats (g, 0, &stats);
+  res->n_sets = stats.n_sets;
+#ifdef YAEP_BENCH_WRAP_ALLOC
+  res->peak_bytes = peak_bytes;
+  res->n_allocs = n_allocs;
+#endif
+  yaep_free_grammar (g);
+  return 1;
+}
+
+
+
+/* This page contains output of the results and their comparison with
+   the baseline. */
+
+/* Metrics of a result compared with the baseline.  Only the first
+   one depends on the machine load. */
+#define N_METRICS 4
+#define N_TIME_METRICS 1
+
+static const char *const metric_names[N_METRICS] = {
+  "avg_ns_per_token", "sets_per_token", "peak_bytes", "allocations"
+};
+
+/* Return metric with number N of result RES or a negative value if it
+   is not measured. */
+static double
+result_metric (const struct result *res, int n)
+{
+  double n_toks = res->n_toks == 0 ? 1.0 : (double) res->n_toks;
+
+  switch (n)
+    {
+    case 0:
+      return res->avg_ns / n_toks;
+    case 1:
+      return res->n_sets < 0 ? -1.0 : (double) res->n_sets / n_toks;
+    case 2:
+      return (double) res->peak_bytes;
+    default:
+      return (double) res->n_allocs;
+    }
+}
+
+static void
+print_long (FILE *f, const char *name, long value, const char *sep)
+{
+  if (value < 0)
+    fprintf (f, "\"%s\":null%s", name, sep);
+  else
+    fprintf (f, "\"%s\":%ld%s", name, value, sep);
+}
+
+/* Print RESULTS of N_RESULTS workloads in JSON into F. */
+static void
+print_results (FILE *f, struct result *results, int n_results)
+{
+  char captured[32];
+  time_t t = time (NULL);
+  struct tm tm;
+  struct result *res;
+  int i;
+
+  gmtime_r (&t, &tm);
+  strftime (captured, sizeof (captured), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  fprintf (f, "{\"schema_version\":%d,\"captured\":\"%s\",\"benchmarks\":[",
+	   SCHEMA_VERSION, captured);
+  for (i = 0; i < n_results; i++)
+    {
+      res = &results[i];
+      fprintf (f, "%s\n {\"name\":\"%s\",\"tokens\":%d,\"iterations\":%d,",
+	       i == 0 ? "" : ",", res->name, res->n_toks, res->iterations);
+      fprintf (f, "\"syntax_errors\":%d,\"ambiguous\":%s,",
+	       res->n_errors, res->ambiguous_p ? "true" : "false");
+      fprintf (f, "\"best_ns\":%.0f,\"avg_ns\":%.0f,", res->best_ns,
+	       res->avg_ns);
+      fprintf (f, "\"best_ns_per_token\":%.2f,\"avg_ns_per_token\":%.2f,",
+	       res->best_ns / (res->n_toks == 0 ? 1 : res->n_toks),
+	       result_metric (res, 0));
+      if (res->n_sets < 0)
+	fprintf (f, "\"sets_per_token\":null,");
+      else
+	fprintf (f, "\"sets_per_token\":%.6f,", result_metric (res, 1));
+      print_long (f, "peak_bytes", res->peak_bytes, ",");
+      print_long (f, "allocations", res->n_allocs, "}");
+    }
+  fprintf (f, "\n]}\n");
+}
+
+/* Return the value of number member NAME in JSON object OBJ of length
+   LEN or a negative value if there is no such member or it is null. */
+static double
+json_number (const char *obj, size_t len, const char *name)
+{
+  char key[64];
+  const char *p, *end = obj + len;
+  size_t key_len;
+
+  snprintf (key, sizeof (key), "\"%s\"", name);
+  key_len = strlen (key);
+  for (p = obj; p + key_len <= end; p++)
+    if (strncmp (p, key, key_len) == 0)
+      {
+	for (p += key_len; p < end && (isspace ((unsigned char) *p)
+				       || *p == ':'); p++)
+	  ;
+	if (p < end && (isdigit ((unsigned char) *p) || *p == '-'))
+	  return strtod (p, NULL);
+	return -1.0;
+      }
+  return -1.0;
+}
+
+/* Return TRUE if JSON object OBJ of length LEN has string member
+   "name" or "benchmark" (schema version 1) equal to NAME. */
+static int
+json_name_p (const char *obj, size_t len, const char *name)
+{
+  static const char *const keys[] = {"\"name\"", "\"benchmark\""};
+  const char *p, *end = obj + len;
+  size_t i, key_len, name_len = strlen (name);
+
+  for (i = 0; i < 2; i++)
+    {
+      key_len = strlen (keys[i]);
+      for (p = obj; p + key_len <= end; p++)
+	if (strncmp (p, keys[i], key_len) == 0)
+	  {
+	    for (p += key_len; p < end && (isspace ((unsigned char) *p)
+					   || *p == ':'); p++)
+	      ;
+	    return (p + name_len + 2 <= end && *p == '"'
+		    && strncmp (p + 1, name, name_len) == 0
+		    && p[name_len + 1] == '"');
+	  }
+    }
+  return 0;
+}
+
+/* Find the innermost JSON object describing benchmark NAME in BASELINE.
+   Return its start and put its length into *LEN, or return NULL. */
+static const char *
+baseline_object (const char *baseline, const char *name, size_t *len)
+{
+  const char *p, *start = NULL;
+  int in_string_p = 0;
+
+  for (p = baseline; *p != '\0'; p++)
+    if (in_string_p)
+      {
+	if (*p == '\\' && p[1] != '\0')
+	  p++;
+	else if (*p == '"')
+	  in_string_p = 0;
+      }
+    else if (*p == '"')
+      in_string_p = 1;
+    else if (*p == '{')
+      start = p;
+    else if (*p == '}' && start != NULL)
+      {
+	*len = (size_t) (p - start + 1);
+	if (json_name_p (start, *len, name))
+	  return start;
+	start = NULL;
+      }
+  return NULL;
+}
+
+/* Compare RESULTS with BASELINE and print the differences into stderr.
+   Return number of the metrics worse than the baseline ones by more
+   than THRESHOLD percents.  Skip the time metrics if NO_TIME_P. */
+static int
+compare_results (const char *baseline, struct result *results,
+		 int n_results, double threshold, int no_time_p)
+{
+  const char *obj;
+  size_t len;
+  double base, curr, change;
+  int i, n, n_regressions = 0;
+
+  for (i = 0; i < n_results; i++)
+    {
+      if ((obj = baseline_object (baseline, results[i].name, &len)) == NULL)
+	{
+	  fprintf (stderr, "%-16s not in the baseline\n", results[i].name);
+	  continue;
+	}
+      for (n = no_time_p ? N_TIME_METRICS : 0; n < N_METRICS; n++)
+	{
+	  base = json_number (obj, len, metric_names[n]);
+	  curr = result_metric (&results[i], n);
+	  if (base < 0 || curr < 0)
+	    continue;
+	  change = base == 0 ? (curr == 0 ? 0.0 : 100.0)
+			     : (curr - base) * 100.0 / base;
+	  fprintf (stderr, "%-16s %-18s %14.3f -> %14.3f (%+.1f%%)%s\n",
+		   results[i].name, metric_names[n], base, curr, change,
+		   change > threshold ? "  REGRESSION" : "");
+	  if (change > threshold)
+	    n_regressions++;
+	}
+    }
+  return n_regressions;
+}
+
+
+
+static void
+usage (void)
+{
+  fprintf (stderr,
+	   "Usage: yaep_bench [--iterations N] [--workload NAME]... "
+	   "[--data-dir DIR]\n"
+	   "                  [--baseline FILE] [--compare FILE "
+	   "[--threshold PERCENT]\n"
+	   "                  [--no-time]]\n"
+	   "Workloads: expr_micro ansic ambiguous error_recovery\n");
+  exit (2);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct workload workloads[4];
+  struct result results[4];
+  const char *selected[4];
+  const char *data_dir = YAEP_BENCH_DATA_DIR;
+  const char *baseline_file = NULL, *compare_file = NULL;
+  char *ansic_description = NULL, *ansic_text = NULL, *baseline = NULL;
+  int iterations = DEFAULT_ITERATIONS, n_selected = 0, n_results = 0;
+  int i, j, n_workloads, n_regressions = 0, no_time_p = 0;
+  double threshold = DEFAULT_THRESHOLD;
+  char path[4096];
+  FILE *f;
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "--no-time") == 0)
+	{
+	  no_time_p = 1;
+	  continue;
+	}
+      if (i + 1 >= argc)
+	usage ();
+      if (strcmp (argv[i], "--iterations") == 0)
+	{
+	  if ((iterations = atoi (argv[++i])) <= 0)
+	    usage ();
+	}
+      else if (strcmp (argv[i], "--workload") == 0)
+	{
+	  if (n_selected >= 4)
+	    usage ();
+	  selected[n_selected++] = argv[++i];
+	}
+      else if (strcmp (argv[i], "--data-dir") == 0)
+	data_dir = argv[++i];
+      else if (strcmp (argv[i], "--baseline") == 0)
+	baseline_file = argv[++i];
+      else if (strcmp (argv[i], "--compare") == 0)
+	compare_file = argv[++i];
+      else if (strcmp (argv[i], "--threshold") == 0)
+	threshold = atof (argv[++i]);
+      else
+	usage ();
+    }
+  if (compare_file != NULL && (baseline = read_file (compare_file)) == NULL)
+    {
+      fprintf (stderr, "yaep_bench: can not read %s\n", compare_file);
+      return 2;
+    }
+
+  memset (workloads, 0, sizeof (workloads));
+  n_workloads = 0;
+  workloads[n_workloads].name = "expr_micro";
+  workloads[n_workloads].description = expr_description;
+  workloads[n_workloads].lookahead_level = 1;
+  workloads[n_workloads].one_parse_p = 1;
+  expr_micro_input (&workloads[n_workloads++], 5000);
+  snprintf (path, sizeof (path), "%s/test_yaep.c.description", data_dir);
+  ansic_description = read_file (path);
+  snprintf (path, sizeof (path), "%s/test.i", data_dir);
+  ansic_text = read_file (path);
+  if (ansic_description == NULL || ansic_text == NULL)
+    fprintf (stderr, "yaep_bench: no ANSI C data in %s, ansic is skipped\n",
+	     data_dir);
+  else
+    {
+      workloads[n_workloads].name = "ansic";
+      workloads[n_workloads].description = ansic_description;
+      workloads[n_workloads].lookahead_level = 1;
+      workloads[n_workloads].one_parse_p = 1;
+      ansic_input (&workloads[n_workloads++], ansic_text);
+    }
+  workloads[n_workloads].name = "ambiguous";
+  workloads[n_workloads].description = ambiguous_description;
+  workloads[n_workloads].lookahead_level = 1;
+  workloads[n_workloads].one_parse_p = 1;
+  ambiguous_input (&workloads[n_workloads++], 120);
+  workloads[n_workloads].name = "error_recovery";
+  workloads[n_workloads].description = error_recovery_description;
+  workloads[n_workloads].lookahead_level = 1;
+  workloads[n_workloads].one_parse_p = 1;
+  workloads[n_workloads].error_recovery_p = 1;
+  error_recovery_input (&workloads[n_workloads++], 3000);
+
+  for (i = 0; i < n_workloads; i++)
+    {
+      for (j = 0; j < n_selected; j++)
+	if (strcmp (selected[j], workloads[i].name) == 0)
+	  break;
+      if (n_selected != 0 && j >= n_selected)
+	continue;
+      if (!run_workload (&workloads[i], iterations, &results[n_results]))
+	return 1;
+      n_results++;
+    }
+  print_results (stdout, results, n_results);
+  if (baseline_file != NULL)
+    {
+      if ((f = fopen (baseline_file, "w")) == NULL)
+	{
+	  fprintf (stderr, "yaep_bench: can not write %s\n", baseline_file);
+	  return 2;
+	}
+      print_results (f, results, n_results);
+      fclose (f);
+    }
+  if (baseline != NULL)
+    n_regressions = compare_results (baseline, results, n_results,
+				     threshold, no_time_p);
+  for (i = 0; i < n_workloads; i++)
+    free (workloads[i].codes);
+  free (ansic_description);
+  free (ansic_text);
+  free (baseline);
+  return n_regressions == 0 ? 0 : 1;
+}
@@ -89,6 +89,18 @@ class Grammar:
 		"""
 		return int(_cffi.parse_grammar_bytes(self._g, strict, buf))
 
+	def save_compiled(self, path) -> int:
+		"""Save the grammar into a compiled grammar file.  Returns YAEP return code."""
+		return int(_cffi.save_compiled_grammar(self._g, path))
+
+	def load_compiled(self, path) -> int:
+		"""Load the grammar from a file written by save_compiled().
+
+		The file is mapped read-only and should not change while the grammar
+		is used.  Returns YAEP return code.
+		"""
+		return int(_cffi.load_compiled_grammar(self._g, path))
+
 	def parse(self, tokens: Iterable[int]) -> Tuple[int, Optional[ParseTree], Optional[Tuple[int, int, int]]]:
 		"""Parse a stream of integer token codes.
 
@@ -144,6 +156,20 @@ class Grammar:
 	def set_recovery_match(self, n_toks: int) -> int:
 		return int(_cffi.set_recovery_match(self._g, n_toks))
 
+	def set_leo_flag(self, flag: int) -> int:
+		return int(_cffi.set_leo_flag(self._g, flag))
+
+	def set_recognition_flag(self, flag: int) -> int:
+		return int(_cffi.set_recognition_flag(self._g, flag))
+
+	def parse_stats(self, total: bool = False) -> Dict[str, int]:
+		"""Return statistics of the last parse (or their sums for all parses
+		if total is true) as a dict keyed by struct yaep_parse_stats members."""
+		return _cffi.get_parse_stats(self._g, total)
+
+	def reset_parse_stats(self) -> None:
+		_cffi.reset_parse_stats(self._g)
+
 	def read_grammar_from_lists(self, terminals: List[Tuple[str, Optional[int]]], rules: List[Dict], strict: bool = True) -> int:
 		"""Read grammar from Python lists of terminals and rules.
 
@@ -7,6 +7,8 @@ _ffi.cdef("""
 typedef struct grammar grammar;
 grammar *yaep_create_grammar(void);
 int yaep_parse_grammar(grammar *g, int strict_p, const char *description);
+int yaep_save_compiled_grammar(grammar *g, const char *path);
+int yaep_load_compiled_grammar(grammar *g, const char *path);
 void yaep_free_grammar(grammar *g);
 int yaep_error_code(struct grammar *g);
 const char *yaep_error_message(struct grammar *g);
@@ -16,6 +18,46 @@ int yaep_set_one_parse_flag(struct grammar *grammar, int flag);
 int yaep_set_cost_flag(struct grammar *grammar, int flag);
 int yaep_set_error_recovery_flag(struct grammar *grammar, int flag);
 int yaep_set_recovery_match(struct grammar *grammar, int n_toks);
+int yaep_set_leo_flag(struct grammar *grammar, int flag);
+int yaep_set_recognition_flag(struct grammar *grammar, int flag);
+
+struct yaep_parse_stats {
+    long n_parses;
+    long n_ambiguous_parses;
+    long n_tokens;
+    long n_sits;
+    long n_term_sets;
+    long term_sets_size;
+    long n_set_cores;
+    long n_set_core_start_sits;
+    long n_parent_indexes;
+    long n_set_dists;
+    long n_set_dists_len;
+    long n_sets;
+    long n_sets_start_sits;
+    long n_set_term_lookaheads;
+    long n_goto_successes;
+    long n_goto_cache_hits;
+    long n_leo_items;
+    long n_leo_uses;
+    long n_core_symb_pairs;
+    long n_core_symb_vect_len;
+    long n_transition_vects;
+    long n_transition_vect_len;
+    long n_transitive_transition_vects;
+    long n_transitive_transition_vect_len;
+    long n_reduce_vects;
+    long n_reduce_vect_len;
+    long n_term_nodes;
+    long n_abstract_nodes;
+    long n_alt_nodes;
+    long n_tab_searches;
+    long n_tab_collisions;
+    long parse_cache_size;
+};
+void yaep_get_parse_stats(struct grammar *g, int total_p,
+                          struct yaep_parse_stats *stats);
+void yaep_reset_parse_stats(struct grammar *g);
 
 /* Parse API with callbacks and tree structures (simplified declarations). */
 enum yaep_tree_node_type { YAEP_NIL, YAEP_ERROR, YAEP_TERM, YAEP_ANODE, YAEP_ALT };
@@ -55,6 +97,14 @@ int yaep_parse(struct grammar *grammar,
                              struct yaep_tree_node **root,
                              int *ambiguous_p);
 
+int yaep_parse_tokens(struct grammar *grammar,
+                      int n, const int *codes, void *const *attrs,
+                      void (*syntax_error) (int, void *, int, void *, int, void *),
+                      void *(*parse_alloc) (int nmemb),
+                      void (*parse_free) (void *mem),
+                      struct yaep_tree_node **root,
+                      int *ambiguous_p);
+
 void yaep_free_tree(struct yaep_tree_node * root, void (*parse_free) (void *), void (*termcb) (struct yaep_term * term));
 
 int yaep_read_grammar(struct grammar *g, int strict_p,
@@ -111,22 +161,30 @@ def parse_grammar_bytes(g, strict_p, buf: bytes):
     return _lib.yaep_parse_grammar(g, int(strict_p), c)
 
 
+def save_compiled_grammar(g, path):
+    return int(_lib.yaep_save_compiled_grammar(g, os.fsencode(path)))
+
+
+def load_compiled_grammar(g, path):
+    return int(_lib.yaep_load_compiled_grammar(g, os.fsencode(path)))
+
+
 def parse_with_tokens(grammar_ptr, token_iterable):
-    """Call yaep_parse with a Python iterable of token integers.
+    """Call yaep_parse_tokens with a Python iterable of token integers.
+
+    The tokens are passed to YAEP as one C array, so no Python callback
+    is called per token.  As with a read_token callback, a negative
+    token ends the input.
 
-    Returns (root_ptr, ambiguous, syntax_error_info)
+    Returns (rc, root_ptr, ambiguous, syntax_error_info)
     """
-    it = iter(token_iterable)
-
-    @_ffi.callback("int(void **)" )
-    def read_token(attr_ptr):
-        try:
-            tok = next(it)
-        except StopIteration:
-            return -1
-        # attr is not used; set to NULL
-        attr_ptr[0] = _ffi.NULL
-        return int(tok)
+    codes = []
+    for tok in token_iterable:
+        tok = int(tok)
+        if tok < 0:
+            break
+        codes.append(tok)
+    c_codes = _ffi.new("int[]", codes)
 
     syntax_err = {'called': False, 'info': None}
 
@@ -138,7 +196,7 @@ def parse_with_tokens(grammar_ptr, token_iterable):
     root_ptr = _ffi.new("struct yaep_tree_node **")
     ambiguous_p = _ffi.new("int *")
 
-    rc = _lib.yaep_parse(grammar_ptr, read_token, syntax_error, _ffi.NULL, _ffi.NULL, root_ptr, ambiguous_p)
+    rc = _lib.yaep_parse_tokens(grammar_ptr, len(codes), c_codes, _ffi.NULL, syntax_error, _ffi.NULL, _ffi.NULL, root_ptr, ambiguous_p)
 
     # Return root pointer (may be NULL), ambiguous flag, and syntax error info
     return int(rc), root_ptr[0], int(ambiguous_p[0]), syntax_err
@@ -190,6 +248,24 @@ def set_error_recovery_flag(g, flag):
 def set_recovery_match(g, n_toks):
     return int(_lib.yaep_set_recovery_match(g, int(n_toks)))
 
+
+def set_leo_flag(g, flag):
+    return int(_lib.yaep_set_leo_flag(g, int(flag)))
+
+
+def set_recognition_flag(g, flag):
+    return int(_lib.yaep_set_recognition_flag(g, int(flag)))
+
+def get_parse_stats(g, total):
+    """Return parse statistics of grammar g as a dict of member names."""
+    stats = _ffi.new("struct yaep_parse_stats *")
+    _lib.yaep_get_parse_stats(g, int(bool(total)), stats)
+    return {name: int(getattr(stats, name))
+            for name, _ in _ffi.typeof("struct yaep_parse_stats").fields}
+
+def reset_parse_stats(g):
+    _lib.yaep_reset_parse_stats(g)
+
 def read_grammar_from_lists(grammar_ptr, strict_p, terminals, rules):
     """Call yaep_read_grammar with Python lists for terminals and rules.
 
@@ -0,0 +1,36 @@
+from yaep_python import Grammar
+
+
+def test_save_and_load_compiled(tmp_path):
+    desc = "TERM;\nS : 'a' S 'b' # s (1) | ;\n"
+    path = tmp_path / "g.cgr"
+    g = Grammar()
+    assert g.save_compiled(path) != 0  # undefined grammar
+    assert g.parse_description(desc, strict=True) == 0
+    assert g.save_compiled(path) == 0
+
+    loaded = Grammar()
+    assert loaded.load_compiled(path) == 0
+    tokens = [ord('a'), ord('a'), ord('b'), ord('b')]
+    rc, tree, syntax_err = loaded.parse(tokens)
+    assert rc == 0
+    assert tree is not None
+    assert syntax_err is None
+    tree.free()
+
+    rc, tree, syntax_err = loaded.parse([ord('a'), ord('b'), ord('b')])
+    assert syntax_err is not None
+    if tree is not None:
+        tree.free()
+    loaded.free()
+    g.free()
+
+
+def test_load_bad_compiled(tmp_path):
+    path = tmp_path / "bad.cgr"
+    path.write_bytes(b"TERM;\nS : 'a';\n")
+    g = Grammar()
+    assert g.load_compiled(path) == 20
+    assert g.load_compiled(tmp_path / "missing.cgr") == 19
+    assert g.error_message()
+    g.free()
@@ -0,0 +1,26 @@
+from yaep_python import Grammar
+
+
+def test_parse_stats():
+    desc = "TERM;\nE : E '+' E # plus (0 2) | 'a' # 0 ;\n"
+    g = Grammar()
+    assert g.parse_description(desc, strict=True) == 0
+    assert g.parse_stats(total=True)['n_parses'] == 0
+    a, plus = ord('a'), ord('+')
+    rc, tree, syntax_err = g.parse([a, plus, a, plus, a])
+    assert rc == 0 and tree is not None
+    tree.free()
+    stats = g.parse_stats()
+    assert stats['n_parses'] == 1
+    assert stats['n_ambiguous_parses'] == 1
+    assert stats['n_tokens'] == 5
+    assert stats['n_term_nodes'] == 3
+    assert stats['n_sets'] > 0
+    rc, tree, syntax_err = g.parse([a])
+    tree.free()
+    total = g.parse_stats(total=True)
+    assert total['n_parses'] == 2
+    assert total['n_tokens'] == 6
+    g.reset_parse_stats()
+    assert g.parse_stats(total=True)['n_parses'] == 0
+    g.free()
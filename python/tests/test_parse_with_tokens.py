@@ -15,3 +15,32 @@ def test_parse_with_empty_tokens():
     assert tree is None or hasattr(tree, 'root')
     assert syntax_err is None  # No syntax error expected
     g.free()
+
+
+def test_parse_with_token_list():
+    g = Grammar()
+    desc = "TERM;\nS : 'a' S 'b' # s (1) | ;\n"
+    rc = g.parse_description(desc, strict=True)
+    assert rc == 0
+
+    # The whole token list is passed to YAEP as one array.
+    rc2, tree, syntax_err = g.parse([ord('a'), ord('a'), ord('b'), ord('b')])
+    assert rc2 == 0
+    assert tree is not None
+    assert syntax_err is None
+    tree.free()
+
+    # A negative token ends the input as with a read_token callback.
+    rc3, tree, syntax_err = g.parse([ord('a'), ord('b'), -1, ord('b')])
+    assert rc3 == 0
+    assert syntax_err is None
+    if tree is not None:
+        tree.free()
+
+    # An unbalanced input reports the syntax error on the end marker.
+    rc4, tree, syntax_err = g.parse([ord('a'), ord('a'), ord('b')])
+    assert rc4 == 0
+    assert syntax_err is not None and syntax_err[0] == 3
+    if tree is not None:
+        tree.free()
+    g.free()
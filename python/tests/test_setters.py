@@ -16,4 +16,8 @@ def test_setters_bindings():
     assert isinstance(prev, int)
     prev = g.set_recovery_match(3)
     assert isinstance(prev, int)
+    assert g.set_leo_flag(1) == 0
+    assert g.set_leo_flag(0) == 1
+    assert g.set_recognition_flag(1) == 0
+    assert g.set_recognition_flag(0) == 1
     g.free()
@@ -37,10 +37,13 @@
        tables can be also removed.  The table element can be only a
        pointer.  The size of hash tables is not fixed.  The hash table
        will be expanded when its occupancy will became big.  The
-       abstract data implementation is based on generalized Algorithm
-       D from Knuth's book "The art of computer programming".  Hash
-       table is expanded by creation of new hash table and
-       transferring elements from the old table to the new table.
+       abstract data implementation probes groups of control bytes
+       keeping 7 bits of the element hashes (as Swiss tables of
+       Abseil do).  If macro `CLASSIC_HASH_TABLE' is defined, the
+       implementation is based on generalized Algorithm D from Knuth's
+       book "The art of computer programming".  Hash table is expanded
+       by allocation of bigger table and transferring elements from
+       the old table to the new table.
 
    SPECIAL CONSIDERATION:
          Defining macro `NDEBUG' (e.g. by option `-D' in C compiler
@@ -53,6 +56,19 @@
 #include "hashtab.h"
 
 #include <assert.h>
+#include <string.h>
+
+/* The following variable is used for debugging. Its value is number
+   of all calls of `find_hash_table_entry' for all hash tables. */
+
+YAEP_THREAD_LOCAL int all_searches = 0;
+
+/* The following variable is used for debugging. Its value is number
+   of collisions fixed for time of work with all hash tables. */
+
+YAEP_THREAD_LOCAL int all_collisions = 0;
+
+#ifdef CLASSIC_HASH_TABLE
 
 /* This macro defines reserved value for empty table entry. */
 
@@ -180,16 +196,6 @@ expand_hash_table (hash_table_t htab)
   yaep_free (new_htab->alloc, new_htab);
 }
 
-/* The following variable is used for debugging. Its value is number
-   of all calls of `find_hash_table_entry' for all hash tables. */
-
-int all_searches = 0;
-
-/* The following variable is used for debugging. Its value is number
-   of collisions fixed for time of work with all hash tables. */
-
-int all_collisions = 0;
-
 /* This function searches for hash table entry which contains element
    equal to given value or empty entry in which given value can be
    placed (if the element with given value does not exist in the
@@ -253,6 +259,53 @@ find_hash_table_entry (hash_table_t htab,
   return entry_ptr;
 }
 
+/* This function returns the table element equal to ELEMENT or NULL if
+   there is no such element.  In contrast to `find_hash_table_entry',
+   the function never changes the table (it does not expand the table
+   and does not update the search statistics), so several threads can
+   search in the same table simultaneously if nobody changes it. */
+
+hash_table_entry_t
+lookup_hash_table_entry (hash_table_t htab, hash_table_entry_t element)
+{
+  hash_table_entry_t *entry_ptr;
+  size_t hash_value, secondary_hash_value;
+
+  assert (htab != NULL);
+  hash_value = (*htab->hash_function) (element);
+  secondary_hash_value = 1 + hash_value % (htab->size - 2);
+  hash_value %= htab->size;
+  for (;;)
+    {
+      entry_ptr = htab->entries + hash_value;
+      if (*entry_ptr == EMPTY_ENTRY)
+	return NULL;
+      else if (*entry_ptr != DELETED_ENTRY
+	       && (*htab->eq_function) (*entry_ptr, element))
+	return *entry_ptr;
+      hash_value += secondary_hash_value;
+      if (hash_value >= htab->size)
+	hash_value -= htab->size;
+    }
+}
+
+/* This function calls FUNC with each element of the table and ARG.
+   FUNC should not change the table. */
+
+void
+traverse_hash_table (hash_table_t htab,
+		     void (*func) (hash_table_entry_t el, void *arg),
+		     void *arg)
+{
+  hash_table_entry_t *entry_ptr;
+
+  assert (htab != NULL);
+  for (entry_ptr = htab->entries; entry_ptr < htab->entries + htab->size;
+       entry_ptr++)
+    if (*entry_ptr != EMPTY_ENTRY && *entry_ptr != DELETED_ENTRY)
+      (*func) (*entry_ptr, arg);
+}
+
 /* This function deletes element with given value from hash table.
    The hash table entry value will be `DELETED_ENTRY' after the
    function call.  Naturally the hash table must already exist.  Hash
@@ -271,6 +324,374 @@ remove_element_from_hash_table_entry (hash_table_t htab,
   htab->number_of_deleted_elements++;
 }
 
+#else /* #ifdef CLASSIC_HASH_TABLE */
+
+/* The following is implementation of the tables probing groups of
+   control bytes (it is analogous to Swiss tables of Abseil).  The
+   number of entries is a power of 2 and each entry has a control
+   byte: CTRL_EMPTY, CTRL_DELETED, or 7 bits of the element hash for
+   an occupied entry.  A probe loads HASH_TABLE_GROUP_SIZE control
+   bytes starting with the entry given by the hash and compares them
+   with the 7 bits at once, and only the elements with the same bits
+   are compared by the equality function.  The next groups are
+   probed quadratically.  The control bytes of the first group are
+   repeated after the last entry, so a group can start with any
+   entry.  Empty and deleted entries contain NULL. */
+
+#if defined (__GNUC__) && defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+
+/* The minimal number of entries. */
+#define MIN_SIZE HASH_TABLE_GROUP_SIZE
+
+/* The following macros return the number of the first entry of the
+   probe sequence and the control byte for hash value HASH.  The hash
+   is mixed by multiplication, so the both use well mixed bits. */
+#define MIXED_HASH(hash) ((unsigned long long) (hash) * 0x9E3779B97F4A7C15ULL)
+#define PROBE_START(mixed) ((size_t) ((mixed) ^ ((mixed) >> 32)))
+#define CTRL_TAG(mixed) ((unsigned char) ((mixed) >> 57))
+
+/* The following function returns the bit mask of the bytes in the
+   group starting with control byte CTRL which are equal to BYTE. */
+
+static unsigned
+group_match (const unsigned char *ctrl, unsigned char byte)
+{
+#if defined (__GNUC__) && defined (__SSE2__)
+  __m128i group = _mm_loadu_si128 ((const __m128i *) ctrl);
+
+  return (unsigned) _mm_movemask_epi8 (_mm_cmpeq_epi8 (group,
+						       _mm_set1_epi8 ((char) byte)));
+#else
+  unsigned i, mask = 0;
+
+  for (i = 0; i < HASH_TABLE_GROUP_SIZE; i++)
+    mask |= (unsigned) (ctrl[i] == byte) << i;
+  return mask;
+#endif
+}
+
+/* The following function returns the number of the lowest bit set in
+   non-zero MASK. */
+
+static unsigned
+lowest_bit (unsigned mask)
+{
+#ifdef __GNUC__
+  return (unsigned) __builtin_ctz (mask);
+#else
+  unsigned i;
+
+  for (i = 0; (mask & 1) == 0; i++)
+    mask >>= 1;
+  return i;
+#endif
+}
+
+/* The following function sets up control byte of entry with number
+   I of HTAB to BYTE. */
+
+static void
+set_ctrl (hash_table_t htab, size_t i, unsigned char byte)
+{
+  htab->ctrl[i] = byte;
+  if (i < HASH_TABLE_GROUP_SIZE)
+    htab->ctrl[htab->size + i] = byte;
+}
+
+/* The following function allocates SIZE empty entries for HTAB.  It
+   returns nonzero if there is no memory. */
+
+static int
+allocate_entries (hash_table_t htab, size_t size)
+{
+  char *mem;
+
+  mem = yaep_malloc (htab->alloc,
+		     size * (sizeof (hash_table_entry_t) + sizeof (unsigned))
+		     + size + HASH_TABLE_GROUP_SIZE);
+  if (mem == NULL)
+    return 1;
+  htab->size = size;
+  htab->entries = (hash_table_entry_t *) (void *) mem;
+  htab->hashes = (unsigned *) (void *) (htab->entries + size);
+  htab->ctrl = (unsigned char *) (htab->hashes + size);
+  memset (htab->entries, 0, size * sizeof (hash_table_entry_t));
+  memset (htab->ctrl, CTRL_EMPTY, size + HASH_TABLE_GROUP_SIZE);
+  return 0;
+}
+
+/* This function creates table with length not less than given source
+   length.  Created hash table is initiated as empty.  The function
+   returns the created hash table. */
+
+hash_table_t
+create_hash_table (YaepAllocator * allocator, size_t size,
+		   unsigned int (*hash_function) (hash_table_entry_t el_ptr),
+		   int (*eq_function) (hash_table_entry_t el1_ptr,
+				       hash_table_entry_t el2_ptr))
+{
+  hash_table_t result;
+  size_t n;
+
+  result = yaep_malloc (allocator, sizeof (*result));
+  if (result == NULL)
+    return NULL;
+  result->alloc = allocator;
+  for (n = MIN_SIZE; n < size; n *= 2)
+    ;
+  if (allocate_entries (result, n) != 0)
+    {
+      yaep_free (allocator, result);
+      return NULL;
+    }
+  result->hash_function = hash_function;
+  result->eq_function = eq_function;
+  result->number_of_elements = 0;
+  result->number_of_deleted_elements = 0;
+  result->searches = 0;
+  result->collisions = 0;
+  return result;
+}
+
+/* This function makes the table empty.  Naturally the hash table must
+   already exist. */
+
+void
+empty_hash_table (hash_table_t htab)
+{
+  assert (htab != NULL);
+  htab->number_of_elements = 0;
+  htab->number_of_deleted_elements = 0;
+  memset (htab->entries, 0, htab->size * sizeof (hash_table_entry_t));
+  memset (htab->ctrl, CTRL_EMPTY, htab->size + HASH_TABLE_GROUP_SIZE);
+}
+
+/* This function frees all memory allocated for given hash table.
+   Naturally the hash table must already exist. */
+
+void
+delete_hash_table (hash_table_t htab)
+{
+  assert (htab != NULL);
+  yaep_free (htab->alloc, htab->entries);
+  yaep_free (htab->alloc, htab);
+}
+
+/* The following function changes size of memory allocated for the
+   entries and places the table elements again using their stored
+   hashes.  The occupancy of the table after the call will be at most
+   50%, deleted elements are removed.  Remember also that the place of
+   the table entries is changed. */
+
+static void
+expand_hash_table (hash_table_t htab)
+{
+  struct
+  {
+    size_t size;
+    hash_table_entry_t *entries;
+    unsigned *hashes;
+    unsigned char *ctrl;
+  } old;
+  size_t i, n, pos, step, mask;
+  unsigned long long mixed;
+  unsigned empty_mask;
+
+  old.size = htab->size;
+  old.entries = htab->entries;
+  old.hashes = htab->hashes;
+  old.ctrl = htab->ctrl;
+  n = 2 * (htab->number_of_elements - htab->number_of_deleted_elements);
+  for (i = MIN_SIZE; i < n; i *= 2)
+    ;
+  if (allocate_entries (htab, i) != 0)
+    return;
+  mask = htab->size - 1;
+  for (i = 0; i < old.size; i++)
+    if (old.ctrl[i] < CTRL_EMPTY && old.entries[i] != NULL)
+      {
+	mixed = MIXED_HASH (old.hashes[i]);
+	for (pos = PROBE_START (mixed) & mask, step = 0;;)
+	  {
+	    empty_mask = group_match (htab->ctrl + pos, CTRL_EMPTY);
+	    if (empty_mask != 0)
+	      break;
+	    step += HASH_TABLE_GROUP_SIZE;
+	    pos = (pos + step) & mask;
+	  }
+	pos = (pos + lowest_bit (empty_mask)) & mask;
+	set_ctrl (htab, pos, CTRL_TAG (mixed));
+	htab->entries[pos] = old.entries[i];
+	htab->hashes[pos] = old.hashes[i];
+      }
+  htab->number_of_elements -= htab->number_of_deleted_elements;
+  htab->number_of_deleted_elements = 0;
+  yaep_free (htab->alloc, old.entries);
+}
+
+/* The following function returns the number of the entry of HTAB
+   containing element equal to ELEMENT with HASH or the number of an
+   entry where the element can be placed (if the element does not
+   exist in the table).  The entry is reserved for the element if
+   RESERVE. */
+
+static size_t
+find_slot (hash_table_t htab, hash_table_entry_t element, unsigned hash,
+	   int reserve)
+{
+  unsigned long long mixed = MIXED_HASH (hash);
+  unsigned char tag = CTRL_TAG (mixed);
+  size_t pos, step, i, mask = htab->size - 1;
+  size_t deleted = (size_t) -1;
+  unsigned match, empty_mask;
+
+  for (pos = PROBE_START (mixed) & mask, step = 0;;)
+    {
+      for (match = group_match (htab->ctrl + pos, tag); match != 0;
+	   match &= match - 1)
+	{
+	  i = (pos + lowest_bit (match)) & mask;
+	  if (htab->entries[i] != NULL
+	      && (*htab->eq_function) (htab->entries[i], element))
+	    return i;
+	  htab->collisions++;
+	  all_collisions++;
+	}
+      empty_mask = group_match (htab->ctrl + pos, CTRL_EMPTY);
+      if (reserve && deleted == (size_t) -1)
+	{
+	  match = group_match (htab->ctrl + pos, CTRL_DELETED);
+	  if (match != 0)
+	    deleted = (pos + lowest_bit (match)) & mask;
+	}
+      if (empty_mask != 0)
+	break;
+      step += HASH_TABLE_GROUP_SIZE;
+      pos = (pos + step) & mask;
+      htab->collisions++;
+      all_collisions++;
+    }
+  i = (pos + lowest_bit (empty_mask)) & mask;
+  if (reserve)
+    {
+      if (deleted != (size_t) -1)
+	{
+	  i = deleted;
+	  htab->number_of_deleted_elements--;
+	}
+      else
+	htab->number_of_elements++;
+      set_ctrl (htab, i, tag);
+      htab->hashes[i] = hash;
+    }
+  return i;
+}
+
+/* This function searches for hash table entry which contains element
+   equal to given value or empty entry in which given value can be
+   placed (if the element with given value does not exist in the
+   table).  The function works in two regimes.  The first regime is
+   used only for search.  The second is used for search and
+   reservation empty entry for given value.  The table is expanded if
+   occupancy (taking into accout also deleted elements) is more than
+   7/8.  Naturally the hash table must already exist.  If reservation
+   flag is TRUE then the element with given value should be inserted
+   into the table entry before another call of
+   `find_hash_table_entry'. */
+
+hash_table_entry_t *
+find_hash_table_entry (hash_table_t htab,
+		       hash_table_entry_t element, int reserve)
+{
+  assert (htab != NULL);
+  if (reserve && htab->number_of_elements >= htab->size - htab->size / 8)
+    expand_hash_table (htab);
+  htab->searches++;
+  all_searches++;
+  return htab->entries + find_slot (htab, element,
+				    (*htab->hash_function) (element),
+				    reserve);
+}
+
+/* This function returns the table element equal to ELEMENT or NULL if
+   there is no such element.  In contrast to `find_hash_table_entry',
+   the function never changes the table (it does not expand the table
+   and does not update the search statistics), so several threads can
+   search in the same table simultaneously if nobody changes it. */
+
+hash_table_entry_t
+lookup_hash_table_entry (hash_table_t htab, hash_table_entry_t element)
+{
+  unsigned long long mixed;
+  unsigned char tag;
+  size_t pos, step, i, mask;
+  unsigned match;
+
+  assert (htab != NULL);
+  mixed = MIXED_HASH ((*htab->hash_function) (element));
+  tag = CTRL_TAG (mixed);
+  mask = htab->size - 1;
+  for (pos = PROBE_START (mixed) & mask, step = 0;;)
+    {
+      for (match = group_match (htab->ctrl + pos, tag); match != 0;
+	   match &= match - 1)
+	{
+	  i = (pos + lowest_bit (match)) & mask;
+	  if (htab->entries[i] != NULL
+	      && (*htab->eq_function) (htab->entries[i], element))
+	    return htab->entries[i];
+	}
+      if (group_match (htab->ctrl + pos, CTRL_EMPTY) != 0)
+	return NULL;
+      step += HASH_TABLE_GROUP_SIZE;
+      pos = (pos + step) & mask;
+    }
+}
+
+/* This function calls FUNC with each element of the table and ARG.
+   FUNC should not change the table. */
+
+void
+traverse_hash_table (hash_table_t htab,
+		     void (*func) (hash_table_entry_t el, void *arg),
+		     void *arg)
+{
+  size_t i;
+
+  assert (htab != NULL);
+  for (i = 0; i < htab->size; i++)
+    if (htab->entries[i] != NULL)
+      (*func) (htab->entries[i], arg);
+}
+
+/* This function deletes element with given value from hash table.
+   The hash table entry will be marked as deleted after the function
+   call.  Naturally the hash table must already exist.  Hash table
+   entry for given value should be not empty (or deleted). */
+
+void
+remove_element_from_hash_table_entry (hash_table_t htab,
+				      hash_table_entry_t element)
+{
+  size_t i;
+
+  assert (htab != NULL);
+  htab->searches++;
+  all_searches++;
+  i = find_slot (htab, element, (*htab->hash_function) (element), 0);
+  assert (htab->entries[i] != NULL);
+  htab->entries[i] = NULL;
+  set_ctrl (htab, i, CTRL_DELETED);
+  htab->number_of_deleted_elements++;
+}
+
+#endif /* #ifdef CLASSIC_HASH_TABLE */
+
 /* The following function returns current size of given hash table. */
 
 size_t
@@ -37,10 +37,13 @@
        tables can be also removed.  The table element can be only a
        pointer.  The size of hash tables is not fixed.  The hash table
        will be expanded when its occupancy will became big.  The
-       abstract data implementation is based on generalized Algorithm
-       D from Knuth's book "The art of computer programming".  Hash
-       table is expanded by creation of new hash table and
-       transferring elements from the old table to the new table.
+       abstract data implementation probes groups of control bytes
+       keeping 7 bits of the element hashes (as Swiss tables of
+       Abseil do).  If macro `CLASSIC_HASH_TABLE' is defined, the
+       implementation is based on generalized Algorithm D from Knuth's
+       book "The art of computer programming".  Hash table is expanded
+       by allocation of bigger table and transferring elements from
+       the old table to the new table.
 
    SPECIAL CONSIDERATION:
          Defining macro `NDEBUG' (e.g. by option `-D' in C++ compiler
@@ -53,6 +56,19 @@
 #include "hashtab.h"
 
 #include <assert.h>
+#include <string.h>
+
+/* The following variable is used for debugging. Its value is number
+   of all calls of `find_hash_table_entry' for all hash tables. */
+
+YAEP_THREAD_LOCAL int hash_table::all_searches = 0;
+
+/* The following variable is used for debugging. Its value is number
+   of collisions fixed for time of work with all hash tables. */
+
+YAEP_THREAD_LOCAL int hash_table::all_collisions = 0;
+
+#ifdef CLASSIC_HASH_TABLE
 
 /* This macro defines reserved value for empty table entry. */
 
@@ -154,71 +170,36 @@ hash_table::expand_hash_table (void)
   yaep_free (new_htab->alloc, new_htab);
 }
 
-/* The following variable is used for debugging. Its value is number
-   of all calls of `find_hash_table_entry' for all hash tables. */
+/* The following functions search the table with the hash and
+   equality functions given to the constructor (see find_entry_with
+   and lookup_with). */
 
-int hash_table::all_searches = 0;
-
-/* The following variable is used for debugging. Its value is number
-   of collisions fixed for time of work with all hash tables. */
+hash_table_entry_t *
+hash_table::find_entry (hash_table_entry_t element, int reserve)
+{
+  return find_entry_with (hash_table_func_ptrs (hash_function, eq_function),
+			  element, reserve);
+}
 
-int hash_table::all_collisions = 0;
+hash_table_entry_t
+hash_table::lookup (hash_table_entry_t element) const
+{
+  return lookup_with (hash_table_func_ptrs (hash_function, eq_function),
+		      element);
+}
 
-/* This function searches for hash table entry which contains element
-   equal to given value or empty entry in which given value can be
-   placed (if the element with given value does not exist in the
-   table).  The function works in two regimes.  The first regime is
-   used only for search.  The second is used for search and
-   reservation empty entry for given value.  The table is expanded if
-   occupancy (taking into accout also deleted elements) is more than
-   75%.  If reservation flag is TRUE then the element with given value
-   should be inserted into the table entry before another call of
-   `find_entry'. */
+/* This function calls FUNC with each element of the table and ARG.
+   FUNC should not change the table. */
 
-hash_table_entry_t *
-hash_table::find_entry (hash_table_entry_t element, int reserve)
+void
+hash_table::traverse (void (*func) (hash_table_entry_t el, void *arg),
+		      void *arg) const
 {
-  hash_table_entry_t *entry_ptr;
-  hash_table_entry_t *first_deleted_entry_ptr;
-  unsigned hash_value, secondary_hash_value;
-
-  if (_size / 4 <= number_of_elements / 3)
-    expand_hash_table();
-  // hash_function returns unsigned, but _size is size_t; cast to unsigned for modulo
-  hash_value = static_cast<unsigned>((*hash_function)(element)); // Explicit cast: hash_function returns unsigned, safe for modulo
-  secondary_hash_value = 1 + hash_value % static_cast<unsigned>(_size - 2); // Explicit cast: _size is size_t, modulo expects unsigned
-  hash_value %= static_cast<unsigned>(_size); // Explicit cast: _size is size_t, modulo expects unsigned
-  searches++;
-  all_searches++;
-  first_deleted_entry_ptr = NULL;
-  for (;; collisions++, all_collisions++)
-    {
-      entry_ptr = entries + hash_value;
-      if (*entry_ptr == EMPTY_ENTRY)
-	{
-	  if (reserve)
-	    {
-	      number_of_elements++;
-	      if (first_deleted_entry_ptr != NULL)
-		{
-		  entry_ptr = first_deleted_entry_ptr;
-		  *entry_ptr = DELETED_ENTRY;
-		}
-	    }
-	  break;
-	}
-      else if (*entry_ptr != DELETED_ENTRY)
-	{
-	  if ((*eq_function) (*entry_ptr, element))
-	    break;
-	}
-      else if (first_deleted_entry_ptr == NULL)
-	first_deleted_entry_ptr = entry_ptr;
-      hash_value += secondary_hash_value;
-      if (hash_value >= _size)
-	hash_value -= static_cast<unsigned>(_size);
-    }
-  return entry_ptr;
+  const hash_table_entry_t *entry_ptr;
+
+  for (entry_ptr = entries; entry_ptr < entries + _size; entry_ptr++)
+    if (*entry_ptr != EMPTY_ENTRY && *entry_ptr != DELETED_ENTRY)
+      (*func) (*entry_ptr, arg);
 }
 
 /* This function deletes element with given value from hash table.
@@ -236,3 +217,177 @@ hash_table::remove_element_from_entry (hash_table_entry_t element)
   *entry_ptr = DELETED_ENTRY;
   number_of_deleted_elements++;
 }
+
+#else /* #ifdef CLASSIC_HASH_TABLE */
+
+/* The following is implementation of the tables probing groups of
+   control bytes (it is analogous to Swiss tables of Abseil).  The
+   number of entries is a power of 2 and each entry has a control
+   byte: ctrl_empty, ctrl_deleted, or 7 bits of the element hash for
+   an occupied entry.  A probe loads HASH_TABLE_GROUP_SIZE control
+   bytes starting with the entry given by the hash and compares them
+   with the 7 bits at once, and only the elements with the same bits
+   are compared by the equality function.  The next groups are
+   probed quadratically.  The control bytes of the first group are
+   repeated after the last entry, so a group can start with any
+   entry.  Empty and deleted entries contain NULL. */
+
+/* The minimal number of entries. */
+#define MIN_SIZE HASH_TABLE_GROUP_SIZE
+
+/* The following function allocates SIZE empty entries for the
+   table. */
+
+void
+hash_table::allocate_entries (size_t size)
+{
+  char *mem;
+
+  mem = static_cast<char *>
+    (yaep_malloc (alloc, size * (sizeof (hash_table_entry_t) + sizeof (unsigned))
+		  + size + HASH_TABLE_GROUP_SIZE));
+  _size = size;
+  entries = reinterpret_cast<hash_table_entry_t *>(mem);
+  hashes = reinterpret_cast<unsigned *>(entries + size);
+  ctrl = reinterpret_cast<unsigned char *>(hashes + size);
+  memset (entries, 0, size * sizeof (hash_table_entry_t));
+  memset (ctrl, ctrl_empty, size + HASH_TABLE_GROUP_SIZE);
+}
+
+/* This constructor creates table with length not less than given
+   source length.  Created hash table is initiated as empty. */
+
+hash_table::hash_table (YaepAllocator * allocator, size_t initial_size,
+                        unsigned int (*hash_func) (hash_table_entry_t el_ptr),
+                        int (*eq_func) (hash_table_entry_t el1_ptr, hash_table_entry_t el2_ptr))
+  : alloc (allocator)
+{
+  size_t n;
+
+  for (n = MIN_SIZE; n < initial_size; n *= 2)
+    ;
+  allocate_entries (n);
+  this->hash_function = hash_func;
+  this->eq_function = eq_func;
+  number_of_elements = 0;
+  number_of_deleted_elements = 0;
+  collisions = 0;
+  searches = 0;
+}
+
+/* This destructor frees all memory allocated for given hash table. */
+
+hash_table::~hash_table (void)
+{
+  yaep_free (alloc, entries);
+}
+
+/* This function makes the table empty.  Naturally the hash table must
+   already exist. */
+
+void
+hash_table::empty (void)
+{
+  number_of_elements = 0;
+  number_of_deleted_elements = 0;
+  memset (entries, 0, _size * sizeof (hash_table_entry_t));
+  memset (ctrl, ctrl_empty, _size + HASH_TABLE_GROUP_SIZE);
+}
+
+/* The following function changes size of memory allocated for the
+   entries and places the table elements again using their stored
+   hashes.  The occupancy of the table after the call will be at most
+   50%, deleted elements are removed.  Remember also that the place of
+   the table entries is changed. */
+
+void
+hash_table::expand_hash_table (void)
+{
+  size_t old_size = _size;
+  hash_table_entry_t *old_entries = entries;
+  unsigned *old_hashes = hashes;
+  unsigned char *old_ctrl = ctrl;
+  size_t i, n, pos, step, mask;
+  unsigned long long mixed;
+  unsigned empty_mask;
+
+  n = 2 * (number_of_elements - number_of_deleted_elements);
+  for (i = MIN_SIZE; i < n; i *= 2)
+    ;
+  allocate_entries (i);
+  mask = _size - 1;
+  for (i = 0; i < old_size; i++)
+    if (old_ctrl[i] < ctrl_empty && old_entries[i] != NULL)
+      {
+	mixed = mixed_hash (old_hashes[i]);
+	for (pos = probe_start (mixed) & mask, step = 0;;)
+	  {
+	    empty_mask = group_match (ctrl + pos, ctrl_empty);
+	    if (empty_mask != 0)
+	      break;
+	    step += HASH_TABLE_GROUP_SIZE;
+	    pos = (pos + step) & mask;
+	  }
+	pos = (pos + lowest_bit (empty_mask)) & mask;
+	set_ctrl (pos, ctrl_tag (mixed));
+	entries[pos] = old_entries[i];
+	hashes[pos] = old_hashes[i];
+      }
+  number_of_elements -= number_of_deleted_elements;
+  number_of_deleted_elements = 0;
+  yaep_free (alloc, old_entries);
+}
+
+/* The following functions search the table with the hash and
+   equality functions given to the constructor (see find_entry_with
+   and lookup_with). */
+
+hash_table_entry_t *
+hash_table::find_entry (hash_table_entry_t element, int reserve)
+{
+  return find_entry_with (hash_table_func_ptrs (hash_function, eq_function),
+			  element, reserve);
+}
+
+hash_table_entry_t
+hash_table::lookup (hash_table_entry_t element) const
+{
+  return lookup_with (hash_table_func_ptrs (hash_function, eq_function),
+		      element);
+}
+
+/* This function calls FUNC with each element of the table and ARG.
+   FUNC should not change the table. */
+
+void
+hash_table::traverse (void (*func) (hash_table_entry_t el, void *arg),
+		      void *arg) const
+{
+  size_t i;
+
+  for (i = 0; i < _size; i++)
+    if (entries[i] != NULL)
+      (*func) (entries[i], arg);
+}
+
+/* This function deletes element with given value from hash table.
+   The hash table entry will be marked as deleted after the function
+   call.  Hash table entry for given value should be not empty (or
+   deleted). */
+
+void
+hash_table::remove_element_from_entry (hash_table_entry_t element)
+{
+  size_t i;
+
+  searches++;
+  all_searches++;
+  i = find_slot (hash_table_func_ptrs (hash_function, eq_function), element,
+		 (*hash_function) (element), 0);
+  assert (entries[i] != NULL);
+  entries[i] = NULL;
+  set_ctrl (i, ctrl_deleted);
+  number_of_deleted_elements++;
+}
+
+#endif /* #ifdef CLASSIC_HASH_TABLE */
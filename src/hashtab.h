@@ -41,6 +41,7 @@
 #include <stdlib.h>
 
 #include"allocate.h"
+#include"yaep_macros.h"
 
 /* The hash table element is represented by the following type. */
 
@@ -54,6 +55,26 @@
    the API boundary. */
 typedef void *hash_table_entry_t;
 
+/* The hash tables are open addressing tables which keep a control
+   byte with 7 bits of the hash for each entry and probe groups of
+   HASH_TABLE_GROUP_SIZE control bytes at once, so the equality
+   function is called only for the elements with the same 7 bits.
+   Define macro CLASSIC_HASH_TABLE to use the tables with double
+   hashing which keep only the element pointers. */
+/* #define CLASSIC_HASH_TABLE */
+
+#ifndef CLASSIC_HASH_TABLE
+#define HASH_TABLE_GROUP_SIZE 16
+#endif
+
+/* The following macro value is the number of bytes used by a table
+   entry. */
+#ifdef CLASSIC_HASH_TABLE
+#define HASH_TABLE_ENTRY_SIZE sizeof (hash_table_entry_t)
+#else
+#define HASH_TABLE_ENTRY_SIZE (sizeof (hash_table_entry_t) + sizeof (unsigned) + 1)
+#endif
+
 
 #ifndef __cplusplus
 
@@ -86,20 +107,29 @@ typedef struct
                       hash_table_entry_t el2_ptr);
   /* Table itself */
   hash_table_entry_t *entries;
+#ifndef CLASSIC_HASH_TABLE
+  /* Control bytes of the entries (the first group is repeated after
+     the last entry) and the hash function values of the elements, so
+     the table is expanded without calling the hash function. */
+  unsigned char *ctrl;
+  unsigned *hashes;
+#endif
   /* Allocator */
   YaepAllocator * alloc;
 } *hash_table_t;
 
 
 /* The following variable is used for debugging. Its value is number
-   of all calls of `find_hash_table_entry' for all hash tables. */
+   of all calls of `find_hash_table_entry' for all hash tables of the
+   current thread. */
 
-extern int all_searches;
+extern YAEP_THREAD_LOCAL int all_searches;
 
 /* The following variable is used for debugging. Its value is number
-   of collisions fixed for time of work with all hash tables. */
+   of collisions fixed for time of work with all hash tables of the
+   current thread. */
 
-extern int all_collisions;
+extern YAEP_THREAD_LOCAL int all_collisions;
 
 /* The prototypes of the package functions. */
 
@@ -125,6 +155,15 @@ find_hash_table_entry_c (hash_table_t htab, const void *element, int reserve)
   return find_hash_table_entry (htab, (hash_table_entry_t) u.v, reserve);
 }
 
+/* Read-only search which never changes the table. */
+extern hash_table_entry_t lookup_hash_table_entry
+   (hash_table_t htab, hash_table_entry_t element);
+
+/* Call a function for each table element. */
+extern void traverse_hash_table
+   (hash_table_t htab, void (*func) (hash_table_entry_t el, void *arg),
+    void *arg);
+
 extern void remove_element_from_hash_table_entry (hash_table_t htab,
                                                   hash_table_entry_t element);
 
@@ -170,12 +209,57 @@ extern int all_hash_table_collision_percentage (void);
 
 #else /* #ifndef __cplusplus */
 
+#ifndef CLASSIC_HASH_TABLE
+#if defined (__GNUC__) && defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+
+/* The following classes call the hash and equality functions of a
+   hash table: the first one through the function pointers given to
+   the table constructor, the second one directly.  The table searches
+   are templates with such class argument, so the compiler can inline
+   the functions given as the template arguments. */
+
+class hash_table_func_ptrs
+{
+  unsigned (*hash_function) (hash_table_entry_t el_ptr);
+  int (*eq_function) (hash_table_entry_t el1_ptr, hash_table_entry_t el2_ptr);
+public:
+  hash_table_func_ptrs (unsigned (*hash_func) (hash_table_entry_t el_ptr),
+                        int (*eq_func) (hash_table_entry_t el1_ptr,
+                                        hash_table_entry_t el2_ptr))
+    : hash_function (hash_func), eq_function (eq_func) {}
+  inline unsigned hash (hash_table_entry_t el) const
+    {
+      return (*hash_function) (el);
+    }
+  inline int eq (hash_table_entry_t el1, hash_table_entry_t el2) const
+    {
+      return (*eq_function) (el1, el2);
+    }
+};
 
+template <unsigned (*Hash) (hash_table_entry_t el_ptr),
+          int (*Eq) (hash_table_entry_t el1_ptr, hash_table_entry_t el2_ptr)>
+class hash_table_funcs
+{
+public:
+  inline unsigned hash (hash_table_entry_t el) const
+    {
+      return Hash (el);
+    }
+  inline int eq (hash_table_entry_t el1, hash_table_entry_t el2) const
+    {
+      return Eq (el1, el2);
+    }
+};
 
 /* Hash tables are of the following class. */
 
 class hash_table
 {
+protected:
   /* Current size (in entries) of the hash table */
   size_t _size;
   /* Current number of elements including also deleted elements */
@@ -197,18 +281,25 @@ class hash_table
                       hash_table_entry_t el2_ptr);
   /* Table itself */
   hash_table_entry_t *entries;
+#ifndef CLASSIC_HASH_TABLE
+  /* Control bytes of the entries (the first group is repeated after
+     the last entry) and the hash function values of the elements, so
+     the table is expanded without calling the hash function. */
+  unsigned char *ctrl;
+  unsigned *hashes;
+#endif
   /* Allocator */
   YaepAllocator * alloc;
 
   /* The following variable is used for debugging. Its value is number
      of all calls of `find_hash_table_entry' for all hash tables. */
 
-  static int all_searches;
+  static YAEP_THREAD_LOCAL int all_searches;
 
   /* The following variable is used for debugging. Its value is number
      of collisions fixed for time of work with all hash tables. */
 
-  static int all_collisions;
+  static YAEP_THREAD_LOCAL int all_collisions;
 
 public:
 
@@ -238,6 +329,13 @@ public:
          return find_entry (element, reserve);
       }
   
+   /* Read-only search which never changes the table. */
+   hash_table_entry_t lookup (hash_table_entry_t element) const;
+
+   /* Call a function for each table element. */
+   void traverse (void (*func) (hash_table_entry_t el, void *arg),
+                  void *arg) const;
+
   void remove_element_from_entry (hash_table_entry_t element);
 
   /* The following function returns current size of given hash
@@ -287,14 +385,344 @@ public:
     {
       return all_collisions;
     }
+
+protected:
+
+  /* The following functions implement find_entry and lookup with the
+     hash and equality functions called by FUNCS. */
+  template <class Funcs>
+  hash_table_entry_t *find_entry_with (const Funcs &funcs,
+                                       hash_table_entry_t element,
+                                       int reserve);
+  template <class Funcs>
+  hash_table_entry_t lookup_with (const Funcs &funcs,
+                                  hash_table_entry_t element) const;
+
 private:
 
   void expand_hash_table (void);
+#ifndef CLASSIC_HASH_TABLE
+  void allocate_entries (size_t size);
+  template <class Funcs>
+  size_t find_slot (const Funcs &funcs, hash_table_entry_t element,
+                    unsigned hash, int reserve);
+
+  /* The control byte values of empty and deleted entries.  The
+     control byte of an occupied entry is 7 bits of its hash. */
+  static const unsigned char ctrl_empty = 0x80;
+  static const unsigned char ctrl_deleted = 0xfe;
+
+  /* The following functions return the mixed hash value, the number
+     of the first entry of the probe sequence, and the control byte
+     for hash value HASH. */
+
+  static inline unsigned long long mixed_hash (unsigned hash)
+    {
+      return static_cast<unsigned long long>(hash) * 0x9E3779B97F4A7C15ULL;
+    }
+
+  static inline size_t probe_start (unsigned long long mixed)
+    {
+      return static_cast<size_t>(mixed ^ (mixed >> 32));
+    }
+
+  static inline unsigned char ctrl_tag (unsigned long long mixed)
+    {
+      return static_cast<unsigned char>(mixed >> 57);
+    }
+
+  /* The following function returns the bit mask of the bytes in the
+     group starting with control byte CTRL which are equal to
+     BYTE. */
+
+  static inline unsigned group_match (const unsigned char *ctrl,
+                                      unsigned char byte)
+    {
+#if defined (__GNUC__) && defined (__SSE2__)
+      __m128i group
+        = _mm_loadu_si128 (reinterpret_cast<const __m128i *>(ctrl));
+
+      return static_cast<unsigned>
+        (_mm_movemask_epi8 (_mm_cmpeq_epi8
+                            (group, _mm_set1_epi8 (static_cast<char>(byte)))));
+#else
+      unsigned i, mask = 0;
+
+      for (i = 0; i < HASH_TABLE_GROUP_SIZE; i++)
+        mask |= static_cast<unsigned>(ctrl[i] == byte) << i;
+      return mask;
+#endif
+    }
+
+  /* The following function returns the number of the lowest bit set
+     in non-zero MASK. */
+
+  static inline unsigned lowest_bit (unsigned mask)
+    {
+#ifdef __GNUC__
+      return static_cast<unsigned>(__builtin_ctz (mask));
+#else
+      unsigned i;
+
+      for (i = 0; (mask & 1) == 0; i++)
+        mask >>= 1;
+      return i;
+#endif
+    }
+
+  /* The following function sets up control byte of entry with number
+     I to BYTE. */
+
+  inline void set_ctrl (size_t i, unsigned char byte)
+    {
+      ctrl[i] = byte;
+      if (i < HASH_TABLE_GROUP_SIZE)
+        ctrl[_size + i] = byte;
+    }
+#endif
 
 };
 
 typedef class hash_table *hash_table_t;
 
+#ifndef CLASSIC_HASH_TABLE
+
+/* The following function returns the number of the entry containing
+   element equal to ELEMENT with HASH or the number of an entry where
+   the element can be placed (if the element does not exist in the
+   table).  The entry is reserved for the element if RESERVE. */
+
+template <class Funcs>
+inline size_t
+hash_table::find_slot (const Funcs &funcs, hash_table_entry_t element,
+                       unsigned hash, int reserve)
+{
+  unsigned long long mixed = mixed_hash (hash);
+  unsigned char tag = ctrl_tag (mixed);
+  size_t pos, step, i, mask = _size - 1;
+  size_t deleted = static_cast<size_t>(-1);
+  unsigned match, empty_mask;
+
+  for (pos = probe_start (mixed) & mask, step = 0;;)
+    {
+      for (match = group_match (ctrl + pos, tag); match != 0;
+           match &= match - 1)
+        {
+          i = (pos + lowest_bit (match)) & mask;
+          if (entries[i] != NULL && funcs.eq (entries[i], element))
+            return i;
+          collisions++;
+          all_collisions++;
+        }
+      empty_mask = group_match (ctrl + pos, ctrl_empty);
+      if (reserve && deleted == static_cast<size_t>(-1))
+        {
+          match = group_match (ctrl + pos, ctrl_deleted);
+          if (match != 0)
+            deleted = (pos + lowest_bit (match)) & mask;
+        }
+      if (empty_mask != 0)
+        break;
+      step += HASH_TABLE_GROUP_SIZE;
+      pos = (pos + step) & mask;
+      collisions++;
+      all_collisions++;
+    }
+  i = (pos + lowest_bit (empty_mask)) & mask;
+  if (reserve)
+    {
+      if (deleted != static_cast<size_t>(-1))
+        {
+          i = deleted;
+          number_of_deleted_elements--;
+        }
+      else
+        number_of_elements++;
+      set_ctrl (i, tag);
+      hashes[i] = hash;
+    }
+  return i;
+}
+
+/* This function searches for hash table entry which contains element
+   equal to given value or empty entry in which given value can be
+   placed (if the element with given value does not exist in the
+   table).  The function works in two regimes.  The first regime is
+   used only for search.  The second is used for search and
+   reservation empty entry for given value.  The table is expanded if
+   occupancy (taking into accout also deleted elements) is more than
+   7/8.  If reservation flag is TRUE then the element with given value
+   should be inserted into the table entry before another call of
+   `find_entry'. */
+
+template <class Funcs>
+inline hash_table_entry_t *
+hash_table::find_entry_with (const Funcs &funcs, hash_table_entry_t element,
+                             int reserve)
+{
+  if (reserve && number_of_elements >= _size - _size / 8)
+    expand_hash_table ();
+  searches++;
+  all_searches++;
+  return entries + find_slot (funcs, element, funcs.hash (element), reserve);
+}
+
+/* This function returns the table element equal to ELEMENT or NULL if
+   there is no such element.  In contrast to `find_entry', the
+   function never changes the table (it does not expand the table and
+   does not update the search statistics), so several threads can
+   search in the same table simultaneously if nobody changes it. */
+
+template <class Funcs>
+inline hash_table_entry_t
+hash_table::lookup_with (const Funcs &funcs, hash_table_entry_t element) const
+{
+  unsigned long long mixed = mixed_hash (funcs.hash (element));
+  unsigned char tag = ctrl_tag (mixed);
+  size_t pos, step, i, mask = _size - 1;
+  unsigned match;
+
+  for (pos = probe_start (mixed) & mask, step = 0;;)
+    {
+      for (match = group_match (ctrl + pos, tag); match != 0;
+           match &= match - 1)
+        {
+          i = (pos + lowest_bit (match)) & mask;
+          if (entries[i] != NULL && funcs.eq (entries[i], element))
+            return entries[i];
+        }
+      if (group_match (ctrl + pos, ctrl_empty) != 0)
+        return NULL;
+      step += HASH_TABLE_GROUP_SIZE;
+      pos = (pos + step) & mask;
+    }
+}
+
+#else /* #ifndef CLASSIC_HASH_TABLE */
+
+/* This function searches for hash table entry which contains element
+   equal to given value or empty entry in which given value can be
+   placed (if the element with given value does not exist in the
+   table).  The function works in two regimes.  The first regime is
+   used only for search.  The second is used for search and
+   reservation empty entry for given value.  The table is expanded if
+   occupancy (taking into accout also deleted elements) is more than
+   75%.  If reservation flag is TRUE then the element with given value
+   should be inserted into the table entry before another call of
+   `find_entry'.  Empty entries are NULL, deleted ones are 1. */
+
+template <class Funcs>
+inline hash_table_entry_t *
+hash_table::find_entry_with (const Funcs &funcs, hash_table_entry_t element,
+                             int reserve)
+{
+  hash_table_entry_t *entry_ptr;
+  hash_table_entry_t *first_deleted_entry_ptr;
+  hash_table_entry_t deleted_entry = reinterpret_cast<void *>(1);
+  unsigned hash_value, secondary_hash_value;
+
+  if (_size / 4 <= number_of_elements / 3)
+    expand_hash_table();
+  hash_value = funcs.hash (element);
+  secondary_hash_value = 1 + hash_value % static_cast<unsigned>(_size - 2);
+  hash_value %= static_cast<unsigned>(_size);
+  searches++;
+  all_searches++;
+  first_deleted_entry_ptr = NULL;
+  for (;; collisions++, all_collisions++)
+    {
+      entry_ptr = entries + hash_value;
+      if (*entry_ptr == NULL)
+        {
+          if (reserve)
+            {
+              number_of_elements++;
+              if (first_deleted_entry_ptr != NULL)
+                {
+                  entry_ptr = first_deleted_entry_ptr;
+                  *entry_ptr = deleted_entry;
+                }
+            }
+          break;
+        }
+      else if (*entry_ptr != deleted_entry)
+        {
+          if (funcs.eq (*entry_ptr, element))
+            break;
+        }
+      else if (first_deleted_entry_ptr == NULL)
+        first_deleted_entry_ptr = entry_ptr;
+      hash_value += secondary_hash_value;
+      if (hash_value >= _size)
+        hash_value -= static_cast<unsigned>(_size);
+    }
+  return entry_ptr;
+}
+
+/* This function returns the table element equal to ELEMENT or NULL if
+   there is no such element.  In contrast to `find_entry', the
+   function never changes the table, so several threads can search in
+   the same table simultaneously if nobody changes it. */
+
+template <class Funcs>
+inline hash_table_entry_t
+hash_table::lookup_with (const Funcs &funcs, hash_table_entry_t element) const
+{
+  const hash_table_entry_t *entry_ptr;
+  hash_table_entry_t deleted_entry = reinterpret_cast<void *>(1);
+  unsigned hash_value, secondary_hash_value;
+
+  hash_value = funcs.hash (element);
+  secondary_hash_value = 1 + hash_value % static_cast<unsigned>(_size - 2);
+  hash_value %= static_cast<unsigned>(_size);
+  for (;;)
+    {
+      entry_ptr = entries + hash_value;
+      if (*entry_ptr == NULL)
+        return NULL;
+      else if (*entry_ptr != deleted_entry
+               && funcs.eq (*entry_ptr, element))
+        return *entry_ptr;
+      hash_value += secondary_hash_value;
+      if (hash_value >= _size)
+        hash_value -= static_cast<unsigned>(_size);
+    }
+}
+
+#endif /* #ifndef CLASSIC_HASH_TABLE */
+
+/* The hash tables of the following class call hash function HASH and
+   equality function EQ directly instead of through the pointers, so
+   the compiler can inline them into the table searches.  Otherwise
+   the tables are the same as the ones of the base class. */
+
+template <unsigned (*Hash) (hash_table_entry_t el_ptr),
+          int (*Eq) (hash_table_entry_t el1_ptr, hash_table_entry_t el2_ptr)>
+class inline_hash_table : public hash_table
+{
+public:
+
+  inline_hash_table (YaepAllocator * allocator, size_t size)
+    : hash_table (allocator, size, Hash, Eq) {}
+
+  inline hash_table_entry_t *find_entry (hash_table_entry_t element,
+                                         int reserve)
+    {
+      return find_entry_with (hash_table_funcs<Hash, Eq> (), element,
+                              reserve);
+    }
+
+  inline hash_table_entry_t *find_entry (const void *element, int reserve)
+    {
+      return find_entry (static_cast<hash_table_entry_t>(const_cast<void*>(element)), reserve);
+    }
+
+  inline hash_table_entry_t lookup (hash_table_entry_t element) const
+    {
+      return lookup_with (hash_table_funcs<Hash, Eq> (), element);
+    }
+};
+
 /* Free helper for const-qualified probe in C++ build to mirror the C helper.
     Defined after class so we can delegate to its method. */
 inline hash_table_entry_t *
@@ -303,6 +731,15 @@ find_hash_table_entry_c (hash_table_t htab, const void *element, int reserve)
    return htab->find_entry (element, reserve);
 }
 
+template <unsigned (*Hash) (hash_table_entry_t el_ptr),
+          int (*Eq) (hash_table_entry_t el1_ptr, hash_table_entry_t el2_ptr)>
+inline hash_table_entry_t *
+find_hash_table_entry_c (inline_hash_table<Hash, Eq> *htab,
+                         const void *element, int reserve)
+{
+   return htab->find_entry (element, reserve);
+}
+
 
 #endif /* #ifndef __cplusplus */
 
@@ -69,6 +69,7 @@ _OS_create_function (os_t * os, size_t initial_segment_length)
       return -1;
     }
   os->os_current_segment->os_previous_segment = NULL;
+  os->os_current_segment->os_segment_length = initial_segment_length;
   os->os_top_object_start
     =
     (char *) _OS_ALIGNED_ADDRESS (os->os_current_segment->os_segment_contest);
@@ -98,23 +99,31 @@ _OS_delete_function (os_t * os)
     }
 }
 
-/* The following function implements macro `OS_EMPTY' (freeing memory
-   allocated for OS except for the first segment). */
+/* The following function implements macro `OS_EMPTY' (removing all
+   objects from OS and joining its segments into one segment). */
 
 void
 _OS_empty_function (os_t * os)
 {
   struct _os_segment *current_segment, *previous_segment;
+  size_t length;
 
   assert (os->os_top_object_start != NULL && os->os_current_segment != NULL);
   current_segment = os->os_current_segment;
-  for (;;)
+  if (current_segment->os_previous_segment != NULL)
     {
-      previous_segment = current_segment->os_previous_segment;
-      if (previous_segment == NULL)
-	break;
-      yaep_free (os->os_alloc, current_segment);
-      current_segment = previous_segment;
+      length = 0;
+      for (; current_segment != NULL; current_segment = previous_segment)
+	{
+	  previous_segment = current_segment->os_previous_segment;
+	  length += current_segment->os_segment_length;
+	  yaep_free (os->os_alloc, current_segment);
+	}
+      current_segment =
+	yaep_malloc (os->os_alloc, length + sizeof (struct _os_segment));
+      current_segment->os_previous_segment = NULL;
+      current_segment->os_segment_length = length;
+      os->initial_segment_length = length;
     }
   os->os_current_segment = current_segment;
   os->os_top_object_start
@@ -182,6 +191,7 @@ _OS_expand_memory (os_t * os, size_t additional_length)
     previous_segment = os->os_current_segment;
   os->os_current_segment = new_segment;
   new_segment->os_previous_segment = previous_segment;
+  new_segment->os_segment_length = segment_length;
   os->os_top_object_start = new_os_top_object_start;
   os->os_top_object_free = os->os_top_object_start + os_top_object_length;
   os->os_boundary = os->os_top_object_start + segment_length;
@@ -47,14 +47,34 @@
 
 /* The constructor of OS with given initial segment length. */
 
-os::os (YaepAllocator * allocator, size_t in_initial_segment_length):os_alloc (allocator)
+os::os (YaepAllocator * allocator, size_t in_initial_segment_length)
 {
+  create (allocator, in_initial_segment_length);
+}
+
+/* The destructor frees memory allocated for OS unless it is freed by
+   `destroy'. */
+
+os::~os (void)
+{
+  if (os_top_object_start != NULL)
+    destroy ();
+}
+
+/* The following function creates OS as the constructor with the same
+   parameters does. */
+
+void
+os::create (YaepAllocator * allocator, size_t in_initial_segment_length)
+{
+  os_alloc = allocator;
   if (in_initial_segment_length == 0)
     in_initial_segment_length = OS_DEFAULT_SEGMENT_LENGTH;
   os_current_segment =
     static_cast<_os_segment *>(yaep_malloc (os_alloc,
 				 in_initial_segment_length + sizeof (_os_segment)));
   os_current_segment->os_previous_segment = NULL;
+  os_current_segment->os_segment_length = in_initial_segment_length;
   os_top_object_start
     = static_cast<char *>(_OS_ALIGNED_ADDRESS (os_current_segment->os_segment_contest));
   os_top_object_free = os_top_object_start;
@@ -62,9 +82,10 @@ os::os (YaepAllocator * allocator, size_t in_initial_segment_length):os_alloc (a
   this->initial_segment_length = in_initial_segment_length;
 }
 
-/* The destructor frees memory allocated for OS. */
+/* The following function frees memory allocated for OS. */
 
-os::~os (void)
+void
+os::destroy (void)
 {
   class _os_segment *current_segment, *previous_segment;
 
@@ -79,23 +100,32 @@ os::~os (void)
     }
 }
 
-/* The following function frees memory allocated for OS except for the
-   first segment. */
+/* The following function removes all objects from OS and joins its
+   segments into one segment. */
 
 void
 os::empty (void)
 {
   class _os_segment *current_segment, *previous_segment;
+  size_t length;
 
   assert (os_top_object_start != NULL && os_current_segment != NULL);
   current_segment = os_current_segment;
-  for (;;)
+  if (current_segment->os_previous_segment != NULL)
     {
-      previous_segment = current_segment->os_previous_segment;
-      if (previous_segment == NULL)
-	break;
-      yaep_free (os_alloc, current_segment);
-      current_segment = previous_segment;
+      length = 0;
+      for (; current_segment != NULL; current_segment = previous_segment)
+	{
+	  previous_segment = current_segment->os_previous_segment;
+	  length += current_segment->os_segment_length;
+	  yaep_free (os_alloc, current_segment);
+	}
+      current_segment =
+	static_cast<_os_segment *>(yaep_malloc (os_alloc,
+						length + sizeof (_os_segment)));
+      current_segment->os_previous_segment = NULL;
+      current_segment->os_segment_length = length;
+      initial_segment_length = length;
     }
   os_current_segment = current_segment;
   os_top_object_start
@@ -161,6 +191,7 @@ os::_OS_expand_memory (size_t additional_length)
     previous_segment = os_current_segment;
   os_current_segment = new_segment;
   new_segment->os_previous_segment = previous_segment;
+  new_segment->os_segment_length = segment_length;
   os_top_object_start = new_os_top_object_start;
   os_top_object_free = os_top_object_start + os_top_object_length;
   os_boundary = os_top_object_start + segment_length;
@@ -126,6 +126,8 @@ struct _os_auxiliary_struct
 struct _os_segment
 {
   struct _os_segment *os_previous_segment;
+  /* The memory length of the segment. */
+  size_t os_segment_length;
   char os_segment_contest[_OS_ALIGNMENT];
 };
 
@@ -172,8 +174,10 @@ typedef struct
 
 #define OS_DELETE(os) _OS_delete_function (& (os))
 
-/* This macro is used for freeing memory allocated for OS except for
-   the first segment.  The macro has not side effects. */
+/* This macro is used for removing all objects from OS.  If OS has
+   several memory segments, they are joined into one segment, so the
+   same objects can be placed again without memory allocation.  The
+   macro has not side effects. */
 
 #define OS_EMPTY(os) _OS_empty_function (& (os))
 
@@ -372,12 +376,33 @@ public:
     explicit os (YaepAllocator * allocator, size_t initial_segment_length =
 		 OS_DEFAULT_SEGMENT_LENGTH);
 
-  /* This destructor is used for freeing memory allocated for OS. */
+  /* This constructor makes OS which is not created yet.  An OS kept
+     by value in a structure or a variable is created by `create' (or
+     by placement new) and freed by `destroy'. */
+
+  os (void)
+    : initial_segment_length (0), os_current_segment (NULL),
+      os_top_object_start (NULL), os_top_object_free (NULL),
+      os_boundary (NULL), os_alloc (NULL)
+  {
+  }
+
+  /* This destructor is used for freeing memory allocated for OS.  An
+     OS freed by `destroy' is not freed again. */
 
    ~os (void);
 
-  /* This function is used for freeing memory allocated for OS except
-     for the first segment. */
+  /* These functions create OS as the constructor with the same
+     parameters does and free memory allocated for OS. */
+
+  void create (YaepAllocator * allocator, size_t initial_segment_length =
+	       OS_DEFAULT_SEGMENT_LENGTH);
+  void destroy (void);
+
+  /* This function is used for removing all objects from OS.  If OS
+     has several memory segments, they are joined into one segment, so
+     the same objects can be placed again without memory
+     allocation. */
 
   void empty (void);
 
@@ -526,9 +551,11 @@ typedef os os_t;
 class _os_segment
 {
   class _os_segment *os_previous_segment;
+  /* The memory length of the segment. */
+  size_t os_segment_length;
   char os_segment_contest[_OS_ALIGNMENT];
-  friend os::os (YaepAllocator *, size_t);
-  friend os::~os (void);
+  friend void os::create (YaepAllocator *, size_t);
+  friend void os::destroy (void);
   friend void os::empty (void);
   friend void os::_OS_expand_memory (size_t additional_length);
 };
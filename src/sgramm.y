@@ -91,19 +91,11 @@ struct srule
 
 /* The following vlos contain all syntax terminal and syntax rule
    structures. */
-#ifndef __cplusplus
 static vlo_t sterms, srules;
-#else
-static vlo_t *sterms, *srules;
-#endif
 
 /* The following contain all right hand sides and translations arrays.
    See members rhs, trans in structure `rule'. */
-#ifndef __cplusplus
 static os_t srhs, strans; 
-#else
-static os_t *srhs, *strans; 
-#endif
 
 /* The following is cost of the last translation which contains an
    abstract node. */
@@ -264,11 +256,7 @@ static const char *curr_ch;
 static int ln;
 
 /* The following contains all representation of the syntax tokens. */
-#ifndef __cplusplus
 static os_t stoks;
-#else
-static os_t *stoks;
-#endif
 
 /* The following is number of syntax terminal and syntax rules being
   read. */
@@ -727,6 +715,8 @@ yaep_parse_grammar (struct grammar *g, int strict_p, const char *description)
   grammar = g;
   yaep_copy_error_to_grammar (grammar);
 
+  if (g->frozen_p)
+    return yaep_set_error (g, YAEP_FROZEN_GRAMMAR, "grammar is frozen");
   code = set_sgrammar (g, description);
   if (code == 0)
     {
@@ -315,32 +315,51 @@ public:
      to 0 the initial allocated memory length is equal to
      VLO_DEFAULT_LENGTH. */
 
-  explicit vlo (YaepAllocator * allocator, size_t initial_length = VLO_DEFAULT_LENGTH):vlo_alloc (allocator)
+  explicit vlo (YaepAllocator * allocator, size_t initial_length = VLO_DEFAULT_LENGTH)
   {
-    initial_length = (initial_length != 0
-		      ? initial_length : VLO_DEFAULT_LENGTH);
-  // Use explicit C++ cast for clarity in C++ compilation units. The runtime
-  // behavior is unchanged; this avoids old-style-cast warnings and makes
-  // intent explicit to future maintainers.
-  vlo_start = reinterpret_cast<char *>(yaep_malloc (vlo_alloc, initial_length));
-  vlo_boundary = vlo_start + initial_length;
-  vlo_free = vlo_start;
+    create (allocator, initial_length);
   }
 
+  /* This constructor makes VLO which is not created yet.  A VLO kept
+     by value in a structure or a variable is created by `create' (or
+     by placement new) and freed by `destroy'. */
+
+  vlo (void)
+    : vlo_start (NULL), vlo_free (NULL), vlo_boundary (NULL), vlo_alloc (NULL)
+  {
+  }
 
   /* This function is used for freeing memory allocated for VLO.  Any
      work (except for creation) with given VLO is not possible after
-     evaluation of this function. */
+     evaluation of this function.  A VLO freed by `destroy' is not
+     freed again. */
 
   inline ~ vlo (void)
   {
-#ifndef NDEBUG
+    if (vlo_start != NULL)
+      destroy ();
+  }
+
+  /* This function creates VLO as the constructor with the same
+     parameters does. */
+
+  inline void create (YaepAllocator * allocator, size_t initial_length = VLO_DEFAULT_LENGTH)
+  {
+    vlo_alloc = allocator;
+    initial_length = (initial_length != 0
+		      ? initial_length : VLO_DEFAULT_LENGTH);
+    vlo_start = static_cast<char *>(yaep_malloc (vlo_alloc, initial_length));
+    vlo_boundary = vlo_start + initial_length;
+    vlo_free = vlo_start;
+  }
+
+  /* This function frees memory allocated for VLO. */
+
+  inline void destroy (void)
+  {
     assert (vlo_start != NULL);
     yaep_free (vlo_alloc, vlo_start);
     vlo_start = NULL;
-#else
-    yaep_free (vlo_alloc, vlo_start);
-#endif /* #ifndef NDEBUG */
   }
 
   /* This function makes that length of VLO will be equal to zero (but
@@ -50,6 +50,10 @@
 #include <new>
 #endif
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
 
 #include "allocate.h"
 #include "hashtab.h"
@@ -78,6 +82,16 @@
   Cast to size_t to avoid sign/width conversion warnings when used in
   size/loop index contexts. */
 #define VLO_NELS(vlo, el) (YAEP_STATIC_CAST(size_t, (VLO_LENGTH (vlo) / sizeof (el))))
+
+/* The following is type of hash table with hash function HASH and
+   equality function EQ.  In C++ the functions are template arguments
+   of the table class, so the compiler can inline them into the table
+   searches.  */
+#ifndef __cplusplus
+#define HASH_TABLE_T(hash, eq) hash_table_t
+#else
+#define HASH_TABLE_T(hash, eq) inline_hash_table<hash, eq> *
+#endif
 /* Cast to size_t to avoid sign/width conversion warnings when used in size/loop index contexts. */
 
 
@@ -147,6 +161,28 @@
    same set as the shifted original situation.  */
 /* #define TRANSITIVE_TRANSITION */
 
+/* The following macro is defined if parsers of a frozen grammar can
+   share set cores, sets, goto sets and core_symb_vects (see
+   yaep_set_shared_memo_flag).  The transitive transitions mark
+   situations during parsing and the core_symb_vect hash table is
+   private for a parser, so the shared memo can not be used with
+   them.  */
+#if defined (USE_SET_HASH_TABLE) && !defined (TRANSITIVE_TRANSITION) \
+  && !defined (USE_CORE_SYMB_HASH_TABLE)
+#define USE_SHARED_MEMO
+#endif
+
+/* The following macro is defined if the terminal set operations on
+   sets of more than 256 terminals use SSE2 instructions.  AVX2
+   versions of the operations are chosen at run time if the processor
+   supports them.  Define NO_TERM_SET_SIMD to use only the portable
+   code.  */
+#if !defined (NO_TERM_SET_SIMD) && defined (__GNUC__) && defined (__SSE2__) \
+  && (defined (__x86_64__) || defined (__i386__))
+#define TERM_SET_SIMD
+#include <immintrin.h>
+#endif
+
 /* Prime number (79087987342985798987987) mod 32 used for hash
    calculations.  */
 static const unsigned jauquet_prime_mod32 = 2053222611;
@@ -164,6 +200,13 @@ struct grammar
      grammar). */
   int undefined_p;
 
+  /* The following member is TRUE if the grammar is frozen by
+     yaep_freeze_grammar.  The frozen grammar is never changed, so
+     parsers in different threads can use it without locking.  Errors
+     for the frozen grammar are kept only in the thread error
+     context. */
+  int frozen_p;
+
   /* This member always contains the last occurred error code for
      given grammar. */
   int error_code;
@@ -211,24 +254,89 @@ struct grammar
   /* The following value is TRUE if we need to make error recovery. */
   int error_recovery_p;
 
+  /* The following value is TRUE if we use Leo items to complete
+     deterministic reduction paths at once. */
+  int leo_p;
+
+  /* The following value is TRUE if we only recognize the input
+     without building the parse tree (see yaep_set_recognition_flag). */
+  int recognition_p;
+
+  /* The following value is the maximal size (in bytes) of the parse
+     cache kept by a parser between parses.  Zero means that the
+     parse cache is not used. */
+  size_t parse_cache_limit;
+
+  /* The following value is changed whenever a new grammar is read.
+     It is used to find parse caches formed for a previous grammar. */
+  unsigned generation;
+
+  /* The following value is TRUE if parsers of the frozen grammar
+     should share set cores, sets, goto sets and core_symb_vects
+     through the shared memo (see yaep_set_shared_memo_flag).  The
+     memo itself (or NULL) is created by yaep_freeze_grammar. */
+  int shared_memo_p;
+  struct shared_memo *shared_memo;
+
+  /* The following value is TRUE if yaep_freeze_grammar should compile
+     the LR(0) automaton of the grammar into set cores of the shared
+     memo (see yaep_set_lr0_automaton_flag). */
+  int lr0_automaton_p;
+
+  /* The parser used by yaep_parse when the parse cache is used. */
+  struct yaep_parser *parser;
+
   /* The following vocabulary used for this grammar. */
   struct symbs *symbs_ptr;
   /* The following rules used for this grammar. */
   struct rules *rules_ptr;
   /* The following terminal sets used for this grammar. */
   struct term_sets *term_sets_ptr;
+  /* The following is the compiled grammar file mapped by
+     yaep_load_compiled_grammar (or NULL) and its size.  Names of the
+     symbols, abstract nodes, translation orders, and FIRST/FOLLOW
+     sets of the loaded grammar are in the mapped file. */
+  void *compiled_image;
+  size_t compiled_image_size;
+  /* Statistics of the last parse and their sums for all parses of
+     the grammar (see yaep_get_parse_stats).  The parsers of the
+     grammar can finish their parses simultaneously, so the statistics
+     are accessed only with the following mutex locked. */
+  struct yaep_parse_stats last_stats, total_stats;
+  pthread_mutex_t stats_mutex;
+  /* The arena for trees built by yaep_parse (or NULL). */
+  struct yaep_tree_arena *tree_arena;
+  /* The callbacks called instead of building trees by yaep_parse (or
+     NULL). */
+  const struct yaep_tree_events *tree_events;
   /* Allocator. */
   YaepAllocator *alloc;
 };
 
 /* The following variable value is the reference for the current
-   grammar structure. */
-static struct grammar *grammar;
+   grammar structure.  It is thread local so different threads can
+   work with different grammars (or parse with the same one). */
+static YAEP_THREAD_LOCAL struct grammar *grammar;
 /* The following variable values are values of the corresponding
-   members for the current grammar. */
-static struct symbs *symbs_ptr;
-static struct term_sets *term_sets_ptr;
-static struct rules *rules_ptr;
+   members for the current grammar.  During parsing term_sets_ptr
+   refers for terminal sets of the current parser instead. */
+static YAEP_THREAD_LOCAL struct symbs *symbs_ptr;
+static YAEP_THREAD_LOCAL struct term_sets *term_sets_ptr;
+static YAEP_THREAD_LOCAL struct rules *rules_ptr;
+
+/* Return TRUE if YAEP_FUZZ_DEBUG is set in the environment to get
+   the fuzz triage output.  The functions translating and reading
+   tokens check it for each token, so the environment is looked up
+   only once in each thread. */
+static int
+fuzz_debug_p (void)
+{
+  static YAEP_THREAD_LOCAL int fuzz_debug = -1;
+
+  if (fuzz_debug < 0)
+    fuzz_debug = getenv ("YAEP_FUZZ_DEBUG") != NULL;
+  return fuzz_debug;
+}
 
 /* If YAEP_FUZZ_WRITEBACKTRACES is set in the environment, print a short
    backtrace and contextual information whenever we are about to write a
@@ -259,17 +367,6 @@ maybe_write_backtrace_for_symb_push (const char *label, struct symb *ptr)
   fflush (stderr);
 }
 
-/* The following is set up the parser amnd used globally. */
-static int (*read_token) (void **attr);
-static void (*syntax_error) (int err_tok_num,
-			     void *err_tok_attr,
-			     int start_ignored_tok_num,
-			     void *start_ignored_tok_attr,
-			     int start_recovered_tok_num,
-			     void *start_recovered_tok_attr);
-static void *(*parse_alloc) (int nmemb);
-static void (*parse_free) (void *mem);
-
 #ifndef __cplusplus
 extern
 #else
@@ -289,7 +386,6 @@ __attribute__((unused))
 #endif
 expand_int_vlo (vlo_t * vlo, int n_els)
 {
-#ifndef __cplusplus
   size_t i, prev_n_els = VLO_NELS (*vlo, int);
 
   /* Cast prev_n_els to int to avoid sign/width conversion warning. */
@@ -301,16 +397,6 @@ expand_int_vlo (vlo_t * vlo, int n_els)
   for (i = prev_n_els; i < YAEP_STATIC_CAST(size_t, n_els); i++)
     STATIC_CAST(int *, VLO_BEGIN (*vlo))[i] = 0;
   return TRUE;
-#else
-  size_t i, prev_n_els = vlo->length () / sizeof (int);
-
-  if (YAEP_STATIC_CAST(int, prev_n_els) >= n_els)
-    return FALSE;
-  vlo->expand (YAEP_STATIC_CAST(size_t, (n_els - YAEP_STATIC_CAST(int, prev_n_els))) * sizeof (int));
-  for (i = prev_n_els; i < YAEP_STATIC_CAST(size_t, n_els); i++)
-    (YAEP_STATIC_CAST(int *, vlo->begin ()))[i] = 0;
-  return TRUE;
-#endif
 }
 
 
@@ -320,10 +406,34 @@ expand_int_vlo (vlo_t * vlo, int n_els)
 /* Forward declaration. */
 struct core_symb_vect;
 
+#ifdef SYMB_CODE_TRANS_VECT
+/* The following describes bucket of the first level of the perfect
+   hash of terminal codes.  The codes of the bucket are placed without
+   collisions into SIZE slots starting with OFFSET by the hash
+   function with multiplier MULT. */
+struct symb_code_bucket
+{
+  uint32_t mult, size, offset;
+};
+
+/* The following describes slot of the second level of the perfect
+   hash.  SYMB is NULL for a slot without terminal. */
+struct symb_code_slot
+{
+  int code;
+  struct symb *symb;
+};
+#endif
+
 /* The following is type of element of array representing set of
    terminals. */
 typedef long int term_set_el_t;
 
+/* The following are number of bits in an element of a terminal set
+   and number of the elements in a set of N terminals. */
+#define TERM_SET_EL_BITS (CHAR_BIT * sizeof (term_set_el_t))
+#define TERM_SET_N_ELS(n) (((n) + TERM_SET_EL_BITS - 1) / TERM_SET_EL_BITS)
+
 /* The following describes symbol of grammar. */
 struct symb
 {
@@ -354,6 +464,16 @@ struct symb
       /* The following members are FIRST and FOLLOW sets of the
          nonterminal. */
       term_set_el_t *first, *follow;
+      /* The following is the prediction closure of the nonterminal:
+         numbers (rule->rule_start_offset + pos) of all situations
+         with zero distance which are added to a set when the
+         nonterminal is after the dot.  They are the initial
+         situations of the nonterminal rules, of the rules of the
+         nonterminals starting them and so on, and the situations
+         formed from them by skipping symbols deriving empty string
+         (see create_prediction_closures). */
+      int *predictions;
+      int n_predictions;
     } nonterm;
   } u;
   /* The following member is TRUE if it is nonterminal. */
@@ -369,13 +489,13 @@ struct symb
   char empty_p;
   /* The following member is order number of symbol. */
   int num;
-#ifdef USE_CORE_SYMB_HASH_TABLE
-  /* The following is used as cache for subsequent search for
-     core_symb_vect with given symb. */
-  struct core_symb_vect *cached_core_symb_vect;
-#endif
 };
 
+static unsigned symb_repr_hash (hash_table_entry_t s);
+static int symb_repr_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+static unsigned symb_code_hash (hash_table_entry_t s);
+static int symb_code_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+
 /* The following structure contians all information about grammar
    vocabulary. */
 struct symbs
@@ -384,30 +504,25 @@ struct symbs
     variables can be read externally. */
   size_t n_terms, n_nonterms;
 
+  /* The following is number of elements of type term_set_el_t in a
+     terminal set.  It is updated together with n_terms, so the term
+     set operations do not recompute it on each call. */
+  size_t n_term_set_els;
+
   /* All symbols are placed in the following object. */
-#ifndef __cplusplus
   os_t symbs_os;
-#else
-  os_t *symbs_os;
-#endif
 
   /* All references to the symbols, terminals, nonterminals are stored
      in the following vlos.  The indexes in the arrays are the same as
      corresponding symbol, terminal, and nonterminal numbers. */
-#ifndef __cplusplus
   vlo_t symbs_vlo;
   vlo_t terms_vlo;
   vlo_t nonterms_vlo;
-#else
-  vlo_t *symbs_vlo;
-  vlo_t *terms_vlo;
-  vlo_t *nonterms_vlo;
-#endif
 
   /* The following are tables to find terminal by its code and symbol by
      its representation. */
-  hash_table_t repr_to_symb_tab;	/* key is `repr' */
-  hash_table_t code_to_symb_tab;	/* key is `code' */
+  HASH_TABLE_T (symb_repr_hash, symb_repr_eq) repr_to_symb_tab; /* key is `repr' */
+  HASH_TABLE_T (symb_code_hash, symb_code_eq) code_to_symb_tab; /* key is `code' */
 #ifdef SYMB_CODE_TRANS_VECT
   /* If terminal symbol codes are not spared (in this case the member
      value is not NULL, we use translation vector instead of hash
@@ -415,6 +530,12 @@ struct symbs
   struct symb **symb_code_trans_vect;
   int symb_code_trans_vect_start;
   int symb_code_trans_vect_end;
+  /* If the codes are spared, terminals are found by the following two
+     level perfect hash (see symb_code_hash_create) instead of the
+     hash table.  The members are NULL if the hash is not used.  */
+  struct symb_code_bucket *symb_code_buckets;
+  struct symb_code_slot *symb_code_slots;
+  uint32_t symb_code_n_buckets, symb_code_mult;
 #endif
 };
 
@@ -493,7 +614,7 @@ symb_init (struct grammar *g, struct symbs **out_symbs)
       return YAEP_NO_MEMORY;
     }
 
-  memset (result, 0, sizeof (*result));
+  memset (YAEP_STATIC_CAST(void *, result), 0, sizeof (*result));
 
 #ifndef __cplusplus
   if (os_create_safe (&result->symbs_os, g->alloc, 0) != 0)
@@ -625,9 +746,13 @@ symb_init (struct grammar *g, struct symbs **out_symbs)
 
 #ifdef SYMB_CODE_TRANS_VECT
   result->symb_code_trans_vect = NULL;
+  result->symb_code_buckets = NULL;
+  result->symb_code_slots = NULL;
+  result->symb_code_n_buckets = result->symb_code_mult = 0;
 #endif
   result->n_nonterms = 0;
   result->n_terms = 0;
+  result->n_term_set_els = 0;
 
   *out_symbs = result;
   return 0;
@@ -666,6 +791,37 @@ symb_find_by_repr (const char *repr)
   return entry ? YAEP_STATIC_CAST(struct symb *, *entry) : NULL;
 }
 
+#ifdef SYMB_CODE_TRANS_VECT
+
+/* The following macro value is hash H reduced to range [0, N).  The
+   high bits of H are used because they are the best mixed by the
+   multiplication. */
+#define SYMB_CODE_HASH_REDUCE(h, n) \
+  YAEP_STATIC_CAST(uint32_t, (YAEP_STATIC_CAST(uint64_t, h) * (n)) >> 32)
+
+/* Return terminal with CODE (or NULL if it does not exist) using the
+   perfect hash of the terminal codes.  The lookup always takes two
+   multiplications and three memory accesses. */
+#if MAKE_INLINE
+INLINE
+#endif
+static struct symb *
+symb_code_hash_find (int code)
+{
+  uint32_t u = YAEP_STATIC_CAST(uint32_t, code);
+  const struct symb_code_bucket *bucket;
+  const struct symb_code_slot *slot;
+
+  bucket = &symbs_ptr->symb_code_buckets
+    [SYMB_CODE_HASH_REDUCE (u * symbs_ptr->symb_code_mult,
+			    symbs_ptr->symb_code_n_buckets)];
+  slot = &symbs_ptr->symb_code_slots
+    [bucket->offset + SYMB_CODE_HASH_REDUCE (u * bucket->mult, bucket->size)];
+  return slot->code == code ? slot->symb : NULL;
+}
+
+#endif
+
 /* Return symbol (or NULL if it does not exist) which is terminal with
    CODE. */
 #if MAKE_INLINE
@@ -682,7 +838,7 @@ symb_find_by_code (int code)
       if ((code < symbs_ptr->symb_code_trans_vect_start)
           || (code >= symbs_ptr->symb_code_trans_vect_end))
         {
-          if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
+          if (fuzz_debug_p ())
             {
               fprintf (stderr, "YAEP_DEBUG_SYMB_VEC_MISS code=%d start=%d end=%d\n",
                        code, symbs_ptr->symb_code_trans_vect_start,
@@ -695,7 +851,7 @@ symb_find_by_code (int code)
         {
           struct symb *res = symbs_ptr->symb_code_trans_vect
             [code - symbs_ptr->symb_code_trans_vect_start];
-          if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
+          if (fuzz_debug_p ())
             {
               fprintf (stderr, "YAEP_DEBUG_SYMB_VEC_LOOKUP code=%d idx=%d res=%p\n",
                        code, code - symbs_ptr->symb_code_trans_vect_start,
@@ -705,6 +861,8 @@ symb_find_by_code (int code)
           return res;
         }
     }
+  if (symbs_ptr->symb_code_slots != NULL)
+    return symb_code_hash_find (code);
 #endif
   symb.term_p = TRUE;
   symb.u.term.code = code;
@@ -712,7 +870,7 @@ symb_find_by_code (int code)
   hash_table_entry_t *e = find_hash_table_entry (symbs_ptr->code_to_symb_tab,
                            &symb, FALSE);
   struct symb *res = e ? YAEP_STATIC_CAST(struct symb *, *e) : NULL;
-    if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
+    if (fuzz_debug_p ())
       {
         fprintf (stderr, "YAEP_DEBUG_SYMB_FIND_BY_CODE code=%d entry=%p res=%p\n",
                  code, YAEP_STATIC_CAST(void *, e), YAEP_STATIC_CAST(void *, res));
@@ -736,6 +894,7 @@ symb_add_term (const char *name, int code)
   symb.num = YAEP_STATIC_CAST(int, symbs_ptr->n_nonterms + symbs_ptr->n_terms);
   symb.u.term.code = code;
   symb.u.term.term_num = YAEP_STATIC_CAST(int, symbs_ptr->n_terms++);
+  symbs_ptr->n_term_set_els = TERM_SET_N_ELS (symbs_ptr->n_terms);
   symb.empty_p = FALSE;
   repr_entry =
     find_hash_table_entry (symbs_ptr->repr_to_symb_tab, &symb, TRUE);
@@ -765,7 +924,7 @@ symb_add_term (const char *name, int code)
   VLO_ADD_MEMORY (symbs_ptr->symbs_vlo, &result, sizeof (struct symb *));
   maybe_write_backtrace_for_symb_push ("symb_add_term-pre-terms", result);
   VLO_ADD_MEMORY (symbs_ptr->terms_vlo, &result, sizeof (struct symb *));
-  if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
+  if (fuzz_debug_p ())
     {
   fprintf (stderr, "YAEP_DEBUG_SYMB_ADD_TERM repr='%s' code=%d result=%p symbs_ptr=%p\n",
        name, code, YAEP_STATIC_CAST(void *, result), YAEP_STATIC_CAST(void *, symbs_ptr));
@@ -788,6 +947,8 @@ symb_add_nonterm (const char *name)
   symb.num = YAEP_STATIC_CAST(int, symbs_ptr->n_nonterms + symbs_ptr->n_terms);
   symb.u.nonterm.rules = NULL;
   symb.u.nonterm.loop_p = 0;
+  symb.u.nonterm.predictions = NULL;
+  symb.u.nonterm.n_predictions = 0;
   symb.u.nonterm.nonterm_num = YAEP_STATIC_CAST(int, symbs_ptr->n_nonterms++);
   entry = find_hash_table_entry (symbs_ptr->repr_to_symb_tab, &symb, TRUE);
   assert (*entry == NULL);
@@ -808,7 +969,7 @@ symb_add_nonterm (const char *name)
   VLO_ADD_MEMORY (symbs_ptr->symbs_vlo, &result, sizeof (struct symb *));
   maybe_write_backtrace_for_symb_push ("symb_add_nonterm-pre-nonterms", result);
   VLO_ADD_MEMORY (symbs_ptr->nonterms_vlo, &result, sizeof (struct symb *));
-  if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
+  if (fuzz_debug_p ())
     {
   fprintf (stderr, "YAEP_DEBUG_SYMB_ADD_NONTERM repr='%s' result=%p symbs_ptr=%p\n",
        name, YAEP_STATIC_CAST(void *, result), YAEP_STATIC_CAST(void *, symbs_ptr));
@@ -880,6 +1041,174 @@ symb_print (FILE * f, struct symb *symb, int code_p)
 
 #define SYMB_CODE_TRANS_VECT_SIZE 10000
 
+/* The following function returns the next multiplier for the perfect
+   hash of terminal codes from pseudo-random sequence with STATE.  The
+   multiplier is odd, so the multiplication is a bijection. */
+static uint32_t
+symb_code_hash_next_mult (uint32_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state | 1;
+}
+
+/* The following function creates the perfect hash of the terminal
+   codes for spared codes (see symb_code_hash_find).  It is the
+   two-level scheme of Fredman, Komlos, and Szemeredi: the codes are
+   distributed into N buckets by the first level multiplier, which is
+   chosen so that the squares of bucket sizes sum to at most 4N (or
+   to the minimal sum found by 100 tries), and
+   each bucket with K codes gets its own multiplier placing the codes
+   without collisions into K*K slots.  So the hash takes O(N) memory.  */
+static void
+symb_code_hash_create (void)
+{
+  uint32_t n = YAEP_STATIC_CAST(uint32_t, symbs_ptr->n_terms);
+  uint32_t state = 2463534242u, mult, best_mult = 1, i, j, k, size;
+  uint32_t *counts, *order, *pos;
+  uint64_t sum, best_sum = UINT64_MAX;
+  struct symb_code_bucket *buckets;
+  struct symb_code_slot *slots;
+  struct symb *symb;
+  int try_num;
+
+  assert (n != 0);
+  counts = YAEP_STATIC_CAST(uint32_t *,
+			    yaep_malloc (grammar->alloc,
+					 3 * sizeof (uint32_t) * n + sizeof (uint32_t)));
+  order = counts + n + 1;
+  pos = order + n;
+  for (try_num = 0; try_num < 100 && best_sum > 4 * YAEP_STATIC_CAST(uint64_t, n);
+       try_num++)
+    {
+      mult = symb_code_hash_next_mult (&state);
+      memset (counts, 0, sizeof (uint32_t) * n);
+      sum = 0;
+      for (i = 0; i < n; i++)
+	{
+	  k = SYMB_CODE_HASH_REDUCE
+	    (YAEP_STATIC_CAST(uint32_t, term_get (YAEP_STATIC_CAST(int, i))->u.term.code)
+	     * mult, n);
+	  /* (c + 1)^2 - c^2 = 2c + 1 */
+	  sum += 2 * YAEP_STATIC_CAST(uint64_t, counts[k]++) + 1;
+	}
+      if (sum < best_sum)
+	{
+	  best_sum = sum;
+	  best_mult = mult;
+	}
+    }
+  /* Sort the terminals by buckets: counts[k] becomes the start of
+     bucket K in ORDER.  */
+  memset (counts, 0, sizeof (uint32_t) * (n + 1));
+  for (i = 0; i < n; i++)
+    {
+      pos[i] = SYMB_CODE_HASH_REDUCE
+	(YAEP_STATIC_CAST(uint32_t, term_get (YAEP_STATIC_CAST(int, i))->u.term.code)
+	 * best_mult, n);
+      counts[pos[i] + 1]++;
+    }
+  for (k = 0; k < n; k++)
+    counts[k + 1] += counts[k];
+  for (i = 0; i < n; i++)
+    order[counts[pos[i]]++] = i;
+  for (k = n; k > 0; k--)
+    counts[k] = counts[k - 1];
+  counts[0] = 0;
+  buckets = YAEP_STATIC_CAST(struct symb_code_bucket *,
+			     yaep_malloc (grammar->alloc,
+					  sizeof (struct symb_code_bucket) * n));
+  for (size = k = 0; k < n; k++)
+    {
+      buckets[k].offset = size;
+      buckets[k].size = (counts[k + 1] - counts[k]) * (counts[k + 1] - counts[k]);
+      buckets[k].mult = 0;
+      size += buckets[k].size;
+    }
+  slots = NULL;
+  for (;;)
+    {
+      /* Slot 0 is always present for the empty buckets.  */
+      slots = YAEP_STATIC_CAST(struct symb_code_slot *,
+			       yaep_realloc (grammar->alloc, slots,
+					     sizeof (struct symb_code_slot)
+					     * (size + 1)));
+      memset (slots, 0, sizeof (struct symb_code_slot) * (size + 1));
+      for (k = 0; k < n; k++)
+	{
+	  if (counts[k + 1] - counts[k] <= 1)
+	    {
+	      if (counts[k + 1] != counts[k])
+		{
+		  symb = term_get (YAEP_STATIC_CAST(int, order[counts[k]]));
+		  slots[buckets[k].offset].code = symb->u.term.code;
+		  slots[buckets[k].offset].symb = symb;
+		}
+	      continue;
+	    }
+	  for (try_num = 0; try_num < 100; try_num++)
+	    {
+	      buckets[k].mult = symb_code_hash_next_mult (&state);
+	      for (j = counts[k]; j < counts[k + 1]; j++)
+		{
+		  symb = term_get (YAEP_STATIC_CAST(int, order[j]));
+		  i = buckets[k].offset
+		    + SYMB_CODE_HASH_REDUCE
+		      (YAEP_STATIC_CAST(uint32_t, symb->u.term.code)
+		       * buckets[k].mult, buckets[k].size);
+		  if (slots[i].symb != NULL)
+		    break;
+		  slots[i].code = symb->u.term.code;
+		  slots[i].symb = symb;
+		}
+	      if (j >= counts[k + 1])
+		break;
+	      for (j = counts[k]; j < counts[k + 1]; j++)
+		{
+		  symb = term_get (YAEP_STATIC_CAST(int, order[j]));
+		  i = buckets[k].offset
+		    + SYMB_CODE_HASH_REDUCE
+		      (YAEP_STATIC_CAST(uint32_t, symb->u.term.code)
+		       * buckets[k].mult, buckets[k].size);
+		  if (slots[i].symb == symb)
+		    slots[i].symb = NULL;
+		}
+	    }
+	  if (try_num >= 100)
+	    break;
+	}
+      if (k >= n)
+	break;
+      /* It is very unlikely: double the bucket and place all codes
+	 again.  */
+      buckets[k].size *= 2;
+      for (size = k = 0; k < n; k++)
+	{
+	  buckets[k].offset = size;
+	  size += buckets[k].size;
+	}
+    }
+  yaep_free (grammar->alloc, counts);
+  symbs_ptr->symb_code_buckets = buckets;
+  symbs_ptr->symb_code_slots = slots;
+  symbs_ptr->symb_code_n_buckets = n;
+  symbs_ptr->symb_code_mult = best_mult;
+}
+
+/* The following function frees the perfect hash of SYMBS. */
+static void
+symb_code_hash_free (struct symbs *symbs)
+{
+  if (symbs->symb_code_slots == NULL)
+    return;
+  yaep_free (grammar->alloc, symbs->symb_code_buckets);
+  yaep_free (grammar->alloc, symbs->symb_code_slots);
+  symbs->symb_code_buckets = NULL;
+  symbs->symb_code_slots = NULL;
+  symbs->symb_code_n_buckets = symbs->symb_code_mult = 0;
+}
+
 static void
 symb_finish_adding_terms (void)
 {
@@ -910,6 +1239,8 @@ symb_finish_adding_terms (void)
       for (i = 0; (symb = term_get (i)) != NULL; i++)
 	symbs_ptr->symb_code_trans_vect[symb->u.term.code - min_code] = symb;
     }
+  else
+    symb_code_hash_create ();
 }
 #endif
 
@@ -925,6 +1256,7 @@ symb_empty (struct symbs *symbs)
       yaep_free (grammar->alloc, symbs_ptr->symb_code_trans_vect);
       symbs_ptr->symb_code_trans_vect = NULL;
     }
+  symb_code_hash_free (symbs);
 #endif
   empty_hash_table (symbs->repr_to_symb_tab);
   empty_hash_table (symbs->code_to_symb_tab);
@@ -932,7 +1264,7 @@ symb_empty (struct symbs *symbs)
   VLO_NULLIFY (symbs->terms_vlo);
   VLO_NULLIFY (symbs->symbs_vlo);
   OS_EMPTY (symbs->symbs_os);
-  symbs->n_nonterms = symbs->n_terms = 0;
+  symbs->n_nonterms = symbs->n_terms = symbs->n_term_set_els = 0;
 }
 
 /* Finalize work with symbols. */
@@ -942,15 +1274,16 @@ symb_fin (struct symbs *symbs)
   if (symbs == NULL)
     return;
 #ifdef SYMB_CODE_TRANS_VECT
-  if (symbs_ptr->symb_code_trans_vect != NULL)
-    yaep_free (grammar->alloc, symbs_ptr->symb_code_trans_vect);
-#endif
-  delete_hash_table (symbs_ptr->repr_to_symb_tab);
-  delete_hash_table (symbs_ptr->code_to_symb_tab);
-  VLO_DELETE (symbs_ptr->nonterms_vlo);
-  VLO_DELETE (symbs_ptr->terms_vlo);
-  VLO_DELETE (symbs_ptr->symbs_vlo);
-  OS_DELETE (symbs_ptr->symbs_os);
+  if (symbs->symb_code_trans_vect != NULL)
+    yaep_free (grammar->alloc, symbs->symb_code_trans_vect);
+  symb_code_hash_free (symbs);
+#endif
+  delete_hash_table (symbs->repr_to_symb_tab);
+  delete_hash_table (symbs->code_to_symb_tab);
+  VLO_DELETE (symbs->nonterms_vlo);
+  VLO_DELETE (symbs->terms_vlo);
+  VLO_DELETE (symbs->symbs_vlo);
+  OS_DELETE (symbs->symbs_os);
   yaep_free (grammar->alloc, symbs);
   symbs = NULL;
 }
@@ -969,15 +1302,14 @@ struct tab_term_set
   term_set_el_t *set;
 };
 
+static unsigned term_set_hash (hash_table_entry_t s);
+static int term_set_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+
 /* The following container for the abstract data. */
 struct term_sets
 {
   /* All terminal sets are stored in the following os. */
-#ifndef __cplusplus
   os_t term_set_os;
-#else
-  os_t *term_set_os;
-#endif
 
   /* The following variables can be read externally.  Their values are
      number of terminal sets and their overall size. */
@@ -985,15 +1317,11 @@ struct term_sets
 
   /* The following is hash table of terminal sets (key is member
      `set'). */
-  hash_table_t term_set_tab;
+  HASH_TABLE_T (term_set_hash, term_set_eq) term_set_tab;
 
   /* References to all structure tab_term_set are stored in the
      following vlo. */
-#ifndef __cplusplus
   vlo_t tab_term_set_vlo;
-#else
-  vlo_t *tab_term_set_vlo;
-#endif
 };
 
 /* Hash of table terminal set. */
@@ -1004,12 +1332,9 @@ term_set_hash (hash_table_entry_t s)
      avoid casting away qualifiers at call sites. */
   const term_set_el_t *set = YAEP_STATIC_CAST(const struct tab_term_set *, s)->set;
   const term_set_el_t *bound;
-  size_t size;
   unsigned result = jauquet_prime_mod32;
 
-  size = ((symbs_ptr->n_terms + YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)) - 1)
-    / YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)));
-  bound = set + size;
+  bound = set + symbs_ptr->n_term_set_els;
   while (set < bound)
     result = result * hash_shift + YAEP_STATIC_CAST(unsigned, *set++);
   return result;
@@ -1021,16 +1346,9 @@ term_set_eq (hash_table_entry_t s1, hash_table_entry_t s2)
 {
   const term_set_el_t *set1 = YAEP_STATIC_CAST(const struct tab_term_set *, s1)->set;
   const term_set_el_t *set2 = YAEP_STATIC_CAST(const struct tab_term_set *, s2)->set;
-  const term_set_el_t *bound;
-  size_t size;
 
-  size = ((symbs_ptr->n_terms + YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)) - 1)
-    / YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)));
-  bound = set1 + size;
-  while (set1 < bound)
-    if (*set1++ != *set2++)
-      return FALSE;
-  return TRUE;
+  return memcmp (set1, set2,
+		 symbs_ptr->n_term_set_els * sizeof (term_set_el_t)) == 0;
 }
 
 /* Initialize work with terminal sets and return storage for terminal
@@ -1054,7 +1372,7 @@ term_set_init (struct grammar *g, struct term_sets **out_term_sets)
       return YAEP_NO_MEMORY;
     }
 
-  memset (result, 0, sizeof (*result));
+  memset (YAEP_STATIC_CAST(void *, result), 0, sizeof (*result));
 
 #ifndef __cplusplus
   if (os_create_safe (&result->term_set_os, g->alloc, 0) != 0)
@@ -1161,6 +1479,105 @@ term_set_create (void)
   return result;
 }
 
+/* The following functions implement the terminal set operations for
+   sets of SIZE elements.  They are called with constant SIZE for sets
+   of 1, 2, and 4 elements (up to 64, 128, and 256 terminals with
+   64-bit elements), so the compiler can unroll the loops and keep the
+   sets in registers.  Term_set_or_els accumulates the new bits
+   instead of testing each element, so it has no branches except the
+   loop one.  */
+#if MAKE_INLINE
+INLINE
+#endif
+static void
+term_set_clear_els (term_set_el_t * set, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    set[i] = 0;
+}
+
+#if MAKE_INLINE
+INLINE
+#endif
+static void
+term_set_copy_els (term_set_el_t * dest, const term_set_el_t * src,
+		   size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    dest[i] = src[i];
+}
+
+#if MAKE_INLINE
+INLINE
+#endif
+static int
+term_set_or_els (term_set_el_t * set, const term_set_el_t * op,
+		 size_t size)
+{
+  size_t i;
+  term_set_el_t new_bits = 0;
+
+  for (i = 0; i < size; i++)
+    {
+      new_bits |= op[i] & ~set[i];
+      set[i] |= op[i];
+    }
+  return new_bits != 0;
+}
+
+#ifdef TERM_SET_SIMD
+
+/* The following functions are versions of term_set_or_els for bigger
+   sets which process 128 or 256 bits at once.  The sets are aligned
+   only to the element size.  */
+static int
+term_set_or_sse2 (term_set_el_t * set, const term_set_el_t * op,
+		  size_t size)
+{
+  const size_t step = sizeof (__m128i) / sizeof (term_set_el_t);
+  __m128i s, o, new_bits = _mm_setzero_si128 ();
+  size_t i;
+
+  for (i = 0; i + step <= size; i += step)
+    {
+      s = _mm_loadu_si128 (YAEP_REINTERPRET_CAST(const __m128i *, set + i));
+      o = _mm_loadu_si128 (YAEP_REINTERPRET_CAST(const __m128i *, op + i));
+      new_bits = _mm_or_si128 (new_bits, _mm_andnot_si128 (s, o));
+      _mm_storeu_si128 (YAEP_REINTERPRET_CAST(__m128i *, set + i),
+			_mm_or_si128 (s, o));
+    }
+  return ((_mm_movemask_epi8 (_mm_cmpeq_epi8 (new_bits, _mm_setzero_si128 ()))
+	   != 0xffff)
+	  | term_set_or_els (set + i, op + i, size - i));
+}
+
+__attribute__ ((target ("avx2")))
+static int
+term_set_or_avx2 (term_set_el_t * set, const term_set_el_t * op,
+		  size_t size)
+{
+  const size_t step = sizeof (__m256i) / sizeof (term_set_el_t);
+  __m256i s, o, new_bits = _mm256_setzero_si256 ();
+  size_t i;
+
+  for (i = 0; i + step <= size; i += step)
+    {
+      s = _mm256_loadu_si256 (YAEP_REINTERPRET_CAST(const __m256i *, set + i));
+      o = _mm256_loadu_si256 (YAEP_REINTERPRET_CAST(const __m256i *, op + i));
+      new_bits = _mm256_or_si256 (new_bits, _mm256_andnot_si256 (s, o));
+      _mm256_storeu_si256 (YAEP_REINTERPRET_CAST(__m256i *, set + i),
+			   _mm256_or_si256 (s, o));
+    }
+  return ((_mm256_testz_si256 (new_bits, new_bits) == 0)
+	  | term_set_or_els (set + i, op + i, size - i));
+}
+
+#endif /* #ifdef TERM_SET_SIMD */
+
 /* Make terminal SET empty. */
 #if MAKE_INLINE
 INLINE
@@ -1168,14 +1585,23 @@ INLINE
 static void
 term_set_clear (term_set_el_t * set)
 {
-  term_set_el_t *bound;
-  size_t size;
-
-  size = ((symbs_ptr->n_terms + YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)) - 1)
-    / YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)));
-  bound = set + size;
-  while (set < bound)
-    *set++ = 0;
+  switch (symbs_ptr->n_term_set_els)
+    {
+    case 1:
+      term_set_clear_els (set, 1);
+      break;
+    case 2:
+      term_set_clear_els (set, 2);
+      break;
+    case 4:
+      term_set_clear_els (set, 4);
+      break;
+    default:
+      /* The library function uses the best vector instructions of
+	 the processor.  */
+      memset (set, 0, symbs_ptr->n_term_set_els * sizeof (term_set_el_t));
+      break;
+    }
 }
 
 /* Copy SRC into DEST. */
@@ -1185,14 +1611,21 @@ INLINE
 static void
 term_set_copy (term_set_el_t * dest, term_set_el_t * src)
 {
-  term_set_el_t *bound;
-  size_t size;
-
-  size = ((symbs_ptr->n_terms + YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)) - 1)
-    / YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)));
-  bound = dest + size;
-  while (dest < bound)
-    *dest++ = *src++;
+  switch (symbs_ptr->n_term_set_els)
+    {
+    case 1:
+      term_set_copy_els (dest, src, 1);
+      break;
+    case 2:
+      term_set_copy_els (dest, src, 2);
+      break;
+    case 4:
+      term_set_copy_els (dest, src, 4);
+      break;
+    default:
+      memcpy (dest, src, symbs_ptr->n_term_set_els * sizeof (term_set_el_t));
+      break;
+    }
 }
 
 /* Add all terminals from set OP with to SET.  Return TRUE if SET has
@@ -1203,21 +1636,25 @@ INLINE
 static int
 term_set_or (term_set_el_t * set, term_set_el_t * op)
 {
-  term_set_el_t *bound;
-  size_t size;
-  int changed_p;
+  size_t size = symbs_ptr->n_term_set_els;
 
-  size = ((symbs_ptr->n_terms + YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)) - 1)
-    / YAEP_STATIC_CAST(size_t, CHAR_BIT * sizeof (term_set_el_t)));
-  bound = set + size;
-  changed_p = 0;
-  while (set < bound)
+  switch (size)
     {
-      if ((*set | *op) != *set)
-	changed_p = 1;
-      *set++ |= *op++;
+    case 1:
+      return term_set_or_els (set, op, 1);
+    case 2:
+      return term_set_or_els (set, op, 2);
+    case 4:
+      return term_set_or_els (set, op, 4);
+    default:
+#ifdef TERM_SET_SIMD
+      if (__builtin_cpu_supports ("avx2"))
+	return term_set_or_avx2 (set, op, size);
+      return term_set_or_sse2 (set, op, size);
+#else
+      return term_set_or_els (set, op, size);
+#endif
     }
-  return changed_p;
 }
 
 /* Add terminal with number NUM to SET.  Return TRUE if SET has been
@@ -1228,12 +1665,16 @@ INLINE
 static int
 term_set_up (term_set_el_t * set, int num)
 {
-  int ind, changed_p;
+  size_t n = YAEP_STATIC_CAST(size_t, num), ind;
+  int changed_p;
   term_set_el_t bit;
 
-  assert (YAEP_STATIC_CAST(size_t, num) < symbs_ptr->n_terms);
-  ind = num / YAEP_STATIC_CAST(int, CHAR_BIT * sizeof (term_set_el_t));
-  bit = YAEP_STATIC_CAST(term_set_el_t, 1) << (num % YAEP_STATIC_CAST(int, CHAR_BIT * sizeof (term_set_el_t)));
+  assert (num >= 0 && n < symbs_ptr->n_terms);
+  ind = n / TERM_SET_EL_BITS;
+  /* Shift an unsigned one, shifting a signed one into the sign bit
+     is undefined.  */
+  bit = YAEP_STATIC_CAST(term_set_el_t,
+			 YAEP_STATIC_CAST(unsigned long, 1) << (n % TERM_SET_EL_BITS));
   changed_p = (set[ind] & bit ? 0 : 1);
   set[ind] |= bit;
   return changed_p;
@@ -1246,13 +1687,12 @@ INLINE
 static int
 term_set_test (term_set_el_t * set, int num)
 {
-  int ind;
-  term_set_el_t bit;
+  size_t n = YAEP_STATIC_CAST(size_t, num);
 
-  assert (num >= 0 && YAEP_STATIC_CAST(size_t, num) < symbs_ptr->n_terms);
-  ind = num / YAEP_STATIC_CAST(int, CHAR_BIT * sizeof (term_set_el_t));
-  bit = YAEP_STATIC_CAST(term_set_el_t, 1) << (num % YAEP_STATIC_CAST(int, CHAR_BIT * sizeof (term_set_el_t)));
-  return (set[ind] & bit) != 0;
+  assert (num >= 0 && n < symbs_ptr->n_terms);
+  /* Unsigned division and remainder are a shift and a mask.  */
+  return YAEP_STATIC_CAST(int, (set[n / TERM_SET_EL_BITS]
+				>> (n % TERM_SET_EL_BITS)) & 1);
 }
 
 /* The following function inserts terminal SET into the table and
@@ -1389,9 +1829,6 @@ struct rule
      in array.  Then the following member is index of the rule lhs in
      the array. */
   int rule_start_offset;
-  /* The following is the same string as anode but memory allocated in
-     parse_alloc. */
-  char *caller_anode;
 };
 
 /* The following container for the abstract data. */
@@ -1405,12 +1842,25 @@ struct rules
   /* The following is rule being formed.  It can be read
      externally. */
   struct rule *curr_rule;
+  /* The following arrays are indexed by situation number
+     (rule->rule_start_offset + pos).  They contain static lookaheads
+     of the situations and flags that the situation tails can derive
+     empty string.  The arrays are created only for the frozen grammar
+     with static lookaheads, otherwise they are NULL. */
+  term_set_el_t **sit_lookaheads;
+  char *sit_empty_tails;
+  /* The following array is indexed by situation number too and
+     contains all situations of the frozen grammar without dynamic
+     lookaheads.  Parsers use them instead of creating their own
+     situations, so situations of different parsers of the grammar
+     are the same (see sit_create).  Otherwise it is NULL. */
+  struct sit *sits;
+  /* The following array is indexed by situation number too and
+     contains the situation rule.  It is used to get situations from
+     the nonterminal prediction closures. */
+  struct rule **sit_rules;
   /* All rules are placed in the following object. */
-#ifndef __cplusplus
   os_t rules_os;
-#else
-  os_t *rules_os;
-#endif
 };
 
 /* Initialize work with rules and return pointer to rules storage. */
@@ -1428,7 +1878,7 @@ rule_init (struct grammar *g, struct rules **out_rules)
       return YAEP_NO_MEMORY;
     }
 
-  memset (result, 0, sizeof (*result));
+  memset (YAEP_STATIC_CAST(void *, result), 0, sizeof (*result));
 
 #ifndef __cplusplus
   if (os_create_safe (&result->rules_os, g->alloc, 0) != 0)
@@ -1600,6 +2050,10 @@ rule_empty (struct rules *rules)
     return;
   OS_EMPTY (rules->rules_os);
   rules->first_rule = rules->curr_rule = NULL;
+  rules->sit_lookaheads = NULL;
+  rules->sit_empty_tails = NULL;
+  rules->sits = NULL;
+  rules->sit_rules = NULL;
   rules->n_rules = rules->n_rhs_lens = 0;
 }
 
@@ -1616,69 +2070,589 @@ rule_fin (struct rules *rules)
 
 
 
-/* This page is abstract data `input tokens'. */
+/* This page is abstract data `parser'.  The parser contains all data
+   which are changed during parsing.  So several parsers can work with
+   the same grammar simultaneously in different threads.  The parser
+   data are accessed through macros with the names of the former
+   global variables (see the corresponding pages for their
+   descriptions). */
+
+static unsigned set_core_hash (hash_table_entry_t s);
+static int set_core_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+static unsigned dists_hash (hash_table_entry_t s);
+static int dists_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+static unsigned set_core_dists_hash (hash_table_entry_t s);
+static int set_core_dists_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+static unsigned set_term_lookahead_hash (hash_table_entry_t s);
+static int set_term_lookahead_eq (hash_table_entry_t s1,
+				  hash_table_entry_t s2);
+#ifdef USE_CORE_SYMB_HASH_TABLE
+static unsigned core_symb_vect_hash (hash_table_entry_t t);
+static int core_symb_vect_eq (hash_table_entry_t t1, hash_table_entry_t t2);
+#endif
+static unsigned transition_els_hash (hash_table_entry_t t);
+static int transition_els_eq (hash_table_entry_t t1, hash_table_entry_t t2);
+#ifdef TRANSITIVE_TRANSITION
+static unsigned transitive_transition_els_hash (hash_table_entry_t t);
+static int transitive_transition_els_eq (hash_table_entry_t t1,
+					 hash_table_entry_t t2);
+#endif
+static unsigned reduce_els_hash (hash_table_entry_t t);
+static int reduce_els_eq (hash_table_entry_t t1, hash_table_entry_t t2);
+static unsigned leo_sit_hash (hash_table_entry_t s);
+static int leo_sit_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+static unsigned parse_state_hash (hash_table_entry_t s);
+static int parse_state_eq (hash_table_entry_t s1, hash_table_entry_t s2);
+static unsigned forest_choice_hash (hash_table_entry_t c);
+static int forest_choice_eq (hash_table_entry_t c1, hash_table_entry_t c2);
+static unsigned sppf_node_hash (hash_table_entry_t n);
+static int sppf_node_eq (hash_table_entry_t n1, hash_table_entry_t n2);
+static unsigned min_cost_node_hash (hash_table_entry_t n);
+static int min_cost_node_eq (hash_table_entry_t n1, hash_table_entry_t n2);
+static unsigned trans_visit_node_hash (hash_table_entry_t n);
+static int trans_visit_node_eq (hash_table_entry_t n1, hash_table_entry_t n2);
+static unsigned reserv_mem_hash (hash_table_entry_t m);
+static int reserv_mem_eq (hash_table_entry_t m1, hash_table_entry_t m2);
+
+struct yaep_parser
+{
+  /* The grammar used by the parser. */
+  struct grammar *grammar;
 
-/* The initial length of array (in tokens) in which input tokens are
-   placed. */
-#ifndef YAEP_INIT_TOKENS_NUMBER
-#define YAEP_INIT_TOKENS_NUMBER 10000
+  /* The last occurred error code and the corresponding message for
+     the parser. */
+  int error_code;
+  char error_message[YAEP_MAX_ERROR_MESSAGE_LENGTH + 1];
+
+  /* Terminal sets (situation lookaheads and contexts) created during
+     parsing.  The grammar terminal sets are never changed by the
+     parser. */
+  struct term_sets *term_sets;
+
+  /* The following is TRUE if the parser contains situations, set
+     cores, sets, goto sets and core_symb_vects (the parse cache)
+     formed by previous parses.  The parse cache is kept only if
+     grammar->parse_cache_limit is not zero.  The grammar generation
+     and lookahead level for which the cache was formed are also
+     saved. */
+  int cache_p;
+  unsigned cache_generation;
+  int cache_lookahead_level;
+
+  /* The following is TRUE if the parser contains the parse workspace:
+     containers used by each parse (tokens, the parsing list, the
+     pairs (sit, dist), error recovery stacks, the parse tree building
+     stack, and parser states).  The workspace is emptied at the parse
+     start instead of creation and deletion of the containers for each
+     parse (see workspace_init). */
+  int workspace_p;
+
+  /* The following is TRUE if the parser is parsing now.  The second
+     flag is TRUE if the parse is started by yaep_parse_begin. */
+  int busy_p;
+  int push_p;
+
+  /* The following is TRUE if the parser is used by yaep_parse_batch.
+     Its parse statistics are added to the grammar statistics by
+     yaep_parse_batch after all parses. */
+  int batch_p;
+
+  /* Statistics of the last parse and their sums for all parses made
+     by the parser. */
+  struct yaep_parse_stats last_stats, total_stats;
+
+  /* The arena for the parse trees (or NULL). */
+  struct yaep_tree_arena *tree_arena;
+
+  /* The callbacks called instead of building the parse trees (or
+     NULL). */
+  const struct yaep_tree_events *tree_events;
+
+  /* Flag of building lazy forests instead of the parse trees (see
+     yaep_parser_set_forest_flag). */
+  int forest_p;
+
+  /* Flag of building shared packed parse forests instead of the parse
+     trees (see yaep_parser_set_sppf_flag). */
+  int sppf_p;
+
+  /* Hash table collisions and searches at the parse start. */
+  int x_tab_collisions, x_tab_searches;
+
+  /* The number of the current parse and the number of goto sets
+     formed by previous parses and reused in the current parse. */
+  int x_parse_num;
+  int x_n_goto_cache_hits;
+
+  /* Parser callbacks. */
+  int (*x_read_token) (void **attr);
+  void (*x_syntax_error) (int err_tok_num,
+			  void *err_tok_attr,
+			  int start_ignored_tok_num,
+			  void *start_ignored_tok_attr,
+			  int start_recovered_tok_num,
+			  void *start_recovered_tok_attr);
+  void *(*x_parse_alloc) (int nmemb);
+  void (*x_parse_free) (void *mem);
+
+  /* Input tokens. */
+  int *x_tok_terms;
+  struct symb **x_tok_term_symbs;
+  int x_toks_len, x_tok_curr;
+  void *const *x_tok_attrs;
+  int x_n_tok_attrs;
+
+  /* Situations. */
+  int x_n_all_sits;
+  struct sit ***x_sit_table;
+
+  /* Sets. */
+  struct set *x_new_set;
+  struct set_core *x_new_core;
+  int x_new_set_ready_p;
+  struct sit **x_new_sits;
+  int *x_new_dists;
+  int x_new_n_start_sits;
+  int x_n_set_cores, x_n_set_core_start_sits;
+  int x_n_set_dists, x_n_set_dists_len, x_n_parent_indexes;
+  int x_n_sets, x_n_sets_start_sits;
+  int x_n_set_term_lookaheads;
+  HASH_TABLE_T (set_core_hash, set_core_eq) x_set_core_tab;
+  HASH_TABLE_T (dists_hash, dists_eq) x_set_dists_tab;
+  HASH_TABLE_T (set_core_dists_hash, set_core_dists_eq) x_set_tab;
+  HASH_TABLE_T (set_term_lookahead_hash, set_term_lookahead_eq)
+    x_set_term_lookahead_tab;
+  int x_curr_sit_dist_vec_check;
+  int x_curr_prediction_check;
+  /* The shared memo snapshot used by the parser (or NULL). */
+  struct shared_memo_snapshot *x_memo_snapshot;
+#ifdef TRANSITIVE_TRANSITION
+  int x_curr_sit_check, x_core_symbol_check;
 #endif
 
-/* The following describes input token. */
-struct tok
-{
-  /* The following is symb correseponding to the token. */
-  struct symb *symb;
-  /* The following is an attribute of the token. */
-  void *attr;
+  /* Parser list.  The following flags are TRUE if forming the list
+     is stopped by a syntax error or suspended until the end of input
+     to make error recovery. */
+  struct set **x_pl;
+  int x_pl_curr, x_pl_size;
+  int x_pl_stopped_p, x_pl_suspended_p;
+
+  /* Pairs (set core, symbol). */
+  int x_vlo_array_len;
+  int x_n_core_symb_pairs, x_n_core_symb_vect_len;
+  int x_n_transition_vects, x_n_transition_vect_len;
+#ifdef TRANSITIVE_TRANSITION
+  int x_n_transitive_transition_vects, x_n_transitive_transition_vect_len;
+#endif
+  int x_n_reduce_vects, x_n_reduce_vect_len;
+#ifdef USE_CORE_SYMB_HASH_TABLE
+  HASH_TABLE_T (core_symb_vect_hash, core_symb_vect_eq)
+    x_core_symb_to_vect_tab;
+  /* The following is indexed by symbol number and used as cache for
+     subsequent search for core_symb_vect with given symb. */
+  struct core_symb_vect **x_cached_core_symb_vects;
+#endif
+  HASH_TABLE_T (transition_els_hash, transition_els_eq) x_transition_els_tab;
+#ifdef TRANSITIVE_TRANSITION
+  HASH_TABLE_T (transitive_transition_els_hash, transitive_transition_els_eq)
+    x_transitive_transition_els_tab;
+#endif
+  HASH_TABLE_T (reduce_els_hash, reduce_els_eq) x_reduce_els_tab;
+
+  /* Error recovery. */
+  int x_start_pl_curr, x_start_tok_curr;
+  int x_back_pl_frontier;
+  int x_original_last_pl_el;
+  int x_n_goto_successes;
+
+  /* Leo items. */
+  int x_leo_p, x_leo_off_p;
+  int x_n_leo_items, x_n_leo_uses;
+  HASH_TABLE_T (leo_sit_hash, leo_sit_eq) x_leo_sits_tab;
+
+  /* Parse tree building. */
+  struct parse_state *x_free_parse_state;
+  HASH_TABLE_T (parse_state_hash, parse_state_eq) x_parse_state_tab;
+  HASH_TABLE_T (trans_visit_node_hash, trans_visit_node_eq)
+    x_trans_visit_nodes_tab;
+  int x_n_trans_visit_nodes;
+  int x_n_parse_term_nodes, x_n_parse_abstract_nodes, x_n_parse_alt_nodes;
+  HASH_TABLE_T (reserv_mem_hash, reserv_mem_eq) x_reserv_mem_tab;
+  /* The following is TRUE if we build only one parse.  It is
+     different from the grammar flag when we look for the minimal
+     cost parse. */
+  int x_curr_one_parse_p;
+  /* The following is indexed by rule number and contains the same
+     string as the rule anode but memory allocated by parse_alloc. */
+  char **x_caller_anodes;
+
+  vlo_t x_tok_terms_vlo, x_tok_attrs_vlo, x_sit_table_vlo;
+  os_t x_sits_os;
+  os_t x_set_cores_os, x_set_sits_os, x_set_parent_indexes_os;
+  os_t x_set_dists_os, x_sets_os, x_set_term_lookahead_os;
+  vlo_t x_sit_dist_vec_vlo;
+  vlo_t x_prediction_sit_check_vlo, x_prediction_nonterm_check_vlo;
+#ifdef TRANSITIVE_TRANSITION
+  vlo_t x_core_symbol_check_vlo, x_core_symbols_vlo;
+  vlo_t x_core_symbol_queue_vlo;
+#endif
+  vlo_t x_vlo_array;
+  os_t x_core_symb_vect_os;
+  vlo_t x_new_core_symb_vect_vlo;
+  os_t x_vect_els_os;
+#ifndef USE_CORE_SYMB_HASH_TABLE
+  os_t x_core_symb_tab_rows;
+#endif
+  os_t x_recovery_state_tail_sets;
+  vlo_t x_original_pl_tail_stack, x_recovery_state_stack;
+  vlo_t x_leo_items_vlo, x_leo_uses_vlo;
+  os_t x_leo_items_os;
+  os_t x_parse_state_os, x_trans_visit_nodes_os;
+  vlo_t x_tnodes_vlo, x_parse_stack;
+  os_t x_tree_events_os;
+  vlo_t x_tree_events_stack;
+  int x_forest_live_p;
+  os_t x_forest_os;
+  vlo_t x_forest_term_nodes_vlo, x_forest_ends_vlo;
+  vlo_t x_forest_origs_vlo, x_forest_orig_marks_vlo, x_forest_rules_vlo;
+  int x_forest_orig_stamp;
+  HASH_TABLE_T (forest_choice_hash, forest_choice_eq) x_forest_choice_tab;
+  struct yaep_tree_node *x_forest_nil_node, *x_forest_error_node;
+  os_t x_sppf_os;
+  vlo_t x_sppf_nodes_vlo, x_sppf_stack_vlo;
+  HASH_TABLE_T (sppf_node_hash, sppf_node_eq) x_sppf_node_tab;
+  struct yaep_sppf_node *x_sppf_root_node;
+  os_t x_min_cost_os;
+  vlo_t x_min_cost_stack_vlo;
+  HASH_TABLE_T (min_cost_node_hash, min_cost_node_eq) x_min_cost_node_tab;
 };
 
-/* The following two variables contains all input tokens and their
-   number.  The variables can be read externally. */
-static struct tok *toks;
-static int toks_len;
-static int tok_curr;
+/* The following variable value is the parser working in the current
+   thread. */
+static YAEP_THREAD_LOCAL struct yaep_parser *curr_parser;
 
-/* The following array contains all input tokens. */
-#ifndef __cplusplus
-static vlo_t toks_vlo;
-#else
-static vlo_t *toks_vlo;
+/* The following structure is used to save the current parser and
+   grammar environment of the thread. */
+struct yaep_parser_env
+{
+  struct yaep_parser *parser;
+  struct grammar *grammar;
+  struct symbs *symbs_ptr;
+  struct term_sets *term_sets_ptr;
+  struct rules *rules_ptr;
+};
+
+static size_t parse_cache_size (void);
+#ifdef USE_SHARED_MEMO
+static int shared_memo_create (void);
+static int lr0_automaton_create (void);
 #endif
 
-/* Initialize work with tokens. */
+/* The following function puts statistics of the current parse
+   into *STATS.  AMBIGUOUS_P is the parse result, TAB_COLLISIONS and
+   TAB_SEARCHES are the hash table collisions and searches made by the
+   parse. */
 static void
-tok_init (void)
-{
-  VLO_CREATE (toks_vlo, grammar->alloc,
-	      YAEP_INIT_TOKENS_NUMBER * sizeof (struct tok));
-  toks_len = 0;
+parse_stats_collect (struct yaep_parse_stats *stats, int ambiguous_p,
+		     int tab_collisions, int tab_searches)
+{
+  memset (stats, 0, sizeof (struct yaep_parse_stats));
+  stats->n_parses = 1;
+  stats->n_ambiguous_parses = ambiguous_p ? 1 : 0;
+  /* Do not count the end marker. */
+  stats->n_tokens = curr_parser->x_toks_len - 1;
+  stats->n_sits = curr_parser->x_n_all_sits;
+  stats->n_term_sets
+    = YAEP_STATIC_CAST(long, grammar->term_sets_ptr->n_term_sets
+		       + term_sets_ptr->n_term_sets);
+  stats->term_sets_size
+    = YAEP_STATIC_CAST(long, grammar->term_sets_ptr->n_term_sets_size
+		       + term_sets_ptr->n_term_sets_size);
+  stats->n_set_cores = curr_parser->x_n_set_cores;
+  stats->n_set_core_start_sits = curr_parser->x_n_set_core_start_sits;
+  stats->n_parent_indexes = curr_parser->x_n_parent_indexes;
+  stats->n_set_dists = curr_parser->x_n_set_dists;
+  stats->n_set_dists_len = curr_parser->x_n_set_dists_len;
+  stats->n_sets = curr_parser->x_n_sets;
+  stats->n_sets_start_sits = curr_parser->x_n_sets_start_sits;
+  stats->n_set_term_lookaheads = curr_parser->x_n_set_term_lookaheads;
+  stats->n_goto_successes = curr_parser->x_n_goto_successes;
+  stats->n_goto_cache_hits = curr_parser->x_n_goto_cache_hits;
+  stats->n_leo_items = curr_parser->x_n_leo_items;
+  stats->n_leo_uses = curr_parser->x_n_leo_uses;
+  stats->n_core_symb_pairs = curr_parser->x_n_core_symb_pairs;
+  stats->n_core_symb_vect_len = curr_parser->x_n_core_symb_vect_len;
+  stats->n_transition_vects = curr_parser->x_n_transition_vects;
+  stats->n_transition_vect_len = curr_parser->x_n_transition_vect_len;
+#ifdef TRANSITIVE_TRANSITION
+  stats->n_transitive_transition_vects
+    = curr_parser->x_n_transitive_transition_vects;
+  stats->n_transitive_transition_vect_len
+    = curr_parser->x_n_transitive_transition_vect_len;
+#endif
+  stats->n_reduce_vects = curr_parser->x_n_reduce_vects;
+  stats->n_reduce_vect_len = curr_parser->x_n_reduce_vect_len;
+  stats->n_term_nodes = curr_parser->x_n_parse_term_nodes;
+  stats->n_abstract_nodes = curr_parser->x_n_parse_abstract_nodes;
+  stats->n_alt_nodes = curr_parser->x_n_parse_alt_nodes;
+  stats->n_tab_searches = tab_searches;
+  stats->n_tab_collisions = tab_collisions;
+  stats->parse_cache_size
+    = curr_parser->cache_p ? YAEP_STATIC_CAST(long, parse_cache_size ()) : 0;
+}
+
+/* The following function adds statistics STATS to the sums
+   TOTAL. */
+static void
+parse_stats_add (struct yaep_parse_stats *total,
+		 const struct yaep_parse_stats *stats)
+{
+  total->n_parses += stats->n_parses;
+  total->n_ambiguous_parses += stats->n_ambiguous_parses;
+  total->n_tokens += stats->n_tokens;
+  total->n_sits += stats->n_sits;
+  total->n_term_sets += stats->n_term_sets;
+  total->term_sets_size += stats->term_sets_size;
+  total->n_set_cores += stats->n_set_cores;
+  total->n_set_core_start_sits += stats->n_set_core_start_sits;
+  total->n_parent_indexes += stats->n_parent_indexes;
+  total->n_set_dists += stats->n_set_dists;
+  total->n_set_dists_len += stats->n_set_dists_len;
+  total->n_sets += stats->n_sets;
+  total->n_sets_start_sits += stats->n_sets_start_sits;
+  total->n_set_term_lookaheads += stats->n_set_term_lookaheads;
+  total->n_goto_successes += stats->n_goto_successes;
+  total->n_goto_cache_hits += stats->n_goto_cache_hits;
+  total->n_leo_items += stats->n_leo_items;
+  total->n_leo_uses += stats->n_leo_uses;
+  total->n_core_symb_pairs += stats->n_core_symb_pairs;
+  total->n_core_symb_vect_len += stats->n_core_symb_vect_len;
+  total->n_transition_vects += stats->n_transition_vects;
+  total->n_transition_vect_len += stats->n_transition_vect_len;
+  total->n_transitive_transition_vects
+    += stats->n_transitive_transition_vects;
+  total->n_transitive_transition_vect_len
+    += stats->n_transitive_transition_vect_len;
+  total->n_reduce_vects += stats->n_reduce_vects;
+  total->n_reduce_vect_len += stats->n_reduce_vect_len;
+  total->n_term_nodes += stats->n_term_nodes;
+  total->n_abstract_nodes += stats->n_abstract_nodes;
+  total->n_alt_nodes += stats->n_alt_nodes;
+  total->n_tab_searches += stats->n_tab_searches;
+  total->n_tab_collisions += stats->n_tab_collisions;
+  total->parse_cache_size = stats->parse_cache_size;
 }
 
-/* Add input token with CODE and attribute at the end of input tokens
-  array.  Return 0 on success, otherwise YAEP error code. */
-static int
-tok_add (int code, void *attr)
+#ifndef NO_YAEP_DEBUG_PRINT
+
+/* The following function prints statistics STATS of the current
+   parse into stderr. */
+static void
+parse_stats_print (const struct yaep_parse_stats *stats)
 {
-  struct symb *symb;
-  struct tok tok;
+  long tab_searches = stats->n_tab_searches;
 
-  symb = symb_find_by_code (code);
-  if (symb == NULL)
-    return yaep_set_error (grammar, YAEP_INVALID_TOKEN_CODE,
-			    "invalid token code %d", code);
+  fprintf (stderr, "%sGrammar: #terms = %zu, #nonterms = %zu, ",
+	   stats->n_ambiguous_parses != 0 ? "AMBIGUOUS " : "",
+	   symbs_ptr->n_terms, symbs_ptr->n_nonterms);
+  fprintf (stderr, "#rules = %d, rules size = %d\n",
+	   rules_ptr->n_rules, rules_ptr->n_rhs_lens + rules_ptr->n_rules);
+  /* The end marker is counted here. */
+  fprintf (stderr, "Input: #tokens = %ld, #unique situations = %ld\n",
+	   stats->n_tokens + 1, stats->n_sits);
+  fprintf (stderr, "       #terminal sets = %ld, their size = %ld\n",
+	   stats->n_term_sets, stats->term_sets_size);
+  fprintf (stderr,
+	   "       #unique set cores = %ld, #their start situations = %ld\n",
+	   stats->n_set_cores, stats->n_set_core_start_sits);
+  fprintf (stderr,
+	   "       #parent indexes for some non start situations = %ld\n",
+	   stats->n_parent_indexes);
+  fprintf (stderr,
+	   "       #unique set dist. vects = %ld, their length = %ld\n",
+	   stats->n_set_dists, stats->n_set_dists_len);
+  fprintf (stderr,
+	   "       #unique sets = %ld, #their start situations = %ld\n",
+	   stats->n_sets, stats->n_sets_start_sits);
+  fprintf (stderr,
+	   "       #unique triples (set, term, lookahead) = %ld, goto successes=%ld\n",
+	   stats->n_set_term_lookaheads, stats->n_goto_successes);
+  if (grammar->parse_cache_limit != 0)
+    fprintf (stderr,
+	     "       #goto successes from previous parses = %ld (%.2g%% of tokens), cache size = %ld\n",
+	     stats->n_goto_cache_hits,
+	     YAEP_STATIC_CAST(double, stats->n_goto_cache_hits) * 100.0
+	     / YAEP_STATIC_CAST(double, stats->n_tokens),
+	     stats->parse_cache_size);
+  if (curr_parser->x_leo_p)
+    fprintf (stderr, "       #Leo items = %ld, their uses = %ld\n",
+	     stats->n_leo_items, stats->n_leo_uses);
+  fprintf (stderr,
+	   "       #pairs(set core, symb) = %ld, their trans+reduce vects length = %ld\n",
+	   stats->n_core_symb_pairs, stats->n_core_symb_vect_len);
+  fprintf (stderr,
+	   "       #unique transition vectors = %ld, their length = %ld\n",
+	   stats->n_transition_vects, stats->n_transition_vect_len);
+#ifdef TRANSITIVE_TRANSITION
+  fprintf (stderr,
+	   "       #unique transitive transition vectors = %ld, their length = %ld\n",
+	   stats->n_transitive_transition_vects,
+	   stats->n_transitive_transition_vect_len);
+#endif
+  fprintf (stderr,
+	   "       #unique reduce vectors = %ld, their length = %ld\n",
+	   stats->n_reduce_vects, stats->n_reduce_vect_len);
+  fprintf (stderr,
+	   "       #term nodes = %ld, #abstract nodes = %ld\n",
+	   stats->n_term_nodes, stats->n_abstract_nodes);
+  fprintf (stderr,
+	   "       #alternative nodes = %ld, #all nodes = %ld\n",
+	   stats->n_alt_nodes,
+	   stats->n_term_nodes + stats->n_abstract_nodes + stats->n_alt_nodes);
+  if (tab_searches == 0)
+    tab_searches++;
+  fprintf (stderr,
+	   "       #table collisions = %.2g%% (%ld out of %ld)\n",
+	   YAEP_STATIC_CAST(double, stats->n_tab_collisions) * 100.0
+	   / YAEP_STATIC_CAST(double, tab_searches),
+	   stats->n_tab_collisions, stats->n_tab_searches);
+}
 
-  tok.attr = attr;
-  tok.symb = symb;
+#endif /* #ifndef NO_YAEP_DEBUG_PRINT */
 
-  VLO_ADD_MEMORY (toks_vlo, &tok, sizeof (struct tok));
-  toks = YAEP_STATIC_CAST(struct tok *, VLO_BEGIN (toks_vlo));
-  toks_len++;
-  if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
-    {
-      fprintf (stderr, "YAEP_DEBUG_TOK_ADD code=%d attr=%p symb=%p toks=%p toks_len=%d\n",
-               code, attr, YAEP_STATIC_CAST(void *, symb), YAEP_STATIC_CAST(void *, toks), toks_len);
-      fflush (stderr);
+/* The following is set up the parser and used globally. */
+#define read_token (curr_parser->x_read_token)
+#define syntax_error (curr_parser->x_syntax_error)
+#define parse_alloc (curr_parser->x_parse_alloc)
+#define parse_free (curr_parser->x_parse_free)
+
+/* The following is TRUE if we build only one parse in the current
+   parser. */
+#define curr_one_parse_p (curr_parser->x_curr_one_parse_p)
+
+/* The number of the current parse of the parser and how many times
+   we reuse Earley's sets from the previous parses kept in the parse
+   cache.  */
+#define curr_parse_num (curr_parser->x_parse_num)
+#define n_goto_cache_hits (curr_parser->x_n_goto_cache_hits)
+
+/* Abstract node names of the rules allocated by parse_alloc. */
+#define caller_anodes (curr_parser->x_caller_anodes)
+
+#ifdef USE_CORE_SYMB_HASH_TABLE
+#define cached_core_symb_vects (curr_parser->x_cached_core_symb_vects)
+#endif
+
+
+
+/* This page is abstract data `input tokens'. */
+
+/* The initial length of array (in tokens) in which input tokens are
+   placed. */
+#ifndef YAEP_INIT_TOKENS_NUMBER
+#define YAEP_INIT_TOKENS_NUMBER 10000
+#endif
+
+/* Input tokens are kept as a structure of arrays: the terminal
+   numbers of the tokens are in one array of 32-bit integers and
+   their attributes are in another one (see tok_attrs) because they
+   can be in an array of the caller.  So the parser reads 4 bytes per
+   token instead of a symbol pointer, and the lookahead terminal
+   number is got without loading the symbol. */
+
+/* The following two variables contains terminal numbers of all input
+   tokens and their number.  The variables can be read externally. */
+#define tok_terms (curr_parser->x_tok_terms)
+#define toks_len (curr_parser->x_toks_len)
+#define tok_curr (curr_parser->x_tok_curr)
+
+/* The following array contains the terminal numbers of all input
+   tokens. */
+#define tok_terms_vlo (curr_parser->x_tok_terms_vlo)
+
+/* The following is the array of the grammar terminals indexed by
+   terminal number.  It is set up at each parse start. */
+#define tok_term_symbs (curr_parser->x_tok_term_symbs)
+
+/* The following macro value is the terminal of token with number
+   I. */
+#define tok_symb(i) (tok_term_symbs[tok_terms[i]])
+
+/* The following are attributes of the first n_tok_attrs tokens.
+   Other tokens have NULL attributes.  The attributes are in
+   tok_attrs_vlo or in an array given by the caller. */
+#define tok_attrs (curr_parser->x_tok_attrs)
+#define n_tok_attrs (curr_parser->x_n_tok_attrs)
+#define tok_attrs_vlo (curr_parser->x_tok_attrs_vlo)
+
+/* The following macro value is the attribute of token with number
+   I. */
+#define tok_attr(i) ((i) < n_tok_attrs ? tok_attrs[i] : NULL)
+
+/* Create the containers of tokens. */
+static void
+tok_create (void)
+{
+  VLO_CREATE (tok_terms_vlo, grammar->alloc,
+	      YAEP_INIT_TOKENS_NUMBER * sizeof (int));
+  VLO_CREATE (tok_attrs_vlo, grammar->alloc, 0);
+}
+
+/* Initialize work with tokens. */
+static void
+tok_init (void)
+{
+  VLO_NULLIFY (tok_terms_vlo);
+  VLO_NULLIFY (tok_attrs_vlo);
+  tok_terms = YAEP_STATIC_CAST(int *, VLO_BEGIN (tok_terms_vlo));
+  tok_term_symbs = YAEP_STATIC_CAST(struct symb **,
+				    VLO_BEGIN (symbs_ptr->terms_vlo));
+  toks_len = 0;
+  tok_attrs = NULL;
+  n_tok_attrs = 0;
+}
+
+/* Set up attributes ATTRS of the last N input tokens.  Attributes of
+   the previous tokens without attributes become NULL. */
+static void
+tok_add_attrs (int n, void *const *attrs)
+{
+  void **vec;
+
+  VLO_EXPAND (tok_attrs_vlo,
+	      YAEP_STATIC_CAST(size_t, toks_len - n_tok_attrs) * sizeof (void *));
+  vec = YAEP_STATIC_CAST(void **, VLO_BEGIN (tok_attrs_vlo));
+  memset (vec + n_tok_attrs, 0,
+	  YAEP_STATIC_CAST(size_t, toks_len - n - n_tok_attrs) * sizeof (void *));
+  memcpy (vec + toks_len - n, attrs, YAEP_STATIC_CAST(size_t, n) * sizeof (void *));
+  tok_attrs = vec;
+  n_tok_attrs = toks_len;
+}
+
+/* Add input token with CODE and attribute at the end of input tokens
+  array.  Return 0 on success, otherwise YAEP error code. */
+static int
+tok_add (int code, void *attr)
+{
+  struct symb *symb;
+  int term_num;
+
+  symb = symb_find_by_code (code);
+  if (symb == NULL)
+    return yaep_set_error (grammar, YAEP_INVALID_TOKEN_CODE,
+			    "invalid token code %d", code);
+
+  term_num = symb->u.term.term_num;
+  VLO_ADD_MEMORY (tok_terms_vlo, &term_num, sizeof (int));
+  tok_terms = YAEP_STATIC_CAST(int *, VLO_BEGIN (tok_terms_vlo));
+  toks_len++;
+  if (attr != NULL)
+    tok_add_attrs (1, &attr);
+  if (fuzz_debug_p ())
+    {
+      fprintf (stderr, "YAEP_DEBUG_TOK_ADD code=%d attr=%p symb=%p tok_terms=%p toks_len=%d\n",
+               code, attr, YAEP_STATIC_CAST(void *, symb), YAEP_STATIC_CAST(void *, tok_terms), toks_len);
+      fflush (stderr);
       /* Detect ASan-poisoned pointer pattern (0xbebebebebebebebe) early and
          print a backtrace to help locate the corruption site. */
       {
@@ -1695,7 +2669,7 @@ tok_add (int code, void *attr)
           }
       }
       /* Verify the symbol pointer is one of those recorded in symbs_vlo.
-         This detects cases where a bad pointer gets stored in toks[].symb
+         This detects cases where a bad pointer gets translated into a token
          even if it doesn't match the exact ASan poison pattern. */
       {
   size_t n_symbs = VLO_NELS (symbs_ptr->symbs_vlo, struct symb *);
@@ -1714,8 +2688,8 @@ tok_add (int code, void *attr)
           {
             void *bt[32];
             int n = backtrace (bt, sizeof (bt) / sizeof (bt[0]));
-            fprintf (stderr, "YAEP_DEBUG_SYMB_NOT_IN_VLO symb=%p toks=%p toks_len=%d n_symbs=%zu\n",
-                     YAEP_STATIC_CAST(void *, symb), YAEP_STATIC_CAST(void *, toks), toks_len, n_symbs);
+            fprintf (stderr, "YAEP_DEBUG_SYMB_NOT_IN_VLO symb=%p tok_terms=%p toks_len=%d n_symbs=%zu\n",
+                     YAEP_STATIC_CAST(void *, symb), YAEP_STATIC_CAST(void *, tok_terms), toks_len, n_symbs);
             backtrace_symbols_fd (bt, n, STDERR_FILENO);
             fflush (stderr);
             abort ();
@@ -1725,11 +2699,71 @@ tok_add (int code, void *attr)
   return 0;
 }
 
+/* Add N input tokens with CODES at the end of input tokens array.
+   The codes are translated into terminal numbers by one pass without
+   attributes.  A negative code is invalid because the end marker
+   code is negative and the end marker is added only by the parser.
+   Return 0 on success, otherwise YAEP error code. */
+static int
+tok_add_codes (int n, const int *codes)
+{
+  struct symb *symb;
+  int *new_terms;
+  int i;
+
+  VLO_EXPAND (tok_terms_vlo, YAEP_STATIC_CAST(size_t, n) * sizeof (int));
+  tok_terms = YAEP_STATIC_CAST(int *, VLO_BEGIN (tok_terms_vlo));
+  new_terms = tok_terms + toks_len;
+#ifdef SYMB_CODE_TRANS_VECT
+  if (symbs_ptr->symb_code_trans_vect != NULL)
+    {
+      struct symb **vect = symbs_ptr->symb_code_trans_vect;
+      int start = symbs_ptr->symb_code_trans_vect_start;
+      unsigned int len
+	= YAEP_STATIC_CAST(unsigned int,
+			   symbs_ptr->symb_code_trans_vect_end - start);
+      unsigned int ind;
+
+      for (i = 0; i < n; i++)
+	{
+	  ind = (YAEP_STATIC_CAST(unsigned int, codes[i])
+		 - YAEP_STATIC_CAST(unsigned int, start));
+	  if (codes[i] < 0 || ind >= len || (symb = vect[ind]) == NULL)
+	    break;
+	  new_terms[i] = symb->u.term.term_num;
+	}
+    }
+  else if (symbs_ptr->symb_code_slots != NULL)
+    for (i = 0; i < n; i++)
+      {
+	if (codes[i] < 0 || (symb = symb_code_hash_find (codes[i])) == NULL)
+	  break;
+	new_terms[i] = symb->u.term.term_num;
+      }
+  else
+#endif
+    for (i = 0; i < n; i++)
+      {
+	if (codes[i] < 0 || (symb = symb_find_by_code (codes[i])) == NULL)
+	  break;
+	new_terms[i] = symb->u.term.term_num;
+      }
+  if (i < n)
+    {
+      VLO_SHORTEN (tok_terms_vlo, YAEP_STATIC_CAST(size_t, n) * sizeof (int));
+      return yaep_set_error (grammar, YAEP_INVALID_TOKEN_CODE,
+			     "invalid token code %d", codes[i]);
+    }
+  toks_len += n;
+  return 0;
+}
+
 /* Finalize work with tokens. */
 static void
 tok_fin (void)
 {
-  VLO_DELETE (toks_vlo);
+  VLO_DELETE (tok_attrs_vlo);
+  VLO_DELETE (tok_terms_vlo);
 }
 
 
@@ -1767,28 +2801,20 @@ struct sit
 
 /* The following contains current number of unique situations.  It can
    be read externally. */
-static int n_all_sits;
+#define n_all_sits (curr_parser->x_n_all_sits)
 
 /* The following two dimensional array (the first dimension is context
    number, the second one is situation number) contains references to
    all possible situations. */
-static struct sit ***sit_table;
+#define sit_table (curr_parser->x_sit_table)
 
 /* The following vlo is indexed by situation context number and gives
    array which is indexed by situation number
    (sit->rule->rule_start_offset + sit->pos). */
-#ifndef __cplusplus
-static vlo_t sit_table_vlo;
-#else
-static vlo_t *sit_table_vlo;
-#endif
+#define sit_table_vlo (curr_parser->x_sit_table_vlo)
 
 /* All situations are placed in the following object. */
-#ifndef __cplusplus
-static os_t sits_os;
-#else
-static os_t *sits_os;
-#endif
+#define sits_os (curr_parser->x_sits_os)
 
 /* Initialize work with situations. */
 static void
@@ -1807,7 +2833,15 @@ static int
 sit_set_lookahead (struct sit *sit)
 {
   struct symb *symb, **symb_ptr;
+  int i;
 
+  if (grammar->lookahead_level == 1 && rules_ptr->sit_lookaheads != NULL)
+    {
+      /* Use the lookahead precomputed for the frozen grammar. */
+      i = sit->rule->rule_start_offset + sit->pos;
+      sit->lookahead = rules_ptr->sit_lookaheads[i];
+      return rules_ptr->sit_empty_tails[i];
+    }
   if (grammar->lookahead_level == 0)
     sit->lookahead = NULL;
   else
@@ -1885,10 +2919,18 @@ sit_create (struct rule *rule, int pos, int context)
     }
   if ((sit = (*context_sit_table_ptr)[rule->rule_start_offset + pos]) != NULL)
     return sit;
+  n_all_sits++;
+  if (rules_ptr->sits != NULL)
+    {
+      /* Use the situation of the frozen grammar. */
+      assert (context == 0);
+      sit = &rules_ptr->sits[rule->rule_start_offset + pos];
+      (*context_sit_table_ptr)[rule->rule_start_offset + pos] = sit;
+      return sit;
+    }
   OS_TOP_EXPAND (sits_os, sizeof (struct sit));
   sit = YAEP_STATIC_CAST(struct sit *, OS_TOP_BEGIN (sits_os));
   OS_TOP_FINISH (sits_os);
-  n_all_sits++;
   sit->rule = rule;
   sit->pos = YAEP_STATIC_CAST(short, pos);
   sit->sit_number = n_all_sits;
@@ -1935,6 +2977,16 @@ sits_hash (int n_sits, struct sit **sits)
   return result;
 }
 
+/* Remove all situations. */
+static void
+sit_empty (void)
+{
+  n_all_sits = 0;
+  OS_EMPTY (sits_os);
+  VLO_NULLIFY (sit_table_vlo);
+  sit_table = YAEP_STATIC_CAST(struct sit ***, VLO_BEGIN (sit_table_vlo));
+}
+
 /* Finalize work with situations. */
 static void
 sit_fin (void)
@@ -1982,6 +3034,13 @@ struct set_core
      which distance of (nonstart noninitial) situation with given
      index (between n_start_situations -> n_all_dists) is taken. */
   int *parent_indexes;
+#ifndef USE_CORE_SYMB_HASH_TABLE
+  /* The following is the core row of the table (set core, symbol) ->
+     core_symb_vect indexed by symbol number or NULL if there are no
+     core_symb_vects for the core yet (see core_symb_vect_find).  Only
+     the parser forming the core changes the row. */
+  struct core_symb_vect **symb_vects;
+#endif
 };
 
 /* The following describes set in Earley's algorithm. */
@@ -2020,93 +3079,107 @@ struct set_term_lookahead
   struct set *result[MAX_CACHED_GOTO_RESULTS];
   /* Corresponding places of the goto sets in the parsing list.  */
   int place[MAX_CACHED_GOTO_RESULTS];
+  /* Numbers of the parses in which the goto sets were saved.  The
+     places are meaningful only for the current parse.  */
+  int parse_num[MAX_CACHED_GOTO_RESULTS];
 };
 
 /* The following variable is set being created.  It can be read
    externally.  It is defined only when new_set_ready_p is TRUE. */
-static struct set *new_set;
+#define new_set (curr_parser->x_new_set)
 
 /* The following variable is always set core of set being created.  It
    can be read externally.  Member core of new_set has always the
    following value.  It is defined only when new_set_ready_p is TRUE. */
-static struct set_core *new_core;
+#define new_core (curr_parser->x_new_core)
 
 /* The following says that new_set, new_core and their members are
    defined.  Before this the access to data of the set being formed
    are possible only through the following variables. */
-static int new_set_ready_p;
+#define new_set_ready_p (curr_parser->x_new_set_ready_p)
 
 /* To optimize code we use the following variables to access to data
    of new set.  They are always defined and correspondingly
    situations, distances, and the current number of start situations
    of the set being formed. */
-static struct sit **new_sits;
-static int *new_dists;
-static int new_n_start_sits;
+#define new_sits (curr_parser->x_new_sits)
+#define new_dists (curr_parser->x_new_dists)
+#define new_n_start_sits (curr_parser->x_new_n_start_sits)
 
 /* The following are number of unique set cores and their start
    situations, unique distance vectors and their summary length, and
    number of parent indexes.  The variables can be read externally. */
-static int n_set_cores, n_set_core_start_sits;
-static int n_set_dists, n_set_dists_len, n_parent_indexes;
+#define n_set_cores (curr_parser->x_n_set_cores)
+#define n_set_core_start_sits (curr_parser->x_n_set_core_start_sits)
+#define n_set_dists (curr_parser->x_n_set_dists)
+#define n_set_dists_len (curr_parser->x_n_set_dists_len)
+#define n_parent_indexes (curr_parser->x_n_parent_indexes)
 
 /* Number unique sets and their start situations.  */
-static int n_sets, n_sets_start_sits;
+#define n_sets (curr_parser->x_n_sets)
+#define n_sets_start_sits (curr_parser->x_n_sets_start_sits)
 
 /* Number unique triples (set, term, lookahead).  */
-static int n_set_term_lookaheads;
+#define n_set_term_lookaheads (curr_parser->x_n_set_term_lookaheads)
 
 /* The set cores of formed sets are placed in the following os. */
-#ifndef __cplusplus
-static os_t set_cores_os;
-#else
-static os_t *set_cores_os;
-#endif
+#define set_cores_os (curr_parser->x_set_cores_os)
 
 /* The situations of formed sets are placed in the following os. */
-#ifndef __cplusplus
-static os_t set_sits_os;
-#else
-static os_t *set_sits_os;
-#endif
+#define set_sits_os (curr_parser->x_set_sits_os)
 
 /* The indexes of the parent start situations whose distances are used
    to get distances of some nonstart situations are placed in the
    following os. */
-#ifndef __cplusplus
-static os_t set_parent_indexes_os;
-#else
-static os_t *set_parent_indexes_os;
-#endif
+#define set_parent_indexes_os (curr_parser->x_set_parent_indexes_os)
 
 /* The distances of formed sets are placed in the following os. */
-#ifndef __cplusplus
-static os_t set_dists_os;
-#else
-static os_t *set_dists_os;
-#endif
+#define set_dists_os (curr_parser->x_set_dists_os)
 
 /* The sets themself are placed in the following os. */
-#ifndef __cplusplus
-static os_t sets_os;
-#else
-static os_t *sets_os;
-#endif
+#define sets_os (curr_parser->x_sets_os)
 
 /* Container for triples (set, term, lookahead.  */
-#ifndef __cplusplus
-static os_t set_term_lookahead_os;
-#else
-static os_t *set_term_lookahead_os;
-#endif
+#define set_term_lookahead_os (curr_parser->x_set_term_lookahead_os)
 
 /* The following 3 tables contain references for sets which refers
    for set cores or distances or both which are in the tables. */
-static hash_table_t set_core_tab;	/* key is only start situations. */
-static hash_table_t set_dists_tab;	/* key is distances. */
-static hash_table_t set_tab;	/* key is (core, distances). */
+#define set_core_tab (curr_parser->x_set_core_tab)	/* key is only start situations. */
+#define set_dists_tab (curr_parser->x_set_dists_tab)	/* key is distances. */
+#define set_tab (curr_parser->x_set_tab)	/* key is (core, distances). */
 /* Table for triples (set, term, lookahead).  */
-static hash_table_t set_term_lookahead_tab;	/* key is (core, distances, lookeahed). */
+#define set_term_lookahead_tab (curr_parser->x_set_term_lookahead_tab)	/* key is (core, distances, lookeahed). */
+
+/* The following is a snapshot of the shared memo of a frozen grammar
+   (see yaep_set_shared_memo_flag).  The snapshot tables are analogous
+   to the tables above but contain set cores, sets and triples (set,
+   term, lookahead) published by all parsers of the grammar.  The
+   tables and the objects in them are never changed after the
+   snapshot publication, so parsers search in them without locking.  A
+   parser looks for an object in the snapshot first and then in its
+   own parse cache. */
+struct shared_memo_snapshot
+{
+  /* The following is number of set cores in the snapshot. */
+  int n_cores;
+  /* The following is number of references to the snapshot from the
+     memo and parsers.  It is changed under the memo mutex. */
+  int n_refs;
+  HASH_TABLE_T (set_core_hash, set_core_eq) core_tab;
+  HASH_TABLE_T (dists_hash, dists_eq) dists_tab;
+  HASH_TABLE_T (set_core_dists_hash, set_core_dists_eq) sets_tab;
+  HASH_TABLE_T (set_term_lookahead_hash, set_term_lookahead_eq) goto_tab;
+};
+
+/* The following is the shared memo snapshot used by the current
+   parser or NULL. */
+#define memo_snapshot (curr_parser->x_memo_snapshot)
+
+/* The following macro returns element equal to EL from table TAB of
+   the shared memo snapshot used by the current parser or NULL. */
+#define shared_memo_find(tab, el)					\
+  (memo_snapshot == NULL						\
+   ? NULL : lookup_hash_table_entry (memo_snapshot->tab, el))
 
 /* Hash of set core. */
 static unsigned
@@ -2221,17 +3294,13 @@ set_term_lookahead_eq (hash_table_entry_t s1, hash_table_entry_t s2)
 
 /* This page contains code for table of pairs (sit, dist).  */
 
-#ifndef __cplusplus
 /* Vector implementing map: sit number -> vlo of the distance check
    indexed by the distance.  */
-static vlo_t sit_dist_vec_vlo;
-#else
-static vlo_t *sit_dist_vec_vlo;
-#endif
+#define sit_dist_vec_vlo (curr_parser->x_sit_dist_vec_vlo)
 
 /* The value used to check the validity of elements of check_dist
    structures.  */
-static int curr_sit_dist_vec_check;
+#define curr_sit_dist_vec_check (curr_parser->x_curr_sit_dist_vec_check)
 
 /* Initiate the set of pairs (sit, dist).  */
 static void
@@ -2248,6 +3317,22 @@ empty_sit_dist_set (void)
   curr_sit_dist_vec_check++;
 }
 
+/* Prepare the set for the current parse.  The set is kept in the
+   parse workspace, so the check values are cleared only when they
+   are close to overflow.  */
+static void
+sit_dist_set_parse_init (void)
+{
+  size_t i, len;
+
+  if (curr_sit_dist_vec_check < INT_MAX / 2)
+    return;
+  len = VLO_NELS (sit_dist_vec_vlo, vlo_t);
+  for (i = 0; i < len; i++)
+    VLO_NULLIFY (STATIC_CAST(vlo_t *, VLO_BEGIN (sit_dist_vec_vlo))[i]);
+  curr_sit_dist_vec_check = 0;
+}
+
 /* Insert pair (SIT, DIST) into the set.  If such pair exists return
    FALSE, otherwise return TRUE.  */
 static int
@@ -2267,15 +3352,9 @@ sit_dist_insert (struct sit *sit, int dist)
     {
       VLO_EXPAND (sit_dist_vec_vlo, YAEP_STATIC_CAST(size_t, sit_number + 1 - len) * sizeof (vlo_t));
       for (i = len; i <= sit_number; i++)
-#ifndef __cplusplus
 	VLO_CREATE (STATIC_CAST(vlo_t *, VLO_BEGIN (sit_dist_vec_vlo))[i],
 		    grammar->alloc, 64);
-#else
-	STATIC_CAST(vlo_t **, VLO_BEGIN (sit_dist_vec_vlo))[i] =
-	  new vlo (grammar->alloc, 64);
-#endif
     }
-#ifndef __cplusplus
   check_dist_vlo = &STATIC_CAST(vlo_t *, VLO_BEGIN (sit_dist_vec_vlo))[sit_number];
   {
     size_t _tmp_len = VLO_NELS (*check_dist_vlo, int);
@@ -2293,20 +3372,6 @@ sit_dist_insert (struct sit *sit, int dist)
     return FALSE;
   STATIC_CAST(int *, VLO_BEGIN (*check_dist_vlo))[dist] = curr_sit_dist_vec_check;
   return TRUE;
-#else
-  check_dist_vlo = STATIC_CAST(vlo_t **, VLO_BEGIN (sit_dist_vec_vlo))[sit_number];
-  len = YAEP_STATIC_CAST(int, check_dist_vlo->length () / sizeof (int));
-  if (len <= dist)
-    {
-      check_dist_vlo->expand (YAEP_STATIC_CAST(size_t, dist + 1 - len) * sizeof (int));
-      for (i = len; i <= dist; i++)
-	YAEP_STATIC_CAST(int *, check_dist_vlo->begin ())[i] = 0;
-    }
-  if (YAEP_STATIC_CAST(int *, check_dist_vlo->begin ())[dist] == curr_sit_dist_vec_check)
-    return FALSE;
-  YAEP_STATIC_CAST(int *, check_dist_vlo->begin ())[dist] = curr_sit_dist_vec_check;
-  return TRUE;
-#endif
 }
 
 /* Finish the set of pairs (sit, dist).  */
@@ -2317,38 +3382,95 @@ sit_dist_set_fin (void)
   size_t i, len = VLO_NELS (sit_dist_vec_vlo, vlo_t);
 
   for (i = 0; i < len; i++)
-#ifndef __cplusplus
     VLO_DELETE (STATIC_CAST(vlo_t *, VLO_BEGIN (sit_dist_vec_vlo))[i]);
-#else
-    delete STATIC_CAST(vlo_t **, VLO_BEGIN (sit_dist_vec_vlo))[i];
-#endif
   VLO_DELETE (sit_dist_vec_vlo);
 }
+
+
+
+/* This page contains code for marking situations and nonterminal
+   prediction closures added to the set being formed.  */
+
+/* The following vlos are indexed by situation number
+   (rule->rule_start_offset + pos) of situations with zero context
+   and by nonterminal number.  An element is equal to the following
+   value if the situation is already in the set being formed or the
+   prediction closure of the nonterminal is already added to it. */
+#define prediction_sit_check_vlo (curr_parser->x_prediction_sit_check_vlo)
+#define prediction_nonterm_check_vlo \
+  (curr_parser->x_prediction_nonterm_check_vlo)
+#define curr_prediction_check (curr_parser->x_curr_prediction_check)
+
+/* Initiate the marks.  They are kept in the parse workspace. */
+static void
+prediction_check_init (void)
+{
+  VLO_CREATE (prediction_sit_check_vlo, grammar->alloc, 0);
+  VLO_CREATE (prediction_nonterm_check_vlo, grammar->alloc, 0);
+  curr_prediction_check = 0;
+}
+
+/* Expand the vlo of marks VLO_PTR to contain N_ELS marks. */
+static void
+prediction_check_expand (vlo_t *vlo_ptr, size_t n_els)
+{
+  size_t i, len = VLO_NELS (*vlo_ptr, int);
+
+  if (len >= n_els)
+    return;
+  VLO_EXPAND (*vlo_ptr, (n_els - len) * sizeof (int));
+  for (i = len; i < n_els; i++)
+    YAEP_STATIC_CAST(int *, VLO_BEGIN (*vlo_ptr))[i] = 0;
+}
+
+/* Prepare the marks for the current parse.  The check values are
+   cleared only when they are close to overflow.  */
+static void
+prediction_check_parse_init (void)
+{
+  if (curr_prediction_check >= INT_MAX / 2)
+    {
+      VLO_NULLIFY (prediction_sit_check_vlo);
+      VLO_NULLIFY (prediction_nonterm_check_vlo);
+      curr_prediction_check = 0;
+    }
+  prediction_check_expand (&prediction_sit_check_vlo,
+			   YAEP_STATIC_CAST(size_t, rules_ptr->n_rhs_lens
+					    + rules_ptr->n_rules));
+  prediction_check_expand (&prediction_nonterm_check_vlo,
+			   symbs_ptr->n_nonterms);
+}
+
+/* Finalize work with the marks. */
+static void
+prediction_check_fin (void)
+{
+  VLO_DELETE (prediction_nonterm_check_vlo);
+  VLO_DELETE (prediction_sit_check_vlo);
+}
 
 
 
 #ifdef TRANSITIVE_TRANSITION
 /* The following varaibles are used for *using* transitive transition
    vectors to exclude multiple situation processing.  */
-static int curr_sit_check;
+#define curr_sit_check (curr_parser->x_curr_sit_check)
 
 /* The following varaibles are used for *building* transitive transition
    vectors:  */
 /*  The value is used to mark already processed symbols.  */
-static int core_symbol_check;
-#ifndef __cplusplus
+#define core_symbol_check (curr_parser->x_core_symbol_check)
 /* The first is used to check already processed symbols.  The second
    contains symbols to be processed.  The third is a queue used during
    building transitive transitions.  */
-static vlo_t core_symbol_check_vlo, core_symbols_vlo, core_symbol_queue_vlo;
-#else
-static vlo_t *core_symbol_check_vlo, *core_symbols_vlo,
-  *core_symbol_queue_vlo;
-#endif
+#define core_symbol_check_vlo (curr_parser->x_core_symbol_check_vlo)
+#define core_symbols_vlo (curr_parser->x_core_symbols_vlo)
+#define core_symbol_queue_vlo (curr_parser->x_core_symbol_queue_vlo)
 
 #endif
 
-/* Initialize work with sets for parsing input with N_TOKS tokens. */
+/* Initialize work with sets for parsing input with N_TOKS tokens.
+   The sets can be kept for subsequent parses in the parse cache. */
 static void
 set_init (int n_toks)
 {
@@ -2375,9 +3497,19 @@ set_init (int n_toks)
   n_set_dists = n_set_dists_len = n_parent_indexes = 0;
   n_sets = n_sets_start_sits = 0;
   n_set_term_lookaheads = 0;
-  sit_dist_set_init ();
 #ifdef TRANSITIVE_TRANSITION
   curr_sit_check = 0;
+#endif
+}
+
+/* Initialize data used for forming sets only during the current
+   parse. */
+static void
+set_parse_init (void)
+{
+  sit_dist_set_parse_init ();
+  prediction_check_parse_init ();
+#ifdef TRANSITIVE_TRANSITION
   VLO_CREATE (core_symbol_check_vlo, grammar->alloc, 0);
   VLO_CREATE (core_symbols_vlo, grammar->alloc, 0);
   VLO_CREATE (core_symbol_queue_vlo, grammar->alloc, 0);
@@ -2450,30 +3582,77 @@ set_add_new_nonstart_sit (struct sit *sit, int parent)
 }
 
 /* Add non-start (initial) SIT with zero distance at the end of the
-   situation array of the set being formed.  If this is non-start
-   situation and there is already the same pair (situation, zero
-   distance), we do not add it. */
+   situation array of the set being formed.  The caller guarantees
+   that the set has no non-start situation SIT yet (see
+   set_new_add_prediction). */
 #if MAKE_INLINE
 INLINE
 #endif
 static void
 set_new_add_initial_sit (struct sit *sit)
 {
-  int i;
-
   assert (new_set_ready_p);
-  /* When we add non-start situations we need to have pairs
-     (situation, the corresponding distance) without duplicates
-     because we also forms core_symb_vect at that time. */
-  for (i = new_n_start_sits; i < new_core->n_sits; i++)
-    if (new_sits[i] == sit)
-      return;
   /* Remember we do not store distance for non-start situations. */
   OS_TOP_ADD_MEMORY (set_sits_os, &sit, sizeof (struct sit *));
   new_sits = new_core->sits = YAEP_STATIC_CAST(struct sit **, OS_TOP_BEGIN (set_sits_os));
   new_core->n_sits++;
 }
 
+/* Mark all non-start situations with zero context of the set being
+   formed.  After that, the non-start situations are added only by
+   set_new_add_prediction. */
+static void
+set_new_mark_nonstart_sits (void)
+{
+  int i, *sit_checks;
+  struct sit *sit;
+
+  curr_prediction_check++;
+  sit_checks = YAEP_STATIC_CAST(int *, VLO_BEGIN (prediction_sit_check_vlo));
+  for (i = new_n_start_sits; i < new_core->n_sits; i++)
+    {
+      sit = new_sits[i];
+      if (sit->context == 0)
+	sit_checks[sit->rule->rule_start_offset + sit->pos]
+	  = curr_prediction_check;
+    }
+}
+
+/* Add the prediction closure of nonterminal SYMB after the dot to the
+   set being formed in one step.  The closure situations already in
+   the set and the closures of nonterminals predicted by the already
+   added closures are skipped. */
+#if MAKE_INLINE
+INLINE
+#endif
+static void
+set_new_add_prediction (struct symb *symb)
+{
+  int i, sit_ind, *sit_checks, *nonterm_checks;
+  struct rule *rule;
+
+  nonterm_checks
+    = YAEP_STATIC_CAST(int *, VLO_BEGIN (prediction_nonterm_check_vlo));
+  if (nonterm_checks[symb->u.nonterm.nonterm_num] == curr_prediction_check)
+    return;
+  sit_checks = YAEP_STATIC_CAST(int *, VLO_BEGIN (prediction_sit_check_vlo));
+  for (i = 0; i < symb->u.nonterm.n_predictions; i++)
+    {
+      sit_ind = symb->u.nonterm.predictions[i];
+      rule = rules_ptr->sit_rules[sit_ind];
+      if (sit_ind == rule->rule_start_offset)
+	/* The closure of the rule lhs is in the closure of SYMB. */
+	nonterm_checks[rule->lhs->u.nonterm.nonterm_num]
+	  = curr_prediction_check;
+      if (sit_checks[sit_ind] == curr_prediction_check)
+	continue;
+      sit_checks[sit_ind] = curr_prediction_check;
+      set_new_add_initial_sit (sit_create (rule,
+					   sit_ind - rule->rule_start_offset,
+					   0));
+    }
+}
+
 /* Set up hash of distances of set S. */
 static void
 setup_set_dists_hash (hash_table_entry_t s)
@@ -2510,7 +3689,7 @@ INLINE
 static int
 set_insert (void)
 {
-  hash_table_entry_t *entry;
+  hash_table_entry_t *entry, shared_entry;
   int result;
 
   OS_TOP_EXPAND (sets_os, sizeof (struct set));
@@ -2524,7 +3703,10 @@ set_insert (void)
 #if defined(USE_DIST_HASH_TABLE) || defined (USE_SET_HASH_TABLE)
   /* Insert dists into table. */
   setup_set_dists_hash (new_set);
-  entry = find_hash_table_entry (set_dists_tab, new_set, TRUE);
+  if ((shared_entry = shared_memo_find (dists_tab, new_set)) != NULL)
+    entry = &shared_entry;
+  else
+    entry = find_hash_table_entry (set_dists_tab, new_set, TRUE);
   if (*entry != NULL)
     {
       /* Read-only access to the stored set's dists; use const to make
@@ -2550,7 +3732,10 @@ set_insert (void)
 #endif
   /* Insert set core into table. */
   setup_set_core_hash (new_set);
-  entry = find_hash_table_entry (set_core_tab, new_set, TRUE);
+  if ((shared_entry = shared_memo_find (core_tab, new_set)) != NULL)
+    entry = &shared_entry;
+  else
+    entry = find_hash_table_entry (set_core_tab, new_set, TRUE);
   if (*entry != NULL)
     {
       OS_TOP_NULLIFY (set_cores_os);
@@ -2564,9 +3749,14 @@ set_insert (void)
     {
       OS_TOP_FINISH (set_cores_os);
       new_core->num = n_set_cores++;
+      if (memo_snapshot != NULL)
+	new_core->num += memo_snapshot->n_cores;
       new_core->n_sits = new_n_start_sits;
       new_core->n_all_dists = new_n_start_sits;
       new_core->parent_indexes = NULL;
+#ifndef USE_CORE_SYMB_HASH_TABLE
+      new_core->symb_vects = NULL;
+#endif
   /* See above: store owned mutable set in hash table. */
   /* See above: store owned mutable set in hash table. */
   *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, new_set));
@@ -2575,7 +3765,10 @@ set_insert (void)
     }
 #ifdef USE_SET_HASH_TABLE
   /* Insert set into table. */
-  entry = find_hash_table_entry (set_tab, new_set, TRUE);
+  if ((shared_entry = shared_memo_find (sets_tab, new_set)) != NULL)
+    entry = &shared_entry;
+  else
+    entry = find_hash_table_entry (set_tab, new_set, TRUE);
   if (*entry == NULL)
     {
   *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, new_set));
@@ -2668,16 +3861,44 @@ set_print (FILE * f, struct set *set, int set_dist, int nonstart_p,
 
 #endif /* #ifndef NO_YAEP_DEBUG_PRINT */
 
-/* Finalize work with sets. */
+/* Finalize data used for forming sets during the current parse. */
 static void
-set_fin (void)
+set_parse_fin (void)
 {
 #ifdef TRANSITIVE_TRANSITION
   VLO_DELETE (core_symbol_queue_vlo);
   VLO_DELETE (core_symbols_vlo);
   VLO_DELETE (core_symbol_check_vlo);
 #endif
-  sit_dist_set_fin ();
+}
+
+/* Remove all sets. */
+static void
+set_empty (void)
+{
+  empty_hash_table (set_term_lookahead_tab);
+  empty_hash_table (set_tab);
+  empty_hash_table (set_dists_tab);
+  empty_hash_table (set_core_tab);
+  OS_EMPTY (set_term_lookahead_os);
+  OS_EMPTY (sets_os);
+  OS_EMPTY (set_parent_indexes_os);
+  OS_EMPTY (set_sits_os);
+  OS_EMPTY (set_dists_os);
+  OS_EMPTY (set_cores_os);
+  n_set_cores = n_set_core_start_sits = 0;
+  n_set_dists = n_set_dists_len = n_parent_indexes = 0;
+  n_sets = n_sets_start_sits = 0;
+  n_set_term_lookaheads = 0;
+#ifdef TRANSITIVE_TRANSITION
+  curr_sit_check = 0;
+#endif
+}
+
+/* Finalize work with sets. */
+static void
+set_fin (void)
+{
   delete_hash_table (set_term_lookahead_tab);
   delete_hash_table (set_tab);
   delete_hash_table (set_dists_tab);
@@ -2697,55 +3918,167 @@ set_fin (void)
 /* The following two variables represents Earley's parser list.  The
    values of pl_curr and array *pl can be read and modified
    externally. */
-static struct set **pl;
-static int pl_curr;
+#define pl (curr_parser->x_pl)
+#define pl_curr (curr_parser->x_pl_curr)
+
+/* The following is number of elements allocated for pl. */
+#define pl_size (curr_parser->x_pl_size)
 
 /* Initialize work with the parser list. */
 static void
 pl_init (void)
 {
   pl = NULL;
+  pl_size = 0;
 }
 
-/* The following function creates Earley's parser list. */
+/* The following function makes pl big enough for the current number
+   of tokens.  Because of error recovery we may have sets 2 times more
+   than tokens. */
 static void
-pl_create (void)
+pl_expand (void)
 {
+  int size = (toks_len + 1) * 2;
   void *mem;
 
-  /* Because of error recovery we may have sets 2 times more than tokens. */
-  mem =
-    yaep_malloc (grammar->alloc, sizeof (struct set *) * YAEP_STATIC_CAST(size_t, toks_len + 1) * 2);
+  if (size <= pl_size)
+    return;
+  if (size < 2 * pl_size)
+    size = 2 * pl_size;
+  mem = yaep_realloc (grammar->alloc, pl,
+		      sizeof (struct set *) * YAEP_STATIC_CAST(size_t, size));
   pl = YAEP_STATIC_CAST(struct set **, mem);
-  pl_curr = -1;
-}
+  pl_size = size;
+}
+
+/* A Leo item of place K and symbol A exists if the set at place K
+   has only one situation with A after the dot and the situation is
+   `B -> x . A, M' where M < K.  So any completion of A at place K
+   results in completed situation `B -> x A ., M' whose completion
+   in its turn can be described by the Leo item of place M and symbol
+   B.  The chain of such items describes a deterministic reduction
+   path.  Only the topmost situation of the path is added to the set
+   where A is completed (see J. Leo, "A general context-free parsing
+   algorithm running in linear time on every LR(k) grammar without
+   using lookahead", 1991).  The other situations of the path are
+   restored only when the parse tree is built.  */
+struct leo_item
+{
+  /* The place and the symbol of the item.  */
+  int place;
+  struct symb *symb;
+  /* The completed situation and its origin.  The situation is NULL if
+     the reduction path of the symbol at the place is not
+     deterministic.  */
+  struct sit *sit;
+  int orig;
+  /* The next item of the path (NULL for the topmost item) and the
+     topmost item of the path.  */
+  struct leo_item *next, *top;
+  /* The next item of the same place.  */
+  struct leo_item *place_next;
+};
 
-/* Finalize work with the parser list. */
-static void
-pl_fin (void)
+/* The following structure describes usage of the Leo item instead of
+   the situations of its path in the set at the given place.  */
+struct leo_use
 {
-  if (pl != NULL)
-    {
-      yaep_free (grammar->alloc, pl);
-      pl = NULL;  /* Prevent double-free */
-    }
-}
-
+  int place;
+  struct leo_item *item;
+};
 
+/* The following is TRUE if the current parse uses Leo items.  Usage
+   of the items is switched off during error recovery.  */
+#define curr_leo_p (curr_parser->x_leo_p)
+#define leo_off_p (curr_parser->x_leo_off_p)
 
+/* All Leo items are allocated in the following os.  The vlo is
+   indexed by place and contains the first Leo item of the place.
+   The usages of the Leo items are stored in the second vlo in order
+   of their places.  */
+#define leo_items_os (curr_parser->x_leo_items_os)
+#define leo_items_vlo (curr_parser->x_leo_items_vlo)
+#define leo_uses_vlo (curr_parser->x_leo_uses_vlo)
 
-/* This page contains code for work with array of vlos.  It is used
-   only to implement abstract data `core_symb_vect'. */
+/* Numbers of the Leo items and their usages in the current parse.  */
+#define n_leo_items (curr_parser->x_n_leo_items)
+#define n_leo_uses (curr_parser->x_n_leo_uses)
 
-/* All vlos being formed are placed in the following object. */
-#ifndef __cplusplus
-static vlo_t vlo_array;
+/* Initialize work with Leo items. */
+static void
+leo_init (void)
+{
+  OS_CREATE (leo_items_os, grammar->alloc, 0);
+  VLO_CREATE (leo_items_vlo, grammar->alloc, 0);
+  VLO_CREATE (leo_uses_vlo, grammar->alloc, 0);
+  leo_off_p = FALSE;
+  n_leo_items = n_leo_uses = 0;
+}
+
+/* The following function removes Leo items and their usages for
+   places after LAST.  It is called when error recovery changes the
+   sets after LAST.  */
+static void
+leo_truncate (int last)
+{
+  size_t n = VLO_NELS (leo_items_vlo, struct leo_item *);
+
+  if (n > YAEP_STATIC_CAST(size_t, last + 1))
+    VLO_SHORTEN (leo_items_vlo, (n - YAEP_STATIC_CAST(size_t, last + 1))
+		 * sizeof (struct leo_item *));
+  while (VLO_LENGTH (leo_uses_vlo) != 0
+	 && (YAEP_STATIC_CAST(struct leo_use *, VLO_BOUND (leo_uses_vlo)))[-1].place > last)
+    VLO_SHORTEN (leo_uses_vlo, sizeof (struct leo_use));
+}
+
+/* Finalize work with Leo items. */
+static void
+leo_fin (void)
+{
+  VLO_DELETE (leo_uses_vlo);
+  VLO_DELETE (leo_items_vlo);
+  OS_DELETE (leo_items_os);
+}
+
+/* The following function creates Earley's parser list. */
+static void
+pl_create (void)
+{
+  pl_expand ();
+  pl_curr = -1;
+#ifndef TRANSITIVE_TRANSITION
+  curr_leo_p = (grammar->leo_p && grammar->lookahead_level <= 1
+		&& !curr_parser->forest_p && !curr_parser->sppf_p
+		&& !(grammar->cost_p && grammar->one_parse_p));
 #else
-static vlo_t *vlo_array;
+  curr_leo_p = FALSE;
 #endif
+  if (curr_leo_p)
+    leo_init ();
+}
+
+/* Finalize work with the parser list of the current parse. */
+static void
+pl_fin (void)
+{
+  if (curr_leo_p)
+    {
+      leo_fin ();
+      curr_leo_p = FALSE;
+    }
+}
+
+
+
+
+/* This page contains code for work with array of vlos.  It is used
+   only to implement abstract data `core_symb_vect'. */
+
+/* All vlos being formed are placed in the following object. */
+#define vlo_array (curr_parser->x_vlo_array)
 
 /* The following is current number of elements in vlo_array. */
-static int vlo_array_len;
+#define vlo_array_len (curr_parser->x_vlo_array_len)
 
 /* Initialize work with array of vlos. */
 #if MAKE_INLINE
@@ -2754,11 +4087,7 @@ INLINE
 static void
 vlo_array_init (void)
 {
-#ifndef __cplusplus
   VLO_CREATE (vlo_array, grammar->alloc, 4096);
-#else
-  vlo_array = new vlo (grammar->alloc, 4096);
-#endif
   vlo_array_len = 0;
 }
 
@@ -2770,7 +4099,6 @@ INLINE
 static int
 vlo_array_expand (void)
 {
-#ifndef __cplusplus
   vlo_t *vlo_ptr;
 
   if (YAEP_STATIC_CAST(size_t, vlo_array_len) >= VLO_NELS (vlo_array, vlo_t))
@@ -2784,21 +4112,6 @@ vlo_array_expand (void)
       vlo_ptr = &STATIC_CAST(vlo_t *, VLO_BEGIN (vlo_array))[vlo_array_len];
       VLO_NULLIFY (*vlo_ptr);
     }
-#else
-  vlo_t **vlo_ptr;
-
-  if (YAEP_STATIC_CAST(unsigned, vlo_array_len) >= vlo_array->length () / sizeof (vlo_t *))
-    {
-      vlo_array->expand (sizeof (vlo_t *));
-      vlo_ptr = &(YAEP_STATIC_CAST(vlo_t **, vlo_array->begin ()))[vlo_array_len];
-      *vlo_ptr = new vlo (grammar->alloc, 64);
-    }
-  else
-    {
-      vlo_ptr = &(YAEP_STATIC_CAST(vlo_t **, vlo_array->begin ()))[vlo_array_len];
-      (*vlo_ptr)->nullify ();
-    }
-#endif
   return vlo_array_len++;
 }
 
@@ -2820,11 +4133,7 @@ static vlo_t *
 vlo_array_el (int index)
 {
   assert (index >= 0 && vlo_array_len > index);
-#ifndef __cplusplus
   return &STATIC_CAST(vlo_t *, VLO_BEGIN (vlo_array))[index];
-#else
-  return (YAEP_STATIC_CAST(vlo_t **, vlo_array->begin ()))[index];
-#endif
 }
 
 /* Finalize work with array of vlos. */
@@ -2834,21 +4143,12 @@ INLINE
 static void
 vlo_array_fin (void)
 {
-#ifndef __cplusplus
   vlo_t *vlo_ptr;
 
   for (vlo_ptr = YAEP_STATIC_CAST(vlo_t *, VLO_BEGIN (vlo_array));
        YAEP_REINTERPRET_CAST(char *, vlo_ptr) < YAEP_REINTERPRET_CAST(char *, VLO_BOUND (vlo_array)); vlo_ptr++)
     VLO_DELETE (*vlo_ptr);
   VLO_DELETE (vlo_array);
-#else
-  vlo_t **vlo_ptr;
-
-  for (vlo_ptr = YAEP_REINTERPRET_CAST(vlo_t **, vlo_array->begin ());
-       YAEP_REINTERPRET_CAST(char *, vlo_ptr) < YAEP_REINTERPRET_CAST(char *, vlo_array->bound ()); vlo_ptr++)
-    delete *vlo_ptr;
-  delete vlo_array;
-#endif
 }
 
 
@@ -2907,72 +4207,49 @@ struct core_symb_vect
    unique (transitive) transition vectors and their summary length,
    and unique reduce vectors and their summary length.  The variables
    can be read externally. */
-static int n_core_symb_pairs, n_core_symb_vect_len;
-static int n_transition_vects, n_transition_vect_len;
+#define n_core_symb_pairs (curr_parser->x_n_core_symb_pairs)
+#define n_core_symb_vect_len (curr_parser->x_n_core_symb_vect_len)
+#define n_transition_vects (curr_parser->x_n_transition_vects)
+#define n_transition_vect_len (curr_parser->x_n_transition_vect_len)
 #ifdef TRANSITIVE_TRANSITION
-static int n_transitive_transition_vects, n_transitive_transition_vect_len;
+#define n_transitive_transition_vects (curr_parser->x_n_transitive_transition_vects)
+#define n_transitive_transition_vect_len (curr_parser->x_n_transitive_transition_vect_len)
 #endif
-static int n_reduce_vects, n_reduce_vect_len;
+#define n_reduce_vects (curr_parser->x_n_reduce_vects)
+#define n_reduce_vect_len (curr_parser->x_n_reduce_vect_len)
 
 /* All triples (set core, symbol, vect) are placed in the following
    object. */
-#ifndef __cplusplus
-static os_t core_symb_vect_os;
-#else
-static os_t *core_symb_vect_os;
-#endif
+#define core_symb_vect_os (curr_parser->x_core_symb_vect_os)
 
 /* Pointers to triples (set core, symbol, vect) being formed are
    placed in the following object. */
-#ifndef __cplusplus
-static vlo_t new_core_symb_vect_vlo;
-#else
-static vlo_t *new_core_symb_vect_vlo;
-#endif
+#define new_core_symb_vect_vlo (curr_parser->x_new_core_symb_vect_vlo)
 
 /* All elements of vectors in the table (see
    (transitive_)transition_els_tab and reduce_els_tab) are placed in
    the following os. */
-#ifndef __cplusplus
-static os_t vect_els_os;
-#else
-static os_t *vect_els_os;
-#endif
+#define vect_els_os (curr_parser->x_vect_els_os)
 
 #ifdef USE_CORE_SYMB_HASH_TABLE
-static hash_table_t core_symb_to_vect_tab;	/* key is set_core and symb. */
-#else
-/* The following two variables contains table (set core,
-   symbol)->core_symb_vect implemented as two dimensional array. */
-/* The following object contains pointers to the table rows for each
-   set core. */
-#ifndef __cplusplus
-static vlo_t core_symb_table_vlo;
-#else
-static vlo_t *core_symb_table_vlo;
-#endif
-
-/* The following is always start of the previous object. */
-static struct core_symb_vect ***core_symb_table;
-
-/* The following contains rows of the table.  The element in the rows
-   are indexed by symbol number. */
-#ifndef __cplusplus
-static os_t core_symb_tab_rows;
+#define core_symb_to_vect_tab (curr_parser->x_core_symb_to_vect_tab)	/* key is set_core and symb. */
 #else
-static os_t *core_symb_tab_rows;
-#endif
+/* The table (set core, symbol)->core_symb_vect is implemented as two
+   dimensional array whose rows are kept in the set cores (see member
+   symb_vects).  The following contains the rows.  The elements in
+   the rows are indexed by symbol number. */
+#define core_symb_tab_rows (curr_parser->x_core_symb_tab_rows)
 #endif
 
 /* The following tables contains references for core_symb_vect which
    (through (transitive) transitions and reduces correspondingly)
    refers for elements which are in the tables.  Sequence elements are
    stored in one exemplar to save memory. */
-static hash_table_t transition_els_tab;	/* key is elements. */
+#define transition_els_tab (curr_parser->x_transition_els_tab)	/* key is elements. */
 #ifdef TRANSITIVE_TRANSITION
-static hash_table_t transitive_transition_els_tab;	/* key is elements. */
+#define transitive_transition_els_tab (curr_parser->x_transitive_transition_els_tab)	/* key is elements. */
 #endif
-static hash_table_t reduce_els_tab;	/* key is elements. */
+#define reduce_els_tab (curr_parser->x_reduce_els_tab)	/* key is elements. */
 
 #ifdef USE_CORE_SYMB_HASH_TABLE
 /* Hash of core_symb_vect. */
@@ -3085,40 +4362,18 @@ reduce_els_eq (hash_table_entry_t t1, hash_table_entry_t t2)
 static void
 core_symb_vect_init (void)
 {
-#ifndef __cplusplus
   OS_CREATE (core_symb_vect_os, grammar->alloc, 0);
   VLO_CREATE (new_core_symb_vect_vlo, grammar->alloc, 0);
   OS_CREATE (vect_els_os, grammar->alloc, 0);
-#else
-  core_symb_vect_os = new os (grammar->alloc, 0);
-  new_core_symb_vect_vlo = new vlo (grammar->alloc, 0);
-  vect_els_os = new os (grammar->alloc, 0);
-#endif
   vlo_array_init ();
 #ifdef USE_CORE_SYMB_HASH_TABLE
-#ifndef __cplusplus
   core_symb_to_vect_tab =
     create_hash_table (grammar->alloc, 3000, core_symb_vect_hash,
 		       core_symb_vect_eq);
 #else
-  core_symb_to_vect_tab =
-    new hash_table (grammar->alloc, 3000, core_symb_vect_hash,
-		    core_symb_vect_eq);
-#endif
-#else
-#ifndef __cplusplus
-  VLO_CREATE (core_symb_table_vlo, grammar->alloc, 4096);
-  core_symb_table
-    = YAEP_STATIC_CAST(struct core_symb_vect ***, VLO_BEGIN (core_symb_table_vlo));
   OS_CREATE (core_symb_tab_rows, grammar->alloc, 8192);
-#else
-  core_symb_table_vlo = new vlo (grammar->alloc, 4096);
-  core_symb_table = YAEP_STATIC_CAST(struct core_symb_vect ***, core_symb_table_vlo->begin ());
-  core_symb_tab_rows = new os (grammar->alloc, 8192);
-#endif
 #endif
 
-#ifndef __cplusplus
   transition_els_tab =
     create_hash_table (grammar->alloc, 3000, transition_els_hash,
 		       transition_els_eq);
@@ -3129,18 +4384,6 @@ core_symb_vect_init (void)
 #endif
   reduce_els_tab =
     create_hash_table (grammar->alloc, 3000, reduce_els_hash, reduce_els_eq);
-#else
-  transition_els_tab =
-    new hash_table (grammar->alloc, 3000, transition_els_hash,
-		    transition_els_eq);
-#ifdef TRANSITIVE_TRANSITION
-  transitive_transition_els_tab =
-    new hash_table (grammar->alloc, 5000, transitive_transition_els_hash,
-		    transitive_transition_els_eq);
-#endif
-  reduce_els_tab =
-    new hash_table (grammar->alloc, 3000, reduce_els_hash, reduce_els_eq);
-#endif
   n_core_symb_pairs = n_core_symb_vect_len = 0;
   n_transition_vects = n_transition_vect_len = 0;
 #ifdef TRANSITIVE_TRANSITION
@@ -3161,89 +4404,43 @@ static struct core_symb_vect **
 core_symb_vect_addr_get (struct core_symb_vect *triple, int reserv_p)
 {
   struct core_symb_vect **result;
-
-  if (triple->symb->cached_core_symb_vect != NULL
-      && triple->symb->cached_core_symb_vect->set_core == triple->set_core)
-    return &triple->symb->cached_core_symb_vect;
-#ifndef __cplusplus
-  result = ((struct core_symb_vect **)
-	    find_hash_table_entry (core_symb_to_vect_tab, triple, reserv_p));
-#else
-  result = ((struct core_symb_vect **)
-	    core_symb_to_vect_tab->find_entry (triple, reserv_p));
-#endif
-  triple->symb->cached_core_symb_vect = *result;
+  struct core_symb_vect **cached = &cached_core_symb_vects[triple->symb->num];
+
+  if (*cached != NULL && (*cached)->set_core == triple->set_core)
+    return cached;
+  result = YAEP_REINTERPRET_CAST(struct core_symb_vect **,
+				  find_hash_table_entry (core_symb_to_vect_tab,
+							 triple, reserv_p));
+  *cached = *result;
   return result;
 }
 
 #else
 
 /* The following function returns entry in the table where pointer to
-   corresponding triple with SET_CORE and SYMB is placed. */
+   corresponding triple with SET_CORE and SYMB is placed.  The row of
+   the set core is created if it does not exist yet. */
 #if MAKE_INLINE
 INLINE
 #endif
 static struct core_symb_vect **
 core_symb_vect_addr_get (struct set_core *set_core, struct symb *symb)
 {
-  struct core_symb_vect ***core_symb_vect_ptr;
+  size_t i, n_symbs;
 
-  core_symb_vect_ptr = core_symb_table + set_core->num;
-#ifndef __cplusplus
-  if (YAEP_REINTERPRET_CAST(char *, core_symb_vect_ptr) >= YAEP_REINTERPRET_CAST(char *, VLO_BOUND (core_symb_table_vlo)))
-#else
-  if (YAEP_REINTERPRET_CAST(char *, core_symb_vect_ptr) >= YAEP_REINTERPRET_CAST(char *, core_symb_table_vlo->bound ()))
-#endif
+  if (set_core->symb_vects == NULL)
     {
-  struct core_symb_vect ***ptr, ***bound;
-  int diff;
-  size_t i;
-
-#ifndef __cplusplus
-      diff = YAEP_STATIC_CAST(int, (YAEP_REINTERPRET_CAST(char *, core_symb_vect_ptr)
-	      - YAEP_REINTERPRET_CAST(char *, VLO_BOUND (core_symb_table_vlo))));
-#else
-      diff = YAEP_STATIC_CAST(int, (YAEP_REINTERPRET_CAST(char *, core_symb_vect_ptr)
-	      - YAEP_REINTERPRET_CAST(char *, core_symb_table_vlo->bound ())));
-#endif
-      diff += YAEP_STATIC_CAST(int, sizeof (struct core_symb_vect **));
-      if (diff == YAEP_STATIC_CAST(int, sizeof (struct core_symb_vect **)))
-	diff *= 10;
-#ifndef __cplusplus
-  VLO_EXPAND (core_symb_table_vlo, YAEP_STATIC_CAST(size_t, diff));
-      core_symb_table
-	= YAEP_STATIC_CAST(struct core_symb_vect ***, VLO_BEGIN (core_symb_table_vlo));
-      core_symb_vect_ptr = core_symb_table + set_core->num;
-      bound = YAEP_STATIC_CAST(struct core_symb_vect ***, VLO_BOUND (core_symb_table_vlo));
-#else
-      core_symb_table_vlo->expand (YAEP_STATIC_CAST(size_t, diff));
-      core_symb_table
-	= YAEP_STATIC_CAST(struct core_symb_vect ***, core_symb_table_vlo->begin ());
-      core_symb_vect_ptr = core_symb_table + set_core->num;
-      bound = YAEP_STATIC_CAST(struct core_symb_vect ***, core_symb_table_vlo->bound ());
-#endif
-      ptr = bound - diff / YAEP_STATIC_CAST(int, sizeof (struct core_symb_vect **));
-      while (ptr < bound)
-	{
-#ifndef __cplusplus
-	  OS_TOP_EXPAND (core_symb_tab_rows,
-			 YAEP_STATIC_CAST(size_t, (symbs_ptr->n_terms + symbs_ptr->n_nonterms))
-			 * sizeof (struct core_symb_vect *));
-	  *ptr = OS_TOP_BEGIN (core_symb_tab_rows);
-	  OS_TOP_FINISH (core_symb_tab_rows);
-#else
-	  core_symb_tab_rows->top_expand
-	    (YAEP_STATIC_CAST(size_t, (symbs_ptr->n_terms + symbs_ptr->n_nonterms))
-	     * sizeof (struct core_symb_vect *));
-	  *ptr = YAEP_STATIC_CAST(struct core_symb_vect **, core_symb_tab_rows->top_begin ());
-	  core_symb_tab_rows->top_finish ();
-#endif
-    for (i = 0; i < symbs_ptr->n_terms + symbs_ptr->n_nonterms; i++)
-      (*ptr)[YAEP_STATIC_CAST(int, i)] = NULL;
-	  ptr++;
-	}
+      n_symbs = symbs_ptr->n_terms + symbs_ptr->n_nonterms;
+      OS_TOP_EXPAND (core_symb_tab_rows,
+		     n_symbs * sizeof (struct core_symb_vect *));
+      set_core->symb_vects
+	= YAEP_STATIC_CAST(struct core_symb_vect **,
+			   OS_TOP_BEGIN (core_symb_tab_rows));
+      OS_TOP_FINISH (core_symb_tab_rows);
+      for (i = 0; i < n_symbs; i++)
+	set_core->symb_vects[i] = NULL;
     }
-  return &(*core_symb_vect_ptr)[symb->num];
+  return &set_core->symb_vects[symb->num];
 }
 #endif
 
@@ -3262,7 +4459,9 @@ core_symb_vect_find (struct set_core *set_core, struct symb *symb)
   core_symb_vect.symb = symb;
   return *core_symb_vect_addr_get (&core_symb_vect, FALSE);
 #else
-  return *core_symb_vect_addr_get (set_core, symb);
+  /* Only read the row: the set core can be in the shared memo. */
+  return (set_core->symb_vects == NULL
+	  ? NULL : set_core->symb_vects[symb->num]);
 #endif
 }
 
@@ -3276,20 +4475,11 @@ core_symb_vect_new (struct set_core *set_core, struct symb *symb)
   vlo_t *vlo_ptr;
 
   /* Create table element. */
-#ifndef __cplusplus
   OS_TOP_EXPAND (core_symb_vect_os, sizeof (struct core_symb_vect));
   triple = (YAEP_STATIC_CAST(struct core_symb_vect *, OS_TOP_BEGIN (core_symb_vect_os)));
-#else
-  core_symb_vect_os->top_expand (sizeof (struct core_symb_vect));
-  triple = (YAEP_STATIC_CAST(struct core_symb_vect *, core_symb_vect_os->top_begin ()));
-#endif
   triple->set_core = set_core;
   triple->symb = symb;
-#ifndef __cplusplus
   OS_TOP_FINISH (core_symb_vect_os);
-#else
-  core_symb_vect_os->top_finish ();
-#endif
 
 #ifdef USE_CORE_SYMB_HASH_TABLE
   addr = core_symb_vect_addr_get (triple, TRUE);
@@ -3302,35 +4492,21 @@ core_symb_vect_new (struct set_core *set_core, struct symb *symb)
   triple->transitions.intern = vlo_array_expand ();
   vlo_ptr = vlo_array_el (triple->transitions.intern);
   triple->transitions.len = 0;
-#ifndef __cplusplus
   triple->transitions.els = YAEP_STATIC_CAST(int *, VLO_BEGIN (*vlo_ptr));
-#else
-  triple->transitions.els = YAEP_STATIC_CAST(int *, vlo_ptr->begin ());
-#endif
 
 #ifdef TRANSITIVE_TRANSITION
   triple->transitive_transitions.intern = vlo_array_expand ();
   vlo_ptr = vlo_array_el (triple->transitive_transitions.intern);
   triple->transitive_transitions.len = 0;
-#ifndef __cplusplus
   triple->transitive_transitions.els = YAEP_STATIC_CAST(int *, VLO_BEGIN (*vlo_ptr));
-#else
-  triple->transitive_transitions.els = YAEP_STATIC_CAST(int *, vlo_ptr->begin ());
-#endif
 #endif
 
   triple->reduces.intern = vlo_array_expand ();
   vlo_ptr = vlo_array_el (triple->reduces.intern);
   triple->reduces.len = 0;
-#ifndef __cplusplus
   triple->reduces.els = YAEP_STATIC_CAST(int *, VLO_BEGIN (*vlo_ptr));
   VLO_ADD_MEMORY (new_core_symb_vect_vlo, &triple,
 		  sizeof (struct core_symb_vect *));
-#else
-  triple->reduces.els = YAEP_STATIC_CAST(int *, vlo_ptr->begin ());
-  new_core_symb_vect_vlo->add_memory (&triple,
-				      sizeof (struct core_symb_vect *));
-#endif
   n_core_symb_pairs++;
   return triple;
 }
@@ -3343,13 +4519,8 @@ vect_new_add_el (struct vect *vec, int el)
 
   vec->len++;
   vlo_ptr = vlo_array_el (vec->intern);
-#ifndef __cplusplus
   VLO_ADD_MEMORY (*vlo_ptr, &el, sizeof (int));
   vec->els = YAEP_STATIC_CAST(int *, VLO_BEGIN (*vlo_ptr));
-#else
-  vlo_ptr->add_memory (&el, sizeof (int));
-  vec->els = YAEP_STATIC_CAST(int *, vlo_ptr->begin ());
-#endif
   n_core_symb_vect_len++;
 }
 
@@ -3388,7 +4559,7 @@ core_symb_vect_new_add_reduce_el (struct core_symb_vect *core_symb_vect,
 static void
 process_core_symb_vect_el (struct core_symb_vect *core_symb_vect,
 			   struct vect *vec,
-			   hash_table_t * tab, int *n_vects, int *n_vect_len)
+			   hash_table_t tab, int *n_vects, int *n_vect_len)
 {
   hash_table_entry_t *entry;
 
@@ -3396,11 +4567,7 @@ process_core_symb_vect_el (struct core_symb_vect *core_symb_vect,
     vec->els = NULL;
   else
     {
-#ifndef __cplusplus
-      entry = find_hash_table_entry (*tab, core_symb_vect, TRUE);
-#else
-      entry = (*tab)->find_entry (core_symb_vect, TRUE);
-#endif
+      entry = find_hash_table_entry (tab, core_symb_vect, TRUE);
       if (*entry != NULL)
     {
       /* Only reading the stored core_symb_vect vectors here; use a
@@ -3419,15 +4586,9 @@ process_core_symb_vect_el (struct core_symb_vect *core_symb_vect,
     /* core_symb_vect is allocated/owned here; cast through void*
        to satisfy the const-qualified hash_table_entry_t type. */
     *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, core_symb_vect));
-#ifndef __cplusplus
 	  OS_TOP_ADD_MEMORY (vect_els_os, vec->els, YAEP_STATIC_CAST(size_t, vec->len) * sizeof (int));
-	  vec->els = OS_TOP_BEGIN (vect_els_os);
+	  vec->els = YAEP_STATIC_CAST(int *, OS_TOP_BEGIN (vect_els_os));
 	  OS_TOP_FINISH (vect_els_os);
-#else
-	  vect_els_os->top_add_memory (vec->els, YAEP_STATIC_CAST(size_t, vec->len) * sizeof (int));
-	  vec->els = YAEP_STATIC_CAST(int *, vect_els_os->top_begin ());
-	  vect_els_os->top_finish ();
-#endif
 	  (*n_vects)++;
 	  *n_vect_len += vec->len;
 	}
@@ -3441,102 +4602,114 @@ core_symb_vect_new_all_stop (void)
 {
   struct core_symb_vect **triple_ptr;
 
-#ifndef __cplusplus
-  for (triple_ptr = VLO_BEGIN (new_core_symb_vect_vlo);
+  for (triple_ptr = YAEP_STATIC_CAST(struct core_symb_vect **,
+				     VLO_BEGIN (new_core_symb_vect_vlo));
        YAEP_REINTERPRET_CAST(char *, triple_ptr) < YAEP_REINTERPRET_CAST(char *, VLO_BOUND (new_core_symb_vect_vlo));
        triple_ptr++)
-#else
-  for (triple_ptr
-       = YAEP_STATIC_CAST(struct core_symb_vect **, new_core_symb_vect_vlo->begin ());
-       YAEP_REINTERPRET_CAST(char *, triple_ptr) < YAEP_REINTERPRET_CAST(char *, new_core_symb_vect_vlo->bound ());
-       triple_ptr++)
-#endif
     {
       process_core_symb_vect_el (*triple_ptr, &(*triple_ptr)->transitions,
-				 &transition_els_tab, &n_transition_vects,
+				 transition_els_tab, &n_transition_vects,
 				 &n_transition_vect_len);
 #ifdef TRANSITIVE_TRANSITION
       process_core_symb_vect_el
 	(*triple_ptr, &(*triple_ptr)->transitive_transitions,
-	 &transitive_transition_els_tab, &n_transitive_transition_vects,
+	 transitive_transition_els_tab, &n_transitive_transition_vects,
 	 &n_transitive_transition_vect_len);
 #endif
       process_core_symb_vect_el (*triple_ptr, &(*triple_ptr)->reduces,
-				 &reduce_els_tab, &n_reduce_vects,
+				 reduce_els_tab, &n_reduce_vects,
 				 &n_reduce_vect_len);
     }
   vlo_array_nullify ();
-#ifndef __cplusplus
   VLO_NULLIFY (new_core_symb_vect_vlo);
+}
+
+/* Remove all triples (set core, symbol, vector). */
+static void
+core_symb_vect_empty (void)
+{
+  empty_hash_table (transition_els_tab);
+#ifdef TRANSITIVE_TRANSITION
+  empty_hash_table (transitive_transition_els_tab);
+#endif
+  empty_hash_table (reduce_els_tab);
+#ifdef USE_CORE_SYMB_HASH_TABLE
+  empty_hash_table (core_symb_to_vect_tab);
 #else
-  new_core_symb_vect_vlo->nullify ();
+  OS_EMPTY (core_symb_tab_rows);
+#endif
+  vlo_array_nullify ();
+  OS_EMPTY (vect_els_os);
+  VLO_NULLIFY (new_core_symb_vect_vlo);
+  OS_EMPTY (core_symb_vect_os);
+  n_core_symb_pairs = n_core_symb_vect_len = 0;
+  n_transition_vects = n_transition_vect_len = 0;
+#ifdef TRANSITIVE_TRANSITION
+  n_transitive_transition_vects = n_transitive_transition_vect_len = 0;
 #endif
+  n_reduce_vects = n_reduce_vect_len = 0;
 }
 
 /* Finalize work with all triples (set core, symbol, vector). */
 static void
 core_symb_vect_fin (void)
 {
-#ifndef __cplusplus
   delete_hash_table (transition_els_tab);
 #ifdef TRANSITIVE_TRANSITION
   delete_hash_table (transitive_transition_els_tab);
 #endif
   delete_hash_table (reduce_els_tab);
-#else
-  delete transition_els_tab;
-#ifdef TRANSITIVE_TRANSITION
-  delete transitive_transition_els_tab;
-#endif
-  delete reduce_els_tab;
-#endif
 #ifdef USE_CORE_SYMB_HASH_TABLE
-#ifndef __cplusplus
   delete_hash_table (core_symb_to_vect_tab);
 #else
-  delete core_symb_to_vect_tab;
-#endif
-#else
-#ifndef __cplusplus
   OS_DELETE (core_symb_tab_rows);
-  VLO_DELETE (core_symb_table_vlo);
-#else
-  delete core_symb_tab_rows;
-  delete core_symb_table_vlo;
-#endif
 #endif
   vlo_array_fin ();
-#ifndef __cplusplus
   OS_DELETE (vect_els_os);
   VLO_DELETE (new_core_symb_vect_vlo);
   OS_DELETE (core_symb_vect_os);
-#else
-  delete vect_els_os;
-  delete new_core_symb_vect_vlo;
-  delete core_symb_vect_os;
-#endif
 }
 
 
 
+/* Errors occurred during parsing are recorded in the current parser
+   to avoid changing the grammar which can be shared by several
+   parsers.  Errors for the frozen grammar outside of a parser are
+   kept only in the thread error context. */
 static void
 yaep_update_error_context (struct grammar *g,
                            const yaep_error_context_t *ctx)
 {
+  int *error_code;
+  char *error_message;
+
   if (g == NULL || ctx == NULL)
     return;
 
-  g->error_code = ctx->error_code;
+  if (curr_parser != NULL && curr_parser->grammar == g)
+    {
+      error_code = &curr_parser->error_code;
+      error_message = curr_parser->error_message;
+    }
+  else if (g->frozen_p)
+    return;
+  else
+    {
+      error_code = &g->error_code;
+      error_message = g->error_message;
+    }
+
+  *error_code = ctx->error_code;
 
   if (ctx->error_message[0] == '\0')
     {
-      g->error_message[0] = '\0';
+      error_message[0] = '\0';
       return;
     }
 
-  strncpy (g->error_message, ctx->error_message,
+  strncpy (error_message, ctx->error_message,
            YAEP_MAX_ERROR_MESSAGE_LENGTH);
-  g->error_message[YAEP_MAX_ERROR_MESSAGE_LENGTH] = '\0';
+  error_message[YAEP_MAX_ERROR_MESSAGE_LENGTH] = '\0';
 }
 
 static void
@@ -3656,6 +4829,7 @@ yaep_create_grammar (void)
     }
 
   memset (g, 0, sizeof (*g));
+  pthread_mutex_init (&g->stats_mutex, NULL);
   g->alloc = allocator;
   g->undefined_p = TRUE;
   g->error_code = 0;
@@ -3665,6 +4839,8 @@ yaep_create_grammar (void)
   g->one_parse_p = 1;
   g->cost_p = 0;
   g->error_recovery_p = 1;
+  g->leo_p = 0;
+  g->recognition_p = 0;
   g->recovery_token_matches = DEFAULT_RECOVERY_TOKEN_MATCHES;
 
   grammar = g;
@@ -3727,7 +4903,10 @@ fail:
     }
 
   if (g != NULL)
-    yaep_free (allocator, g);
+    {
+      pthread_mutex_destroy (&g->stats_mutex);
+      yaep_free (allocator, g);
+    }
 
   grammar = NULL;
   yaep_alloc_seterr (allocator, previous_error_handler, previous_userptr);
@@ -3735,6 +4914,18 @@ fail:
   return NULL;
 }
 
+/* The following function unmaps the compiled grammar file of G (if
+   any). */
+static void
+compiled_image_unmap (struct grammar *g)
+{
+  if (g->compiled_image == NULL)
+    return;
+  munmap (g->compiled_image, g->compiled_image_size);
+  g->compiled_image = NULL;
+  g->compiled_image_size = 0;
+}
+
 /* The following function makes grammar empty. */
 static void
 yaep_empty_grammar (void)
@@ -3744,11 +4935,13 @@ yaep_empty_grammar (void)
       rule_empty (grammar->rules_ptr);
       term_set_empty (grammar->term_sets_ptr);
       symb_empty (grammar->symbs_ptr);
+      compiled_image_unmap (grammar);
     }
 }
 
 /* The function returns the last occurred error code for given
-   grammar. */
+   grammar.  For the frozen grammar it is the last error occurred in
+   the current thread. */
 #ifdef __cplusplus
 static
 #endif
@@ -3756,6 +4949,8 @@ int
 yaep_error_code (struct grammar *g)
 {
   assert (g != NULL);
+  if (g->frozen_p)
+    return yaep_get_error_context ()->error_code;
   return g->error_code;
 }
 
@@ -3768,9 +4963,31 @@ const char *
 yaep_error_message (struct grammar *g)
 {
   assert (g != NULL);
+  if (g->frozen_p)
+    return yaep_get_error_context ()->error_message;
   return g->error_message;
 }
 
+/* The function returns how the parsers of grammar G translate token
+   codes into terminals. */
+#ifdef __cplusplus
+static
+#endif
+enum yaep_code_translation
+yaep_code_translation_strategy (struct grammar *g)
+{
+  assert (g != NULL);
+  if (g->symbs_ptr == NULL || g->symbs_ptr->n_terms == 0)
+    return YAEP_CODE_TRANSLATION_NONE;
+#ifdef SYMB_CODE_TRANS_VECT
+  if (g->symbs_ptr->symb_code_trans_vect != NULL)
+    return YAEP_CODE_TRANSLATION_VECTOR;
+  if (g->symbs_ptr->symb_code_slots != NULL)
+    return YAEP_CODE_TRANSLATION_PERFECT_HASH;
+#endif
+  return YAEP_CODE_TRANSLATION_HASH_TABLE;
+}
+
 /* The following function creates sets FIRST and FOLLOW for all
    grammar nonterminals. */
 static void
@@ -3838,6 +5055,86 @@ create_first_follow_sets (void)
   while (changed_p);
 }
 
+/* The following function adds situation with number SIT_IND to the
+   prediction closure being formed on the top of the rules object
+   stack if it is not marked by CHECK in SIT_CHECKS yet.  *N is the
+   closure length. */
+static void
+prediction_closure_add (int sit_ind, int *sit_checks, int check, int *n)
+{
+  if (sit_checks[sit_ind] == check)
+    return;
+  sit_checks[sit_ind] = check;
+  OS_TOP_ADD_MEMORY (rules_ptr->rules_os, &sit_ind, sizeof (int));
+  (*n)++;
+}
+
+/* The following function creates the prediction closures of all
+   grammar nonterminals.  The closures are formed in the same order
+   as expand_new_start_set formed the situations one rule at a time,
+   so the set for one nonterminal after the dot is the same.  We
+   should have correct flags empty_p and the rule offsets here. */
+static void
+create_prediction_closures (void)
+{
+  struct symb *symb, *rhs_symb;
+  struct rule *rule;
+  int i, k, n, pos, sit_ind, n_sits;
+  int *sit_checks, *nonterm_checks;
+
+  n_sits = rules_ptr->n_rhs_lens + rules_ptr->n_rules;
+  OS_TOP_EXPAND (rules_ptr->rules_os,
+		 YAEP_STATIC_CAST(size_t, n_sits) * sizeof (struct rule *));
+  rules_ptr->sit_rules
+    = YAEP_STATIC_CAST(struct rule **, OS_TOP_BEGIN (rules_ptr->rules_os));
+  OS_TOP_FINISH (rules_ptr->rules_os);
+  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
+    for (pos = 0; pos <= rule->rhs_len; pos++)
+      rules_ptr->sit_rules[rule->rule_start_offset + pos] = rule;
+  sit_checks
+    = YAEP_STATIC_CAST(int *, yaep_malloc (grammar->alloc,
+					   YAEP_STATIC_CAST(size_t, n_sits)
+					   * sizeof (int)));
+  nonterm_checks
+    = YAEP_STATIC_CAST(int *, yaep_malloc (grammar->alloc,
+					   (symbs_ptr->n_nonterms + 1)
+					   * sizeof (int)));
+  memset (sit_checks, 0, YAEP_STATIC_CAST(size_t, n_sits) * sizeof (int));
+  memset (nonterm_checks, 0, (symbs_ptr->n_nonterms + 1) * sizeof (int));
+  for (i = 0; (symb = nonterm_get (i)) != NULL; i++)
+    {
+      /* Use the nonterminal order number + 1 as the check value. */
+      nonterm_checks[i] = i + 1;
+      n = 0;
+      for (rule = symb->u.nonterm.rules; rule != NULL; rule = rule->lhs_next)
+	prediction_closure_add (rule->rule_start_offset, sit_checks, i + 1, &n);
+      for (k = 0; k < n; k++)
+	{
+	  sit_ind = YAEP_STATIC_CAST(int *, OS_TOP_BEGIN (rules_ptr->rules_os))[k];
+	  rule = rules_ptr->sit_rules[sit_ind];
+	  if ((rhs_symb = rule->rhs[sit_ind - rule->rule_start_offset]) == NULL)
+	    continue;
+	  if (!rhs_symb->term_p
+	      && nonterm_checks[rhs_symb->u.nonterm.nonterm_num] != i + 1)
+	    {
+	      nonterm_checks[rhs_symb->u.nonterm.nonterm_num] = i + 1;
+	      for (rule = rhs_symb->u.nonterm.rules;
+		   rule != NULL; rule = rule->lhs_next)
+		prediction_closure_add (rule->rule_start_offset,
+					sit_checks, i + 1, &n);
+	    }
+	  if (rhs_symb->empty_p)
+	    prediction_closure_add (sit_ind + 1, sit_checks, i + 1, &n);
+	}
+      symb->u.nonterm.predictions
+	= YAEP_STATIC_CAST(int *, OS_TOP_BEGIN (rules_ptr->rules_os));
+      symb->u.nonterm.n_predictions = n;
+      OS_TOP_FINISH (rules_ptr->rules_os);
+    }
+  yaep_free (grammar->alloc, nonterm_checks);
+  yaep_free (grammar->alloc, sit_checks);
+}
+
 /* The following function sets up flags empty_p, access_p and
    derivation_p for all grammar symbols. */
 static void
@@ -4022,6 +5319,7 @@ check_grammar (int strict_p)
   
   /* We should have correct flags empty_p here. */
   create_first_follow_sets ();
+  create_prediction_closures ();
   
   return 0;  /* Validation successful */
 }
@@ -4051,8 +5349,13 @@ struct yaep_read_grammar_context
 
 struct yaep_parse_context
 {
-  struct grammar *grammar;
+  struct yaep_parser *parser;
+  /* The input is read by READ_FN or given by N_CODES tokens with
+     CODES and ATTRS if READ_FN is NULL. */
   int (*read_fn) (void **attr);
+  int n_codes;
+  const int *codes;
+  void *const *attrs;
   void (*error_fn) (int err_tok_num, void *err_tok_attr,
                     int start_ignored_tok_num, void *start_ignored_tok_attr,
                     int start_recovered_tok_num,
@@ -4062,7 +5365,6 @@ struct yaep_parse_context
   struct yaep_tree_node **root;
   int *ambiguous_p;
   int result;
-  int tok_init_p;
   int parse_init_p;
 };
 
@@ -4121,6 +5423,11 @@ yaep_read_grammar_internal (void *user)
   term_sets_ptr = grammar->term_sets_ptr;
   rules_ptr = grammar->rules_ptr;
 
+  if (grammar->frozen_p)
+    return yaep_set_error (grammar, YAEP_FROZEN_GRAMMAR,
+			   "grammar is frozen");
+  /* Parse caches formed for the previous grammar become invalid. */
+  grammar->generation++;
   if (!grammar->undefined_p)
     yaep_empty_grammar ();
   
@@ -4347,7 +5654,8 @@ yaep_read_grammar_internal (void *user)
 #endif
 
 /* The following functions set up parameter which affect parser work
-   and return the previous parameter value. */
+   and return the previous parameter value.  The parameters of the
+   frozen grammar are not changed. */
 
 #ifdef __cplusplus
 static
@@ -4359,6 +5667,8 @@ yaep_set_lookahead_level (struct grammar *g, int level)
 
   assert (g != NULL);
   old = g->lookahead_level;
+  if (g->frozen_p)
+    return old;
   g->lookahead_level = (level < 0 ? 0 : level > 2 ? 2 : level);
   return old;
 }
@@ -4373,6 +5683,8 @@ yaep_set_debug_level (struct grammar *g, int level)
 
   assert (g != NULL);
   old = g->debug_level;
+  if (g->frozen_p)
+    return old;
   g->debug_level = level;
   return old;
 }
@@ -4387,6 +5699,8 @@ yaep_set_one_parse_flag (struct grammar *g, int flag)
 
   assert (g != NULL);
   old = g->one_parse_p;
+  if (g->frozen_p)
+    return old;
   g->one_parse_p = flag;
   return old;
 }
@@ -4401,6 +5715,8 @@ yaep_set_cost_flag (struct grammar *g, int flag)
 
   assert (g != NULL);
   old = g->cost_p;
+  if (g->frozen_p)
+    return old;
   g->cost_p = flag;
   return old;
 }
@@ -4415,6 +5731,8 @@ yaep_set_error_recovery_flag (struct grammar *g, int flag)
 
   assert (g != NULL);
   old = g->error_recovery_p;
+  if (g->frozen_p)
+    return old;
   g->error_recovery_p = flag;
   return old;
 }
@@ -4429,2492 +5747,6336 @@ yaep_set_recovery_match (struct grammar *g, int n_toks)
 
   assert (g != NULL);
   old = g->recovery_token_matches;
+  if (g->frozen_p)
+    return old;
   g->recovery_token_matches = n_toks;
   return old;
 }
 
-/* The function initializes all internal data for parser for N_TOKS
-   tokens. */
-static void
-yaep_parse_init (int n_toks)
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_set_leo_flag (struct grammar *g, int flag)
 {
-  struct rule *rule;
+  int old;
 
-  sit_init ();
-  set_init (n_toks);
-  core_symb_vect_init ();
-#ifdef USE_CORE_SYMB_HASH_TABLE
-  {
-    int i;
-    struct symb *symb;
+  assert (g != NULL);
+  old = g->leo_p;
+  if (g->frozen_p)
+    return old;
+  g->leo_p = flag;
+  return old;
+}
 
-    for (i = 0; (symb = symb_get (i)) != NULL; i++)
-      symb->cached_core_symb_vect = NULL;
-  }
+#ifdef __cplusplus
+static
 #endif
-  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
-    rule->caller_anode = NULL;
+int
+yaep_set_recognition_flag (struct grammar *g, int flag)
+{
+  int old;
+
+  assert (g != NULL);
+  old = g->recognition_p;
+  if (g->frozen_p)
+    return old;
+  g->recognition_p = flag;
+  return old;
 }
 
-/* The function should be called the last (it frees all allocated
-   data for parser). */
-static void
-yaep_parse_fin (void)
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_set_shared_memo_flag (struct grammar *g, int flag)
 {
-  core_symb_vect_fin ();
-  set_fin ();
-  sit_fin ();
-}
+  int old;
 
-/* The following function reads all input tokens and returns 0 on success. */
-static int
-read_toks (void)
-{
-  int code;
-  void *attr;
-
-  while ((code = read_token (&attr)) >= 0)
-    {
-      int err = tok_add (code, attr);
-      if (err != 0)
-        return err;
-    }
-  return tok_add (END_MARKER_CODE, NULL);
+  assert (g != NULL);
+  old = g->shared_memo_p;
+  if (g->frozen_p)
+    return old;
+  g->shared_memo_p = flag;
+  return old;
 }
 
-/* The following function add start situations which is formed from
-   given start situation SIT with distance DIST by reducing symbol
-   which can derivate empty string and which is placed after dot in
-   given situation.  The function returns TRUE if the dot is placed on
-   the last position in given situation or in the added situations. */
-#if MAKE_INLINE
-INLINE
+#ifdef __cplusplus
+static
 #endif
-static void
-add_derived_nonstart_sits (struct sit *sit, int parent)
+int
+yaep_set_lr0_automaton_flag (struct grammar *g, int flag)
 {
-  struct symb *symb;
-  struct rule *rule = sit->rule;
-  int context = sit->context;
-  int i;
+  int old;
 
-  for (i = sit->pos; (symb = rule->rhs[i]) != NULL && symb->empty_p; i++)
-    set_add_new_nonstart_sit (sit_create (rule, i + 1, context), parent);
+  assert (g != NULL);
+  old = g->lr0_automaton_p;
+  if (g->frozen_p)
+    return old;
+  g->lr0_automaton_p = flag;
+  return old;
 }
 
-#ifdef TRANSITIVE_TRANSITION
-/* Collect all symbols before the dot in new situations in
-   CORE_SYMBOL_VLO.  */
-static void
-collect_core_symbols (void)
+/* The following function freezes grammar G.  After that the grammar
+   is never changed and any number of parsers (e.g. in different
+   threads) can use it simultaneously without locking.  Without
+   dynamic lookaheads, the function also creates all situations with
+   their lookaheads, so parsers do not create them, and the shared
+   memo with the LR(0) automaton if they are requested.  The function
+   returns the error code. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_freeze_grammar (struct grammar *g)
 {
-  size_t i;
-  int *core_symbol_check_vec = YAEP_STATIC_CAST(int *, VLO_BEGIN (core_symbol_check_vlo));
-  struct symb *symb;
-  struct sit *sit;
+  struct rule *rule;
+  struct sit sit;
+  struct sit *sits;
+  term_set_el_t **lookaheads;
+  char *empty_tails;
+  int i, pos, n_sits;
+#ifdef USE_SHARED_MEMO
+  int code;
+#endif
 
-  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_core->n_sits); i++)
+  assert (g != NULL);
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  if (g->frozen_p)
+    return 0;
+  grammar = g;
+  yaep_copy_error_to_grammar (grammar);
+  if (grammar->undefined_p)
+    return yaep_set_error
+      (grammar, YAEP_UNDEFINED_OR_BAD_GRAMMAR, "undefined or bad grammar");
+  symbs_ptr = grammar->symbs_ptr;
+  term_sets_ptr = grammar->term_sets_ptr;
+  rules_ptr = grammar->rules_ptr;
+  if (grammar->lookahead_level <= 1)
     {
-      sit = new_sits[i];
-      if (sit->pos >= sit->rule->rhs_len)
-	continue;
-      /* There is a symbol after dot in the situation. */
-      symb = sit->rule->rhs[sit->pos];
-      if (core_symbol_check_vec[symb->num] == core_symbol_check
-	  || symb == grammar->term_error)
-	continue;
-      core_symbol_check_vec[symb->num] = core_symbol_check;
-      VLO_ADD_MEMORY (core_symbols_vlo, &symb, sizeof (symb));
-    }
+      n_sits = rules_ptr->n_rhs_lens + rules_ptr->n_rules;
+      lookaheads = NULL;
+      empty_tails = NULL;
+      if (grammar->lookahead_level == 1)
+	{
+	  OS_TOP_EXPAND (rules_ptr->rules_os,
+			 YAEP_STATIC_CAST(size_t, n_sits)
+			 * sizeof (term_set_el_t *));
+	  lookaheads = YAEP_STATIC_CAST(term_set_el_t **,
+					OS_TOP_BEGIN (rules_ptr->rules_os));
+	  OS_TOP_FINISH (rules_ptr->rules_os);
+	  OS_TOP_EXPAND (rules_ptr->rules_os, YAEP_STATIC_CAST(size_t, n_sits));
+	  empty_tails = YAEP_STATIC_CAST(char *,
+					 OS_TOP_BEGIN (rules_ptr->rules_os));
+	  OS_TOP_FINISH (rules_ptr->rules_os);
+	}
+      OS_TOP_EXPAND (rules_ptr->rules_os,
+		     YAEP_STATIC_CAST(size_t, n_sits) * sizeof (struct sit));
+      sits = YAEP_STATIC_CAST(struct sit *, OS_TOP_BEGIN (rules_ptr->rules_os));
+      OS_TOP_FINISH (rules_ptr->rules_os);
+      sit.context = 0;
+      for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
+	for (pos = 0; pos <= rule->rhs_len; pos++)
+	  {
+	    sit.rule = rule;
+	    sit.pos = YAEP_STATIC_CAST(short, pos);
+	    i = rule->rule_start_offset + pos;
+	    sit.sit_number = i + 1;
+	    sit.empty_tail_p = YAEP_STATIC_CAST(char, sit_set_lookahead (&sit));
+#ifdef TRANSITIVE_TRANSITION
+	    sit.sit_check = 0;
+#endif
+	    if (grammar->lookahead_level == 1)
+	      {
+		empty_tails[i] = sit.empty_tail_p;
+		lookaheads[i] = sit.lookahead;
+	      }
+	    sits[i] = sit;
+	  }
+      rules_ptr->sit_lookaheads = lookaheads;
+      rules_ptr->sit_empty_tails = empty_tails;
+#ifndef TRANSITIVE_TRANSITION
+      /* The transitive transitions mark situations during parsing, so
+	 the situations can not be shared by parsers in this case. */
+      rules_ptr->sits = sits;
+#endif
+    }
+#ifdef USE_SHARED_MEMO
+  if ((grammar->shared_memo_p || grammar->lr0_automaton_p)
+      && rules_ptr->sits != NULL
+      && ((code = shared_memo_create ()) != 0
+	  || (grammar->lr0_automaton_p
+	      && (code = lr0_automaton_create ()) != 0)))
+    return code;
+#endif
+  grammar->frozen_p = TRUE;
+  return 0;
 }
 
-/* Create transitive transition vectors for the new situations.
-   Transition vectors should be already created.  */
+
+
+
+
+/* This page contains functions saving the grammar into a compiled
+   grammar file and loading the grammar from it.  The file contains
+   the grammar after checking it, i.e. the symbols with their flags,
+   the rules with their translations, FIRST and FOLLOW sets of the
+   nonterminals and the terminal code translation vector, so loading
+   the grammar does not repeat the grammar description parsing and
+   the fixed point computations.  All references in the file are
+   numbers of symbols or offsets from the file start, so the file is
+   position independent.  The file is loaded by mapping it into memory
+   read-only; symbol and abstract node names, translation orders, and
+   FIRST/FOLLOW sets are used right from the mapped file, so processes
+   loading the same file share its page cache copy.  The file can be
+   loaded only on a machine with the same byte order and the same
+   sizes of int and terminal set elements. */
+
+/* The file starts with the following magic and contains the following
+   format version. */
+#define COMPILED_GRAMMAR_MAGIC "YAEPCGR"
+#define COMPILED_GRAMMAR_VERSION 1
+
+/* The following value is used to check the byte order. */
+#define COMPILED_GRAMMAR_BYTE_ORDER 0x01020304
+
+/* The maximal number of nil translations in a rule of the compiled
+   grammar file.  It bounds memory allocated for abstract nodes of a
+   loaded grammar. */
+#define COMPILED_GRAMMAR_MAX_NILS 1024
+
+/* The following is header of the compiled grammar file.  The offsets
+   of the file sections are multiple of 8. */
+struct compiled_grammar_header
+{
+  char magic[8];
+  int version, byte_order, int_size, term_set_el_size;
+  /* Numbers of terminals, nonterminals, rules, and sum of the rule
+     rhs lengths. */
+  int n_terms, n_nonterms, n_rules, n_rhs_lens;
+  /* Numbers of the axiom, the end marker and the error symbols. */
+  int axiom, end_marker, term_error;
+  /* Size of a terminal set in bytes. */
+  int term_set_size;
+  /* The first code and the length of the translation vector (zero if
+     it is not used). */
+  int trans_vect_start, trans_vect_len;
+  /* Size of the file and offsets of the sections: the symbols (struct
+     compiled_symb in the order of symbol numbers), the rules (struct
+     compiled_rule in the order of rule numbers), numbers of rhs
+     symbols of all rules (int), translation orders of all rules
+     (int), FIRST and FOLLOW sets of all nonterminals, the translation
+     vector (terminal numbers or -1), and zero terminated strings. */
+  uint64_t file_size, symbs_offset, rules_offset, rhs_offset;
+  uint64_t order_offset, term_sets_offset, trans_vect_offset;
+  uint64_t strings_offset, strings_size;
+};
+
+/* The following describes symbol in the compiled grammar file. */
+struct compiled_symb
+{
+  /* Offset of the name in the strings section. */
+  int repr;
+  /* Code of the terminal or loop flag of the nonterminal. */
+  int code, loop_p;
+  char term_p, access_p, derivation_p, empty_p;
+};
+
+/* The following describes rule in the compiled grammar file. */
+struct compiled_rule
+{
+  /* The lhs symbol number, offset of the abstract node name in the
+     strings section (or -1 if there is no abstract node). */
+  int lhs, rhs_len, anode, anode_cost, trans_len;
+};
+
+/* The following function adds zero bytes to IMAGE to make its length
+   multiple of 8. */
 static void
-form_transitive_transition_vectors (void)
+compiled_image_align (vlo_t *image)
 {
-  size_t i, j, k;
-  int sit_ind;
-  struct symb *symb, *new_symb;
-  struct sit *sit;
-  struct core_symb_vect *core_symb_vect, *symb_core_symb_vect;
+  static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  size_t len = VLO_LENGTH (*image) % 8;
 
-  core_symbol_check++;
-  expand_int_vlo (&core_symbol_check_vlo,
-		  symbs_ptr->n_terms + symbs_ptr->n_nonterms);
-  VLO_NULLIFY (core_symbols_vlo);
-  collect_core_symbols ();
-  for (i = 0; i < VLO_NELS (core_symbols_vlo, struct symb *); i++)
-    {
-      symb = STATIC_CAST(struct symb **, VLO_BEGIN (core_symbols_vlo))[i];
-      core_symb_vect = core_symb_vect_find (new_core, symb);
-      if (core_symb_vect == NULL)
-	core_symb_vect = core_symb_vect_new (new_core, symb);
-      core_symbol_check++;
-      VLO_NULLIFY (core_symbol_queue_vlo);
-      /* Put the symbol into the queue.  */
-  VLO_ADD_MEMORY (core_symbol_queue_vlo, &symb, sizeof (symb));
-  for (j = 0;
-   j < VLO_NELS (core_symbol_queue_vlo, struct symb *);
-   j++)
-	{
-	  symb = STATIC_CAST(struct symb **, VLO_BEGIN (core_symbol_queue_vlo))[j];
-	  symb_core_symb_vect = core_symb_vect_find (new_core, symb);
-	  if (symb_core_symb_vect == NULL)
-	    continue;
-      for (k = 0; k < symb_core_symb_vect->transitions.len; k++)
-	    {
- 	      sit_ind = symb_core_symb_vect->transitions.els[k];
- 	      /* sit_ind comes from a vector of ints but may originate from
- 	         size_t indices; ensure any upstream size_t->int conversions
- 	         were checked.  Pass through as-is (sit_ind is already int). */
- 	      core_symb_vect_new_add_transitive_transition_el (core_symb_vect,
- 			       sit_ind);
-	      if (sit_ind < new_core->n_all_dists)
-		/* This situation is originated from other sets --
-		   stop.  */
-		continue;
-    sit = new_sits[sit_ind];
-    /* sit_ind is an int here; sit_create expects int parameters. */
-    sit = sit_create (sit->rule, sit->pos + 1, sit->context);
-	      if (sit->empty_tail_p)
-		{
-		  new_symb = sit->rule->lhs;
-		  if (STATIC_CAST(int *, VLO_BEGIN (core_symbol_check_vlo))[new_symb->
-								  num] !=
-		      core_symbol_check)
-		    {
-		      /* Put the LHS symbol into queue.  */
-		      VLO_ADD_MEMORY (core_symbol_queue_vlo,
-				      &new_symb, sizeof (new_symb));
-		      STATIC_CAST(int *, VLO_BEGIN (core_symbol_check_vlo))[new_symb->
-								  num] =
-			core_symbol_check;
-		    }
-		}
-	    }
-	}
-    }
+  if (len != 0)
+    VLO_ADD_MEMORY (*image, zeros, 8 - len);
 }
-#endif
 
-/* The following function adds the rest (non-start) situations to the
-   new set and and forms triples (set core, symbol, indexes) for
-   further fast search of start situations from given core by
-   transition on given symbol (see comment for abstract data
-   `core_symb_vect'). */
-#if MAKE_INLINE
-INLINE
+/* The following function saves the grammar G into compiled grammar
+   file with name PATH.  The function returns the error code. */
+#ifdef __cplusplus
+static
 #endif
-static void
-expand_new_start_set (void)
+int
+yaep_save_compiled_grammar (struct grammar *g, const char *path)
 {
-  struct sit *sit;
+  struct compiled_grammar_header header;
+  struct compiled_symb csymb;
+  struct compiled_rule crule;
   struct symb *symb;
-  struct core_symb_vect *core_symb_vect;
   struct rule *rule;
-  size_t i;
-  size_t _tmp_i;
+  FILE *f;
+  size_t len;
+  int i, j, n_symbs, code;
+  vlo_t image, strings;
 
-  /* Add non start situations with nonzero distances. */
-  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_n_start_sits); i++)
-    {
-      _tmp_i = i;
-      assert (_tmp_i <= YAEP_STATIC_CAST(size_t, INT_MAX));
-      add_derived_nonstart_sits (new_sits[i], YAEP_STATIC_CAST(int, _tmp_i));
-    }
-  /* Add non start situations and form transitions vectors. */
-  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_core->n_sits); i++)
+  assert (g != NULL);
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  grammar = g;
+  yaep_copy_error_to_grammar (grammar);
+  if (grammar->undefined_p)
+    return yaep_set_error
+      (grammar, YAEP_UNDEFINED_OR_BAD_GRAMMAR, "undefined or bad grammar");
+  symbs_ptr = grammar->symbs_ptr;
+  term_sets_ptr = grammar->term_sets_ptr;
+  rules_ptr = grammar->rules_ptr;
+  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
+    if (rule->trans_len > rule->rhs_len + COMPILED_GRAMMAR_MAX_NILS)
+      return yaep_set_error
+	(grammar, YAEP_INCORRECT_TRANSLATION,
+	 "too many nil translations in rule for `%s'", rule->lhs->repr);
+  VLO_CREATE (image, grammar->alloc, 4096);
+  VLO_CREATE (strings, grammar->alloc, 4096);
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, COMPILED_GRAMMAR_MAGIC, sizeof (header.magic));
+  header.version = COMPILED_GRAMMAR_VERSION;
+  header.byte_order = COMPILED_GRAMMAR_BYTE_ORDER;
+  header.int_size = sizeof (int);
+  header.term_set_el_size = sizeof (term_set_el_t);
+  header.n_terms = YAEP_STATIC_CAST(int, symbs_ptr->n_terms);
+  header.n_nonterms = YAEP_STATIC_CAST(int, symbs_ptr->n_nonterms);
+  header.n_rules = rules_ptr->n_rules;
+  header.n_rhs_lens = rules_ptr->n_rhs_lens;
+  header.axiom = grammar->axiom->num;
+  header.end_marker = grammar->end_marker->num;
+  header.term_error = grammar->term_error->num;
+  header.term_set_size
+    = YAEP_STATIC_CAST(int, (symbs_ptr->n_terms + CHAR_BIT * 8 - 1)
+		       / (CHAR_BIT * 8) * 8);
+  VLO_ADD_MEMORY (image, &header, sizeof (header));
+  compiled_image_align (&image);
+  n_symbs = header.n_terms + header.n_nonterms;
+  header.symbs_offset = VLO_LENGTH (image);
+  for (i = 0; i < n_symbs; i++)
+    {
+      symb = symb_get (i);
+      memset (&csymb, 0, sizeof (csymb));
+      csymb.repr = YAEP_STATIC_CAST(int, VLO_LENGTH (strings));
+      VLO_ADD_MEMORY (strings, symb->repr, strlen (symb->repr) + 1);
+      csymb.code = symb->term_p ? symb->u.term.code : 0;
+      csymb.loop_p = symb->term_p ? 0 : symb->u.nonterm.loop_p;
+      csymb.term_p = symb->term_p;
+      csymb.access_p = symb->access_p;
+      csymb.derivation_p = symb->derivation_p;
+      csymb.empty_p = symb->empty_p;
+      VLO_ADD_MEMORY (image, &csymb, sizeof (csymb));
+    }
+  compiled_image_align (&image);
+  header.rules_offset = VLO_LENGTH (image);
+  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
     {
-      sit = new_sits[i];
-      if (sit->pos < sit->rule->rhs_len)
+      crule.lhs = rule->lhs->num;
+      crule.rhs_len = rule->rhs_len;
+      if (rule->anode == NULL)
+	crule.anode = -1;
+      else
 	{
-	  /* There is a symbol after dot in the situation. */
-	  symb = sit->rule->rhs[sit->pos];
-	  core_symb_vect = core_symb_vect_find (new_core, symb);
-	  if (core_symb_vect == NULL)
-	    {
-	      core_symb_vect = core_symb_vect_new (new_core, symb);
-	      if (!symb->term_p)
-		for (rule = symb->u.nonterm.rules;
-		     rule != NULL; rule = rule->lhs_next)
-		  set_new_add_initial_sit (sit_create (rule, 0, 0));
-	    }
-  _tmp_i = i;
-  assert (_tmp_i <= YAEP_STATIC_CAST(size_t, INT_MAX));
-  core_symb_vect_new_add_transition_el (core_symb_vect, YAEP_STATIC_CAST(int, _tmp_i));
-      if (symb->empty_p && i >= YAEP_STATIC_CAST(size_t, new_core->n_all_dists))
-        set_new_add_initial_sit (sit_create (sit->rule, sit->pos + 1, 0));
+	  crule.anode = YAEP_STATIC_CAST(int, VLO_LENGTH (strings));
+	  VLO_ADD_MEMORY (strings, rule->anode, strlen (rule->anode) + 1);
 	}
+      crule.anode_cost = rule->anode_cost;
+      crule.trans_len = rule->trans_len;
+      VLO_ADD_MEMORY (image, &crule, sizeof (crule));
     }
-  /* Now forming reduce vectors. */
-  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_core->n_sits); i++)
+  compiled_image_align (&image);
+  header.rhs_offset = VLO_LENGTH (image);
+  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
+    for (j = 0; j < rule->rhs_len; j++)
+      VLO_ADD_MEMORY (image, &rule->rhs[j]->num, sizeof (int));
+  compiled_image_align (&image);
+  header.order_offset = VLO_LENGTH (image);
+  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
+    VLO_ADD_MEMORY (image, rule->order,
+		    YAEP_STATIC_CAST(size_t, rule->rhs_len) * sizeof (int));
+  compiled_image_align (&image);
+  header.term_sets_offset = VLO_LENGTH (image);
+  for (i = 0; (symb = nonterm_get (i)) != NULL; i++)
     {
-      sit = new_sits[i];
-      if (sit->pos == sit->rule->rhs_len)
+      VLO_ADD_MEMORY (image, symb->u.nonterm.first,
+		      YAEP_STATIC_CAST(size_t, header.term_set_size));
+      VLO_ADD_MEMORY (image, symb->u.nonterm.follow,
+		      YAEP_STATIC_CAST(size_t, header.term_set_size));
+    }
+  compiled_image_align (&image);
+  header.trans_vect_offset = VLO_LENGTH (image);
+#ifdef SYMB_CODE_TRANS_VECT
+  if (symbs_ptr->symb_code_trans_vect != NULL)
+    {
+      header.trans_vect_start = symbs_ptr->symb_code_trans_vect_start;
+      header.trans_vect_len = (symbs_ptr->symb_code_trans_vect_end
+			       - symbs_ptr->symb_code_trans_vect_start);
+      for (i = 0; i < header.trans_vect_len; i++)
 	{
-	  symb = sit->rule->lhs;
-	  core_symb_vect = core_symb_vect_find (new_core, symb);
-	  if (core_symb_vect == NULL)
-	    core_symb_vect = core_symb_vect_new (new_core, symb);
-      _tmp_i = i;
-      assert (_tmp_i <= YAEP_STATIC_CAST(size_t, INT_MAX));
-      core_symb_vect_new_add_reduce_el (core_symb_vect, YAEP_STATIC_CAST(int, _tmp_i));
+	  symb = symbs_ptr->symb_code_trans_vect[i];
+	  code = symb == NULL ? -1 : symb->u.term.term_num;
+	  VLO_ADD_MEMORY (image, &code, sizeof (int));
 	}
+      compiled_image_align (&image);
+    }
+#endif
+  header.strings_offset = VLO_LENGTH (image);
+  header.strings_size = VLO_LENGTH (strings);
+  VLO_ADD_MEMORY (image, VLO_BEGIN (strings), VLO_LENGTH (strings));
+  compiled_image_align (&image);
+  header.file_size = VLO_LENGTH (image);
+  memcpy (VLO_BEGIN (image), &header, sizeof (header));
+  len = 0;
+  if ((f = fopen (path, "wb")) != NULL)
+    {
+      len = fwrite (VLO_BEGIN (image), 1, VLO_LENGTH (image), f);
+      if (fclose (f) != 0)
+	len = 0;
+    }
+  code = 0;
+  if (len != VLO_LENGTH (image))
+    code = yaep_set_error (grammar, YAEP_COMPILED_GRAMMAR_IO_ERROR,
+			   "can not write compiled grammar file `%s'", path);
+  VLO_DELETE (strings);
+  VLO_DELETE (image);
+  return code;
+}
+
+/* The following function adds symbol SYMB loaded from the compiled
+   grammar file to the symbol tables.  It returns the new symbol or
+   NULL if a symbol with the same name or code already exists. */
+static struct symb *
+symb_add_compiled (struct symb *symb)
+{
+  struct symb *result;
+  hash_table_entry_t *repr_entry, *code_entry = NULL;
+
+  repr_entry = find_hash_table_entry (symbs_ptr->repr_to_symb_tab, symb, TRUE);
+  if (*repr_entry != NULL)
+    return NULL;
+  if (symb->term_p)
+    {
+      code_entry = find_hash_table_entry (symbs_ptr->code_to_symb_tab,
+					  symb, TRUE);
+      if (*code_entry != NULL)
+	return NULL;
     }
-#ifdef TRANSITIVE_TRANSITION
-  form_transitive_transition_vectors ();
-#endif
-  if (grammar->lookahead_level > 1)
+  OS_TOP_ADD_MEMORY (symbs_ptr->symbs_os, symb, sizeof (struct symb));
+  result = YAEP_STATIC_CAST(struct symb *, OS_TOP_BEGIN (symbs_ptr->symbs_os));
+  OS_TOP_FINISH (symbs_ptr->symbs_os);
+  *repr_entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, result));
+  VLO_ADD_MEMORY (symbs_ptr->symbs_vlo, &result, sizeof (struct symb *));
+  if (symb->term_p)
     {
-      struct sit *new_sit, *shifted_sit;
-      term_set_el_t *context_set;
-  int changed_p, sit_ind, context; ptrdiff_t j;
-
-      /* Now we have incorrect initial situations because their
-         context is not correct. */
-      context_set = term_set_create ();
-      do
-	{
-	  changed_p = FALSE;
-  for (i = YAEP_STATIC_CAST(size_t, new_core->n_all_dists);
-       i < YAEP_STATIC_CAST(size_t, new_core->n_sits);
-       i++)
-	    {
-	      term_set_clear (context_set);
-	      new_sit = new_sits[i];
-	      core_symb_vect = core_symb_vect_find (new_core,
-						    new_sit->rule->lhs);
-	      for (j = 0; j < core_symb_vect->transitions.len; j++)
-		{
-		  sit_ind = core_symb_vect->transitions.els[j];
-		  sit = new_sits[sit_ind];
-		  shifted_sit = sit_create (sit->rule, sit->pos + 1,
-					    sit->context);
-		  term_set_or (context_set, shifted_sit->lookahead);
-		}
-	      context = term_set_insert (context_set);
-	      if (context >= 0)
-		context_set = term_set_create ();
-	      else
-		context = -context - 1;
-	      sit = sit_create (new_sit->rule, new_sit->pos, context);
-	      if (sit != new_sit)
-		{
-		  new_sits[i] = sit;
-		  changed_p = TRUE;
-		}
-	    }
-	}
-      while (changed_p);
+      *code_entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, result));
+      VLO_ADD_MEMORY (symbs_ptr->terms_vlo, &result, sizeof (struct symb *));
     }
-  set_new_core_stop ();
-  core_symb_vect_new_all_stop ();
+  else
+    VLO_ADD_MEMORY (symbs_ptr->nonterms_vlo, &result, sizeof (struct symb *));
+  return result;
 }
 
-/* The following function forms the 1st set. */
-static void
-build_start_set (void)
+/* The following function returns TRUE if the section of N_ELS
+   elements of EL_SIZE bytes at OFFSET is inside the compiled grammar
+   file described by HEADER. */
+static int
+compiled_section_p (const struct compiled_grammar_header *header,
+		    uint64_t offset, size_t n_els, size_t el_size)
+{
+  return (offset % 8 == 0 && offset <= header->file_size
+	  && (el_size == 0
+	      || n_els <= (header->file_size - offset) / el_size));
+}
+
+/* The following function checks the header of the compiled grammar
+   file of SIZE bytes.  It returns error message or NULL if the header
+   is ok. */
+static const char *
+compiled_header_check (const struct compiled_grammar_header *header,
+		       size_t size)
+{
+  size_t n_symbs;
+
+  if (size < sizeof (struct compiled_grammar_header)
+      || memcmp (header->magic, COMPILED_GRAMMAR_MAGIC,
+		 sizeof (header->magic)) != 0)
+    return "it is not a compiled grammar file";
+  if (header->version != COMPILED_GRAMMAR_VERSION)
+    return "unsupported compiled grammar version";
+  if (header->byte_order != COMPILED_GRAMMAR_BYTE_ORDER
+      || header->int_size != sizeof (int)
+      || header->term_set_el_size != sizeof (term_set_el_t))
+    return "compiled grammar for another machine";
+  if (header->file_size != size
+      || header->n_terms <= 0 || header->n_nonterms <= 0
+      || header->n_rules <= 0 || header->n_rhs_lens < 0
+      || header->term_set_size
+      != (header->n_terms + CHAR_BIT * 8 - 1) / (CHAR_BIT * 8) * 8
+      || header->trans_vect_len < 0)
+    return "corrupted compiled grammar file";
+  n_symbs = (YAEP_STATIC_CAST(size_t, header->n_terms)
+	     + YAEP_STATIC_CAST(size_t, header->n_nonterms));
+  if (!compiled_section_p (header, header->symbs_offset, n_symbs,
+			   sizeof (struct compiled_symb))
+      || !compiled_section_p (header, header->rules_offset,
+			      YAEP_STATIC_CAST(size_t, header->n_rules),
+			      sizeof (struct compiled_rule))
+      || !compiled_section_p (header, header->rhs_offset,
+			      YAEP_STATIC_CAST(size_t, header->n_rhs_lens),
+			      sizeof (int))
+      || !compiled_section_p (header, header->order_offset,
+			      YAEP_STATIC_CAST(size_t, header->n_rhs_lens),
+			      sizeof (int))
+      || !compiled_section_p (header, header->term_sets_offset,
+			      2 * YAEP_STATIC_CAST(size_t, header->n_nonterms),
+			      YAEP_STATIC_CAST(size_t, header->term_set_size))
+      || !compiled_section_p (header, header->trans_vect_offset,
+			      YAEP_STATIC_CAST(size_t, header->trans_vect_len),
+			      sizeof (int))
+      || !compiled_section_p (header, header->strings_offset,
+			      YAEP_STATIC_CAST(size_t, header->strings_size), 1)
+      || header->strings_size == 0)
+    return "corrupted compiled grammar file";
+  return NULL;
+}
+
+/* The following function forms the grammar from the compiled grammar
+   file IMAGE.  MARKS is used to check that translation positions of
+   a rule are different.  It returns error message or NULL if the file
+   is ok. */
+static const char *
+compiled_grammar_form (char *image, vlo_t *marks)
 {
+  const struct compiled_grammar_header *header;
+  const struct compiled_symb *csymbs;
+  const struct compiled_rule *crules;
+  const int *rhs, *trans_vect;
+  int *order;
+  const char *strings;
+  struct symb symb, *lhs;
   struct rule *rule;
-  struct sit *sit;
-  term_set_el_t *context_set;
-  int context;
-
-  set_new_start ();
-  if (grammar->lookahead_level <= 1)
-    context = 0;
-  else
-    {
-      context_set = term_set_create ();
-      term_set_clear (context_set);
-      context = term_set_insert (context_set);
-      /* Empty context in the table has always number zero. */
-      assert (context == 0);
-    }
-  for (rule = grammar->axiom->u.nonterm.rules;
-       rule != NULL; rule = rule->lhs_next)
-    {
-      sit = sit_create (rule, 0, context);
-      set_new_add_start_sit (sit, 0);
-    }
-  if (!set_insert ())
-    assert (FALSE);
-  expand_new_start_set ();
-  pl[0] = new_set;
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
-    {
-      fprintf (stderr, "\nParsing start...\n");
-      if (grammar->debug_level > 3)
-	set_print (stderr, new_set, 0, grammar->debug_level > 4,
-		   grammar->debug_level > 5);
+  int i, j, n_symbs, offset;
+
+  header = YAEP_REINTERPRET_CAST(const struct compiled_grammar_header *, image);
+  csymbs = YAEP_REINTERPRET_CAST(const struct compiled_symb *,
+				 image + header->symbs_offset);
+  crules = YAEP_REINTERPRET_CAST(const struct compiled_rule *,
+				 image + header->rules_offset);
+  rhs = YAEP_REINTERPRET_CAST(const int *, image + header->rhs_offset);
+  order = YAEP_REINTERPRET_CAST(int *, image + header->order_offset);
+  trans_vect = YAEP_REINTERPRET_CAST(const int *,
+				     image + header->trans_vect_offset);
+  strings = image + header->strings_offset;
+  if (strings[header->strings_size - 1] != '\0')
+    return "corrupted compiled grammar file";
+  n_symbs = header->n_terms + header->n_nonterms;
+  for (i = 0; i < n_symbs; i++)
+    {
+      if (csymbs[i].repr < 0
+	  || YAEP_STATIC_CAST(uint64_t, csymbs[i].repr) >= header->strings_size
+	  || YAEP_STATIC_CAST(unsigned, csymbs[i].term_p) > 1
+	  || YAEP_STATIC_CAST(unsigned, csymbs[i].access_p) > 1
+	  || YAEP_STATIC_CAST(unsigned, csymbs[i].derivation_p) > 1
+	  || YAEP_STATIC_CAST(unsigned, csymbs[i].empty_p) > 1
+	  || YAEP_STATIC_CAST(unsigned, csymbs[i].loop_p) > 1
+	  || (csymbs[i].term_p && (csymbs[i].empty_p || csymbs[i].loop_p)))
+	return "corrupted compiled grammar file";
+      memset (&symb, 0, sizeof (symb));
+      symb.repr = strings + csymbs[i].repr;
+      symb.term_p = csymbs[i].term_p;
+      symb.access_p = csymbs[i].access_p;
+      symb.derivation_p = csymbs[i].derivation_p;
+      symb.empty_p = csymbs[i].empty_p;
+      symb.num = i;
+      if (symb.term_p)
+	{
+	  symb.u.term.code = csymbs[i].code;
+	  symb.u.term.term_num = YAEP_STATIC_CAST(int, symbs_ptr->n_terms++);
+	  symbs_ptr->n_term_set_els = TERM_SET_N_ELS (symbs_ptr->n_terms);
+	  if (symbs_ptr->n_terms > YAEP_STATIC_CAST(size_t, header->n_terms))
+	    return "corrupted compiled grammar file";
+	}
+      else
+	{
+	  symb.u.nonterm.nonterm_num
+	    = YAEP_STATIC_CAST(int, symbs_ptr->n_nonterms++);
+	  if (symbs_ptr->n_nonterms > YAEP_STATIC_CAST(size_t, header->n_nonterms))
+	    return "corrupted compiled grammar file";
+	  symb.u.nonterm.loop_p = csymbs[i].loop_p;
+	  symb.u.nonterm.first
+	    = YAEP_REINTERPRET_CAST(term_set_el_t *,
+				    image + header->term_sets_offset
+				    + (2 * YAEP_STATIC_CAST(size_t, symb.u.nonterm.nonterm_num)
+				       * YAEP_STATIC_CAST(size_t, header->term_set_size)));
+	  symb.u.nonterm.follow
+	    = symb.u.nonterm.first + header->term_set_size / YAEP_STATIC_CAST(int, sizeof (term_set_el_t));
+	}
+      if (symb_add_compiled (&symb) == NULL)
+	return "corrupted compiled grammar file";
+    }
+  grammar->axiom = symb_get (header->axiom);
+  grammar->end_marker = symb_get (header->end_marker);
+  grammar->term_error = symb_get (header->term_error);
+  if (grammar->axiom == NULL || grammar->axiom->term_p
+      || grammar->end_marker == NULL || !grammar->end_marker->term_p
+      || grammar->term_error == NULL || !grammar->term_error->term_p)
+    return "corrupted compiled grammar file";
+  grammar->term_error_num = grammar->term_error->u.term.term_num;
+  for (offset = i = 0; i < header->n_rules; i++)
+    {
+      lhs = symb_get (crules[i].lhs);
+      if (lhs == NULL || lhs->term_p || crules[i].rhs_len < 0
+	  || crules[i].rhs_len > header->n_rhs_lens - offset
+	  || crules[i].trans_len < 0
+	  || crules[i].trans_len > crules[i].rhs_len + COMPILED_GRAMMAR_MAX_NILS
+	  /* A rule without abstract node is translated into nil or
+	     into translation of one rhs symbol. */
+	  || (crules[i].anode < 0 && crules[i].trans_len > 1)
+	  || (i == 0 && lhs != grammar->axiom)
+	  || (crules[i].anode >= 0
+	      && YAEP_STATIC_CAST(uint64_t, crules[i].anode) >= header->strings_size))
+	return "corrupted compiled grammar file";
+      OS_TOP_EXPAND (rules_ptr->rules_os, sizeof (struct rule));
+      rule = YAEP_STATIC_CAST(struct rule *, OS_TOP_BEGIN (rules_ptr->rules_os));
+      OS_TOP_FINISH (rules_ptr->rules_os);
+      OS_TOP_EXPAND (rules_ptr->rules_os,
+		     YAEP_STATIC_CAST(size_t, crules[i].rhs_len + 1)
+		     * sizeof (struct symb *));
+      rule->rhs = YAEP_STATIC_CAST(struct symb **, OS_TOP_BEGIN (rules_ptr->rules_os));
+      OS_TOP_FINISH (rules_ptr->rules_os);
+      expand_int_vlo (marks, crules[i].trans_len);
+      for (j = 0; j < crules[i].rhs_len; j++)
+	{
+	  if ((rule->rhs[j] = symb_get (rhs[offset + j])) == NULL
+	      || order[offset + j] < -1
+	      || order[offset + j] >= crules[i].trans_len)
+	    return "corrupted compiled grammar file";
+	  if (order[offset + j] < 0)
+	    continue;
+	  /* Marks of the previous rules are smaller. */
+	  if (STATIC_CAST(int *, VLO_BEGIN (*marks))[order[offset + j]] == i + 1)
+	    return "corrupted compiled grammar file";
+	  STATIC_CAST(int *, VLO_BEGIN (*marks))[order[offset + j]] = i + 1;
+	}
+      rule->rhs[j] = NULL;
+      rule->rhs_len = crules[i].rhs_len;
+      rule->lhs = lhs;
+      rule->anode = crules[i].anode < 0 ? NULL : strings + crules[i].anode;
+      rule->anode_cost = crules[i].anode_cost;
+      rule->trans_len = crules[i].trans_len;
+      rule->order = order + offset;
+      rule->next = NULL;
+      if (rules_ptr->curr_rule != NULL)
+	rules_ptr->curr_rule->next = rule;
+      else
+	rules_ptr->first_rule = rule;
+      rules_ptr->curr_rule = rule;
+      rule->lhs_next = lhs->u.nonterm.rules;
+      lhs->u.nonterm.rules = rule;
+      rule->rule_start_offset = rules_ptr->n_rhs_lens + rules_ptr->n_rules;
+      rule->num = rules_ptr->n_rules++;
+      rules_ptr->n_rhs_lens += rule->rhs_len;
+      offset += rule->rhs_len;
+    }
+  if (offset != header->n_rhs_lens)
+    return "corrupted compiled grammar file";
+#ifdef SYMB_CODE_TRANS_VECT
+  if (header->trans_vect_len != 0)
+    {
+      symbs_ptr->symb_code_trans_vect
+	= YAEP_STATIC_CAST(struct symb **,
+			   yaep_malloc (grammar->alloc,
+					sizeof (struct symb *)
+					* YAEP_STATIC_CAST(size_t, header->trans_vect_len)));
+      symbs_ptr->symb_code_trans_vect_start = header->trans_vect_start;
+      symbs_ptr->symb_code_trans_vect_end
+	= header->trans_vect_start + header->trans_vect_len;
+      for (i = 0; i < header->trans_vect_len; i++)
+	if (trans_vect[i] < 0)
+	  symbs_ptr->symb_code_trans_vect[i] = NULL;
+	else if ((symbs_ptr->symb_code_trans_vect[i]
+		  = term_get (trans_vect[i])) == NULL)
+	  return "corrupted compiled grammar file";
     }
+  else
+    symb_code_hash_create ();
 #endif
+  return NULL;
 }
 
-/* The following function builds new set by shifting situations of SET
-   given in CORE_SYMB_VECT with given lookahead terminal number.  If
-   the number is negative, we ignore lookahead at all. */
-static void
-build_new_set (struct set *set, struct core_symb_vect *core_symb_vect,
-	       int lookahead_term_num)
+/* The following function loads the grammar G from compiled grammar
+   file with name PATH saved by yaep_save_compiled_grammar.  The
+   function returns the error code. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_load_compiled_grammar (struct grammar *g, const char *path)
 {
-  struct set *prev_set;
-  struct set_core *set_core, *prev_set_core;
-  struct sit *sit, *new_sit, **prev_sits;
-  struct core_symb_vect *prev_core_symb_vect;
-  int local_lookahead_level, dist, sit_ind, new_dist;
-  int i, place;
-  struct vect *transitions;
+  struct stat st;
+  const char *message;
+  void *image;
+  vlo_t marks;
+  int fd;
 
-  local_lookahead_level = (lookahead_term_num < 0
-			   ? 0 : grammar->lookahead_level);
-  set_core = set->core;
-  set_new_start ();
-#ifdef TRANSITIVE_TRANSITION
-  curr_sit_check++;
-  transitions = &core_symb_vect->transitive_transitions;
-#else
-  transitions = &core_symb_vect->transitions;
-#endif
-  empty_sit_dist_set ();
-  for (i = 0; i < transitions->len; i++)
-    {
-      sit_ind = transitions->els[i];
-      sit = set_core->sits[sit_ind];
-      new_sit = sit_create (sit->rule, sit->pos + 1, sit->context);
-      if (local_lookahead_level != 0
-	  && !term_set_test (new_sit->lookahead, lookahead_term_num)
-	  && !term_set_test (new_sit->lookahead, grammar->term_error_num))
-	continue;
-#ifndef ABSOLUTE_DISTANCES
-      dist = 0;
-#else
-      dist = pl_curr;
-#endif
-      if (sit_ind >= set_core->n_all_dists)
-#ifdef TRANSITIVE_TRANSITION
-	new_sit->sit_check = curr_sit_check;
-#else
-	;
-#endif
-      else if (sit_ind < set_core->n_start_sits)
-	dist = set->dists[sit_ind];
-      else
-	dist = set->dists[set_core->parent_indexes[sit_ind]];
-#ifndef ABSOLUTE_DISTANCES
-      dist++;
-#endif
-      if (sit_dist_insert (new_sit, dist))
-	set_new_add_start_sit (new_sit, dist);
-    }
-  for (i = 0; i < new_n_start_sits; i++)
-    {
-      new_sit = new_sits[i];
-      if (new_sit->empty_tail_p
-#ifdef TRANSITIVE_TRANSITION
-	  && new_sit->sit_check != curr_sit_check
-#endif
-	)
-	{
-	  int *curr_el, *bound;
+  assert (g != NULL);
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  grammar = g;
+  yaep_copy_error_to_grammar (grammar);
+  symbs_ptr = grammar->symbs_ptr;
+  term_sets_ptr = grammar->term_sets_ptr;
+  rules_ptr = grammar->rules_ptr;
+  if (grammar->frozen_p)
+    return yaep_set_error (grammar, YAEP_FROZEN_GRAMMAR,
+			   "grammar is frozen");
+  /* Parse caches formed for the previous grammar become invalid. */
+  grammar->generation++;
+  if (!grammar->undefined_p)
+    yaep_empty_grammar ();
+  grammar->undefined_p = TRUE;
+  if ((fd = open (path, O_RDONLY)) < 0)
+    return yaep_set_error (grammar, YAEP_COMPILED_GRAMMAR_IO_ERROR,
+			   "can not open compiled grammar file `%s'", path);
+  image = MAP_FAILED;
+  if (fstat (fd, &st) == 0 && st.st_size > 0)
+    image = mmap (NULL, YAEP_STATIC_CAST(size_t, st.st_size), PROT_READ,
+		  MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (image == MAP_FAILED)
+    return yaep_set_error (grammar, YAEP_COMPILED_GRAMMAR_IO_ERROR,
+			   "can not map compiled grammar file `%s'", path);
+  grammar->compiled_image = image;
+  grammar->compiled_image_size = YAEP_STATIC_CAST(size_t, st.st_size);
+  VLO_CREATE (marks, grammar->alloc, 256);
+  if ((message = compiled_header_check
+       (YAEP_STATIC_CAST(const struct compiled_grammar_header *, image),
+	grammar->compiled_image_size)) != NULL
+      || (message = compiled_grammar_form
+	  (YAEP_STATIC_CAST(char *, image), &marks)) != NULL)
+    {
+      VLO_DELETE (marks);
+      yaep_empty_grammar ();
+      return yaep_set_error (grammar, YAEP_BAD_COMPILED_GRAMMAR,
+			     "%s: %s", path, message);
+    }
+  VLO_DELETE (marks);
+  create_prediction_closures ();
+  grammar->undefined_p = FALSE;
+  return 0;
+}
 
-	  /* All tail in new sitiation may derivate empty string so
-	     make reduce and add new situations. */
-	  new_dist = new_dists[i];
-#ifndef ABSOLUTE_DISTANCES
-	  place = pl_curr + 1 - new_dist;
-#else
-	  place = new_dist;
-#endif
-	  prev_set = pl[place];
-	  prev_set_core = prev_set->core;
-	  prev_core_symb_vect = core_symb_vect_find (prev_set_core,
-						     new_sit->rule->lhs);
-	  if (prev_core_symb_vect == NULL)
-	    {
-	      assert (new_sit->rule->lhs == grammar->axiom);
-	      continue;
-	    }
+
+
+
+
+/* The following function returns approximate size (in bytes) of
+   the parse cache of the current parser. */
+static size_t
+parse_cache_size (void)
+{
+  size_t size, n_sit_tables;
+
+  n_sit_tables = VLO_LENGTH (sit_table_vlo) / sizeof (struct sit **);
+  /* The situations of the frozen grammar are not in the cache. */
+  size = (rules_ptr->sits != NULL
+	  ? 0 : YAEP_STATIC_CAST(size_t, n_all_sits) * sizeof (struct sit));
+  size += (n_sit_tables
+	  * YAEP_STATIC_CAST(size_t, rules_ptr->n_rhs_lens + rules_ptr->n_rules)
+	  * sizeof (struct sit *)
+	  + term_sets_ptr->n_term_sets_size);
+  size += (YAEP_STATIC_CAST(size_t, n_set_cores) * sizeof (struct set_core)
+	   + YAEP_STATIC_CAST(size_t, n_set_core_start_sits + n_parent_indexes)
+	   * sizeof (struct sit *)
+	   + YAEP_STATIC_CAST(size_t, n_parent_indexes + n_set_dists_len)
+	   * sizeof (int)
+	   + YAEP_STATIC_CAST(size_t, n_sets) * sizeof (struct set)
+	   + YAEP_STATIC_CAST(size_t, n_set_term_lookaheads)
+	   * sizeof (struct set_term_lookahead));
+  size += (YAEP_STATIC_CAST(size_t, n_core_symb_pairs)
+	   * sizeof (struct core_symb_vect)
+	   + YAEP_STATIC_CAST(size_t, n_transition_vect_len + n_reduce_vect_len)
+	   * sizeof (int));
 #ifdef TRANSITIVE_TRANSITION
-	  curr_el = prev_core_symb_vect->transitive_transitions.els;
-	  bound = curr_el + prev_core_symb_vect->transitive_transitions.len;
-#else
-	  curr_el = prev_core_symb_vect->transitions.els;
-	  bound = curr_el + prev_core_symb_vect->transitions.len;
-#endif
-	  assert (curr_el != NULL);
-	  prev_sits = prev_set_core->sits;
-	  do
-	    {
-	      sit_ind = *curr_el++;
-	      sit = prev_sits[sit_ind];
-	      new_sit = sit_create (sit->rule, sit->pos + 1, sit->context);
-	      if (local_lookahead_level != 0
-		  && !term_set_test (new_sit->lookahead, lookahead_term_num)
-		  && !term_set_test (new_sit->lookahead,
-				     grammar->term_error_num))
-		continue;
-#ifndef ABSOLUTE_DISTANCES
-	      dist = 0;
-#else
-	      dist = new_dist;
+  size += (YAEP_STATIC_CAST(size_t, n_transitive_transition_vect_len)
+	   * sizeof (int));
 #endif
-	      if (sit_ind >= prev_set_core->n_all_dists)
-#ifdef TRANSITIVE_TRANSITION
-		new_sit->sit_check = curr_sit_check;
+#ifndef USE_CORE_SYMB_HASH_TABLE
+  size += (YAEP_STATIC_CAST(size_t, n_set_cores)
+	   * (symbs_ptr->n_terms + symbs_ptr->n_nonterms)
+	   * sizeof (struct core_symb_vect *));
 #else
-		;
-#endif
-	      else if (sit_ind < prev_set_core->n_start_sits)
-		dist = prev_set->dists[sit_ind];
-	      else
-		dist =
-		  prev_set->dists[prev_set_core->parent_indexes[sit_ind]];
-#ifndef ABSOLUTE_DISTANCES
-	      dist += new_dist;
+  size += hash_table_size (core_symb_to_vect_tab) * HASH_TABLE_ENTRY_SIZE;
 #endif
-	      if (sit_dist_insert (new_sit, dist))
-		set_new_add_start_sit (new_sit, dist);
-	    }
-	  while (curr_el < bound);
-	}
-    }
-  if (set_insert ())
-    {
-      expand_new_start_set ();
-      new_core->term = core_symb_vect->symb;
-    }
+  size += ((hash_table_size (set_core_tab) + hash_table_size (set_dists_tab)
+	    + hash_table_size (set_tab)
+	    + hash_table_size (set_term_lookahead_tab)
+	    + hash_table_size (transition_els_tab)
+	    + hash_table_size (reduce_els_tab))
+	   * HASH_TABLE_ENTRY_SIZE);
+  return size;
 }
-
-
 
-/* This page contains error recovery code.  This code finds minimal
-   cost error recovery.  The cost of error recovery is number of
-   tokens ignored by error recovery.  The error recovery is successful
-   when we match at least RECOVERY_TOKEN_MATCHES tokens. */
+/* The following function removes the parse cache contents of the
+   current parser but keeps its containers for subsequent parses. */
+static void
+parse_cache_empty (void)
+{
+  assert (curr_parser->cache_p);
+  core_symb_vect_empty ();
+  set_empty ();
+  sit_empty ();
+  term_set_empty (term_sets_ptr);
+}
 
-/* The following strucrture describes an error recovery state (an
-   error recovery alternative. */
-struct recovery_state
+/* The following function frees the parse cache of the current
+   parser. */
+static void
+parse_cache_fin (void)
 {
-  /* The following three members define start pl used to given error
-     recovery state (alternative). */
-  /* The following members define what part of original (at the error
-     recovery start) pl will be head of error recovery state.  The
-     head will be all states from original pl with indexes in range
-     [0, last_original_pl_el]. */
-  int last_original_pl_el;
-  /* The following two members define tail of pl for this error
-     recovery state. */
-  int pl_tail_length;
-  struct set **pl_tail;
-  /* The following member is index of start token for given error
-     recovery state. */
-  int start_tok;
-  /* The following member value is number of tokens already ignored in
-     order to achieved given error recovery state. */
-  int backward_move_cost;
-};
-
-/* All tail sets of error recovery are saved in the following os. */
-#ifndef __cplusplus
-static os_t recovery_state_tail_sets;
-#else
-static os_t *recovery_state_tail_sets;
+  if (!curr_parser->cache_p)
+    return;
+  yaep_free (grammar->alloc, caller_anodes);
+  caller_anodes = NULL;
+#ifdef USE_CORE_SYMB_HASH_TABLE
+  yaep_free (grammar->alloc, cached_core_symb_vects);
+  cached_core_symb_vects = NULL;
 #endif
+  core_symb_vect_fin ();
+  set_fin ();
+  sit_fin ();
+  /* Situation lookaheads and contexts are not needed anymore. */
+  term_set_empty (term_sets_ptr);
+  curr_parser->cache_p = FALSE;
+}
 
-/* The following variable values is pl_curr and tok_curr at error
-   recovery start (when the original syntax error has been fixed). */
-static int start_pl_curr, start_tok_curr;
+#ifdef USE_SHARED_MEMO
 
-/* The following variable value means that all error sets in pl with
-   indexes [back_pl_frontier, start_pl_curr] are being processed or
-   have been processed. */
-static int back_pl_frontier;
 
-/* The following variable stores original pl tail in reversed order.
-   This object only grows.  The last object sets may be used to
-   restore original pl in order to try another error recovery state
-   (alternative). */
-#ifndef __cplusplus
-static vlo_t original_pl_tail_stack;
-#else
-static vlo_t *original_pl_tail_stack;
-#endif
+/* This page contains the shared memo of a frozen grammar.  Parsers of
+   the grammar (e.g. working in different threads) find set cores,
+   sets, goto sets and core_symb_vects formed by other parsers in the
+   memo instead of forming them again.  The memo is a sequence of
+   immutable snapshots (see struct shared_memo_snapshot).  The parsers
+   read the current snapshot without locking.  When a parse forms new
+   set cores, the parser publishes a new snapshot containing the
+   current one and its parse cache by an atomic compare and swap of
+   the current snapshot.  If another parser has published a snapshot
+   before, the publication is repeated with the new current snapshot.
+   The published objects are never changed and are freed only with
+   the grammar.  The mutex is used only to count references to the
+   snapshots when a parser switches to a new snapshot. */
 
-/* The following variable value is last pl element which is original
-   set (set before the error_recovery start). */
-static int original_last_pl_el;
+struct shared_memo
+{
+  /* The current snapshot.  It is read and changed only atomically. */
+  struct shared_memo_snapshot *head;
+  /* The mutex protects reference counters of the snapshots and the
+     following vlo. */
+  pthread_mutex_t mutex;
+  /* The following vlo contains object stacks with the objects
+     published by the parsers. */
+  vlo_t os_vlo;
+};
 
-/* The following function may be called if you know that pl has
-   original sets upto LAST element (including it).  Such call can
-   decrease number of restored sets. */
-#if MAKE_INLINE
-INLINE
-#endif
+/* Insert element EL into table TAB of a snapshot being formed unless
+   there is already the same element in the table. */
 static void
-set_original_set_bound (int last)
+shared_memo_insert (hash_table_entry_t el, void *tab)
 {
-  assert (last >= 0 && last <= start_pl_curr
-	  && original_last_pl_el <= start_pl_curr);
-  original_last_pl_el = last;
+  hash_table_entry_t *entry;
+
+  entry = find_hash_table_entry (YAEP_STATIC_CAST(hash_table_t, tab), el,
+				 TRUE);
+  if (*entry == NULL)
+    *entry = el;
 }
 
-/* The following function guarantees that original pl tail sets
-   starting with pl_curr (including the state) is saved.  The function
-   should be called after any decreasing pl_curr with subsequent
-   writing to pl [pl_curr]. */
-static void
-save_original_sets (void)
+/* Create and return a new snapshot containing elements of snapshot
+   BASE (if it is not NULL).  The snapshot has one reference. */
+static struct shared_memo_snapshot *
+shared_memo_snapshot_create (struct shared_memo_snapshot *base)
 {
-  int length, curr_pl;
+  struct shared_memo_snapshot *snapshot;
 
-  assert (pl_curr >= 0 && original_last_pl_el <= start_pl_curr);
-  {
-    size_t _tmp_length = VLO_NELS (original_pl_tail_stack, struct set *);
-    assert (_tmp_length <= YAEP_STATIC_CAST(size_t, INT_MAX));
-    length = YAEP_STATIC_CAST(int, _tmp_length);
-  }
-  for (curr_pl = start_pl_curr - length; curr_pl >= pl_curr; curr_pl--)
-    {
-      VLO_ADD_MEMORY (original_pl_tail_stack, &pl[curr_pl],
-		      sizeof (struct set *));
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
-	{
-	  fprintf (stderr, "++++Save original set=%d\n", curr_pl);
-	  if (grammar->debug_level > 3)
-	    {
-	      set_print (stderr, pl[curr_pl], curr_pl,
-			 grammar->debug_level > 4, grammar->debug_level > 5);
-	      fprintf (stderr, "\n");
-	    }
-	}
-#endif
-    }
-  original_last_pl_el = pl_curr - 1;
+  snapshot = YAEP_STATIC_CAST(struct shared_memo_snapshot *,
+			      yaep_malloc (grammar->alloc,
+					   sizeof (struct shared_memo_snapshot)));
+  if (snapshot == NULL)
+    return NULL;
+  snapshot->n_cores = base == NULL ? 0 : base->n_cores;
+  snapshot->n_refs = 1;
+  snapshot->core_tab
+    = create_hash_table (grammar->alloc,
+			 base == NULL ? 1000 : hash_table_size (base->core_tab),
+			 set_core_hash, set_core_eq);
+  snapshot->dists_tab
+    = create_hash_table (grammar->alloc,
+			 base == NULL ? 1000 : hash_table_size (base->dists_tab),
+			 dists_hash, dists_eq);
+  snapshot->sets_tab
+    = create_hash_table (grammar->alloc,
+			 base == NULL ? 1000 : hash_table_size (base->sets_tab),
+			 set_core_dists_hash, set_core_dists_eq);
+  snapshot->goto_tab
+    = create_hash_table (grammar->alloc,
+			 base == NULL ? 1000 : hash_table_size (base->goto_tab),
+			 set_term_lookahead_hash, set_term_lookahead_eq);
+  if (base != NULL)
+    {
+      traverse_hash_table (base->core_tab, shared_memo_insert,
+			   snapshot->core_tab);
+      traverse_hash_table (base->dists_tab, shared_memo_insert,
+			   snapshot->dists_tab);
+      traverse_hash_table (base->sets_tab, shared_memo_insert,
+			   snapshot->sets_tab);
+      traverse_hash_table (base->goto_tab, shared_memo_insert,
+			   snapshot->goto_tab);
+    }
+  return snapshot;
+}
+
+/* Free SNAPSHOT (but not the objects in it). */
+static void
+shared_memo_snapshot_delete (struct shared_memo_snapshot *snapshot)
+{
+  delete_hash_table (snapshot->goto_tab);
+  delete_hash_table (snapshot->sets_tab);
+  delete_hash_table (snapshot->dists_tab);
+  delete_hash_table (snapshot->core_tab);
+  yaep_free (grammar->alloc, snapshot);
 }
 
-/* If it is necessary, the following function restores original pl
-   part with states in range [0, last_pl_el]. */
+/* Remove a reference to SNAPSHOT and free it if there are no other
+   references.  The memo mutex should be locked. */
 static void
-restore_original_sets (int last_pl_el)
+shared_memo_snapshot_unref (struct shared_memo_snapshot *snapshot)
 {
-  assert (last_pl_el <= start_pl_curr
-	  && original_last_pl_el <= start_pl_curr);
-  if (original_last_pl_el >= last_pl_el)
-    {
-      original_last_pl_el = last_pl_el;
-      return;
-    }
-  for (;;)
+  if (--snapshot->n_refs == 0)
+    shared_memo_snapshot_delete (snapshot);
+}
+
+/* Create the shared memo of the current grammar and return the error
+   code. */
+static int
+shared_memo_create (void)
+{
+  struct shared_memo *memo;
+
+  memo = YAEP_STATIC_CAST(struct shared_memo *,
+			  yaep_malloc (grammar->alloc,
+				       sizeof (struct shared_memo)));
+  if (memo == NULL)
+    return yaep_set_error (grammar, YAEP_NO_MEMORY,
+			   "no memory for shared memo");
+  if ((memo->head = shared_memo_snapshot_create (NULL)) == NULL)
     {
-      original_last_pl_el++;
-      pl[original_last_pl_el]
-	= (YAEP_STATIC_CAST(struct set **, VLO_BEGIN (original_pl_tail_stack)))
-	[start_pl_curr - original_last_pl_el];
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
-	{
-	  fprintf (stderr, "++++++Restore original set=%d\n",
-		   original_last_pl_el);
-	  if (grammar->debug_level > 3)
-	    {
-	      set_print (stderr, pl[original_last_pl_el], original_last_pl_el,
-			 grammar->debug_level > 4, grammar->debug_level > 5);
-	      fprintf (stderr, "\n");
-	    }
-	}
-#endif
-      if (original_last_pl_el >= last_pl_el)
-	break;
+      yaep_free (grammar->alloc, memo);
+      return yaep_set_error (grammar, YAEP_NO_MEMORY,
+			     "no memory for shared memo");
     }
+  pthread_mutex_init (&memo->mutex, NULL);
+  VLO_CREATE (memo->os_vlo, grammar->alloc, 0);
+  grammar->shared_memo = memo;
+  return 0;
 }
 
-/* The following function looking backward in pl starting with element
-   START_PL_EL and returns pl element which refers set with situation
-   containing `. error'.  START_PL_EL should be non negative.
-   Remember that zero pl set contains `.error' because we added such
-   rule if it is necessary.  The function returns number of terminals
-   (not taking error into account) on path (result, start_pl_set]. */
-#if MAKE_INLINE
-INLINE
-#endif
-static int
-find_error_pl_set (int start_pl_set, int *cost)
+/* Free the shared memo of the current grammar.  All parsers of the
+   grammar should be already freed. */
+static void
+shared_memo_free (void)
 {
-  int curr_pl;
+  struct shared_memo *memo = grammar->shared_memo;
+  os_t *os_ptr;
 
-  assert (start_pl_set >= 0);
-  *cost = 0;
-  for (curr_pl = start_pl_set; curr_pl >= 0; curr_pl--)
-    if (core_symb_vect_find (pl[curr_pl]->core, grammar->term_error) != NULL)
-      break;
-    else if (pl[curr_pl]->core->term != grammar->term_error)
-      (*cost)++;
-  assert (curr_pl >= 0);
-  return curr_pl;
+  if (memo == NULL)
+    return;
+  shared_memo_snapshot_unref (memo->head);
+  for (os_ptr = YAEP_STATIC_CAST(os_t *, VLO_BEGIN (memo->os_vlo));
+       os_ptr < YAEP_STATIC_CAST(os_t *, VLO_BOUND (memo->os_vlo));
+       os_ptr++)
+    OS_DELETE (*os_ptr);
+  VLO_DELETE (memo->os_vlo);
+  pthread_mutex_destroy (&memo->mutex);
+  yaep_free (grammar->alloc, memo);
+  grammar->shared_memo = NULL;
+}
+
+/* Make the current parser use the current snapshot of the shared
+   memo.  The mutex is locked only when the snapshot was changed. */
+static void
+shared_memo_adopt (void)
+{
+  struct shared_memo *memo = grammar->shared_memo;
+  struct shared_memo_snapshot *old;
+
+  if (memo == NULL
+      || __atomic_load_n (&memo->head, __ATOMIC_ACQUIRE) == memo_snapshot)
+    return;
+  pthread_mutex_lock (&memo->mutex);
+  old = memo_snapshot;
+  memo_snapshot = __atomic_load_n (&memo->head, __ATOMIC_ACQUIRE);
+  memo_snapshot->n_refs++;
+  if (old != NULL)
+    shared_memo_snapshot_unref (old);
+  pthread_mutex_unlock (&memo->mutex);
 }
 
-/* The following function creates and returns new error recovery state
-   with charcteristics (LAST_ORIGINAL_PL_EL, BACKWARD_MOVE_COST,
-   pl_curr, tok_curr). */
-static struct recovery_state
-new_recovery_state (int last_original_pl_el, int backward_move_cost)
+/* Remove the reference of the current parser to a shared memo
+   snapshot. */
+static void
+shared_memo_release (void)
 {
-  struct recovery_state state;
-  int i;
+  struct shared_memo *memo = grammar->shared_memo;
 
-  assert (backward_move_cost >= 0);
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
-    {
-      fprintf (stderr,
-	       "++++Creating recovery state: original set=%d, tok=%d, ",
-	       last_original_pl_el, tok_curr);
-      symb_print (stderr, toks[tok_curr].symb, TRUE);
-      fprintf (stderr, "\n");
-    }
-#endif
-  state.last_original_pl_el = last_original_pl_el;
-  state.pl_tail_length = pl_curr - last_original_pl_el;
-  assert (state.pl_tail_length >= 0);
-  for (i = last_original_pl_el + 1; i <= pl_curr; i++)
-    {
-      OS_TOP_ADD_MEMORY (recovery_state_tail_sets, &pl[i], sizeof (pl[i]));
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 3)
-	{
-	  fprintf (stderr, "++++++Saving set=%d\n", i);
-	  set_print (stderr, pl[i], i, grammar->debug_level > 4,
-		     grammar->debug_level > 5);
-	  fprintf (stderr, "\n");
-	}
-#endif
-    }
-  state.pl_tail = YAEP_STATIC_CAST(struct set **, OS_TOP_BEGIN (recovery_state_tail_sets));
-  OS_TOP_FINISH (recovery_state_tail_sets);
-  state.start_tok = tok_curr;
-  state.backward_move_cost = backward_move_cost;
-  return state;
+  if (memo_snapshot == NULL)
+    return;
+  pthread_mutex_lock (&memo->mutex);
+  shared_memo_snapshot_unref (memo_snapshot);
+  pthread_mutex_unlock (&memo->mutex);
+  memo_snapshot = NULL;
 }
 
-/* The following vlo is error recovery states stack.  The stack
-   contains error recovery state which should be investigated to find
-   the best error recovery. */
-#ifndef __cplusplus
-static vlo_t recovery_state_stack;
-#else
-static vlo_t *recovery_state_stack;
-#endif
+/* Move object stack *STACK with the objects published by the current
+   parser into the shared memo and create new empty object stack with
+   initial segment length LEN in *STACK.  The memo mutex should be
+   locked. */
+static void
+shared_memo_keep_os (os_t *stack, size_t len)
+{
+  VLO_ADD_MEMORY (grammar->shared_memo->os_vlo, stack, sizeof (*stack));
+  OS_CREATE (*stack, grammar->alloc, len);
+}
 
-/* The following function creates new error recovery state and pushes
-   it on the states stack top. */
-#if MAKE_INLINE
-INLINE
-#endif
+/* Publish set cores, sets, goto sets and core_symb_vects of the parse
+   cache of the current parser in the shared memo if the cache
+   contains new set cores.  The parse cache is emptied after that. */
 static void
-push_recovery_state (int last_original_pl_el, int backward_move_cost)
+shared_memo_publish (void)
 {
-  struct recovery_state state;
+  struct shared_memo *memo = grammar->shared_memo;
+  struct shared_memo_snapshot *base, *snapshot;
 
-  state = new_recovery_state (last_original_pl_el, backward_move_cost);
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
+  if (memo == NULL || n_set_cores == 0)
+    return;
+  for (;;)
     {
-      fprintf (stderr, "++++Push recovery state: original set=%d, tok=%d, ",
-	       last_original_pl_el, tok_curr);
-      symb_print (stderr, toks[tok_curr].symb, TRUE);
-      fprintf (stderr, "\n");
-    }
+      shared_memo_adopt ();
+      base = memo_snapshot;
+      if ((snapshot = shared_memo_snapshot_create (base)) == NULL)
+	return;
+      traverse_hash_table (set_core_tab, shared_memo_insert,
+			   snapshot->core_tab);
+      traverse_hash_table (set_dists_tab, shared_memo_insert,
+			   snapshot->dists_tab);
+      traverse_hash_table (set_tab, shared_memo_insert, snapshot->sets_tab);
+      traverse_hash_table (set_term_lookahead_tab, shared_memo_insert,
+			   snapshot->goto_tab);
+      snapshot->n_cores += n_set_cores;
+      /* The references from the memo and the current parser. */
+      snapshot->n_refs = 2;
+      if (__atomic_compare_exchange_n (&memo->head, &base, snapshot, FALSE,
+				       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	break;
+      /* Another parser has published its snapshot.  Repeat with
+	 it. */
+      shared_memo_snapshot_delete (snapshot);
+    }
+  pthread_mutex_lock (&memo->mutex);
+  /* Remove the references of the memo and the parser to the previous
+     snapshot. */
+  shared_memo_snapshot_unref (memo_snapshot);
+  shared_memo_snapshot_unref (memo_snapshot);
+  memo_snapshot = snapshot;
+  shared_memo_keep_os (&set_cores_os, 0);
+  shared_memo_keep_os (&set_sits_os, 2048);
+  shared_memo_keep_os (&set_parent_indexes_os, 2048);
+  shared_memo_keep_os (&set_dists_os, 2048);
+  shared_memo_keep_os (&sets_os, 0);
+  shared_memo_keep_os (&set_term_lookahead_os, 0);
+  shared_memo_keep_os (&core_symb_vect_os, 0);
+  shared_memo_keep_os (&vect_els_os, 0);
+  shared_memo_keep_os (&core_symb_tab_rows, 8192);
+  pthread_mutex_unlock (&memo->mutex);
+  parse_cache_empty ();
+}
+
+#endif /* #ifdef USE_SHARED_MEMO */
+
+/* The function initializes all internal data for parser for N_TOKS
+   tokens.  The parse cache is reused if it was formed for the same
+   grammar and lookahead level. */
+static void
+yaep_parse_init (int n_toks)
+{
+  struct rule *rule;
+
+  if (curr_parser->cache_p
+      && (curr_parser->cache_generation != grammar->generation
+	  || curr_parser->cache_lookahead_level != grammar->lookahead_level))
+    parse_cache_fin ();
+  if (!curr_parser->cache_p)
+    {
+      sit_init ();
+      set_init (n_toks);
+      core_symb_vect_init ();
+#ifdef USE_CORE_SYMB_HASH_TABLE
+      cached_core_symb_vects
+	= YAEP_STATIC_CAST(struct core_symb_vect **,
+			   yaep_malloc (grammar->alloc,
+					sizeof (struct core_symb_vect *)
+					* (symbs_ptr->n_terms
+					   + symbs_ptr->n_nonterms)));
+#endif
+      caller_anodes
+	= YAEP_STATIC_CAST(char **,
+			   yaep_malloc (grammar->alloc,
+					sizeof (char *)
+					* YAEP_STATIC_CAST(size_t, rules_ptr->n_rules)));
+      curr_parser->cache_p = TRUE;
+      curr_parser->cache_generation = grammar->generation;
+      curr_parser->cache_lookahead_level = grammar->lookahead_level;
+    }
+#ifdef USE_SHARED_MEMO
+  shared_memo_adopt ();
+#endif
+  set_parse_init ();
+  curr_parse_num++;
+  n_goto_cache_hits = 0;
+#ifdef USE_CORE_SYMB_HASH_TABLE
+  {
+    size_t i, n_symbs = symbs_ptr->n_terms + symbs_ptr->n_nonterms;
+
+    for (i = 0; i < n_symbs; i++)
+      cached_core_symb_vects[i] = NULL;
+  }
 #endif
-  VLO_ADD_MEMORY (recovery_state_stack, &state, sizeof (state));
+  for (rule = rules_ptr->first_rule; rule != NULL; rule = rule->next)
+    caller_anodes[rule->num] = NULL;
 }
 
-/* The following function sets up parser state (pl, pl_curr, tok_curr)
-   according to error recovery STATE. */
+/* The function should be called the last.  The parse cache is kept
+   if it is used and its size is in the limit.  If the cache is not
+   used, only its containers are kept for the next parse. */
 static void
-set_recovery_state (struct recovery_state *state)
+yaep_parse_fin (void)
 {
-  int i;
+  set_parse_fin ();
+  if (grammar->parse_cache_limit == 0)
+    parse_cache_empty ();
+  else if (parse_cache_size () > grammar->parse_cache_limit)
+    parse_cache_fin ();
+}
 
-  tok_curr = state->start_tok;
-  restore_original_sets (state->last_original_pl_el);
-  pl_curr = state->last_original_pl_el;
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
+/* The following function reads all input tokens and returns 0 on success. */
+static int
+read_toks (void)
+{
+  int code;
+  void *attr;
+
+  while ((code = read_token (&attr)) >= 0)
     {
-      fprintf (stderr, "++++Set recovery state: set=%d, tok=%d, ",
-	       pl_curr, tok_curr);
-      symb_print (stderr, toks[tok_curr].symb, TRUE);
-      fprintf (stderr, "\n");
+      int err = tok_add (code, attr);
+      if (err != 0)
+        return err;
     }
-#endif
-  for (i = 0; i < state->pl_tail_length; i++)
+  return tok_add (END_MARKER_CODE, NULL);
+}
+
+/* The following function sets up N input tokens with CODES and
+   attributes ATTRS (it can be NULL) given by the caller and adds the
+   end marker.  The attributes are not copied.  The function returns 0
+   on success. */
+static int
+tok_set_array (int n, const int *codes, void *const *attrs)
+{
+  int code;
+
+  if ((code = tok_add_codes (n, codes)) != 0
+      || (code = tok_add (END_MARKER_CODE, NULL)) != 0)
+    return code;
+  if (attrs != NULL)
     {
-      pl[++pl_curr] = state->pl_tail[i];
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 3)
-	{
-	  fprintf (stderr, "++++++Add saved set=%d\n", pl_curr);
-	  set_print (stderr, pl[pl_curr], pl_curr, grammar->debug_level > 4,
-		     grammar->debug_level > 5);
-	  fprintf (stderr, "\n");
-	}
-#endif
+      tok_attrs = attrs;
+      n_tok_attrs = n;
     }
+  return 0;
 }
 
-/* The following function pops the top error recovery state from
-   states stack.  The current parser state will be setup according to
-   the state. */
+/* The following function add start situations which is formed from
+   given start situation SIT with distance DIST by reducing symbol
+   which can derivate empty string and which is placed after dot in
+   given situation.  The function returns TRUE if the dot is placed on
+   the last position in given situation or in the added situations. */
 #if MAKE_INLINE
 INLINE
 #endif
-static struct recovery_state
-pop_recovery_state (void)
+static void
+add_derived_nonstart_sits (struct sit *sit, int parent)
 {
-  struct recovery_state *state;
+  struct symb *symb;
+  struct rule *rule = sit->rule;
+  int context = sit->context;
+  int i;
 
-  state = &(YAEP_STATIC_CAST(struct recovery_state *, VLO_BOUND (recovery_state_stack)))[-1];
-  VLO_SHORTEN (recovery_state_stack, sizeof (struct recovery_state));
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
-    fprintf (stderr, "++++Pop error recovery state\n");
-#endif
-  set_recovery_state (state);
-  return *state;
+  for (i = sit->pos; (symb = rule->rhs[i]) != NULL && symb->empty_p; i++)
+    set_add_new_nonstart_sit (sit_create (rule, i + 1, context), parent);
 }
 
-/* The following function is major function of syntax error recovery.
-   It searches for minimal cost error recovery.  The function returns
-   in the parameter number of start token which is ignored and number
-   of the first token which is not ignored.  If the number of ignored
-   tokens is zero, *START will be equal to *STOP and number of token
-   on which the error occurred. */
+#ifdef TRANSITIVE_TRANSITION
+/* Collect all symbols before the dot in new situations in
+   CORE_SYMBOL_VLO.  */
 static void
-error_recovery (int *start, int *stop)
+collect_core_symbols (void)
 {
-  struct set *set;
-  struct core_symb_vect *core_symb_vect;
-  struct recovery_state best_state, state;
-  int best_cost, cost, lookahead_term_num, n_matched_toks;
-  int back_to_frontier_move_cost, backward_move_cost;
+  size_t i;
+  int *core_symbol_check_vec = YAEP_STATIC_CAST(int *, VLO_BEGIN (core_symbol_check_vlo));
+  struct symb *symb;
+  struct sit *sit;
 
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
-    fprintf (stderr, "\n++Error recovery start\n");
-#endif
-  *stop = *start = -1;
-  OS_CREATE (recovery_state_tail_sets, grammar->alloc, 0);
-  VLO_NULLIFY (original_pl_tail_stack);
-  VLO_NULLIFY (recovery_state_stack);
-  start_pl_curr = pl_curr;
-  start_tok_curr = tok_curr;
-  /* Initialize error recovery state stack. */
-  pl_curr
-    = back_pl_frontier = find_error_pl_set (pl_curr, &backward_move_cost);
-  back_to_frontier_move_cost = backward_move_cost;
-  save_original_sets ();
-  push_recovery_state (back_pl_frontier, backward_move_cost);
-  best_cost = 2 * toks_len;
-  while (VLO_LENGTH (recovery_state_stack) > 0)
+  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_core->n_sits); i++)
     {
-      state = pop_recovery_state ();
-      cost = state.backward_move_cost;
-      assert (cost >= 0);
-      /* Advance back frontier. */
-      if (back_pl_frontier > 0)
-	{
-	  int saved_pl_curr = pl_curr, saved_tok_curr = tok_curr;
+      sit = new_sits[i];
+      if (sit->pos >= sit->rule->rhs_len)
+	continue;
+      /* There is a symbol after dot in the situation. */
+      symb = sit->rule->rhs[sit->pos];
+      if (core_symbol_check_vec[symb->num] == core_symbol_check
+	  || symb == grammar->term_error)
+	continue;
+      core_symbol_check_vec[symb->num] = core_symbol_check;
+      VLO_ADD_MEMORY (core_symbols_vlo, &symb, sizeof (symb));
+    }
+}
 
-	  /* Advance back frontier. */
-	  pl_curr = find_error_pl_set (back_pl_frontier - 1,
-				       &backward_move_cost);
-#ifndef NO_YAEP_DEBUG_PRINT
-	  if (grammar->debug_level > 2)
-	    fprintf (stderr, "++++Advance back frontier: old=%d, new=%d\n",
-		     back_pl_frontier, pl_curr);
-#endif
-	  if (best_cost >= back_to_frontier_move_cost + backward_move_cost)
-	    {
-	      back_pl_frontier = pl_curr;
-	      tok_curr = start_tok_curr;
-	      save_original_sets ();
-	      back_to_frontier_move_cost += backward_move_cost;
-	      push_recovery_state (back_pl_frontier,
-				   back_to_frontier_move_cost);
-	      set_original_set_bound (state.last_original_pl_el);
-	      tok_curr = saved_tok_curr;
-	    }
-	  pl_curr = saved_pl_curr;
-	}
-      /* Advance head frontier. */
-      if (best_cost >= cost + 1)
+/* Create transitive transition vectors for the new situations.
+   Transition vectors should be already created.  */
+static void
+form_transitive_transition_vectors (void)
+{
+  size_t i, j, k;
+  int sit_ind;
+  struct symb *symb, *new_symb;
+  struct sit *sit;
+  struct core_symb_vect *core_symb_vect, *symb_core_symb_vect;
+
+  core_symbol_check++;
+  expand_int_vlo (&core_symbol_check_vlo,
+		  symbs_ptr->n_terms + symbs_ptr->n_nonterms);
+  VLO_NULLIFY (core_symbols_vlo);
+  collect_core_symbols ();
+  for (i = 0; i < VLO_NELS (core_symbols_vlo, struct symb *); i++)
+    {
+      symb = STATIC_CAST(struct symb **, VLO_BEGIN (core_symbols_vlo))[i];
+      core_symb_vect = core_symb_vect_find (new_core, symb);
+      if (core_symb_vect == NULL)
+	core_symb_vect = core_symb_vect_new (new_core, symb);
+      core_symbol_check++;
+      VLO_NULLIFY (core_symbol_queue_vlo);
+      /* Put the symbol into the queue.  */
+  VLO_ADD_MEMORY (core_symbol_queue_vlo, &symb, sizeof (symb));
+  for (j = 0;
+   j < VLO_NELS (core_symbol_queue_vlo, struct symb *);
+   j++)
 	{
-	  tok_curr++;
-	  if (tok_curr < toks_len)
+	  symb = STATIC_CAST(struct symb **, VLO_BEGIN (core_symbol_queue_vlo))[j];
+	  symb_core_symb_vect = core_symb_vect_find (new_core, symb);
+	  if (symb_core_symb_vect == NULL)
+	    continue;
+      for (k = 0; k < symb_core_symb_vect->transitions.len; k++)
 	    {
-#ifndef NO_YAEP_DEBUG_PRINT
-	      if (grammar->debug_level > 2)
+ 	      sit_ind = symb_core_symb_vect->transitions.els[k];
+ 	      /* sit_ind comes from a vector of ints but may originate from
+ 	         size_t indices; ensure any upstream size_t->int conversions
+ 	         were checked.  Pass through as-is (sit_ind is already int). */
+ 	      core_symb_vect_new_add_transitive_transition_el (core_symb_vect,
+ 			       sit_ind);
+	      if (sit_ind < new_core->n_all_dists)
+		/* This situation is originated from other sets --
+		   stop.  */
+		continue;
+    sit = new_sits[sit_ind];
+    /* sit_ind is an int here; sit_create expects int parameters. */
+    sit = sit_create (sit->rule, sit->pos + 1, sit->context);
+	      if (sit->empty_tail_p)
 		{
-		  fprintf (stderr,
-			   "++++Advance head frontier (one pos): tok=%d, ",
-			   tok_curr);
-		  symb_print (stderr, toks[tok_curr].symb, TRUE);
-		  fprintf (stderr, "\n");
-#endif
+		  new_symb = sit->rule->lhs;
+		  if (STATIC_CAST(int *, VLO_BEGIN (core_symbol_check_vlo))[new_symb->
+								  num] !=
+		      core_symbol_check)
+		    {
+		      /* Put the LHS symbol into queue.  */
+		      VLO_ADD_MEMORY (core_symbol_queue_vlo,
+				      &new_symb, sizeof (new_symb));
+		      STATIC_CAST(int *, VLO_BEGIN (core_symbol_check_vlo))[new_symb->
+								  num] =
+			core_symbol_check;
+		    }
 		}
-	      push_recovery_state (state.last_original_pl_el, cost + 1);
 	    }
-	  tok_curr--;
-	}
-      set = pl[pl_curr];
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
-	{
-	  fprintf (stderr, "++++Trying set=%d, tok=%d, ", pl_curr, tok_curr);
-	  symb_print (stderr, toks[tok_curr].symb, TRUE);
-	  fprintf (stderr, "\n");
 	}
+    }
+}
 #endif
-      /* Shift error: */
-      core_symb_vect = core_symb_vect_find (set->core, grammar->term_error);
-      assert (core_symb_vect != NULL);
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
-	fprintf (stderr, "++++Making error shift in set=%d\n", pl_curr);
+
+/* The following function adds the rest (non-start) situations to the
+   new set and and forms triples (set core, symbol, indexes) for
+   further fast search of start situations from given core by
+   transition on given symbol (see comment for abstract data
+   `core_symb_vect'). */
+#if MAKE_INLINE
+INLINE
 #endif
-      build_new_set (set, core_symb_vect, -1);
-      pl[++pl_curr] = new_set;
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
+static void
+expand_new_start_set (void)
+{
+  struct sit *sit;
+  struct symb *symb;
+  struct core_symb_vect *core_symb_vect;
+  size_t i;
+  size_t _tmp_i;
+
+  /* Add non start situations with nonzero distances. */
+  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_n_start_sits); i++)
+    {
+      _tmp_i = i;
+      assert (_tmp_i <= YAEP_STATIC_CAST(size_t, INT_MAX));
+      add_derived_nonstart_sits (new_sits[i], YAEP_STATIC_CAST(int, _tmp_i));
+    }
+  set_new_mark_nonstart_sits ();
+  /* Add non start situations and form transitions vectors.  The
+     situations with zero distance are added by the prediction
+     closures which also contain the situations formed by skipping
+     symbols deriving empty string. */
+  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_core->n_sits); i++)
+    {
+      sit = new_sits[i];
+      if (sit->pos < sit->rule->rhs_len)
 	{
-	  fprintf (stderr, "++Trying new set=%d\n", pl_curr);
-	  if (grammar->debug_level > 3)
-	    {
-	      set_print (stderr, new_set, pl_curr, grammar->debug_level > 4,
-			 grammar->debug_level > 5);
-	      fprintf (stderr, "\n");
-	    }
-	}
-#endif
-      /* Search the first right token. */
-      while (tok_curr < toks_len)
-	{
-	  core_symb_vect = core_symb_vect_find (new_core,
-						toks[tok_curr].symb);
-	  if (core_symb_vect != NULL)
-	    break;
-#ifndef NO_YAEP_DEBUG_PRINT
-	  if (grammar->debug_level > 2)
+	  /* There is a symbol after dot in the situation. */
+	  symb = sit->rule->rhs[sit->pos];
+	  core_symb_vect = core_symb_vect_find (new_core, symb);
+	  if (core_symb_vect == NULL)
 	    {
-	      fprintf (stderr, "++++++Skipping=%d ", tok_curr);
-	      symb_print (stderr, toks[tok_curr].symb, TRUE);
-	      fprintf (stderr, "\n");
+	      core_symb_vect = core_symb_vect_new (new_core, symb);
+	      if (!symb->term_p)
+		set_new_add_prediction (symb);
 	    }
-#endif
-	  cost++;
-	  tok_curr++;
-	  if (cost >= best_cost)
-	    /* This state is worse.  Reject it. */
-	    break;
-	}
-      if (cost >= best_cost)
-	{
-#ifndef NO_YAEP_DEBUG_PRINT
-	  if (grammar->debug_level > 2)
-	    fprintf
-	      (stderr,
-	       "++++Too many ignored tokens %d (already worse recovery)\n",
-	       cost);
-#endif
-	  /* This state is worse.  Reject it. */
-	  continue;
-	}
-      if (tok_curr >= toks_len)
-	{
-#ifndef NO_YAEP_DEBUG_PRINT
-	  if (grammar->debug_level > 2)
-	    fprintf
-	      (stderr,
-	       "++++We achieved EOF without matching -- reject this state\n");
-#endif
-	  /* Go to the next recovery state.  To guarantee that pl does
-	     not grows to much we don't push secondary error recovery
-	     states without matching in primary error recovery state.
-	     So we can say that pl length at most twice length of
-	     tokens array. */
-	  continue;
+  _tmp_i = i;
+  assert (_tmp_i <= YAEP_STATIC_CAST(size_t, INT_MAX));
+  core_symb_vect_new_add_transition_el (core_symb_vect, YAEP_STATIC_CAST(int, _tmp_i));
 	}
-      /* Shift the found token. */
-      lookahead_term_num = (tok_curr + 1 < toks_len
-			    ? toks[tok_curr + 1].symb->u.term.term_num : -1);
-      build_new_set (new_set, core_symb_vect, lookahead_term_num);
-      pl[++pl_curr] = new_set;
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 3)
+    }
+  /* Now forming reduce vectors. */
+  for (i = 0; i < YAEP_STATIC_CAST(size_t, new_core->n_sits); i++)
+    {
+      sit = new_sits[i];
+      if (sit->pos == sit->rule->rhs_len)
 	{
-	  fprintf (stderr, "++++++++Building new set=%d\n", pl_curr);
-	  if (grammar->debug_level > 3)
-	    set_print (stderr, new_set, pl_curr, grammar->debug_level > 4,
-		       grammar->debug_level > 5);
+	  symb = sit->rule->lhs;
+	  core_symb_vect = core_symb_vect_find (new_core, symb);
+	  if (core_symb_vect == NULL)
+	    core_symb_vect = core_symb_vect_new (new_core, symb);
+      _tmp_i = i;
+      assert (_tmp_i <= YAEP_STATIC_CAST(size_t, INT_MAX));
+      core_symb_vect_new_add_reduce_el (core_symb_vect, YAEP_STATIC_CAST(int, _tmp_i));
 	}
+    }
+#ifdef TRANSITIVE_TRANSITION
+  form_transitive_transition_vectors ();
 #endif
-      n_matched_toks = 0;
-      for (;;)
+  if (grammar->lookahead_level > 1)
+    {
+      struct sit *new_sit, *shifted_sit;
+      term_set_el_t *context_set;
+  int changed_p, sit_ind, context; ptrdiff_t j;
+
+      /* Now we have incorrect initial situations because their
+         context is not correct. */
+      context_set = term_set_create ();
+      do
 	{
-#ifndef NO_YAEP_DEBUG_PRINT
-	  if (grammar->debug_level > 2)
-	    {
-	      fprintf (stderr, "++++++Matching=%d ", tok_curr);
-	      symb_print (stderr, toks[tok_curr].symb, TRUE);
-	      fprintf (stderr, "\n");
-	    }
-#endif
-	  n_matched_toks++;
-	  if (n_matched_toks >= grammar->recovery_token_matches)
-	    break;
-	  tok_curr++;
-	  if (tok_curr >= toks_len)
-	    break;
-	  /* Push secondary recovery state (with error in set). */
-	  if (core_symb_vect_find (new_core, grammar->term_error) != NULL)
+	  changed_p = FALSE;
+  for (i = YAEP_STATIC_CAST(size_t, new_core->n_all_dists);
+       i < YAEP_STATIC_CAST(size_t, new_core->n_sits);
+       i++)
 	    {
-#ifndef NO_YAEP_DEBUG_PRINT
-	      if (grammar->debug_level > 2)
+	      term_set_clear (context_set);
+	      new_sit = new_sits[i];
+	      core_symb_vect = core_symb_vect_find (new_core,
+						    new_sit->rule->lhs);
+	      for (j = 0; j < core_symb_vect->transitions.len; j++)
 		{
-		  fprintf
-		    (stderr,
-		     "++++Found secondary state: original set=%d, tok=%d, ",
-		     state.last_original_pl_el, tok_curr);
-		  symb_print (stderr, toks[tok_curr].symb, TRUE);
-		  fprintf (stderr, "\n");
+		  sit_ind = core_symb_vect->transitions.els[j];
+		  sit = new_sits[sit_ind];
+		  shifted_sit = sit_create (sit->rule, sit->pos + 1,
+					    sit->context);
+		  term_set_or (context_set, shifted_sit->lookahead);
+		}
+	      context = term_set_insert (context_set);
+	      if (context >= 0)
+		context_set = term_set_create ();
+	      else
+		context = -context - 1;
+	      sit = sit_create (new_sit->rule, new_sit->pos, context);
+	      if (sit != new_sit)
+		{
+		  new_sits[i] = sit;
+		  changed_p = TRUE;
 		}
-#endif
-	      push_recovery_state (state.last_original_pl_el, cost);
-	    }
-	  core_symb_vect
-	    = core_symb_vect_find (new_core, toks[tok_curr].symb);
-	  if (core_symb_vect == NULL)
-	    break;
-	  lookahead_term_num = (tok_curr + 1 < toks_len
-				? toks[tok_curr + 1].symb->u.term.term_num
-				: -1);
-	  build_new_set (new_set, core_symb_vect, lookahead_term_num);
-	  pl[++pl_curr] = new_set;
-	}
-      if (n_matched_toks >= grammar->recovery_token_matches
-	  || tok_curr >= toks_len)
-	{
-	  /* We found an error recovery.  Compare costs. */
-	  if (best_cost > cost)
-	    {
-#ifndef NO_YAEP_DEBUG_PRINT
-	      if (grammar->debug_level > 2)
-		fprintf
-		  (stderr,
-		   "++++Ignore %d tokens (the best recovery now): Save it:\n",
-		   cost);
-#endif
-	      best_cost = cost;
-	      if (tok_curr == toks_len)
-		tok_curr--;
-	      best_state = new_recovery_state (state.last_original_pl_el,
-					       /* It may be any constant here
-					          because it is not used. */
-					       0);
-	      *start = start_tok_curr - state.backward_move_cost;
-	      *stop = *start + cost;
 	    }
-#ifndef NO_YAEP_DEBUG_PRINT
-	  else if (grammar->debug_level > 2)
-	    fprintf (stderr, "++++Ignore %d tokens (worse recovery)\n", cost);
-#endif
 	}
-#ifndef NO_YAEP_DEBUG_PRINT
-      else if (cost < best_cost && grammar->debug_level > 2)
-	fprintf (stderr, "++++No %d matched tokens  -- reject this state\n",
-		 grammar->recovery_token_matches);
-#endif
+      while (changed_p);
     }
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 2)
-    fprintf (stderr, "\n++Finishing error recovery: Restore best state\n");
-#endif
-  set_recovery_state (&best_state);
+  set_new_core_stop ();
+  core_symb_vect_new_all_stop ();
+}
+
+/* The following function forms the 1st set. */
+static void
+build_start_set (void)
+{
+  struct rule *rule;
+  struct sit *sit;
+  term_set_el_t *context_set;
+  int context;
+
+  set_new_start ();
+  if (grammar->lookahead_level <= 1
+      /* The empty context can be already in the table of the parse
+	 cache. */
+      || VLO_LENGTH (term_sets_ptr->tab_term_set_vlo) != 0)
+    context = 0;
+  else
+    {
+      context_set = term_set_create ();
+      term_set_clear (context_set);
+      context = term_set_insert (context_set);
+      /* Empty context in the table has always number zero. */
+      assert (context == 0);
+    }
+  for (rule = grammar->axiom->u.nonterm.rules;
+       rule != NULL; rule = rule->lhs_next)
+    {
+      sit = sit_create (rule, 0, context);
+      set_new_add_start_sit (sit, 0);
+    }
+  /* The start set can be already in the parse cache. */
+  if (set_insert ())
+    expand_new_start_set ();
+  pl[0] = new_set;
 #ifndef NO_YAEP_DEBUG_PRINT
   if (grammar->debug_level > 2)
     {
-      fprintf (stderr, "\n++Error recovery end: curr token %d=", tok_curr);
-      symb_print (stderr, toks[tok_curr].symb, TRUE);
-      fprintf (stderr, ", Current set=%d:\n", pl_curr);
+      fprintf (stderr, "\nParsing start...\n");
       if (grammar->debug_level > 3)
-	set_print (stderr, pl[pl_curr], pl_curr, grammar->debug_level > 4,
+	set_print (stderr, new_set, 0, grammar->debug_level > 4,
 		   grammar->debug_level > 5);
     }
 #endif
-  OS_DELETE (recovery_state_tail_sets);
-}
-
-/* Initialize work with error recovery. */
-static void
-error_recovery_init (void)
-{
-  VLO_CREATE (original_pl_tail_stack, grammar->alloc, 4096);
-  VLO_CREATE (recovery_state_stack, grammar->alloc, 4096);
-}
-
-/* Finalize work with error recovery. */
-static void
-error_recovery_fin (void)
-{
-  VLO_DELETE (recovery_state_stack);
-  VLO_DELETE (original_pl_tail_stack);
 }
-
-
-
 
-#if MAKE_INLINE
-INLINE
-#endif
-/* Return TRUE if goto set SET from parsing list PLACE can be used as
-   the next set.  The criterium is that all origin sets of start
-   situations are the same as from PLACE.  */
-static int
-check_cached_transition_set (struct set *set, int place)
+/* The following function returns Leo item of PLACE and SYMB or NULL
+   if the reduction path of SYMB at PLACE is not deterministic.  The
+   function forms the item and the next items of its path if it is
+   necessary.  */
+static struct leo_item *
+leo_item_find (int place, struct symb *symb)
 {
-  int i, dist;
-  int *dists = set->dists;
+  struct leo_item *item, *first, *last, *top, *curr, **items;
+  struct set *set;
+  struct set_core *set_core;
+  struct core_symb_vect *core_symb_vect;
+  struct sit *sit;
+  int sit_ind, orig;
+  size_t n;
 
-  for (i = set->core->n_start_sits - 1; i >= 0; i--)
+  first = last = NULL;
+  for (;;)
     {
-      if ((dist = dists[i]) <= 1)
-	continue;
-      /* Sets at origins of situations with distance one are supposed
-         to be the same.  */
-      if (pl[pl_curr + 1 - dist] != pl[place + 1 - dist])
-	return FALSE;
-    }
-  return TRUE;
-}
-
-/* How many times we reuse Earley's sets without their
-   recalculation.  */
-static int n_goto_successes;
-
-/* The following function is major function forming parsing list in
-   Earley's algorithm. */
-static void
-build_pl (void)
-{
-  int i;
-  struct symb *term;
-  struct set *set;
-  struct core_symb_vect *core_symb_vect;
-  int lookahead_term_num;
-#ifdef USE_SET_HASH_TABLE
-  hash_table_entry_t *entry;
-  struct set_term_lookahead *new_set_term_lookahead;
-#endif
-
-  error_recovery_init ();
-  build_start_set ();
-  lookahead_term_num = -1;
-  for (tok_curr = pl_curr = 0; tok_curr < toks_len; tok_curr++)
-    {
-      term = toks[tok_curr].symb;
-      /* Early debug snapshot to help fuzz triage. Guarded by
-         YAEP_FUZZ_DEBUG to avoid noisy output in normal runs. */
-      if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
-        {
-          fprintf (stderr, "YAEP_DEBUG_LOOP tok=%d toks_len=%d toks=%p toks[idx]=%p term=%p\n",
-                   tok_curr, toks_len, YAEP_STATIC_CAST(void *, toks),
-                   YAEP_STATIC_CAST(void *, (tok_curr < toks_len ? &toks[tok_curr] : NULL)),
-                   YAEP_STATIC_CAST(void *, term));
-          fflush (stderr);
-        }
-      if (grammar->lookahead_level != 0)
-	lookahead_term_num = (tok_curr < toks_len - 1
-			      ? toks[tok_curr +
-				     1].symb->u.term.term_num : -1);
-
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
+      n = VLO_NELS (leo_items_vlo, struct leo_item *);
+      if (YAEP_STATIC_CAST(size_t, place) >= n)
 	{
-	  fprintf (stderr, "\nReading %d=", tok_curr);
-	  symb_print (stderr, term, TRUE);
-	  fprintf (stderr, ", Current set=%d\n", pl_curr);
+	  VLO_EXPAND (leo_items_vlo,
+		      (YAEP_STATIC_CAST(size_t, place) + 1 - n)
+		      * sizeof (struct leo_item *));
+	  items = YAEP_STATIC_CAST(struct leo_item **, VLO_BEGIN (leo_items_vlo));
+	  for (; n <= YAEP_STATIC_CAST(size_t, place); n++)
+	    items[n] = NULL;
 	}
-#endif
-      set = pl[pl_curr];
-      new_set = NULL;
-#ifdef USE_SET_HASH_TABLE
-      OS_TOP_EXPAND (set_term_lookahead_os,
-		     sizeof (struct set_term_lookahead));
-      new_set_term_lookahead =
-	YAEP_STATIC_CAST(struct set_term_lookahead *, OS_TOP_BEGIN (set_term_lookahead_os));
-      new_set_term_lookahead->set = set;
-      new_set_term_lookahead->term = term;
-      new_set_term_lookahead->lookahead = lookahead_term_num;
-      for (i = 0; i < MAX_CACHED_GOTO_RESULTS; i++)
-	new_set_term_lookahead->result[i] = NULL;
-      new_set_term_lookahead->curr = 0;
-      entry =
-    find_hash_table_entry (set_term_lookahead_tab, new_set_term_lookahead,
-               TRUE);
-
-      /* Optional runtime debug logging for fuzz triage. If the
-         environment variable YAEP_FUZZ_DEBUG is set, emit a single
-         line with key pointers and token info which helps trace the
-         state leading to crashes without changing program flow. */
-      if (getenv ("YAEP_FUZZ_DEBUG") != NULL)
-        {
-          const char *trepr = (term && term->repr) ? term->repr : "(null)";
-          fprintf (stderr, "YAEP_DEBUG tok=%d pl=%d term=%p repr='%s' set=%p entry=%p *entry=%p\n",
-                   tok_curr, pl_curr, YAEP_STATIC_CAST(void *, term), trepr, YAEP_STATIC_CAST(void *, set),
-                   YAEP_STATIC_CAST(void *, entry), YAEP_STATIC_CAST(void *, (entry ? *entry : NULL)));
-          /* fflush to ensure log reaches fuzzer output */
-          fflush (stderr);
-        }
-      if (*entry != NULL)
-    {
-      /* The entry stores a mutable set_term_lookahead owned by the
-         hash table. We intentionally cast through (void*) once here
-         to obtain a mutable local pointer for subsequent mutations
-         and checks. This documents the deliberate removal of the
-         const qualifier at the mutation site while keeping the
-         public API (hash_table_entry_t) const. */
-      struct set_term_lookahead *tab_ent = YAEP_STATIC_CAST(struct set_term_lookahead *, YAEP_STATIC_CAST(void *, *entry));
-      struct set *tab_set;
-
-      OS_TOP_NULLIFY (set_term_lookahead_os);
-      for (i = 0; i < MAX_CACHED_GOTO_RESULTS; i++)
-        if ((tab_set = tab_ent->result[i]) == NULL)
-          break;
-        else if (check_cached_transition_set
-             (tab_set,
-              tab_ent->place[i]))
-          {
-        new_set = tab_set;
-        n_goto_successes++;
-        break;
-          }
-    }
-      else
+      items = YAEP_STATIC_CAST(struct leo_item **, VLO_BEGIN (leo_items_vlo));
+      for (item = items[place]; item != NULL; item = item->place_next)
+	if (item->symb == symb)
+	  break;
+      if (item != NULL)
+	break;
+      OS_TOP_EXPAND (leo_items_os, sizeof (struct leo_item));
+      item = YAEP_STATIC_CAST(struct leo_item *, OS_TOP_BEGIN (leo_items_os));
+      OS_TOP_FINISH (leo_items_os);
+      n_leo_items++;
+      item->place = place;
+      item->symb = symb;
+      item->sit = NULL;
+      item->orig = place;
+      item->next = item->top = NULL;
+      item->place_next = items[place];
+      items[place] = item;
+      set = pl[place];
+      set_core = set->core;
+      core_symb_vect = core_symb_vect_find (set_core, symb);
+      if (core_symb_vect != NULL && core_symb_vect->transitions.len == 1)
 	{
-	  OS_TOP_FINISH (set_term_lookahead_os);
-       /* Cache the newly-created mutable lookahead struct in the
-         table. Deliberately cast through (void*) to document that
-         this is owned mutable data stored in a const-typed slot. */
-       *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, new_set_term_lookahead));
-	  n_set_term_lookaheads++;
-	}
-
+	  sit_ind = core_symb_vect->transitions.els[0];
+	  sit = set_core->sits[sit_ind];
+	  orig = place;
+	  if (sit_ind < set_core->n_all_dists)
+	    {
+	      if (sit_ind >= set_core->n_start_sits)
+		sit_ind = set_core->parent_indexes[sit_ind];
+#ifndef ABSOLUTE_DISTANCES
+	      orig = place - set->dists[sit_ind];
+#else
+	      orig = set->dists[sit_ind];
 #endif
-      if (new_set == NULL)
-	{
-	  core_symb_vect = core_symb_vect_find (set->core, term);
-	  if (core_symb_vect == NULL)
+	    }
+	  /* The origin check excludes cycles in the paths.  */
+	  if (sit->pos + 1 == sit->rule->rhs_len && orig < place)
 	    {
-	      int saved_tok_curr, start, stop;
-
-	      /* Error recovery.  We do not check transition vector
-	         because for terminal transition vector is never NULL
-	         and reduce is always NULL. */
-	      saved_tok_curr = tok_curr;
-	      if (grammar->error_recovery_p)
-		{
-		  error_recovery (&start, &stop);
-		  syntax_error (saved_tok_curr, toks[saved_tok_curr].attr,
-				start, toks[start].attr, stop,
-				toks[stop].attr);
-		  continue;
-		}
-	      else
-		{
-		  syntax_error (saved_tok_curr, toks[saved_tok_curr].attr,
-				-1, NULL, -1, NULL);
-		  break;
-		}
+	      item->sit = sit_create (sit->rule, sit->pos + 1, sit->context);
+	      item->orig = orig;
 	    }
-	  build_new_set (set, core_symb_vect, lookahead_term_num);
-#ifdef USE_SET_HASH_TABLE
-	  /* Save (set, term, lookahead) -> new_set in the table.  */
-      /* Mutate the stored table entry — obtain local mutable pointer
-         via documented void* cast as above. */
-      {
-        struct set_term_lookahead *tab_ent = YAEP_STATIC_CAST(struct set_term_lookahead *, YAEP_STATIC_CAST(void *, *entry));
-        i = tab_ent->curr;
-        tab_ent->result[i] = new_set;
-        tab_ent->place[i] = pl_curr;
-        tab_ent->lookahead = lookahead_term_num;
-        tab_ent->curr = (i + 1) % MAX_CACHED_GOTO_RESULTS;
-      }
-#endif
-	}
-      pl[++pl_curr] = new_set;
-#ifndef NO_YAEP_DEBUG_PRINT
-      if (grammar->debug_level > 2)
-	{
-	  fprintf (stderr, "New set=%d\n", pl_curr);
-	  if (grammar->debug_level > 3)
-	    set_print (stderr, new_set, pl_curr, grammar->debug_level > 4,
-		       grammar->debug_level > 5);
 	}
-#endif
+      if (item->sit == NULL)
+	break;
+      /* Form the next item of the path.  */
+      if (last == NULL)
+	first = item;
+      else
+	last->next = item;
+      last = item;
+      place = item->orig;
+      symb = item->sit->rule->lhs;
     }
-  error_recovery_fin ();
+  if (item->sit == NULL)
+    top = last;
+  else
+    {
+      if (last != NULL)
+	last->next = item;
+      top = item->top;
+    }
+  for (curr = first; curr != NULL && curr->top == NULL; curr = curr->next)
+    curr->top = top;
+  if (first != NULL)
+    return first;
+  return item->sit == NULL ? NULL : item;
 }
-
-
-
-/* This page contains code to work with parse states. */
-
-/* The following describes parser state. */
-struct parse_state
-{
-  /* The rule which we are processing. */
-  struct rule *rule;
-  /* Position in the rule where we are now. */
-  int pos;
-  /* The rule origin (start point of derivated string from rule rhs)
-     and parser list in which we are now. */
-  int orig, pl_ind;
-  /* If the following value is NULL, then we do not need to create
-     translation for this rule.  If we should create abstract node
-     for this rule, the value refers for the abstract node and the
-     displacement is undefined.  Otherwise, the two members is
-     place into which we should place the translation of the rule.
-     The following member is used only for states in the stack. */
-  struct parse_state *parent_anode_state;
-  int parent_disp;
-  /* The following is used only for states in the table. */
-  struct yaep_tree_node *anode;
-};
-
-/* The following os contains all allocated parser states. */
-#ifndef __cplusplus
-static os_t parse_state_os;
-#else
-static os_t *parse_state_os;
-#endif
-
-/* The following variable refers to head of chain of already allocated
-   and then freed parser states. */
-static struct parse_state *free_parse_state;
-
-/* The following table is used to make translation for ambiguous
-   grammar more compact.  It is used only when we want all
-   translations. */
-static hash_table_t parse_state_tab;	/* Key is rule, orig, pl_ind. */
 
-/* Hash of parse state. */
-static unsigned
-parse_state_hash (hash_table_entry_t s)
+/* The following function saves usage of Leo ITEM in the set at
+   PLACE.  */
+static void
+leo_use_add (int place, struct leo_item *item)
 {
-  /* Treat the incoming entry as const because the hash function only
-     reads fields; this avoids casting away const at call sites and
-     documents that we won't mutate the stored object here. */
-  const struct parse_state *state = (YAEP_STATIC_CAST(const struct parse_state *, s));
-
-  /* The table contains only states with dot at the end of rule. */
-  assert (state->pos == state->rule->rhs_len);
-  return (((jauquet_prime_mod32 * hash_shift +
-      YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, state->rule))) * hash_shift +
-     YAEP_STATIC_CAST(unsigned, state->orig)) * hash_shift + YAEP_STATIC_CAST(unsigned, state->pl_ind));
-}
+  struct leo_use use;
 
-/* Equality of parse states. */
-static int
-parse_state_eq (hash_table_entry_t s1, hash_table_entry_t s2)
-{
-  /* Equality comparison only reads the structures; keep pointers const
-     to avoid casting away qualifiers and to make intent explicit. */
-  const struct parse_state *state1 = (YAEP_STATIC_CAST(const struct parse_state *, s1));
-  const struct parse_state *state2 = (YAEP_STATIC_CAST(const struct parse_state *, s2));
+  if (VLO_LENGTH (leo_uses_vlo) != 0)
+    {
+      struct leo_use *last
+	= &(YAEP_STATIC_CAST(struct leo_use *, VLO_BOUND (leo_uses_vlo)))[-1];
 
-  /* The table contains only states with dot at the end of rule. */
-  assert (state1->pos == state1->rule->rhs_len
-    && state2->pos == state2->rule->rhs_len);
-  return (state1->rule == state2->rule && state1->orig == state2->orig
-    && state1->pl_ind == state2->pl_ind);
+      if (last->place == place && last->item == item)
+	return;
+    }
+  use.place = place;
+  use.item = item;
+  VLO_ADD_MEMORY (leo_uses_vlo, &use, sizeof (use));
+  n_leo_uses++;
 }
 
-/* The following function initializes work with parser states. */
+/* The following function builds new set by shifting situations of SET
+   given in CORE_SYMB_VECT with given lookahead terminal number.  If
+   the number is negative, we ignore lookahead at all. */
 static void
-parse_state_init (void)
+build_new_set (struct set *set, struct core_symb_vect *core_symb_vect,
+	       int lookahead_term_num)
 {
-  free_parse_state = NULL;
-  OS_CREATE (parse_state_os, grammar->alloc, 0);
-  if (!grammar->one_parse_p)
-#ifndef __cplusplus
-    parse_state_tab =
-      create_hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 2, parse_state_hash,
-			 parse_state_eq);
-#else
-    parse_state_tab =
-      new hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 2, parse_state_hash,
-		      parse_state_eq);
-#endif
-}
+  struct set *prev_set;
+  struct set_core *set_core, *prev_set_core;
+  struct sit *sit, *new_sit, **prev_sits;
+  struct core_symb_vect *prev_core_symb_vect;
+  struct leo_item *leo;
+  int local_lookahead_level, dist, sit_ind, new_dist;
+  int i, place;
+  struct vect *transitions;
 
-/* The following function returns new parser state. */
-#if MAKE_INLINE
-INLINE
+  local_lookahead_level = (lookahead_term_num < 0
+			   ? 0 : grammar->lookahead_level);
+  set_core = set->core;
+  set_new_start ();
+#ifdef TRANSITIVE_TRANSITION
+  curr_sit_check++;
+  transitions = &core_symb_vect->transitive_transitions;
+#else
+  transitions = &core_symb_vect->transitions;
 #endif
-static struct parse_state *
-parse_state_alloc (void)
-{
-  struct parse_state *result;
-
-  if (free_parse_state == NULL)
+  empty_sit_dist_set ();
+  for (i = 0; i < transitions->len; i++)
     {
-      OS_TOP_EXPAND (parse_state_os, sizeof (struct parse_state));
-      result = YAEP_STATIC_CAST(struct parse_state *, OS_TOP_BEGIN (parse_state_os));
-      OS_TOP_FINISH (parse_state_os);
+      sit_ind = transitions->els[i];
+      sit = set_core->sits[sit_ind];
+      new_sit = sit_create (sit->rule, sit->pos + 1, sit->context);
+      if (local_lookahead_level != 0
+	  && !term_set_test (new_sit->lookahead, lookahead_term_num)
+	  && !term_set_test (new_sit->lookahead, grammar->term_error_num))
+	continue;
+#ifndef ABSOLUTE_DISTANCES
+      dist = 0;
+#else
+      dist = pl_curr;
+#endif
+      if (sit_ind >= set_core->n_all_dists)
+#ifdef TRANSITIVE_TRANSITION
+	new_sit->sit_check = curr_sit_check;
+#else
+	;
+#endif
+      else if (sit_ind < set_core->n_start_sits)
+	dist = set->dists[sit_ind];
+      else
+	dist = set->dists[set_core->parent_indexes[sit_ind]];
+#ifndef ABSOLUTE_DISTANCES
+      dist++;
+#endif
+      if (sit_dist_insert (new_sit, dist))
+	set_new_add_start_sit (new_sit, dist);
     }
-  else
+  for (i = 0; i < new_n_start_sits; i++)
     {
-      result = free_parse_state;
-      free_parse_state = YAEP_REINTERPRET_CAST(struct parse_state *, free_parse_state->rule);
-    }
-  return result;
-}
-
-/* The following function frees STATE. */
-#if MAKE_INLINE
-INLINE
+      new_sit = new_sits[i];
+      if (new_sit->empty_tail_p
+#ifdef TRANSITIVE_TRANSITION
+	  && new_sit->sit_check != curr_sit_check
 #endif
-static void
-parse_state_free (struct parse_state *state)
-{
-  state->rule = YAEP_REINTERPRET_CAST(struct rule *, free_parse_state);
-  free_parse_state = state;
-}
+	)
+	{
+	  int *curr_el, *bound;
 
-/* The following function searches for state in the table with the
-   same characteristics as *STATE.  If it found it, it returns pointer
-   to the state in the table.  Otherwise the function makes copy of
-   *STATE, inserts into the table and returns pointer to copied state.
-   In the last case, the function also sets up *NEW_P. */
-#if MAKE_INLINE
-INLINE
+	  /* All tail in new sitiation may derivate empty string so
+	     make reduce and add new situations. */
+	  new_dist = new_dists[i];
+#ifndef ABSOLUTE_DISTANCES
+	  place = pl_curr + 1 - new_dist;
+#else
+	  place = new_dist;
 #endif
-static struct parse_state *
-parse_state_insert (struct parse_state *state, int *new_p)
-{
-  hash_table_entry_t *entry;
-
-#ifndef __cplusplus
-  entry = find_hash_table_entry (parse_state_tab, state, TRUE);
+	  if (curr_leo_p && !leo_off_p
+	      && (leo = leo_item_find (place, new_sit->rule->lhs)) != NULL
+	      && leo->next != NULL)
+	    {
+	      /* Add only the topmost situation of the deterministic
+		 reduction path.  The static lookahead of the situation
+		 is a subset of ones of other path situations. */
+	      new_sit = leo->top->sit;
+	      if (local_lookahead_level != 0
+		  && !term_set_test (new_sit->lookahead, lookahead_term_num)
+		  && !term_set_test (new_sit->lookahead,
+				     grammar->term_error_num))
+		continue;
+#ifndef ABSOLUTE_DISTANCES
+	      dist = pl_curr + 1 - leo->top->orig;
 #else
-  entry = parse_state_tab->find_entry (state, TRUE);
+	      dist = leo->top->orig;
 #endif
-  *new_p = FALSE;
-  if (*entry != NULL)
-    return YAEP_STATIC_CAST(struct parse_state *, *entry);
-  *new_p = TRUE;
-  /* We make copy because pl_ind can be changed in further processing
-     state. */
-  *entry = parse_state_alloc ();
-  *YAEP_STATIC_CAST(struct parse_state *, *entry) = *state;
-  return YAEP_STATIC_CAST(struct parse_state *, *entry);
-}
-
-/* The following function finalizes work with parser states. */
-static void
-parse_state_fin (void)
-{
-  if (!grammar->one_parse_p)
-#ifndef __cplusplus
-    delete_hash_table (parse_state_tab);
+	      if (sit_dist_insert (new_sit, dist))
+		set_new_add_start_sit (new_sit, dist);
+	      leo_use_add (pl_curr + 1, leo);
+	      continue;
+	    }
+	  prev_set = pl[place];
+	  prev_set_core = prev_set->core;
+	  prev_core_symb_vect = core_symb_vect_find (prev_set_core,
+						     new_sit->rule->lhs);
+	  if (prev_core_symb_vect == NULL)
+	    {
+	      assert (new_sit->rule->lhs == grammar->axiom);
+	      continue;
+	    }
+#ifdef TRANSITIVE_TRANSITION
+	  curr_el = prev_core_symb_vect->transitive_transitions.els;
+	  bound = curr_el + prev_core_symb_vect->transitive_transitions.len;
 #else
-    delete parse_state_tab;
+	  curr_el = prev_core_symb_vect->transitions.els;
+	  bound = curr_el + prev_core_symb_vect->transitions.len;
 #endif
-  OS_DELETE (parse_state_os);
+	  assert (curr_el != NULL);
+	  prev_sits = prev_set_core->sits;
+	  do
+	    {
+	      sit_ind = *curr_el++;
+	      sit = prev_sits[sit_ind];
+	      new_sit = sit_create (sit->rule, sit->pos + 1, sit->context);
+	      if (local_lookahead_level != 0
+		  && !term_set_test (new_sit->lookahead, lookahead_term_num)
+		  && !term_set_test (new_sit->lookahead,
+				     grammar->term_error_num))
+		continue;
+#ifndef ABSOLUTE_DISTANCES
+	      dist = 0;
+#else
+	      dist = new_dist;
+#endif
+	      if (sit_ind >= prev_set_core->n_all_dists)
+#ifdef TRANSITIVE_TRANSITION
+		new_sit->sit_check = curr_sit_check;
+#else
+		;
+#endif
+	      else if (sit_ind < prev_set_core->n_start_sits)
+		dist = prev_set->dists[sit_ind];
+	      else
+		dist =
+		  prev_set->dists[prev_set_core->parent_indexes[sit_ind]];
+#ifndef ABSOLUTE_DISTANCES
+	      dist += new_dist;
+#endif
+	      if (sit_dist_insert (new_sit, dist))
+		set_new_add_start_sit (new_sit, dist);
+	    }
+	  while (curr_el < bound);
+	}
+    }
+  if (set_insert ())
+    {
+      expand_new_start_set ();
+      new_core->term = core_symb_vect->symb;
+    }
 }
 
 
 
-#ifndef NO_YAEP_DEBUG_PRINT
-
-/* This page conatins code to traverse translation. */
+/* This page contains error recovery code.  This code finds minimal
+   cost error recovery.  The cost of error recovery is number of
+   tokens ignored by error recovery.  The error recovery is successful
+   when we match at least RECOVERY_TOKEN_MATCHES tokens. */
 
-/* To make better traversing and don't waist tree parse memory,
-   we use the following structures to enumerate the tree node. */
-struct trans_visit_node
+/* The following strucrture describes an error recovery state (an
+   error recovery alternative. */
+struct recovery_state
 {
-  /* The following member is order number of the node.  This value is
-     negative if we did not visit the node yet. */
-  int num;
-  /* The tree node itself. */
-  struct yaep_tree_node *node;
+  /* The following three members define start pl used to given error
+     recovery state (alternative). */
+  /* The following members define what part of original (at the error
+     recovery start) pl will be head of error recovery state.  The
+     head will be all states from original pl with indexes in range
+     [0, last_original_pl_el]. */
+  int last_original_pl_el;
+  /* The following two members define tail of pl for this error
+     recovery state. */
+  int pl_tail_length;
+  struct set **pl_tail;
+  /* The following member is index of start token for given error
+     recovery state. */
+  int start_tok;
+  /* The following member value is number of tokens already ignored in
+     order to achieved given error recovery state. */
+  int backward_move_cost;
 };
 
-/* The key of the following table is node itself. */
-static hash_table_t trans_visit_nodes_tab;
+/* All tail sets of error recovery are saved in the following os. */
+#define recovery_state_tail_sets (curr_parser->x_recovery_state_tail_sets)
 
-/* All translation visit nodes are placed in the following stack.  All
-   the nodes are in the table. */
-#ifndef __cplusplus
-static os_t trans_visit_nodes_os;
-#else
-static os_t *trans_visit_nodes_os;
-#endif
+/* The following variable values is pl_curr and tok_curr at error
+   recovery start (when the original syntax error has been fixed). */
+#define start_pl_curr (curr_parser->x_start_pl_curr)
+#define start_tok_curr (curr_parser->x_start_tok_curr)
 
-/* The following value is number of translation visit nodes. */
-static int n_trans_visit_nodes;
+/* The following variable value means that all error sets in pl with
+   indexes [back_pl_frontier, start_pl_curr] are being processed or
+   have been processed. */
+#define back_pl_frontier (curr_parser->x_back_pl_frontier)
 
-/* Hash of translation visit node. */
-static unsigned
-trans_visit_node_hash (hash_table_entry_t n)
+/* The following variable stores original pl tail in reversed order.
+   This object only grows.  The last object sets may be used to
+   restore original pl in order to try another error recovery state
+   (alternative). */
+#define original_pl_tail_stack (curr_parser->x_original_pl_tail_stack)
+
+/* The following variable value is last pl element which is original
+   set (set before the error_recovery start). */
+#define original_last_pl_el (curr_parser->x_original_last_pl_el)
+
+/* The following function may be called if you know that pl has
+   original sets upto LAST element (including it).  Such call can
+   decrease number of restored sets. */
+#if MAKE_INLINE
+INLINE
+#endif
+static void
+set_original_set_bound (int last)
 {
-  /* The hash only needs to read the node pointer; use a const view to
-     avoid casting away qualifiers and to make intent explicit. */
-  const struct trans_visit_node *tn = (YAEP_STATIC_CAST(const struct trans_visit_node *, n));
-  return YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, tn->node));
+  assert (last >= 0 && last <= start_pl_curr
+	  && original_last_pl_el <= start_pl_curr);
+  original_last_pl_el = last;
 }
 
-/* Equality of translation visit nodes. */
-static int
-trans_visit_node_eq (hash_table_entry_t n1, hash_table_entry_t n2)
+/* The following function guarantees that original pl tail sets
+   starting with pl_curr (including the state) is saved.  The function
+   should be called after any decreasing pl_curr with subsequent
+   writing to pl [pl_curr]. */
+static void
+save_original_sets (void)
 {
-  const struct trans_visit_node *tn1 = (YAEP_STATIC_CAST(const struct trans_visit_node *, n1));
-  const struct trans_visit_node *tn2 = (YAEP_STATIC_CAST(const struct trans_visit_node *, n2));
-  return (tn1->node == tn2->node);
-}
+  int length, curr_pl;
 
-/* The following function checks presence translation visit node with
-   given NODE in the table and if it is not present in the table, the
-   function creates the translation visit node and inserts it into
-   the table. */
-static struct trans_visit_node *
-visit_node (struct yaep_tree_node *node)
-{
-  struct trans_visit_node trans_visit_node;
-  hash_table_entry_t *entry;
-
-  trans_visit_node.node = node;
-#ifndef __cplusplus
-  entry = find_hash_table_entry (trans_visit_nodes_tab,
-				 &trans_visit_node, TRUE);
-#else
-  entry = trans_visit_nodes_tab->find_entry (&trans_visit_node, TRUE);
+  assert (pl_curr >= 0 && original_last_pl_el <= start_pl_curr);
+  {
+    size_t _tmp_length = VLO_NELS (original_pl_tail_stack, struct set *);
+    assert (_tmp_length <= YAEP_STATIC_CAST(size_t, INT_MAX));
+    length = YAEP_STATIC_CAST(int, _tmp_length);
+  }
+  for (curr_pl = start_pl_curr - length; curr_pl >= pl_curr; curr_pl--)
+    {
+      VLO_ADD_MEMORY (original_pl_tail_stack, &pl[curr_pl],
+		      sizeof (struct set *));
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
+	{
+	  fprintf (stderr, "++++Save original set=%d\n", curr_pl);
+	  if (grammar->debug_level > 3)
+	    {
+	      set_print (stderr, pl[curr_pl], curr_pl,
+			 grammar->debug_level > 4, grammar->debug_level > 5);
+	      fprintf (stderr, "\n");
+	    }
+	}
 #endif
-  if (*entry == NULL)
+    }
+  original_last_pl_el = pl_curr - 1;
+}
+
+/* If it is necessary, the following function restores original pl
+   part with states in range [0, last_pl_el]. */
+static void
+restore_original_sets (int last_pl_el)
+{
+  assert (last_pl_el <= start_pl_curr
+	  && original_last_pl_el <= start_pl_curr);
+  if (original_last_pl_el >= last_pl_el)
     {
-      /* If it is the new node, we did not visit it yet. */
-      trans_visit_node.num = -1 - n_trans_visit_nodes;
-      n_trans_visit_nodes++;
-      OS_TOP_ADD_MEMORY (trans_visit_nodes_os,
-			 &trans_visit_node, sizeof (trans_visit_node));
-    /* Store newly-created trans_visit_node (owned/mutable) in the
-      global table; cast via void* to make the intent explicit. */
-    *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, OS_TOP_BEGIN (trans_visit_nodes_os)));
-      OS_TOP_FINISH (trans_visit_nodes_os);
+      original_last_pl_el = last_pl_el;
+      return;
+    }
+  for (;;)
+    {
+      original_last_pl_el++;
+      pl[original_last_pl_el]
+	= (YAEP_STATIC_CAST(struct set **, VLO_BEGIN (original_pl_tail_stack)))
+	[start_pl_curr - original_last_pl_el];
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
+	{
+	  fprintf (stderr, "++++++Restore original set=%d\n",
+		   original_last_pl_el);
+	  if (grammar->debug_level > 3)
+	    {
+	      set_print (stderr, pl[original_last_pl_el], original_last_pl_el,
+			 grammar->debug_level > 4, grammar->debug_level > 5);
+	      fprintf (stderr, "\n");
+	    }
+	}
+#endif
+      if (original_last_pl_el >= last_pl_el)
+	break;
     }
-  return YAEP_STATIC_CAST(struct trans_visit_node *, *entry);
 }
 
-/* The following function returns the positive order number of node
-   with number NUM. */
+/* The following function looking backward in pl starting with element
+   START_PL_EL and returns pl element which refers set with situation
+   containing `. error'.  START_PL_EL should be non negative.
+   Remember that zero pl set contains `.error' because we added such
+   rule if it is necessary.  The function returns number of terminals
+   (not taking error into account) on path (result, start_pl_set]. */
 #if MAKE_INLINE
 INLINE
 #endif
 static int
-canon_node_num (int num)
+find_error_pl_set (int start_pl_set, int *cost)
 {
-  return (num < 0 ? -num - 1 : num);
+  int curr_pl;
+
+  assert (start_pl_set >= 0);
+  *cost = 0;
+  for (curr_pl = start_pl_set; curr_pl >= 0; curr_pl--)
+    if (core_symb_vect_find (pl[curr_pl]->core, grammar->term_error) != NULL)
+      break;
+    else if (pl[curr_pl]->core->term != grammar->term_error)
+      (*cost)++;
+  assert (curr_pl >= 0);
+  return curr_pl;
 }
 
-/* The following recursive function prints NODE into file F and prints
-   all its children (if debug_level < 0 output format is for
-   graphviz). */
-static void
-print_node (FILE * f, struct yaep_tree_node *node)
+/* The following function creates and returns new error recovery state
+   with charcteristics (LAST_ORIGINAL_PL_EL, BACKWARD_MOVE_COST,
+   pl_curr, tok_curr). */
+static struct recovery_state
+new_recovery_state (int last_original_pl_el, int backward_move_cost)
 {
-  struct trans_visit_node *trans_visit_node;
-  struct yaep_tree_node *child;
+  struct recovery_state state;
   int i;
 
-  assert (node != NULL);
-  trans_visit_node = visit_node (node);
-  if (trans_visit_node->num >= 0)
-    return;
-  trans_visit_node->num = -trans_visit_node->num - 1;
-  if (grammar->debug_level > 0)
-    fprintf (f, "%7d: ", trans_visit_node->num);
-  switch (node->type)
+  assert (backward_move_cost >= 0);
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 2)
     {
-    case YAEP_NIL:
-      if (grammar->debug_level > 0)
-	fprintf (f, "EMPTY\n");
-      break;
-    case YAEP_ERROR:
-      if (grammar->debug_level > 0)
-	fprintf (f, "ERROR\n");
-      break;
-    case YAEP_TERM:
-      if (grammar->debug_level > 0)
-	fprintf (f, "TERMINAL: code=%d, repr=%s\n", node->val.term.code,
-		 symb_find_by_code (node->val.term.code)->repr);
-      break;
-    case YAEP_ANODE:
-      if (grammar->debug_level > 0)
-	{
-	  fprintf (f, "ABSTRACT: %s (", node->val.anode.name);
-	  for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
-	    fprintf (f, " %d", canon_node_num (visit_node (child)->num));
-	  fprintf (f, " )\n");
-	}
-      else
-	{
-	  for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
-	    {
-	      fprintf (f, "  \"%d: %s\" -> \"%d: ", trans_visit_node->num,
-		       node->val.anode.name,
-		       canon_node_num (visit_node (child)->num));
-	      switch (child->type)
-		{
-		case YAEP_NIL:
-		  fprintf (f, "EMPTY");
-		  break;
-		case YAEP_ERROR:
-		  fprintf (f, "ERROR");
-		  break;
-		case YAEP_TERM:
-		  fprintf (f, "%s",
-			   symb_find_by_code (child->val.term.code)->repr);
-		  break;
-		case YAEP_ANODE:
-		  fprintf (f, "%s", child->val.anode.name);
-		  break;
-		case YAEP_ALT:
-		  fprintf (f, "ALT");
-		  break;
-		default:
-		  assert (FALSE);
-		}
-	      fprintf (f, "\";\n");
-	    }
-	}
-      for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
-	print_node (f, child);
-      break;
-    case YAEP_ALT:
-      if (grammar->debug_level > 0)
-	{
-	  fprintf (f, "ALTERNATIVE: node=%d, next=",
-		   canon_node_num (visit_node (node->val.alt.node)->num));
-	  if (node->val.alt.next != NULL)
-	    fprintf (f, "%d\n",
-		     canon_node_num (visit_node (node->val.alt.next)->num));
-	  else
-	    fprintf (f, "nil\n");
-	}
-      else
+      fprintf (stderr,
+	       "++++Creating recovery state: original set=%d, tok=%d, ",
+	       last_original_pl_el, tok_curr);
+      symb_print (stderr, tok_symb (tok_curr), TRUE);
+      fprintf (stderr, "\n");
+    }
+#endif
+  state.last_original_pl_el = last_original_pl_el;
+  state.pl_tail_length = pl_curr - last_original_pl_el;
+  assert (state.pl_tail_length >= 0);
+  for (i = last_original_pl_el + 1; i <= pl_curr; i++)
+    {
+      OS_TOP_ADD_MEMORY (recovery_state_tail_sets, &pl[i], sizeof (pl[i]));
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 3)
 	{
-	  fprintf (f, "  \"%d: ALT\" -> \"%d: ", trans_visit_node->num,
-		   canon_node_num (visit_node (node->val.alt.node)->num));
-	  switch (node->val.alt.node->type)
-	    {
-	    case YAEP_NIL:
-	      fprintf (f, "EMPTY");
-	      break;
-	    case YAEP_ERROR:
-	      fprintf (f, "ERROR");
-	      break;
-	    case YAEP_TERM:
-	      fprintf (f, "%s",
-		       symb_find_by_code (node->val.alt.node->val.term.code)->
-		       repr);
-	      break;
-	    case YAEP_ANODE:
-	      fprintf (f, "%s", node->val.alt.node->val.anode.name);
-	      break;
-	    case YAEP_ALT:
-	      fprintf (f, "ALT");
-	      break;
-	    default:
-	      assert (FALSE);
-	    }
-	  fprintf (f, "\";\n");
-	  if (node->val.alt.next != NULL)
-	    fprintf (f, "  \"%d: ALT\" -> \"%d: ALT\";\n",
-		     trans_visit_node->num,
-		     canon_node_num (visit_node (node->val.alt.next)->num));
+	  fprintf (stderr, "++++++Saving set=%d\n", i);
+	  set_print (stderr, pl[i], i, grammar->debug_level > 4,
+		     grammar->debug_level > 5);
+	  fprintf (stderr, "\n");
 	}
-      print_node (f, node->val.alt.node);
-      if (node->val.alt.next != NULL)
-	print_node (f, node->val.alt.next);
-      break;
-    default:
-      assert (FALSE);
+#endif
     }
+  state.pl_tail = YAEP_STATIC_CAST(struct set **, OS_TOP_BEGIN (recovery_state_tail_sets));
+  OS_TOP_FINISH (recovery_state_tail_sets);
+  state.start_tok = tok_curr;
+  state.backward_move_cost = backward_move_cost;
+  return state;
 }
 
-/* The following function prints parse tree with ROOT. */
-static void
-print_parse (FILE * f, struct yaep_tree_node *root)
-{
-#ifndef __cplusplus
-  trans_visit_nodes_tab =
-    create_hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 2, trans_visit_node_hash,
-		       trans_visit_node_eq);
-#else
-  trans_visit_nodes_tab =
-    new hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 2, trans_visit_node_hash,
-		    trans_visit_node_eq);
-#endif
-  n_trans_visit_nodes = 0;
-  OS_CREATE (trans_visit_nodes_os, grammar->alloc, 0);
-  print_node (f, root);
-  OS_DELETE (trans_visit_nodes_os);
-#ifndef __cplusplus
-  delete_hash_table (trans_visit_nodes_tab);
-#else
-  delete trans_visit_nodes_tab;
-#endif
-}
-
-#endif
-
-/* The following is number of created terminal, abstract, and
-   alternative nodes. */
-static int n_parse_term_nodes, n_parse_abstract_nodes, n_parse_alt_nodes;
+/* The following vlo is error recovery states stack.  The stack
+   contains error recovery state which should be investigated to find
+   the best error recovery. */
+#define recovery_state_stack (curr_parser->x_recovery_state_stack)
 
-/* The following function places translation NODE into *PLACE and
-   creates alternative nodes if it is necessary. */
+/* The following function creates new error recovery state and pushes
+   it on the states stack top. */
 #if MAKE_INLINE
 INLINE
 #endif
 static void
-place_translation (struct yaep_tree_node **place, struct yaep_tree_node *node)
+push_recovery_state (int last_original_pl_el, int backward_move_cost)
 {
-  struct yaep_tree_node *alt, *next_alt;
+  struct recovery_state state;
 
-  assert (place != NULL);
-  if (*place == NULL)
-    {
-      *place = node;
-      return;
-    }
-  /* We need an alternative. */
+  state = new_recovery_state (last_original_pl_el, backward_move_cost);
 #ifndef NO_YAEP_DEBUG_PRINT
-  n_parse_alt_nodes++;
-#endif
-  alt = YAEP_STATIC_CAST(struct yaep_tree_node *, (*parse_alloc) (sizeof
-						  (struct yaep_tree_node)));
-  alt->type = YAEP_ALT;
-  alt->val.alt.node = node;
-  if ((*place)->type == YAEP_ALT)
-    alt->val.alt.next = *place;
-  else
+  if (grammar->debug_level > 2)
     {
-      /* We need alternative node for the 1st
-         alternative too. */
-      n_parse_alt_nodes++;
-      next_alt = alt->val.alt.next
-	= (YAEP_STATIC_CAST(struct yaep_tree_node *,
-	   (*parse_alloc) (sizeof (struct yaep_tree_node))));
-      next_alt->type = YAEP_ALT;
-      next_alt->val.alt.node = *place;
-      next_alt->val.alt.next = NULL;
+      fprintf (stderr, "++++Push recovery state: original set=%d, tok=%d, ",
+	       last_original_pl_el, tok_curr);
+      symb_print (stderr, tok_symb (tok_curr), TRUE);
+      fprintf (stderr, "\n");
     }
-  *place = alt;
+#endif
+  VLO_ADD_MEMORY (recovery_state_stack, &state, sizeof (state));
 }
 
-static struct yaep_tree_node *
-copy_anode (struct yaep_tree_node **place, struct yaep_tree_node *anode,
-	    struct rule *rule, int disp)
+/* The following function sets up parser state (pl, pl_curr, tok_curr)
+   according to error recovery STATE. */
+static void
+set_recovery_state (struct recovery_state *state)
 {
-  struct yaep_tree_node *node;
   int i;
 
-  node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
-	  (*parse_alloc) (YAEP_STATIC_CAST(int, (YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node))
-			  + YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node *))
-			  * YAEP_STATIC_CAST(size_t, (rule->trans_len + 1)))))));
-  *node = *anode;
-  node->val.anode.children
-    = (YAEP_REINTERPRET_CAST(struct yaep_tree_node **,
-       (YAEP_REINTERPRET_CAST(char *, node) + sizeof (struct yaep_tree_node))));
-  for (i = 0; i <= rule->trans_len; i++)
-    node->val.anode.children[i] = anode->val.anode.children[i];
-  node->val.anode.children[disp] = NULL;
-  place_translation (place, node);
-  return node;
-}
-
-/* The following table is used to find allocated memory which should
-   not be freed. */
-static hash_table_t reserv_mem_tab;
-
-/* The hash of the memory reference. */
-static unsigned
-reserv_mem_hash (hash_table_entry_t m)
-{
-  return YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, m));
+  tok_curr = state->start_tok;
+  restore_original_sets (state->last_original_pl_el);
+  pl_curr = state->last_original_pl_el;
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 2)
+    {
+      fprintf (stderr, "++++Set recovery state: set=%d, tok=%d, ",
+	       pl_curr, tok_curr);
+      symb_print (stderr, tok_symb (tok_curr), TRUE);
+      fprintf (stderr, "\n");
+    }
+#endif
+  for (i = 0; i < state->pl_tail_length; i++)
+    {
+      pl[++pl_curr] = state->pl_tail[i];
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 3)
+	{
+	  fprintf (stderr, "++++++Add saved set=%d\n", pl_curr);
+	  set_print (stderr, pl[pl_curr], pl_curr, grammar->debug_level > 4,
+		     grammar->debug_level > 5);
+	  fprintf (stderr, "\n");
+	}
+#endif
+    }
 }
 
-/* The equity of the memory reference. */
-static int
-reserv_mem_eq (hash_table_entry_t m1, hash_table_entry_t m2)
+/* The following function pops the top error recovery state from
+   states stack.  The current parser state will be setup according to
+   the state. */
+#if MAKE_INLINE
+INLINE
+#endif
+static struct recovery_state
+pop_recovery_state (void)
 {
-  return m1 == m2;
-}
+  struct recovery_state *state;
 
-/* The following vlo will contain references to memory which should be
-   freed.  The same reference can be represented more on time. */
-#ifndef __cplusplus
-static vlo_t tnodes_vlo;
-#else
-static vlo_t *tnodes_vlo;
+  state = &(YAEP_STATIC_CAST(struct recovery_state *, VLO_BOUND (recovery_state_stack)))[-1];
+  VLO_SHORTEN (recovery_state_stack, sizeof (struct recovery_state));
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 2)
+    fprintf (stderr, "++++Pop error recovery state\n");
 #endif
+  set_recovery_state (state);
+  return *state;
+}
 
-/* The following function sets up minimal cost for each abstract node.
-   The function returns minimal translation corresponding to NODE.
-   The function also collects references to memory which can be
-   freed. Remeber that the translation is DAG, altenatives form lists
-   (alt node may not refer for another alternative). */
-static struct yaep_tree_node *
-prune_to_minimal (struct yaep_tree_node *node, int *cost)
+/* The following function is major function of syntax error recovery.
+   It searches for minimal cost error recovery.  The function returns
+   in the parameter number of start token which is ignored and number
+   of the first token which is not ignored.  If the number of ignored
+   tokens is zero, *START will be equal to *STOP and number of token
+   on which the error occurred. */
+static void
+error_recovery (int *start, int *stop)
 {
-  struct yaep_tree_node *child, *alt, *next_alt, *result = NULL;
-  int i, min_cost = INT_MAX; /* Initialize to sentinel so comparisons are well-defined */
+  struct set *set;
+  struct core_symb_vect *core_symb_vect;
+  struct recovery_state best_state, state;
+  int best_cost, cost, lookahead_term_num, n_matched_toks;
+  int back_to_frontier_move_cost, backward_move_cost;
 
-  assert (node != NULL);
-  switch (node->type)
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 2)
+    fprintf (stderr, "\n++Error recovery start\n");
+#endif
+  *stop = *start = -1;
+  /* Leo items are formed only for the original sets.  */
+  leo_off_p = TRUE;
+  OS_CREATE (recovery_state_tail_sets, grammar->alloc, 0);
+  VLO_NULLIFY (original_pl_tail_stack);
+  VLO_NULLIFY (recovery_state_stack);
+  start_pl_curr = pl_curr;
+  start_tok_curr = tok_curr;
+  /* Initialize error recovery state stack. */
+  pl_curr
+    = back_pl_frontier = find_error_pl_set (pl_curr, &backward_move_cost);
+  back_to_frontier_move_cost = backward_move_cost;
+  save_original_sets ();
+  push_recovery_state (back_pl_frontier, backward_move_cost);
+  best_cost = 2 * toks_len;
+  while (VLO_LENGTH (recovery_state_stack) > 0)
     {
-    case YAEP_NIL:
-    case YAEP_ERROR:
-    case YAEP_TERM:
-      if (parse_free != NULL)
-	VLO_ADD_MEMORY (tnodes_vlo, &node, sizeof (node));
-      *cost = 0;
-      return node;
-    case YAEP_ANODE:
-      if (node->val.anode.cost >= 0)
+      state = pop_recovery_state ();
+      cost = state.backward_move_cost;
+      assert (cost >= 0);
+      /* Advance back frontier. */
+      if (back_pl_frontier > 0)
 	{
-	  if (parse_free != NULL)
-	    VLO_ADD_MEMORY (tnodes_vlo, &node, sizeof (node));
-	  for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
+	  int saved_pl_curr = pl_curr, saved_tok_curr = tok_curr;
+
+	  /* Advance back frontier. */
+	  pl_curr = find_error_pl_set (back_pl_frontier - 1,
+				       &backward_move_cost);
+#ifndef NO_YAEP_DEBUG_PRINT
+	  if (grammar->debug_level > 2)
+	    fprintf (stderr, "++++Advance back frontier: old=%d, new=%d\n",
+		     back_pl_frontier, pl_curr);
+#endif
+	  if (best_cost >= back_to_frontier_move_cost + backward_move_cost)
 	    {
-	      node->val.anode.children[i] = prune_to_minimal (child, cost);
-	      node->val.anode.cost += *cost;
+	      back_pl_frontier = pl_curr;
+	      tok_curr = start_tok_curr;
+	      save_original_sets ();
+	      back_to_frontier_move_cost += backward_move_cost;
+	      push_recovery_state (back_pl_frontier,
+				   back_to_frontier_move_cost);
+	      set_original_set_bound (state.last_original_pl_el);
+	      tok_curr = saved_tok_curr;
 	    }
-	  *cost = node->val.anode.cost;
-          node->val.anode.cost = -node->val.anode.cost - 1;	/* flag of visit */
+	  pl_curr = saved_pl_curr;
 	}
-      return node;
-    case YAEP_ALT:
-  for (alt = node; alt != NULL; alt = next_alt)
+      /* Advance head frontier. */
+      if (best_cost >= cost + 1)
 	{
-	  if (parse_free != NULL)
-	    VLO_ADD_MEMORY (tnodes_vlo, &alt, sizeof (alt));
-	  next_alt = alt->val.alt.next;
-	  alt->val.alt.node = prune_to_minimal (alt->val.alt.node, cost);
-    if (alt == node || min_cost > *cost)
+	  tok_curr++;
+	  if (tok_curr < toks_len)
 	    {
-	      min_cost = *cost;
-	      alt->val.alt.next = NULL;
-	      result = alt;
+#ifndef NO_YAEP_DEBUG_PRINT
+	      if (grammar->debug_level > 2)
+		{
+		  fprintf (stderr,
+			   "++++Advance head frontier (one pos): tok=%d, ",
+			   tok_curr);
+		  symb_print (stderr, tok_symb (tok_curr), TRUE);
+		  fprintf (stderr, "\n");
+#endif
+		}
+	      push_recovery_state (state.last_original_pl_el, cost + 1);
 	    }
-    else if (min_cost == *cost && !grammar->one_parse_p)
+	  tok_curr--;
+	}
+      set = pl[pl_curr];
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
+	{
+	  fprintf (stderr, "++++Trying set=%d, tok=%d, ", pl_curr, tok_curr);
+	  symb_print (stderr, tok_symb (tok_curr), TRUE);
+	  fprintf (stderr, "\n");
+	}
+#endif
+      /* Shift error: */
+      core_symb_vect = core_symb_vect_find (set->core, grammar->term_error);
+      assert (core_symb_vect != NULL);
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
+	fprintf (stderr, "++++Making error shift in set=%d\n", pl_curr);
+#endif
+      build_new_set (set, core_symb_vect, -1);
+      pl[++pl_curr] = new_set;
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
+	{
+	  fprintf (stderr, "++Trying new set=%d\n", pl_curr);
+	  if (grammar->debug_level > 3)
 	    {
-	      alt->val.alt.next = result;
-	      result = alt;
+	      set_print (stderr, new_set, pl_curr, grammar->debug_level > 4,
+			 grammar->debug_level > 5);
+	      fprintf (stderr, "\n");
 	    }
 	}
-      *cost = (min_cost == INT_MAX ? 0 : min_cost);
-      assert (result != NULL); /* result must be set because at least one alt exists */
-      return (result->val.alt.next == NULL ? result->val.alt.node : result);
-    default:
-      assert (FALSE);
+#endif
+      /* Search the first right token. */
+      while (tok_curr < toks_len)
+	{
+	  core_symb_vect = core_symb_vect_find (new_core,
+						tok_symb (tok_curr));
+	  if (core_symb_vect != NULL)
+	    break;
+#ifndef NO_YAEP_DEBUG_PRINT
+	  if (grammar->debug_level > 2)
+	    {
+	      fprintf (stderr, "++++++Skipping=%d ", tok_curr);
+	      symb_print (stderr, tok_symb (tok_curr), TRUE);
+	      fprintf (stderr, "\n");
+	    }
+#endif
+	  cost++;
+	  tok_curr++;
+	  if (cost >= best_cost)
+	    /* This state is worse.  Reject it. */
+	    break;
+	}
+      if (cost >= best_cost)
+	{
+#ifndef NO_YAEP_DEBUG_PRINT
+	  if (grammar->debug_level > 2)
+	    fprintf
+	      (stderr,
+	       "++++Too many ignored tokens %d (already worse recovery)\n",
+	       cost);
+#endif
+	  /* This state is worse.  Reject it. */
+	  continue;
+	}
+      if (tok_curr >= toks_len)
+	{
+#ifndef NO_YAEP_DEBUG_PRINT
+	  if (grammar->debug_level > 2)
+	    fprintf
+	      (stderr,
+	       "++++We achieved EOF without matching -- reject this state\n");
+#endif
+	  /* Go to the next recovery state.  To guarantee that pl does
+	     not grows to much we don't push secondary error recovery
+	     states without matching in primary error recovery state.
+	     So we can say that pl length at most twice length of
+	     tokens array. */
+	  continue;
+	}
+      /* Shift the found token. */
+      lookahead_term_num = (tok_curr + 1 < toks_len
+			    ? tok_terms[tok_curr + 1] : -1);
+      build_new_set (new_set, core_symb_vect, lookahead_term_num);
+      pl[++pl_curr] = new_set;
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 3)
+	{
+	  fprintf (stderr, "++++++++Building new set=%d\n", pl_curr);
+	  if (grammar->debug_level > 3)
+	    set_print (stderr, new_set, pl_curr, grammar->debug_level > 4,
+		       grammar->debug_level > 5);
+	}
+#endif
+      n_matched_toks = 0;
+      for (;;)
+	{
+#ifndef NO_YAEP_DEBUG_PRINT
+	  if (grammar->debug_level > 2)
+	    {
+	      fprintf (stderr, "++++++Matching=%d ", tok_curr);
+	      symb_print (stderr, tok_symb (tok_curr), TRUE);
+	      fprintf (stderr, "\n");
+	    }
+#endif
+	  n_matched_toks++;
+	  if (n_matched_toks >= grammar->recovery_token_matches)
+	    break;
+	  tok_curr++;
+	  if (tok_curr >= toks_len)
+	    break;
+	  /* Push secondary recovery state (with error in set). */
+	  if (core_symb_vect_find (new_core, grammar->term_error) != NULL)
+	    {
+#ifndef NO_YAEP_DEBUG_PRINT
+	      if (grammar->debug_level > 2)
+		{
+		  fprintf
+		    (stderr,
+		     "++++Found secondary state: original set=%d, tok=%d, ",
+		     state.last_original_pl_el, tok_curr);
+		  symb_print (stderr, tok_symb (tok_curr), TRUE);
+		  fprintf (stderr, "\n");
+		}
+#endif
+	      push_recovery_state (state.last_original_pl_el, cost);
+	    }
+	  core_symb_vect
+	    = core_symb_vect_find (new_core, tok_symb (tok_curr));
+	  if (core_symb_vect == NULL)
+	    break;
+	  lookahead_term_num = (tok_curr + 1 < toks_len
+				? tok_terms[tok_curr + 1] : -1);
+	  build_new_set (new_set, core_symb_vect, lookahead_term_num);
+	  pl[++pl_curr] = new_set;
+	}
+      if (n_matched_toks >= grammar->recovery_token_matches
+	  || tok_curr >= toks_len)
+	{
+	  /* We found an error recovery.  Compare costs. */
+	  if (best_cost > cost)
+	    {
+#ifndef NO_YAEP_DEBUG_PRINT
+	      if (grammar->debug_level > 2)
+		fprintf
+		  (stderr,
+		   "++++Ignore %d tokens (the best recovery now): Save it:\n",
+		   cost);
+#endif
+	      best_cost = cost;
+	      if (tok_curr == toks_len)
+		tok_curr--;
+	      best_state = new_recovery_state (state.last_original_pl_el,
+					       /* It may be any constant here
+					          because it is not used. */
+					       0);
+	      *start = start_tok_curr - state.backward_move_cost;
+	      *stop = *start + cost;
+	    }
+#ifndef NO_YAEP_DEBUG_PRINT
+	  else if (grammar->debug_level > 2)
+	    fprintf (stderr, "++++Ignore %d tokens (worse recovery)\n", cost);
+#endif
+	}
+#ifndef NO_YAEP_DEBUG_PRINT
+      else if (cost < best_cost && grammar->debug_level > 2)
+	fprintf (stderr, "++++No %d matched tokens  -- reject this state\n",
+		 grammar->recovery_token_matches);
+#endif
     }
-  *cost = 0;
-  return NULL;
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 2)
+    fprintf (stderr, "\n++Finishing error recovery: Restore best state\n");
+#endif
+  set_recovery_state (&best_state);
+  /* Only the original sets up to original_last_pl_el are left.  */
+  if (curr_leo_p)
+    leo_truncate (original_last_pl_el);
+  leo_off_p = FALSE;
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 2)
+    {
+      fprintf (stderr, "\n++Error recovery end: curr token %d=", tok_curr);
+      symb_print (stderr, tok_symb (tok_curr), TRUE);
+      fprintf (stderr, ", Current set=%d:\n", pl_curr);
+      if (grammar->debug_level > 3)
+	set_print (stderr, pl[pl_curr], pl_curr, grammar->debug_level > 4,
+		   grammar->debug_level > 5);
+    }
+#endif
+  OS_DELETE (recovery_state_tail_sets);
 }
 
-/* The following function traverses the translation collecting
-   reference to memory which may not be freed. */
+/* Create the stacks used by error recovery. */
 static void
-traverse_pruned_translation (struct yaep_tree_node *node)
+error_recovery_create (void)
 {
-  struct yaep_tree_node *child;
-  hash_table_entry_t *entry;
-  int i;
+  VLO_CREATE (original_pl_tail_stack, grammar->alloc, 4096);
+  VLO_CREATE (recovery_state_stack, grammar->alloc, 4096);
+}
 
- next:
-  assert (node != NULL);
-  if (parse_free != NULL
-      && *(entry =
-	   find_hash_table_entry (reserv_mem_tab, node, TRUE)) == NULL)
-   /* Insert owned mutable node pointer into the table; cast through
-     void* to satisfy the public const-qualified entry type. */
-   *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, node));
-  switch (node->type)
-    {
-    case YAEP_NIL:
-    case YAEP_ERROR:
-    case YAEP_TERM:
-      break;
-    case YAEP_ANODE:
-      if (parse_free != NULL
-  && *(entry = find_hash_table_entry_c (reserv_mem_tab,
-               node->val.anode.name,
-               TRUE)) == NULL)
-  /* Record the owned name pointer in the reservation table so that
-     later cleanup does NOT free it. Previous logic erroneously used
-     '!= NULL', skipping insertion and leading to premature free and
-     corrupted abstract node names (seen in tests 45/47).
-     Use union to avoid cast-qual warning when storing const char*. */
-	{
-	  union { const char *cc; void *v; } u;
-	  u.cc = node->val.anode.name;
-	  *entry = YAEP_STATIC_CAST(hash_table_entry_t, u.v);
-	}
-      for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
-	traverse_pruned_translation (child);
-      assert (node->val.anode.cost < 0);
-      node->val.anode.cost = -node->val.anode.cost - 1;
-      break;
-    case YAEP_ALT:
-      traverse_pruned_translation (node->val.alt.node);
-      if ((node = node->val.alt.next) != NULL)
-	goto next;
-      break;
-    default:
-      assert (FALSE);
-    }
-  return;
+/* Initialize work with error recovery. */
+static void
+error_recovery_init (void)
+{
+  VLO_NULLIFY (original_pl_tail_stack);
+  VLO_NULLIFY (recovery_state_stack);
 }
 
-/* The function finds and returns a minimal cost parse(s). */
-static struct yaep_tree_node *
-find_minimal_translation (struct yaep_tree_node *root)
+/* Finalize work with error recovery. */
+static void
+error_recovery_fin (void)
 {
-  struct yaep_tree_node **node_ptr;
-  int cost;
+  VLO_DELETE (recovery_state_stack);
+  VLO_DELETE (original_pl_tail_stack);
+}
+
 
-  if (parse_free != NULL)
-    {
-#ifndef __cplusplus
-      reserv_mem_tab =
-	create_hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 4, reserv_mem_hash,
-			   reserv_mem_eq);
-#else
-      reserv_mem_tab =
-	new hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 4, reserv_mem_hash,
-			reserv_mem_eq);
+
+
+#if MAKE_INLINE
+INLINE
 #endif
-      VLO_CREATE (tnodes_vlo, grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 4 * sizeof (void *));
-    }
-  root = prune_to_minimal (root, &cost);
-  traverse_pruned_translation (root);
-  if (parse_free != NULL)
+/* Return TRUE if goto set SET from parsing list PLACE of parse
+   SET_PARSE_NUM can be used as the next set.  The criterium is that
+   all origin sets of start situations are the same as from PLACE.  */
+static int
+check_cached_transition_set (struct set *set, int place, int set_parse_num)
+{
+  int i, dist;
+  int *dists = set->dists;
+
+  for (i = set->core->n_start_sits - 1; i >= 0; i--)
     {
-      for (node_ptr = YAEP_STATIC_CAST(struct yaep_tree_node **, VLO_BEGIN (tnodes_vlo));
-	   node_ptr < YAEP_STATIC_CAST(struct yaep_tree_node **, VLO_BOUND (tnodes_vlo));
-	   node_ptr++)
-  if (*find_hash_table_entry_c (reserv_mem_tab, *node_ptr, TRUE) == NULL)
-	   {
-	     if ((*node_ptr)->type == YAEP_ANODE
-       && *find_hash_table_entry_c (reserv_mem_tab,
-                  (*node_ptr)->val.anode.name,
-                  TRUE) == NULL)
-	       {
-		 /* Use union to avoid cast-qual warning when freeing const char*
-		    allocated by user's parse_alloc. The user owns the memory. */
-		 union { const char *cc; void *v; } u;
-		 u.cc = (*node_ptr)->val.anode.name;
-		 (*parse_free) (u.v);
-	       }
-	     (*parse_free) (*node_ptr);
-	   }
-      VLO_DELETE (tnodes_vlo);
-#ifndef __cplusplus
-      delete_hash_table (reserv_mem_tab);
-#else
-      delete reserv_mem_tab;
-#endif
+      if ((dist = dists[i]) <= 1)
+	continue;
+      /* Sets at origins of situations with distance one are supposed
+         to be the same.  Places of the previous parses can not be
+         checked.  The origin can be before the start of the list
+         for the current place.  */
+      if (set_parse_num != curr_parse_num || dist > pl_curr + 1
+	  || pl[pl_curr + 1 - dist] != pl[place + 1 - dist])
+	return FALSE;
     }
-  return root;
+  return TRUE;
 }
 
-/* The following function finds parse tree of parsed input.  The
-   function sets up *AMBIGUOUS_P if we found that the grammer is
-   ambigous (it works even we asked only one parse tree without
-   alternatives). */
-static struct yaep_tree_node *
-make_parse (int *ambiguous_p)
+/* How many times we reuse Earley's sets without their
+   recalculation.  */
+#define n_goto_successes (curr_parser->x_n_goto_successes)
+
+#ifdef USE_SET_HASH_TABLE
+/* Return a goto set saved in TRIPLE which can be used as the next set
+   or NULL.  The places of the triple from the shared memo (SHARED_P)
+   are never checked because they belong to another parse.  */
+static struct set *
+cached_transition_set (const struct set_term_lookahead *triple,
+		       int shared_p)
 {
-  struct set *set, *check_set;
-  struct set_core *set_core, *check_set_core;
-  struct sit *sit, *check_sit;
-  struct rule *rule, *sit_rule;
-  struct symb *symb;
-  struct core_symb_vect *core_symb_vect, *check_core_symb_vect;
-  int i, k, found, pos, orig, pl_ind, n_candidates, disp; ptrdiff_t j;
-  int sit_ind, check_sit_ind, sit_orig, check_sit_orig, new_p;
-  struct parse_state *state, *orig_state, *curr_state;
-  struct parse_state *table_state, *parent_anode_state;
-  struct parse_state root_state;
-  struct yaep_tree_node *result, *empty_node, *node, *error_node;
-  struct yaep_tree_node *parent_anode, *anode, root_anode;
-  int parent_disp;
-  int saved_one_parse_p;
-  struct yaep_tree_node **term_node_array = NULL; /* Initialize to ensure safe free guard */
-#ifndef __cplusplus
-  vlo_t stack, orig_states;
-#else
-  vlo_t *stack, *orig_states = NULL; /* Initialize to silence maybe-uninitialized in C++ inlining context */
-#endif
+  struct set *set;
+  int i, parse_num;
 
-  n_parse_term_nodes = n_parse_abstract_nodes = n_parse_alt_nodes = 0;
-  set = pl[pl_curr];
-  assert (grammar->axiom != NULL);
-  /* We have only one start situation: "$S : <start symb> $eof .".  */
-  sit = (set->core->sits != NULL ? set->core->sits[0] : NULL);
-  if (sit == NULL
-#ifndef ABSOLUTE_DISTANCES
-      || set->dists[0] != pl_curr
-#else
-      || set->dists[0] != 0
-#endif
-      || sit->rule->lhs != grammar->axiom || sit->pos != sit->rule->rhs_len)
+  for (i = 0; i < MAX_CACHED_GOTO_RESULTS; i++)
     {
-      /* It is possible only if error recovery is switched off.
-         Because we always adds rule `axiom: error $eof'. */
-      assert (!grammar->error_recovery_p);
-      return NULL;
+      if ((set = triple->result[i]) == NULL)
+	break;
+      parse_num = shared_p ? -1 : triple->parse_num[i];
+      if (check_cached_transition_set (set, triple->place[i], parse_num))
+	{
+	  n_goto_successes++;
+	  if (parse_num != curr_parse_num)
+	    n_goto_cache_hits++;
+	  return set;
+	}
     }
-  saved_one_parse_p = grammar->one_parse_p;
-  if (grammar->cost_p)
-    /* We need all parses to choose the minimal one */
-    grammar->one_parse_p = FALSE;
-  sit = set->core->sits[0];
-  parse_state_init ();
-  if (!grammar->one_parse_p)
-    {
-      void *mem;
+  return NULL;
+}
+#endif
 
-      /* We need this array to reuse terminal nodes only for
-         generation of several parses. */
-      mem =
-	yaep_malloc (grammar->alloc,
-		     YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node *)) * YAEP_STATIC_CAST(size_t, toks_len));
-      term_node_array = YAEP_STATIC_CAST(struct yaep_tree_node **, mem);
-      for (i = 0; i < toks_len; i++)
-	term_node_array[i] = NULL;
-      /* The following is used to check necessity to create current
-         state with different pl_ind. */
-      VLO_CREATE (orig_states, grammar->alloc, 0);
-    }
-  VLO_CREATE (stack, grammar->alloc, 10000);
-  VLO_EXPAND (stack, sizeof (struct parse_state *));
-  state = parse_state_alloc ();
-  (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (stack)))[-1] = state;
-  rule = state->rule = sit->rule;
-  state->pos = sit->pos;
-  state->orig = 0;
-  state->pl_ind = pl_curr;
-  result = NULL;
-  root_state.anode = &root_anode;
-  root_anode.val.anode.children = &result;
-  state->parent_anode_state = &root_state;
-  state->parent_disp = 0;
-  state->anode = NULL;
-  /* Create empty and error node: */
-  empty_node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
-		(*parse_alloc) (sizeof (struct yaep_tree_node))));
-  empty_node->type = YAEP_NIL;
-  empty_node->val.nil.used = 0;
-  error_node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
-		(*parse_alloc) (sizeof (struct yaep_tree_node))));
-  error_node->type = YAEP_ERROR;
-  error_node->val.error.used = 0;
-  while (VLO_LENGTH (stack) != 0)
-    {
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
-      if ((grammar->debug_level > 2 && state->pos == state->rule->rhs_len)
-          || grammar->debug_level > 3)
-    {
-      /* Compute top index from VLO_LENGTH into a size_t temporary, then
-         convert to long with defined behavior for empty stack (use -1).
-         This avoids converting an unsigned size_t directly to long in the
-         fprintf call which can trigger compiler warnings. */
-      size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (stack) / sizeof (struct parse_state *));
-      long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
-      fprintf (stderr, "Processing top %ld, set place = %d, sit = ",
-           _top_index,
-           state->pl_ind);
-      rule_dot_print (stderr, state->rule, state->pos);
-      fprintf (stderr, ", %d\n", state->orig);
-    }
+/* The following function starts forming parsing list in Earley's
+   algorithm. */
+static void
+build_pl_start (void)
+{
+  error_recovery_init ();
+  build_start_set ();
+  tok_curr = pl_curr = 0;
+  curr_parser->x_pl_stopped_p = curr_parser->x_pl_suspended_p = FALSE;
+}
+
+/* The following function is major function forming parsing list in
+   Earley's algorithm.  It forms sets for tokens starting with
+   tok_curr.  If END_P is FALSE, tokens can be added later.  In this
+   case the function processes only tokens followed by another token
+   (it is needed for the lookahead) and suspends forming the list on
+   a syntax error until all tokens are known because error recovery
+   can look at any subsequent token. */
+static void
+build_pl_advance (int end_p)
+{
+  int i, n_uses;
+  struct symb *term;
+  struct set *set;
+  struct core_symb_vect *core_symb_vect;
+  int lookahead_term_num;
+#ifdef USE_SET_HASH_TABLE
+  hash_table_entry_t *entry, shared_entry;
+  struct set_term_lookahead *new_set_term_lookahead;
 #endif
-      pos = --state->pos;
-      rule = state->rule;
-      parent_anode_state = state->parent_anode_state;
-      parent_anode = parent_anode_state->anode;
-      parent_disp = state->parent_disp;
-      anode = state->anode;
-      disp = rule->order[pos];
-      pl_ind = state->pl_ind;
-      orig = state->orig;
-      if (pos < 0)
+
+  if (curr_parser->x_pl_stopped_p
+      || (curr_parser->x_pl_suspended_p && !end_p))
+    return;
+  curr_parser->x_pl_suspended_p = FALSE;
+  lookahead_term_num = -1;
+  for (; tok_curr < (end_p ? toks_len : toks_len - 1); tok_curr++)
+    {
+      term = tok_symb (tok_curr);
+      /* Early debug snapshot to help fuzz triage. Guarded by
+         YAEP_FUZZ_DEBUG to avoid noisy output in normal runs. */
+      if (fuzz_debug_p ())
+        {
+          fprintf (stderr, "YAEP_DEBUG_LOOP tok=%d toks_len=%d tok_terms=%p term_num=%d term=%p\n",
+                   tok_curr, toks_len, YAEP_STATIC_CAST(void *, tok_terms),
+                   tok_terms[tok_curr], YAEP_STATIC_CAST(void *, term));
+          fflush (stderr);
+        }
+      if (grammar->lookahead_level != 0)
+	lookahead_term_num = (tok_curr < toks_len - 1
+			      ? tok_terms[tok_curr + 1] : -1);
+
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
 	{
-	  /* We've processed all rhs of the rule. */
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
-      if ((grammar->debug_level > 2 && state->pos == state->rule->rhs_len)
-          || grammar->debug_level > 3)
+	  fprintf (stderr, "\nReading %d=", tok_curr);
+	  symb_print (stderr, term, TRUE);
+	  fprintf (stderr, ", Current set=%d\n", pl_curr);
+	}
+#endif
+      set = pl[pl_curr];
+      new_set = NULL;
+#ifdef USE_SET_HASH_TABLE
+      OS_TOP_EXPAND (set_term_lookahead_os,
+		     sizeof (struct set_term_lookahead));
+      new_set_term_lookahead =
+	YAEP_STATIC_CAST(struct set_term_lookahead *, OS_TOP_BEGIN (set_term_lookahead_os));
+      new_set_term_lookahead->set = set;
+      new_set_term_lookahead->term = term;
+      new_set_term_lookahead->lookahead = lookahead_term_num;
+      for (i = 0; i < MAX_CACHED_GOTO_RESULTS; i++)
+	new_set_term_lookahead->result[i] = NULL;
+      new_set_term_lookahead->curr = 0;
+      entry =
+    find_hash_table_entry (set_term_lookahead_tab, new_set_term_lookahead,
+               TRUE);
+
+      /* Optional runtime debug logging for fuzz triage. If the
+         environment variable YAEP_FUZZ_DEBUG is set, emit a single
+         line with key pointers and token info which helps trace the
+         state leading to crashes without changing program flow. */
+      if (fuzz_debug_p ())
+        {
+          const char *trepr = (term && term->repr) ? term->repr : "(null)";
+          fprintf (stderr, "YAEP_DEBUG tok=%d pl=%d term=%p repr='%s' set=%p entry=%p *entry=%p\n",
+                   tok_curr, pl_curr, YAEP_STATIC_CAST(void *, term), trepr, YAEP_STATIC_CAST(void *, set),
+                   YAEP_STATIC_CAST(void *, entry), YAEP_STATIC_CAST(void *, (entry ? *entry : NULL)));
+          /* fflush to ensure log reaches fuzzer output */
+          fflush (stderr);
+        }
+      if (*entry != NULL)
     {
-      /* See comment above: compute top index safely to avoid unsigned ->
-         signed narrowing in the call. */
-      size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (stack) / sizeof (struct parse_state *));
-      long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
-      fprintf (stderr, "Poping top %ld, set place = %d, sit = ",
-               _top_index,
-               state->pl_ind);
-      rule_dot_print (stderr, state->rule, 0);
-      fprintf (stderr, ", %d\n", state->orig);
+      /* The entry stores a mutable set_term_lookahead owned by the
+         hash table. We intentionally cast through (void*) once here
+         to obtain a mutable local pointer for subsequent mutations
+         and checks. This documents the deliberate removal of the
+         const qualifier at the mutation site while keeping the
+         public API (hash_table_entry_t) const. */
+      struct set_term_lookahead *tab_ent = YAEP_STATIC_CAST(struct set_term_lookahead *, YAEP_STATIC_CAST(void *, *entry));
+
+      OS_TOP_NULLIFY (set_term_lookahead_os);
+      new_set = cached_transition_set (tab_ent, FALSE);
     }
+      else
+	{
+	  OS_TOP_FINISH (set_term_lookahead_os);
+       /* Cache the newly-created mutable lookahead struct in the
+         table. Deliberately cast through (void*) to document that
+         this is owned mutable data stored in a const-typed slot. */
+       *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, new_set_term_lookahead));
+	  n_set_term_lookaheads++;
+	}
+      /* Try the goto sets published by other parses into the shared
+	 memo.  Their triples are never changed. */
+      if (new_set == NULL
+	  && (shared_entry = shared_memo_find (goto_tab, *entry)) != NULL)
+	new_set = cached_transition_set
+	  (YAEP_STATIC_CAST(const struct set_term_lookahead *, shared_entry),
+	   TRUE);
 #endif
-	  parse_state_free (state);
-	  VLO_SHORTEN (stack, sizeof (struct parse_state *));
-	  if (VLO_LENGTH (stack) != 0)
-	    state = (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (stack)))[-1];
-	  if (parent_anode != NULL && rule->trans_len == 0 && anode == NULL)
-	    {
-	      /* We do produce nothing but we should.  So write empty
-	         node. */
-	      place_translation (parent_anode->val.anode.children +
-				 parent_disp, empty_node);
-	      empty_node->val.nil.used = 1;
-	    }
-	  else if (anode != NULL)
-	    {
-	      /* Change NULLs into empty nodes.  We can not make it
-	         the first time because when building several parses
-	         the NULL means flag of absence of translations (see
-	         function `place_translation'). */
-	      for (i = 0; i < rule->trans_len; i++)
-		if (anode->val.anode.children[i] == NULL)
-		  {
-		    anode->val.anode.children[i] = empty_node;
-		    empty_node->val.nil.used = 1;
-		  }
-	    }
-	  continue;
-	}
-      assert (pos >= 0);
-      if ((symb = rule->rhs[pos])->term_p)
+      if (new_set == NULL)
 	{
-	  /* Terminal before dot: */
-	  pl_ind--;		/* l */
-#ifndef ABSOLUTE_DISTANCES
-	  /* Because of error recovery toks [pl_ind].symb may be not
-	     equal to symb. */
-	  assert (toks[pl_ind].symb == symb);
-#endif
-	  if (parent_anode != NULL && disp >= 0)
+	  core_symb_vect = core_symb_vect_find (set->core, term);
+	  if (core_symb_vect == NULL)
 	    {
-	      /* We should generate and use the translation of the
-	         terminal.  Add reference to the current node. */
-	      if (symb == grammar->term_error)
+	      int saved_tok_curr, start, stop;
+
+	      /* Error recovery.  We do not check transition vector
+	         because for terminal transition vector is never NULL
+	         and reduce is always NULL. */
+	      saved_tok_curr = tok_curr;
+	      if (grammar->error_recovery_p && !end_p)
 		{
-		  node = error_node;
-		  error_node->val.error.used = 1;
+		  curr_parser->x_pl_suspended_p = TRUE;
+		  return;
+		}
+	      else if (grammar->error_recovery_p)
+		{
+		  error_recovery (&start, &stop);
+		  syntax_error (saved_tok_curr, tok_attr (saved_tok_curr),
+				start, tok_attr (start), stop,
+				tok_attr (stop));
+		  continue;
 		}
-	      else if (!grammar->one_parse_p
-		       && (node = term_node_array[pl_ind]) != NULL)
-		;
 	      else
 		{
-		  n_parse_term_nodes++;
-		  node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
-			  (*parse_alloc) (sizeof (struct yaep_tree_node))));
-		  node->type = YAEP_TERM;
-		  node->val.term.code = symb->u.term.code;
-		  node->val.term.attr = toks[pl_ind].attr;
-		  if (!grammar->one_parse_p)
-		    term_node_array[pl_ind] = node;
+		  syntax_error (saved_tok_curr, tok_attr (saved_tok_curr),
+				-1, NULL, -1, NULL);
+		  curr_parser->x_pl_stopped_p = TRUE;
+		  break;
 		}
-	      place_translation
-		(anode != NULL ? anode->val.anode.children + disp
-		 : parent_anode->val.anode.children + parent_disp, node);
 	    }
-	  if (pos != 0)
-	    state->pl_ind = pl_ind;
-	  continue;
+	  n_uses = n_leo_uses;
+	  build_new_set (set, core_symb_vect, lookahead_term_num);
+#ifdef USE_SET_HASH_TABLE
+	  /* Save (set, term, lookahead) -> new_set in the table.  A set
+	     formed with Leo items depends on all sets of the reduction
+	     paths, so it is not saved.  */
+      /* Mutate the stored table entry — obtain local mutable pointer
+         via documented void* cast as above. */
+      if (n_leo_uses == n_uses)
+      {
+        struct set_term_lookahead *tab_ent = YAEP_STATIC_CAST(struct set_term_lookahead *, YAEP_STATIC_CAST(void *, *entry));
+        i = tab_ent->curr;
+        tab_ent->result[i] = new_set;
+        tab_ent->place[i] = pl_curr;
+        tab_ent->parse_num[i] = curr_parse_num;
+        tab_ent->lookahead = lookahead_term_num;
+        tab_ent->curr = (i + 1) % MAX_CACHED_GOTO_RESULTS;
+      }
+#endif
 	}
-      /* Nonterminal before dot: */
-      set = pl[pl_ind];
-      set_core = set->core;
-      core_symb_vect = core_symb_vect_find (set_core, symb);
-      assert (core_symb_vect->reduces.len != 0);
-      n_candidates = 0;
-      orig_state = state;
-      if (!grammar->one_parse_p)
-	VLO_NULLIFY (orig_states);
-      for (i = 0; i < core_symb_vect->reduces.len; i++)
+      pl[++pl_curr] = new_set;
+#ifndef NO_YAEP_DEBUG_PRINT
+      if (grammar->debug_level > 2)
 	{
-	  sit_ind = core_symb_vect->reduces.els[i];
-	  sit = set_core->sits[sit_ind];
-	  if (sit_ind < set_core->n_start_sits)
-#ifndef ABSOLUTE_DISTANCES
-	    sit_orig = pl_ind - set->dists[sit_ind];
-#else
-	    sit_orig = set->dists[sit_ind];
-#endif
-	  else if (sit_ind < set_core->n_all_dists)
-#ifndef ABSOLUTE_DISTANCES
-	    sit_orig = pl_ind - set->dists[set_core->parent_indexes[sit_ind]];
-#else
-	    sit_orig = set->dists[set_core->parent_indexes[sit_ind]];
-#endif
-	  else
-	    sit_orig = pl_ind;
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+	  fprintf (stderr, "New set=%d\n", pl_curr);
 	  if (grammar->debug_level > 3)
-	    {
-	      fprintf (stderr, "    Trying set place = %d, sit = ", pl_ind);
-	      sit_print (stderr, sit, grammar->debug_level > 5);
-	      fprintf (stderr, ", %d\n", sit_orig);
-	    }
+	    set_print (stderr, new_set, pl_curr, grammar->debug_level > 4,
+		       grammar->debug_level > 5);
+	}
 #endif
-	  check_set = pl[sit_orig];
-	  check_set_core = check_set->core;
-	  check_core_symb_vect = core_symb_vect_find (check_set_core, symb);
-	  assert (check_core_symb_vect != NULL);
-	  found = FALSE;
-	  for (j = 0; j < check_core_symb_vect->transitions.len; j++)
-	    {
-	      check_sit_ind = check_core_symb_vect->transitions.els[j];
-	      check_sit = check_set->core->sits[check_sit_ind];
-	      if (check_sit->rule != rule || check_sit->pos != pos)
-		continue;
-	      check_sit_orig = sit_orig;
-	      if (check_sit_ind < check_set_core->n_all_dists)
-		{
-		  if (check_sit_ind < check_set_core->n_start_sits)
-#ifndef ABSOLUTE_DISTANCES
-		    check_sit_orig
-		      = sit_orig - check_set->dists[check_sit_ind];
-#else
-		    check_sit_orig = check_set->dists[check_sit_ind];
+    }
+}
+
+
+
+/* This page contains code to work with parse states. */
+
+/* The following describes parser state. */
+struct parse_state
+{
+  /* The rule which we are processing. */
+  struct rule *rule;
+  /* Position in the rule where we are now. */
+  int pos;
+  /* The rule origin (start point of derivated string from rule rhs)
+     and parser list in which we are now. */
+  int orig, pl_ind;
+  /* If the following value is NULL, then we do not need to create
+     translation for this rule.  If we should create abstract node
+     for this rule, the value refers for the abstract node and the
+     displacement is undefined.  Otherwise, the two members is
+     place into which we should place the translation of the rule.
+     The following member is used only for states in the stack. */
+  struct parse_state *parent_anode_state;
+  int parent_disp;
+  /* The following is used only for states in the table. */
+  struct yaep_tree_node *anode;
+};
+
+/* The following os contains all allocated parser states. */
+#define parse_state_os (curr_parser->x_parse_state_os)
+
+/* The following vlo is the stack of parser states used to build the
+   parse tree. */
+#define parse_stack (curr_parser->x_parse_stack)
+
+/* The following os contains the nodes of the tree built to call the
+   tree events callbacks (see make_tree_events). */
+#define tree_events_os (curr_parser->x_tree_events_os)
+
+/* The following vlo is the stack of abstract nodes whose children are
+   visited to call the tree events callbacks. */
+#define tree_events_stack (curr_parser->x_tree_events_stack)
+
+/* The following variable refers to head of chain of already allocated
+   and then freed parser states. */
+#define free_parse_state (curr_parser->x_free_parse_state)
+
+/* The following table is used to make translation for ambiguous
+   grammar more compact.  It is used only when we want all
+   translations. */
+#define parse_state_tab (curr_parser->x_parse_state_tab)	/* Key is rule, orig, pl_ind. */
+
+/* Hash of parse state. */
+static unsigned
+parse_state_hash (hash_table_entry_t s)
+{
+  /* Treat the incoming entry as const because the hash function only
+     reads fields; this avoids casting away const at call sites and
+     documents that we won't mutate the stored object here. */
+  const struct parse_state *state = (YAEP_STATIC_CAST(const struct parse_state *, s));
+
+  /* The table contains only states with dot at the end of rule. */
+  assert (state->pos == state->rule->rhs_len);
+  return (((jauquet_prime_mod32 * hash_shift +
+      YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, state->rule))) * hash_shift +
+     YAEP_STATIC_CAST(unsigned, state->orig)) * hash_shift + YAEP_STATIC_CAST(unsigned, state->pl_ind));
+}
+
+/* Equality of parse states. */
+static int
+parse_state_eq (hash_table_entry_t s1, hash_table_entry_t s2)
+{
+  /* Equality comparison only reads the structures; keep pointers const
+     to avoid casting away qualifiers and to make intent explicit. */
+  const struct parse_state *state1 = (YAEP_STATIC_CAST(const struct parse_state *, s1));
+  const struct parse_state *state2 = (YAEP_STATIC_CAST(const struct parse_state *, s2));
+
+  /* The table contains only states with dot at the end of rule. */
+  assert (state1->pos == state1->rule->rhs_len
+    && state2->pos == state2->rule->rhs_len);
+  return (state1->rule == state2->rule && state1->orig == state2->orig
+    && state1->pl_ind == state2->pl_ind);
+}
+
+/* The following function initializes work with parser states. */
+static void
+parse_state_init (void)
+{
+  free_parse_state = NULL;
+  OS_EMPTY (parse_state_os);
+  if (!curr_one_parse_p)
+    parse_state_tab =
+      create_hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 2, parse_state_hash,
+			 parse_state_eq);
+}
+
+/* The following function returns new parser state. */
+#if MAKE_INLINE
+INLINE
 #endif
-		  else
-#ifndef ABSOLUTE_DISTANCES
-		    check_sit_orig
-		      = (sit_orig
-			 - check_set->dists[check_set_core->parent_indexes
-					    [check_sit_ind]]);
-#else
-		    check_sit_orig
-		      = check_set->dists[check_set_core->parent_indexes
-					 [check_sit_ind]];
+static struct parse_state *
+parse_state_alloc (void)
+{
+  struct parse_state *result;
+
+  if (free_parse_state == NULL)
+    {
+      OS_TOP_EXPAND (parse_state_os, sizeof (struct parse_state));
+      result = YAEP_STATIC_CAST(struct parse_state *, OS_TOP_BEGIN (parse_state_os));
+      OS_TOP_FINISH (parse_state_os);
+    }
+  else
+    {
+      result = free_parse_state;
+      free_parse_state = YAEP_REINTERPRET_CAST(struct parse_state *, free_parse_state->rule);
+    }
+  return result;
+}
+
+/* The following function frees STATE. */
+#if MAKE_INLINE
+INLINE
 #endif
-		}
-	      if (check_sit_orig == orig)
-		{
-		  found = TRUE;
-		  break;
-		}
-	    }
-	  if (!found)
-	    continue;
-	  if (n_candidates != 0)
-	    {
-	      *ambiguous_p = TRUE;
-	      if (grammar->one_parse_p)
-		break;
-	    }
-	  sit_rule = sit->rule;
-	  if (n_candidates == 0)
-	    orig_state->pl_ind = sit_orig;
-	  if (parent_anode != NULL && disp >= 0)
-	    {
-	      /* We should generate and use the translation of the
-	         nonterminal. */
-	      curr_state = orig_state;
-	      anode = orig_state->anode;
-	      /* We need translation of the rule. */
-	      if (n_candidates != 0)
-		{
-		  assert (!grammar->one_parse_p);
-		  if (n_candidates == 1)
-		    {
-		      VLO_EXPAND (orig_states, sizeof (struct parse_state *));
-		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (orig_states)))[-1]
-			= orig_state;
-		    }
+static void
+parse_state_free (struct parse_state *state)
+{
+  state->rule = YAEP_REINTERPRET_CAST(struct rule *, free_parse_state);
+  free_parse_state = state;
+}
+
+/* The following function searches for state in the table with the
+   same characteristics as *STATE.  If it found it, it returns pointer
+   to the state in the table.  Otherwise the function makes copy of
+   *STATE, inserts into the table and returns pointer to copied state.
+   In the last case, the function also sets up *NEW_P. */
+#if MAKE_INLINE
+INLINE
+#endif
+static struct parse_state *
+parse_state_insert (struct parse_state *state, int *new_p)
+{
+  hash_table_entry_t *entry;
+
+  entry = find_hash_table_entry (parse_state_tab, state, TRUE);
+  *new_p = FALSE;
+  if (*entry != NULL)
+    return YAEP_STATIC_CAST(struct parse_state *, *entry);
+  *new_p = TRUE;
+  /* We make copy because pl_ind can be changed in further processing
+     state. */
+  *entry = parse_state_alloc ();
+  *YAEP_STATIC_CAST(struct parse_state *, *entry) = *state;
+  return YAEP_STATIC_CAST(struct parse_state *, *entry);
+}
+
+/* The following function finalizes work with parser states. */
+static void
+parse_state_fin (void)
+{
+  if (!curr_one_parse_p)
+    delete_hash_table (parse_state_tab);
+}
+
+/* The following structure describes a situation of a deterministic
+   reduction path which is absent in the set at PLACE because of Leo
+   items.  The situation completes the last symbol of the path
+   situation with rule RULE and origin ORIG (the both situations are
+   in the set at PLACE).  Situations with the same place, rule, and
+   origin are chained by NEXT.  */
+struct leo_sit
+{
+  int place;
+  struct rule *rule;
+  int orig;
+  struct sit *sit;
+  int sit_orig;
+  struct leo_sit *next;
+};
+
+/* The following table contains situations omitted because of Leo
+   items.  For each place where the situations were restored, the
+   table also contains the element with NULL rule. */
+#define leo_sits_tab (curr_parser->x_leo_sits_tab)	/* Key is place, rule, orig. */
+
+/* Hash of situations omitted because of Leo items. */
+static unsigned
+leo_sit_hash (hash_table_entry_t s)
+{
+  const struct leo_sit *leo_sit = YAEP_STATIC_CAST(const struct leo_sit *, s);
+
+  return (((jauquet_prime_mod32 * hash_shift +
+	    YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, leo_sit->rule))) * hash_shift +
+	   YAEP_STATIC_CAST(unsigned, leo_sit->orig)) * hash_shift
+	  + YAEP_STATIC_CAST(unsigned, leo_sit->place));
+}
+
+/* Equality of situations omitted because of Leo items. */
+static int
+leo_sit_eq (hash_table_entry_t s1, hash_table_entry_t s2)
+{
+  const struct leo_sit *leo_sit1 = YAEP_STATIC_CAST(const struct leo_sit *, s1);
+  const struct leo_sit *leo_sit2 = YAEP_STATIC_CAST(const struct leo_sit *, s2);
+
+  return (leo_sit1->place == leo_sit2->place
+	  && leo_sit1->rule == leo_sit2->rule
+	  && leo_sit1->orig == leo_sit2->orig);
+}
+
+/* The following function returns new element of leo_sits_tab with
+   the given characteristics.  */
+static struct leo_sit *
+leo_sit_create (int place, struct rule *rule, int orig,
+		struct sit *sit, int sit_orig)
+{
+  struct leo_sit *leo_sit;
+
+  OS_TOP_EXPAND (leo_items_os, sizeof (struct leo_sit));
+  leo_sit = YAEP_STATIC_CAST(struct leo_sit *, OS_TOP_BEGIN (leo_items_os));
+  OS_TOP_FINISH (leo_items_os);
+  leo_sit->place = place;
+  leo_sit->rule = rule;
+  leo_sit->orig = orig;
+  leo_sit->sit = sit;
+  leo_sit->sit_orig = sit_orig;
+  leo_sit->next = NULL;
+  return leo_sit;
+}
+
+/* The following function restores situations of the deterministic
+   reduction paths omitted in the set at PLACE because of Leo items
+   and inserts them into leo_sits_tab.  */
+static void
+leo_sits_restore (int place)
+{
+  struct leo_use *uses;
+  struct leo_item *item;
+  struct leo_sit key, *leo_sit;
+  hash_table_entry_t *entry;
+  size_t n, low, high, middle;
+
+  uses = YAEP_STATIC_CAST(struct leo_use *, VLO_BEGIN (leo_uses_vlo));
+  n = VLO_NELS (leo_uses_vlo, struct leo_use);
+  /* The usages are ordered by places.  Find the first usage of
+     PLACE.  */
+  for (low = 0, high = n; low < high;)
+    {
+      middle = (low + high) / 2;
+      if (uses[middle].place < place)
+	low = middle + 1;
+      else
+	high = middle;
+    }
+  key.place = place;
+  for (; low < n && uses[low].place == place; low++)
+    for (item = uses[low].item; item->next != NULL; item = item->next)
       {
-        size_t _tmp_orig_states_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (orig_states)
-                  / sizeof (struct parse_state *));
-        int _start_j = (_tmp_orig_states_n == 0 ? -1 : YAEP_STATIC_CAST(int, _tmp_orig_states_n - 1));
-        for (j = _start_j; j >= 0; j--)
-          if ((YAEP_STATIC_CAST(struct parse_state **,
-       VLO_BEGIN (orig_states)))[j]->pl_ind == sit_orig)
-      break;
-      }
-		  if (j >= 0)
-		    {
-		      /* [A -> x., n] & [A -> y., n] */
-		      curr_state = (YAEP_STATIC_CAST(struct parse_state **,
-				    VLO_BEGIN (orig_states)))[j];
-		      anode = curr_state->anode;
-		    }
-		  else
-		    {
-		      /* [A -> x., n] & [A -> y., m] where n != m. */
-		      /* It is different from the previous ones so add
-		         it to process. */
-		      state = parse_state_alloc ();
-		      VLO_EXPAND (stack, sizeof (struct parse_state *));
-		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (stack)))[-1] = state;
-		      *state = *orig_state;
-		      state->pl_ind = sit_orig;
-		      if (anode != NULL)
-			state->anode
-			  = copy_anode (parent_anode->val.anode.children
-					+ parent_disp, anode, rule, disp);
-		      VLO_EXPAND (orig_states, sizeof (struct parse_state *));
-		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (orig_states)))[-1]
-			= state;
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
-        if (grammar->debug_level > 3)
-            {
-        /* Compute top index safely to avoid unsigned->signed narrowing
-        in the fprintf call. */
-        size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (stack) / sizeof (struct parse_state *));
-        long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
-        fprintf (stderr,
-          "  Adding top %ld, set place = %d, modified sit = ",
-          _top_index,
-          sit_orig);
-        rule_dot_print (stderr, state->rule, state->pos);
-        fprintf (stderr, ", %d\n", state->orig);
+	key.rule = item->next->sit->rule;
+	key.orig = item->next->orig;
+	entry = find_hash_table_entry (leo_sits_tab, &key, TRUE);
+	for (leo_sit = YAEP_STATIC_CAST(struct leo_sit *, *entry);
+	     leo_sit != NULL;
+	     leo_sit = leo_sit->next)
+	  if (leo_sit->sit == item->sit && leo_sit->sit_orig == item->orig)
+	    break;
+	if (leo_sit != NULL)
+	  /* The rest of the path is already restored.  */
+	  break;
+	leo_sit = leo_sit_create (place, key.rule, key.orig,
+				  item->sit, item->orig);
+	leo_sit->next = YAEP_STATIC_CAST(struct leo_sit *, *entry);
+	*entry = leo_sit;
       }
+}
+
+/* The following function returns the first situation omitted because
+   of Leo items in the set at PLACE which completes the last symbol of
+   the situation with RULE and origin ORIG.  */
+static struct leo_sit *
+leo_sits_find (int place, struct rule *rule, int orig)
+{
+  struct leo_sit key;
+  hash_table_entry_t *entry;
+
+  key.place = place;
+  key.rule = NULL;
+  key.orig = 0;
+  entry = find_hash_table_entry (leo_sits_tab, &key, TRUE);
+  if (*entry == NULL)
+    {
+      *entry = leo_sit_create (place, NULL, 0, NULL, 0);
+      leo_sits_restore (place);
+    }
+  key.rule = rule;
+  key.orig = orig;
+  entry = find_hash_table_entry (leo_sits_tab, &key, FALSE);
+  return YAEP_STATIC_CAST(struct leo_sit *, *entry);
+}
+
+/* The following function returns TRUE if the set at PLACE contains
+   situation SIT with origin ORIG among reduces in CORE_SYMB_VECT (it
+   can be NULL).  */
+static int
+reduce_sit_in_set_p (int place, struct core_symb_vect *core_symb_vect,
+		     struct sit *sit, int orig)
+{
+  struct set *set = pl[place];
+  struct set_core *set_core = set->core;
+  int i, sit_ind, sit_orig;
+
+  if (core_symb_vect == NULL)
+    return FALSE;
+  for (i = 0; i < core_symb_vect->reduces.len; i++)
+    {
+      sit_ind = core_symb_vect->reduces.els[i];
+      if (set_core->sits[sit_ind] != sit)
+	continue;
+      if (sit_ind < set_core->n_start_sits)
+#ifndef ABSOLUTE_DISTANCES
+	sit_orig = place - set->dists[sit_ind];
+#else
+	sit_orig = set->dists[sit_ind];
 #endif
-		      curr_state = state;
-		      anode = state->anode;
-		    }
-		}		/* if (n_candidates != 0) */
-	      if (sit_rule->anode != NULL)
-		{
-		  /* This rule creates abstract node. */
-		  state = parse_state_alloc ();
-		  state->rule = sit_rule;
-		  state->pos = sit->pos;
-		  state->orig = sit_orig;
-		  state->pl_ind = pl_ind;
-		  table_state = NULL;
-		  if (!grammar->one_parse_p)
-		    table_state = parse_state_insert (state, &new_p);
-		  if (table_state == NULL || new_p)
-		    {
-		      /* We need new abtract node. */
-		      n_parse_abstract_nodes++;
-		      node
-			= (YAEP_STATIC_CAST(struct yaep_tree_node *,
-			   (*parse_alloc) (YAEP_STATIC_CAST(int, (YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node))
-					   + YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node *))
-					   * YAEP_STATIC_CAST(size_t, (sit_rule->trans_len + 1)))))));
-		      state->anode = node;
-		      if (table_state != NULL)
-			table_state->anode = node;
-		      node->type = YAEP_ANODE;
-		      if (sit_rule->caller_anode == NULL)
-			{
-			  sit_rule->caller_anode
-			    = (YAEP_STATIC_CAST(char *,
-			       (*parse_alloc) (YAEP_STATIC_CAST(int, (YAEP_STATIC_CAST(size_t, (strlen (sit_rule->anode) + 1)))))));
-			  strcpy (sit_rule->caller_anode, sit_rule->anode);
-			}
-		      node->val.anode.name = sit_rule->caller_anode;
-		      node->val.anode.cost = sit_rule->anode_cost;
-		      node->val.anode.children
-			= (YAEP_REINTERPRET_CAST(struct yaep_tree_node **,
-			   (YAEP_REINTERPRET_CAST(char *, node) + sizeof (struct yaep_tree_node))));
-		      for (k = 0; k <= sit_rule->trans_len; k++)
-			node->val.anode.children[k] = NULL;
-		      VLO_EXPAND (stack, sizeof (struct parse_state *));
-		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (stack)))[-1] = state;
-		      if (anode == NULL)
-			{
-			  state->parent_anode_state
-			    = curr_state->parent_anode_state;
-			  state->parent_disp = parent_disp;
-			}
-		      else
-			{
-			  state->parent_anode_state = curr_state;
-			  state->parent_disp = disp;
-			}
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
-        if (grammar->debug_level > 3)
-            {
-        size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (stack) / sizeof (struct parse_state *));
-        long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
-        fprintf (stderr,
-          "  Adding top %ld, set place = %d, sit = ",
-          _top_index, pl_ind);
-        sit_print (stderr, sit, grammar->debug_level > 5);
-        fprintf (stderr, ", %d\n", sit_orig);
-      }
+      else if (sit_ind < set_core->n_all_dists)
+#ifndef ABSOLUTE_DISTANCES
+	sit_orig = place - set->dists[set_core->parent_indexes[sit_ind]];
+#else
+	sit_orig = set->dists[set_core->parent_indexes[sit_ind]];
+#endif
+      else
+	sit_orig = place;
+      if (sit_orig == orig)
+	return TRUE;
+    }
+  return FALSE;
+}
+
+
+
+#ifndef NO_YAEP_DEBUG_PRINT
+
+/* This page conatins code to traverse translation. */
+
+/* To make better traversing and don't waist tree parse memory,
+   we use the following structures to enumerate the tree node. */
+struct trans_visit_node
+{
+  /* The following member is order number of the node.  This value is
+     negative if we did not visit the node yet. */
+  int num;
+  /* The tree node itself. */
+  struct yaep_tree_node *node;
+};
+
+/* The key of the following table is node itself. */
+#define trans_visit_nodes_tab (curr_parser->x_trans_visit_nodes_tab)
+
+/* All translation visit nodes are placed in the following stack.  All
+   the nodes are in the table. */
+#define trans_visit_nodes_os (curr_parser->x_trans_visit_nodes_os)
+
+/* The following value is number of translation visit nodes. */
+#define n_trans_visit_nodes (curr_parser->x_n_trans_visit_nodes)
+
+/* Hash of translation visit node. */
+static unsigned
+trans_visit_node_hash (hash_table_entry_t n)
+{
+  /* The hash only needs to read the node pointer; use a const view to
+     avoid casting away qualifiers and to make intent explicit. */
+  const struct trans_visit_node *tn = (YAEP_STATIC_CAST(const struct trans_visit_node *, n));
+  return YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, tn->node));
+}
+
+/* Equality of translation visit nodes. */
+static int
+trans_visit_node_eq (hash_table_entry_t n1, hash_table_entry_t n2)
+{
+  const struct trans_visit_node *tn1 = (YAEP_STATIC_CAST(const struct trans_visit_node *, n1));
+  const struct trans_visit_node *tn2 = (YAEP_STATIC_CAST(const struct trans_visit_node *, n2));
+  return (tn1->node == tn2->node);
+}
+
+/* The following function checks presence translation visit node with
+   given NODE in the table and if it is not present in the table, the
+   function creates the translation visit node and inserts it into
+   the table. */
+static struct trans_visit_node *
+visit_node (struct yaep_tree_node *node)
+{
+  struct trans_visit_node trans_visit_node;
+  hash_table_entry_t *entry;
+
+  trans_visit_node.node = node;
+  entry = find_hash_table_entry (trans_visit_nodes_tab,
+				 &trans_visit_node, TRUE);
+  if (*entry == NULL)
+    {
+      /* If it is the new node, we did not visit it yet. */
+      trans_visit_node.num = -1 - n_trans_visit_nodes;
+      n_trans_visit_nodes++;
+      OS_TOP_ADD_MEMORY (trans_visit_nodes_os,
+			 &trans_visit_node, sizeof (trans_visit_node));
+    /* Store newly-created trans_visit_node (owned/mutable) in the
+      global table; cast via void* to make the intent explicit. */
+    *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, OS_TOP_BEGIN (trans_visit_nodes_os)));
+      OS_TOP_FINISH (trans_visit_nodes_os);
+    }
+  return YAEP_STATIC_CAST(struct trans_visit_node *, *entry);
+}
+
+/* The following function returns the positive order number of node
+   with number NUM. */
+#if MAKE_INLINE
+INLINE
+#endif
+static int
+canon_node_num (int num)
+{
+  return (num < 0 ? -num - 1 : num);
+}
+
+/* The following recursive function prints NODE into file F and prints
+   all its children (if debug_level < 0 output format is for
+   graphviz). */
+static void
+print_node (FILE * f, struct yaep_tree_node *node)
+{
+  struct trans_visit_node *trans_visit_node;
+  struct yaep_tree_node *child;
+  int i;
+
+  assert (node != NULL);
+  trans_visit_node = visit_node (node);
+  if (trans_visit_node->num >= 0)
+    return;
+  trans_visit_node->num = -trans_visit_node->num - 1;
+  if (grammar->debug_level > 0)
+    fprintf (f, "%7d: ", trans_visit_node->num);
+  switch (node->type)
+    {
+    case YAEP_NIL:
+      if (grammar->debug_level > 0)
+	fprintf (f, "EMPTY\n");
+      break;
+    case YAEP_ERROR:
+      if (grammar->debug_level > 0)
+	fprintf (f, "ERROR\n");
+      break;
+    case YAEP_TERM:
+      if (grammar->debug_level > 0)
+	fprintf (f, "TERMINAL: code=%d, repr=%s\n", node->val.term.code,
+		 symb_find_by_code (node->val.term.code)->repr);
+      break;
+    case YAEP_ANODE:
+      if (grammar->debug_level > 0)
+	{
+	  fprintf (f, "ABSTRACT: %s (", node->val.anode.name);
+	  for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
+	    fprintf (f, " %d", canon_node_num (visit_node (child)->num));
+	  fprintf (f, " )\n");
+	}
+      else
+	{
+	  for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
+	    {
+	      fprintf (f, "  \"%d: %s\" -> \"%d: ", trans_visit_node->num,
+		       node->val.anode.name,
+		       canon_node_num (visit_node (child)->num));
+	      switch (child->type)
+		{
+		case YAEP_NIL:
+		  fprintf (f, "EMPTY");
+		  break;
+		case YAEP_ERROR:
+		  fprintf (f, "ERROR");
+		  break;
+		case YAEP_TERM:
+		  fprintf (f, "%s",
+			   symb_find_by_code (child->val.term.code)->repr);
+		  break;
+		case YAEP_ANODE:
+		  fprintf (f, "%s", child->val.anode.name);
+		  break;
+		case YAEP_ALT:
+		  fprintf (f, "ALT");
+		  break;
+		default:
+		  assert (FALSE);
+		}
+	      fprintf (f, "\";\n");
+	    }
+	}
+      for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
+	print_node (f, child);
+      break;
+    case YAEP_ALT:
+      if (grammar->debug_level > 0)
+	{
+	  fprintf (f, "ALTERNATIVE: node=%d, next=",
+		   canon_node_num (visit_node (node->val.alt.node)->num));
+	  if (node->val.alt.next != NULL)
+	    fprintf (f, "%d\n",
+		     canon_node_num (visit_node (node->val.alt.next)->num));
+	  else
+	    fprintf (f, "nil\n");
+	}
+      else
+	{
+	  fprintf (f, "  \"%d: ALT\" -> \"%d: ", trans_visit_node->num,
+		   canon_node_num (visit_node (node->val.alt.node)->num));
+	  switch (node->val.alt.node->type)
+	    {
+	    case YAEP_NIL:
+	      fprintf (f, "EMPTY");
+	      break;
+	    case YAEP_ERROR:
+	      fprintf (f, "ERROR");
+	      break;
+	    case YAEP_TERM:
+	      fprintf (f, "%s",
+		       symb_find_by_code (node->val.alt.node->val.term.code)->
+		       repr);
+	      break;
+	    case YAEP_ANODE:
+	      fprintf (f, "%s", node->val.alt.node->val.anode.name);
+	      break;
+	    case YAEP_ALT:
+	      fprintf (f, "ALT");
+	      break;
+	    default:
+	      assert (FALSE);
+	    }
+	  fprintf (f, "\";\n");
+	  if (node->val.alt.next != NULL)
+	    fprintf (f, "  \"%d: ALT\" -> \"%d: ALT\";\n",
+		     trans_visit_node->num,
+		     canon_node_num (visit_node (node->val.alt.next)->num));
+	}
+      print_node (f, node->val.alt.node);
+      if (node->val.alt.next != NULL)
+	print_node (f, node->val.alt.next);
+      break;
+    default:
+      assert (FALSE);
+    }
+}
+
+/* The following function prints parse tree with ROOT. */
+static void
+print_parse (FILE * f, struct yaep_tree_node *root)
+{
+  trans_visit_nodes_tab =
+    create_hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 2, trans_visit_node_hash,
+		       trans_visit_node_eq);
+  n_trans_visit_nodes = 0;
+  OS_CREATE (trans_visit_nodes_os, grammar->alloc, 0);
+  print_node (f, root);
+  OS_DELETE (trans_visit_nodes_os);
+  delete_hash_table (trans_visit_nodes_tab);
+}
+
+/* The following function prints translation RESULT of the parse
+   according to the debug level. */
+static void
+print_translation (struct yaep_tree_node *result)
+{
+  if (grammar->debug_level > 1)
+    {
+      fprintf (stderr, "Translation:\n");
+      print_parse (stderr, result);
+      fprintf (stderr, "\n");
+    }
+  else if (grammar->debug_level < 0)
+    {
+      fprintf (stderr, "digraph CFG {\n");
+      fprintf (stderr, "  node [shape=ellipse, fontsize=200];\n");
+      fprintf (stderr, "  ratio=fill;\n");
+      fprintf (stderr, "  ordering=out;\n");
+      fprintf (stderr, "  page = \"8.5, 11\"; // inches\n");
+      fprintf (stderr, "  size = \"7.5, 10\"; // inches\n\n");
+      print_parse (stderr, result);
+      fprintf (stderr, "}\n");
+    }
+}
+
+#endif
+
+/* The following is number of created terminal, abstract, and
+   alternative nodes. */
+#define n_parse_term_nodes (curr_parser->x_n_parse_term_nodes)
+#define n_parse_abstract_nodes (curr_parser->x_n_parse_abstract_nodes)
+#define n_parse_alt_nodes (curr_parser->x_n_parse_alt_nodes)
+
+/* The following function places translation NODE into *PLACE and
+   creates alternative nodes if it is necessary. */
+#if MAKE_INLINE
+INLINE
+#endif
+static void
+place_translation (struct yaep_tree_node **place, struct yaep_tree_node *node)
+{
+  struct yaep_tree_node *alt, *next_alt;
+
+  assert (place != NULL);
+  if (*place == NULL)
+    {
+      *place = node;
+      return;
+    }
+  /* We need an alternative. */
+#ifndef NO_YAEP_DEBUG_PRINT
+  n_parse_alt_nodes++;
+#endif
+  alt = YAEP_STATIC_CAST(struct yaep_tree_node *, (*parse_alloc) (sizeof
+						  (struct yaep_tree_node)));
+  alt->type = YAEP_ALT;
+  alt->val.alt.node = node;
+  if ((*place)->type == YAEP_ALT)
+    alt->val.alt.next = *place;
+  else
+    {
+      /* We need alternative node for the 1st
+         alternative too. */
+      n_parse_alt_nodes++;
+      next_alt = alt->val.alt.next
+	= (YAEP_STATIC_CAST(struct yaep_tree_node *,
+	   (*parse_alloc) (sizeof (struct yaep_tree_node))));
+      next_alt->type = YAEP_ALT;
+      next_alt->val.alt.node = *place;
+      next_alt->val.alt.next = NULL;
+    }
+  *place = alt;
+}
+
+static struct yaep_tree_node *
+copy_anode (struct yaep_tree_node **place, struct yaep_tree_node *anode,
+	    struct rule *rule, int disp)
+{
+  struct yaep_tree_node *node;
+  int i;
+
+  node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+	  (*parse_alloc) (YAEP_STATIC_CAST(int, (YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node))
+			  + YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node *))
+			  * YAEP_STATIC_CAST(size_t, (rule->trans_len + 1)))))));
+  *node = *anode;
+  node->val.anode.children
+    = (YAEP_REINTERPRET_CAST(struct yaep_tree_node **,
+       (YAEP_REINTERPRET_CAST(char *, node) + sizeof (struct yaep_tree_node))));
+  for (i = 0; i <= rule->trans_len; i++)
+    node->val.anode.children[i] = anode->val.anode.children[i];
+  node->val.anode.children[disp] = NULL;
+  place_translation (place, node);
+  return node;
+}
+
+/* The following table is used to find allocated memory which should
+   not be freed. */
+#define reserv_mem_tab (curr_parser->x_reserv_mem_tab)
+
+/* The hash of the memory reference. */
+static unsigned
+reserv_mem_hash (hash_table_entry_t m)
+{
+  return YAEP_STATIC_CAST(unsigned, YAEP_REINTERPRET_CAST(size_t, m));
+}
+
+/* The equity of the memory reference. */
+static int
+reserv_mem_eq (hash_table_entry_t m1, hash_table_entry_t m2)
+{
+  return m1 == m2;
+}
+
+/* The following vlo will contain references to memory which should be
+   freed.  The same reference can be represented more on time. */
+#define tnodes_vlo (curr_parser->x_tnodes_vlo)
+
+/* The following function sets up minimal cost for each abstract node.
+   The function returns minimal translation corresponding to NODE.
+   The function also collects references to memory which can be
+   freed. Remeber that the translation is DAG, altenatives form lists
+   (alt node may not refer for another alternative). */
+static struct yaep_tree_node *
+prune_to_minimal (struct yaep_tree_node *node, int *cost)
+{
+  struct yaep_tree_node *child, *alt, *next_alt, *result = NULL;
+  int i, min_cost = INT_MAX; /* Initialize to sentinel so comparisons are well-defined */
+
+  assert (node != NULL);
+  switch (node->type)
+    {
+    case YAEP_NIL:
+    case YAEP_ERROR:
+    case YAEP_TERM:
+      if (parse_free != NULL)
+	VLO_ADD_MEMORY (tnodes_vlo, &node, sizeof (node));
+      *cost = 0;
+      return node;
+    case YAEP_ANODE:
+      if (node->val.anode.cost >= 0)
+	{
+	  if (parse_free != NULL)
+	    VLO_ADD_MEMORY (tnodes_vlo, &node, sizeof (node));
+	  for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
+	    {
+	      node->val.anode.children[i] = prune_to_minimal (child, cost);
+	      node->val.anode.cost += *cost;
+	    }
+	  *cost = node->val.anode.cost;
+          node->val.anode.cost = -node->val.anode.cost - 1;	/* flag of visit */
+	}
+      return node;
+    case YAEP_ALT:
+  for (alt = node; alt != NULL; alt = next_alt)
+	{
+	  if (parse_free != NULL)
+	    VLO_ADD_MEMORY (tnodes_vlo, &alt, sizeof (alt));
+	  next_alt = alt->val.alt.next;
+	  alt->val.alt.node = prune_to_minimal (alt->val.alt.node, cost);
+    if (alt == node || min_cost > *cost)
+	    {
+	      min_cost = *cost;
+	      alt->val.alt.next = NULL;
+	      result = alt;
+	    }
+    else if (min_cost == *cost && !grammar->one_parse_p)
+	    {
+	      alt->val.alt.next = result;
+	      result = alt;
+	    }
+	}
+      *cost = (min_cost == INT_MAX ? 0 : min_cost);
+      assert (result != NULL); /* result must be set because at least one alt exists */
+      return (result->val.alt.next == NULL ? result->val.alt.node : result);
+    default:
+      assert (FALSE);
+    }
+  *cost = 0;
+  return NULL;
+}
+
+/* The following function traverses the translation collecting
+   reference to memory which may not be freed. */
+static void
+traverse_pruned_translation (struct yaep_tree_node *node)
+{
+  struct yaep_tree_node *child;
+  hash_table_entry_t *entry;
+  int i;
+
+ next:
+  assert (node != NULL);
+  if (parse_free != NULL
+      && *(entry =
+	   find_hash_table_entry (reserv_mem_tab, node, TRUE)) == NULL)
+   /* Insert owned mutable node pointer into the table; cast through
+     void* to satisfy the public const-qualified entry type. */
+   *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, node));
+  switch (node->type)
+    {
+    case YAEP_NIL:
+    case YAEP_ERROR:
+    case YAEP_TERM:
+      break;
+    case YAEP_ANODE:
+      if (parse_free != NULL
+  && *(entry = find_hash_table_entry_c (reserv_mem_tab,
+               node->val.anode.name,
+               TRUE)) == NULL)
+  /* Record the owned name pointer in the reservation table so that
+     later cleanup does NOT free it. Previous logic erroneously used
+     '!= NULL', skipping insertion and leading to premature free and
+     corrupted abstract node names (seen in tests 45/47).
+     Use union to avoid cast-qual warning when storing const char*. */
+	{
+	  union { const char *cc; void *v; } u;
+	  u.cc = node->val.anode.name;
+	  *entry = YAEP_STATIC_CAST(hash_table_entry_t, u.v);
+	}
+      for (i = 0; (child = node->val.anode.children[i]) != NULL; i++)
+	traverse_pruned_translation (child);
+      assert (node->val.anode.cost < 0);
+      node->val.anode.cost = -node->val.anode.cost - 1;
+      break;
+    case YAEP_ALT:
+      traverse_pruned_translation (node->val.alt.node);
+      if ((node = node->val.alt.next) != NULL)
+	goto next;
+      break;
+    default:
+      assert (FALSE);
+    }
+  return;
+}
+
+/* The function finds and returns a minimal cost parse(s). */
+static struct yaep_tree_node *
+find_minimal_translation (struct yaep_tree_node *root)
+{
+  struct yaep_tree_node **node_ptr;
+  hash_table_entry_t *entry;
+  int cost;
+
+  if (parse_free != NULL)
+    {
+      reserv_mem_tab =
+	create_hash_table (grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 4, reserv_mem_hash,
+			   reserv_mem_eq);
+      VLO_CREATE (tnodes_vlo, grammar->alloc, YAEP_STATIC_CAST(size_t, toks_len) * 4 * sizeof (void *));
+    }
+  root = prune_to_minimal (root, &cost);
+  traverse_pruned_translation (root);
+  if (parse_free != NULL)
+    {
+      for (node_ptr = YAEP_STATIC_CAST(struct yaep_tree_node **, VLO_BEGIN (tnodes_vlo));
+	   node_ptr < YAEP_STATIC_CAST(struct yaep_tree_node **, VLO_BOUND (tnodes_vlo));
+	   node_ptr++)
+  if (*(entry = find_hash_table_entry_c (reserv_mem_tab, *node_ptr, TRUE)) == NULL)
+	   {
+	     /* The node and the name can be met several times, so remember
+	        that they are already freed. */
+	     *entry = YAEP_STATIC_CAST(hash_table_entry_t, YAEP_STATIC_CAST(void *, *node_ptr));
+	     /* The only empty and error nodes are freed by make_parse if
+	        they are not used. */
+	     if ((*node_ptr)->type == YAEP_NIL)
+	       {
+		 (*node_ptr)->val.nil.used = FALSE;
+		 continue;
+	       }
+	     if ((*node_ptr)->type == YAEP_ERROR)
+	       {
+		 (*node_ptr)->val.error.used = FALSE;
+		 continue;
+	       }
+	     if ((*node_ptr)->type == YAEP_ANODE
+       && *(entry = find_hash_table_entry_c (reserv_mem_tab,
+                  (*node_ptr)->val.anode.name,
+                  TRUE)) == NULL)
+	       {
+		 /* Use union to avoid cast-qual warning when freeing const char*
+		    allocated by user's parse_alloc. The user owns the memory. */
+		 union { const char *cc; void *v; } u;
+		 u.cc = (*node_ptr)->val.anode.name;
+		 *entry = YAEP_STATIC_CAST(hash_table_entry_t, u.v);
+		 (*parse_free) (u.v);
+	       }
+	     (*parse_free) (*node_ptr);
+	   }
+      VLO_DELETE (tnodes_vlo);
+      delete_hash_table (reserv_mem_tab);
+    }
+  return root;
+}
+
+/* The following function returns TRUE if the last set contains the
+   only start situation "$S : <start symb> $eof ." with the origin in
+   the first set, i.e. if the input was recognized.  It is always so
+   if the error recovery is switched on. */
+static int
+input_recognized_p (void)
+{
+  struct set *set;
+  struct sit *sit;
+
+  set = pl[pl_curr];
+  assert (grammar->axiom != NULL);
+  sit = (set->core->sits != NULL ? set->core->sits[0] : NULL);
+  if (sit == NULL
+#ifndef ABSOLUTE_DISTANCES
+      || set->dists[0] != pl_curr
+#else
+      || set->dists[0] != 0
+#endif
+      || sit->rule->lhs != grammar->axiom || sit->pos != sit->rule->rhs_len)
+    {
+      /* It is possible only if error recovery is switched off.
+         Because we always adds rule `axiom: error $eof'. */
+      assert (!grammar->error_recovery_p);
+      return FALSE;
+    }
+  return TRUE;
+}
+
+/* The following function returns a node of type YAEP_NIL allocated
+   by parse_alloc.  It is the tree root returned when no tree is built
+   for the recognized input. */
+static struct yaep_tree_node *
+make_nil_root (void)
+{
+  struct yaep_tree_node *result;
+
+  result = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+	    (*parse_alloc) (sizeof (struct yaep_tree_node))));
+  result->type = YAEP_NIL;
+  result->val.nil.used = 1;
+  return result;
+}
+
+/* The following function is used instead of make_parse in the
+   recognition mode.  It returns a node of type YAEP_NIL allocated by
+   parse_alloc if the input was recognized and NULL otherwise.  No
+   parse state is formed and no tree node is created for the input,
+   so the ambiguity is not checked. */
+static struct yaep_tree_node *
+make_recognition (void)
+{
+  n_parse_term_nodes = n_parse_abstract_nodes = n_parse_alt_nodes = 0;
+  if (!input_recognized_p ())
+    return NULL;
+  return make_nil_root ();
+}
+
+/* In the tree events mode, the tree nodes are allocated in
+   tree_events_os.  Each node is preceded by the following header
+   containing the number of the first token of the node. */
+union tree_events_header
+{
+  int tok_num;
+  void *align_ptr;
+  double align_double;
+};
+
+/* The following macro is the header field of NODE allocated in the
+   tree events mode. */
+#define tree_events_tok_num(node)					\
+  ((YAEP_REINTERPRET_CAST(union tree_events_header *, node) - 1)->tok_num)
+
+/* The following function is used instead of parse_alloc in the tree
+   events mode. */
+static void *
+tree_events_parse_alloc (int nmemb)
+{
+  union tree_events_header *header;
+
+  assert (nmemb > 0);
+  OS_TOP_EXPAND (tree_events_os,
+		 sizeof (union tree_events_header)
+		 + YAEP_STATIC_CAST(size_t, nmemb));
+  header = YAEP_STATIC_CAST(union tree_events_header *,
+			    OS_TOP_BEGIN (tree_events_os));
+  OS_TOP_FINISH (tree_events_os);
+  header->tok_num = -1;
+  return header + 1;
+}
+
+/* The following function finds parse tree of parsed input.  The
+   function sets up *AMBIGUOUS_P if we found that the grammer is
+   ambigous (it works even we asked only one parse tree without
+   alternatives). */
+static struct yaep_tree_node *
+make_parse (int *ambiguous_p)
+{
+  struct set *set, *check_set;
+  struct set_core *set_core, *check_set_core;
+  struct sit *sit, *check_sit;
+  struct rule *rule, *sit_rule;
+  struct symb *symb;
+  struct core_symb_vect *core_symb_vect, *check_core_symb_vect;
+  int i, k, found, pos, orig, pl_ind, n_candidates, disp; ptrdiff_t j;
+  int sit_ind, check_sit_ind, sit_orig, check_sit_orig, new_p, n_reduces;
+  struct leo_sit *leo_sit;
+  struct parse_state *state, *orig_state, *curr_state;
+  struct parse_state *table_state, *parent_anode_state;
+  struct parse_state root_state;
+  struct yaep_tree_node *result, *empty_node, *node, *error_node;
+  struct yaep_tree_node *parent_anode, *anode, root_anode;
+  int parent_disp;
+  struct yaep_tree_node **term_node_array = NULL; /* Initialize to ensure safe free guard */
+  vlo_t orig_states;
+
+  n_parse_term_nodes = n_parse_abstract_nodes = n_parse_alt_nodes = 0;
+  /* We have only one start situation: "$S : <start symb> $eof .".  */
+  if (!input_recognized_p ())
+    return NULL;
+  set = pl[pl_curr];
+  curr_one_parse_p = grammar->one_parse_p;
+  if (grammar->cost_p)
+    /* We need all parses to choose the minimal ones (the only minimal
+       one is found by make_min_cost_parse). */
+    curr_one_parse_p = FALSE;
+  if (curr_parser->tree_events != NULL)
+    /* The events describe only one parse. */
+    curr_one_parse_p = TRUE;
+  sit = set->core->sits[0];
+  parse_state_init ();
+  leo_sits_tab = NULL;
+  if (curr_leo_p && VLO_LENGTH (leo_uses_vlo) != 0)
+    leo_sits_tab = create_hash_table (grammar->alloc, 1000, leo_sit_hash,
+				      leo_sit_eq);
+  if (!curr_one_parse_p)
+    {
+      void *mem;
+
+      /* We need this array to reuse terminal nodes only for
+         generation of several parses. */
+      mem =
+	yaep_malloc (grammar->alloc,
+		     YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node *)) * YAEP_STATIC_CAST(size_t, toks_len));
+      term_node_array = YAEP_STATIC_CAST(struct yaep_tree_node **, mem);
+      for (i = 0; i < toks_len; i++)
+	term_node_array[i] = NULL;
+      /* The following is used to check necessity to create current
+         state with different pl_ind. */
+      VLO_CREATE (orig_states, grammar->alloc, 0);
+    }
+  VLO_NULLIFY (parse_stack);
+  VLO_EXPAND (parse_stack, sizeof (struct parse_state *));
+  state = parse_state_alloc ();
+  (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (parse_stack)))[-1] = state;
+  rule = state->rule = sit->rule;
+  state->pos = sit->pos;
+  state->orig = 0;
+  state->pl_ind = pl_curr;
+  result = NULL;
+  root_state.anode = &root_anode;
+  root_anode.val.anode.children = &result;
+  state->parent_anode_state = &root_state;
+  state->parent_disp = 0;
+  state->anode = NULL;
+  /* Create empty and error node: */
+  empty_node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+		(*parse_alloc) (sizeof (struct yaep_tree_node))));
+  empty_node->type = YAEP_NIL;
+  empty_node->val.nil.used = 0;
+  error_node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+		(*parse_alloc) (sizeof (struct yaep_tree_node))));
+  error_node->type = YAEP_ERROR;
+  error_node->val.error.used = 0;
+  while (VLO_LENGTH (parse_stack) != 0)
+    {
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+      if ((grammar->debug_level > 2 && state->pos == state->rule->rhs_len)
+          || grammar->debug_level > 3)
+    {
+      /* Compute top index from VLO_LENGTH into a size_t temporary, then
+         convert to long with defined behavior for empty stack (use -1).
+         This avoids converting an unsigned size_t directly to long in the
+         fprintf call which can trigger compiler warnings. */
+      size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (parse_stack) / sizeof (struct parse_state *));
+      long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
+      fprintf (stderr, "Processing top %ld, set place = %d, sit = ",
+           _top_index,
+           state->pl_ind);
+      rule_dot_print (stderr, state->rule, state->pos);
+      fprintf (stderr, ", %d\n", state->orig);
+    }
+#endif
+      pos = --state->pos;
+      rule = state->rule;
+      parent_anode_state = state->parent_anode_state;
+      parent_anode = parent_anode_state->anode;
+      parent_disp = state->parent_disp;
+      anode = state->anode;
+      disp = rule->order[pos];
+      pl_ind = state->pl_ind;
+      orig = state->orig;
+      if (pos < 0)
+	{
+	  /* We've processed all rhs of the rule. */
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+      if ((grammar->debug_level > 2 && state->pos == state->rule->rhs_len)
+          || grammar->debug_level > 3)
+    {
+      /* See comment above: compute top index safely to avoid unsigned ->
+         signed narrowing in the call. */
+      size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (parse_stack) / sizeof (struct parse_state *));
+      long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
+      fprintf (stderr, "Poping top %ld, set place = %d, sit = ",
+               _top_index,
+               state->pl_ind);
+      rule_dot_print (stderr, state->rule, 0);
+      fprintf (stderr, ", %d\n", state->orig);
+    }
+#endif
+	  parse_state_free (state);
+	  VLO_SHORTEN (parse_stack, sizeof (struct parse_state *));
+	  if (VLO_LENGTH (parse_stack) != 0)
+	    state = (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (parse_stack)))[-1];
+	  if (parent_anode != NULL && rule->trans_len == 0 && anode == NULL)
+	    {
+	      /* We do produce nothing but we should.  So write empty
+	         node. */
+	      place_translation (parent_anode->val.anode.children +
+				 parent_disp, empty_node);
+	      empty_node->val.nil.used = 1;
+	    }
+	  else if (anode != NULL)
+	    {
+	      /* Change NULLs into empty nodes.  We can not make it
+	         the first time because when building several parses
+	         the NULL means flag of absence of translations (see
+	         function `place_translation'). */
+	      for (i = 0; i < rule->trans_len; i++)
+		if (anode->val.anode.children[i] == NULL)
+		  {
+		    anode->val.anode.children[i] = empty_node;
+		    empty_node->val.nil.used = 1;
+		  }
+	    }
+	  continue;
+	}
+      assert (pos >= 0);
+      if ((symb = rule->rhs[pos])->term_p)
+	{
+	  /* Terminal before dot: */
+	  pl_ind--;		/* l */
+#ifndef ABSOLUTE_DISTANCES
+	  /* Because of error recovery tok_symb (pl_ind) may be not
+	     equal to symb. */
+	  assert (tok_symb (pl_ind) == symb);
+#endif
+	  if (parent_anode != NULL && disp >= 0)
+	    {
+	      /* We should generate and use the translation of the
+	         terminal.  Add reference to the current node. */
+	      if (symb == grammar->term_error)
+		{
+		  node = error_node;
+		  error_node->val.error.used = 1;
+		}
+	      else if (!curr_one_parse_p
+		       && (node = term_node_array[pl_ind]) != NULL)
+		;
+	      else
+		{
+		  n_parse_term_nodes++;
+		  node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+			  (*parse_alloc) (sizeof (struct yaep_tree_node))));
+		  node->type = YAEP_TERM;
+		  node->val.term.code = symb->u.term.code;
+		  node->val.term.attr = tok_attr (pl_ind);
+		  if (curr_parser->tree_events != NULL)
+		    tree_events_tok_num (node) = pl_ind;
+		  if (!curr_one_parse_p)
+		    term_node_array[pl_ind] = node;
+		}
+	      place_translation
+		(anode != NULL ? anode->val.anode.children + disp
+		 : parent_anode->val.anode.children + parent_disp, node);
+	    }
+	  if (pos != 0)
+	    state->pl_ind = pl_ind;
+	  continue;
+	}
+      /* Nonterminal before dot: */
+      set = pl[pl_ind];
+      set_core = set->core;
+      core_symb_vect = core_symb_vect_find (set_core, symb);
+      n_reduces = core_symb_vect == NULL ? 0 : core_symb_vect->reduces.len;
+      /* The situations completing the last symbol can be omitted
+         because of Leo items. */
+      leo_sit = NULL;
+      if (leo_sits_tab != NULL && pos == rule->rhs_len - 1)
+	leo_sit = leo_sits_find (pl_ind, rule, orig);
+      assert (n_reduces != 0 || leo_sit != NULL);
+      n_candidates = 0;
+      orig_state = state;
+      if (!curr_one_parse_p)
+	VLO_NULLIFY (orig_states);
+      for (i = 0; i < n_reduces || leo_sit != NULL; i++)
+	{
+	  if (i >= n_reduces)
+	    {
+	      sit = leo_sit->sit;
+	      sit_orig = leo_sit->sit_orig;
+	      leo_sit = leo_sit->next;
+	      if (reduce_sit_in_set_p (pl_ind, core_symb_vect, sit, sit_orig))
+		continue;
+	    }
+	  else
+	    {
+	      sit_ind = core_symb_vect->reduces.els[i];
+	      sit = set_core->sits[sit_ind];
+	      if (sit_ind < set_core->n_start_sits)
+#ifndef ABSOLUTE_DISTANCES
+		sit_orig = pl_ind - set->dists[sit_ind];
+#else
+		sit_orig = set->dists[sit_ind];
+#endif
+	      else if (sit_ind < set_core->n_all_dists)
+#ifndef ABSOLUTE_DISTANCES
+		sit_orig
+		  = pl_ind - set->dists[set_core->parent_indexes[sit_ind]];
+#else
+		sit_orig = set->dists[set_core->parent_indexes[sit_ind]];
+#endif
+	      else
+		sit_orig = pl_ind;
+	    }
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+	  if (grammar->debug_level > 3)
+	    {
+	      fprintf (stderr, "    Trying set place = %d, sit = ", pl_ind);
+	      sit_print (stderr, sit, grammar->debug_level > 5);
+	      fprintf (stderr, ", %d\n", sit_orig);
+	    }
+#endif
+	  check_set = pl[sit_orig];
+	  check_set_core = check_set->core;
+	  check_core_symb_vect = core_symb_vect_find (check_set_core, symb);
+	  assert (check_core_symb_vect != NULL);
+	  found = FALSE;
+	  for (j = 0; j < check_core_symb_vect->transitions.len; j++)
+	    {
+	      check_sit_ind = check_core_symb_vect->transitions.els[j];
+	      check_sit = check_set->core->sits[check_sit_ind];
+	      if (check_sit->rule != rule || check_sit->pos != pos)
+		continue;
+	      check_sit_orig = sit_orig;
+	      if (check_sit_ind < check_set_core->n_all_dists)
+		{
+		  if (check_sit_ind < check_set_core->n_start_sits)
+#ifndef ABSOLUTE_DISTANCES
+		    check_sit_orig
+		      = sit_orig - check_set->dists[check_sit_ind];
+#else
+		    check_sit_orig = check_set->dists[check_sit_ind];
+#endif
+		  else
+#ifndef ABSOLUTE_DISTANCES
+		    check_sit_orig
+		      = (sit_orig
+			 - check_set->dists[check_set_core->parent_indexes
+					    [check_sit_ind]]);
+#else
+		    check_sit_orig
+		      = check_set->dists[check_set_core->parent_indexes
+					 [check_sit_ind]];
+#endif
+		}
+	      if (check_sit_orig == orig)
+		{
+		  found = TRUE;
+		  break;
+		}
+	    }
+	  if (!found)
+	    continue;
+	  if (n_candidates != 0)
+	    {
+	      *ambiguous_p = TRUE;
+	      if (curr_one_parse_p)
+		break;
+	    }
+	  sit_rule = sit->rule;
+	  if (n_candidates == 0)
+	    orig_state->pl_ind = sit_orig;
+	  if (parent_anode != NULL && disp >= 0)
+	    {
+	      /* We should generate and use the translation of the
+	         nonterminal. */
+	      curr_state = orig_state;
+	      anode = orig_state->anode;
+	      /* We need translation of the rule. */
+	      if (n_candidates != 0)
+		{
+		  assert (!curr_one_parse_p);
+		  if (n_candidates == 1)
+		    {
+		      VLO_EXPAND (orig_states, sizeof (struct parse_state *));
+		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (orig_states)))[-1]
+			= orig_state;
+		    }
+      {
+        size_t _tmp_orig_states_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (orig_states)
+                  / sizeof (struct parse_state *));
+        int _start_j = (_tmp_orig_states_n == 0 ? -1 : YAEP_STATIC_CAST(int, _tmp_orig_states_n - 1));
+        for (j = _start_j; j >= 0; j--)
+          if ((YAEP_STATIC_CAST(struct parse_state **,
+       VLO_BEGIN (orig_states)))[j]->pl_ind == sit_orig)
+      break;
+      }
+		  if (j >= 0)
+		    {
+		      /* [A -> x., n] & [A -> y., n] */
+		      curr_state = (YAEP_STATIC_CAST(struct parse_state **,
+				    VLO_BEGIN (orig_states)))[j];
+		      anode = curr_state->anode;
+		    }
+		  else
+		    {
+		      /* [A -> x., n] & [A -> y., m] where n != m. */
+		      /* It is different from the previous ones so add
+		         it to process. */
+		      state = parse_state_alloc ();
+		      VLO_EXPAND (parse_stack, sizeof (struct parse_state *));
+		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (parse_stack)))[-1] = state;
+		      *state = *orig_state;
+		      state->pl_ind = sit_orig;
+		      if (anode != NULL)
+			state->anode
+			  = copy_anode (parent_anode->val.anode.children
+					+ parent_disp, anode, rule, disp);
+		      VLO_EXPAND (orig_states, sizeof (struct parse_state *));
+		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (orig_states)))[-1]
+			= state;
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+        if (grammar->debug_level > 3)
+            {
+        /* Compute top index safely to avoid unsigned->signed narrowing
+        in the fprintf call. */
+        size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (parse_stack) / sizeof (struct parse_state *));
+        long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
+        fprintf (stderr,
+          "  Adding top %ld, set place = %d, modified sit = ",
+          _top_index,
+          sit_orig);
+        rule_dot_print (stderr, state->rule, state->pos);
+        fprintf (stderr, ", %d\n", state->orig);
+      }
+#endif
+		      curr_state = state;
+		      anode = state->anode;
+		    }
+		}		/* if (n_candidates != 0) */
+	      if (sit_rule->anode != NULL)
+		{
+		  /* This rule creates abstract node. */
+		  state = parse_state_alloc ();
+		  state->rule = sit_rule;
+		  state->pos = sit->pos;
+		  state->orig = sit_orig;
+		  state->pl_ind = pl_ind;
+		  table_state = NULL;
+		  if (!curr_one_parse_p)
+		    table_state = parse_state_insert (state, &new_p);
+		  if (table_state == NULL || new_p)
+		    {
+		      /* We need new abtract node. */
+		      n_parse_abstract_nodes++;
+		      node
+			= (YAEP_STATIC_CAST(struct yaep_tree_node *,
+			   (*parse_alloc) (YAEP_STATIC_CAST(int, (YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node))
+					   + YAEP_STATIC_CAST(size_t, sizeof (struct yaep_tree_node *))
+					   * YAEP_STATIC_CAST(size_t, (sit_rule->trans_len + 1)))))));
+		      state->anode = node;
+		      if (table_state != NULL)
+			table_state->anode = node;
+		      node->type = YAEP_ANODE;
+		      if (caller_anodes[sit_rule->num] == NULL)
+			{
+			  caller_anodes[sit_rule->num]
+			    = (YAEP_STATIC_CAST(char *,
+			       (*parse_alloc) (YAEP_STATIC_CAST(int, (YAEP_STATIC_CAST(size_t, (strlen (sit_rule->anode) + 1)))))));
+			  strcpy (caller_anodes[sit_rule->num], sit_rule->anode);
+			}
+		      node->val.anode.name = caller_anodes[sit_rule->num];
+		      node->val.anode.cost = sit_rule->anode_cost;
+		      if (curr_parser->tree_events != NULL)
+			tree_events_tok_num (node) = sit_orig;
+		      node->val.anode.children
+			= (YAEP_REINTERPRET_CAST(struct yaep_tree_node **,
+			   (YAEP_REINTERPRET_CAST(char *, node) + sizeof (struct yaep_tree_node))));
+		      for (k = 0; k <= sit_rule->trans_len; k++)
+			node->val.anode.children[k] = NULL;
+		      VLO_EXPAND (parse_stack, sizeof (struct parse_state *));
+		      (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (parse_stack)))[-1] = state;
+		      if (anode == NULL)
+			{
+			  state->parent_anode_state
+			    = curr_state->parent_anode_state;
+			  state->parent_disp = parent_disp;
+			}
+		      else
+			{
+			  state->parent_anode_state = curr_state;
+			  state->parent_disp = disp;
+			}
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+        if (grammar->debug_level > 3)
+            {
+        size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (parse_stack) / sizeof (struct parse_state *));
+        long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
+        fprintf (stderr,
+          "  Adding top %ld, set place = %d, sit = ",
+          _top_index, pl_ind);
+        sit_print (stderr, sit, grammar->debug_level > 5);
+        fprintf (stderr, ", %d\n", sit_orig);
+      }
+#endif
+		    }
+		  else
+		    {
+		      /* We allready have the translation. */
+		      assert (!curr_one_parse_p);
+		      parse_state_free (state);
+		      state = (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (parse_stack)))[-1];
+		      node = table_state->anode;
+		      assert (node != NULL);
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+		      if (grammar->debug_level > 3)
+			{
+			  fprintf (stderr,
+				   "  Found prev. translation: set place = %d, sit = ",
+				   pl_ind);
+			  sit_print (stderr, sit, grammar->debug_level > 5);
+			  fprintf (stderr, ", %d\n", sit_orig);
+			}
+#endif
+		    }
+		  place_translation (anode == NULL
+				     ? parent_anode->val.anode.children
+				     + parent_disp
+				     : anode->val.anode.children + disp,
+				     node);
+		}		/* if (sit_rule->anode != NULL) */
+	      else if (sit->pos != 0)
+		{
+		  /* We should generate and use the translation of the
+		     nonterminal.  Add state to get a translation. */
+		  state = parse_state_alloc ();
+		  VLO_EXPAND (parse_stack, sizeof (struct parse_state *));
+		  (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (parse_stack)))[-1] = state;
+		  state->rule = sit_rule;
+		  state->pos = sit->pos;
+		  state->orig = sit_orig;
+		  state->pl_ind = pl_ind;
+		  state->parent_anode_state = (anode == NULL
+					       ? curr_state->
+					       parent_anode_state :
+					       curr_state);
+		  state->parent_disp = anode == NULL ? parent_disp : disp;
+		  state->anode = NULL;
+#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
+          if (grammar->debug_level > 3)
+            {
+              size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (parse_stack) / sizeof (struct parse_state *));
+              long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
+              fprintf (stderr,
+                   "  Adding top %ld, set place = %d, sit = ",
+                   _top_index, pl_ind);
+              sit_print (stderr, sit, grammar->debug_level > 5);
+              fprintf (stderr, ", %d\n", sit_orig);
+            }
+#endif
+		}
+	      else
+		{
+		  /* Empty rule should produce something not abtract
+		     node.  So place empty node. */
+		  place_translation (anode == NULL
+				     ? parent_anode->val.anode.children
+				     + parent_disp
+				     : anode->val.anode.children + disp,
+				     empty_node);
+		  empty_node->val.nil.used = 1;
+		}
+	    }			/* if (parent_anode != NULL && disp >= 0) */
+	  n_candidates++;
+	}			/* For all reduces of the nonterminal. */
+      /* We should have a parse. */
+      assert (n_candidates != 0
+	      && (!curr_one_parse_p || n_candidates == 1));
+    }				/* For all parser states. */
+  if (leo_sits_tab != NULL)
+    delete_hash_table (leo_sits_tab);
+  if (!curr_one_parse_p)
+    {
+      VLO_DELETE (orig_states);
+      if (term_node_array != NULL)
+        yaep_free (grammar->alloc, term_node_array);
+    }
+  parse_state_fin ();
+  if (grammar->cost_p && !curr_one_parse_p && *ambiguous_p)
+    /* We can not build minimal tree during building parsing list
+       because we have not the translation yet.  We can not make it
+       during parsing because the abstract nodes are created before
+       their children. */
+    result = find_minimal_translation (result);
+#ifndef NO_YAEP_DEBUG_PRINT
+  print_translation (result);
+#endif
+
+  /* Free empty and error node if they have not been used */
+  if (parse_free != NULL)
+    {
+      if (!empty_node->val.nil.used)
+	{
+	  parse_free (empty_node);
+	}
+      if (!error_node->val.error.used)
+	{
+	  parse_free (error_node);
+	}
+    }
+
+  assert (result != NULL
+	  && (!grammar->one_parse_p || n_parse_alt_nodes == 0));
+  return result;
+}
+
+/* The following structure describes an abstract node whose children
+   are visited to call the tree events callbacks. */
+struct tree_events_frame
+{
+  struct yaep_tree_node *anode;
+  /* The index of the next child to visit. */
+  int next_child;
+};
+
+/* The following function calls the tree events callbacks of the
+   current parser for tree ROOT built in the tree events mode.  The
+   tree is visited in the translation order without recursion. */
+static void
+emit_tree_events (struct yaep_tree_node *root)
+{
+  const struct yaep_tree_events *events = curr_parser->tree_events;
+  struct yaep_tree_node *node, *anode;
+  struct tree_events_frame frame, *top;
+
+  VLO_NULLIFY (tree_events_stack);
+  node = root;
+  for (;;)
+    {
+      switch (node->type)
+	{
+	case YAEP_NIL:
+	  if (events->nil != NULL)
+	    events->nil (events->data);
+	  break;
+	case YAEP_ERROR:
+	  if (events->error != NULL)
+	    events->error (events->data);
+	  break;
+	case YAEP_TERM:
+	  if (events->term != NULL)
+	    events->term (events->data, node->val.term.code,
+			  node->val.term.attr, tree_events_tok_num (node));
+	  break;
+	case YAEP_ANODE:
+	  if (events->enter_anode != NULL)
+	    events->enter_anode (events->data, node->val.anode.name,
+				 node->val.anode.cost,
+				 tree_events_tok_num (node));
+	  frame.anode = node;
+	  frame.next_child = 0;
+	  VLO_ADD_MEMORY (tree_events_stack, &frame, sizeof (frame));
+	  break;
+	default:
+	  assert (FALSE);
+	}
+      /* Find the next node to visit leaving the abstract nodes whose
+	 children have been visited. */
+      for (;;)
+	{
+	  if (VLO_LENGTH (tree_events_stack) == 0)
+	    return;
+	  top = YAEP_STATIC_CAST(struct tree_events_frame *,
+				 VLO_BOUND (tree_events_stack)) - 1;
+	  anode = top->anode;
+	  if ((node = anode->val.anode.children[top->next_child]) != NULL)
+	    {
+	      top->next_child++;
+	      break;
+	    }
+	  if (events->leave_anode != NULL)
+	    events->leave_anode (events->data, anode->val.anode.name,
+				 anode->val.anode.cost);
+	  VLO_SHORTEN (tree_events_stack, sizeof (struct tree_events_frame));
+	}
+    }
+}
+
+/* The following function is used instead of make_parse in the tree
+   events mode.  The tree nodes of one parse are built by make_parse
+   in tree_events_os of the parser which is reused by the next parses,
+   the events callbacks are called for the tree, and the nodes are
+   freed.  The function returns a node of type YAEP_NIL allocated by
+   parse_alloc if the input was recognized and NULL otherwise.  It
+   sets up *AMBIGUOUS_P as make_parse. */
+static struct yaep_tree_node *
+make_tree_events (int *ambiguous_p)
+{
+  void *(*saved_parse_alloc) (int nmemb);
+  void (*saved_parse_free) (void *mem);
+  struct yaep_tree_node *root;
+
+  saved_parse_alloc = parse_alloc;
+  saved_parse_free = parse_free;
+  parse_alloc = tree_events_parse_alloc;
+  parse_free = NULL;
+  OS_EMPTY (tree_events_os);
+  root = make_parse (ambiguous_p);
+  parse_alloc = saved_parse_alloc;
+  parse_free = saved_parse_free;
+  if (root == NULL)
+    return NULL;
+  emit_tree_events (root);
+  OS_EMPTY (tree_events_os);
+  return make_nil_root ();
+}
+
+
+
+
+/* This page contains lazy forests.  A lazy forest is formed instead
+   of the parse tree if the forest flag of the parser is set up.  The
+   Earley's sets of the parse are kept until the next parse of the
+   parser and the forest nodes are formed from them only when the
+   caller expands them (see yaep_parser_expand_forest_node).  An
+   unexpanded node of type YAEP_LAZY represents all translations of a
+   nonterminal for a part of the input (a choice).  It is expanded in
+   place into the translation node or into a list of alternatives if
+   there are several translations.  The alternatives and the children
+   of the abstract nodes are unexpanded nodes for nonterminals.  The
+   choices are unique, so the forest is a graph in which each part is
+   formed only once. */
+
+/* The following structure describes a choice: the translations of
+   nonterminal SYMB for the input from set START to set END. */
+struct forest_choice
+{
+  struct symb *symb;
+  int start, end;
+  /* The forest node of the choice. */
+  struct yaep_tree_node *node;
+};
+
+/* The following is TRUE if the sets of the last parse are kept for
+   its forest. */
+#define forest_live_p (curr_parser->x_forest_live_p)
+
+/* The following os contains the forest nodes, choices and children
+   arrays. */
+#define forest_os (curr_parser->x_forest_os)
+
+/* The following vlo is indexed by set number and contains the
+   terminal node of the token shifted to the set (or NULL). */
+#define forest_term_nodes_vlo (curr_parser->x_forest_term_nodes_vlo)
+
+/* The following vlo contains the numbers of sets where the symbols of
+   the rules whose derivations are being formed end. */
+#define forest_ends_vlo (curr_parser->x_forest_ends_vlo)
+#define forest_end(base, i)					\
+  ((YAEP_STATIC_CAST(int *, VLO_BEGIN (forest_ends_vlo)))[(base) + (i)])
+
+/* The following vlo contains the different origins of the derivations
+   of rule symbols being formed.  */
+#define forest_origs_vlo (curr_parser->x_forest_origs_vlo)
+#define forest_orig(i)						\
+  ((YAEP_STATIC_CAST(int *, VLO_BEGIN (forest_origs_vlo)))[i])
+
+/* The following vlo is indexed by set number.  Its element is equal to
+   forest_orig_stamp if the set is already among the origins being
+   collected. */
+#define forest_orig_marks_vlo (curr_parser->x_forest_orig_marks_vlo)
+#define forest_orig_mark(i)						\
+  ((YAEP_STATIC_CAST(int *, VLO_BEGIN (forest_orig_marks_vlo)))[i])
+#define forest_orig_stamp (curr_parser->x_forest_orig_stamp)
+
+/* The following vlo contains the different rules of the derivations
+   of symbols being formed. */
+#define forest_rules_vlo (curr_parser->x_forest_rules_vlo)
+#define forest_rule(i)							\
+  ((YAEP_STATIC_CAST(struct rule **, VLO_BEGIN (forest_rules_vlo)))[i])
+
+/* The following table contains all choices of the forest. */
+#define forest_choice_tab (curr_parser->x_forest_choice_tab)
+
+/* The following are the only empty and error nodes of the forest. */
+#define forest_nil_node (curr_parser->x_forest_nil_node)
+#define forest_error_node (curr_parser->x_forest_error_node)
+
+/* Hash of forest choice. */
+static unsigned
+forest_choice_hash (hash_table_entry_t c)
+{
+  const struct forest_choice *choice
+    = YAEP_STATIC_CAST(const struct forest_choice *, c);
+
+  return ((jauquet_prime_mod32 * hash_shift
+	   + YAEP_STATIC_CAST(unsigned, choice->symb->num)) * hash_shift
+	  + YAEP_STATIC_CAST(unsigned, choice->start)) * hash_shift
+    + YAEP_STATIC_CAST(unsigned, choice->end);
+}
+
+/* Equality of forest choices. */
+static int
+forest_choice_eq (hash_table_entry_t c1, hash_table_entry_t c2)
+{
+  const struct forest_choice *choice1
+    = YAEP_STATIC_CAST(const struct forest_choice *, c1);
+  const struct forest_choice *choice2
+    = YAEP_STATIC_CAST(const struct forest_choice *, c2);
+
+  return (choice1->symb == choice2->symb
+	  && choice1->start == choice2->start
+	  && choice1->end == choice2->end);
+}
+
+/* The following function returns new forest memory of SIZE bytes. */
+static void *
+forest_alloc (size_t size)
+{
+  void *result;
+
+  OS_TOP_EXPAND (forest_os, size);
+  result = OS_TOP_BEGIN (forest_os);
+  OS_TOP_FINISH (forest_os);
+  return result;
+}
+
+/* The following function returns new forest node of TYPE. */
+static struct yaep_tree_node *
+forest_node_alloc (enum yaep_tree_node_type type)
+{
+  struct yaep_tree_node *node;
+
+  node = YAEP_STATIC_CAST(struct yaep_tree_node *,
+			  forest_alloc (sizeof (struct yaep_tree_node)));
+  node->type = type;
+  return node;
+}
+
+/* The following function returns the origin of situation with index
+   SIT_IND in the set at PLACE. */
+static int
+forest_sit_orig (int place, int sit_ind)
+{
+  struct set *set = pl[place];
+  struct set_core *set_core = set->core;
+
+  if (sit_ind < set_core->n_start_sits)
+#ifndef ABSOLUTE_DISTANCES
+    return place - set->dists[sit_ind];
+#else
+    return set->dists[sit_ind];
+#endif
+  else if (sit_ind < set_core->n_all_dists)
+#ifndef ABSOLUTE_DISTANCES
+    return place - set->dists[set_core->parent_indexes[sit_ind]];
+#else
+    return set->dists[set_core->parent_indexes[sit_ind]];
+#endif
+  return place;
+}
+
+/* The following function returns TRUE if the set at PLACE contains
+   situation with RULE, dot position POS before SYMB, and origin
+   ORIG. */
+static int
+forest_sit_p (int place, struct symb *symb, struct rule *rule, int pos,
+	      int orig)
+{
+  struct core_symb_vect *core_symb_vect;
+  struct sit *sit;
+  int i, sit_ind;
+
+  core_symb_vect = core_symb_vect_find (pl[place]->core, symb);
+  if (core_symb_vect == NULL)
+    return FALSE;
+  for (i = 0; i < core_symb_vect->transitions.len; i++)
+    {
+      sit_ind = core_symb_vect->transitions.els[i];
+      sit = pl[place]->core->sits[sit_ind];
+      if (sit->rule == rule && sit->pos == pos
+	  && forest_sit_orig (place, sit_ind) == orig)
+	return TRUE;
+    }
+  return FALSE;
+}
+
+/* The following function initializes the data used to find the
+   derivations on the sets of the last parse. */
+static void
+forest_derivs_init (void)
+{
+  VLO_NULLIFY (forest_origs_vlo);
+  VLO_NULLIFY (forest_rules_vlo);
+  VLO_NULLIFY (forest_orig_marks_vlo);
+  VLO_EXPAND (forest_orig_marks_vlo,
+	      sizeof (int) * YAEP_STATIC_CAST(size_t, pl_curr + 1));
+  memset (VLO_BEGIN (forest_orig_marks_vlo), 0,
+	  VLO_LENGTH (forest_orig_marks_vlo));
+  forest_orig_stamp = 0;
+}
+
+/* The following function returns TRUE if the first POS symbols of
+   RULE derive the empty string. */
+static int
+forest_empty_prefix_p (struct rule *rule, int pos)
+{
+  int i;
+
+  for (i = 0; i < pos; i++)
+    if (!rule->rhs[i]->empty_p)
+      return FALSE;
+  return TRUE;
+}
+
+/* The following two functions find the derivations in the same way
+   as make_parse, with one exception.  A situation whose origin is its
+   own set is not added to the set if the set already has the same
+   situation with another origin (see set_new_add_prediction), so the
+   derivations of the empty string can be absent from the sets.  They
+   are found from the grammar instead: any symbol deriving the empty
+   string derives it between any two symbols of a derivation. */
+
+/* The following function collects the different rules of the
+   derivations of nonterminal SYMB from set START to set END into
+   forest_rules_vlo and returns the offset of the first one.  The
+   caller shortens the vlo back to the offset. */
+static int
+forest_symb_rules (struct symb *symb, int start, int end)
+{
+  struct core_symb_vect *core_symb_vect;
+  struct rule *rule;
+  int i, j, sit_ind, rules_start, rules_bound;
+
+  rules_start = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_rules_vlo)
+				 / sizeof (struct rule *));
+  if (start == end)
+    {
+      for (rule = symb->u.nonterm.rules; rule != NULL; rule = rule->lhs_next)
+	if (forest_empty_prefix_p (rule, rule->rhs_len))
+	  VLO_ADD_MEMORY (forest_rules_vlo, &rule, sizeof (rule));
+      return rules_start;
+    }
+  core_symb_vect = core_symb_vect_find (pl[end]->core, symb);
+  assert (core_symb_vect != NULL);
+  for (i = 0; i < core_symb_vect->reduces.len; i++)
+    {
+      sit_ind = core_symb_vect->reduces.els[i];
+      if (forest_sit_orig (end, sit_ind) != start)
+	continue;
+      /* The situations of the same rule can differ only in the
+	 lookahead context. */
+      rule = pl[end]->core->sits[sit_ind]->rule;
+      rules_bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_rules_vlo)
+				     / sizeof (struct rule *));
+      for (j = rules_start; j < rules_bound && forest_rule (j) != rule; j++)
+	;
+      if (j >= rules_bound)
+	VLO_ADD_MEMORY (forest_rules_vlo, &rule, sizeof (rule));
+    }
+  return rules_start;
+}
+
+/* The following function collects the different sets where
+   nonterminal RHS[POS - 1] of RULE starts in the derivations of the
+   first POS symbols of RULE from set START to set END into
+   forest_origs_vlo and returns the offset of the first one.  The
+   caller shortens the vlo back to the offset. */
+static int
+forest_item_splits (struct rule *rule, int pos, int start, int end)
+{
+  struct core_symb_vect *core_symb_vect;
+  struct symb *symb = rule->rhs[pos - 1];
+  int i, sit_ind, sit_orig, origs_start;
+
+  assert (!symb->term_p);
+  origs_start = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_origs_vlo)
+				 / sizeof (int));
+  forest_orig_stamp++;
+  if (start < end)
+    {
+      /* Several rules for SYMB can be completed with the same
+	 origin. */
+      core_symb_vect = core_symb_vect_find (pl[end]->core, symb);
+      assert (core_symb_vect != NULL);
+      for (i = 0; i < core_symb_vect->reduces.len; i++)
+	{
+	  sit_ind = core_symb_vect->reduces.els[i];
+	  sit_orig = forest_sit_orig (end, sit_ind);
+	  if (sit_orig < start || sit_orig == end
+	      || forest_orig_mark (sit_orig) == forest_orig_stamp
+	      || (sit_orig == start ? !forest_empty_prefix_p (rule, pos - 1)
+		  : (pos == 1
+		     || !forest_sit_p (sit_orig, symb, rule, pos - 1,
+				       start))))
+	    continue;
+	  forest_orig_mark (sit_orig) = forest_orig_stamp;
+	  VLO_ADD_MEMORY (forest_origs_vlo, &sit_orig, sizeof (int));
+	}
+    }
+  if (symb->empty_p
+      && (start == end ? forest_empty_prefix_p (rule, pos - 1)
+	  : pos > 1 && forest_sit_p (end, symb, rule, pos - 1, start)))
+    VLO_ADD_MEMORY (forest_origs_vlo, &end, sizeof (int));
+  return origs_start;
+}
+
+/* The following function returns the forest node for symbol SYMB
+   derived from the input from set START to set END. */
+static struct yaep_tree_node *
+forest_symb_node (struct symb *symb, int start, int end)
+{
+  struct yaep_tree_node **term_node_ptr;
+  struct forest_choice key, *choice;
+  hash_table_entry_t *entry;
+
+  if (symb == grammar->term_error)
+    return forest_error_node;
+  if (symb->term_p)
+    {
+      assert (start + 1 == end);
+      term_node_ptr = (YAEP_STATIC_CAST(struct yaep_tree_node **,
+				       VLO_BEGIN (forest_term_nodes_vlo))
+		       + start);
+      if (*term_node_ptr == NULL)
+	{
+	  *term_node_ptr = forest_node_alloc (YAEP_TERM);
+	  (*term_node_ptr)->val.term.code = symb->u.term.code;
+	  (*term_node_ptr)->val.term.attr = tok_attr (start);
+	}
+      return *term_node_ptr;
+    }
+  key.symb = symb;
+  key.start = start;
+  key.end = end;
+  entry = find_hash_table_entry (forest_choice_tab, &key, TRUE);
+  if (*entry != NULL)
+    return YAEP_STATIC_CAST(const struct forest_choice *, *entry)->node;
+  choice = YAEP_STATIC_CAST(struct forest_choice *,
+			    forest_alloc (sizeof (struct forest_choice)));
+  *choice = key;
+  choice->node = forest_node_alloc (YAEP_LAZY);
+  choice->node->val.lazy.data = choice;
+  *entry = choice;
+  return choice->node;
+}
+
+/* The following function adds NODE to the alternatives given by
+   *FIRST and *LAST if it is not there yet.  The alternatives are a
+   list of nodes of type YAEP_ALT.  */
+static void
+forest_add_alt (struct yaep_tree_node *node, struct yaep_tree_node **first,
+		struct yaep_tree_node **last, int check_p)
+{
+  struct yaep_tree_node *alt;
+
+  if (check_p)
+    for (alt = *first; alt != NULL; alt = alt->val.alt.next)
+      if (alt->val.alt.node == node)
+	return;
+  alt = forest_node_alloc (YAEP_ALT);
+  alt->val.alt.node = node;
+  alt->val.alt.next = NULL;
+  if (*last == NULL)
+    *first = alt;
+  else
+    (*last)->val.alt.next = alt;
+  *last = alt;
+}
+
+static void forest_expand_choice (struct forest_choice *choice);
+
+/* The following function adds the translation of RULE derivation
+   whose symbols end in sets given by forest_end (BASE, ...) to the
+   alternatives given by *FIRST and *LAST. */
+static void
+forest_add_deriv (struct rule *rule, int base, struct yaep_tree_node **first,
+		  struct yaep_tree_node **last)
+{
+  struct yaep_tree_node *node, *alt;
+  int i, disp;
+
+  if (rule->anode != NULL)
+    {
+      node = forest_node_alloc (YAEP_ANODE);
+      node->val.anode.name = rule->anode;
+      node->val.anode.cost = rule->anode_cost;
+      node->val.anode.children
+	= YAEP_STATIC_CAST(struct yaep_tree_node **,
+			   forest_alloc (sizeof (struct yaep_tree_node *)
+					 * YAEP_STATIC_CAST(size_t,
+							   rule->trans_len
+							   + 1)));
+      for (i = 0; i < rule->trans_len; i++)
+	node->val.anode.children[i] = forest_nil_node;
+      node->val.anode.children[rule->trans_len] = NULL;
+      for (i = 0; i < rule->rhs_len; i++)
+	if ((disp = rule->order[i]) >= 0)
+	  node->val.anode.children[disp]
+	    = forest_symb_node (rule->rhs[i], forest_end (base, i),
+				forest_end (base, i + 1));
+      forest_add_alt (node, first, last, FALSE);
+      return;
+    }
+  for (i = 0; i < rule->rhs_len; i++)
+    if (rule->order[i] >= 0)
+      break;
+  if (i >= rule->rhs_len)
+    {
+      forest_add_alt (forest_nil_node, first, last, TRUE);
+      return;
+    }
+  node = forest_symb_node (rule->rhs[i], forest_end (base, i),
+			   forest_end (base, i + 1));
+  if (node->type == YAEP_LAZY)
+    forest_expand_choice
+      (YAEP_STATIC_CAST(struct forest_choice *, node->val.lazy.data));
+  if (node->type != YAEP_ALT)
+    forest_add_alt (node, first, last, TRUE);
+  else
+    for (alt = node; alt != NULL; alt = alt->val.alt.next)
+      forest_add_alt (alt->val.alt.node, first, last, TRUE);
+}
+
+/* The following function adds the translations of all derivations of
+   symbols of RULE before dot position POS from set ORIG to set
+   forest_end (BASE, POS) to the alternatives given by *FIRST and
+   *LAST. */
+static void
+forest_add_derivs (struct rule *rule, int pos, int orig, int base,
+		   struct yaep_tree_node **first, struct yaep_tree_node **last)
+{
+  struct symb *symb;
+  int i, end, origs_start, origs_bound;
+
+  if (pos == 0)
+    {
+      assert (forest_end (base, 0) == orig);
+      forest_add_deriv (rule, base, first, last);
+      return;
+    }
+  symb = rule->rhs[pos - 1];
+  end = forest_end (base, pos);
+  if (symb->term_p)
+    {
+      forest_end (base, pos - 1) = end - 1;
+      forest_add_derivs (rule, pos - 1, orig, base, first, last);
+      return;
+    }
+  /* The derivations of other symbols are formed meanwhile, so only
+     the offsets of the origins are used. */
+  origs_start = forest_item_splits (rule, pos, orig, end);
+  origs_bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_origs_vlo)
+				 / sizeof (int));
+  for (i = origs_start; i < origs_bound; i++)
+    {
+      /* The end of the previous symbol is the start of SYMB. */
+      forest_end (base, pos - 1) = forest_orig (i);
+      forest_add_derivs (rule, pos - 1, orig, base, first, last);
+    }
+  VLO_SHORTEN (forest_origs_vlo,
+	       sizeof (int) * YAEP_STATIC_CAST(size_t,
+					       origs_bound - origs_start));
+}
+
+/* The following function expands the node of CHOICE in place. */
+static void
+forest_expand_choice (struct forest_choice *choice)
+{
+  struct yaep_tree_node *first, *last;
+  struct rule *rule;
+  int i, base, rules_start, rules_bound;
+  size_t size;
+
+  if (choice->node->type != YAEP_LAZY)
+    return;
+  first = last = NULL;
+  rules_start = forest_symb_rules (choice->symb, choice->start, choice->end);
+  rules_bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_rules_vlo)
+				 / sizeof (struct rule *));
+  for (i = rules_start; i < rules_bound; i++)
+    {
+      rule = forest_rule (i);
+      /* The ends of the rule symbols are kept in the vlo while the
+	 derivations are formed.  The choices of other rules can be
+	 expanded meanwhile, so only the offsets are used. */
+      base = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_ends_vlo)
+			      / sizeof (int));
+      size = sizeof (int) * YAEP_STATIC_CAST(size_t, rule->rhs_len + 1);
+      VLO_EXPAND (forest_ends_vlo, size);
+      forest_end (base, rule->rhs_len) = choice->end;
+      forest_add_derivs (rule, rule->rhs_len, choice->start, base,
+			 &first, &last);
+      VLO_SHORTEN (forest_ends_vlo, size);
+    }
+  VLO_SHORTEN (forest_rules_vlo,
+	       sizeof (struct rule *)
+	       * YAEP_STATIC_CAST(size_t, rules_bound - rules_start));
+  /* Only the choices with derivations are formed. */
+  assert (first != NULL);
+  if (first->val.alt.next == NULL)
+    *choice->node = *first->val.alt.node;
+  else
+    *choice->node = *first;
+}
+
+/* The following function is used instead of make_parse if the forest
+   flag of the parser is set up.  It returns the unexpanded root of the
+   forest if the input was recognized and NULL otherwise.  The sets of
+   the parse are kept for the forest until forest_fin. */
+static struct yaep_tree_node *
+make_forest (void)
+{
+  n_parse_term_nodes = n_parse_abstract_nodes = n_parse_alt_nodes = 0;
+  if (!input_recognized_p ())
+    return NULL;
+  OS_EMPTY (forest_os);
+  VLO_NULLIFY (forest_term_nodes_vlo);
+  VLO_EXPAND (forest_term_nodes_vlo,
+	      sizeof (struct yaep_tree_node *)
+	      * YAEP_STATIC_CAST(size_t, pl_curr + 1));
+  memset (VLO_BEGIN (forest_term_nodes_vlo), 0,
+	  VLO_LENGTH (forest_term_nodes_vlo));
+  VLO_NULLIFY (forest_ends_vlo);
+  forest_derivs_init ();
+  forest_choice_tab
+    = create_hash_table (grammar->alloc,
+			 YAEP_STATIC_CAST(size_t, toks_len) * 2,
+			 forest_choice_hash, forest_choice_eq);
+  forest_nil_node = forest_node_alloc (YAEP_NIL);
+  forest_nil_node->val.nil.used = 1;
+  forest_error_node = forest_node_alloc (YAEP_ERROR);
+  forest_error_node->val.error.used = 1;
+  forest_live_p = TRUE;
+  return forest_symb_node (grammar->axiom, 0, pl_curr);
+}
+
+/* The following function frees the forest of the last parse of the
+   current parser and finishes the parse if the forest exists. */
+static void
+forest_fin (void)
+{
+  if (!forest_live_p)
+    return;
+  forest_live_p = FALSE;
+  delete_hash_table (forest_choice_tab);
+  OS_EMPTY (forest_os);
+  yaep_parse_fin ();
+  pl_fin ();
+}
+
+
+
+/* This page contains shared packed parse forests (SPPF).  The SPPF
+   is built instead of the parse tree if the SPPF flag of the parser
+   is set up.  It is formed from the Earley's sets as in Scott's
+   construction (E. Scott, SPPF-style parsing from Earley recognisers,
+   2008).  A symbol node (symbol, start, end) represents all
+   derivations of the symbol from the input from set START to set END,
+   an intermediate node (rule, pos, start, end) all derivations of the
+   first POS (two or more) symbols of the rule, and a packed node
+   (rule, pos, split) one way to derive them: its left child is the
+   node for the first POS - 1 symbols ending in set SPLIT and its
+   right child is the symbol node of the last one starting there.  As
+   the rules are binarized in this way, a symbol or intermediate node
+   has O(n) packed nodes and the SPPF size is O(n^3) for input of n
+   tokens.  All nodes are unique, so they are kept in a hash table
+   while the SPPF is built.  The grammar has no cycles (see
+   YAEP_LOOP_NONTERM), so the SPPF is an acyclic graph. */
+
+/* The following structure describes an SPPF node with the data used
+   to build the SPPF. */
+struct sppf_node
+{
+  /* The node in the interface. */
+  struct yaep_sppf_node node;
+  /* The symbol of a symbol node or the rule of other nodes. */
+  struct symb *symb;
+  struct rule *rule;
+};
+
+/* The following os contains the nodes of the SPPF. */
+#define sppf_os (curr_parser->x_sppf_os)
+
+/* The following vlo contains the nodes of the SPPF in the order of
+   their numbers after the SPPF is built. */
+#define sppf_nodes_vlo (curr_parser->x_sppf_nodes_vlo)
+
+/* The following vlo is the stack of the nodes whose packed nodes
+   should be formed while the SPPF is built and the stack of the
+   visits (see struct sppf_visit) while the nodes are numbered. */
+#define sppf_stack_vlo (curr_parser->x_sppf_stack_vlo)
+
+/* The following table contains all nodes of the SPPF being built. */
+#define sppf_node_tab (curr_parser->x_sppf_node_tab)
+
+/* The following is the root of the SPPF of the last parse (or
+   NULL). */
+#define sppf_root_node (curr_parser->x_sppf_root_node)
+
+/* Hash of SPPF node. */
+static unsigned
+sppf_node_hash (hash_table_entry_t n)
+{
+  const struct sppf_node *sppf_node
+    = YAEP_STATIC_CAST(const struct sppf_node *, n);
+  const struct yaep_sppf_node *node = &sppf_node->node;
+  unsigned result;
+
+  result = (node->type == YAEP_SPPF_SYMBOL
+	    ? YAEP_STATIC_CAST(unsigned, sppf_node->symb->num)
+	    : YAEP_STATIC_CAST(unsigned, sppf_node->rule->num));
+  result = ((jauquet_prime_mod32 * hash_shift + result) * hash_shift
+	    + YAEP_STATIC_CAST(unsigned, node->type));
+  result = (result * hash_shift + YAEP_STATIC_CAST(unsigned, node->pos));
+  result = (result * hash_shift + YAEP_STATIC_CAST(unsigned, node->start));
+  result = (result * hash_shift + YAEP_STATIC_CAST(unsigned, node->end));
+  return result * hash_shift + YAEP_STATIC_CAST(unsigned, node->split);
+}
+
+/* Equality of SPPF nodes. */
+static int
+sppf_node_eq (hash_table_entry_t n1, hash_table_entry_t n2)
+{
+  const struct sppf_node *node1 = YAEP_STATIC_CAST(const struct sppf_node *,
+						   n1);
+  const struct sppf_node *node2 = YAEP_STATIC_CAST(const struct sppf_node *,
+						   n2);
+
+  return (node1->node.type == node2->node.type
+	  && node1->symb == node2->symb && node1->rule == node2->rule
+	  && node1->node.pos == node2->node.pos
+	  && node1->node.start == node2->node.start
+	  && node1->node.end == node2->node.end
+	  && node1->node.split == node2->node.split);
+}
+
+/* The following function returns the SPPF node of TYPE for SYMB (a
+   symbol node) or RULE with POS symbols (other nodes) from set START
+   to set END with SPLIT (a packed node).  If the node is new, *NEW_P
+   is set up and a new symbol node of a nonterminal or an intermediate
+   node is pushed to the stack to form its packed nodes. */
+static struct sppf_node *
+sppf_node_get (enum yaep_sppf_node_type type, struct symb *symb,
+	       struct rule *rule, int pos, int start, int end, int split,
+	       int *new_p)
+{
+  struct sppf_node key, *node;
+  hash_table_entry_t *entry;
+
+  key.node.type = type;
+  key.symb = symb;
+  key.rule = rule;
+  key.node.pos = pos;
+  key.node.start = start;
+  key.node.end = end;
+  key.node.split = split;
+  entry = find_hash_table_entry (sppf_node_tab, &key, TRUE);
+  *new_p = *entry == NULL;
+  if (!*new_p)
+    return YAEP_STATIC_CAST(struct sppf_node *, *entry);
+  OS_TOP_EXPAND (sppf_os, sizeof (struct sppf_node));
+  node = YAEP_STATIC_CAST(struct sppf_node *, OS_TOP_BEGIN (sppf_os));
+  OS_TOP_FINISH (sppf_os);
+  *node = key;
+  node->node.num = -1;
+  if (type == YAEP_SPPF_SYMBOL)
+    {
+      node->node.name = symb->repr;
+      node->node.code = (symb->term_p && symb->u.term.code >= 0
+			 ? symb->u.term.code : -1);
+      node->node.attr = symb->term_p ? tok_attr (start) : NULL;
+      node->node.rule = -1;
+      node->node.anode = NULL;
+    }
+  else
+    {
+      node->node.name = rule->lhs->repr;
+      node->node.code = -1;
+      node->node.attr = NULL;
+      node->node.rule = rule->num;
+      node->node.anode = type == YAEP_SPPF_PACKED ? rule->anode : NULL;
+    }
+  node->node.packed = node->node.next = NULL;
+  node->node.left = node->node.right = NULL;
+  *entry = node;
+  if (type == YAEP_SPPF_INTERMEDIATE
+      || (type == YAEP_SPPF_SYMBOL && !symb->term_p))
+    VLO_ADD_MEMORY (sppf_stack_vlo, &node, sizeof (node));
+  return node;
+}
+
+/* The following function returns the SPPF symbol node for SYMB
+   derived from the input from set START to set END. */
+static struct yaep_sppf_node *
+sppf_symb_node (struct symb *symb, int start, int end)
+{
+  int new_p;
+
+  return &sppf_node_get (YAEP_SPPF_SYMBOL, symb, NULL, -1, start, end, -1,
+			 &new_p)->node;
+}
+
+/* The following function adds the packed node for the first POS
+   symbols of RULE with SPLIT to PARENT if it is not there yet. */
+static void
+sppf_add_packed (struct sppf_node *parent, struct rule *rule, int pos,
+		 int split)
+{
+  struct sppf_node *packed;
+  int start = parent->node.start, end = parent->node.end, new_p;
+
+  packed = sppf_node_get (YAEP_SPPF_PACKED, NULL, rule, pos, start, end,
+			  split, &new_p);
+  if (!new_p)
+    return;
+  if (pos > 0)
+    {
+      packed->node.right = sppf_symb_node (rule->rhs[pos - 1], split, end);
+      if (pos == 2)
+	packed->node.left = sppf_symb_node (rule->rhs[0], start, split);
+      else if (pos > 2)
+	packed->node.left
+	  = &sppf_node_get (YAEP_SPPF_INTERMEDIATE, NULL, rule, pos - 1,
+			    start, split, -1, &new_p)->node;
+    }
+  packed->node.next = parent->node.packed;
+  parent->node.packed = &packed->node;
+}
+
+/* The following function adds the packed nodes for all derivations of
+   the first POS symbols of RULE represented by PARENT. */
+static void
+sppf_add_derivs (struct sppf_node *parent, struct rule *rule, int pos)
+{
+  struct symb *symb;
+  int i, start = parent->node.start, end = parent->node.end;
+  int origs_start, origs_bound;
+
+  if (pos == 0)
+    {
+      assert (start == end);
+      sppf_add_packed (parent, rule, 0, start);
+      return;
+    }
+  symb = rule->rhs[pos - 1];
+  if (symb->term_p)
+    {
+      sppf_add_packed (parent, rule, pos, end - 1);
+      return;
+    }
+  origs_start = forest_item_splits (rule, pos, start, end);
+  origs_bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_origs_vlo)
+				 / sizeof (int));
+  for (i = origs_start; i < origs_bound; i++)
+    sppf_add_packed (parent, rule, pos, forest_orig (i));
+  VLO_SHORTEN (forest_origs_vlo,
+	       sizeof (int) * YAEP_STATIC_CAST(size_t,
+					       origs_bound - origs_start));
+}
+
+/* The following function adds the packed nodes of symbol or
+   intermediate NODE.  It returns TRUE if there are several ones. */
+static int
+sppf_expand (struct sppf_node *node)
+{
+  struct rule *rule;
+  int i, rules_start, rules_bound;
+
+  if (node->node.type == YAEP_SPPF_INTERMEDIATE)
+    sppf_add_derivs (node, node->rule, node->node.pos);
+  else
+    {
+      rules_start = forest_symb_rules (node->symb, node->node.start,
+				       node->node.end);
+      rules_bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_rules_vlo)
+				     / sizeof (struct rule *));
+      for (i = rules_start; i < rules_bound; i++)
+	{
+	  rule = forest_rule (i);
+	  sppf_add_derivs (node, rule, rule->rhs_len);
+	}
+      VLO_SHORTEN (forest_rules_vlo,
+		   sizeof (struct rule *)
+		   * YAEP_STATIC_CAST(size_t, rules_bound - rules_start));
+    }
+  /* Only the nodes with derivations are formed. */
+  assert (node->node.packed != NULL);
+  return node->node.packed->next != NULL;
+}
+
+/* The following structure describes a node being visited while the
+   SPPF nodes are numbered. */
+struct sppf_visit
+{
+  struct yaep_sppf_node *node;
+  /* The next packed node to visit of a symbol or intermediate node or
+     the number of the next child to visit of a packed node. */
+  struct yaep_sppf_node *packed;
+  int child;
+};
+
+/* The following function numbers the SPPF nodes in the depth first
+   order (children before their parents) and puts them into
+   sppf_nodes_vlo. */
+static void
+sppf_number_nodes (void)
+{
+  struct sppf_visit visit, *top;
+  struct yaep_sppf_node *child;
+  int n = 0;
+
+  VLO_NULLIFY (sppf_stack_vlo);
+  visit.node = sppf_root_node;
+  visit.packed = sppf_root_node->packed;
+  visit.child = 0;
+  sppf_root_node->num = -2;
+  VLO_ADD_MEMORY (sppf_stack_vlo, &visit, sizeof (visit));
+  while (VLO_LENGTH (sppf_stack_vlo) != 0)
+    {
+      top = YAEP_STATIC_CAST(struct sppf_visit *,
+			     VLO_BOUND (sppf_stack_vlo)) - 1;
+      child = NULL;
+      if (top->node->type != YAEP_SPPF_PACKED)
+	{
+	  if ((child = top->packed) != NULL)
+	    top->packed = child->next;
+	}
+      else
+	while (child == NULL && top->child < 2)
+	  child = top->child++ == 0 ? top->node->left : top->node->right;
+      if (child == NULL)
+	{
+	  top->node->num = n++;
+	  VLO_ADD_MEMORY (sppf_nodes_vlo, &top->node, sizeof (top->node));
+	  VLO_SHORTEN (sppf_stack_vlo, sizeof (struct sppf_visit));
+	}
+      else if (child->num == -1)
+	{
+	  /* The SPPF has no cycles. */
+	  child->num = -2;
+	  visit.node = child;
+	  visit.packed = child->packed;
+	  visit.child = 0;
+	  VLO_ADD_MEMORY (sppf_stack_vlo, &visit, sizeof (visit));
+	}
+      else
+	assert (child->num >= 0);
+    }
+}
+
+/* The following function is used instead of make_parse if the SPPF
+   flag of the parser is set up.  It builds the SPPF of the parse and
+   returns a node of type YAEP_NIL allocated by parse_alloc if the
+   input was recognized and NULL otherwise.  It sets up *AMBIGUOUS_P
+   if the input has several parses. */
+static struct yaep_tree_node *
+make_sppf (int *ambiguous_p)
+{
+  struct sppf_node *node;
+
+  n_parse_term_nodes = n_parse_abstract_nodes = n_parse_alt_nodes = 0;
+  if (!input_recognized_p ())
+    return NULL;
+  sppf_node_tab
+    = create_hash_table (grammar->alloc,
+			 YAEP_STATIC_CAST(size_t, toks_len) * 4,
+			 sppf_node_hash, sppf_node_eq);
+  VLO_NULLIFY (sppf_stack_vlo);
+  forest_derivs_init ();
+  sppf_root_node = sppf_symb_node (grammar->axiom, 0, pl_curr);
+  while (VLO_LENGTH (sppf_stack_vlo) != 0)
+    {
+      node = (YAEP_STATIC_CAST(struct sppf_node **,
+			       VLO_BOUND (sppf_stack_vlo)))[-1];
+      VLO_SHORTEN (sppf_stack_vlo, sizeof (node));
+      if (sppf_expand (node))
+	*ambiguous_p = TRUE;
+    }
+  delete_hash_table (sppf_node_tab);
+  sppf_number_nodes ();
+  return make_nil_root ();
+}
+
+/* The following function frees the SPPF of the last parse of the
+   current parser. */
+static void
+sppf_fin (void)
+{
+  if (sppf_root_node == NULL)
+    return;
+  sppf_root_node = NULL;
+  OS_EMPTY (sppf_os);
+  VLO_NULLIFY (sppf_nodes_vlo);
+}
+
+
+
+/* This page contains minimal cost parses.  If the cost flag of the
+   grammar is set up and only one parse is asked, the parse of the
+   minimal cost is found on the Earley's sets by dynamic programming
+   (as in Viterbi algorithm) instead of building all parses and
+   pruning them (see find_minimal_translation).  A symbol node
+   (symbol, start, end) contains the minimal cost of the translations
+   of the symbol derived from the input from set START to set END, and
+   an item node (rule, pos, start, end) contains the minimal cost of
+   the translations of the first POS symbols of the rule.  The costs
+   of the nodes are computed after the costs of their children, and
+   only the tree of the minimal cost is formed by parse_alloc then.
+   So the memory used besides the Earley's sets is proportional to the
+   number of the nodes instead of the size of all parses.  The
+   derivations are found in the same way as for the lazy forest (see
+   forest_symb_rules). */
+
+/* The following is the state of a node while the costs are
+   computed. */
+enum min_cost_node_state
+{
+  /* The derivations of the node are not processed yet. */
+  MIN_COST_NEW,
+  /* The children whose costs are unknown are pushed onto the
+     stack. */
+  MIN_COST_EXPANDED,
+  /* The minimal cost of the node is known. */
+  MIN_COST_DONE
+};
+
+/* The following structure describes a node of the minimal cost
+   parse. */
+struct min_cost_node
+{
+  /* The symbol of a symbol node or NULL for an item node. */
+  struct symb *symb;
+  /* The rule and the number of its symbols of an item node (NULL and
+     -1 for a symbol node). */
+  struct rule *rule;
+  int pos;
+  int start, end;
+  enum min_cost_node_state state;
+  int cost;
+  /* The rule of the minimal cost translation of a symbol node. */
+  struct rule *min_rule;
+  /* The set where the last symbol of the minimal cost translation of
+     an item node starts. */
+  int split;
+};
+
+/* The following structure describes the translation of RULE for the
+   input from set START to set END which should be formed: the
+   children of its abstract node ANODE or the translation in PLACE if
+   the rule has no abstract node. */
+struct min_cost_task
+{
+  struct rule *rule;
+  int start, end;
+  struct yaep_tree_node *anode, **place;
+};
+
+/* The following os contains the nodes of the minimal cost parse. */
+#define min_cost_os (curr_parser->x_min_cost_os)
+
+/* The following vlo is the stack of the nodes whose costs are being
+   computed and then the stack of the translations which should be
+   formed (see struct min_cost_task). */
+#define min_cost_stack_vlo (curr_parser->x_min_cost_stack_vlo)
+
+/* The following table contains all nodes of the minimal cost
+   parse. */
+#define min_cost_node_tab (curr_parser->x_min_cost_node_tab)
+
+/* Hash of minimal cost parse node. */
+static unsigned
+min_cost_node_hash (hash_table_entry_t n)
+{
+  const struct min_cost_node *node
+    = YAEP_STATIC_CAST(const struct min_cost_node *, n);
+  unsigned result;
+
+  result = (node->symb != NULL
+	    ? YAEP_STATIC_CAST(unsigned, node->symb->num)
+	    : YAEP_STATIC_CAST(unsigned, node->rule->num));
+  result = ((jauquet_prime_mod32 * hash_shift + result) * hash_shift
+	    + YAEP_STATIC_CAST(unsigned, node->pos));
+  result = (result * hash_shift + YAEP_STATIC_CAST(unsigned, node->start));
+  return result * hash_shift + YAEP_STATIC_CAST(unsigned, node->end);
+}
+
+/* Equality of minimal cost parse nodes. */
+static int
+min_cost_node_eq (hash_table_entry_t n1, hash_table_entry_t n2)
+{
+  const struct min_cost_node *node1
+    = YAEP_STATIC_CAST(const struct min_cost_node *, n1);
+  const struct min_cost_node *node2
+    = YAEP_STATIC_CAST(const struct min_cost_node *, n2);
+
+  return (node1->symb == node2->symb && node1->rule == node2->rule
+	  && node1->pos == node2->pos && node1->start == node2->start
+	  && node1->end == node2->end);
+}
+
+/* The following function returns the node for SYMB (a symbol node)
+   or for the first POS symbols of RULE (an item node) from set START
+   to set END. */
+static struct min_cost_node *
+min_cost_node_get (struct symb *symb, struct rule *rule, int pos,
+		   int start, int end)
+{
+  struct min_cost_node key, *node;
+  hash_table_entry_t *entry;
+
+  key.symb = symb;
+  key.rule = rule;
+  key.pos = pos;
+  key.start = start;
+  key.end = end;
+  entry = find_hash_table_entry (min_cost_node_tab, &key, TRUE);
+  if (*entry != NULL)
+    return YAEP_STATIC_CAST(struct min_cost_node *, *entry);
+  OS_TOP_EXPAND (min_cost_os, sizeof (struct min_cost_node));
+  node = YAEP_STATIC_CAST(struct min_cost_node *, OS_TOP_BEGIN (min_cost_os));
+  OS_TOP_FINISH (min_cost_os);
+  *node = key;
+  node->state = MIN_COST_NEW;
+  node->cost = 0;
+  node->min_rule = NULL;
+  node->split = -1;
+  *entry = node;
+  return node;
+}
+
+/* The following function adds the minimal cost of the node for SYMB
+   or for the first POS symbols of RULE from set START to set END to
+   *COST if COMPUTE_P.  It returns FALSE if the node has no derivation
+   then.  Otherwise, it pushes the node onto the stack if its cost is
+   not known yet and returns TRUE. */
+static int
+min_cost_child (struct symb *symb, struct rule *rule, int pos, int start,
+		int end, int compute_p, int *cost)
+{
+  struct min_cost_node *node;
+
+  node = min_cost_node_get (symb, rule, pos, start, end);
+  if (compute_p)
+    {
+      assert (node->state == MIN_COST_DONE);
+      if (symb != NULL ? node->min_rule == NULL : node->split < 0)
+	return FALSE;
+      *cost += node->cost;
+      return TRUE;
+    }
+  /* The grammar has no cycles (see YAEP_LOOP_NONTERM), so the node
+     can not be expanded here. */
+  assert (node->state != MIN_COST_EXPANDED);
+  if (node->state == MIN_COST_NEW)
+    VLO_ADD_MEMORY (min_cost_stack_vlo, &node, sizeof (node));
+  return TRUE;
+}
+
+/* The following function processes the derivations of NODE.  If
+   COMPUTE_P, it sets up the minimal cost of NODE from the costs of
+   its children (the costs of the symbols without translation are
+   ignored).  The derivations with a child without derivations are
+   skipped then, so NODE has no derivation (its min_rule is NULL or
+   its split is negative) if all its derivations are skipped.
+   Otherwise, it pushes the children whose costs are not known yet
+   onto the stack.  The function returns the number of the
+   derivations. */
+static int
+min_cost_derivs (struct min_cost_node *node, int compute_p)
+{
+  struct symb *symb;
+  struct rule *rule = node->rule;
+  int i, split, cost, n = 0, first, bound;
+  int pos = node->pos, start = node->start, end = node->end;
+
+  if (node->symb != NULL)
+    {
+      first = forest_symb_rules (node->symb, start, end);
+      bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_rules_vlo)
+			       / sizeof (struct rule *));
+      for (i = first; i < bound; i++)
+	{
+	  rule = forest_rule (i);
+	  cost = rule->anode_cost;
+	  if (rule->rhs_len != 0
+	      && !min_cost_child (NULL, rule, rule->rhs_len, start, end,
+				  compute_p, &cost))
+	    continue;
+	  if (compute_p && (n == 0 || cost < node->cost))
+	    {
+	      node->cost = cost;
+	      node->min_rule = rule;
+	    }
+	  n++;
+	}
+      VLO_SHORTEN (forest_rules_vlo,
+		   sizeof (struct rule *)
+		   * YAEP_STATIC_CAST(size_t, bound - first));
+      return n;
+    }
+  assert (pos > 0);
+  symb = rule->rhs[pos - 1];
+  if (symb->term_p)
+    {
+      assert (pos > 1 || start == end - 1);
+      cost = 0;
+      if (pos > 1
+	  && !min_cost_child (NULL, rule, pos - 1, start, end - 1,
+			      compute_p, &cost))
+	return 0;
+      if (compute_p)
+	{
+	  node->cost = cost;
+	  node->split = end - 1;
+	}
+      return 1;
+    }
+  first = forest_item_splits (rule, pos, start, end);
+  bound = YAEP_STATIC_CAST(int, VLO_LENGTH (forest_origs_vlo)
+			   / sizeof (int));
+  for (i = first; i < bound; i++)
+    {
+      split = forest_orig (i);
+      cost = 0;
+      /* The symbols without translation are not processed, but all
+	 symbols of the found derivations have derivations. */
+      if ((pos > 1
+	   && !min_cost_child (NULL, rule, pos - 1, start, split,
+			       compute_p, &cost))
+	  || (rule->order[pos - 1] >= 0
+	      && !min_cost_child (symb, NULL, -1, split, end, compute_p,
+				  &cost)))
+	continue;
+      if (compute_p && (n == 0 || cost < node->cost))
+	{
+	  node->cost = cost;
+	  node->split = split;
+	}
+      n++;
+    }
+  VLO_SHORTEN (forest_origs_vlo,
+	       sizeof (int) * YAEP_STATIC_CAST(size_t, bound - first));
+  return n;
+}
+
+/* The following function returns new abstract node of RULE with COST
+   whose children are EMPTY_NODE.  */
+static struct yaep_tree_node *
+min_cost_anode (struct rule *rule, int cost, struct yaep_tree_node *empty_node)
+{
+  struct yaep_tree_node *node;
+  int i, n_children = 0;
+
+  n_parse_abstract_nodes++;
+  node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+	  (*parse_alloc) (YAEP_STATIC_CAST(int, sizeof (struct yaep_tree_node)
+					   + sizeof (struct yaep_tree_node *)
+					   * YAEP_STATIC_CAST(size_t, rule->trans_len + 1)))));
+  node->type = YAEP_ANODE;
+  if (caller_anodes[rule->num] == NULL)
+    {
+      caller_anodes[rule->num]
+	= (YAEP_STATIC_CAST(char *,
+	   (*parse_alloc) (YAEP_STATIC_CAST(int, strlen (rule->anode) + 1))));
+      strcpy (caller_anodes[rule->num], rule->anode);
+    }
+  node->val.anode.name = caller_anodes[rule->num];
+  node->val.anode.cost = cost;
+  node->val.anode.children
+    = (YAEP_REINTERPRET_CAST(struct yaep_tree_node **,
+       (YAEP_REINTERPRET_CAST(char *, node) + sizeof (struct yaep_tree_node))));
+  for (i = 0; i < rule->trans_len; i++)
+    node->val.anode.children[i] = empty_node;
+  node->val.anode.children[rule->trans_len] = NULL;
+  for (i = 0; i < rule->rhs_len; i++)
+    if (rule->order[i] >= 0)
+      n_children++;
+  if (n_children < rule->trans_len)
+    /* Some children are nil translations. */
+    empty_node->val.nil.used = 1;
+  return node;
+}
+
+/* The following function forms the minimal cost translation of the
+   input whose costs are in the nodes and returns it.  The cost of an
+   abstract node is the cost of its translation if TOTAL_COST_P and
+   the cost of the abstract node itself otherwise (as in make_parse
+   for the unambiguous input). */
+static struct yaep_tree_node *
+min_cost_translation (int total_cost_p)
+{
+  struct min_cost_task task, new_task;
+  struct min_cost_node *symb_node;
+  struct yaep_tree_node *result = NULL, *empty_node, *error_node, *node;
+  struct yaep_tree_node **place;
+  struct rule *rule;
+  struct symb *symb;
+  int i, disp, split = 0, end, placed_p;
+
+  empty_node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+		(*parse_alloc) (sizeof (struct yaep_tree_node))));
+  empty_node->type = YAEP_NIL;
+  empty_node->val.nil.used = 0;
+  error_node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+		(*parse_alloc) (sizeof (struct yaep_tree_node))));
+  error_node->type = YAEP_ERROR;
+  error_node->val.error.used = 0;
+  task.rule = pl[pl_curr]->core->sits[0]->rule;
+  task.start = 0;
+  task.end = pl_curr;
+  task.anode = NULL;
+  task.place = &result;
+  VLO_NULLIFY (min_cost_stack_vlo);
+  VLO_ADD_MEMORY (min_cost_stack_vlo, &task, sizeof (task));
+  while (VLO_LENGTH (min_cost_stack_vlo) != 0)
+    {
+      task = (YAEP_STATIC_CAST(struct min_cost_task *,
+			       VLO_BOUND (min_cost_stack_vlo)))[-1];
+      VLO_SHORTEN (min_cost_stack_vlo, sizeof (struct min_cost_task));
+      rule = task.rule;
+      placed_p = FALSE;
+      for (end = task.end, i = rule->rhs_len - 1; i >= 0; end = split, i--)
+	{
+	  symb = rule->rhs[i];
+	  if (i == 0)
+	    split = task.start;
+	  else if (symb->term_p)
+	    split = end - 1;
+	  else
+	    split = min_cost_node_get (NULL, rule, i + 1, task.start,
+				       end)->split;
+	  if ((disp = rule->order[i]) < 0)
+	    continue;
+	  placed_p = TRUE;
+	  place = (task.anode != NULL
+		   ? task.anode->val.anode.children + disp : task.place);
+	  if (symb == grammar->term_error)
+	    {
+	      node = error_node;
+	      error_node->val.error.used = 1;
+	    }
+	  else if (symb->term_p)
+	    {
+	      n_parse_term_nodes++;
+	      node = (YAEP_STATIC_CAST(struct yaep_tree_node *,
+		      (*parse_alloc) (sizeof (struct yaep_tree_node))));
+	      node->type = YAEP_TERM;
+	      node->val.term.code = symb->u.term.code;
+	      node->val.term.attr = tok_attr (split);
+	    }
+	  else
+	    {
+	      symb_node = min_cost_node_get (symb, NULL, -1, split, end);
+	      assert (symb_node->state == MIN_COST_DONE
+		      && symb_node->min_rule != NULL);
+	      new_task.rule = symb_node->min_rule;
+	      new_task.start = split;
+	      new_task.end = end;
+	      new_task.anode = NULL;
+	      new_task.place = place;
+	      if (new_task.rule->anode != NULL)
+		new_task.anode
+		  = min_cost_anode (new_task.rule,
+				    (total_cost_p ? symb_node->cost
+				     : new_task.rule->anode_cost),
+				    empty_node);
+	      VLO_ADD_MEMORY (min_cost_stack_vlo, &new_task,
+			      sizeof (new_task));
+	      if ((node = new_task.anode) == NULL)
+		/* The translation is placed by the new task. */
+		continue;
+	    }
+	  *place = node;
+	}
+      assert (end == task.start);
+      if (task.anode == NULL && !placed_p)
+	{
+	  /* The rule produces nothing.  */
+	  *task.place = empty_node;
+	  empty_node->val.nil.used = 1;
+	}
+    }
+  /* Free empty and error node if they have not been used */
+  if (parse_free != NULL)
+    {
+      if (!empty_node->val.nil.used)
+	parse_free (empty_node);
+      if (!error_node->val.error.used)
+	parse_free (error_node);
+    }
+  assert (result != NULL);
+  return result;
+}
+
+/* The following function is used instead of make_parse if the cost
+   flag of the grammar is set up and only one parse is asked.  It
+   returns the minimal cost parse tree and sets up *AMBIGUOUS_P if the
+   input has several parses. */
+static struct yaep_tree_node *
+make_min_cost_parse (int *ambiguous_p)
+{
+  struct min_cost_node *node;
+  struct rule *rule;
+  struct yaep_tree_node *result;
+
+  n_parse_term_nodes = n_parse_abstract_nodes = n_parse_alt_nodes = 0;
+  if (!input_recognized_p ())
+    return NULL;
+  min_cost_node_tab
+    = create_hash_table (grammar->alloc,
+			 YAEP_STATIC_CAST(size_t, toks_len) * 4,
+			 min_cost_node_hash, min_cost_node_eq);
+  VLO_NULLIFY (min_cost_stack_vlo);
+  forest_derivs_init ();
+  /* We have only one start situation: "$S : <start symb> $eof .".  */
+  rule = pl[pl_curr]->core->sits[0]->rule;
+  node = min_cost_node_get (NULL, rule, rule->rhs_len, 0, pl_curr);
+  VLO_ADD_MEMORY (min_cost_stack_vlo, &node, sizeof (node));
+  while (VLO_LENGTH (min_cost_stack_vlo) != 0)
+    {
+      node = (YAEP_STATIC_CAST(struct min_cost_node **,
+			       VLO_BOUND (min_cost_stack_vlo)))[-1];
+      if (node->state == MIN_COST_NEW)
+	{
+	  /* The node stays on the stack until the costs of its
+	     children are known. */
+	  node->state = MIN_COST_EXPANDED;
+	  min_cost_derivs (node, FALSE);
+	  continue;
+	}
+      VLO_SHORTEN (min_cost_stack_vlo, sizeof (node));
+      if (node->state == MIN_COST_EXPANDED)
+	{
+	  if (min_cost_derivs (node, TRUE) > 1)
+	    *ambiguous_p = TRUE;
+	  node->state = MIN_COST_DONE;
+	}
+    }
+  result = min_cost_translation (*ambiguous_p);
+  delete_hash_table (min_cost_node_tab);
+  OS_EMPTY (min_cost_os);
+#ifndef NO_YAEP_DEBUG_PRINT
+  print_translation (result);
+#endif
+  return result;
+}
+
+
+
+/* This page contains the parse workspace. */
+
+/* The following function creates the parse workspace of the current
+   parser if it does not exist yet.  The workspace containers are
+   emptied by the initialization functions of the corresponding
+   abstract data at each parse start, so parses of similar inputs do
+   not allocate memory for them after the first parse. */
+static void
+workspace_init (void)
+{
+  if (curr_parser->workspace_p)
+    return;
+  tok_create ();
+  pl_init ();
+  sit_dist_set_init ();
+  prediction_check_init ();
+  error_recovery_create ();
+  VLO_CREATE (parse_stack, grammar->alloc, 10000);
+  OS_CREATE (parse_state_os, grammar->alloc, 0);
+  OS_CREATE (tree_events_os, grammar->alloc, 0);
+  VLO_CREATE (tree_events_stack, grammar->alloc, 0);
+  OS_CREATE (forest_os, grammar->alloc, 0);
+  VLO_CREATE (forest_term_nodes_vlo, grammar->alloc, 0);
+  VLO_CREATE (forest_ends_vlo, grammar->alloc, 0);
+  VLO_CREATE (forest_origs_vlo, grammar->alloc, 0);
+  VLO_CREATE (forest_orig_marks_vlo, grammar->alloc, 0);
+  VLO_CREATE (forest_rules_vlo, grammar->alloc, 0);
+  OS_CREATE (sppf_os, grammar->alloc, 0);
+  VLO_CREATE (sppf_nodes_vlo, grammar->alloc, 0);
+  VLO_CREATE (sppf_stack_vlo, grammar->alloc, 0);
+  OS_CREATE (min_cost_os, grammar->alloc, 0);
+  VLO_CREATE (min_cost_stack_vlo, grammar->alloc, 0);
+  curr_parser->workspace_p = TRUE;
+}
+
+/* The following function frees the parse workspace of the current
+   parser. */
+static void
+workspace_fin (void)
+{
+  if (!curr_parser->workspace_p)
+    return;
+  VLO_DELETE (min_cost_stack_vlo);
+  OS_DELETE (min_cost_os);
+  VLO_DELETE (sppf_stack_vlo);
+  VLO_DELETE (sppf_nodes_vlo);
+  OS_DELETE (sppf_os);
+  VLO_DELETE (forest_rules_vlo);
+  VLO_DELETE (forest_orig_marks_vlo);
+  VLO_DELETE (forest_origs_vlo);
+  VLO_DELETE (forest_ends_vlo);
+  VLO_DELETE (forest_term_nodes_vlo);
+  OS_DELETE (forest_os);
+  VLO_DELETE (tree_events_stack);
+  OS_DELETE (tree_events_os);
+  OS_DELETE (parse_state_os);
+  VLO_DELETE (parse_stack);
+  error_recovery_fin ();
+  prediction_check_fin ();
+  sit_dist_set_fin ();
+  if (pl != NULL)
+    yaep_free (grammar->alloc, pl);
+  pl_init ();
+  tok_fin ();
+  curr_parser->workspace_p = FALSE;
+}
+
+
+
+
+static void *
+parse_alloc_default (int nmemb)
+{
+  void *result;
+
+  assert (nmemb > 0);
+
+  result = malloc (YAEP_STATIC_CAST(size_t, nmemb));
+  if (result == NULL)
+    {
+      exit (1);
+    }
+
+  return result;
+}
+
+static void
+parse_free_default (void *mem)
+{
+  free (mem);
+}
+
+
+
+/* This page contains tree arenas.  The arena memory consists of
+   slabs which are allocated by malloc.  Blocks are allocated from the
+   first slab and new slab twice bigger than the previous one is added
+   when there is no space in the first slab.  */
+
+/* Size of the first slab of the arena. */
+#define TREE_ARENA_SLAB_SIZE (64 * 1024)
+
+/* All arena blocks are aligned as the following union. */
+union tree_arena_align
+{
+  void *ptr;
+  long l;
+  double d;
+};
+
+#define TREE_ARENA_ALIGN(size)						\
+  (((size) + sizeof (union tree_arena_align) - 1)			\
+   / sizeof (union tree_arena_align) * sizeof (union tree_arena_align))
+
+/* The following is a slab header.  The slab memory follows it. */
+struct tree_arena_slab
+{
+  struct tree_arena_slab *next;
+  size_t size;
+};
+
+struct yaep_tree_arena
+{
+  /* The slabs.  The current one is the first. */
+  struct tree_arena_slab *slabs;
+  /* The free memory of the current slab. */
+  char *free_start, *free_bound;
+  /* Size of the next slab and the total size of the slabs. */
+  size_t slab_size, total_size;
+};
+
+/* The following function adds slab of SIZE bytes to ARENA and makes
+   it current. */
+static void
+tree_arena_add_slab (struct yaep_tree_arena *arena, size_t size)
+{
+  struct tree_arena_slab *slab;
+
+  slab = YAEP_STATIC_CAST(struct tree_arena_slab *,
+			  malloc (TREE_ARENA_ALIGN (sizeof (struct tree_arena_slab))
+				  + size));
+  if (slab == NULL)
+    exit (1);
+  slab->next = arena->slabs;
+  slab->size = size;
+  arena->slabs = slab;
+  arena->free_start = (YAEP_REINTERPRET_CAST(char *, slab)
+		       + TREE_ARENA_ALIGN (sizeof (struct tree_arena_slab)));
+  arena->free_bound = arena->free_start + size;
+  arena->total_size += size;
+}
+
+/* The following function allocates SIZE bytes in ARENA. */
+static void *
+tree_arena_alloc (struct yaep_tree_arena *arena, size_t size)
+{
+  void *result;
+
+  size = TREE_ARENA_ALIGN (size);
+  if (YAEP_STATIC_CAST(size_t, arena->free_bound - arena->free_start) < size)
+    {
+      tree_arena_add_slab (arena, size > arena->slab_size
+				  ? size : arena->slab_size);
+      arena->slab_size *= 2;
+    }
+  result = arena->free_start;
+  arena->free_start += size;
+  return result;
+}
+
+/* The following function is used instead of parse_alloc when the
+   tree arena of the current parser is set up. */
+static void *
+tree_arena_parse_alloc (int nmemb)
+{
+  assert (nmemb > 0 && curr_parser->tree_arena != NULL);
+  return tree_arena_alloc (curr_parser->tree_arena,
+			   YAEP_STATIC_CAST(size_t, nmemb));
+}
+
+/* The following function frees the slabs of ARENA. */
+static void
+tree_arena_free_slabs (struct yaep_tree_arena *arena)
+{
+  struct tree_arena_slab *slab, *next;
+
+  for (slab = arena->slabs; slab != NULL; slab = next)
+    {
+      next = slab->next;
+      free (slab);
+    }
+  arena->slabs = NULL;
+  arena->free_start = arena->free_bound = NULL;
+  arena->total_size = 0;
+}
+
+/* The following function creates a tree arena.  It returns NULL if
+   there is no memory. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_tree_arena *
+yaep_create_tree_arena (void)
+{
+  struct yaep_tree_arena *arena;
+
+  arena = YAEP_STATIC_CAST(struct yaep_tree_arena *,
+			   malloc (sizeof (struct yaep_tree_arena)));
+  if (arena == NULL)
+    return NULL;
+  arena->slabs = NULL;
+  arena->free_start = arena->free_bound = NULL;
+  arena->slab_size = TREE_ARENA_SLAB_SIZE;
+  arena->total_size = 0;
+  return arena;
+}
+
+/* The following function frees all trees of ARENA and joins its
+   slabs into one slab. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_reset_tree_arena (struct yaep_tree_arena *arena)
+{
+  size_t size;
+
+  assert (arena != NULL);
+  if (arena->slabs == NULL)
+    return;
+  if (arena->slabs->next != NULL)
+    {
+      size = arena->total_size;
+      tree_arena_free_slabs (arena);
+      tree_arena_add_slab (arena, size);
+      arena->slab_size = size;
+    }
+  else
+    arena->free_start = (YAEP_REINTERPRET_CAST(char *, arena->slabs)
+			 + TREE_ARENA_ALIGN (sizeof (struct tree_arena_slab)));
+}
+
+/* The following function frees ARENA with all its trees. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_free_tree_arena (struct yaep_tree_arena *arena)
+{
+  if (arena == NULL)
+    return;
+  tree_arena_free_slabs (arena);
+  free (arena);
+}
+
+/* The following function sets up ARENA for trees built by yaep_parse
+   and yaep_parse_tokens for grammar G.  It returns the previous
+   arena. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_tree_arena *
+yaep_set_tree_arena (struct grammar *g, struct yaep_tree_arena *arena)
+{
+  struct yaep_tree_arena *old;
+
+  assert (g != NULL);
+  old = g->tree_arena;
+  if (!g->frozen_p)
+    g->tree_arena = arena;
+  return old;
+}
+
+/* The following function sets up ARENA for trees built by PARSER.  It
+   returns the previous arena. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_tree_arena *
+yaep_parser_set_tree_arena (struct yaep_parser *parser,
+			    struct yaep_tree_arena *arena)
+{
+  struct yaep_tree_arena *old;
+
+  assert (parser != NULL && !parser->busy_p);
+  old = parser->tree_arena;
+  parser->tree_arena = arena;
+  return old;
+}
+
+/* The following function sets up EVENTS for yaep_parse and
+   yaep_parse_tokens of grammar G.  It returns the previous events. */
+#ifdef __cplusplus
+static
+#endif
+const struct yaep_tree_events *
+yaep_set_tree_events (struct grammar *g,
+		      const struct yaep_tree_events *events)
+{
+  const struct yaep_tree_events *old;
+
+  assert (g != NULL);
+  old = g->tree_events;
+  if (!g->frozen_p)
+    g->tree_events = events;
+  return old;
+}
+
+/* The following function sets up EVENTS for parses of PARSER.  It
+   returns the previous events. */
+#ifdef __cplusplus
+static
+#endif
+const struct yaep_tree_events *
+yaep_parser_set_tree_events (struct yaep_parser *parser,
+			     const struct yaep_tree_events *events)
+{
+  const struct yaep_tree_events *old;
+
+  assert (parser != NULL && !parser->busy_p);
+  old = parser->tree_events;
+  parser->tree_events = events;
+  return old;
+}
+
+/* The following function saves the current parser environment of the
+   thread in SAVED and makes PARSER current.  So a parser can be used
+   even from callbacks of another parser working in the same
+   thread. */
+static void
+parser_enter (struct yaep_parser *parser, struct yaep_parser_env *saved)
+{
+  saved->parser = curr_parser;
+  saved->grammar = grammar;
+  saved->symbs_ptr = symbs_ptr;
+  saved->term_sets_ptr = term_sets_ptr;
+  saved->rules_ptr = rules_ptr;
+  curr_parser = parser;
+  grammar = parser->grammar;
+  symbs_ptr = grammar->symbs_ptr;
+  term_sets_ptr = parser->term_sets;
+  rules_ptr = grammar->rules_ptr;
+}
+
+/* The following function restores the parser environment saved by
+   parser_enter. */
+static void
+parser_leave (const struct yaep_parser_env *saved)
+{
+  curr_parser = saved->parser;
+  grammar = saved->grammar;
+  symbs_ptr = saved->symbs_ptr;
+  term_sets_ptr = saved->term_sets_ptr;
+  rules_ptr = saved->rules_ptr;
+}
+
+/* The following function creates parser for grammar G.  The function
+   returns NULL if there is no memory. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_parser *
+yaep_create_parser (struct grammar *g)
+{
+  struct yaep_parser *parser;
+
+  assert (g != NULL);
+  yaep_initialize_error_handling ();
+  parser = YAEP_STATIC_CAST(struct yaep_parser *,
+			    yaep_malloc (g->alloc, sizeof (struct yaep_parser)));
+  if (parser == NULL)
+    {
+      yaep_set_error (g, YAEP_NO_MEMORY, "no memory for parser");
+      return NULL;
+    }
+  memset (YAEP_STATIC_CAST(void *, parser), 0, sizeof (struct yaep_parser));
+  parser->grammar = g;
+  if (term_set_init (g, &parser->term_sets) != 0)
+    {
+      yaep_free (g->alloc, parser);
+      return NULL;
+    }
+  return parser;
+}
+
+/* The function returns the last occurred error code for given
+   parser. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_parser_error_code (struct yaep_parser *parser)
+{
+  assert (parser != NULL);
+  return parser->error_code;
+}
+
+/* The function returns message corresponding to the last occurred
+   error code for given parser. */
+#ifdef __cplusplus
+static
+#endif
+const char *
+yaep_parser_error_message (struct yaep_parser *parser)
+{
+  assert (parser != NULL);
+  return parser->error_message;
+}
+
+/* The following function frees memory allocated for PARSER. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_free_parser (struct yaep_parser *parser)
+{
+  struct yaep_parser_env saved;
+
+  if (parser == NULL)
+    return;
+  parser_enter (parser, &saved);
+  forest_fin ();
+  sppf_fin ();
+  parse_cache_fin ();
+#ifdef USE_SHARED_MEMO
+  shared_memo_release ();
+#endif
+  workspace_fin ();
+  term_set_fin (parser->term_sets);
+  yaep_free (grammar->alloc, parser);
+  parser_leave (&saved);
+}
+
+/* The following function frees the parse cache and the parse
+   workspace of PARSER. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_parser_flush_cache (struct yaep_parser *parser)
+{
+  struct yaep_parser_env saved;
+
+  assert (parser != NULL && !parser->busy_p);
+  parser_enter (parser, &saved);
+  forest_fin ();
+  sppf_fin ();
+  parse_cache_fin ();
+  workspace_fin ();
+  parser_leave (&saved);
+}
+
+/* The following function sets up FLAG of building lazy forests by
+   PARSER.  It returns the previous flag value. */
+#ifdef __cplusplus
+static
 #endif
-		    }
-		  else
-		    {
-		      /* We allready have the translation. */
-		      assert (!grammar->one_parse_p);
-		      parse_state_free (state);
-		      state = (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (stack)))[-1];
-		      node = table_state->anode;
-		      assert (node != NULL);
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
-		      if (grammar->debug_level > 3)
-			{
-			  fprintf (stderr,
-				   "  Found prev. translation: set place = %d, sit = ",
-				   pl_ind);
-			  sit_print (stderr, sit, grammar->debug_level > 5);
-			  fprintf (stderr, ", %d\n", sit_orig);
-			}
+int
+yaep_parser_set_forest_flag (struct yaep_parser *parser, int flag)
+{
+  int old;
+
+  assert (parser != NULL && !parser->busy_p);
+  old = parser->forest_p;
+  parser->forest_p = flag != 0;
+  return old;
+}
+
+/* The following function expands NODE of the forest of the last
+   parse by PARSER and returns it. */
+#ifdef __cplusplus
+static
 #endif
-		    }
-		  place_translation (anode == NULL
-				     ? parent_anode->val.anode.children
-				     + parent_disp
-				     : anode->val.anode.children + disp,
-				     node);
-		}		/* if (sit_rule->anode != NULL) */
-	      else if (sit->pos != 0)
-		{
-		  /* We should generate and use the translation of the
-		     nonterminal.  Add state to get a translation. */
-		  state = parse_state_alloc ();
-		  VLO_EXPAND (stack, sizeof (struct parse_state *));
-		  (YAEP_STATIC_CAST(struct parse_state **, VLO_BOUND (stack)))[-1] = state;
-		  state->rule = sit_rule;
-		  state->pos = sit->pos;
-		  state->orig = sit_orig;
-		  state->pl_ind = pl_ind;
-		  state->parent_anode_state = (anode == NULL
-					       ? curr_state->
-					       parent_anode_state :
-					       curr_state);
-		  state->parent_disp = anode == NULL ? parent_disp : disp;
-		  state->anode = NULL;
-#if !defined (NDEBUG) && !defined (NO_YAEP_DEBUG_PRINT)
-          if (grammar->debug_level > 3)
-            {
-              size_t _vlo_stack_n = YAEP_STATIC_CAST(size_t, VLO_LENGTH (stack) / sizeof (struct parse_state *));
-              long _top_index = _vlo_stack_n == 0 ? -1 : YAEP_STATIC_CAST(long, _vlo_stack_n - 1);
-              fprintf (stderr,
-                   "  Adding top %ld, set place = %d, sit = ",
-                   _top_index, pl_ind);
-              sit_print (stderr, sit, grammar->debug_level > 5);
-              fprintf (stderr, ", %d\n", sit_orig);
-            }
+struct yaep_tree_node *
+yaep_parser_expand_forest_node (struct yaep_parser *parser,
+				struct yaep_tree_node *node)
+{
+  struct yaep_parser_env saved;
+
+  assert (parser != NULL && !parser->busy_p && node != NULL);
+  if (node->type != YAEP_LAZY)
+    return node;
+  assert (parser->x_forest_live_p);
+  parser_enter (parser, &saved);
+  forest_expand_choice (YAEP_STATIC_CAST(struct forest_choice *,
+					 node->val.lazy.data));
+  parser_leave (&saved);
+  return node;
+}
+
+/* The following function sets up FLAG of building SPPFs by PARSER.
+   It returns the previous flag value. */
+#ifdef __cplusplus
+static
 #endif
-		}
-	      else
-		{
-		  /* Empty rule should produce something not abtract
-		     node.  So place empty node. */
-		  place_translation (anode == NULL
-				     ? parent_anode->val.anode.children
-				     + parent_disp
-				     : anode->val.anode.children + disp,
-				     empty_node);
-		  empty_node->val.nil.used = 1;
-		}
-	    }			/* if (parent_anode != NULL && disp >= 0) */
-	  n_candidates++;
-	}			/* For all reduces of the nonterminal. */
-      /* We should have a parse. */
-      assert (n_candidates != 0
-	      && (!grammar->one_parse_p || n_candidates == 1));
-    }				/* For all parser states. */
-  VLO_DELETE (stack);
-  if (!grammar->one_parse_p)
+int
+yaep_parser_set_sppf_flag (struct yaep_parser *parser, int flag)
+{
+  int old;
+
+  assert (parser != NULL && !parser->busy_p);
+  old = parser->sppf_p;
+  parser->sppf_p = flag != 0;
+  return old;
+}
+
+/* The following function returns the root of the SPPF of the last
+   parse by PARSER or NULL. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_sppf_node *
+yaep_parser_sppf_root (struct yaep_parser *parser)
+{
+  assert (parser != NULL);
+  return parser->x_sppf_root_node;
+}
+
+/* The following function returns the first node of the SPPF of the
+   last parse by PARSER or NULL. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_sppf_node *
+yaep_parser_sppf_first (struct yaep_parser *parser)
+{
+  assert (parser != NULL);
+  if (parser->x_sppf_root_node == NULL)
+    return NULL;
+  return *YAEP_STATIC_CAST(struct yaep_sppf_node **,
+			   VLO_BEGIN (parser->x_sppf_nodes_vlo));
+}
+
+/* The following function returns the node after NODE of the SPPF of
+   the last parse by PARSER or NULL. */
+#ifdef __cplusplus
+static
+#endif
+struct yaep_sppf_node *
+yaep_parser_sppf_next (struct yaep_parser *parser,
+		       struct yaep_sppf_node *node)
+{
+  assert (parser != NULL && parser->x_sppf_root_node != NULL && node != NULL);
+  if (node == parser->x_sppf_root_node)
+    return NULL;
+  return (YAEP_STATIC_CAST(struct yaep_sppf_node **,
+			   VLO_BEGIN (parser->x_sppf_nodes_vlo)))[node->num
+								  + 1];
+}
+
+#ifdef USE_SHARED_MEMO
+
+
+/* This page contains compilation of the LR(0) automaton of a frozen
+   grammar.  Its states are formed ahead of time as set cores in the
+   same way as the split epsilon-DFA of Aycock and Horspool: the start
+   situations of a core are the kernel of a state and the rest of the
+   core (the prediction closures of the nonterminals after the dot) is
+   its epsilon successor.  The goto of a state on a symbol is the core
+   whose start situations are the situations of the state shifted over
+   the symbol.  The cores are published as the first snapshot of the
+   shared memo, so all parses find set cores formed only by shifting
+   (e.g. after operators, keywords and opening brackets) there.  Set
+   cores containing situations formed by reductions are still formed
+   during parsing. */
+
+/* The following function adds the goto of state CORE on the symbol
+   of CORE_SYMB_VECT to the automaton if it is a new state.  Shifted
+   situations whose lookahead does not contain terminal with number
+   LOOKAHEAD_TERM_NUM are not in the goto unless the number is
+   negative.  The start situations of the state are supposed to have
+   the same origin set, the distance of the start situations formed
+   from the initial ones is 1.  ORIGIN_DIST is the distance of the
+   other start situations.  The new state is added to *CORES_VLO. */
+static void
+lr0_automaton_goto (vlo_t *cores_vlo, struct set_core *core,
+		    struct core_symb_vect *core_symb_vect,
+		    int lookahead_term_num, int origin_dist)
+{
+  struct sit *sit, *new_sit;
+  int i, sit_ind, dist;
+
+  set_new_start ();
+  empty_sit_dist_set ();
+  for (i = 0; i < core_symb_vect->transitions.len; i++)
     {
-      VLO_DELETE (orig_states);
-      if (term_node_array != NULL)
-        yaep_free (grammar->alloc, term_node_array);
+      sit_ind = core_symb_vect->transitions.els[i];
+      sit = core->sits[sit_ind];
+      new_sit = sit_create (sit->rule, sit->pos + 1, sit->context);
+      if (lookahead_term_num >= 0
+	  && !term_set_test (new_sit->lookahead, lookahead_term_num)
+	  && !term_set_test (new_sit->lookahead, grammar->term_error_num))
+	continue;
+      dist = sit_ind >= core->n_all_dists ? 1 : origin_dist;
+      if (sit_dist_insert (new_sit, dist))
+	set_new_add_start_sit (new_sit, dist);
     }
-  parse_state_fin ();
-  grammar->one_parse_p = saved_one_parse_p;
-  if (grammar->cost_p && *ambiguous_p)
-    /* We can not build minimal tree during building parsing list
-       because we have not the translation yet.  We can not make it
-       during parsing because the abstract nodes are created before
-       their children. */
-    result = find_minimal_translation (result);
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 1)
+  if (new_n_start_sits == 0 || !set_insert ())
+    return;
+  expand_new_start_set ();
+  new_core->term = core_symb_vect->symb->term_p ? core_symb_vect->symb : NULL;
+  VLO_ADD_MEMORY (*cores_vlo, &new_core, sizeof (struct set_core *));
+}
+
+/* The following function compiles the LR(0) automaton of the current
+   frozen grammar into the first snapshot of its shared memo.  For
+   static lookaheads, a goto is formed for each lookahead terminal as
+   a parse does it.  The function returns the error code. */
+static int
+lr0_automaton_create (void)
+{
+  struct yaep_parser *parser;
+  struct yaep_parser_env saved;
+  struct set_core *core;
+  struct core_symb_vect *core_symb_vect;
+  struct rule *rule;
+  struct symb *symb;
+  size_t k;
+  int i, lookahead_term_num, n_terms;
+  vlo_t cores_vlo;
+
+  if ((parser = yaep_create_parser (grammar)) == NULL)
+    return YAEP_NO_MEMORY;
+  parser_enter (parser, &saved);
+  workspace_init ();
+  yaep_parse_init (0);
+  VLO_CREATE (cores_vlo, grammar->alloc, 0);
+  set_new_start ();
+  for (rule = grammar->axiom->u.nonterm.rules;
+       rule != NULL; rule = rule->lhs_next)
+    set_new_add_start_sit (sit_create (rule, 0, 0), 0);
+  if (set_insert ())
     {
-      fprintf (stderr, "Translation:\n");
-      print_parse (stderr, result);
-      fprintf (stderr, "\n");
+      expand_new_start_set ();
+      new_core->term = NULL;
+      VLO_ADD_MEMORY (cores_vlo, &new_core, sizeof (struct set_core *));
     }
-  else if (grammar->debug_level < 0)
+  n_terms = grammar->lookahead_level == 0 ? 0 : YAEP_STATIC_CAST(int, symbs_ptr->n_terms);
+  for (k = 0; k < VLO_NELS (cores_vlo, struct set_core *); k++)
     {
-      fprintf (stderr, "digraph CFG {\n");
-      fprintf (stderr, "  node [shape=ellipse, fontsize=200];\n");
-      fprintf (stderr, "  ratio=fill;\n");
-      fprintf (stderr, "  ordering=out;\n");
-      fprintf (stderr, "  page = \"8.5, 11\"; // inches\n");
-      fprintf (stderr, "  size = \"7.5, 10\"; // inches\n\n");
-      print_parse (stderr, result);
-      fprintf (stderr, "}\n");
+      core = YAEP_STATIC_CAST(struct set_core **, VLO_BEGIN (cores_vlo))[k];
+      for (i = 0; (symb = symb_get (i)) != NULL; i++)
+	{
+	  if ((core_symb_vect = core_symb_vect_find (core, symb)) == NULL
+	      || core_symb_vect->transitions.len == 0)
+	    continue;
+	  /* The start situations of the first set have zero
+	     distance. */
+	  lookahead_term_num = n_terms == 0 ? -1 : 0;
+	  do
+	    lr0_automaton_goto (&cores_vlo, core, core_symb_vect,
+				lookahead_term_num, k == 0 ? 1 : 2);
+	  while (++lookahead_term_num < n_terms);
+	}
     }
+  VLO_DELETE (cores_vlo);
+  shared_memo_publish ();
+  yaep_parse_fin ();
+  parser_leave (&saved);
+  yaep_free_parser (parser);
+  return 0;
+}
+
+#endif /* #ifdef USE_SHARED_MEMO */
+
+/* The following function puts statistics of the last parse made by
+   PARSER (if TOTAL_P is zero) or their sums for all parses of PARSER
+   into *STATS. */
+#ifdef __cplusplus
+static
 #endif
+void
+yaep_parser_get_parse_stats (struct yaep_parser *parser, int total_p,
+			     struct yaep_parse_stats *stats)
+{
+  assert (parser != NULL && stats != NULL);
+  *stats = total_p ? parser->total_stats : parser->last_stats;
+}
 
-  /* Free empty and error node if they have not been used */
-  if (parse_free != NULL)
+/* The following function clears the parse statistics of PARSER. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_parser_reset_parse_stats (struct yaep_parser *parser)
+{
+  assert (parser != NULL);
+  memset (&parser->last_stats, 0, sizeof (struct yaep_parse_stats));
+  memset (&parser->total_stats, 0, sizeof (struct yaep_parse_stats));
+}
+
+/* The following function puts statistics of the last parse of
+   grammar G (if TOTAL_P is zero) or their sums for all parses of G
+   into *STATS. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_get_parse_stats (struct grammar *g, int total_p,
+		      struct yaep_parse_stats *stats)
+{
+  assert (g != NULL && stats != NULL);
+  pthread_mutex_lock (&g->stats_mutex);
+  *stats = total_p ? g->total_stats : g->last_stats;
+  pthread_mutex_unlock (&g->stats_mutex);
+}
+
+/* The following function clears the parse statistics of grammar G.
+   The statistics of a frozen grammar are never changed. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_reset_parse_stats (struct grammar *g)
+{
+  assert (g != NULL);
+  if (g->frozen_p)
+    return;
+  pthread_mutex_lock (&g->stats_mutex);
+  memset (&g->last_stats, 0, sizeof (struct yaep_parse_stats));
+  memset (&g->total_stats, 0, sizeof (struct yaep_parse_stats));
+  pthread_mutex_unlock (&g->stats_mutex);
+}
+
+/* The following function frees the parse cache and the parse
+   workspace used by yaep_parse for grammar G. */
+#ifdef __cplusplus
+static
+#endif
+void
+yaep_flush_parse_cache (struct grammar *g)
+{
+  assert (g != NULL);
+  if (g->parser != NULL && !g->parser->busy_p)
+    yaep_parser_flush_cache (g->parser);
+}
+
+/* The following function sets up maximal size of the parse cache for
+   grammar G and returns the previous value. */
+#ifdef __cplusplus
+static
+#endif
+size_t
+yaep_set_parse_cache_limit (struct grammar *g, size_t limit)
+{
+  size_t old;
+
+  assert (g != NULL);
+  old = g->parse_cache_limit;
+  if (g->frozen_p)
+    return old;
+  g->parse_cache_limit = limit;
+  if (limit == 0)
+    yaep_flush_parse_cache (g);
+  return old;
+}
+
+/* The following function makes parse with PARSER whose input and
+   callbacks are given by CTX.  The function returns the error
+   code. */
+static int
+parser_parse (struct yaep_parser *parser, struct yaep_parse_context *ctx)
+{
+  struct yaep_parser_env saved;
+  int code;
+
+  assert (parser != NULL);
+
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  if (parser->tree_arena != NULL)
     {
-      if (!empty_node->val.nil.used)
-	{
-	  parse_free (empty_node);
-	}
-      if (!error_node->val.error.used)
+      ctx->alloc_fn = tree_arena_parse_alloc;
+      ctx->free_fn = NULL;
+    }
+  else if (ctx->alloc_fn == NULL)
+    {
+      if (ctx->free_fn != NULL)
 	{
-	  parse_free (error_node);
+	  /* Cannot allocate memory with a null function */
+	  return YAEP_NO_MEMORY;
 	}
+      /* Set up defaults */
+      ctx->alloc_fn = parse_alloc_default;
+      ctx->free_fn = parse_free_default;
     }
 
-  assert (result != NULL
-	  && (!grammar->one_parse_p || n_parse_alt_nodes == 0));
-  return result;
-}
+  ctx->parser = parser;
+  ctx->result = 0;
+  ctx->parse_init_p = FALSE;
 
-static void *
-parse_alloc_default (int nmemb)
-{
-  void *result;
+  parser_enter (parser, &saved);
+  parser->busy_p = TRUE;
+  workspace_init ();
+  forest_fin ();
+  sppf_fin ();
 
-  assert (nmemb > 0);
+  /* All internal error handling now uses explicit return codes,
+   * so we can call yaep_parse_internal directly without the
+   * error boundary wrapper. This simplifies the call stack and
+   * improves debuggability. */
+  code = yaep_parse_internal (ctx);
+  if (code != 0 && ctx->result == 0)
+    ctx->result = code;
 
-  result = malloc (YAEP_STATIC_CAST(size_t, nmemb));
-  if (result == NULL)
+  if (code != 0)
     {
-      exit (1);
+      pl_fin ();
+      if (ctx->parse_init_p)
+	{
+	  yaep_parse_fin ();
+	  /* The cache can be inconsistent after the error. */
+	  parse_cache_fin ();
+	}
     }
+  parser->busy_p = FALSE;
+  parser_leave (&saved);
 
-  return result;
+  return ctx->result;
 }
 
-static void
-parse_free_default (void *mem)
+/* The following function makes parse given by CTX with the grammar
+   parser keeping the parse cache and the parse workspace between the
+   calls (or with a temporary parser if G is frozen or the grammar
+   parser is busy) and records error in grammar G (or only in the
+   thread error context if G is frozen).  The function returns the
+   error code. */
+static int
+grammar_parse (struct grammar *g, struct yaep_parse_context *ctx)
 {
-  free (mem);
+  struct yaep_parser *parser;
+  int code;
+
+  assert (g != NULL);
+
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  if (!g->frozen_p && (g->parser == NULL || !g->parser->busy_p))
+    {
+      /* Use the grammar parser to keep the parse cache and the parse
+	 workspace between the calls. */
+      if (g->parser == NULL && (g->parser = yaep_create_parser (g)) == NULL)
+	return yaep_error_code (g);
+      parser = g->parser;
+    }
+  else if ((parser = yaep_create_parser (g)) == NULL)
+    return yaep_error_code (g);
+  parser->tree_arena = g->tree_arena;
+  parser->tree_events = g->tree_events;
+  code = parser_parse (parser, ctx);
+  if (!g->frozen_p)
+    {
+      g->error_code = parser->error_code;
+      strcpy (g->error_message, parser->error_message);
+    }
+  if (parser != g->parser)
+    yaep_free_parser (parser);
+  return code;
 }
 
 /* The following function parses input according read grammar.
@@ -6928,7 +12090,42 @@ parse_free_default (void *mem)
    NO_YAEP_DEBUG_PRINT).  The function returns the error code (which
    will be also in error_code).  The function sets up
    *AMBIGUOUS_P if we found that the grammer is ambigous (it works even
-   we asked only one parse tree without alternatives). */
+   we asked only one parse tree without alternatives).  All data
+   changed during parsing are in PARSER, so different parsers for the
+   same grammar can work simultaneously. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_parser_parse (struct yaep_parser *parser,
+		   int (*read) (void **attr),
+		   void (*error) (int err_tok_num, void *err_tok_attr,
+				  int start_ignored_tok_num,
+				  void *start_ignored_tok_attr,
+				  int start_recovered_tok_num,
+				  void *start_recovered_tok_attr),
+		   void *(*alloc) (int nmemb),
+		   void (*free) (void *mem),
+		   struct yaep_tree_node **root, int *ambiguous_p)
+{
+  struct yaep_parse_context ctx;
+
+  ctx.read_fn = read;
+  ctx.n_codes = 0;
+  ctx.codes = NULL;
+  ctx.attrs = NULL;
+  ctx.error_fn = error;
+  ctx.alloc_fn = alloc;
+  ctx.free_fn = free;
+  ctx.root = root;
+  ctx.ambiguous_p = ambiguous_p;
+  return parser_parse (parser, &ctx);
+}
+
+/* The following function is analogous to the previous one but it
+   uses a temporary parser (or the grammar parser if the parse cache
+   is used) and records error in grammar G (or only in the thread
+   error context if G is frozen). */
 #ifdef __cplusplus
 static
 #endif
@@ -6945,70 +12142,169 @@ yaep_parse (struct grammar *g,
 	    struct yaep_tree_node **root, int *ambiguous_p)
 {
   struct yaep_parse_context ctx;
-  int code;
 
-  assert (g != NULL);
+  ctx.read_fn = read;
+  ctx.n_codes = 0;
+  ctx.codes = NULL;
+  ctx.attrs = NULL;
+  ctx.error_fn = error;
+  ctx.alloc_fn = alloc;
+  ctx.free_fn = free;
+  ctx.root = root;
+  ctx.ambiguous_p = ambiguous_p;
+  return grammar_parse (g, &ctx);
+}
 
-  yaep_initialize_error_handling ();
-  yaep_clear_error ();
-  if (alloc == NULL)
-    {
-      if (free != NULL)
-	{
-	  /* Cannot allocate memory with a null function */
-	  return YAEP_NO_MEMORY;
-	}
-      /* Set up defaults */
-      alloc = parse_alloc_default;
-      free = parse_free_default;
-    }
+/* The following function is analogous to yaep_parser_parse but the
+   input is N tokens with CODES and attributes ATTRS (it can be NULL
+   if all attributes are NULL) given by the caller.  The attributes
+   are not copied, so the arrays should live until the parse is
+   finished. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_parser_parse_tokens (struct yaep_parser *parser,
+			  int n, const int *codes, void *const *attrs,
+			  void (*error) (int err_tok_num, void *err_tok_attr,
+					 int start_ignored_tok_num,
+					 void *start_ignored_tok_attr,
+					 int start_recovered_tok_num,
+					 void *start_recovered_tok_attr),
+			  void *(*alloc) (int nmemb),
+			  void (*free) (void *mem),
+			  struct yaep_tree_node **root, int *ambiguous_p)
+{
+  struct yaep_parse_context ctx;
 
-  ctx.grammar = g;
-  ctx.read_fn = read;
+  assert (n >= 0);
+  ctx.read_fn = NULL;
+  ctx.n_codes = n;
+  ctx.codes = codes;
+  ctx.attrs = attrs;
   ctx.error_fn = error;
   ctx.alloc_fn = alloc;
   ctx.free_fn = free;
   ctx.root = root;
   ctx.ambiguous_p = ambiguous_p;
-  ctx.result = 0;
-  ctx.tok_init_p = FALSE;
-  ctx.parse_init_p = FALSE;
+  return parser_parse (parser, &ctx);
+}
 
-  pl_init ();
+/* The following function is analogous to yaep_parse but the input
+   is given as for yaep_parser_parse_tokens. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_parse_tokens (struct grammar *g,
+		   int n, const int *codes, void *const *attrs,
+		   void (*error) (int err_tok_num, void *err_tok_attr,
+				  int start_ignored_tok_num,
+				  void *start_ignored_tok_attr,
+				  int start_recovered_tok_num,
+				  void *start_recovered_tok_attr),
+		   void *(*alloc) (int nmemb),
+		   void (*free) (void *mem),
+		   struct yaep_tree_node **root, int *ambiguous_p)
+{
+  struct yaep_parse_context ctx;
 
-  /* All internal error handling now uses explicit return codes,
-   * so we can call yaep_parse_internal directly without the
-   * error boundary wrapper. This simplifies the call stack and
-   * improves debuggability. */
-  code = yaep_parse_internal (&ctx);
-  if (code != 0 && ctx.result == 0)
-    ctx.result = code;
+  assert (n >= 0);
+  ctx.read_fn = NULL;
+  ctx.n_codes = n;
+  ctx.codes = codes;
+  ctx.attrs = attrs;
+  ctx.error_fn = error;
+  ctx.alloc_fn = alloc;
+  ctx.free_fn = free;
+  ctx.root = root;
+  ctx.ambiguous_p = ambiguous_p;
+  return grammar_parse (g, &ctx);
+}
 
-  if (code != 0)
+/* The following function starts the current parse for N_TOKS tokens
+   (it is only an estimation used for the initial sizes of tables). */
+static void
+start_parse (int n_toks)
+{
+  n_goto_successes = 0;
+  yaep_parse_init (n_toks);
+  pl_create ();
+#ifndef __cplusplus
+  curr_parser->x_tab_collisions = get_all_collisions ();
+  curr_parser->x_tab_searches = get_all_searches ();
+#else
+  curr_parser->x_tab_collisions = hash_table::get_all_collisions ();
+  curr_parser->x_tab_searches = hash_table::get_all_searches ();
+#endif
+  build_pl_start ();
+}
+
+/* The following function finishes forming the parsing list for all
+   input tokens, builds the parse tree in *ROOT, and frees data of the
+   current parse started by start_parse and tok_init. */
+static void
+finish_parse (struct yaep_tree_node **root, int *ambiguous_p)
+{
+  int tab_collisions, tab_searches;
+
+  build_pl_advance (TRUE);
+  if (grammar->recognition_p)
+    *root = make_recognition ();
+  else if (curr_parser->sppf_p)
+    *root = make_sppf (ambiguous_p);
+  else if (curr_parser->forest_p)
+    *root = make_forest ();
+  else if (curr_parser->tree_events != NULL)
+    *root = make_tree_events (ambiguous_p);
+  else if (grammar->cost_p && grammar->one_parse_p)
+    *root = make_min_cost_parse (ambiguous_p);
+  else
+    *root = make_parse (ambiguous_p);
+#ifndef __cplusplus
+  tab_collisions = get_all_collisions () - curr_parser->x_tab_collisions;
+  tab_searches = get_all_searches () - curr_parser->x_tab_searches;
+#else
+  tab_collisions
+    = hash_table::get_all_collisions () - curr_parser->x_tab_collisions;
+  tab_searches
+    = hash_table::get_all_searches () - curr_parser->x_tab_searches;
+#endif
+
+  parse_stats_collect (&curr_parser->last_stats, *ambiguous_p,
+		       tab_collisions, tab_searches);
+  parse_stats_add (&curr_parser->total_stats, &curr_parser->last_stats);
+  if (!grammar->frozen_p && !curr_parser->batch_p)
     {
-      pl_fin ();
-      if (ctx.parse_init_p)
-	yaep_parse_fin ();
-      if (ctx.tok_init_p)
-	tok_fin ();
+      pthread_mutex_lock (&grammar->stats_mutex);
+      grammar->last_stats = curr_parser->last_stats;
+      parse_stats_add (&grammar->total_stats, &curr_parser->last_stats);
+      pthread_mutex_unlock (&grammar->stats_mutex);
     }
+#ifndef NO_YAEP_DEBUG_PRINT
+  if (grammar->debug_level > 0)
+    parse_stats_print (&curr_parser->last_stats);
+#endif
 
-  return ctx.result;
+#ifdef USE_SHARED_MEMO
+  if (grammar->shared_memo_p)
+    shared_memo_publish ();
+#endif
+  if (forest_live_p)
+    /* The sets are kept for the forest (see forest_fin). */
+    return;
+  yaep_parse_fin ();
+  pl_fin ();
 }
 
 static int
 yaep_parse_internal (void *user)
 {
   struct yaep_parse_context *ctx = YAEP_STATIC_CAST(struct yaep_parse_context *, user);
-  int tab_collisions, tab_searches;
   int code;
 
-  grammar = ctx->grammar;
-  assert (grammar != NULL);
+  assert (grammar != NULL && ctx->parser == curr_parser);
   yaep_copy_error_to_grammar (grammar);
-  symbs_ptr = grammar->symbs_ptr;
-  term_sets_ptr = grammar->term_sets_ptr;
-  rules_ptr = grammar->rules_ptr;
   read_token = ctx->read_fn;
   syntax_error = ctx->error_fn;
   parse_alloc = ctx->alloc_fn;
@@ -7017,110 +12313,420 @@ yaep_parse_internal (void *user)
   *ctx->ambiguous_p = FALSE;
 
   ctx->result = 0;
-  ctx->tok_init_p = FALSE;
   ctx->parse_init_p = FALSE;
 
   /* Grammar must be properly initialized before parsing */
   if (grammar->undefined_p)
     return yaep_set_error
       (grammar, YAEP_UNDEFINED_OR_BAD_GRAMMAR, "undefined or bad grammar");
-  n_goto_successes = 0;
   tok_init ();
-  ctx->tok_init_p = TRUE;
-  code = read_toks ();
+  if (ctx->read_fn != NULL)
+    code = read_toks ();
+  else
+    code = tok_set_array (ctx->n_codes, ctx->codes, ctx->attrs);
   if (code != 0)
     {
       ctx->result = code;
       return code;
     }
-  yaep_parse_init (toks_len);
+  start_parse (toks_len);
   ctx->parse_init_p = TRUE;
-  pl_create ();
-#ifndef __cplusplus
-  tab_collisions = get_all_collisions ();
-  tab_searches = get_all_searches ();
-#else
-  tab_collisions = hash_table::get_all_collisions ();
-  tab_searches = hash_table::get_all_searches ();
-#endif
-  build_pl ();
-  *ctx->root = make_parse (ctx->ambiguous_p);
-#ifndef __cplusplus
-  tab_collisions = get_all_collisions () - tab_collisions;
-  tab_searches = get_all_searches () - tab_searches;
-#else
-  tab_collisions = hash_table::get_all_collisions () - tab_collisions;
-  tab_searches = hash_table::get_all_searches () - tab_searches;
+  finish_parse (ctx->root, ctx->ambiguous_p);
+  ctx->parse_init_p = FALSE;
+  return 0;
+}
+
+/* The following function starts parse with PARSER whose tokens will
+   be given by calls of yaep_parse_feed.  Other parameters are
+   analogous to the ones of yaep_parser_parse.  The function returns
+   the error code. */
+#ifdef __cplusplus
+static
 #endif
+int
+yaep_parse_begin (struct yaep_parser *parser,
+		  void (*error) (int err_tok_num, void *err_tok_attr,
+				 int start_ignored_tok_num,
+				 void *start_ignored_tok_attr,
+				 int start_recovered_tok_num,
+				 void *start_recovered_tok_attr),
+		  void *(*alloc) (int nmemb), void (*free) (void *mem))
+{
+  struct yaep_parser_env saved;
+  int code = 0;
 
-#ifndef NO_YAEP_DEBUG_PRINT
-  if (grammar->debug_level > 0)
+  assert (parser != NULL && !parser->busy_p);
+
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  if (parser->tree_arena != NULL)
     {
-  fprintf (stderr, "%sGrammar: #terms = %zu, #nonterms = %zu, ",
-        *ctx->ambiguous_p ? "AMBIGUOUS " : "",
-        symbs_ptr->n_terms, symbs_ptr->n_nonterms);
-      fprintf (stderr, "#rules = %d, rules size = %d\n",
-	       rules_ptr->n_rules,
-	       rules_ptr->n_rhs_lens + rules_ptr->n_rules);
-      fprintf (stderr, "Input: #tokens = %d, #unique situations = %d\n",
-	       toks_len, n_all_sits);
-  fprintf (stderr, "       #terminal sets = %zu, their size = %zu\n",
-        term_sets_ptr->n_term_sets, term_sets_ptr->n_term_sets_size);
-      fprintf (stderr,
-	       "       #unique set cores = %d, #their start situations = %d\n",
-	       n_set_cores, n_set_core_start_sits);
-      fprintf (stderr,
-	       "       #parent indexes for some non start situations = %d\n",
-	       n_parent_indexes);
-      fprintf (stderr,
-	       "       #unique set dist. vects = %d, their length = %d\n",
-	       n_set_dists, n_set_dists_len);
-      fprintf (stderr,
-	       "       #unique sets = %d, #their start situations = %d\n",
-	       n_sets, n_sets_start_sits);
-      fprintf (stderr,
-	       "       #unique triples (set, term, lookahead) = %d, goto successes=%d\n",
-	       n_set_term_lookaheads, n_goto_successes);
-      fprintf (stderr,
-	       "       #pairs(set core, symb) = %d, their trans+reduce vects length = %d\n",
-	       n_core_symb_pairs, n_core_symb_vect_len);
-      fprintf (stderr,
-	       "       #unique transition vectors = %d, their length = %d\n",
-	       n_transition_vects, n_transition_vect_len);
-#ifdef TRANSITIVE_TRANSITION
-      fprintf (stderr,
-	       "       #unique transitive transition vectors = %d, their length = %d\n",
-	       n_transitive_transition_vects,
-	       n_transitive_transition_vect_len);
+      alloc = tree_arena_parse_alloc;
+      free = NULL;
+    }
+  else if (alloc == NULL)
+    {
+      if (free != NULL)
+	/* Cannot allocate memory with a null function */
+	return YAEP_NO_MEMORY;
+      /* Set up defaults */
+      alloc = parse_alloc_default;
+      free = parse_free_default;
+    }
+  parser_enter (parser, &saved);
+  yaep_copy_error_to_grammar (grammar);
+  if (grammar->undefined_p)
+    code = yaep_set_error
+      (grammar, YAEP_UNDEFINED_OR_BAD_GRAMMAR, "undefined or bad grammar");
+  else
+    {
+      parser->busy_p = parser->push_p = TRUE;
+      read_token = NULL;
+      syntax_error = error;
+      parse_alloc = alloc;
+      parse_free = free;
+      workspace_init ();
+      forest_fin ();
+      sppf_fin ();
+      tok_init ();
+      start_parse (0);
+    }
+  parser_leave (&saved);
+  return code;
+}
+
+/* The following function adds N tokens with CODES and attributes
+   ATTRS (it can be NULL if all attributes are NULL) to the input of
+   the parse started by yaep_parse_begin and forms Earley's sets for
+   all tokens except for the last one (its set needs the next token
+   for the lookahead).  If error recovery is switched on, forming the
+   sets is suspended after a syntax error until yaep_parse_end
+   because error recovery can look at any subsequent token.  The
+   function returns the error code.  The parse is finished on an
+   error. */
+#ifdef __cplusplus
+static
 #endif
-      fprintf (stderr,
-	       "       #unique reduce vectors = %d, their length = %d\n",
-	       n_reduce_vects, n_reduce_vect_len);
-      fprintf (stderr,
-	       "       #term nodes = %d, #abstract nodes = %d\n",
-	       n_parse_term_nodes, n_parse_abstract_nodes);
-      fprintf (stderr,
-	       "       #alternative nodes = %d, #all nodes = %d\n",
-	       n_parse_alt_nodes,
-	       n_parse_term_nodes + n_parse_abstract_nodes
-	       + n_parse_alt_nodes);
-      if (tab_searches == 0)
-	tab_searches++;
-      fprintf (stderr,
-	       "       #table collisions = %.2g%% (%d out of %d)\n",
-	       tab_collisions * 100.0 / tab_searches,
-	       tab_collisions, tab_searches);
+int
+yaep_parse_feed (struct yaep_parser *parser, int n, const int *codes,
+		 void *const *attrs)
+{
+  struct yaep_parser_env saved;
+  int code;
+
+  assert (parser != NULL && parser->push_p && n >= 0);
+  parser_enter (parser, &saved);
+  if ((code = tok_add_codes (n, codes)) == 0)
+    {
+      if (attrs != NULL)
+	tok_add_attrs (n, attrs);
+      pl_expand ();
+      build_pl_advance (FALSE);
+    }
+  else
+    {
+      pl_fin ();
+      yaep_parse_fin ();
+      parser->busy_p = parser->push_p = FALSE;
     }
+  parser_leave (&saved);
+  return code;
+}
+
+/* The following function finishes the parse started by
+   yaep_parse_begin, forms the rest of Earley's sets, and builds the
+   parse tree in *ROOT.  *AMBIGUOUS_P is set up as in
+   yaep_parser_parse.  The function returns the error code. */
+#ifdef __cplusplus
+static
 #endif
+int
+yaep_parse_end (struct yaep_parser *parser,
+		struct yaep_tree_node **root, int *ambiguous_p)
+{
+  struct yaep_parser_env saved;
+  int code;
 
-  yaep_parse_fin ();
-  ctx->parse_init_p = FALSE;
-  tok_fin ();
-  ctx->tok_init_p = FALSE;
-  /* Free parser list memory allocated in pl_create() to avoid leak (Valgrind baseline). */
-  pl_fin ();
-  return 0;
+  assert (parser != NULL && parser->push_p);
+  parser_enter (parser, &saved);
+  *root = NULL;
+  *ambiguous_p = FALSE;
+  code = tok_add (END_MARKER_CODE, NULL);
+  assert (code == 0);
+  pl_expand ();
+  finish_parse (root, ambiguous_p);
+  parser->busy_p = parser->push_p = FALSE;
+  parser_leave (&saved);
+  return code;
+}
+
+
+
+/* This page contains batch parsing.  The batch inputs are parsed by
+   a pool of threads (workers).  Each worker has own parser and a
+   deque of inputs.  The inputs are dealt to the deques in order of
+   decreasing size, so each deque starts with its largest input and
+   the large inputs are parsed first by all workers.  A worker takes
+   inputs from the start of its deque.  When the deque is empty, the
+   worker steals inputs from the end of other deques.  The batch has
+   no other inputs than the dealt ones, so the workers finish when
+   all deques are empty. */
+
+/* The following describes a batch worker. */
+struct batch_worker
+{
+  /* The batch of the worker. */
+  struct batch *batch;
+  /* The parser of the worker. */
+  struct yaep_parser *parser;
+  pthread_t thread;
+  /* TRUE if THREAD was created. */
+  int thread_p;
+  /* The worker deque is the elements of batch->order from START to
+     BOUND (not including).  They are changed only when MUTEX is
+     locked. */
+  pthread_mutex_t mutex;
+  int start, bound;
+};
+
+/* The following describes a batch parse. */
+struct batch
+{
+  struct yaep_batch_input *inputs;
+  /* The indexes of inputs dealt to the worker deques. */
+  int *order;
+  int n_workers;
+  struct batch_worker *workers;
+  void (*error_fn) (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num,
+		    void *start_ignored_tok_attr,
+		    int start_recovered_tok_num,
+		    void *start_recovered_tok_attr);
+  void *(*alloc_fn) (int nmemb);
+  void (*free_fn) (void *mem);
+};
+
+/* The following describes an input size used to sort the inputs. */
+struct batch_input_size
+{
+  int n_toks, index;
+};
+
+/* The following is comparison function for sorting the inputs in
+   order of decreasing size. */
+static int
+batch_input_size_cmp (const void *s1, const void *s2)
+{
+  const struct batch_input_size *size1
+    = YAEP_STATIC_CAST(const struct batch_input_size *, s1);
+  const struct batch_input_size *size2
+    = YAEP_STATIC_CAST(const struct batch_input_size *, s2);
+
+  if (size1->n_toks != size2->n_toks)
+    return size1->n_toks > size2->n_toks ? -1 : 1;
+  return size1->index < size2->index ? -1 : size1->index > size2->index;
+}
+
+/* The following function deals N inputs of batch B given by their
+   SIZES sorted in order of decreasing size to the worker deques.  The
+   Ith input goes to the deque of worker I % n_workers, so the deque
+   sizes differ by one at most. */
+static void
+batch_deal (struct batch *b, const struct batch_input_size *sizes, int n)
+{
+  struct batch_worker *w;
+  int i, start;
+
+  for (start = i = 0; i < b->n_workers; i++)
+    {
+      w = &b->workers[i];
+      w->start = w->bound = start;
+      start += n / b->n_workers + (i < n % b->n_workers ? 1 : 0);
+    }
+  for (i = 0; i < n; i++)
+    {
+      w = &b->workers[i % b->n_workers];
+      b->order[w->bound++] = sizes[i].index;
+    }
+}
+
+/* The following function removes and returns an input index from the
+   start (if START_P) or from the end of deque of worker W.  It returns
+   -1 if the deque is empty. */
+static int
+batch_deque_pop (struct batch_worker *w, int start_p)
+{
+  int index = -1;
+
+  pthread_mutex_lock (&w->mutex);
+  if (w->start < w->bound)
+    index = w->batch->order[start_p ? w->start++ : --w->bound];
+  pthread_mutex_unlock (&w->mutex);
+  return index;
+}
+
+/* The following function returns index of the next input for worker
+   W: the first input of its deque or an input stolen from another
+   worker.  It returns -1 if all deques are empty. */
+static int
+batch_next_input (struct batch_worker *w)
+{
+  struct batch *b = w->batch;
+  int i, index, num;
+
+  if ((index = batch_deque_pop (w, TRUE)) >= 0)
+    return index;
+  num = YAEP_STATIC_CAST(int, w - b->workers);
+  for (i = 1; i < b->n_workers; i++)
+    if ((index = batch_deque_pop (&b->workers[(num + i) % b->n_workers],
+				  FALSE)) >= 0)
+      return index;
+  return -1;
+}
+
+/* The following function is the thread function of batch worker
+   ARG. */
+static void *
+batch_work (void *arg)
+{
+  struct batch_worker *w = YAEP_STATIC_CAST(struct batch_worker *, arg);
+  struct batch *b = w->batch;
+  struct yaep_batch_input *input;
+  int index;
+
+  while ((index = batch_next_input (w)) >= 0)
+    {
+      input = &b->inputs[index];
+      input->error_code
+	= yaep_parser_parse_tokens (w->parser, input->n_toks, input->codes,
+				    input->attrs, b->error_fn,
+				    b->alloc_fn, b->free_fn,
+				    &input->root, &input->ambiguous_p);
+    }
+  return NULL;
+}
+
+/* The following function parses N INPUTS according to grammar G in
+   N_THREADS threads.  The calling thread is one of the workers.  If a
+   thread can not be created, its inputs are stolen by other
+   workers. */
+#ifdef __cplusplus
+static
+#endif
+int
+yaep_parse_batch (struct grammar *g, struct yaep_batch_input *inputs,
+		  int n, int n_threads,
+		  void (*error) (int err_tok_num, void *err_tok_attr,
+				 int start_ignored_tok_num,
+				 void *start_ignored_tok_attr,
+				 int start_recovered_tok_num,
+				 void *start_recovered_tok_attr),
+		  void *(*alloc) (int nmemb),
+		  void (*free) (void *mem))
+{
+  struct batch b;
+  struct batch_worker *w;
+  struct batch_input_size *sizes;
+  struct yaep_parse_stats stats;
+  int i, code = 0;
+
+  assert (g != NULL && n >= 0);
+  yaep_initialize_error_handling ();
+  yaep_clear_error ();
+  for (i = 0; i < n; i++)
+    {
+      inputs[i].error_code = 0;
+      inputs[i].root = NULL;
+      inputs[i].ambiguous_p = FALSE;
+    }
+  if (n == 0)
+    return 0;
+  if (n_threads <= 0)
+    n_threads = YAEP_STATIC_CAST(int, sysconf (_SC_NPROCESSORS_ONLN));
+  if (n_threads <= 0)
+    n_threads = 1;
+  if (n_threads > n)
+    n_threads = n;
+  b.inputs = inputs;
+  b.n_workers = n_threads;
+  b.error_fn = error;
+  b.alloc_fn = alloc;
+  b.free_fn = free;
+  sizes = YAEP_STATIC_CAST(struct batch_input_size *,
+			   yaep_malloc (g->alloc, YAEP_STATIC_CAST(size_t, n)
+					* sizeof (struct batch_input_size)));
+  b.order = YAEP_STATIC_CAST(int *,
+			     yaep_malloc (g->alloc, YAEP_STATIC_CAST(size_t, n)
+					  * sizeof (int)));
+  b.workers
+    = YAEP_STATIC_CAST(struct batch_worker *,
+		       yaep_calloc (g->alloc,
+				    YAEP_STATIC_CAST(size_t, n_threads),
+				    sizeof (struct batch_worker)));
+  if (sizes == NULL || b.order == NULL || b.workers == NULL)
+    {
+      code = yaep_set_error (g, YAEP_NO_MEMORY, "no memory for batch");
+      goto free_batch;
+    }
+  for (i = 0; i < n; i++)
+    {
+      sizes[i].n_toks = inputs[i].n_toks;
+      sizes[i].index = i;
+    }
+  qsort (sizes, YAEP_STATIC_CAST(size_t, n), sizeof (struct batch_input_size),
+	 batch_input_size_cmp);
+  batch_deal (&b, sizes, n);
+  for (i = 0; i < n_threads; i++)
+    {
+      w = &b.workers[i];
+      w->batch = &b;
+      if ((w->parser = yaep_create_parser (g)) == NULL)
+	{
+	  code = yaep_error_code (g);
+	  goto free_batch;
+	}
+      w->parser->batch_p = TRUE;
+      pthread_mutex_init (&w->mutex, NULL);
+    }
+  for (i = 1; i < n_threads; i++)
+    {
+      w = &b.workers[i];
+      w->thread_p = pthread_create (&w->thread, NULL, batch_work, w) == 0;
+    }
+  batch_work (&b.workers[0]);
+  memset (&stats, 0, sizeof (struct yaep_parse_stats));
+  for (i = 0; i < n_threads; i++)
+    {
+      w = &b.workers[i];
+      if (w->thread_p)
+	pthread_join (w->thread, NULL);
+      parse_stats_add (&stats, &w->parser->total_stats);
+    }
+  if (!g->frozen_p)
+    {
+      pthread_mutex_lock (&g->stats_mutex);
+      g->last_stats = stats;
+      parse_stats_add (&g->total_stats, &stats);
+      pthread_mutex_unlock (&g->stats_mutex);
+    }
+ free_batch:
+  if (b.workers != NULL)
+    for (i = 0; i < n_threads; i++)
+      if (b.workers[i].parser != NULL)
+	{
+	  pthread_mutex_destroy (&b.workers[i].mutex);
+	  yaep_free_parser (b.workers[i].parser);
+	}
+  yaep_free (g->alloc, b.workers);
+  yaep_free (g->alloc, b.order);
+  yaep_free (g->alloc, sizes);
+  if (code != 0)
+    for (i = 0; i < n; i++)
+      inputs[i].error_code = code;
+  return code;
 }
+
+
 
 /* The following function frees memory allocated for the grammar. */
 #ifdef __cplusplus
@@ -7133,11 +12739,17 @@ yaep_free_grammar (struct grammar *g)
 
   if (g != NULL)
     {
+      yaep_free_parser (g->parser);
+      grammar = g;
       allocator = g->alloc;
-      pl_fin ();
+#ifdef USE_SHARED_MEMO
+      shared_memo_free ();
+#endif
       rule_fin (g->rules_ptr);
       term_set_fin (g->term_sets_ptr);
       symb_fin (g->symbs_ptr);
+      compiled_image_unmap (g);
+      pthread_mutex_destroy (&g->stats_mutex);
       yaep_free (allocator, g);
       yaep_alloc_del (allocator);
     }
@@ -7311,11 +12923,7 @@ yaep_free_tree (struct yaep_tree_node *root, void (*free_fn) (void *),
 #ifdef YAEP_TEST
 
 /* All parse_alloc memory is contained here. */
-#ifndef __cplusplus
 static os_t mem_os;
-#else
-static os_t *mem_os;
-#endif
 
 static void *
 test_parse_alloc (int size)
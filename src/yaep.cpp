@@ -24,33 +24,41 @@
 
 */
 
-#define VLO_CREATE( v, allocator, len ) ( v ) = new vlo( allocator, len )
-#define VLO_DELETE(vlo) delete vlo
-#define VLO_LENGTH(vlo) (vlo)->length ()
-#define VLO_BEGIN(vlo) (vlo)->begin ()
-#define VLO_BOUND(vlo) (vlo)->bound ()
-#define VLO_ADD_MEMORY(vlo, addr, size) (vlo)->add_memory (addr, size)
-#define VLO_EXPAND(vlo, size) (vlo)->expand (size)
-#define VLO_SHORTEN(vlo, size) (vlo)->shorten (size)
-#define VLO_NULLIFY(vlo) (vlo)->nullify ()
-
-#define OS_CREATE( o, allocator, len ) ( o ) = new os( allocator, len )
-#define OS_EMPTY(os) (os)->empty ()
-#define OS_DELETE(os) delete os
-#define OS_TOP_BEGIN(os) (os)->top_begin ()
-#define OS_TOP_LENGTH(os) (os)->top_length ()
-#define OS_TOP_ADD_MEMORY(os, addr, size) (os)->top_add_memory (addr, size)
-#define OS_TOP_ADD_STRING(os, str) (os)->top_add_string (str)
-#define OS_TOP_ADD_BYTE(os, b) (os)->top_add_byte (b)
-#define OS_TOP_FINISH(os) (os)->top_finish ()
-#define OS_TOP_EXPAND(os, size) (os)->top_expand (size)
-#define OS_TOP_SHORTEN(os, size) (os)->top_shorten (size)
-#define OS_TOP_NULLIFY(os) (os)->top_nullify ()
-
-#define create_hash_table( allocator, size, hash, eq ) new hash_table( allocator, size, hash, eq )
+/* The VLOs and OSes are kept by value as in C.  They are placed into
+   the memory allocated for the structures containing them, so they
+   are created by placement new and freed by `destroy'. */
+#define VLO_CREATE( v, allocator, len ) new (&(v)) vlo( allocator, len )
+#define VLO_DELETE(vlo) (vlo).destroy ()
+#define VLO_LENGTH(vlo) (vlo).length ()
+#define VLO_BEGIN(vlo) (vlo).begin ()
+#define VLO_BOUND(vlo) (vlo).bound ()
+#define VLO_ADD_MEMORY(vlo, addr, size) (vlo).add_memory (addr, size)
+#define VLO_EXPAND(vlo, size) (vlo).expand (size)
+#define VLO_SHORTEN(vlo, size) (vlo).shorten (size)
+#define VLO_NULLIFY(vlo) (vlo).nullify ()
+
+#define OS_CREATE( o, allocator, len ) new (&(o)) os( allocator, len )
+#define OS_EMPTY(os) (os).empty ()
+#define OS_DELETE(os) (os).destroy ()
+#define OS_TOP_BEGIN(os) (os).top_begin ()
+#define OS_TOP_LENGTH(os) (os).top_length ()
+#define OS_TOP_ADD_MEMORY(os, addr, size) (os).top_add_memory (addr, size)
+#define OS_TOP_ADD_STRING(os, str) (os).top_add_string (str)
+#define OS_TOP_ADD_BYTE(os, b) (os).top_add_byte (b)
+#define OS_TOP_FINISH(os) (os).top_finish ()
+#define OS_TOP_EXPAND(os, size) (os).top_expand (size)
+#define OS_TOP_SHORTEN(os, size) (os).top_shorten (size)
+#define OS_TOP_NULLIFY(os) (os).top_nullify ()
+
+/* The hash table searches call the hash and equality functions of
+   the table directly, see class inline_hash_table. */
+#define create_hash_table( allocator, size, hash, eq ) new inline_hash_table< hash, eq >( allocator, size )
 #define empty_hash_table(tab) (tab)->empty ()
 #define delete_hash_table(tab) delete tab
 #define find_hash_table_entry(tab, el, res_p) (tab)->find_entry(el, res_p)
+#define lookup_hash_table_entry(tab, el) (tab)->lookup (el)
+#define traverse_hash_table(tab, func, arg) (tab)->traverse (func, arg)
+#define hash_table_size(tab) (tab)->size ()
 
 #ifdef YAEP_TEST
 /* Forward declarations: */
@@ -58,6 +66,13 @@ static void use_functions (int argc, char **argv);
 static void use_description (int argc, char **argv);
 #endif
 
+/* yaep.c is the main part of this translation unit, so its structures
+   can have the table fields whose types depend on its static hash and
+   equality functions. */
+#if defined (__GNUC__) && !defined (__clang__)
+#pragma GCC diagnostic ignored "-Wsubobject-linkage"
+#endif
+
 #include "yaep.c"
 
 yaep::yaep (void)
@@ -82,6 +97,12 @@ yaep::error_message (void)
   return yaep_error_message (this->grammar);
 }
 
+enum yaep_code_translation
+yaep::code_translation_strategy (void)
+{
+  return yaep_code_translation_strategy (this->grammar);
+}
+
 int
 yaep::read_grammar (int strict_p,
 		    const char *(*read_terminal) (int *code),
@@ -99,6 +120,18 @@ yaep::parse_grammar (int strict_p, const char *grammar_description)
   return yaep_parse_grammar (this->grammar, strict_p, grammar_description);
 }
 
+int
+yaep::save_compiled_grammar (const char *path)
+{
+  return yaep_save_compiled_grammar (this->grammar, path);
+}
+
+int
+yaep::load_compiled_grammar (const char *path)
+{
+  return yaep_load_compiled_grammar (this->grammar, path);
+}
+
 int
 yaep::set_lookahead_level (int level)
 {
@@ -135,6 +168,73 @@ yaep::set_recovery_match (int n_toks)
   return yaep_set_recovery_match (this->grammar, n_toks);
 }
 
+int
+yaep::set_leo_flag (int flag)
+{
+  return yaep_set_leo_flag (this->grammar, flag);
+}
+
+int
+yaep::set_recognition_flag (int flag)
+{
+  return yaep_set_recognition_flag (this->grammar, flag);
+}
+
+size_t
+yaep::set_parse_cache_limit (size_t limit)
+{
+  return yaep_set_parse_cache_limit (this->grammar, limit);
+}
+
+void
+yaep::flush_parse_cache (void)
+{
+  yaep_flush_parse_cache (this->grammar);
+}
+
+int
+yaep::set_shared_memo_flag (int flag)
+{
+  return yaep_set_shared_memo_flag (this->grammar, flag);
+}
+
+int
+yaep::set_lr0_automaton_flag (int flag)
+{
+  return yaep_set_lr0_automaton_flag (this->grammar, flag);
+}
+
+int
+yaep::freeze (void)
+{
+  return yaep_freeze_grammar (this->grammar);
+}
+
+void
+yaep::get_parse_stats (int total_p, struct yaep_parse_stats *stats)
+{
+  yaep_get_parse_stats (this->grammar, total_p, stats);
+}
+
+void
+yaep::reset_parse_stats (void)
+{
+  yaep_reset_parse_stats (this->grammar);
+}
+
+void
+yaep::set_tree_arena (tree_arena *arena)
+{
+  yaep_set_tree_arena (this->grammar,
+		       arena == NULL ? NULL : arena->yaep_tree_arena);
+}
+
+const struct yaep_tree_events *
+yaep::set_tree_events (const struct yaep_tree_events *events)
+{
+  return yaep_set_tree_events (this->grammar, events);
+}
+
 int
 yaep::parse (int (*read_token_fn) (void **attr),
 	     void (*syntax_error_fn) (int err_tok_num,
@@ -151,6 +251,37 @@ yaep::parse (int (*read_token_fn) (void **attr),
 		     parse_alloc_fn, parse_free_fn, root, ambiguous_p);
 }
 
+int
+yaep::parse_tokens (int n, const int *codes, void *const *attrs,
+		    void (*syntax_error_fn) (int err_tok_num,
+					     void *err_tok_attr,
+					     int start_ignored_tok_num,
+					     void *start_ignored_tok_attr,
+					     int start_recovered_tok_num,
+					     void *start_recovered_tok_attr),
+		    void *(*parse_alloc_fn) (int nmemb),
+		    void (*parse_free_fn) (void *mem),
+		    struct yaep_tree_node **root, int *ambiguous_p)
+{
+  return yaep_parse_tokens (this->grammar, n, codes, attrs, syntax_error_fn,
+			    parse_alloc_fn, parse_free_fn, root, ambiguous_p);
+}
+
+int
+yaep::parse_batch (struct yaep_batch_input *inputs, int n, int n_threads,
+		   void (*syntax_error_fn) (int err_tok_num,
+					    void *err_tok_attr,
+					    int start_ignored_tok_num,
+					    void *start_ignored_tok_attr,
+					    int start_recovered_tok_num,
+					    void *start_recovered_tok_attr),
+		   void *(*parse_alloc_fn) (int nmemb),
+		   void (*parse_free_fn) (void *mem))
+{
+  return yaep_parse_batch (this->grammar, inputs, n, n_threads,
+			   syntax_error_fn, parse_alloc_fn, parse_free_fn);
+}
+
 void
 yaep::free_tree (struct yaep_tree_node *root, void (*parse_free_fn) (void *),
 		 void (*termcb) (struct yaep_term * term))
@@ -158,6 +289,175 @@ yaep::free_tree (struct yaep_tree_node *root, void (*parse_free_fn) (void *),
   yaep_free_tree (root, parse_free_fn, termcb);
 }
 
+yaep::parser::parser (yaep &g)
+{
+  this->yaep_parser = yaep_create_parser (g.grammar);
+  if (this->yaep_parser == NULL)
+    throw std::bad_alloc ();
+}
+
+yaep::parser::~parser (void)
+{
+  yaep_free_parser (this->yaep_parser);
+}
+
+int
+yaep::parser::error_code (void)
+{
+  return yaep_parser_error_code (this->yaep_parser);
+}
+
+const char *
+yaep::parser::error_message (void)
+{
+  return yaep_parser_error_message (this->yaep_parser);
+}
+
+void
+yaep::parser::flush_cache (void)
+{
+  yaep_parser_flush_cache (this->yaep_parser);
+}
+
+void
+yaep::parser::get_parse_stats (int total_p, struct yaep_parse_stats *stats)
+{
+  yaep_parser_get_parse_stats (this->yaep_parser, total_p, stats);
+}
+
+void
+yaep::parser::reset_parse_stats (void)
+{
+  yaep_parser_reset_parse_stats (this->yaep_parser);
+}
+
+void
+yaep::parser::set_tree_arena (tree_arena *arena)
+{
+  yaep_parser_set_tree_arena (this->yaep_parser,
+			      arena == NULL ? NULL : arena->yaep_tree_arena);
+}
+
+const struct yaep_tree_events *
+yaep::parser::set_tree_events (const struct yaep_tree_events *events)
+{
+  return yaep_parser_set_tree_events (this->yaep_parser, events);
+}
+
+int
+yaep::parser::set_forest_flag (int flag)
+{
+  return yaep_parser_set_forest_flag (this->yaep_parser, flag);
+}
+
+struct yaep_tree_node *
+yaep::parser::expand_forest_node (struct yaep_tree_node *node)
+{
+  return yaep_parser_expand_forest_node (this->yaep_parser, node);
+}
+
+int
+yaep::parser::set_sppf_flag (int flag)
+{
+  return yaep_parser_set_sppf_flag (this->yaep_parser, flag);
+}
+
+struct yaep_sppf_node *
+yaep::parser::sppf_root (void)
+{
+  return yaep_parser_sppf_root (this->yaep_parser);
+}
+
+struct yaep_sppf_node *
+yaep::parser::sppf_first (void)
+{
+  return yaep_parser_sppf_first (this->yaep_parser);
+}
+
+struct yaep_sppf_node *
+yaep::parser::sppf_next (struct yaep_sppf_node *node)
+{
+  return yaep_parser_sppf_next (this->yaep_parser, node);
+}
+
+yaep::tree_arena::tree_arena (void)
+{
+  this->yaep_tree_arena = yaep_create_tree_arena ();
+  if (this->yaep_tree_arena == NULL)
+    throw std::bad_alloc ();
+}
+
+yaep::tree_arena::~tree_arena (void)
+{
+  yaep_free_tree_arena (this->yaep_tree_arena);
+}
+
+void
+yaep::tree_arena::reset (void)
+{
+  yaep_reset_tree_arena (this->yaep_tree_arena);
+}
+
+int
+yaep::parser::parse (int (*read_token_fn) (void **attr),
+		     void (*syntax_error_fn) (int err_tok_num,
+					      void *err_tok_attr,
+					      int start_ignored_tok_num,
+					      void *start_ignored_tok_attr,
+					      int start_recovered_tok_num,
+					      void *start_recovered_tok_attr),
+		     void *(*parse_alloc_fn) (int nmemb),
+		     void (*parse_free_fn) (void *mem),
+		     struct yaep_tree_node **root, int *ambiguous_p)
+{
+  return yaep_parser_parse (this->yaep_parser, read_token_fn,
+			    syntax_error_fn, parse_alloc_fn, parse_free_fn,
+			    root, ambiguous_p);
+}
+
+int
+yaep::parser::parse_tokens (int n, const int *codes, void *const *attrs,
+			    void (*syntax_error_fn) (int err_tok_num,
+						     void *err_tok_attr,
+						     int start_ignored_tok_num,
+						     void *start_ignored_tok_attr,
+						     int start_recovered_tok_num,
+						     void *start_recovered_tok_attr),
+			    void *(*parse_alloc_fn) (int nmemb),
+			    void (*parse_free_fn) (void *mem),
+			    struct yaep_tree_node **root, int *ambiguous_p)
+{
+  return yaep_parser_parse_tokens (this->yaep_parser, n, codes, attrs,
+				   syntax_error_fn, parse_alloc_fn,
+				   parse_free_fn, root, ambiguous_p);
+}
+
+int
+yaep::parser::begin (void (*syntax_error_fn) (int err_tok_num,
+					      void *err_tok_attr,
+					      int start_ignored_tok_num,
+					      void *start_ignored_tok_attr,
+					      int start_recovered_tok_num,
+					      void *start_recovered_tok_attr),
+		     void *(*parse_alloc_fn) (int nmemb),
+		     void (*parse_free_fn) (void *mem))
+{
+  return yaep_parse_begin (this->yaep_parser, syntax_error_fn,
+			   parse_alloc_fn, parse_free_fn);
+}
+
+int
+yaep::parser::feed (int n, const int *codes, void *const *attrs)
+{
+  return yaep_parse_feed (this->yaep_parser, n, codes, attrs);
+}
+
+int
+yaep::parser::end (struct yaep_tree_node **root, int *ambiguous_p)
+{
+  return yaep_parse_end (this->yaep_parser, root, ambiguous_p);
+}
+
 
 #ifdef YAEP_TEST
 
@@ -33,11 +33,45 @@
 #define __YAEP__
 
 #include <limits.h>
+#include <stddef.h>
 
 /* The following is a forward declaration of grammar formed by function
    yaep_read_grammar. */
 struct grammar;
 
+/* The following is a forward declaration of parser formed by function
+   yaep_create_parser.  The parser contains all data changed during
+   parsing. */
+struct yaep_parser;
+
+/* The following is a forward declaration of tree arena formed by
+   function yaep_create_tree_arena.  The arena contains memory of
+   parse trees. */
+struct yaep_tree_arena;
+
+/* The following structure contains callbacks called instead of
+   building the parse tree (see yaep_set_tree_events).  The callbacks
+   are called for nodes of the parse tree in the translation order:
+   ENTER_ANODE and LEAVE_ANODE before and after the children of an
+   abstract node with NAME and COST, TERM for a terminal node, NIL for
+   an empty node, and ERROR for an error node.  TOK_NUM is the number
+   of the token of a terminal node or of the first token of an
+   abstract node (it is the number of the next token if the abstract
+   node covers no tokens).  As for the attributes of the terminal nodes
+   of the built trees, the token numbers after an error recovery count
+   the error as one token and do not count the ignored tokens.  NAME
+   is valid only during the call.  DATA
+   is passed to all callbacks.  A null callback is not called. */
+struct yaep_tree_events
+{
+  void (*enter_anode) (void *data, const char *name, int cost, int tok_num);
+  void (*leave_anode) (void *data, const char *name, int cost);
+  void (*term) (void *data, int code, void *attr, int tok_num);
+  void (*nil) (void *data);
+  void (*error) (void *data);
+  void *data;
+};
+
 /* The following value is reserved to be designation of empty node for
    translation.  It should be positive number which is not intersected
    with symbol numbers. */
@@ -62,6 +96,30 @@ struct grammar;
 #define YAEP_NONTERM_DERIVATION            15
 #define YAEP_LOOP_NONTERM                  16
 #define YAEP_INVALID_TOKEN_CODE            17
+#define YAEP_FROZEN_GRAMMAR                18
+#define YAEP_COMPILED_GRAMMAR_IO_ERROR     19
+#define YAEP_BAD_COMPILED_GRAMMAR          20
+
+/* The following describes how token codes are translated into
+   terminals (see yaep_code_translation_strategy):
+
+   o YAEP_CODE_TRANSLATION_NONE -- the grammar has no terminals yet.
+   o YAEP_CODE_TRANSLATION_VECTOR -- the codes are indexes of a vector
+     (the codes span less than 10000 values).
+   o YAEP_CODE_TRANSLATION_PERFECT_HASH -- the codes are found by a
+     two-level perfect hash built when the grammar is read or loaded.
+     The lookup has constant time too but it is slower than the vector
+     one.
+   o YAEP_CODE_TRANSLATION_HASH_TABLE -- the codes are found by a
+     general hash table.  It is used only if the library is compiled
+     without the translation vector. */
+enum yaep_code_translation
+{
+  YAEP_CODE_TRANSLATION_NONE,
+  YAEP_CODE_TRANSLATION_VECTOR,
+  YAEP_CODE_TRANSLATION_PERFECT_HASH,
+  YAEP_CODE_TRANSLATION_HASH_TABLE
+};
 
 /* The following describes the type of parse tree node. */
 enum yaep_tree_node_type
@@ -71,6 +129,7 @@ enum yaep_tree_node_type
   YAEP_TERM,
   YAEP_ANODE,
   YAEP_ALT,
+  YAEP_LAZY,
   _yaep_VISITED = 0x80, /* _yaep_VISITED is not part of the interface and for internal use only */
   _yaep_MAX = 0xFF, /* _yaep_MAX is not part of the interface and is just here to ensure a logical OR of _yaep_VISITED with the other enum values does not produce an out-of-range enum */
 };
@@ -130,6 +189,14 @@ struct yaep_alt
   struct yaep_tree_node *next;
 };
 
+/* The following structure describes a node of a lazy forest which
+   has not been expanded yet (see yaep_parser_expand_forest_node). */
+struct yaep_lazy
+{
+  /* The forest data of the node. */
+  void *data;
+};
+
 /* The following structure describes generalized node of the parse
    tree. */
 struct yaep_tree_node
@@ -145,9 +212,131 @@ struct yaep_tree_node
     struct yaep_anode anode;
     struct _yaep_anode_name _anode_name; /* Internal use only */
     struct yaep_alt alt;
+    struct yaep_lazy lazy;
   } val;
 };
 
+/* The following enumeration describes all possible nodes of a shared
+   packed parse forest (see yaep_parser_set_sppf_flag). */
+enum yaep_sppf_node_type
+{
+  /* All derivations of a symbol from a part of the input. */
+  YAEP_SPPF_SYMBOL,
+  /* All derivations of the first symbols (at least two ones but not
+     all) of a rule from a part of the input. */
+  YAEP_SPPF_INTERMEDIATE,
+  /* One way to derive the parent from its part of the input. */
+  YAEP_SPPF_PACKED,
+};
+
+/* The following structure describes a node of a shared packed parse
+   forest. */
+struct yaep_sppf_node
+{
+  enum yaep_sppf_node_type type;
+  /* The order number of the node (see yaep_parser_sppf_first). */
+  int num;
+  /* The symbol name of a symbol node or the left hand side name of the
+     rule of other nodes. */
+  const char *name;
+  /* The code of a terminal symbol node.  It is -1 for nonterminals and
+     the special symbols `error' and `$eof'. */
+  int code;
+  /* The attribute of the token of a terminal symbol node (NULL for
+     other nodes). */
+  void *attr;
+  /* The rule of an intermediate or packed node and the number of its
+     symbols represented by the node.  The rules are numbered in the
+     order of the grammar description from 1.  Rule 0 is added rule
+     `$S : <start symbol> $eof'.  The values are -1 for symbol
+     nodes. */
+  int rule, pos;
+  /* The abstract node name of the rule of a packed node (NULL if there
+     is no one or for other nodes). */
+  const char *anode;
+  /* The node represents derivations from the part of input from token
+     START to token END (not including).  The tokens are counted as in
+     yaep_tree_events.  The values of a packed node are the ones of its
+     parent. */
+  int start, end;
+  /* The token number where the derivation of the last represented
+     symbol starts for a packed node (-1 for other nodes). */
+  int split;
+  /* The list of packed nodes of a nonterminal symbol node or an
+     intermediate node. */
+  struct yaep_sppf_node *packed;
+  /* The next packed node of the same parent. */
+  struct yaep_sppf_node *next;
+  /* The children of a packed node: the node for the represented rule
+     symbols except for the last one (NULL if it is the only one) and
+     the symbol node for the last symbol.  The both are NULL for an
+     empty rule. */
+  struct yaep_sppf_node *left, *right;
+};
+
+/* The following structure describes statistics of a parse (see
+   functions yaep_get_parse_stats and yaep_parser_get_parse_stats).
+   The sizes of the parse structures include the structures reused
+   from the previous parses (see yaep_set_parse_cache_limit).  In sums
+   of statistics for several parses all members are sums except for
+   the parse cache size which is the size after the last parse. */
+struct yaep_parse_stats
+{
+  /* Number of the parses, number of the parses of ambiguous input,
+     and number of the input tokens (without the end marker). */
+  long n_parses, n_ambiguous_parses, n_tokens;
+  /* Number of unique situations, number of terminal sets (lookaheads
+     and FIRST/FOLLOW sets) and their size in bytes. */
+  long n_sits, n_term_sets, term_sets_size;
+  /* Number of unique set cores and their start situations, number of
+     parent indexes of non start situations. */
+  long n_set_cores, n_set_core_start_sits, n_parent_indexes;
+  /* Number of unique vectors of set situation distances and their
+     length. */
+  long n_set_dists, n_set_dists_len;
+  /* Number of unique sets and their start situations. */
+  long n_sets, n_sets_start_sits;
+  /* Number of unique triples (set, terminal, lookahead) and number of
+     the sets found through them instead of forming them again (the
+     second number includes the sets formed by the previous parses). */
+  long n_set_term_lookaheads, n_goto_successes, n_goto_cache_hits;
+  /* Number of Leo items and their uses (see yaep_set_leo_flag). */
+  long n_leo_items, n_leo_uses;
+  /* Number of pairs (set core, symbol) and length of their
+     transition and reduce vectors. */
+  long n_core_symb_pairs, n_core_symb_vect_len;
+  /* Number of unique transition, transitive transition (only when
+     YAEP is built with TRANSITIVE_TRANSITION), and reduce vectors and
+     their lengths. */
+  long n_transition_vects, n_transition_vect_len;
+  long n_transitive_transition_vects, n_transitive_transition_vect_len;
+  long n_reduce_vects, n_reduce_vect_len;
+  /* Number of the parse tree nodes. */
+  long n_term_nodes, n_abstract_nodes, n_alt_nodes;
+  /* Number of hash table searches and collisions during the
+     parse. */
+  long n_tab_searches, n_tab_collisions;
+  /* Size of the parse cache in bytes after the parse. */
+  long parse_cache_size;
+};
+
+/* The following describes an input of yaep_parse_batch and the
+   result of its parse. */
+struct yaep_batch_input
+{
+  /* Number of the input tokens, their codes, and attributes (it can
+     be NULL if all attributes are NULL). */
+  int n_toks;
+  const int *codes;
+  void *const *attrs;
+  /* The following members are set up by yaep_parse_batch: the error
+     code of the parse (0 if the input was parsed successfully), the
+     parse tree, and the flag of ambiguous input. */
+  int error_code;
+  struct yaep_tree_node *root;
+  int ambiguous_p;
+};
+
 #ifndef __cplusplus
 
 /* The following function creates undefined grammar.  The function
@@ -163,6 +352,11 @@ extern int yaep_error_code (struct grammar *g);
    corresponding to the last occurred error code. */
 extern const char *yaep_error_message (struct grammar *g);
 
+/* The function returns how the parsers of grammar G translate token
+   codes into terminals. */
+extern enum yaep_code_translation
+yaep_code_translation_strategy (struct grammar *g);
+
 /* The following function reads terminals/rules into grammar G and
    checks it depending on STRICT_P.  It returns zero if it is all ok.
    Otherwise, the function returns error code occurred (its code will
@@ -209,6 +403,32 @@ extern int
 yaep_parse_grammar (struct grammar *g, int strict_p,
 		    const char *description);
 
+/* The following function saves grammar G read by yaep_read_grammar or
+   yaep_parse_grammar into compiled grammar file with name PATH.  The
+   file contains the checked grammar with precomputed data (FIRST and
+   FOLLOW sets, the terminal code translation vector etc).  The
+   function returns the error code (YAEP_COMPILED_GRAMMAR_IO_ERROR if
+   the file can not be written, YAEP_INCORRECT_TRANSLATION if a rule
+   translation contains more than 1024 nil translations). */
+extern int yaep_save_compiled_grammar (struct grammar *g, const char *path);
+
+/* The following function is analogous to yaep_read_grammar but it
+   loads grammar G from compiled grammar file PATH saved by
+   yaep_save_compiled_grammar.  It is much faster than reading the
+   grammar because the grammar is not checked and the precomputed data
+   are used right from the file mapped into memory (so processes
+   loading the same file share it).  The file should not be changed
+   while the grammar is used.  The file can be loaded only on a
+   machine with the same byte order and sizes of basic types.  The
+   function returns the error code (YAEP_COMPILED_GRAMMAR_IO_ERROR if
+   the file can not be read, YAEP_BAD_COMPILED_GRAMMAR if it is not a
+   compiled grammar file, has another format version, or is
+   corrupted).  The loader checks the file structure but trusts the
+   precomputed data: the file should be loaded only from a trusted
+   source because the wrong FIRST and FOLLOW sets or symbol flags
+   result in wrong parses. */
+extern int yaep_load_compiled_grammar (struct grammar *g, const char *path);
+
 /* The following functions set up different parameters which affect
    parser work.  The functions return the previous parameter value.
 
@@ -237,13 +457,86 @@ yaep_parse_grammar (struct grammar *g, int strict_p,
 
    o recovery_match means how much subsequent tokens should be
      successfully shifted to finish error recovery.  The default value
-     is 3. */
+     is 3.
+
+   o leo_flag means usage of Leo items (memoized deterministic
+     reduction paths).  With the flag, the Earley set at the end of a
+     right recursion contains only the topmost situation of the
+     recursion instead of one situation per nesting level, and the
+     parse tree builder restores the omitted situations.  It makes
+     parsing deep right recursions linear.  The parse trees are the
+     same.  The flag is ignored for the dynamic lookahead (level 2).
+     The default value is 0.
+
+   o recognition_flag means only recognition of the input.  The parse
+     functions build Earley's sets (calling the syntax error function
+     as usual) but do not build the parse tree: *root is a node of
+     type YAEP_NIL if the input was recognized (always so with error
+     recovery) and NULL otherwise, and *ambiguous_p is 0.  It makes
+     validation of inputs considerably faster and takes less memory.
+     The default value is 0. */
 extern int yaep_set_lookahead_level (struct grammar *grammar, int level);
 extern int yaep_set_debug_level (struct grammar *grammar, int level);
 extern int yaep_set_one_parse_flag (struct grammar *grammar, int flag);
 extern int yaep_set_cost_flag (struct grammar *grammar, int flag);
 extern int yaep_set_error_recovery_flag (struct grammar *grammar, int flag);
 extern int yaep_set_recovery_match (struct grammar *grammar, int n_toks);
+extern int yaep_set_leo_flag (struct grammar *grammar, int flag);
+extern int yaep_set_recognition_flag (struct grammar *grammar, int flag);
+
+/* The following function sets up maximal size (in bytes) of the parse
+   cache and returns the previous value.  The parse cache contains
+   situations, set cores, sets, goto sets and transition/reduce
+   vectors formed by previous parses of a parser (or of yaep_parse
+   for the grammar).  They depend only on the grammar, so the next
+   parse can reuse them instead of forming them again.  It
+   considerably speeds up parsing many short inputs.  The cache is
+   freed when its size after a parse exceeds the limit.  The default
+   value is 0 which means that the cache is not used.  */
+extern size_t yaep_set_parse_cache_limit (struct grammar *grammar,
+					  size_t limit);
+
+/* The following function frees the parse cache and the parse
+   workspace used by yaep_parse for the grammar. */
+extern void yaep_flush_parse_cache (struct grammar *grammar);
+
+/* The following function sets up the flag whose nonzero value means
+   that all parsers of the grammar after freezing it (including
+   yaep_parse and yaep_parse_batch in different threads) share set
+   cores, sets, goto sets and transition/reduce vectors through the
+   shared memo.  A parse publishes the objects formed by it into the
+   memo if it found new set cores, so the objects found by one parser
+   speed up all the others.  Parsers read the memo without locking.
+   The memo is kept until the grammar is freed.  The flag should be
+   set up before yaep_freeze_grammar and is ignored for the dynamic
+   lookahead (level 2).  The function returns the previous value.
+   The default value is 0.  */
+extern int yaep_set_shared_memo_flag (struct grammar *grammar, int flag);
+
+/* The following function sets up the flag whose nonzero value means
+   that yaep_freeze_grammar compiles the LR(0) automaton of the grammar
+   ahead of time.  The automaton states are set cores formed by
+   shifting from the start set core.  They are put into the shared
+   memo of the grammar, so parsers do not form them.  Only set cores
+   formed during parsing are published in the memo if the shared memo
+   flag is also set.  The flag should be set up before
+   yaep_freeze_grammar and is ignored for the dynamic lookahead (level
+   2).  The function returns the previous value.  The default value
+   is 0.  */
+extern int yaep_set_lr0_automaton_flag (struct grammar *grammar, int flag);
+
+/* The following function freezes the grammar read by
+   yaep_read_grammar or yaep_parse_grammar.  The frozen grammar is
+   never changed: the functions above do not change the parameters
+   and reading a new grammar results in error YAEP_FROZEN_GRAMMAR.
+   So any number of threads can parse according to the frozen grammar
+   simultaneously without locking, even with yaep_parse.  Errors for
+   the frozen grammar are reported only to the thread where they
+   occurred, i.e. yaep_error_code and yaep_error_message return the
+   last error of the current thread.  Without dynamic lookaheads, the
+   function also creates all situations with their lookaheads.  The
+   function returns the error code. */
+extern int yaep_freeze_grammar (struct grammar *grammar);
 
 /* The following function parses input according read grammar.  The
    function returns the error code (which will be also in
@@ -296,9 +589,160 @@ extern int yaep_parse (struct grammar *grammar,
 		       struct yaep_tree_node **root,
 		       int *ambiguous_p);
 
+/* The following function is analogous to yaep_parse but the input is
+   N tokens with CODES and attributes ATTRS (it can be NULL if all
+   attributes are NULL) instead of tokens read by a callback.  The
+   codes are translated into symbols by one pass and the attributes
+   are not copied, so the arrays should not be changed until the
+   parse is finished.  The end of the input is given by N, so unlike
+   the codes returned by READ_TOKEN a negative code is not the end of
+   the input but an invalid code (YAEP_INVALID_TOKEN_CODE). */
+extern int yaep_parse_tokens (struct grammar *grammar,
+			      int n, const int *codes, void *const *attrs,
+			      void (*syntax_error) (int err_tok_num,
+						    void *err_tok_attr,
+						    int start_ignored_tok_num,
+						    void *start_ignored_tok_attr,
+						    int start_recovered_tok_num,
+						    void *start_recovered_tok_attr),
+			      void *(*parse_alloc) (int nmemb),
+			      void (*parse_free) (void *mem),
+			      struct yaep_tree_node **root,
+			      int *ambiguous_p);
+
 /* The following function frees memory allocated for the grammar. */
 extern void yaep_free_grammar (struct grammar *grammar);
 
+/* The following function creates parser for GRAMMAR.  The function
+   returns NULL if there is no memory.  Function yaep_parse uses a
+   temporary parser and can not be called for the same grammar from
+   different threads simultaneously unless the grammar is frozen.
+   Different parsers can parse simultaneously according to the same
+   grammar (e.g. each thread can have own parser) as long as the
+   grammar itself is not changed.  The parsers should be freed before
+   the grammar. */
+extern struct yaep_parser *yaep_create_parser (struct grammar *grammar);
+
+/* The functions return the last occurred error code and the
+   corresponding error message for given parser. */
+extern int yaep_parser_error_code (struct yaep_parser *parser);
+extern const char *yaep_parser_error_message (struct yaep_parser *parser);
+
+/* The following function is analogous to yaep_parse but it uses
+   PARSER and records errors in PARSER instead of the grammar. */
+extern int yaep_parser_parse (struct yaep_parser *parser,
+			      int (*read_token) (void **attr),
+			      void (*syntax_error) (int err_tok_num,
+						    void *err_tok_attr,
+						    int start_ignored_tok_num,
+						    void *start_ignored_tok_attr,
+						    int start_recovered_tok_num,
+						    void *start_recovered_tok_attr),
+			      void *(*parse_alloc) (int nmemb),
+			      void (*parse_free) (void *mem),
+			      struct yaep_tree_node **root,
+			      int *ambiguous_p);
+
+/* The following function is analogous to yaep_parse_tokens but it
+   uses PARSER. */
+extern int yaep_parser_parse_tokens (struct yaep_parser *parser,
+				     int n, const int *codes,
+				     void *const *attrs,
+				     void (*syntax_error) (int err_tok_num,
+							   void *err_tok_attr,
+							   int start_ignored_tok_num,
+							   void *start_ignored_tok_attr,
+							   int start_recovered_tok_num,
+							   void *start_recovered_tok_attr),
+				     void *(*parse_alloc) (int nmemb),
+				     void (*parse_free) (void *mem),
+				     struct yaep_tree_node **root,
+				     int *ambiguous_p);
+
+/* The following functions are a push interface of PARSER analogous
+   to yaep_parser_parse.  Instead of reading tokens by a callback, the
+   parse is started by yaep_parse_begin, N tokens with CODES and
+   attributes ATTRS (it can be NULL) are added by each call of
+   yaep_parse_feed, and the parse is finished by yaep_parse_end which
+   returns the parse tree.  Earley's sets are formed during the feeds
+   as soon as the next token is known, so lexing can be interleaved
+   with parsing and a syntax error is reported by the first feed
+   containing the erroneous token and its successor if error recovery
+   is switched off.  Otherwise the syntax errors are reported by
+   yaep_parse_end because error recovery can look at any subsequent
+   token.  As for yaep_parse_tokens, a negative code is invalid.  The
+   functions return the error code.  If yaep_parse_feed returns an
+   error code, the parse is finished and yaep_parse_end
+   should not be called. */
+extern int yaep_parse_begin (struct yaep_parser *parser,
+			     void (*syntax_error) (int err_tok_num,
+						   void *err_tok_attr,
+						   int start_ignored_tok_num,
+						   void *start_ignored_tok_attr,
+						   int start_recovered_tok_num,
+						   void *start_recovered_tok_attr),
+			     void *(*parse_alloc) (int nmemb),
+			     void (*parse_free) (void *mem));
+extern int yaep_parse_feed (struct yaep_parser *parser, int n,
+			    const int *codes, void *const *attrs);
+extern int yaep_parse_end (struct yaep_parser *parser,
+			   struct yaep_tree_node **root, int *ambiguous_p);
+
+/* The following function frees the parse cache and the parse
+   workspace of the parser (see comments for function
+   yaep_set_parse_cache_limit). */
+extern void yaep_parser_flush_cache (struct yaep_parser *parser);
+
+/* The following function frees memory allocated for the parser. */
+extern void yaep_free_parser (struct yaep_parser *parser);
+
+/* The following function parses N INPUTS according to GRAMMAR in
+   N_THREADS threads (the number of online processors if N_THREADS is
+   not positive) and puts the error codes, parse trees, and ambiguity
+   flags into the inputs.  Each thread has own parser, so it keeps the
+   parse workspace and the parse cache between its inputs.  The inputs
+   are dealt to the threads starting with the largest ones, and a
+   thread which has parsed all its inputs steals inputs of other
+   threads.  SYNTAX_ERROR, PARSE_ALLOC, and PARSE_FREE are analogous
+   to ones of yaep_parse_tokens but they are called from different
+   threads simultaneously.  The tree arena of the grammar is not used.
+   The grammar should not be changed during the batch parse.  The
+   statistics of the grammar parses get the batch parses as one last
+   parse.  The function returns the error code which is not zero only
+   if the batch could not be parsed at all. */
+extern int yaep_parse_batch (struct grammar *grammar,
+			     struct yaep_batch_input *inputs, int n,
+			     int n_threads,
+			     void (*syntax_error) (int err_tok_num,
+						   void *err_tok_attr,
+						   int start_ignored_tok_num,
+						   void *start_ignored_tok_attr,
+						   int start_recovered_tok_num,
+						   void *start_recovered_tok_attr),
+			     void *(*parse_alloc) (int nmemb),
+			     void (*parse_free) (void *mem));
+
+/* The following function puts statistics of the last finished parse
+   into *STATS if TOTAL_P is zero.  Otherwise, it puts sums of the
+   statistics of all parses finished since the grammar creation or
+   yaep_reset_parse_stats.  The parses made by yaep_parse,
+   yaep_parse_tokens, and by all parsers of the grammar are counted.
+   The parsers can still work simultaneously as the grammar
+   statistics are updated under a lock.  The statistics are not
+   changed after freezing the grammar, use yaep_parser_get_parse_stats
+   for the frozen grammar.  The statistics are collected even if the
+   debug printing is switched off. */
+extern void yaep_get_parse_stats (struct grammar *g, int total_p,
+				  struct yaep_parse_stats *stats);
+extern void yaep_reset_parse_stats (struct grammar *g);
+
+/* The following functions are analogous to the previous ones but
+   work with statistics of the parses made by PARSER. */
+extern void yaep_parser_get_parse_stats (struct yaep_parser *parser,
+					 int total_p,
+					 struct yaep_parse_stats *stats);
+extern void yaep_parser_reset_parse_stats (struct yaep_parser *parser);
+
 /* The following function frees memory allocated for the parse tree.
    It must not be called until after yaep_free_grammar() has been called.
    ROOT must be the root of the parse tree as returned by yaep_parse().
@@ -313,6 +757,123 @@ extern void yaep_free_grammar (struct grammar *grammar);
    to free the term attributes. The term node itself must not be freed. */
 extern void yaep_free_tree( struct yaep_tree_node * root, void ( *parse_free )( void * ), void ( *termcb )( struct yaep_term * term ) );
 
+/* The following function creates an arena for parse trees.  If an
+   arena is set up for the parse (see yaep_set_tree_arena and
+   yaep_parser_set_tree_arena), all memory of the parse tree is taken
+   from big slabs of the arena and the PARSE_ALLOC and PARSE_FREE
+   arguments of the parse functions are ignored.  The trees should not
+   be freed by yaep_free_tree with a freeing function (a function doing
+   nothing can be used to call TERMCB for the terminals).  Instead, all
+   trees built in the arena are freed at once by yaep_reset_tree_arena
+   or yaep_free_tree_arena.  The function returns NULL if there is no
+   memory. */
+extern struct yaep_tree_arena *yaep_create_tree_arena (void);
+
+/* The following function frees all trees built in ARENA.  The arena
+   memory is kept for the next trees: the slabs are joined into one
+   slab, so the next trees of the same size are built without any
+   memory allocation. */
+extern void yaep_reset_tree_arena (struct yaep_tree_arena *arena);
+
+/* The following function frees ARENA and all trees built in it. */
+extern void yaep_free_tree_arena (struct yaep_tree_arena *arena);
+
+/* The following function sets up ARENA (it can be NULL) for trees
+   built by yaep_parse and yaep_parse_tokens for GRAMMAR and returns
+   the previous arena.  The arena of a frozen grammar is not changed
+   as an arena can not be used by several threads simultaneously. */
+extern struct yaep_tree_arena *yaep_set_tree_arena (struct grammar *grammar,
+						    struct yaep_tree_arena
+						    *arena);
+
+/* The following function is analogous to the previous one but sets
+   up ARENA for trees built by PARSER. */
+extern struct yaep_tree_arena
+  *yaep_parser_set_tree_arena (struct yaep_parser *parser,
+			       struct yaep_tree_arena *arena);
+
+/* The following function sets up EVENTS (it can be NULL) for
+   yaep_parse and yaep_parse_tokens of GRAMMAR and returns the
+   previous events.  If EVENTS is not NULL, the parse functions build
+   no parse tree.  Instead, the callbacks of EVENTS are called for
+   nodes of one parse tree (even if the one parse flag is zero) before
+   the functions return.  The tree with the minimal cost is not
+   searched.  The ambiguity is still reported.  If the input was
+   recognized, *ROOT is a node of type YAEP_NIL allocated by
+   PARSE_ALLOC.  The events of a frozen grammar are not changed.
+   EVENTS should live while they are set up. */
+extern const struct yaep_tree_events
+  *yaep_set_tree_events (struct grammar *grammar,
+			 const struct yaep_tree_events *events);
+
+/* The following function is analogous to the previous one but sets
+   up EVENTS for parses of PARSER. */
+extern const struct yaep_tree_events
+  *yaep_parser_set_tree_events (struct yaep_parser *parser,
+				const struct yaep_tree_events *events);
+
+/* The following function sets up FLAG of building lazy forests by
+   PARSER and returns the previous flag value.  If the flag is set up,
+   the parse functions of PARSER return in *ROOT the root of a forest
+   of all parses whose nodes are formed only when the caller expands
+   them.  An unexpanded node has type YAEP_LAZY.  The Earley's sets of
+   the parse are kept for the forest until the next parse by PARSER,
+   yaep_parser_flush_cache, or yaep_free_parser, and all forest nodes
+   are freed then.  The forest nodes should not be freed by
+   yaep_free_tree, PARSE_ALLOC and PARSE_FREE are not used.  The
+   attributes of the tokens given to the parse should live while the
+   forest is expanded.  *AMBIGUOUS_P is not set up as the forest is not
+   traversed by the parse.  Leo items are not used for the forest.  The
+   abstract node costs are the costs of the nodes themselves. */
+extern int yaep_parser_set_forest_flag (struct yaep_parser *parser,
+					int flag);
+
+/* The following function expands NODE of the last forest built by
+   PARSER if it has type YAEP_LAZY and returns NODE.  The node is
+   changed in place into the translation (a node of type YAEP_NIL,
+   YAEP_ERROR, YAEP_TERM, or YAEP_ANODE) or, if there are several
+   translations, into the first element of the list of their
+   alternatives (type YAEP_ALT).  The children of the abstract nodes
+   and the nodes of the alternatives can be of type YAEP_LAZY.  Equal
+   parts of the forest are expanded only once, so the forest is a
+   graph. */
+extern struct yaep_tree_node
+  *yaep_parser_expand_forest_node (struct yaep_parser *parser,
+				   struct yaep_tree_node *node);
+
+/* The following function sets up FLAG of building shared packed parse
+   forests (SPPF) by PARSER and returns the previous flag value.  If
+   the flag is set up, the parse functions of PARSER build the SPPF of
+   all parses instead of the parse tree and return in *ROOT a node of
+   type YAEP_NIL (allocated by PARSE_ALLOC) if the input is recognized.
+   *AMBIGUOUS_P is set up if the input has several parses.  The SPPF
+   is formed as in Scott's construction, so its size is at most cubic
+   in the input length for any grammar.  The SPPF lives until the next
+   parse by PARSER, yaep_parser_flush_cache, or yaep_free_parser.  The
+   flag has priority over the forest flag.  Leo items are not used for
+   the SPPF. */
+extern int yaep_parser_set_sppf_flag (struct yaep_parser *parser, int flag);
+
+/* The following function returns the root of the SPPF of the last
+   parse by PARSER (a symbol node of `$S' for the whole input with the
+   end marker) or NULL if there is no SPPF. */
+extern struct yaep_sppf_node *yaep_parser_sppf_root (struct yaep_parser
+						     *parser);
+
+/* The following functions iterate over all nodes of the SPPF of the
+   last parse by PARSER.  The first function returns the first node
+   (or NULL if there is no SPPF) and the second one the node after
+   NODE (or NULL if NODE is the root).  The nodes are visited in the
+   order of their numbers from 0, children before their parents, so
+   the root is visited last and its number plus one is the number of
+   the nodes. */
+extern struct yaep_sppf_node *yaep_parser_sppf_first (struct yaep_parser
+						      *parser);
+extern struct yaep_sppf_node *yaep_parser_sppf_next (struct yaep_parser
+						     *parser,
+						     struct yaep_sppf_node
+						     *node);
+
 #else /* #ifndef __cplusplus */
 
 class yaep
@@ -335,6 +896,9 @@ public:
   /* See comments for function yaep_error_message. */
   const char *error_message (void);
 
+  /* See comments for function yaep_code_translation_strategy. */
+  enum yaep_code_translation code_translation_strategy (void);
+
   /* See comments for function yaep_read_grammar. */
   int read_grammar (int strict_p,
 			   const char *(*read_terminal) (int *code),
@@ -346,6 +910,11 @@ public:
   /* See comments for function yaep_parse_grammar. */
   int parse_grammar (int strict_p, const char *grammar_description);
 
+  /* See comments for functions yaep_save_compiled_grammar and
+     yaep_load_compiled_grammar. */
+  int save_compiled_grammar (const char *path);
+  int load_compiled_grammar (const char *path);
+
   /* See comments for corresponding C functions. */
   int set_lookahead_level (int level);
   int set_debug_level (int level);
@@ -353,6 +922,26 @@ public:
   int set_cost_flag (int flag);
   int set_error_recovery_flag (int flag);
   int set_recovery_match (int n_toks);
+  int set_leo_flag (int flag);
+  int set_recognition_flag (int flag);
+
+  /* See comments for corresponding C functions. */
+  size_t set_parse_cache_limit (size_t limit);
+  void flush_parse_cache (void);
+
+  /* See comments for function yaep_set_shared_memo_flag. */
+  int set_shared_memo_flag (int flag);
+
+  /* See comments for function yaep_set_lr0_automaton_flag. */
+  int set_lr0_automaton_flag (int flag);
+
+  /* See comments for function yaep_freeze_grammar. */
+  int freeze (void);
+
+  /* See comments for functions yaep_get_parse_stats and
+     yaep_reset_parse_stats. */
+  void get_parse_stats (int total_p, struct yaep_parse_stats *stats);
+  void reset_parse_stats (void);
 
   /* See comments for function yaep_parse. */
   int parse (int (*read_token_fn) (void **attr),
@@ -367,11 +956,150 @@ public:
 	     struct yaep_tree_node **root,
 	     int *ambiguous_p);
 
+  /* See comments for function yaep_parse_tokens. */
+  int parse_tokens (int n, const int *codes, void *const *attrs,
+		    void (*syntax_error_fn) (int err_tok_num,
+					     void *err_tok_attr,
+					     int start_ignored_tok_num,
+					     void *start_ignored_tok_attr,
+					     int start_recovered_tok_num,
+					     void *start_recovered_tok_attr),
+		    void *(*parse_alloc_fn) (int nmemb),
+		    void (*parse_free_fn) (void *mem),
+		    struct yaep_tree_node **root,
+		    int *ambiguous_p);
+
+  /* See comments for function yaep_parse_batch. */
+  int parse_batch (struct yaep_batch_input *inputs, int n, int n_threads,
+		   void (*syntax_error_fn) (int err_tok_num,
+					    void *err_tok_attr,
+					    int start_ignored_tok_num,
+					    void *start_ignored_tok_attr,
+					    int start_recovered_tok_num,
+					    void *start_recovered_tok_attr),
+		   void *(*parse_alloc_fn) (int nmemb),
+		   void (*parse_free_fn) (void *mem));
+
   /* See comments for function yaep_free_tree().
      This is a static member function because the lifetime of the
      parse tree exceeds the lifetime of the yaep instance it
      came from. */
   static void free_tree( struct yaep_tree_node * root, void ( *parse_free_fn )( void * ), void ( *termcb )( struct yaep_term * term ) );
+
+  class tree_arena;
+
+  /* See comments for function yaep_set_tree_arena. */
+  void set_tree_arena (tree_arena *arena);
+
+  /* See comments for function yaep_set_tree_events. */
+  const struct yaep_tree_events *
+    set_tree_events (const struct yaep_tree_events *events);
+
+  /* The following class is a parser for the grammar (see comments
+     for function yaep_create_parser).  Different parsers of the same
+     grammar can be used in different threads simultaneously. */
+  class parser
+  {
+    struct yaep_parser *yaep_parser;
+  public:
+    /* The constructor and destructor allocate and free memory for the
+       parser.  The grammar should live longer than the parser. */
+    parser (yaep &g);
+    ~parser (void);
+
+    /* See comments for function yaep_parser_error_code. */
+    int error_code (void);
+
+    /* See comments for function yaep_parser_error_message. */
+    const char *error_message (void);
+
+    /* See comments for function yaep_parser_flush_cache. */
+    void flush_cache (void);
+
+    /* See comments for functions yaep_parser_get_parse_stats and
+       yaep_parser_reset_parse_stats. */
+    void get_parse_stats (int total_p, struct yaep_parse_stats *stats);
+    void reset_parse_stats (void);
+
+    /* See comments for function yaep_parser_parse. */
+    int parse (int (*read_token_fn) (void **attr),
+	       void (*syntax_error_fn) (int err_tok_num,
+					void *err_tok_attr,
+					int start_ignored_tok_num,
+					void *start_ignored_tok_attr,
+					int start_recovered_tok_num,
+					void *start_recovered_tok_attr),
+	       void *(*parse_alloc_fn) (int nmemb),
+	       void (*parse_free_fn) (void *mem),
+	       struct yaep_tree_node **root,
+	       int *ambiguous_p);
+
+    /* See comments for function yaep_parser_parse_tokens. */
+    int parse_tokens (int n, const int *codes, void *const *attrs,
+		      void (*syntax_error_fn) (int err_tok_num,
+					       void *err_tok_attr,
+					       int start_ignored_tok_num,
+					       void *start_ignored_tok_attr,
+					       int start_recovered_tok_num,
+					       void *start_recovered_tok_attr),
+		      void *(*parse_alloc_fn) (int nmemb),
+		      void (*parse_free_fn) (void *mem),
+		      struct yaep_tree_node **root,
+		      int *ambiguous_p);
+
+    /* See comments for functions yaep_parse_begin, yaep_parse_feed,
+       and yaep_parse_end. */
+    int begin (void (*syntax_error_fn) (int err_tok_num,
+					void *err_tok_attr,
+					int start_ignored_tok_num,
+					void *start_ignored_tok_attr,
+					int start_recovered_tok_num,
+					void *start_recovered_tok_attr),
+	       void *(*parse_alloc_fn) (int nmemb),
+	       void (*parse_free_fn) (void *mem));
+    int feed (int n, const int *codes, void *const *attrs);
+    int end (struct yaep_tree_node **root, int *ambiguous_p);
+
+    /* See comments for function yaep_parser_set_tree_arena. */
+    void set_tree_arena (tree_arena *arena);
+
+    /* See comments for function yaep_parser_set_tree_events. */
+    const struct yaep_tree_events *
+      set_tree_events (const struct yaep_tree_events *events);
+
+    /* See comments for function yaep_parser_set_forest_flag. */
+    int set_forest_flag (int flag);
+
+    /* See comments for function yaep_parser_expand_forest_node. */
+    struct yaep_tree_node *expand_forest_node (struct yaep_tree_node *node);
+
+    /* See comments for function yaep_parser_set_sppf_flag. */
+    int set_sppf_flag (int flag);
+
+    /* See comments for functions yaep_parser_sppf_root,
+       yaep_parser_sppf_first, and yaep_parser_sppf_next. */
+    struct yaep_sppf_node *sppf_root (void);
+    struct yaep_sppf_node *sppf_first (void);
+    struct yaep_sppf_node *sppf_next (struct yaep_sppf_node *node);
+  };
+
+  /* The following class is an arena for parse trees (see comments for
+     function yaep_create_tree_arena).  The arena should live longer
+     than the grammars and parsers using it. */
+  class tree_arena
+  {
+    struct yaep_tree_arena *yaep_tree_arena;
+    friend class yaep;
+    friend class parser;
+  public:
+    /* The constructor and destructor allocate and free memory for the
+       arena and its trees. */
+    tree_arena (void);
+    ~tree_arena (void);
+
+    /* See comments for function yaep_reset_tree_arena. */
+    void reset (void);
+  };
 };
 
 #endif /* #ifndef __cplusplus */
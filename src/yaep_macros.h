@@ -34,4 +34,17 @@
   #define YAEP_REINTERPRET_CAST(type, expr) ((type)(expr))
 #endif
 
+/* Storage class for data private to each thread */
+#if defined(__cplusplus)
+  #define YAEP_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L)
+  #define YAEP_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) || defined(__clang__)
+  #define YAEP_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+  #define YAEP_THREAD_LOCAL __declspec(thread)
+#else
+  #error "Thread-local storage not supported on this compiler"
+#endif
+
 #endif /* YAEP_MACROS_H */
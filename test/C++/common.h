@@ -30,6 +30,7 @@
 #include<cassert>
 #include<cstdio>
 #include<cstdlib>
+#include<cstring>
 
 #include"yaep.h"
 
@@ -112,6 +113,103 @@ test_read_token (void **attr)
 # define YAEP_TEST_UNUSED
 #endif
 
+/* Print MESSAGE and exit with failure. */
+static YAEP_TEST_UNUSED void
+test_fail (const char *message)
+{
+  fprintf (stderr, "%s\n", message);
+  exit (1);
+}
+
+/* Ignore syntax error. */
+static YAEP_TEST_UNUSED void
+test_silent_syntax_error (int err_tok_num, void *err_tok_attr,
+			  int start_ignored_tok_num,
+			  void *start_ignored_tok_attr,
+			  int start_recovered_tok_num,
+			  void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+}
+
+/* Read grammar of E from DESCRIPTION.  Exit with the error message if
+   it is wrong. */
+static YAEP_TEST_UNUSED void
+test_parse_grammar (yaep *e, const char *description)
+{
+  if (e->parse_grammar (1, description) != 0)
+    test_fail (e->error_message ());
+}
+
+/* The following flags of test_tree_eq say to compare the terminal
+   attributes too, to check that the terminal attributes of the second
+   tree are NULL, to compare the abstract node costs too, and to
+   ignore the terminal codes. */
+#define TEST_TREE_ATTRS 1
+#define TEST_TREE_NULL_ATTRS 2
+#define TEST_TREE_COSTS 4
+#define TEST_TREE_NO_CODES 8
+
+/* Return true if trees with roots N1 and N2 are the same according
+   to FLAGS.  The first children and the next alternatives are
+   processed iteratively as the trees can be deep. */
+static YAEP_TEST_UNUSED bool
+test_tree_eq (struct yaep_tree_node *n1, struct yaep_tree_node *n2,
+	      int flags)
+{
+  int i;
+
+  for (;;)
+    {
+      if (n1 == NULL || n2 == NULL)
+	return n1 == n2;
+      if (n1->type != n2->type)
+	return false;
+      switch (n1->type)
+	{
+	case YAEP_TERM:
+	  if (!(flags & TEST_TREE_NO_CODES)
+	      && n1->val.term.code != n2->val.term.code)
+	    return false;
+	  if (flags & TEST_TREE_NULL_ATTRS)
+	    return n2->val.term.attr == NULL;
+	  return (!(flags & TEST_TREE_ATTRS)
+		  || n1->val.term.attr == n2->val.term.attr);
+	case YAEP_ALT:
+	  if (!test_tree_eq (n1->val.alt.node, n2->val.alt.node, flags))
+	    return false;
+	  n1 = n1->val.alt.next;
+	  n2 = n2->val.alt.next;
+	  break;
+	case YAEP_ANODE:
+	  if (strcmp (n1->val.anode.name, n2->val.anode.name) != 0
+	      || ((flags & TEST_TREE_COSTS)
+		  && n1->val.anode.cost != n2->val.anode.cost))
+	    return false;
+	  if (n1->val.anode.children[0] == NULL
+	      || n2->val.anode.children[0] == NULL)
+	    return n1->val.anode.children[0] == n2->val.anode.children[0];
+	  for (i = 1; n1->val.anode.children[i] != NULL; i++)
+	    if (n2->val.anode.children[i] == NULL
+		|| !test_tree_eq (n1->val.anode.children[i],
+				  n2->val.anode.children[i], flags))
+	      return false;
+	  if (n2->val.anode.children[i] != NULL)
+	    return false;
+	  n1 = n1->val.anode.children[0];
+	  n2 = n2->val.anode.children[0];
+	  break;
+	default:
+	  return true;
+	}
+    }
+}
+
 static YAEP_TEST_UNUSED void
 test_standard_parse (const char *input, const char *description)
 {
@@ -216,4 +314,52 @@ test_complex_parse
   delete e;
 }
 
+/* Grammars whose nonterminals derive the empty string in several
+   ways.  Each rule has its own abstract node translating all its
+   symbols, so each derivation is a different tree. */
+static const char *test_nullable_descs[] YAEP_TEST_UNUSED = {
+  "TERM;\n"
+  "A : 'c' 'a'         # ca 1 (0 1)\n"
+  "  | B B             # bb1 2 (0 1)\n"
+  "  | B B             # bb2 3 (0 1)\n"
+  "  ;\n"
+  "B : A 'c'           # ac 1 (0 1)\n"
+  "  |                 # b0 1\n"
+  "  ;\n",
+  "TERM;\n"
+  "A : 'a'             # a1 1 (0)\n"
+  "  |                 # a0 2\n"
+  "  | 'a' B           # ab 1 (0 1)\n"
+  "  ;\n"
+  "B : D 'b' 'b'       # dbb 1 (0 1 2)\n"
+  "  | A C             # ac 1 (0 1)\n"
+  "  ;\n"
+  "C :                 # c0 1\n"
+  "  |                 # c1 2\n"
+  "  | 'c' A C         # cac 1 (0 1 2)\n"
+  "  ;\n"
+  "D : C               # dc 1 (0)\n"
+  "  | 'a' 'b'         # dab 1 (0 1)\n"
+  "  | 'b'             # db 1 (0)\n"
+  "  ;\n",
+};
+
+/* Inputs of the grammars above with the numbers of their derivations
+   and the minimal costs of the derivations. */
+static const struct
+{
+  int desc;
+  const char *input;
+  long n_derivs;
+  int min_cost;
+} test_nullable_inputs[] YAEP_TEST_UNUSED = {
+  {0, "c", 8, 8}, {0, "cc", 40, 12}, {0, "cac", 4, 5}, {0, "ccc", 224, 16},
+  {1, "a", 3, 1}, {1, "aa", 6, 4}, {1, "abb", 2, 4}, {1, "aca", 6, 7},
+  {1, "aabb", 4, 7},
+};
+
+#define TEST_N_NULLABLE_INPUTS					\
+  static_cast<int> (sizeof (test_nullable_inputs)		\
+		    / sizeof (test_nullable_inputs[0]))
+
 #endif
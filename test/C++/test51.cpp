@@ -0,0 +1,152 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Parsing in several threads simultaneously with one frozen grammar
+   by yaep::parse. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include"common.h"
+
+#define N_THREADS 4
+#define N_PARSES  100
+
+static const char *input = "a+a*(a*a+a)*(a+a)";
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static yaep *e;
+static struct yaep_tree_node *reference_root;
+
+/* The current token of the thread. */
+static thread_local int thread_ntok;
+
+static int
+thread_read_token (void **attr)
+{
+  *attr = NULL;
+  if (input [thread_ntok])
+    return input [thread_ntok++];
+  return -1;
+}
+
+/* Parse the input several times.  Put error message into *RESULT if
+   something is wrong. */
+static void
+parse_thread (const char **result)
+{
+  struct yaep_tree_node *root;
+  int ambiguous_p;
+
+  *result = NULL;
+  for (int i = 0; i < N_PARSES; i++)
+    {
+      thread_ntok = 0;
+      if (e->parse (thread_read_token, test_syntax_error,
+		    test_parse_alloc, test_parse_free,
+		    &root, &ambiguous_p) != 0)
+	{
+	  *result = e->error_message ();
+	  return;
+	}
+      if (!test_tree_eq (root, reference_root, 0))
+	{
+	  *result = "different parse trees";
+	  return;
+	}
+      yaep::free_tree (root, test_parse_free, NULL);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  std::thread threads[N_THREADS];
+  const char *results[N_THREADS];
+  int i, ambiguous_p;
+  bool ok = true;
+
+  e = new yaep ();
+  if (argc > 1)
+    e->set_lookahead_level (atoi (argv [1]));
+  test_parse_grammar (e, description);
+  thread_ntok = 0;
+  if (e->parse (thread_read_token, test_syntax_error, test_parse_alloc,
+		test_parse_free, &reference_root, &ambiguous_p))
+    {
+      fprintf (stderr, "yaep parse: %s\n", e->error_message ());
+      exit (1);
+    }
+  if (e->freeze () != 0)
+    {
+      fprintf (stderr, "yaep::freeze: %s\n", e->error_message ());
+      exit (1);
+    }
+  if (e->parse_grammar (1, description) != YAEP_FROZEN_GRAMMAR
+      || e->error_code () != YAEP_FROZEN_GRAMMAR)
+    {
+      fprintf (stderr, "frozen grammar is changed\n");
+      exit (1);
+    }
+  e->set_one_parse_flag (0);
+  if (e->set_one_parse_flag (0) != 1)
+    {
+      fprintf (stderr, "parameter of frozen grammar is changed\n");
+      exit (1);
+    }
+  for (i = 0; i < N_THREADS; i++)
+    threads[i] = std::thread (parse_thread, &results[i]);
+  for (i = 0; i < N_THREADS; i++)
+    {
+      threads[i].join ();
+      if (results[i] != NULL)
+	{
+	  fprintf (stderr, "thread %d: %s\n", i, results[i]);
+	  ok = false;
+	}
+    }
+  yaep::free_tree (reference_root, test_parse_free, NULL);
+  delete e;
+  if (!ok)
+    exit (1);
+  fprintf (stderr, "frozen grammar, %d threads: all parses are the same\n", N_THREADS);
+  exit (0);
+}
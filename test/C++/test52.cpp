@@ -0,0 +1,184 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Parsing several inputs many times with the parse cache and
+   comparing the results with ones without the cache. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+#define N_PARSES 20
+
+static const char *inputs[] =
+  {
+    "a+a*(a*a+a)*(a+a)",
+    "a*a",
+    "(a+a",
+    "a+a*a+a",
+    "a++a*(a+a)",
+    "((a))*a+a",
+  };
+
+#define N_INPUTS (static_cast<int> (sizeof (inputs) / sizeof (inputs[0])))
+
+static const char *description;
+static const char *curr_input;
+static int ntok, n_errors;
+
+static int
+read_token (void **attr)
+{
+  *attr = NULL;
+  if (curr_input [ntok])
+    return curr_input [ntok++];
+  return -1;
+}
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  n_errors++;
+}
+
+static yaep *
+create_grammar (int lookahead_level, size_t cache_limit)
+{
+  yaep *e = new yaep ();
+
+  e->set_lookahead_level (lookahead_level);
+  e->set_parse_cache_limit (cache_limit);
+  test_parse_grammar (e, description);
+  return e;
+}
+
+/* Parse input I by E (or PARSER if it is not NULL) and return the
+   tree.  Put number of syntax errors into *N_ERRS. */
+static struct yaep_tree_node *
+parse (yaep *e, yaep::parser *parser, int i, int *n_errs)
+{
+  struct yaep_tree_node *root;
+  int ambiguous_p, code;
+
+  curr_input = inputs[i];
+  ntok = n_errors = 0;
+  if (parser == NULL)
+    code = e->parse (read_token, count_syntax_error, test_parse_alloc,
+		     test_parse_free, &root, &ambiguous_p);
+  else
+    code = parser->parse (read_token, count_syntax_error, test_parse_alloc,
+			  test_parse_free, &root, &ambiguous_p);
+  if (code != 0)
+    {
+      fprintf (stderr, "yaep parse: %s\n",
+	       parser == NULL ? e->error_message () : parser->error_message ());
+      exit (1);
+    }
+  *n_errs = n_errors;
+  return root;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct yaep_tree_node *reference_roots[N_INPUTS], *root;
+  int reference_n_errors[N_INPUTS];
+  int i, n, n_errs, level = argc > 1 ? atoi (argv [1]) : 1;
+
+  description =
+    "\n"
+    "TERM;\n"
+    "E : T         # 0\n"
+    "  | E '+' T   # plus (0 2)\n"
+    "  ;\n"
+    "T : F         # 0\n"
+    "  | T '*' F   # mult (0 2)\n"
+    "  ;\n"
+    "F : 'a'       # 0\n"
+    "  | '(' E ')' # 1\n"
+    "  | error     # 0\n"
+    "  ;\n";
+  yaep *e = create_grammar (level, 0);
+  yaep *cached_e = create_grammar (level, 1 << 20);
+  yaep *small_cached_e = create_grammar (level, 1);
+  yaep::parser *parser = new yaep::parser (*cached_e);
+  for (i = 0; i < N_INPUTS; i++)
+    reference_roots[i] = parse (e, NULL, i, &reference_n_errors[i]);
+  for (n = 0; n < N_PARSES; n++)
+    {
+      if (n == N_PARSES / 2)
+	{
+	  cached_e->flush_parse_cache ();
+	  parser->flush_cache ();
+	}
+      for (i = 0; i < N_INPUTS; i++)
+	{
+	  root = parse (cached_e, NULL, i, &n_errs);
+	  if (!test_tree_eq (root, reference_roots[i], 0)
+	      || n_errs != reference_n_errors[i])
+	    {
+	      fprintf (stderr, "different parse of `%s'\n", inputs[i]);
+	      exit (1);
+	    }
+	  yaep::free_tree (root, test_parse_free, NULL);
+	  root = parse (cached_e, parser, i, &n_errs);
+	  if (!test_tree_eq (root, reference_roots[i], 0)
+	      || n_errs != reference_n_errors[i])
+	    {
+	      fprintf (stderr, "different parser parse of `%s'\n", inputs[i]);
+	      exit (1);
+	    }
+	  yaep::free_tree (root, test_parse_free, NULL);
+	  root = parse (small_cached_e, NULL, i, &n_errs);
+	  if (!test_tree_eq (root, reference_roots[i], 0)
+	      || n_errs != reference_n_errors[i])
+	    {
+	      fprintf (stderr, "different parse of `%s' with small cache\n",
+		       inputs[i]);
+	      exit (1);
+	    }
+	  yaep::free_tree (root, test_parse_free, NULL);
+	}
+    }
+  for (i = 0; i < N_INPUTS; i++)
+    yaep::free_tree (reference_roots[i], test_parse_free, NULL);
+  delete parser;
+  delete small_cached_e;
+  delete cached_e;
+  delete e;
+  fprintf (stderr, "all parses with the parse cache are the same\n");
+  exit (0);
+}
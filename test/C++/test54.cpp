@@ -0,0 +1,210 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Parsing inputs given by token arrays and comparing the results
+   with ones of parsing tokens read by a callback. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+static const char *inputs[] =
+  {
+    "a+a*(a*a+a)*(a+a)",
+    "a*a",
+    "(a+a",
+    "a++a*(a+a)",
+    "a)a+a+a+a+a",
+    "",
+  };
+
+#define N_INPUTS (static_cast<int> (sizeof (inputs) / sizeof (inputs[0])))
+
+static const char *description;
+
+static char curr_input[100];
+static int ntok, n_errors;
+
+static int
+read_token (void **attr)
+{
+  *attr = &curr_input [ntok];
+  if (curr_input [ntok])
+    return curr_input [ntok++];
+  return -1;
+}
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  n_errors++;
+}
+
+/* Check parses of token arrays by a grammar with description
+   DESCR. */
+static void
+check (int lookahead_level, const char *descr)
+{
+  yaep *e = new yaep ();
+  struct yaep_tree_node *reference_root, *root;
+  int codes[100];
+  void *attrs[100];
+  int reference_n_errors, ambiguous_p, i, k, len;
+  bool null_attrs_p;
+
+  e->set_lookahead_level (lookahead_level);
+  test_parse_grammar (e, descr);
+  yaep::parser *parser = new yaep::parser (*e);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      strcpy (curr_input, inputs[i]);
+      ntok = n_errors = 0;
+      if (e->parse (read_token, count_syntax_error, test_parse_alloc,
+		    test_parse_free, &reference_root, &ambiguous_p) != 0)
+	{
+	  fprintf (stderr, "parse: %s\n", e->error_message ());
+	  exit (1);
+	}
+      reference_n_errors = n_errors;
+      len = static_cast<int> (strlen (curr_input));
+      for (k = 0; k < len; k++)
+	{
+	  codes[k] = curr_input[k];
+	  attrs[k] = &curr_input[k];
+	}
+      for (k = 0; k < 4; k++)
+	{
+	  n_errors = 0;
+	  null_attrs_p = k % 2 != 0;
+	  if ((k < 2
+	       ? e->parse_tokens (len, codes, null_attrs_p ? NULL : attrs,
+				  count_syntax_error, test_parse_alloc,
+				  test_parse_free, &root, &ambiguous_p)
+	       : parser->parse_tokens (len, codes,
+				       null_attrs_p ? NULL : attrs,
+				       count_syntax_error, test_parse_alloc,
+				       test_parse_free, &root,
+				       &ambiguous_p)) != 0)
+	    {
+	      fprintf (stderr, "parse of token array: %s\n",
+		       k < 2 ? e->error_message () : parser->error_message ());
+	      exit (1);
+	    }
+	  if (!test_tree_eq (reference_root, root,
+			     (null_attrs_p
+			      ? TEST_TREE_NULL_ATTRS : TEST_TREE_ATTRS))
+	      || n_errors != reference_n_errors)
+	    {
+	      fprintf (stderr, "different parse of token array `%s'\n",
+		       inputs[i]);
+	      exit (1);
+	    }
+	  yaep::free_tree (root, test_parse_free, NULL);
+	}
+      yaep::free_tree (reference_root, test_parse_free, NULL);
+    }
+  codes[0] = 'a';
+  codes[1] = 'b';
+  if (e->parse_tokens (2, codes, NULL, count_syntax_error,
+		       NULL, NULL, &root, &ambiguous_p)
+      != YAEP_INVALID_TOKEN_CODE
+      || parser->parse_tokens (2, codes, NULL, count_syntax_error,
+			       NULL, NULL, &root, &ambiguous_p)
+      != YAEP_INVALID_TOKEN_CODE
+      || strcmp (e->error_message (), "invalid token code 98") != 0)
+    {
+      fprintf (stderr, "invalid token code is not reported\n");
+      exit (1);
+    }
+  /* The end marker code is not the end of the token array. */
+  codes[1] = -1;
+  codes[2] = 'a';
+  if (e->parse_tokens (3, codes, NULL, count_syntax_error,
+		       NULL, NULL, &root, &ambiguous_p)
+      != YAEP_INVALID_TOKEN_CODE
+      || strcmp (e->error_message (), "invalid token code -1") != 0
+      || parser->parse_tokens (3, codes, NULL, count_syntax_error,
+			       NULL, NULL, &root, &ambiguous_p)
+      != YAEP_INVALID_TOKEN_CODE
+      || parser->begin (count_syntax_error, NULL, NULL) != 0
+      || parser->feed (3, codes, NULL) != YAEP_INVALID_TOKEN_CODE
+      || strcmp (parser->error_message (), "invalid token code -1") != 0)
+    {
+      fprintf (stderr, "negative token code is not reported\n");
+      exit (1);
+    }
+  delete parser;
+  delete e;
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+
+  description =
+    "\n"
+    "TERM;\n"
+    "E : T         # 0\n"
+    "  | E '+' T   # plus (0 2)\n"
+    "  ;\n"
+    "T : F         # 0\n"
+    "  | T '*' F   # mult (0 2)\n"
+    "  ;\n"
+    "F : 'a'       # 0\n"
+    "  | '(' E ')' # 1\n"
+    "  | error     # 0\n"
+    "  ;\n";
+  check (level, description);
+  /* The codes are too sparse for the code translation vector. */
+  check (level,
+	 "\n"
+	 "TERM z=1000000;\n"
+	 "E : T         # 0\n"
+	 "  | E '+' T   # plus (0 2)\n"
+	 "  | E z       # 0\n"
+	 "  ;\n"
+	 "T : F         # 0\n"
+	 "  | T '*' F   # mult (0 2)\n"
+	 "  ;\n"
+	 "F : 'a'       # 0\n"
+	 "  | '(' E ')' # 1\n"
+	 "  | error     # 0\n"
+	 "  ;\n");
+  fprintf (stderr, "all parses of token arrays are the same\n");
+  exit (0);
+}
@@ -0,0 +1,188 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Checking parse statistics of grammars and parsers. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : E '+' E # plus (0 2)\n"
+"  | 'a'     # 0\n"
+"  ;\n";
+
+static const char *inputs[] = {"a", "a+a+a", "a+a+a+a+a", "a+a"};
+#define N_INPUTS (static_cast<int> (sizeof (inputs) / sizeof (inputs[0])))
+
+/* Parse input I by grammar E (if PARSER is NULL) or by PARSER and
+   return the ambiguity flag. */
+static int
+parse (yaep *e, yaep::parser *parser, int i)
+{
+  int codes[20], n, ambiguous_p, code;
+  struct yaep_tree_node *root;
+
+  for (n = 0; inputs[i][n] != '\0'; n++)
+    codes[n] = inputs[i][n];
+  if (parser == NULL)
+    code = e->parse_tokens (n, codes, NULL, test_syntax_error,
+			    test_parse_alloc, test_parse_free,
+			    &root, &ambiguous_p);
+  else
+    code = parser->parse_tokens (n, codes, NULL, test_syntax_error,
+				 test_parse_alloc, test_parse_free,
+				 &root, &ambiguous_p);
+  if (code != 0)
+    test_fail ("parse error");
+  yaep::free_tree (root, test_parse_free, NULL);
+  return ambiguous_p;
+}
+
+/* Check that statistics LAST are statistics of the parse of input I
+   with ambiguity flag AMBIGUOUS_P. */
+static void
+check_last (struct yaep_parse_stats *last, int i, int ambiguous_p)
+{
+  if (last->n_parses != 1
+      || last->n_ambiguous_parses != ambiguous_p
+      || last->n_tokens != static_cast<long> (strlen (inputs[i]))
+      || last->n_sits <= 0 || last->n_sets <= 0
+      || last->n_set_cores <= 0 || last->n_core_symb_pairs <= 0
+      || last->n_term_nodes != static_cast<long> ((strlen (inputs[i]) + 1) / 2)
+      || last->n_abstract_nodes != static_cast<long> (strlen (inputs[i]) / 2)
+      || last->n_tab_searches < last->n_tab_collisions)
+    test_fail ("wrong statistics of the last parse");
+}
+
+/* Add statistics STATS to SUM for the members checked by the
+   test. */
+static void
+add (struct yaep_parse_stats *sum, struct yaep_parse_stats *stats)
+{
+  sum->n_parses += stats->n_parses;
+  sum->n_ambiguous_parses += stats->n_ambiguous_parses;
+  sum->n_tokens += stats->n_tokens;
+  sum->n_sets += stats->n_sets;
+  sum->n_term_nodes += stats->n_term_nodes;
+  sum->n_alt_nodes += stats->n_alt_nodes;
+  sum->n_goto_cache_hits += stats->n_goto_cache_hits;
+}
+
+static void
+check_total (struct yaep_parse_stats *total, struct yaep_parse_stats *sum)
+{
+  if (total->n_parses != sum->n_parses
+      || total->n_ambiguous_parses != sum->n_ambiguous_parses
+      || total->n_tokens != sum->n_tokens
+      || total->n_sets != sum->n_sets
+      || total->n_term_nodes != sum->n_term_nodes
+      || total->n_alt_nodes != sum->n_alt_nodes
+      || total->n_goto_cache_hits != sum->n_goto_cache_hits)
+    test_fail ("wrong total statistics");
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+  yaep *e = new yaep ();
+  yaep::parser *parser;
+  struct yaep_parse_stats last, total, sum, parser_total;
+  int i, round, ambiguous_p;
+
+  e->set_lookahead_level (level);
+  test_parse_grammar (e, description);
+  e->get_parse_stats (1, &total);
+  if (total.n_parses != 0)
+    test_fail ("statistics before parsing");
+  /* The second round reuses the parse cache. */
+  e->set_parse_cache_limit (1 << 24);
+  memset (&sum, 0, sizeof (sum));
+  for (round = 0; round < 2; round++)
+    for (i = 0; i < N_INPUTS; i++)
+      {
+	ambiguous_p = parse (e, NULL, i);
+	if (ambiguous_p != (i == 1 || i == 2))
+	  test_fail ("wrong ambiguity");
+	e->get_parse_stats (0, &last);
+	check_last (&last, i, ambiguous_p);
+	if (round == 1 && last.n_goto_cache_hits == 0)
+	  test_fail ("no parse cache use in the statistics");
+	add (&sum, &last);
+      }
+  e->get_parse_stats (1, &total);
+  check_total (&total, &sum);
+  if (total.n_ambiguous_parses != 4 || total.n_parses != 2 * N_INPUTS)
+    test_fail ("wrong number of parses");
+  e->reset_parse_stats ();
+  e->get_parse_stats (1, &total);
+  e->get_parse_stats (0, &last);
+  if (total.n_parses != 0 || last.n_parses != 0 || total.n_tokens != 0)
+    test_fail ("statistics after reset");
+  /* Parsers count their parses.  The frozen grammar statistics are
+     not changed. */
+  parser = new yaep::parser (*e);
+  parse (e, parser, 1);
+  e->get_parse_stats (1, &total);
+  parser->get_parse_stats (1, &parser_total);
+  if (total.n_parses != 1 || parser_total.n_parses != 1)
+    test_fail ("wrong parser statistics");
+  if (e->freeze () != 0)
+    test_fail (e->error_message ());
+  memset (&sum, 0, sizeof (sum));
+  add (&sum, &parser_total);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      ambiguous_p = parse (e, parser, i);
+      parser->get_parse_stats (0, &last);
+      check_last (&last, i, ambiguous_p);
+      add (&sum, &last);
+      parse (e, NULL, i);
+    }
+  parser->get_parse_stats (1, &parser_total);
+  check_total (&parser_total, &sum);
+  e->get_parse_stats (1, &total);
+  if (total.n_parses != 1)
+    test_fail ("frozen grammar statistics are changed");
+  e->reset_parse_stats ();
+  e->get_parse_stats (1, &total);
+  if (total.n_parses != 1)
+    test_fail ("frozen grammar statistics are reset");
+  parser->reset_parse_stats ();
+  parser->get_parse_stats (1, &parser_total);
+  if (parser_total.n_parses != 0)
+    test_fail ("parser statistics after reset");
+  delete parser;
+  delete e;
+  fprintf (stderr, "parse statistics are right\n");
+  exit (0);
+}
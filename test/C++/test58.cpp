@@ -0,0 +1,204 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Checking parse trees allocated in tree arenas. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : E '+' T # plus (0 2)\n"
+"  | T       # 0\n"
+"  ;\n"
+"T : 'a'     # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n";
+
+/* Number of the input tokens of the long input.  Its tree does not
+   fit into one arena slab. */
+#define N_LONG_TOKENS 40001
+
+static int codes[N_LONG_TOKENS];
+
+static int n_allocs, n_terms;
+
+static void *
+count_parse_alloc (int size)
+{
+  n_allocs++;
+  return test_parse_alloc (size);
+}
+
+static void
+no_free (void *mem)
+{
+  (void) mem;
+}
+
+static void
+count_term (struct yaep_term *term)
+{
+  (void) term;
+  n_terms++;
+}
+
+/* Return the number of the tokens in codes for input STR.  */
+static int
+set_codes (const char *str)
+{
+  int n;
+
+  for (n = 0; str[n] != '\0'; n++)
+    codes[n] = str[n];
+  return n;
+}
+
+/* Return the number of the tokens in codes for input a+a+...+a. */
+static int
+set_long_codes (void)
+{
+  int n;
+
+  for (n = 0; n < N_LONG_TOKENS; n++)
+    codes[n] = n % 2 == 0 ? 'a' : '+';
+  return N_LONG_TOKENS;
+}
+
+/* Parse N tokens from codes by grammar E (if PARSER is NULL) or by
+   PARSER (with the push interface if PUSH_P) and return the tree. */
+static struct yaep_tree_node *
+parse (yaep *e, yaep::parser *parser, int push_p, int n)
+{
+  int ambiguous_p, code;
+  struct yaep_tree_node *root;
+
+  if (parser == NULL)
+    code = e->parse_tokens (n, codes, NULL, test_syntax_error,
+			    count_parse_alloc, test_parse_free,
+			    &root, &ambiguous_p);
+  else if (!push_p)
+    code = parser->parse_tokens (n, codes, NULL, test_syntax_error,
+				 count_parse_alloc, test_parse_free,
+				 &root, &ambiguous_p);
+  else if ((code = parser->begin (test_syntax_error, count_parse_alloc,
+				  test_parse_free)) == 0
+	   && (code = parser->feed (n, codes, NULL)) == 0)
+    code = parser->end (&root, &ambiguous_p);
+  if (code != 0 || root == NULL)
+    test_fail ("parse error");
+  return root;
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+  yaep *e = new yaep ();
+  yaep::parser *parser;
+  yaep::tree_arena *arena = new yaep::tree_arena ();
+  yaep::tree_arena *arena2 = new yaep::tree_arena ();
+  struct yaep_tree_node *root, *arena_root, *arena_root2;
+  int n, round, n_malloc_terms;
+
+  e->set_lookahead_level (level);
+  test_parse_grammar (e, description);
+  n = set_codes ("a+(a+a)+((a))");
+  root = parse (e, NULL, 0, n);
+  e->set_tree_arena (arena);
+  /* The arena is reused by the second round. */
+  for (round = 0; round < 2; round++)
+    {
+      n_allocs = 0;
+      arena_root = parse (e, NULL, 0, n);
+      if (n_allocs != 0)
+	test_fail ("PARSE_ALLOC is used with the arena");
+      if (!test_tree_eq (root, arena_root, 0))
+	test_fail ("different trees with the arena");
+      n_terms = 0;
+      yaep::free_tree (arena_root, no_free, count_term);
+      if (n_terms != 4)
+	test_fail ("wrong number of terminals in the arena tree");
+      arena->reset ();
+    }
+  yaep::free_tree (root, test_parse_free, NULL);
+  /* The tree of the long input needs several slabs. */
+  n = set_long_codes ();
+  e->set_tree_arena (NULL);
+  root = parse (e, NULL, 0, n);
+  n_terms = 0;
+  yaep::free_tree (root, test_parse_free, count_term);
+  n_malloc_terms = n_terms;
+  root = parse (e, NULL, 0, n);
+  e->set_tree_arena (arena);
+  for (round = 0; round < 2; round++)
+    {
+      arena_root = parse (e, NULL, 0, n);
+      if (!test_tree_eq (root, arena_root, 0))
+	test_fail ("different long trees with the arena");
+      n_terms = 0;
+      yaep::free_tree (arena_root, no_free, count_term);
+      if (n_terms != n_malloc_terms)
+	test_fail ("wrong number of terminals in the long arena tree");
+      arena->reset ();
+    }
+  /* Parsers have their own arenas. */
+  parser = new yaep::parser (*e);
+  parser->set_tree_arena (arena2);
+  n_allocs = 0;
+  arena_root = parse (e, parser, 0, n);
+  arena_root2 = parse (e, parser, 1, n);
+  if (n_allocs != 0)
+    test_fail ("PARSE_ALLOC is used with the parser arena");
+  if (!test_tree_eq (root, arena_root, 0)
+      || !test_tree_eq (root, arena_root2, 0))
+    test_fail ("different trees with the parser arena");
+  parser->set_tree_arena (NULL);
+  arena_root = parse (e, parser, 0, n);
+  if (n_allocs == 0)
+    test_fail ("PARSE_ALLOC is not used without the parser arena");
+  yaep::free_tree (arena_root, test_parse_free, NULL);
+  /* The arena of the frozen grammar can not be changed. */
+  if (e->freeze () != 0)
+    test_fail (e->error_message ());
+  e->set_tree_arena (NULL);
+  n_allocs = 0;
+  arena_root = parse (e, NULL, 0, n);
+  if (n_allocs != 0 || !test_tree_eq (root, arena_root, 0))
+    test_fail ("wrong tree of the frozen grammar with the arena");
+  yaep::free_tree (root, test_parse_free, NULL);
+  delete parser;
+  delete e;
+  delete arena;
+  delete arena2;
+  fprintf (stderr, "tree arenas are right\n");
+  exit (0);
+}
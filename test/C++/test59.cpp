@@ -0,0 +1,229 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Checking that repeated parses of small inputs do not allocate
+   memory after the first parses (the parse workspace reuse).  The
+   allocations are counted by wrapping the allocation functions with
+   the GNU linker (YAEP_TEST_WRAP_ALLOC) and by replacing the global
+   operators new and new[].  */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include"common.h"
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : E '+' T # plus (0 2)\n"
+"  | T       # 0\n"
+"  ;\n"
+"T : T '*' F # mult (0 2)\n"
+"  | F       # 0\n"
+"  ;\n"
+"F : 'a'     # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n";
+
+static const char *inputs[] = {
+  "a+a*(a+a)*a+a*a+(a*a+a)*(a+(a*a)+a)+a*a*a+(a)+a+a*a+a",
+  "a*(a+a)",
+  "(a+a*a)*(a+a*a+a)+a*a*a*a+a+(((a+a)))*a",
+};
+#define N_INPUTS (static_cast<int> (sizeof (inputs) / sizeof (inputs[0])))
+
+/* Number of rounds of parsing all inputs before and during counting
+   the allocations. */
+#define WARM_UP_ROUNDS 3
+#define ROUNDS 10
+
+static int alloc_counting_p;
+static long n_allocs;
+
+#ifdef YAEP_TEST_WRAP_ALLOC
+
+extern "C"
+{
+void *__real_malloc (size_t size);
+void *__real_calloc (size_t nmemb, size_t size);
+void *__real_realloc (void *ptr, size_t size);
+void *__wrap_malloc (size_t size);
+void *__wrap_calloc (size_t nmemb, size_t size);
+void *__wrap_realloc (void *ptr, size_t size);
+}
+
+void *
+__wrap_malloc (size_t size)
+{
+  n_allocs += alloc_counting_p;
+  return __real_malloc (size);
+}
+
+void *
+__wrap_calloc (size_t nmemb, size_t size)
+{
+  n_allocs += alloc_counting_p;
+  return __real_calloc (nmemb, size);
+}
+
+void *
+__wrap_realloc (void *ptr, size_t size)
+{
+  n_allocs += alloc_counting_p;
+  return __real_realloc (ptr, size);
+}
+
+#endif
+
+/* The library objects are allocated by operator new. */
+void *
+operator new (size_t size)
+{
+  void *ptr;
+
+  n_allocs += alloc_counting_p;
+  if ((ptr = malloc (size == 0 ? 1 : size)) == NULL)
+    throw std::bad_alloc ();
+  return ptr;
+}
+
+void
+operator delete (void *ptr) noexcept
+{
+  free (ptr);
+}
+
+void
+operator delete (void *ptr, size_t size) noexcept
+{
+  (void) size;
+  free (ptr);
+}
+
+void *
+operator new[] (size_t size)
+{
+  return operator new (size);
+}
+
+void
+operator delete[] (void *ptr) noexcept
+{
+  operator delete (ptr);
+}
+
+void
+operator delete[] (void *ptr, size_t size) noexcept
+{
+  operator delete (ptr, size);
+}
+
+/* Parse input I by grammar E (if PARSER is NULL) or by PARSER (with
+   the push interface if PUSH_P).  The tree is allocated in the arena
+   of the grammar or the parser. */
+static void
+parse (yaep *e, yaep::parser *parser, int push_p, int i)
+{
+  int codes[100], n, ambiguous_p, code;
+  struct yaep_tree_node *root;
+
+  for (n = 0; inputs[i][n] != '\0'; n++)
+    codes[n] = inputs[i][n];
+  if (parser == NULL)
+    code = e->parse_tokens (n, codes, NULL, test_syntax_error,
+			    NULL, NULL, &root, &ambiguous_p);
+  else if (!push_p)
+    code = parser->parse_tokens (n, codes, NULL, test_syntax_error,
+				 NULL, NULL, &root, &ambiguous_p);
+  else if ((code = parser->begin (test_syntax_error, NULL, NULL)) == 0
+	   && (code = parser->feed (n, codes, NULL)) == 0)
+    code = parser->end (&root, &ambiguous_p);
+  if (code != 0 || root == NULL || ambiguous_p)
+    test_fail ("parse error");
+}
+
+/* Parse all inputs ROUNDS times after the warm-up and return the
+   number of allocations during the counted rounds. */
+static long
+count_allocs (yaep *e, yaep::parser *parser, int push_p,
+	      yaep::tree_arena *arena)
+{
+  int round, i;
+
+  n_allocs = 0;
+  for (round = 0; round < WARM_UP_ROUNDS + ROUNDS; round++)
+    {
+      alloc_counting_p = round >= WARM_UP_ROUNDS;
+      for (i = 0; i < N_INPUTS; i++)
+	{
+	  parse (e, parser, push_p, i);
+	  arena->reset ();
+	}
+    }
+  alloc_counting_p = 0;
+  return n_allocs;
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+  /* The objects are not created by new expressions here: GCC warns
+     about the replaced operator delete inlined into them. */
+  yaep e;
+  yaep::tree_arena arena;
+
+  e.set_lookahead_level (level);
+  test_parse_grammar (&e, description);
+  e.set_tree_arena (&arena);
+  if (count_allocs (&e, NULL, 0, &arena) != 0)
+    test_fail ("parse_tokens allocates memory after warm-up");
+  /* The same with the parse cache. */
+  e.set_parse_cache_limit (1 << 24);
+  if (count_allocs (&e, NULL, 0, &arena) != 0)
+    test_fail ("parse_tokens with the parse cache allocates memory after "
+               "warm-up");
+  e.set_parse_cache_limit (0);
+  {
+    yaep::parser parser (e);
+
+    parser.set_tree_arena (&arena);
+    if (count_allocs (&e, &parser, 0, &arena) != 0)
+      test_fail ("parser parse_tokens allocates memory after warm-up");
+    if (count_allocs (&e, &parser, 1, &arena) != 0)
+      test_fail ("the push interface allocates memory after warm-up");
+    /* Flushing frees the workspace which is created again. */
+    parser.flush_cache ();
+    if (count_allocs (&e, &parser, 0, &arena) != 0)
+      test_fail ("parser parse_tokens allocates memory after flush and "
+                 "warm-up");
+  }
+  fprintf (stderr, "parses do not allocate memory after warm-up\n");
+  return 0;
+}
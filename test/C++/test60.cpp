@@ -0,0 +1,165 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Batch parsing: the trees and error codes of yaep_parse_batch are
+   the same as ones of sequential parses for any number of threads. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+#define N_INPUTS 200
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static yaep *e;
+static struct yaep_batch_input inputs[N_INPUTS];
+static struct yaep_tree_node *reference_roots[N_INPUTS];
+static int reference_codes[N_INPUTS];
+static int *input_codes[N_INPUTS];
+
+static void
+batch_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num,
+		    void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+}
+
+/* Form input I.  The inputs have different sizes and each 17th
+   input contains an invalid token. */
+static void
+make_input (int i)
+{
+  static const char *piece = "+a*(a+a)";
+  int *codes, j, n, len = (i * 7) % 61;
+
+  n = 1 + len * static_cast<int> (strlen (piece));
+  codes = static_cast<int *> (malloc (static_cast<size_t> (n)
+				      * sizeof (int)));
+  codes[0] = 'a';
+  for (j = 1; j < n; j++)
+    codes[j] = piece[static_cast<size_t> (j - 1) % strlen (piece)];
+  if (i % 17 == 0 && n > 1)
+    codes[n / 2] = 'b';
+  inputs[i].n_toks = n;
+  inputs[i].codes = input_codes[i] = codes;
+  inputs[i].attrs = NULL;
+}
+
+/* Parse the inputs by the batch in N_THREADS threads and compare the
+   results with the reference ones.  Return FALSE if something is
+   wrong. */
+static bool
+check_batch (int n_threads)
+{
+  struct yaep_parse_stats stats;
+  int i, n_parses = 0;
+  bool ok = true;
+
+  if (e->parse_batch (inputs, N_INPUTS, n_threads, batch_syntax_error,
+		      test_parse_alloc, test_parse_free) != 0)
+    {
+      fprintf (stderr, "parse_batch: %s\n", e->error_message ());
+      return false;
+    }
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      if (inputs[i].error_code != reference_codes[i]
+	  || !test_tree_eq (inputs[i].root, reference_roots[i], 0))
+	{
+	  fprintf (stderr, "%d threads: input %d differs\n", n_threads, i);
+	  ok = false;
+	}
+      if (inputs[i].root != NULL)
+	yaep::free_tree (inputs[i].root, test_parse_free, NULL);
+      if (reference_codes[i] == 0)
+	n_parses++;
+    }
+  e->get_parse_stats (0, &stats);
+  if (stats.n_parses != n_parses)
+    {
+      fprintf (stderr, "%d threads: %ld parses in the statistics\n",
+	       n_threads, stats.n_parses);
+      ok = false;
+    }
+  return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+  int i, ambiguous_p;
+  bool ok;
+
+  e = new yaep ();
+  if (argc > 1)
+    e->set_lookahead_level (atoi (argv [1]));
+  test_parse_grammar (e, description);
+  e->set_error_recovery_flag (0);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      make_input (i);
+      reference_codes[i]
+	= e->parse_tokens (inputs[i].n_toks, inputs[i].codes, NULL,
+			   batch_syntax_error, test_parse_alloc,
+			   test_parse_free, &reference_roots[i], &ambiguous_p);
+    }
+  ok = check_batch (1) && check_batch (4) && check_batch (0);
+  e->set_parse_cache_limit (1 << 24);
+  ok = ok && check_batch (3);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      if (reference_roots[i] != NULL)
+	yaep::free_tree (reference_roots[i], test_parse_free, NULL);
+      free (input_codes[i]);
+    }
+  delete e;
+  if (!ok)
+    exit (1);
+  fprintf (stderr, "batch parses are the same as sequential ones\n");
+  exit (0);
+}
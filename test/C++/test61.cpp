@@ -0,0 +1,214 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* The shared memo: parsers in several threads publish set cores and
+   goto sets into the memo of the frozen grammar, their trees are the
+   same as without the memo, and a new parser of the grammar forms no
+   set cores for the same inputs. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include"common.h"
+
+#define N_THREADS 4
+#define N_INPUTS 60
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static yaep *e;
+static int lookahead_level = 1;
+static int n_input_toks[N_INPUTS];
+static int *input_codes[N_INPUTS];
+static struct yaep_tree_node *reference_roots[N_INPUTS];
+static int reference_codes[N_INPUTS];
+
+static void
+memo_syntax_error (int err_tok_num, void *err_tok_attr,
+		   int start_ignored_tok_num, void *start_ignored_tok_attr,
+		   int start_recovered_tok_num,
+		   void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+}
+
+/* Form input I.  The inputs have different sizes and each 7th input
+   contains an invalid token. */
+static void
+make_input (int i)
+{
+  static const char *piece = "+(a*a+a)*a";
+  int *codes, j, n, len = (i * 11) % 37;
+
+  n = 1 + len * static_cast<int> (strlen (piece));
+  codes = new int[n];
+  codes[0] = 'a';
+  for (j = 1; j < n; j++)
+    codes[j] = piece[static_cast<size_t> (j - 1) % strlen (piece)];
+  if (i % 7 == 3 && n > 1)
+    codes[n / 3] = 'b';
+  n_input_toks[i] = n;
+  input_codes[i] = codes;
+}
+
+/* Create and return a grammar.  The grammar uses the shared memo if
+   SHARED_MEMO_P. */
+static yaep *
+create_grammar (int shared_memo_p)
+{
+  yaep *gr = new yaep ();
+
+  gr->set_lookahead_level (lookahead_level);
+  gr->set_error_recovery_flag (0);
+  gr->set_shared_memo_flag (shared_memo_p);
+  test_parse_grammar (gr, description);
+  return gr;
+}
+
+/* Parse all inputs by PARSER starting with input START and return
+   an error message if the results differ from the reference ones. */
+static const char *
+parse_inputs (yaep::parser &parser, int start)
+{
+  struct yaep_tree_node *root;
+  int i, code, ambiguous_p;
+
+  for (int k = 0; k < N_INPUTS; k++)
+    {
+      i = (start + k) % N_INPUTS;
+      code = parser.parse_tokens (n_input_toks[i], input_codes[i], NULL,
+				  memo_syntax_error, test_parse_alloc,
+				  test_parse_free, &root, &ambiguous_p);
+      if (code != reference_codes[i]
+	  || !test_tree_eq (root, reference_roots[i], 0))
+	return "different parse results";
+      if (root != NULL)
+	yaep::free_tree (root, test_parse_free, NULL);
+    }
+  return NULL;
+}
+
+/* Parse all inputs by a new parser of the frozen grammar starting
+   with an input depending on thread number NUM.  Put an error
+   message into *RESULT if something is wrong. */
+static void
+parse_thread (int num, const char **result)
+{
+  yaep::parser parser (*e);
+
+  *result = parse_inputs (parser, num * 13);
+}
+
+int
+main (int argc, char **argv)
+{
+  std::thread threads[N_THREADS];
+  const char *results[N_THREADS];
+  struct yaep_parse_stats stats;
+  const char *message;
+  yaep *reference_e;
+  int i, ambiguous_p;
+  bool ok = true;
+
+  if (argc > 1)
+    lookahead_level = atoi (argv [1]);
+  reference_e = create_grammar (0);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      make_input (i);
+      reference_codes[i]
+	= reference_e->parse_tokens (n_input_toks[i], input_codes[i], NULL,
+				     memo_syntax_error, test_parse_alloc,
+				     test_parse_free, &reference_roots[i],
+				     &ambiguous_p);
+    }
+  e = create_grammar (1);
+  if (e->freeze () != 0)
+    {
+      fprintf (stderr, "freeze: %s\n", e->error_message ());
+      exit (1);
+    }
+  for (i = 0; i < N_THREADS; i++)
+    threads[i] = std::thread (parse_thread, i, &results[i]);
+  for (i = 0; i < N_THREADS; i++)
+    {
+      threads[i].join ();
+      if (results[i] != NULL)
+	{
+	  fprintf (stderr, "thread %d: %s\n", i, results[i]);
+	  ok = false;
+	}
+    }
+  /* All set cores for the inputs are already in the memo.  The memo
+     is not used for the dynamic lookahead. */
+  {
+    yaep::parser parser (*e);
+
+    if ((message = parse_inputs (parser, 0)) != NULL)
+      {
+	fprintf (stderr, "%s\n", message);
+	ok = false;
+      }
+    parser.get_parse_stats (1, &stats);
+    if ((stats.n_set_cores == 0) != (lookahead_level < 2))
+      {
+	fprintf (stderr, "%ld set cores are formed with the memo\n",
+		 stats.n_set_cores);
+	ok = false;
+      }
+  }
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      if (reference_roots[i] != NULL)
+	yaep::free_tree (reference_roots[i], test_parse_free, NULL);
+      delete[] input_codes[i];
+    }
+  delete e;
+  delete reference_e;
+  if (!ok)
+    exit (1);
+  fprintf (stderr, "parses with the shared memo are the same\n");
+  exit (0);
+}
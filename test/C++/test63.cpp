@@ -0,0 +1,148 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* The LR(0) automaton compiled by freezing the grammar: the trees
+   (including ones after error recovery) are the same as without the
+   automaton, and parses form fewer set cores because the states
+   formed by shifting are already in the shared memo of the grammar. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+#define N_INPUTS 30
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static int lookahead_level = 1;
+static int n_input_toks[N_INPUTS];
+static int *input_codes[N_INPUTS];
+
+/* Form input I.  The inputs have different sizes and each 7th input
+   contains an invalid token. */
+static void
+make_input (int i)
+{
+  static const char *piece = "+(a*a+a)*a";
+  int *codes, j, n, len = (i * 11) % 37;
+
+  n = 1 + len * static_cast<int> (strlen (piece));
+  codes = new int[n];
+  codes[0] = 'a';
+  for (j = 1; j < n; j++)
+    codes[j] = piece[static_cast<size_t> (j - 1) % strlen (piece)];
+  if (i % 7 == 3 && n > 1)
+    codes[n / 3] = 'b';
+  n_input_toks[i] = n;
+  input_codes[i] = codes;
+}
+
+/* Create and return a grammar.  The grammar is frozen with the LR(0)
+   automaton if AUTOMATON_P. */
+static yaep *
+create_grammar (int automaton_p)
+{
+  yaep *gr = new yaep ();
+
+  gr->set_lookahead_level (lookahead_level);
+  gr->set_lr0_automaton_flag (automaton_p);
+  test_parse_grammar (gr, description);
+  if (automaton_p && gr->freeze () != 0)
+    {
+      fprintf (stderr, "freeze: %s\n", gr->error_message ());
+      exit (1);
+    }
+  return gr;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct yaep_tree_node *reference_root, *root;
+  struct yaep_parse_stats reference_stats, stats;
+  yaep *reference_e, *e;
+  int i, reference_code, code, ambiguous_p;
+
+  if (argc > 1)
+    lookahead_level = atoi (argv [1]);
+  reference_e = create_grammar (0);
+  e = create_grammar (1);
+  {
+    yaep::parser reference_parser (*reference_e), parser (*e);
+
+    for (i = 0; i < N_INPUTS; i++)
+      {
+	make_input (i);
+	reference_code
+	  = reference_parser.parse_tokens (n_input_toks[i], input_codes[i],
+					   NULL, test_silent_syntax_error,
+					   test_parse_alloc, test_parse_free,
+					   &reference_root, &ambiguous_p);
+	code = parser.parse_tokens (n_input_toks[i], input_codes[i], NULL,
+				    test_silent_syntax_error, test_parse_alloc,
+				    test_parse_free, &root, &ambiguous_p);
+	if (code != reference_code || !test_tree_eq (root, reference_root, 0))
+	  {
+	    fprintf (stderr, "different parse results for input %d\n", i);
+	    exit (1);
+	  }
+	if (root != NULL)
+	  yaep::free_tree (root, test_parse_free, NULL);
+	if (reference_root != NULL)
+	  yaep::free_tree (reference_root, test_parse_free, NULL);
+	delete[] input_codes[i];
+      }
+    /* The automaton is not used for the dynamic lookahead. */
+    reference_parser.get_parse_stats (1, &reference_stats);
+    parser.get_parse_stats (1, &stats);
+    if ((stats.n_set_cores < reference_stats.n_set_cores)
+	!= (lookahead_level < 2))
+      {
+	fprintf (stderr,
+		 "%ld set cores are formed with the automaton, %ld without it\n",
+		 stats.n_set_cores, reference_stats.n_set_cores);
+	exit (1);
+      }
+  }
+  delete e;
+  delete reference_e;
+  fprintf (stderr, "parses with the LR(0) automaton are the same\n");
+  exit (0);
+}
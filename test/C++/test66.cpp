@@ -0,0 +1,179 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+/* Recognition mode: with and without error recovery, Leo items and a
+   frozen grammar with the LR(0) automaton, the recognition gives the
+   same syntax errors as building the trees, returns only a nil node
+   for recognized inputs and calls parse_alloc only for it. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+#define MAX_ERRORS 10
+
+static const char *desc = "TERM;\n"
+  "E : T         # 0\n"
+  "  | E '+' T   # plus (0 2)\n"
+  "  ;\n"
+  "T : F         # 0\n"
+  "  | T '*' F   # mult (0 2)\n"
+  "  ;\n"
+  "F : 'a'       # 0\n"
+  "  | '(' E ')' # 1\n"
+  "  | F '!'     # fact (0)\n"
+  "  | error     # 0\n"
+  "  ;\n";
+
+static const char *inputs[] = {
+  "a", "a+a*a", "(a+a)*a!!", "((((a))))+a*(a+(a*a))",
+  "a+", "aa", "(a+a", "a+*a+a*a)", "a*(a+a))+(a*a",
+};
+
+#define N_INPUTS static_cast<int> (sizeof (inputs) / sizeof (inputs[0]))
+
+/* The numbers of tokens with syntax errors of the last parse. */
+static int errors[MAX_ERRORS], n_errors;
+
+/* The number of parse_alloc calls. */
+static int n_allocs;
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num,
+		    void *start_recovered_tok_attr)
+{
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  if (n_errors < MAX_ERRORS)
+    errors[n_errors++] = err_tok_num;
+}
+
+static void *
+count_parse_alloc (int size)
+{
+  n_allocs++;
+  return test_parse_alloc (size);
+}
+
+/* Create and return a grammar with RECOGNITION_P, ERROR_RECOVERY_P,
+   LEO_P and FROZEN_P (the last with the LR(0) automaton). */
+static yaep *
+create_grammar (int recognition_p, int error_recovery_p, int leo_p,
+		int frozen_p)
+{
+  yaep *g = new yaep ();
+
+  g->set_recognition_flag (recognition_p);
+  g->set_error_recovery_flag (error_recovery_p);
+  g->set_leo_flag (leo_p);
+  g->set_lr0_automaton_flag (frozen_p);
+  if (g->parse_grammar (1, desc) != 0 || (frozen_p && g->freeze () != 0))
+    {
+      fprintf (stderr, "%s\n", g->error_message ());
+      exit (1);
+    }
+  return g;
+}
+
+/* Parse STR by G with RECOGNITION_P, return the root and put the
+   syntax errors into ERRS and their number into *N_ERRS. */
+static struct yaep_tree_node *
+parse (yaep *g, int recognition_p, const char *str, int *errs,
+       int *n_errs)
+{
+  struct yaep_tree_node *root;
+  int codes[100], i, n, ambiguous_p;
+
+  n = static_cast<int> (strlen (str));
+  for (i = 0; i < n; i++)
+    codes[i] = str[i];
+  n_errors = 0;
+  if (g->parse_tokens (n, codes, NULL, count_syntax_error,
+		       count_parse_alloc, test_parse_free, &root,
+		       &ambiguous_p) != 0)
+    {
+      fprintf (stderr, "%s\n", g->error_message ());
+      exit (1);
+    }
+  if (recognition_p && ambiguous_p)
+    {
+      fprintf (stderr, "ambiguity is reported by recognition\n");
+      exit (1);
+    }
+  memcpy (errs, errors, sizeof (errors));
+  *n_errs = n_errors;
+  return root;
+}
+
+int
+main (void)
+{
+  yaep *tree_g, *recognition_g;
+  struct yaep_tree_node *tree_root, *root;
+  int tree_errs[MAX_ERRORS], errs[MAX_ERRORS], n_tree_errs, n_errs;
+  int i, recovery_p, leo_p, frozen_p;
+
+  for (recovery_p = 0; recovery_p <= 1; recovery_p++)
+    for (leo_p = 0; leo_p <= 1; leo_p++)
+      for (frozen_p = 0; frozen_p <= 1; frozen_p++)
+	{
+	  tree_g = create_grammar (0, recovery_p, leo_p, frozen_p);
+	  recognition_g = create_grammar (1, recovery_p, leo_p, frozen_p);
+	  for (i = 0; i < N_INPUTS; i++)
+	    {
+	      tree_root = parse (tree_g, 0, inputs[i], tree_errs, &n_tree_errs);
+	      n_allocs = 0;
+	      root = parse (recognition_g, 1, inputs[i], errs, &n_errs);
+	      if ((root == NULL) != (tree_root == NULL)
+		  || (root != NULL && root->type != YAEP_NIL)
+		  || n_allocs != (root != NULL)
+		  || n_errs != n_tree_errs
+		  || memcmp (errs, tree_errs,
+			     static_cast<size_t> (n_errs) * sizeof (int)) != 0)
+		{
+		  fprintf (stderr, "different recognition of \"%s\" "
+			   "(recovery %d, leo %d, frozen %d)\n",
+			   inputs[i], recovery_p, leo_p, frozen_p);
+		  exit (1);
+		}
+	      if (!leo_p && !frozen_p)
+		fprintf (stderr, "recovery %d: input %d %s, %d errors\n",
+			 recovery_p, i,
+			 root == NULL ? "rejected" : "recognized", n_errs);
+	      yaep::free_tree (tree_root, test_parse_free, NULL);
+	      yaep::free_tree (root, test_parse_free, NULL);
+	    }
+	  delete recognition_g;
+	  delete tree_g;
+	}
+  exit (0);
+}
@@ -0,0 +1,300 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/* Tree events: with and without error recovery and Leo items, through
+   the grammar and the parser push interfaces, the events give the
+   same translation as the built trees, the terminal token numbers
+   refer to the same attributes as the terminal nodes, the first tokens of the abstract
+   nodes precede their terminals, and parse_alloc is called only for
+   the nil root. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include"common.h"
+
+#define MAX_INPUT_LEN 100
+#define MAX_TRANS_LEN 2000
+
+static const char *desc = "TERM;\n"
+  "S : L               # 0\n"
+  "  ;\n"
+  "L : E               # list (0)\n"
+  "  | L ',' E         # list (0 2)\n"
+  "  ;\n"
+  "E : 'a'             # 0\n"
+  "  | '(' L ')'       # paren (1)\n"
+  "  | E '-' E         # minus (0 2)\n"
+  "  | '[' E E ']'     # swap (2 1)\n"
+  "  | '<' O '>'       # angle (1)\n"
+  "  | E '!'           # -\n"
+  "  | error           # 0\n"
+  "  ;\n"
+  "O :                 # opt\n"
+  "  | 'o'             # 0\n"
+  "  ;\n";
+
+static const char *inputs[] = {
+  "a", "a,a", "(a,a)-a-a", "[a(a)]", "<>", "<o>!", "a!-[<>a]",
+  "a,,a", "(a", "a)a,a",
+};
+
+#define N_INPUTS static_cast<int> (sizeof (inputs) / sizeof (inputs[0]))
+
+/* The token numbers used as the token attributes and the number of
+   the input tokens. */
+static int tok_nums[MAX_INPUT_LEN], n_toks;
+
+/* The translation formed by the events, its length, the number of
+   events, and the number of parse_alloc calls. */
+static char trans[MAX_TRANS_LEN];
+static int trans_len, n_events, n_allocs;
+
+/* The stack of the first tokens of the entered abstract nodes and the
+   minimal terminal token numbers of their subtrees. */
+static int anode_toks[MAX_INPUT_LEN], min_toks[MAX_INPUT_LEN], depth;
+
+/* The first tokens of the abstract nodes in the event order. */
+static int starts[MAX_INPUT_LEN], n_starts;
+
+static void *
+count_parse_alloc (int size)
+{
+  n_allocs++;
+  return test_parse_alloc (size);
+}
+
+static void
+add_trans (const char *str)
+{
+  int len = static_cast<int> (strlen (str));
+
+  if (trans_len + len >= MAX_TRANS_LEN)
+    test_fail ("too long translation");
+  strcpy (trans + trans_len, str);
+  trans_len += len;
+}
+
+/* Return the token number which is terminal attribute ATTR or -1 for
+   no attribute. */
+static int
+attr_tok_num (void *attr)
+{
+  return attr == NULL ? -1 : *static_cast<int *> (attr);
+}
+
+/* Add translation of tree NODE to TRANS. */
+static void
+add_tree_trans (struct yaep_tree_node *node)
+{
+  char str[100];
+  int i;
+
+  switch (node->type)
+    {
+    case YAEP_NIL:
+      add_trans ("-");
+      break;
+    case YAEP_ERROR:
+      add_trans ("!");
+      break;
+    case YAEP_TERM:
+      sprintf (str, "%c@%d ", node->val.term.code,
+	       attr_tok_num (node->val.term.attr));
+      add_trans (str);
+      break;
+    case YAEP_ANODE:
+      sprintf (str, "%s/%d{", node->val.anode.name, node->val.anode.cost);
+      add_trans (str);
+      for (i = 0; node->val.anode.children[i] != NULL; i++)
+	add_tree_trans (node->val.anode.children[i]);
+      add_trans ("}");
+      break;
+    default:
+      test_fail ("unexpected tree node");
+    }
+}
+
+static void
+enter_anode (void *data, const char *name, int cost, int tok_num)
+{
+  char str[100];
+
+  if (data != trans)
+    test_fail ("wrong events data");
+  n_events++;
+  sprintf (str, "%s/%d{", name, cost);
+  add_trans (str);
+  anode_toks[depth] = tok_num;
+  min_toks[depth++] = MAX_INPUT_LEN;
+  starts[n_starts++] = tok_num;
+}
+
+static void
+leave_anode (void *data, const char *name, int cost)
+{
+  (void) data;
+  (void) name;
+  (void) cost;
+  n_events++;
+  add_trans ("}");
+  depth--;
+  if (min_toks[depth] < anode_toks[depth])
+    test_fail ("terminal before the first token of the abstract node");
+  if (depth > 0 && min_toks[depth] < min_toks[depth - 1])
+    min_toks[depth - 1] = min_toks[depth];
+}
+
+static void
+term (void *data, int code, void *attr, int tok_num)
+{
+  char str[100];
+
+  (void) data;
+  n_events++;
+  if (attr != (tok_num < n_toks ? &tok_nums[tok_num] : NULL))
+    test_fail ("wrong terminal token number");
+  sprintf (str, "%c@%d ", code, attr_tok_num (attr));
+  add_trans (str);
+  if (depth > 0 && tok_num < min_toks[depth - 1])
+    min_toks[depth - 1] = tok_num;
+}
+
+static void
+nil (void *data)
+{
+  (void) data;
+  n_events++;
+  add_trans ("-");
+}
+
+static void
+error (void *data)
+{
+  (void) data;
+  n_events++;
+  add_trans ("!");
+}
+
+static const struct yaep_tree_events events = {
+  enter_anode, leave_anode, term, nil, error, trans
+};
+
+/* Create and return a grammar with ERROR_RECOVERY_P and LEO_P. */
+static yaep *
+create_grammar (int error_recovery_p, int leo_p)
+{
+  yaep *g = new yaep ();
+
+  g->set_error_recovery_flag (error_recovery_p);
+  g->set_leo_flag (leo_p);
+  test_parse_grammar (g, desc);
+  return g;
+}
+
+int
+main (void)
+{
+  yaep *tree_g, *events_g;
+  yaep::parser *parser;
+  struct yaep_tree_node *tree_root, *root;
+  char tree_trans[MAX_TRANS_LEN];
+  int codes[MAX_INPUT_LEN];
+  void *attrs[MAX_INPUT_LEN];
+  int i, j, n, recovery_p, leo_p, push_p;
+  int tree_code, code, tree_ambiguous_p, ambiguous_p;
+
+  for (i = 0; i < MAX_INPUT_LEN; i++)
+    {
+      tok_nums[i] = i;
+      attrs[i] = &tok_nums[i];
+    }
+  for (recovery_p = 0; recovery_p <= 1; recovery_p++)
+    for (leo_p = 0; leo_p <= 1; leo_p++)
+      {
+	tree_g = create_grammar (recovery_p, leo_p);
+	events_g = create_grammar (recovery_p, leo_p);
+	if (events_g->set_tree_events (&events) != NULL)
+	  test_fail ("wrong initial tree events");
+	parser = new yaep::parser (*tree_g);
+	parser->set_tree_events (&events);
+	for (push_p = 0; push_p <= 1; push_p++)
+	  for (i = 0; i < N_INPUTS; i++)
+	    {
+	      n = n_toks = static_cast<int> (strlen (inputs[i]));
+	      for (j = 0; j < n; j++)
+		codes[j] = inputs[i][j];
+	      tree_code = tree_g->parse_tokens (n, codes, attrs,
+						test_silent_syntax_error,
+						test_parse_alloc, test_parse_free,
+						&tree_root, &tree_ambiguous_p);
+	      trans_len = 0;
+	      trans[0] = '\0';
+	      if (tree_root != NULL)
+		add_tree_trans (tree_root);
+	      strcpy (tree_trans, trans);
+	      trans_len = n_events = n_allocs = depth = n_starts = 0;
+	      trans[0] = '\0';
+	      if (!push_p)
+		code = events_g->parse_tokens (n, codes, attrs,
+					       test_silent_syntax_error,
+					       count_parse_alloc, test_parse_free,
+					       &root, &ambiguous_p);
+	      else if ((code = parser->begin (test_silent_syntax_error,
+					      count_parse_alloc,
+					      test_parse_free)) == 0
+		       && (code = parser->feed (n, codes, attrs)) == 0)
+		code = parser->end (&root, &ambiguous_p);
+	      if (code != tree_code || (root == NULL) != (tree_root == NULL)
+		  || (root != NULL && root->type != YAEP_NIL)
+		  || n_allocs != (root != NULL)
+		  || (root != NULL && ambiguous_p != tree_ambiguous_p)
+		  || depth != 0 || strcmp (trans, tree_trans) != 0)
+		{
+		  fprintf (stderr, "different events for \"%s\" "
+			   "(recovery %d, leo %d, push %d)\n",
+			   inputs[i], recovery_p, leo_p, push_p);
+		  exit (1);
+		}
+	      if (!leo_p && !push_p)
+		{
+		  fprintf (stderr, "recovery %d: input %d %s, %d events, "
+			   "anodes at", recovery_p, i,
+			   root == NULL ? "rejected" : "recognized", n_events);
+		  for (j = 0; j < n_starts; j++)
+		    fprintf (stderr, " %d", starts[j]);
+		  fprintf (stderr, "\n");
+		}
+	      yaep::free_tree (tree_root, test_parse_free, NULL);
+	      yaep::free_tree (root, test_parse_free, NULL);
+	    }
+	delete parser;
+	delete events_g;
+	delete tree_g;
+      }
+  exit (0);
+}
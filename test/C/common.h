@@ -30,6 +30,7 @@
 #include<assert.h>
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 
 #include"yaep.h"
 
@@ -78,6 +79,114 @@ test_syntax_error (int err_tok_num, void *err_tok_attr,
        start_ignored_tok_num);
 }
 
+/* Print MESSAGE and exit with failure. */
+static void
+YAEP_UNUSED test_fail (const char *message)
+{
+  fprintf (stderr, "%s\n", message);
+  exit (1);
+}
+
+/* Ignore syntax error. */
+static void
+YAEP_UNUSED test_silent_syntax_error (int err_tok_num, void *err_tok_attr,
+				      int start_ignored_tok_num,
+				      void *start_ignored_tok_attr,
+				      int start_recovered_tok_num,
+				      void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+}
+
+/* Create and return a grammar.  Exit if there is no memory. */
+static YAEP_UNUSED struct grammar *
+test_create_grammar (void)
+{
+  struct grammar *g;
+
+  if ((g = yaep_create_grammar ()) == NULL)
+    test_fail ("yaep_create_grammar: No memory");
+  return g;
+}
+
+/* Read grammar G from DESCRIPTION.  Exit with the error message if it
+   is wrong. */
+static void
+YAEP_UNUSED test_parse_grammar (struct grammar *g, const char *description)
+{
+  if (yaep_parse_grammar (g, 1, description) != 0)
+    test_fail (yaep_error_message (g));
+}
+
+/* The following flags of test_tree_eq say to compare the terminal
+   attributes too, to check that the terminal attributes of the second
+   tree are NULL, to compare the abstract node costs too, and to
+   ignore the terminal codes. */
+#define TEST_TREE_ATTRS 1
+#define TEST_TREE_NULL_ATTRS 2
+#define TEST_TREE_COSTS 4
+#define TEST_TREE_NO_CODES 8
+
+/* Return nonzero if trees with roots N1 and N2 are the same according
+   to FLAGS.  The first children and the next alternatives are
+   processed iteratively as the trees can be deep. */
+static int
+YAEP_UNUSED test_tree_eq (struct yaep_tree_node *n1,
+			  struct yaep_tree_node *n2, int flags)
+{
+  int i;
+
+  for (;;)
+    {
+      if (n1 == NULL || n2 == NULL)
+	return n1 == n2;
+      if (n1->type != n2->type)
+	return 0;
+      switch (n1->type)
+	{
+	case YAEP_TERM:
+	  if (!(flags & TEST_TREE_NO_CODES)
+	      && n1->val.term.code != n2->val.term.code)
+	    return 0;
+	  if (flags & TEST_TREE_NULL_ATTRS)
+	    return n2->val.term.attr == NULL;
+	  return (!(flags & TEST_TREE_ATTRS)
+		  || n1->val.term.attr == n2->val.term.attr);
+	case YAEP_ALT:
+	  if (!test_tree_eq (n1->val.alt.node, n2->val.alt.node, flags))
+	    return 0;
+	  n1 = n1->val.alt.next;
+	  n2 = n2->val.alt.next;
+	  break;
+	case YAEP_ANODE:
+	  if (strcmp (n1->val.anode.name, n2->val.anode.name) != 0
+	      || ((flags & TEST_TREE_COSTS)
+		  && n1->val.anode.cost != n2->val.anode.cost))
+	    return 0;
+	  if (n1->val.anode.children[0] == NULL
+	      || n2->val.anode.children[0] == NULL)
+	    return n1->val.anode.children[0] == n2->val.anode.children[0];
+	  for (i = 1; n1->val.anode.children[i] != NULL; i++)
+	    if (n2->val.anode.children[i] == NULL
+		|| !test_tree_eq (n1->val.anode.children[i],
+				  n2->val.anode.children[i], flags))
+	      return 0;
+	  if (n2->val.anode.children[i] != NULL)
+	    return 0;
+	  n1 = n1->val.anode.children[0];
+	  n2 = n2->val.anode.children[0];
+	  break;
+	default:
+	  return 1;
+	}
+    }
+}
+
 static const char *input;
 static const char *description;
 
@@ -210,4 +319,51 @@ YAEP_UNUSED test_complex_parse
   yaep_free_grammar (g);
 }
 
+/* Grammars whose nonterminals derive the empty string in several
+   ways.  Each rule has its own abstract node translating all its
+   symbols, so each derivation is a different tree. */
+static const char *test_nullable_descs[] YAEP_UNUSED = {
+  "TERM;\n"
+  "A : 'c' 'a'         # ca 1 (0 1)\n"
+  "  | B B             # bb1 2 (0 1)\n"
+  "  | B B             # bb2 3 (0 1)\n"
+  "  ;\n"
+  "B : A 'c'           # ac 1 (0 1)\n"
+  "  |                 # b0 1\n"
+  "  ;\n",
+  "TERM;\n"
+  "A : 'a'             # a1 1 (0)\n"
+  "  |                 # a0 2\n"
+  "  | 'a' B           # ab 1 (0 1)\n"
+  "  ;\n"
+  "B : D 'b' 'b'       # dbb 1 (0 1 2)\n"
+  "  | A C             # ac 1 (0 1)\n"
+  "  ;\n"
+  "C :                 # c0 1\n"
+  "  |                 # c1 2\n"
+  "  | 'c' A C         # cac 1 (0 1 2)\n"
+  "  ;\n"
+  "D : C               # dc 1 (0)\n"
+  "  | 'a' 'b'         # dab 1 (0 1)\n"
+  "  | 'b'             # db 1 (0)\n"
+  "  ;\n",
+};
+
+/* Inputs of the grammars above with the numbers of their derivations
+   and the minimal costs of the derivations. */
+static const struct
+{
+  int desc;
+  const char *input;
+  long n_derivs;
+  int min_cost;
+} test_nullable_inputs[] YAEP_UNUSED = {
+  {0, "c", 8, 8}, {0, "cc", 40, 12}, {0, "cac", 4, 5}, {0, "ccc", 224, 16},
+  {1, "a", 3, 1}, {1, "aa", 6, 4}, {1, "abb", 2, 4}, {1, "aca", 6, 7},
+  {1, "aabb", 4, 7},
+};
+
+#define TEST_N_NULLABLE_INPUTS						\
+  ((int) (sizeof (test_nullable_inputs) / sizeof (test_nullable_inputs[0])))
+
 #endif
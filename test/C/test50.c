@@ -0,0 +1,147 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Parsing in several threads simultaneously with one grammar and a
+   parser for each thread. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define N_THREADS 4
+#define N_PARSES  100
+
+static const char *input = "a+a*(a*a+a)*(a+a)";
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static struct grammar *g;
+static struct yaep_tree_node *reference_root;
+
+/* The current token of the thread. */
+static _Thread_local int thread_ntok;
+
+static int
+thread_read_token (void **attr)
+{
+  *attr = NULL;
+  if (input [thread_ntok])
+    return input [thread_ntok++];
+  return -1;
+}
+
+/* Parse the input several times.  Put error message into *ARG if
+   something is wrong. */
+static void *
+parse_thread (void *arg)
+{
+  const char **result = (const char **) arg;
+  struct yaep_parser *parser;
+  struct yaep_tree_node *root;
+  int i, ambiguous_p;
+
+  *result = NULL;
+  if ((parser = yaep_create_parser (g)) == NULL)
+    {
+      *result = "yaep_create_parser: No memory";
+      return NULL;
+    }
+  for (i = 0; i < N_PARSES; i++)
+    {
+      thread_ntok = 0;
+      if (yaep_parser_parse (parser, thread_read_token, test_syntax_error,
+			     test_parse_alloc, test_parse_free,
+			     &root, &ambiguous_p) != 0)
+	{
+	  *result = yaep_parser_error_message (parser);
+	  return NULL;
+	}
+      if (!test_tree_eq (root, reference_root, 0))
+	{
+	  *result = "different parse trees";
+	  return NULL;
+	}
+      yaep_free_tree (root, test_parse_free, NULL);
+    }
+  yaep_free_parser (parser);
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  pthread_t threads[N_THREADS];
+  const char *results[N_THREADS];
+  int i, ambiguous_p, ok = 1;
+
+  g = test_create_grammar ();
+  if (argc > 1)
+    yaep_set_lookahead_level (g, atoi (argv [1]));
+  test_parse_grammar (g, description);
+  thread_ntok = 0;
+  if (yaep_parse (g, thread_read_token, test_syntax_error, test_parse_alloc,
+		  test_parse_free, &reference_root, &ambiguous_p))
+    {
+      fprintf (stderr, "yaep parse: %s\n", yaep_error_message (g));
+      exit (1);
+    }
+  for (i = 0; i < N_THREADS; i++)
+    if (pthread_create (&threads[i], NULL, parse_thread, &results[i]) != 0)
+      {
+	fprintf (stderr, "pthread_create failed\n");
+	exit (1);
+      }
+  for (i = 0; i < N_THREADS; i++)
+    {
+      pthread_join (threads[i], NULL);
+      if (results[i] != NULL)
+	{
+	  fprintf (stderr, "thread %d: %s\n", i, results[i]);
+	  ok = 0;
+	}
+    }
+  yaep_free_tree (reference_root, test_parse_free, NULL);
+  yaep_free_grammar (g);
+  if (!ok)
+    exit (1);
+  fprintf (stderr, "%d threads: all parses are the same\n", N_THREADS);
+  exit (0);
+}
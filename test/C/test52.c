@@ -0,0 +1,192 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Parsing several inputs many times with the parse cache and
+   comparing the results with ones without the cache. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define N_PARSES 20
+
+static const char *inputs[] =
+  {
+    "a+a*(a*a+a)*(a+a)",
+    "a*a",
+    "(a+a",
+    "a+a*a+a",
+    "a++a*(a+a)",
+    "((a))*a+a",
+  };
+
+#define N_INPUTS ((int) (sizeof (inputs) / sizeof (inputs[0])))
+
+static const char *curr_input;
+static int ntok, n_errors;
+
+static int
+read_token (void **attr)
+{
+  *attr = NULL;
+  if (curr_input [ntok])
+    return curr_input [ntok++];
+  return -1;
+}
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  n_errors++;
+}
+
+static struct grammar *
+create_grammar (int lookahead_level, size_t cache_limit)
+{
+  struct grammar *g;
+
+  g = test_create_grammar ();
+  yaep_set_lookahead_level (g, lookahead_level);
+  yaep_set_parse_cache_limit (g, cache_limit);
+  test_parse_grammar (g, description);
+  return g;
+}
+
+/* Parse input I by G (or PARSER if it is not NULL) and return the
+   tree.  Put number of syntax errors into *N_ERRS. */
+static struct yaep_tree_node *
+parse (struct grammar *g, struct yaep_parser *parser, int i, int *n_errs)
+{
+  struct yaep_tree_node *root;
+  int ambiguous_p, code;
+
+  curr_input = inputs[i];
+  ntok = n_errors = 0;
+  if (parser == NULL)
+    code = yaep_parse (g, read_token, count_syntax_error, test_parse_alloc,
+		       test_parse_free, &root, &ambiguous_p);
+  else
+    code = yaep_parser_parse (parser, read_token, count_syntax_error,
+			      test_parse_alloc, test_parse_free,
+			      &root, &ambiguous_p);
+  if (code != 0)
+    {
+      fprintf (stderr, "yaep parse: %s\n",
+	       parser == NULL ? yaep_error_message (g)
+	       : yaep_parser_error_message (parser));
+      exit (1);
+    }
+  *n_errs = n_errors;
+  return root;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct grammar *g, *cached_g, *small_cached_g;
+  struct yaep_parser *parser;
+  struct yaep_tree_node *reference_roots[N_INPUTS], *root;
+  int reference_n_errors[N_INPUTS];
+  int i, n, n_errs, level = argc > 1 ? atoi (argv [1]) : 1;
+
+  description =
+    "\n"
+    "TERM;\n"
+    "E : T         # 0\n"
+    "  | E '+' T   # plus (0 2)\n"
+    "  ;\n"
+    "T : F         # 0\n"
+    "  | T '*' F   # mult (0 2)\n"
+    "  ;\n"
+    "F : 'a'       # 0\n"
+    "  | '(' E ')' # 1\n"
+    "  | error     # 0\n"
+    "  ;\n";
+  g = create_grammar (level, 0);
+  cached_g = create_grammar (level, 1 << 20);
+  small_cached_g = create_grammar (level, 1);
+  if ((parser = yaep_create_parser (cached_g)) == NULL)
+    {
+      fprintf (stderr, "yaep_create_parser: No memory\n");
+      exit (1);
+    }
+  for (i = 0; i < N_INPUTS; i++)
+    reference_roots[i] = parse (g, NULL, i, &reference_n_errors[i]);
+  for (n = 0; n < N_PARSES; n++)
+    {
+      if (n == N_PARSES / 2)
+	{
+	  yaep_flush_parse_cache (cached_g);
+	  yaep_parser_flush_cache (parser);
+	}
+      for (i = 0; i < N_INPUTS; i++)
+	{
+	  root = parse (cached_g, NULL, i, &n_errs);
+	  if (!test_tree_eq (root, reference_roots[i], 0)
+	      || n_errs != reference_n_errors[i])
+	    {
+	      fprintf (stderr, "different parse of `%s'\n", inputs[i]);
+	      exit (1);
+	    }
+	  yaep_free_tree (root, test_parse_free, NULL);
+	  root = parse (cached_g, parser, i, &n_errs);
+	  if (!test_tree_eq (root, reference_roots[i], 0)
+	      || n_errs != reference_n_errors[i])
+	    {
+	      fprintf (stderr, "different parser parse of `%s'\n", inputs[i]);
+	      exit (1);
+	    }
+	  yaep_free_tree (root, test_parse_free, NULL);
+	  root = parse (small_cached_g, NULL, i, &n_errs);
+	  if (!test_tree_eq (root, reference_roots[i], 0)
+	      || n_errs != reference_n_errors[i])
+	    {
+	      fprintf (stderr, "different parse of `%s' with small cache\n",
+		       inputs[i]);
+	      exit (1);
+	    }
+	  yaep_free_tree (root, test_parse_free, NULL);
+	}
+    }
+  for (i = 0; i < N_INPUTS; i++)
+    yaep_free_tree (reference_roots[i], test_parse_free, NULL);
+  yaep_free_parser (parser);
+  yaep_free_grammar (small_cached_g);
+  yaep_free_grammar (cached_g);
+  yaep_free_grammar (g);
+  fprintf (stderr, "all parses with the parse cache are the same\n");
+  exit (0);
+}
@@ -0,0 +1,238 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Parsing inputs with the push interface feeding tokens by chunks of
+   different sizes and comparing the results with ones of
+   yaep_parse. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+static const char *inputs[] =
+  {
+    "a+a*(a*a+a)*(a+a)",
+    "a*a",
+    "(a+a",
+    "a+a*a+a",
+    "a++a*(a+a)",
+    "((a))*a+a",
+    "a)a+a+a+a+a",
+    "",
+  };
+
+#define N_INPUTS ((int) (sizeof (inputs) / sizeof (inputs[0])))
+
+static const int chunk_sizes[] = {1, 2, 3, 7, 1000};
+
+#define N_CHUNK_SIZES ((int) (sizeof (chunk_sizes) / sizeof (chunk_sizes[0])))
+
+static char curr_input[100];
+static int ntok, n_errors, n_feed_errors, feeding_p;
+
+static int
+read_token (void **attr)
+{
+  *attr = &curr_input [ntok];
+  if (curr_input [ntok])
+    return curr_input [ntok++];
+  return -1;
+}
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  if (curr_input[err_tok_num] != '\0'
+      && *(char *) err_tok_attr != curr_input[err_tok_num])
+    {
+      fprintf (stderr, "wrong error token attribute at %d\n", err_tok_num);
+      exit (1);
+    }
+  n_errors++;
+  if (feeding_p)
+    n_feed_errors++;
+}
+
+static struct grammar *
+create_grammar (int lookahead_level, int recovery_p)
+{
+  struct grammar *g;
+
+  g = test_create_grammar ();
+  yaep_set_lookahead_level (g, lookahead_level);
+  yaep_set_error_recovery_flag (g, recovery_p);
+  test_parse_grammar (g, description);
+  return g;
+}
+
+/* Parse input I by PARSER feeding tokens by chunks of CHUNK_SIZE and
+   return the tree.  Put number of syntax errors into *N_ERRS. */
+static struct yaep_tree_node *
+push_parse (struct yaep_parser *parser, int i, int chunk_size, int *n_errs)
+{
+  struct yaep_tree_node *root;
+  int codes[1000];
+  void *attrs[1000];
+  int ambiguous_p, code, n, len, start;
+
+  strcpy (curr_input, inputs[i]);
+  n_errors = n_feed_errors = 0;
+  if (yaep_parse_begin (parser, count_syntax_error, test_parse_alloc,
+			test_parse_free) != 0)
+    {
+      fprintf (stderr, "yaep_parse_begin: %s\n",
+	       yaep_parser_error_message (parser));
+      exit (1);
+    }
+  len = (int) strlen (curr_input);
+  feeding_p = 1;
+  for (start = 0; start < len; start += n)
+    {
+      n = len - start < chunk_size ? len - start : chunk_size;
+      for (code = 0; code < n; code++)
+	{
+	  codes[code] = curr_input[start + code];
+	  attrs[code] = &curr_input[start + code];
+	}
+      if (yaep_parse_feed (parser, n, codes, attrs) != 0)
+	{
+	  fprintf (stderr, "yaep_parse_feed: %s\n",
+		   yaep_parser_error_message (parser));
+	  exit (1);
+	}
+    }
+  feeding_p = 0;
+  if (yaep_parse_end (parser, &root, &ambiguous_p) != 0)
+    {
+      fprintf (stderr, "yaep_parse_end: %s\n",
+	       yaep_parser_error_message (parser));
+      exit (1);
+    }
+  *n_errs = n_errors;
+  return root;
+}
+
+/* Check push parses of all inputs by G with a parser. */
+static void
+check (struct grammar *g, int recovery_p)
+{
+  struct yaep_parser *parser;
+  struct yaep_tree_node *reference_root, *root;
+  int reference_n_errors, ambiguous_p, i, k, n_errs;
+
+  if ((parser = yaep_create_parser (g)) == NULL)
+    {
+      fprintf (stderr, "yaep_create_parser: No memory\n");
+      exit (1);
+    }
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      strcpy (curr_input, inputs[i]);
+      ntok = n_errors = 0;
+      feeding_p = 0;
+      if (yaep_parse (g, read_token, count_syntax_error, test_parse_alloc,
+		      test_parse_free, &reference_root, &ambiguous_p) != 0)
+	{
+	  fprintf (stderr, "yaep_parse: %s\n", yaep_error_message (g));
+	  exit (1);
+	}
+      reference_n_errors = n_errors;
+      for (k = 0; k < N_CHUNK_SIZES; k++)
+	{
+	  root = push_parse (parser, i, chunk_sizes[k], &n_errs);
+	  if (!test_tree_eq (root, reference_root, 0)
+	      || n_errs != reference_n_errors)
+	    {
+	      fprintf (stderr, "different push parse of `%s' by %d tokens\n",
+		       inputs[i], chunk_sizes[k]);
+	      exit (1);
+	    }
+	  /* Without error recovery a syntax error before the last
+	     token is reported by a feed. */
+	  if (!recovery_p && i == 4 && n_feed_errors != 1)
+	    {
+	      fprintf (stderr, "late syntax error for `%s' by %d tokens\n",
+		       inputs[i], chunk_sizes[k]);
+	      exit (1);
+	    }
+	  yaep_free_tree (root, test_parse_free, NULL);
+	}
+      yaep_free_tree (reference_root, test_parse_free, NULL);
+    }
+  /* An invalid token code finishes the parse. */
+  {
+    int codes[] = {'a', '+', 1000};
+
+    if (yaep_parse_begin (parser, count_syntax_error, NULL, NULL) != 0
+	|| yaep_parse_feed (parser, 3, codes, NULL) != YAEP_INVALID_TOKEN_CODE
+	|| yaep_parser_error_code (parser) != YAEP_INVALID_TOKEN_CODE)
+      {
+	fprintf (stderr, "invalid token code is not reported\n");
+	exit (1);
+      }
+  }
+  root = push_parse (parser, 0, 1, &n_errs);
+  yaep_free_tree (root, test_parse_free, NULL);
+  yaep_free_parser (parser);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct grammar *g, *no_recovery_g;
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+
+  description =
+    "\n"
+    "TERM;\n"
+    "E : T         # 0\n"
+    "  | E '+' T   # plus (0 2)\n"
+    "  ;\n"
+    "T : F         # 0\n"
+    "  | T '*' F   # mult (0 2)\n"
+    "  ;\n"
+    "F : 'a'       # 0\n"
+    "  | '(' E ')' # 1\n"
+    "  | error     # 0\n"
+    "  ;\n";
+  g = create_grammar (level, 1);
+  no_recovery_g = create_grammar (level, 0);
+  check (g, 1);
+  check (no_recovery_g, 0);
+  yaep_free_grammar (no_recovery_g);
+  yaep_free_grammar (g);
+  fprintf (stderr, "all push parses are the same\n");
+  exit (0);
+}
@@ -0,0 +1,249 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Parsing with and without Leo items and comparing the results. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+/* Nesting depth of the right recursions in the long inputs. */
+#define DEPTH 500
+
+static char *curr_input;
+static int ntok, n_errors;
+
+static int
+read_token (void **attr)
+{
+  *attr = &curr_input [ntok];
+  if (curr_input [ntok])
+    return curr_input [ntok++];
+  return -1;
+}
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  n_errors++;
+}
+
+/* Return new input consisting of PREFIX, COUNT copies of REPEAT, and
+   SUFFIX. */
+static char *
+make_input (const char *prefix, const char *repeat, int count,
+	    const char *suffix)
+{
+  size_t repeat_len = strlen (repeat);
+  char *str, *p;
+  int i;
+
+  str = (char *) malloc (strlen (prefix) + repeat_len * (size_t) count
+			 + strlen (suffix) + 1);
+  assert (str != NULL);
+  strcpy (str, prefix);
+  p = str + strlen (prefix);
+  for (i = 0; i < count; i++, p += repeat_len)
+    memcpy (p, repeat, repeat_len);
+  strcpy (p, suffix);
+  return str;
+}
+
+/* Parse STR by G and return the tree. */
+static struct yaep_tree_node *
+parse (struct grammar *g, char *str, int *ambiguous_p)
+{
+  struct yaep_tree_node *root;
+
+  curr_input = str;
+  ntok = n_errors = 0;
+  if (yaep_parse (g, read_token, count_syntax_error, test_parse_alloc,
+		  test_parse_free, &root, ambiguous_p) != 0)
+    {
+      fprintf (stderr, "yaep_parse: %s\n", yaep_error_message (g));
+      exit (1);
+    }
+  return root;
+}
+
+/* Check parses of INPUTS by grammar with description DESCR with and
+   without Leo items.  Leo items should also shrink Earley's sets of
+   input with index LEO_INPUT containing a deep right recursion. */
+static void
+check (int lookahead_level, const char *descr, char **inputs,
+       int leo_input)
+{
+  struct grammar *g;
+  struct yaep_tree_node *reference_root, *root;
+  struct yaep_parse_stats reference_stats, stats;
+  int reference_n_errors, reference_ambiguous_p, ambiguous_p;
+  int i, one_parse_p, cache_p;
+
+  g = test_create_grammar ();
+  yaep_set_lookahead_level (g, lookahead_level);
+  test_parse_grammar (g, descr);
+  if (yaep_set_leo_flag (g, 1) != 0 || yaep_set_leo_flag (g, 0) != 1)
+    {
+      fprintf (stderr, "wrong Leo flag value\n");
+      exit (1);
+    }
+  for (one_parse_p = 0; one_parse_p <= 1; one_parse_p++)
+    for (cache_p = 0; cache_p <= 1; cache_p++)
+      {
+	yaep_set_one_parse_flag (g, one_parse_p);
+	yaep_set_parse_cache_limit (g, cache_p ? 1 << 24 : 0);
+	for (i = 0; inputs[i] != NULL; i++)
+	  {
+	    yaep_set_leo_flag (g, 0);
+	    reference_root = parse (g, inputs[i], &reference_ambiguous_p);
+	    reference_n_errors = n_errors;
+	    yaep_get_parse_stats (g, 0, &reference_stats);
+	    yaep_set_leo_flag (g, 1);
+	    root = parse (g, inputs[i], &ambiguous_p);
+	    yaep_get_parse_stats (g, 0, &stats);
+	    if (!test_tree_eq (reference_root, root, TEST_TREE_ATTRS)
+		|| ambiguous_p != reference_ambiguous_p
+		|| n_errors != reference_n_errors)
+	      {
+		fprintf (stderr, "different parse with Leo items of `%.40s'\n",
+			 inputs[i]);
+		exit (1);
+	      }
+	    /* The Leo flag is ignored for the dynamic lookahead.  The
+	       statistics include the sets of the previous parses if the
+	       parse cache is used. */
+	    if (i == leo_input && lookahead_level <= 1 && !cache_p
+		&& (stats.n_leo_items == 0
+		    || (10 * stats.n_sets_start_sits
+			>= reference_stats.n_sets_start_sits)))
+	      {
+		fprintf (stderr, "Leo items do not shrink sets of `%.40s'\n",
+			 inputs[i]);
+		exit (1);
+	      }
+	    yaep_free_tree (root, test_parse_free, NULL);
+	    yaep_free_tree (reference_root, test_parse_free, NULL);
+	  }
+      }
+  yaep_free_grammar (g);
+}
+
+/* Check parses by all test grammars with lookahead LEVEL. */
+static void
+check_grammars (int level)
+{
+  int i;
+  char *inputs[10];
+
+  /* Chains of assignments and statement lists. */
+  inputs[0] = make_input ("", "a=", 3, "a;a;");
+  inputs[1] = make_input ("", "a=", DEPTH, "a;");
+  inputs[2] = make_input ("", "a;", DEPTH, "");
+  inputs[3] = make_input ("", "a=(a=", DEPTH / 2, "a");
+  inputs[4] = make_input (inputs[3], ")", DEPTH / 2, ";a=a;");
+  inputs[5] = make_input ("a=a;", "a=", DEPTH, "=a;a=a;");
+  inputs[6] = make_input ("a==a;", "a=", 10, "a;;a=a;");
+  inputs[7] = make_input ("", "", 0, "");
+  inputs[8] = NULL;
+  check (level,
+	 "\n"
+	 "TERM;\n"
+	 "P : S         # 0\n"
+	 "  ;\n"
+	 "S : st S      # seq (0 1)\n"
+	 "  |           # -\n"
+	 "  ;\n"
+	 "st : E ';'    # 0\n"
+	 "   | error ';' # 0\n"
+	 "   ;\n"
+	 "E : 'a' '=' E # assign (0 2)\n"
+	 "  | 'a'       # 0\n"
+	 "  | '(' E ')' # 1\n"
+	 "  ;\n",
+	 inputs, 1);
+  for (i = 0; inputs[i] != NULL; i++)
+    free (inputs[i]);
+  /* Mutual right recursion. */
+  inputs[0] = make_input ("", "xy", DEPTH, "z");
+  inputs[1] = make_input ("", "xy", DEPTH, "xyy");
+  inputs[2] = make_input ("x", "yx", DEPTH, "");
+  inputs[3] = make_input ("", "xy", DEPTH, "y");
+  inputs[4] = NULL;
+  check (level,
+	 "\n"
+	 "TERM;\n"
+	 "A : 'x' B     # a (1)\n"
+	 "  | 'z'       # 0\n"
+	 "  | error     # 0\n"
+	 "  ;\n"
+	 "B : 'y' A     # b (1)\n"
+	 "  | 'y'       # 0\n"
+	 "  ;\n",
+	 inputs, 0);
+  for (i = 0; inputs[i] != NULL; i++)
+    free (inputs[i]);
+  /* Ambiguous bottom of a right recursion. */
+  inputs[0] = make_input ("", "a", DEPTH, "b");
+  inputs[1] = make_input ("", "a", 3, "bb");
+  inputs[2] = NULL;
+  check (level,
+	 "\n"
+	 "TERM;\n"
+	 "S : 'a' S     # s (0 1)\n"
+	 "  | X         # 0\n"
+	 "  ;\n"
+	 "X : 'b'       # x (0)\n"
+	 "  | Y         # 0\n"
+	 "  ;\n"
+	 "Y : 'b'       # y (0)\n"
+	 "  ;\n",
+	 inputs, 0);
+  for (i = 0; inputs[i] != NULL; i++)
+    free (inputs[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+
+  check_grammars (level);
+  if (level == 1)
+    check_grammars (0);
+  fprintf (stderr, "all parses with Leo items are the same\n");
+  exit (0);
+}
@@ -0,0 +1,355 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Saving grammars into compiled grammar files, loading them, and
+   comparing parses by the loaded and the original grammars. */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+static const char *curr_input;
+static int ntok, n_errors;
+
+/* The following is prefix of the compiled grammar file name. */
+#define TEST_NAME "test56"
+
+/* Name of the compiled grammar file.  It depends on the test and
+   the lookahead level, so the tests can be run in parallel. */
+static char path[100];
+
+static int
+read_token (void **attr)
+{
+  *attr = NULL;
+  if (curr_input [ntok])
+    return curr_input [ntok++];
+  return -1;
+}
+
+static void
+count_syntax_error (int err_tok_num, void *err_tok_attr,
+		    int start_ignored_tok_num, void *start_ignored_tok_attr,
+		    int start_recovered_tok_num, void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+  n_errors++;
+}
+
+/* Parse STR by G and return the tree. */
+static struct yaep_tree_node *
+parse (struct grammar *g, const char *str, int *ambiguous_p)
+{
+  struct yaep_tree_node *root;
+
+  curr_input = str;
+  ntok = n_errors = 0;
+  if (yaep_parse (g, read_token, count_syntax_error, test_parse_alloc,
+		  test_parse_free, &root, ambiguous_p) != 0)
+    {
+      fprintf (stderr, "yaep_parse: %s\n", yaep_error_message (g));
+      exit (1);
+    }
+  return root;
+}
+
+/* Return contents of file PATH and its size in *SIZE. */
+static char *
+read_file (size_t *size)
+{
+  FILE *f;
+  char *contents;
+  long len;
+
+  if ((f = fopen (path, "rb")) == NULL || fseek (f, 0, SEEK_END) != 0
+      || (len = ftell (f)) < 0 || fseek (f, 0, SEEK_SET) != 0)
+    {
+      fprintf (stderr, "can not read %s\n", path);
+      exit (1);
+    }
+  contents = (char *) malloc ((size_t) len + 1);
+  assert (contents != NULL);
+  *size = fread (contents, 1, (size_t) len, f);
+  fclose (f);
+  return contents;
+}
+
+/* Write SIZE bytes of CONTENTS into file PATH. */
+static void
+write_file (const char *contents, size_t size)
+{
+  FILE *f;
+
+  if ((f = fopen (path, "wb")) == NULL
+      || fwrite (contents, 1, size, f) != size || fclose (f) != 0)
+    {
+      fprintf (stderr, "can not write %s\n", path);
+      exit (1);
+    }
+}
+
+/* Check that loading file PATH into G fails with error CODE and
+   that G can not be used for parsing after that. */
+static void
+check_load_error (struct grammar *g, int code)
+{
+  struct yaep_tree_node *root;
+  int ambiguous_p;
+
+  if (yaep_load_compiled_grammar (g, path) != code
+      || yaep_error_code (g) != code)
+    {
+      fprintf (stderr, "wrong error for bad compiled grammar: %s\n",
+	       yaep_error_message (g));
+      exit (1);
+    }
+  curr_input = "a";
+  ntok = 0;
+  if (yaep_parse (g, read_token, count_syntax_error, test_parse_alloc,
+		  test_parse_free, &root, &ambiguous_p)
+      != YAEP_UNDEFINED_OR_BAD_GRAMMAR)
+    {
+      fprintf (stderr, "parse by badly loaded grammar\n");
+      exit (1);
+    }
+}
+
+/* Check parses of INPUTS by grammar with description DESCR and by
+   the grammar loaded into LOADED from the compiled grammar file. */
+static void
+check (struct grammar *loaded, int lookahead_level, const char *descr,
+       const char **inputs)
+{
+  struct grammar *g;
+  struct yaep_tree_node *reference_root, *root;
+  int reference_n_errors, reference_ambiguous_p, ambiguous_p;
+  int i, one_parse_p;
+  char *contents, *copy;
+  size_t size, copy_size;
+
+  g = test_create_grammar ();
+  if (yaep_save_compiled_grammar (g, path) != YAEP_UNDEFINED_OR_BAD_GRAMMAR)
+    {
+      fprintf (stderr, "saving undefined grammar\n");
+      exit (1);
+    }
+  yaep_set_lookahead_level (g, lookahead_level);
+  yaep_set_lookahead_level (loaded, lookahead_level);
+  yaep_set_cost_flag (g, 1);
+  yaep_set_cost_flag (loaded, 1);
+  if (yaep_parse_grammar (g, 1, descr) != 0
+      || yaep_save_compiled_grammar (g, path) != 0
+      || yaep_load_compiled_grammar (loaded, path) != 0)
+    {
+      fprintf (stderr, "%s %s\n", yaep_error_message (g),
+	       yaep_error_message (loaded));
+      exit (1);
+    }
+  /* The loaded grammar is saved into the same file. */
+  contents = read_file (&size);
+  if (yaep_save_compiled_grammar (loaded, path) != 0)
+    {
+      fprintf (stderr, "%s\n", yaep_error_message (loaded));
+      exit (1);
+    }
+  copy = read_file (&copy_size);
+  if (size != copy_size || memcmp (contents, copy, size) != 0)
+    {
+      fprintf (stderr, "different compiled grammar files\n");
+      exit (1);
+    }
+  free (copy);
+  for (one_parse_p = 0; one_parse_p <= 1; one_parse_p++)
+    {
+      yaep_set_one_parse_flag (g, one_parse_p);
+      yaep_set_one_parse_flag (loaded, one_parse_p);
+      for (i = 0; inputs[i] != NULL; i++)
+	{
+	  reference_root = parse (g, inputs[i], &reference_ambiguous_p);
+	  reference_n_errors = n_errors;
+	  root = parse (loaded, inputs[i], &ambiguous_p);
+	  if (!test_tree_eq (reference_root, root,
+			     TEST_TREE_ATTRS | TEST_TREE_COSTS)
+	      || ambiguous_p != reference_ambiguous_p
+	      || n_errors != reference_n_errors)
+	    {
+	      fprintf (stderr, "different parse of `%s'\n", inputs[i]);
+	      exit (1);
+	    }
+	  yaep_free_tree (root, test_parse_free, NULL);
+	  yaep_free_tree (reference_root, test_parse_free, NULL);
+	}
+    }
+  yaep_free_grammar (g);
+  /* Corrupted files. */
+  write_file (contents, size / 2);
+  check_load_error (loaded, YAEP_BAD_COMPILED_GRAMMAR);
+  contents[0] = 'X';
+  write_file (contents, size);
+  check_load_error (loaded, YAEP_BAD_COMPILED_GRAMMAR);
+  write_file (descr, strlen (descr));
+  check_load_error (loaded, YAEP_BAD_COMPILED_GRAMMAR);
+  free (contents);
+}
+
+/* Check that compiled grammar files with wrong rule translations can
+   not be loaded into LOADED and that a grammar with too many nil
+   translations can not be saved. */
+static void
+check_bad_translation (struct grammar *loaded)
+{
+  /* The grammars differ only in the translation length of the rule
+     for S, so their files differ only in the length. */
+  static const char *descrs[2] = {
+    "\nTERM a;\nS : a # s (0)\n  ;\n",
+    "\nTERM a;\nS : a # s (0 -)\n  ;\n"
+  };
+  struct grammar *g;
+  char *contents[2], descr[4000];
+  size_t sizes[2], i, trans_len_offset;
+  int k, value;
+
+  for (k = 0; k < 2; k++)
+    {
+      g = test_create_grammar ();
+      if (yaep_parse_grammar (g, 1, descrs[k]) != 0
+	  || yaep_save_compiled_grammar (g, path) != 0)
+	{
+	  fprintf (stderr, "%s\n", yaep_error_message (g));
+	  exit (1);
+	}
+      yaep_free_grammar (g);
+      contents[k] = read_file (&sizes[k]);
+    }
+  for (i = 0; i < sizes[0] && contents[0][i] == contents[1][i]; i++)
+    ;
+  if (sizes[0] != sizes[1] || i == sizes[0])
+    {
+      fprintf (stderr, "unexpected compiled grammar files\n");
+      exit (1);
+    }
+  /* The abstract node name offset is two integers before the
+     translation length. */
+  trans_len_offset = i / sizeof (int) * sizeof (int);
+  value = INT_MAX;
+  memcpy (contents[0] + trans_len_offset, &value, sizeof (int));
+  write_file (contents[0], sizes[0]);
+  check_load_error (loaded, YAEP_BAD_COMPILED_GRAMMAR);
+  value = -1;
+  memcpy (contents[1] + trans_len_offset - 2 * sizeof (int), &value,
+	  sizeof (int));
+  write_file (contents[1], sizes[1]);
+  check_load_error (loaded, YAEP_BAD_COMPILED_GRAMMAR);
+  /* Rule without abstract node translated into its symbol is ok. */
+  value = 1;
+  memcpy (contents[0] + trans_len_offset, &value, sizeof (int));
+  value = -1;
+  memcpy (contents[0] + trans_len_offset - 2 * sizeof (int), &value,
+	  sizeof (int));
+  write_file (contents[0], sizes[0]);
+  if (yaep_load_compiled_grammar (loaded, path) != 0)
+    {
+      fprintf (stderr, "%s\n", yaep_error_message (loaded));
+      exit (1);
+    }
+  free (contents[0]);
+  free (contents[1]);
+  strcpy (descr, "\nTERM a;\nS : a # s (0");
+  for (k = 0; k <= 1024; k++)
+    strcat (descr, " -");
+  strcat (descr, ")\n  ;\n");
+  g = test_create_grammar ();
+  if (yaep_parse_grammar (g, 1, descr) != 0
+      || yaep_save_compiled_grammar (g, path) != YAEP_INCORRECT_TRANSLATION)
+    {
+      fprintf (stderr, "saving rule with too many nil translations\n");
+      exit (1);
+    }
+  yaep_free_grammar (g);
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+  struct grammar *loaded;
+  const char *inputs[10];
+
+  sprintf (path, "%s-%d.cgr", TEST_NAME, level);
+  loaded = test_create_grammar ();
+  inputs[0] = "a=a;a=(a=a);";
+  inputs[1] = "a==a;a=a;a;";
+  inputs[2] = ";";
+  inputs[3] = "";
+  inputs[4] = NULL;
+  check (loaded, level,
+	 "\n"
+	 "TERM;\n"
+	 "P : S         # 0\n"
+	 "  ;\n"
+	 "S : st S      # seq (0 1)\n"
+	 "  |           # -\n"
+	 "  ;\n"
+	 "st : E ';'    # 0\n"
+	 "   | error ';' # 0\n"
+	 "   ;\n"
+	 "E : 'a' '=' E # assign 2 (0 2)\n"
+	 "  | 'a'       # 0\n"
+	 "  | '(' E ')' # 1\n"
+	 "  ;\n",
+	 inputs);
+  /* Ambiguous grammar with costs and sparse terminal codes. */
+  inputs[0] = "a";
+  inputs[1] = "aaaa";
+  inputs[2] = "aaa";
+  inputs[3] = NULL;
+  check (loaded, level,
+	 "\n"
+	 "TERM a=97 z=1000000;\n"
+	 "S : S S       # s 1 (0 1)\n"
+	 "  | a         # a (0)\n"
+	 "  | a a       # aa 3 (0 - 1)\n"
+	 "  | z         # z (0)\n"
+	 "  ;\n",
+	 inputs);
+  check_bad_translation (loaded);
+  yaep_free_grammar (loaded);
+  remove (path);
+  loaded = test_create_grammar ();
+  check_load_error (loaded, YAEP_COMPILED_GRAMMAR_IO_ERROR);
+  yaep_free_grammar (loaded);
+  fprintf (stderr, "compiled grammars parse the same\n");
+  exit (0);
+}
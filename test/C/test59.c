@@ -0,0 +1,186 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+/* Checking that repeated parses of small inputs do not allocate
+   memory after the first parses (the parse workspace reuse).  The
+   allocations are counted by wrapping the allocation functions with
+   the GNU linker (YAEP_TEST_WRAP_ALLOC).  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : E '+' T # plus (0 2)\n"
+"  | T       # 0\n"
+"  ;\n"
+"T : T '*' F # mult (0 2)\n"
+"  | F       # 0\n"
+"  ;\n"
+"F : 'a'     # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n";
+
+static const char *inputs[] = {
+  "a+a*(a+a)*a+a*a+(a*a+a)*(a+(a*a)+a)+a*a*a+(a)+a+a*a+a",
+  "a*(a+a)",
+  "(a+a*a)*(a+a*a+a)+a*a*a*a+a+(((a+a)))*a",
+};
+#define N_INPUTS ((int) (sizeof (inputs) / sizeof (inputs[0])))
+
+/* Number of rounds of parsing all inputs before and during counting
+   the allocations. */
+#define WARM_UP_ROUNDS 3
+#define ROUNDS 10
+
+static int alloc_counting_p;
+static long n_allocs;
+
+#ifdef YAEP_TEST_WRAP_ALLOC
+
+void *__real_malloc (size_t size);
+void *__real_calloc (size_t nmemb, size_t size);
+void *__real_realloc (void *ptr, size_t size);
+void *__wrap_malloc (size_t size);
+void *__wrap_calloc (size_t nmemb, size_t size);
+void *__wrap_realloc (void *ptr, size_t size);
+
+void *
+__wrap_malloc (size_t size)
+{
+  n_allocs += alloc_counting_p;
+  return __real_malloc (size);
+}
+
+void *
+__wrap_calloc (size_t nmemb, size_t size)
+{
+  n_allocs += alloc_counting_p;
+  return __real_calloc (nmemb, size);
+}
+
+void *
+__wrap_realloc (void *ptr, size_t size)
+{
+  n_allocs += alloc_counting_p;
+  return __real_realloc (ptr, size);
+}
+
+#endif
+
+/* Parse input I by grammar G (if PARSER is NULL) or by PARSER (with
+   the push interface if PUSH_P).  The tree is allocated in the arena
+   of the grammar or the parser. */
+static void
+parse (struct grammar *g, struct yaep_parser *parser, int push_p, int i)
+{
+  int codes[100], n, ambiguous_p, code;
+  struct yaep_tree_node *root;
+
+  for (n = 0; inputs[i][n] != '\0'; n++)
+    codes[n] = inputs[i][n];
+  if (parser == NULL)
+    code = yaep_parse_tokens (g, n, codes, NULL, test_syntax_error,
+			      NULL, NULL, &root, &ambiguous_p);
+  else if (!push_p)
+    code = yaep_parser_parse_tokens (parser, n, codes, NULL,
+				     test_syntax_error, NULL, NULL,
+				     &root, &ambiguous_p);
+  else if ((code = yaep_parse_begin (parser, test_syntax_error,
+				     NULL, NULL)) == 0
+	   && (code = yaep_parse_feed (parser, n, codes, NULL)) == 0)
+    code = yaep_parse_end (parser, &root, &ambiguous_p);
+  if (code != 0 || root == NULL || ambiguous_p)
+    test_fail ("parse error");
+}
+
+/* Parse all inputs ROUNDS times after the warm-up and return the
+   number of allocations during the counted rounds. */
+static long
+count_allocs (struct grammar *g, struct yaep_parser *parser, int push_p,
+	      struct yaep_tree_arena *arena)
+{
+  int round, i;
+
+  n_allocs = 0;
+  for (round = 0; round < WARM_UP_ROUNDS + ROUNDS; round++)
+    {
+      alloc_counting_p = round >= WARM_UP_ROUNDS;
+      for (i = 0; i < N_INPUTS; i++)
+	{
+	  parse (g, parser, push_p, i);
+	  yaep_reset_tree_arena (arena);
+	}
+    }
+  alloc_counting_p = 0;
+  return n_allocs;
+}
+
+int
+main (int argc, char **argv)
+{
+  int level = argc > 1 ? atoi (argv [1]) : 1;
+  struct grammar *g;
+  struct yaep_parser *parser;
+  struct yaep_tree_arena *arena;
+
+  g = test_create_grammar ();
+  yaep_set_lookahead_level (g, level);
+  test_parse_grammar (g, description);
+  if ((arena = yaep_create_tree_arena ()) == NULL)
+    test_fail ("yaep_create_tree_arena: No memory");
+  yaep_set_tree_arena (g, arena);
+  if (count_allocs (g, NULL, 0, arena) != 0)
+    test_fail ("yaep_parse_tokens allocates memory after warm-up");
+  /* The same with the parse cache. */
+  yaep_set_parse_cache_limit (g, 1 << 24);
+  if (count_allocs (g, NULL, 0, arena) != 0)
+    test_fail ("yaep_parse_tokens with the parse cache allocates memory "
+               "after warm-up");
+  yaep_set_parse_cache_limit (g, 0);
+  if ((parser = yaep_create_parser (g)) == NULL)
+    test_fail (yaep_error_message (g));
+  yaep_parser_set_tree_arena (parser, arena);
+  if (count_allocs (g, parser, 0, arena) != 0)
+    test_fail ("yaep_parser_parse_tokens allocates memory after warm-up");
+  if (count_allocs (g, parser, 1, arena) != 0)
+    test_fail ("the push interface allocates memory after warm-up");
+  /* Flushing frees the workspace which is created again. */
+  yaep_parser_flush_cache (parser);
+  if (count_allocs (g, parser, 0, arena) != 0)
+    test_fail ("yaep_parser_parse_tokens allocates memory after flush and "
+               "warm-up");
+  yaep_free_parser (parser);
+  yaep_free_grammar (g);
+  yaep_free_tree_arena (arena);
+  fprintf (stderr, "parses do not allocate memory after warm-up\n");
+  exit (0);
+}
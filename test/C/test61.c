@@ -0,0 +1,243 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* The shared memo: parsers in several threads publish set cores and
+   goto sets into the memo of the frozen grammar, their trees are the
+   same as without the memo, and a new parser of the grammar forms no
+   set cores for the same inputs. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define N_THREADS 4
+#define N_INPUTS 60
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static struct grammar *g;
+static int lookahead_level = 1;
+static int n_input_toks[N_INPUTS];
+static int *input_codes[N_INPUTS];
+static struct yaep_tree_node *reference_roots[N_INPUTS];
+static int reference_codes[N_INPUTS];
+
+static void
+memo_syntax_error (int err_tok_num, void *err_tok_attr,
+		   int start_ignored_tok_num, void *start_ignored_tok_attr,
+		   int start_recovered_tok_num,
+		   void *start_recovered_tok_attr)
+{
+  (void) err_tok_num;
+  (void) err_tok_attr;
+  (void) start_ignored_tok_num;
+  (void) start_ignored_tok_attr;
+  (void) start_recovered_tok_num;
+  (void) start_recovered_tok_attr;
+}
+
+/* Form input I.  The inputs have different sizes and each 7th input
+   contains an invalid token. */
+static void
+make_input (int i)
+{
+  static const char *piece = "+(a*a+a)*a";
+  int *codes, j, n, len = (i * 11) % 37;
+
+  n = 1 + len * (int) strlen (piece);
+  codes = (int *) malloc ((size_t) n * sizeof (int));
+  codes[0] = 'a';
+  for (j = 1; j < n; j++)
+    codes[j] = piece[(size_t) (j - 1) % strlen (piece)];
+  if (i % 7 == 3 && n > 1)
+    codes[n / 3] = 'b';
+  n_input_toks[i] = n;
+  input_codes[i] = codes;
+}
+
+/* Create and return a grammar.  The grammar uses the shared memo if
+   SHARED_MEMO_P. */
+static struct grammar *
+create_grammar (int shared_memo_p)
+{
+  struct grammar *gr;
+
+  gr = test_create_grammar ();
+  yaep_set_lookahead_level (gr, lookahead_level);
+  yaep_set_error_recovery_flag (gr, 0);
+  yaep_set_shared_memo_flag (gr, shared_memo_p);
+  test_parse_grammar (gr, description);
+  return gr;
+}
+
+/* Parse all inputs by PARSER starting with input START and return
+   an error message if the results differ from the reference ones. */
+static const char *
+parse_inputs (struct yaep_parser *parser, int start)
+{
+  struct yaep_tree_node *root;
+  int i, k, code, ambiguous_p;
+
+  for (k = 0; k < N_INPUTS; k++)
+    {
+      i = (start + k) % N_INPUTS;
+      code = yaep_parser_parse_tokens (parser, n_input_toks[i],
+				       input_codes[i], NULL,
+				       memo_syntax_error, test_parse_alloc,
+				       test_parse_free, &root, &ambiguous_p);
+      if (code != reference_codes[i]
+	  || !test_tree_eq (root, reference_roots[i], 0))
+	return "different parse results";
+      if (root != NULL)
+	yaep_free_tree (root, test_parse_free, NULL);
+    }
+  return NULL;
+}
+
+/* The thread number and the error message of the thread (or
+   NULL). */
+struct thread_result
+{
+  int num;
+  const char *message;
+};
+
+/* Parse all inputs by a new parser of the frozen grammar starting
+   with an input depending on the thread number.  Put an error message
+   into ARG if something is wrong. */
+static void *
+parse_thread (void *arg)
+{
+  struct thread_result *result = (struct thread_result *) arg;
+  struct yaep_parser *parser;
+
+  if ((parser = yaep_create_parser (g)) == NULL)
+    {
+      result->message = "yaep_create_parser: No memory";
+      return NULL;
+    }
+  result->message = parse_inputs (parser, result->num * 13);
+  yaep_free_parser (parser);
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  pthread_t threads[N_THREADS];
+  struct thread_result results[N_THREADS];
+  struct yaep_parser *parser;
+  struct yaep_parse_stats stats;
+  struct grammar *reference_g;
+  const char *message;
+  int i, ambiguous_p, ok = 1;
+
+  if (argc > 1)
+    lookahead_level = atoi (argv [1]);
+  reference_g = create_grammar (0);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      make_input (i);
+      reference_codes[i]
+	= yaep_parse_tokens (reference_g, n_input_toks[i], input_codes[i],
+			     NULL, memo_syntax_error, test_parse_alloc,
+			     test_parse_free, &reference_roots[i],
+			     &ambiguous_p);
+    }
+  g = create_grammar (1);
+  if (yaep_freeze_grammar (g) != 0)
+    {
+      fprintf (stderr, "yaep_freeze_grammar: %s\n", yaep_error_message (g));
+      exit (1);
+    }
+  for (i = 0; i < N_THREADS; i++)
+    {
+      results[i].num = i;
+      results[i].message = NULL;
+    }
+  for (i = 0; i < N_THREADS; i++)
+    if (pthread_create (&threads[i], NULL, parse_thread, &results[i]) != 0)
+      {
+	fprintf (stderr, "pthread_create failed\n");
+	exit (1);
+      }
+  for (i = 0; i < N_THREADS; i++)
+    {
+      pthread_join (threads[i], NULL);
+      if (results[i].message != NULL)
+	{
+	  fprintf (stderr, "thread %d: %s\n", i, results[i].message);
+	  ok = 0;
+	}
+    }
+  /* All set cores for the inputs are already in the memo.  The memo
+     is not used for the dynamic lookahead. */
+  if ((parser = yaep_create_parser (g)) == NULL)
+    {
+      fprintf (stderr, "yaep_create_parser: No memory\n");
+      exit (1);
+    }
+  if ((message = parse_inputs (parser, 0)) != NULL)
+    {
+      fprintf (stderr, "%s\n", message);
+      ok = 0;
+    }
+  yaep_parser_get_parse_stats (parser, 1, &stats);
+  if ((stats.n_set_cores == 0) != (lookahead_level < 2))
+    {
+      fprintf (stderr, "%ld set cores are formed with the memo\n",
+	       stats.n_set_cores);
+      ok = 0;
+    }
+  yaep_free_parser (parser);
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      if (reference_roots[i] != NULL)
+	yaep_free_tree (reference_roots[i], test_parse_free, NULL);
+      free (input_codes[i]);
+    }
+  yaep_free_grammar (g);
+  yaep_free_grammar (reference_g);
+  if (!ok)
+    exit (1);
+  fprintf (stderr, "parses with the shared memo are the same\n");
+  exit (0);
+}
@@ -0,0 +1,157 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* The LR(0) automaton compiled by freezing the grammar: the trees
+   (including ones after error recovery) are the same as without the
+   automaton, and parses form fewer set cores because the states
+   formed by shifting are already in the shared memo of the grammar. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define N_INPUTS 30
+
+static const char *description =
+"\n"
+"TERM;\n"
+"E : T         # 0\n"
+"  | E '+' T   # plus (0 2)\n"
+"  ;\n"
+"T : F         # 0\n"
+"  | T '*' F   # mult (0 2)\n"
+"  ;\n"
+"F : 'a'       # 0\n"
+"  | '(' E ')' # 1\n"
+"  ;\n"
+  ;
+
+static int lookahead_level = 1;
+static int n_input_toks[N_INPUTS];
+static int *input_codes[N_INPUTS];
+
+/* Form input I.  The inputs have different sizes and each 7th input
+   contains an invalid token. */
+static void
+make_input (int i)
+{
+  static const char *piece = "+(a*a+a)*a";
+  int *codes, j, n, len = (i * 11) % 37;
+
+  n = 1 + len * (int) strlen (piece);
+  codes = (int *) malloc ((size_t) n * sizeof (int));
+  codes[0] = 'a';
+  for (j = 1; j < n; j++)
+    codes[j] = piece[(size_t) (j - 1) % strlen (piece)];
+  if (i % 7 == 3 && n > 1)
+    codes[n / 3] = 'b';
+  n_input_toks[i] = n;
+  input_codes[i] = codes;
+}
+
+/* Create and return a grammar.  The grammar is frozen with the LR(0)
+   automaton if AUTOMATON_P. */
+static struct grammar *
+create_grammar (int automaton_p)
+{
+  struct grammar *gr;
+
+  gr = test_create_grammar ();
+  yaep_set_lookahead_level (gr, lookahead_level);
+  yaep_set_lr0_automaton_flag (gr, automaton_p);
+  test_parse_grammar (gr, description);
+  if (automaton_p && yaep_freeze_grammar (gr) != 0)
+    {
+      fprintf (stderr, "yaep_freeze_grammar: %s\n", yaep_error_message (gr));
+      exit (1);
+    }
+  return gr;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct grammar *reference_g, *g;
+  struct yaep_parser *reference_parser, *parser;
+  struct yaep_tree_node *reference_root, *root;
+  struct yaep_parse_stats reference_stats, stats;
+  int i, reference_code, code, ambiguous_p;
+
+  if (argc > 1)
+    lookahead_level = atoi (argv [1]);
+  reference_g = create_grammar (0);
+  g = create_grammar (1);
+  if ((reference_parser = yaep_create_parser (reference_g)) == NULL
+      || (parser = yaep_create_parser (g)) == NULL)
+    {
+      fprintf (stderr, "yaep_create_parser: No memory\n");
+      exit (1);
+    }
+  for (i = 0; i < N_INPUTS; i++)
+    {
+      make_input (i);
+      reference_code
+	= yaep_parser_parse_tokens (reference_parser, n_input_toks[i],
+				    input_codes[i], NULL,
+				    test_silent_syntax_error, test_parse_alloc,
+				    test_parse_free, &reference_root,
+				    &ambiguous_p);
+      code = yaep_parser_parse_tokens (parser, n_input_toks[i],
+				       input_codes[i], NULL,
+				       test_silent_syntax_error,
+				       test_parse_alloc, test_parse_free,
+				       &root, &ambiguous_p);
+      if (code != reference_code || !test_tree_eq (root, reference_root, 0))
+	{
+	  fprintf (stderr, "different parse results for input %d\n", i);
+	  exit (1);
+	}
+      if (root != NULL)
+	yaep_free_tree (root, test_parse_free, NULL);
+      if (reference_root != NULL)
+	yaep_free_tree (reference_root, test_parse_free, NULL);
+      free (input_codes[i]);
+    }
+  /* The automaton is not used for the dynamic lookahead. */
+  yaep_parser_get_parse_stats (reference_parser, 1, &reference_stats);
+  yaep_parser_get_parse_stats (parser, 1, &stats);
+  if ((stats.n_set_cores < reference_stats.n_set_cores)
+      != (lookahead_level < 2))
+    {
+      fprintf (stderr,
+	       "%ld set cores are formed with the automaton, %ld without it\n",
+	       stats.n_set_cores, reference_stats.n_set_cores);
+      exit (1);
+    }
+  yaep_free_parser (parser);
+  yaep_free_parser (reference_parser);
+  yaep_free_grammar (g);
+  yaep_free_grammar (reference_g);
+  fprintf (stderr, "parses with the LR(0) automaton are the same\n");
+  exit (0);
+}
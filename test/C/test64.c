@@ -0,0 +1,171 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Terminal sets of different sizes: grammars with 20 up to 700
+   terminals give the same trees (including ones after error
+   recovery) with the static and dynamic lookahead as without the
+   lookahead. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define N_INPUTS 10
+#define MAX_INPUT_LEN 400
+
+static const int n_terms_tab[] = {20, 100, 128, 200, 250, 300, 700};
+
+/* Return description of a grammar with N_TERMS terminals t0, t1, ...
+   with codes 1, 2, ...  Terminals t0 and t1 are brackets and t2 is a
+   separator. */
+static char *
+make_description (int n_terms)
+{
+  char *str = (char *) malloc ((size_t) n_terms * 40 + 200);
+  char *p = str;
+  int i;
+
+  p += sprintf (p, "TERM");
+  for (i = 0; i < n_terms; i++)
+    p += sprintf (p, " t%d=%d", i, i + 1);
+  p += sprintf (p, ";\n"
+		"S : L          # 0\n"
+		"  ;\n"
+		"L : E          # 0\n"
+		"  | L t2 E     # list (0 2)\n"
+		"  ;\n"
+		"E : t0 L t1    # 1\n"
+		"  | E P        # apply (0 1)\n");
+  for (i = 3; i < n_terms; i++)
+    p += sprintf (p, "  | t%d # 0\n", i);
+  p += sprintf (p, "  ;\nP : t0 t1 # 0\n  | t%d t%d # 1\n  ;\n",
+		n_terms - 1, n_terms / 2);
+  return str;
+}
+
+/* Form input I of at most MAX_INPUT_LEN codes for a grammar with
+   N_TERMS terminals into CODES and return its length.  Each 4th input
+   contains an invalid token. */
+static int
+make_input (int i, int n_terms, int *codes)
+{
+  int n = 0, depth = 0;
+  unsigned seed = (unsigned) (i * 7919 + n_terms);
+
+  while (n < MAX_INPUT_LEN - 2 * depth - 4)
+    {
+      seed = (seed * 1103515245u + 12345u) & 0x7fffffff;
+      if (seed % 5 == 0 && depth < 20)
+	{
+	  codes[n++] = 1;
+	  depth++;
+	  continue;
+	}
+      codes[n++] = 4 + (int) ((seed >> 8) % (unsigned) (n_terms - 3));
+      if (seed % 7 == 0)
+	{
+	  codes[n++] = n_terms;
+	  codes[n++] = n_terms / 2 + 1;
+	}
+      if (depth > 0 && seed % 3 == 0)
+	{
+	  codes[n++] = 2;
+	  depth--;
+	}
+      if (n >= 20 * (i + 1))
+	break;
+      codes[n++] = 3;
+    }
+  while (depth-- > 0)
+    codes[n++] = 2;
+  if (i % 4 == 1)
+    codes[n / 2] = 2;
+  return n;
+}
+
+/* Create and return a grammar with N_TERMS terminals and
+   LOOKAHEAD_LEVEL. */
+static struct grammar *
+create_grammar (int n_terms, int lookahead_level)
+{
+  struct grammar *gr;
+  char *grammar_description = make_description (n_terms);
+
+  gr = test_create_grammar ();
+  yaep_set_lookahead_level (gr, lookahead_level);
+  test_parse_grammar (gr, grammar_description);
+  free (grammar_description);
+  return gr;
+}
+
+int
+main (void)
+{
+  struct grammar *reference_g, *g;
+  struct yaep_tree_node *reference_root, *root;
+  int codes[MAX_INPUT_LEN];
+  int i, j, level, n, n_terms, reference_code, code, ambiguous_p;
+
+  for (j = 0; j < (int) (sizeof (n_terms_tab) / sizeof (int)); j++)
+    {
+      n_terms = n_terms_tab[j];
+      reference_g = create_grammar (n_terms, 0);
+      for (level = 1; level <= 2; level++)
+	{
+	  g = create_grammar (n_terms, level);
+	  for (i = 0; i < N_INPUTS; i++)
+	    {
+	      n = make_input (i, n_terms, codes);
+	      reference_code
+		= yaep_parse_tokens (reference_g, n, codes, NULL,
+				     test_silent_syntax_error, test_parse_alloc,
+				     test_parse_free, &reference_root,
+				     &ambiguous_p);
+	      code = yaep_parse_tokens (g, n, codes, NULL,
+					test_silent_syntax_error,
+					test_parse_alloc, test_parse_free,
+					&root, &ambiguous_p);
+	      if (code != reference_code || root == NULL
+		  || !test_tree_eq (root, reference_root, 0))
+		{
+		  fprintf (stderr,
+			   "different parse results for input %d of grammar "
+			   "with %d terminals and lookahead level %d\n",
+			   i, n_terms, level);
+		  exit (1);
+		}
+	      yaep_free_tree (root, test_parse_free, NULL);
+	      yaep_free_tree (reference_root, test_parse_free, NULL);
+	    }
+	  yaep_free_grammar (g);
+	}
+      yaep_free_grammar (reference_g);
+      fprintf (stderr, "%d terminals: ok\n", n_terms);
+    }
+  exit (0);
+}
@@ -0,0 +1,181 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Translation of sparse token codes: a grammar with hashed 32-bit
+   codes uses the perfect hash (also after loading it from a compiled
+   grammar file) and gives the same trees as the same grammar with
+   dense codes; codes which are not terminals are invalid. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define N_TERMS 500
+#define N_TOKS 300
+
+/* Name of the compiled grammar file. */
+#define PATH "test65.cgr"
+
+/* Return code of terminal I.  Sparse codes are hashed and spread
+   over non-negative 32-bit integers with zero 4 low bits. */
+static int
+term_code (int i, int sparse_p)
+{
+  return sparse_p ? (int) (((unsigned) i * 2654435761u) & 0x7ffffff0) : i + 1;
+}
+
+/* Return a grammar with N_TERMS terminals t0, t1, ... with sparse or
+   dense codes.  Terminal t0 is a separator. */
+static struct grammar *
+create_grammar (int sparse_p)
+{
+  struct grammar *gr;
+  char *str = (char *) malloc (N_TERMS * 40 + 200), *p = str;
+  int i;
+
+  p += sprintf (p, "TERM");
+  for (i = 0; i < N_TERMS; i++)
+    p += sprintf (p, " t%d=%d", i, term_code (i, sparse_p));
+  p += sprintf (p, ";\n"
+		"L : E          # 0\n"
+		"  | L t0 E     # list (0 2)\n"
+		"  ;\n"
+		"E : t1         # 0\n");
+  for (i = 2; i < N_TERMS; i++)
+    p += sprintf (p, "  | t%d E # pair (0 1)\n", i);
+  p += sprintf (p, "  ;\n");
+  gr = test_create_grammar ();
+  test_parse_grammar (gr, str);
+  free (str);
+  return gr;
+}
+
+/* Return name of translation strategy of G. */
+static const char *
+strategy_name (struct grammar *g)
+{
+  switch (yaep_code_translation_strategy (g))
+    {
+    case YAEP_CODE_TRANSLATION_NONE:
+      return "none";
+    case YAEP_CODE_TRANSLATION_VECTOR:
+      return "vector";
+    case YAEP_CODE_TRANSLATION_PERFECT_HASH:
+      return "perfect hash";
+    case YAEP_CODE_TRANSLATION_HASH_TABLE:
+      return "hash table";
+    default:
+      return "unknown";
+    }
+}
+
+/* Parse the terminal numbers NUMS by G with sparse or dense codes and
+   return the tree. */
+static struct yaep_tree_node *
+parse (struct grammar *g, const int *nums, int sparse_p)
+{
+  struct yaep_tree_node *root;
+  int codes[N_TOKS], i, ambiguous_p;
+
+  for (i = 0; i < N_TOKS; i++)
+    codes[i] = term_code (nums[i], sparse_p);
+  if (yaep_parse_tokens (g, N_TOKS, codes, NULL, test_silent_syntax_error,
+			 test_parse_alloc, test_parse_free, &root,
+			 &ambiguous_p) != 0)
+    {
+      fprintf (stderr, "%s\n", yaep_error_message (g));
+      exit (1);
+    }
+  return root;
+}
+
+int
+main (void)
+{
+  struct grammar *dense_g, *sparse_g, *loaded_g;
+  struct yaep_tree_node *dense_root, *root;
+  int nums[N_TOKS], i, code, ambiguous_p;
+  unsigned seed = 1;
+
+  loaded_g = test_create_grammar ();
+  fprintf (stderr, "no grammar: %s\n", strategy_name (loaded_g));
+  dense_g = create_grammar (0);
+  sparse_g = create_grammar (1);
+  if (yaep_save_compiled_grammar (sparse_g, PATH) != 0
+      || yaep_load_compiled_grammar (loaded_g, PATH) != 0)
+    {
+      fprintf (stderr, "%s\n", yaep_error_message (loaded_g));
+      exit (1);
+    }
+  remove (PATH);
+  fprintf (stderr, "dense codes: %s\n", strategy_name (dense_g));
+  fprintf (stderr, "sparse codes: %s\n", strategy_name (sparse_g));
+  fprintf (stderr, "loaded sparse codes: %s\n", strategy_name (loaded_g));
+  /* Use all terminals: t2 ... t499 t1 t0 t2 ... */
+  for (i = 0; i < N_TOKS; i++)
+    {
+      seed = (seed * 1103515245u + 12345u) & 0x7fffffff;
+      nums[i] = i % 10 == 9 ? 1 : i % 10 == 0 && i != 0 ? 0
+		: 2 + (int) ((seed >> 8) % (N_TERMS - 2));
+    }
+  nums[N_TOKS - 1] = 1;
+  dense_root = parse (dense_g, nums, 0);
+  root = parse (sparse_g, nums, 1);
+  if (!test_tree_eq (dense_root, root, TEST_TREE_NO_CODES))
+    {
+      fprintf (stderr, "different trees for sparse codes\n");
+      exit (1);
+    }
+  yaep_free_tree (root, test_parse_free, NULL);
+  root = parse (loaded_g, nums, 1);
+  if (!test_tree_eq (dense_root, root, TEST_TREE_NO_CODES))
+    {
+      fprintf (stderr, "different trees for loaded sparse codes\n");
+      exit (1);
+    }
+  yaep_free_tree (root, test_parse_free, NULL);
+  yaep_free_tree (dense_root, test_parse_free, NULL);
+  /* Codes next to the terminal codes are not terminals.  */
+  for (i = 0; i < N_TERMS; i++)
+    {
+      code = term_code (i, 1);
+      nums[0] = code + 1;
+      if (yaep_parse_tokens (sparse_g, 1, nums, NULL, test_silent_syntax_error,
+			     test_parse_alloc, test_parse_free, &root,
+			     &ambiguous_p) != YAEP_INVALID_TOKEN_CODE)
+	{
+	  fprintf (stderr, "code %d is accepted\n", code + 1);
+	  exit (1);
+	}
+    }
+  fprintf (stderr, "invalid codes are rejected\n");
+  yaep_free_grammar (loaded_g);
+  yaep_free_grammar (sparse_g);
+  yaep_free_grammar (dense_g);
+  exit (0);
+}
@@ -0,0 +1,329 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/* Lazy forests: the forest fully expanded contains the parse tree
+   (including ones after error recovery and with the Leo flag), the
+   forest of an ambiguous input represents all its trees (without
+   repetitions when several rules of a nonterminal derive the same
+   part of the input) including the derivations of the empty string,
+   the forest nodes are not expanded until the caller expands them,
+   and the forest lives until the next parse. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define MAX_INPUT_LEN 100
+
+static const char *desc = "TERM;\n"
+  "S : L               # 0\n"
+  "  ;\n"
+  "L : E               # list (0)\n"
+  "  | L ',' E         # list (0 2)\n"
+  "  ;\n"
+  "E : 'a'             # 0\n"
+  "  | '(' L ')'       # paren (1)\n"
+  "  | '[' E E ']'     # swap (2 1)\n"
+  "  | '<' O '>'       # angle (1 -)\n"
+  "  | E '!'           # -\n"
+  "  | error           # 0\n"
+  "  ;\n"
+  "O :                 # opt\n"
+  "  | 'o'             # 0\n"
+  "  ;\n";
+
+static const char *inputs[] = {
+  "a", "a,a", "(a,a),a", "[a(a)]", "<>", "<o>!", "a!,[<>a]",
+  "a,,a", "(a", "a)a,a",
+};
+
+#define N_INPUTS ((int) (sizeof (inputs) / sizeof (inputs[0])))
+
+static const char *ambiguous_desc = "TERM;\n"
+  "S : S S             # s (0 1)\n"
+  "  | 'a'             # 0\n"
+  "  ;\n";
+
+static const char *expr_desc = "TERM;\n"
+  "E : E '+' E         # plus (0 2)\n"
+  "  | E '*' E         # mult (0 2)\n"
+  "  | 'a'             # a\n"
+  "  ;\n";
+
+/* Inputs with 0, 1, ... operators.  Each one has the Catalan number
+   of parses for the operator number. */
+static const char *expr_inputs[] = {
+  "a", "a+a", "a+a*a", "a+a*a+a", "a*a+a*a+a", "a+a+a*a*a+a",
+};
+
+#define N_EXPR_INPUTS ((int) (sizeof (expr_inputs) / sizeof (expr_inputs[0])))
+
+/* Expand all nodes of the forest of PARSER reachable from NODE. */
+static void
+expand_all (struct yaep_parser *parser, struct yaep_tree_node *node)
+{
+  int i;
+
+  yaep_parser_expand_forest_node (parser, node);
+  switch (node->type)
+    {
+    case YAEP_ANODE:
+      for (i = 0; node->val.anode.children[i] != NULL; i++)
+	expand_all (parser, node->val.anode.children[i]);
+      break;
+    case YAEP_ALT:
+      for (; node != NULL; node = node->val.alt.next)
+	expand_all (parser, node->val.alt.node);
+      break;
+    case YAEP_LAZY:
+      test_fail ("unexpanded forest node");
+      break;
+    default:
+      break;
+    }
+}
+
+/* Return TRUE if TREE without alternatives is one of the trees of
+   expanded forest NODE. */
+static int
+tree_in_forest_p (struct yaep_tree_node *node, struct yaep_tree_node *tree)
+{
+  int i;
+
+  if (node->type == YAEP_ALT)
+    {
+      for (; node != NULL; node = node->val.alt.next)
+	if (tree_in_forest_p (node->val.alt.node, tree))
+	  return 1;
+      return 0;
+    }
+  if (node->type != tree->type)
+    return 0;
+  switch (node->type)
+    {
+    case YAEP_TERM:
+      return (node->val.term.code == tree->val.term.code
+	      && node->val.term.attr == tree->val.term.attr);
+    case YAEP_ANODE:
+      if (strcmp (node->val.anode.name, tree->val.anode.name) != 0
+	  || node->val.anode.cost != tree->val.anode.cost)
+	return 0;
+      for (i = 0; node->val.anode.children[i] != NULL; i++)
+	if (tree->val.anode.children[i] == NULL
+	    || !tree_in_forest_p (node->val.anode.children[i],
+				  tree->val.anode.children[i]))
+	  return 0;
+      return tree->val.anode.children[i] == NULL;
+    default:
+      return 1;
+    }
+}
+
+/* Return the number of trees represented by NODE of the forest of
+   PARSER. */
+static long
+count_trees (struct yaep_parser *parser, struct yaep_tree_node *node)
+{
+  long n;
+  int i;
+
+  yaep_parser_expand_forest_node (parser, node);
+  switch (node->type)
+    {
+    case YAEP_ANODE:
+      for (n = 1, i = 0; node->val.anode.children[i] != NULL; i++)
+	n *= count_trees (parser, node->val.anode.children[i]);
+      return n;
+    case YAEP_ALT:
+      for (n = 0; node != NULL; node = node->val.alt.next)
+	n += count_trees (parser, node->val.alt.node);
+      return n;
+    default:
+      return 1;
+    }
+}
+
+/* Create and return a grammar with GRAMMAR_DESCRIPTION, ONE_PARSE_P,
+   ERROR_RECOVERY_P and LEO_P. */
+static struct grammar *
+create_grammar (const char *grammar_description, int one_parse_p,
+		int error_recovery_p, int leo_p)
+{
+  struct grammar *g;
+
+  g = test_create_grammar ();
+  yaep_set_one_parse_flag (g, one_parse_p);
+  yaep_set_error_recovery_flag (g, error_recovery_p);
+  yaep_set_leo_flag (g, leo_p);
+  test_parse_grammar (g, grammar_description);
+  return g;
+}
+
+/* Parse N tokens CODES with ATTRS by PARSER and return the root. */
+static struct yaep_tree_node *
+parse (struct yaep_parser *parser, int n, const int *codes,
+       void *const *attrs)
+{
+  struct yaep_tree_node *root;
+  int ambiguous_p;
+
+  if (yaep_parser_parse_tokens (parser, n, codes, attrs,
+				test_silent_syntax_error, test_parse_alloc,
+				test_parse_free, &root, &ambiguous_p) != 0)
+    test_fail (yaep_parser_error_message (parser));
+  return root;
+}
+
+int
+main (void)
+{
+  struct grammar *g;
+  struct yaep_parser *parser;
+  struct yaep_tree_node *tree_root, *root;
+  int codes[MAX_INPUT_LEN], tok_nums[MAX_INPUT_LEN];
+  void *attrs[MAX_INPUT_LEN];
+  int i, j, n, recovery_p, leo_p;
+  long n_trees, catalan;
+
+  for (i = 0; i < MAX_INPUT_LEN; i++)
+    {
+      tok_nums[i] = i;
+      attrs[i] = &tok_nums[i];
+    }
+  for (recovery_p = 0; recovery_p <= 1; recovery_p++)
+    for (leo_p = 0; leo_p <= 1; leo_p++)
+      {
+	g = create_grammar (desc, 1, recovery_p, leo_p);
+	if ((parser = yaep_create_parser (g)) == NULL)
+	  test_fail (yaep_error_message (g));
+	for (i = 0; i < N_INPUTS; i++)
+	  {
+	    n = (int) strlen (inputs[i]);
+	    for (j = 0; j < n; j++)
+	      codes[j] = inputs[i][j];
+	    yaep_parser_set_forest_flag (parser, 0);
+	    tree_root = parse (parser, n, codes, attrs);
+	    if (yaep_parser_set_forest_flag (parser, 1) != 0)
+	      test_fail ("wrong forest flag");
+	    root = parse (parser, n, codes, attrs);
+	    if ((root == NULL) != (tree_root == NULL)
+		|| (root != NULL && root->type != YAEP_LAZY))
+	      test_fail ("wrong forest root");
+	    if (root != NULL)
+	      {
+		expand_all (parser, root);
+		if (!tree_in_forest_p (root, tree_root))
+		  {
+		    fprintf (stderr, "different forest for \"%s\" "
+			     "(recovery %d, leo %d)\n",
+			     inputs[i], recovery_p, leo_p);
+		    exit (1);
+		  }
+	      }
+	    if (!leo_p)
+	      fprintf (stderr, "recovery %d: input %d: %ld trees\n",
+		       recovery_p, i,
+		       root == NULL ? 0 : count_trees (parser, root));
+	    yaep_free_tree (tree_root, test_parse_free, NULL);
+	  }
+	yaep_free_parser (parser);
+	yaep_free_grammar (g);
+      }
+  g = create_grammar (ambiguous_desc, 0, 1, 0);
+  if ((parser = yaep_create_parser (g)) == NULL)
+    test_fail (yaep_error_message (g));
+  yaep_parser_set_forest_flag (parser, 1);
+  catalan = 1;
+  for (n = 1; n <= 9; n++)
+    {
+      for (j = 0; j < n; j++)
+	codes[j] = 'a';
+      root = parse (parser, n, codes, attrs);
+      if (root == NULL || root->type != YAEP_LAZY)
+	test_fail ("wrong forest root");
+      yaep_parser_expand_forest_node (parser, root);
+      if (n > 2
+	  && (root->type != YAEP_ALT
+	      || root->val.alt.node->type != YAEP_ANODE
+	      || root->val.alt.node->val.anode.children[0]->type != YAEP_LAZY))
+	test_fail ("forest is not lazy");
+      /* The number of binary trees with N leaves is the Catalan
+	 number C(N - 1). */
+      n_trees = count_trees (parser, root);
+      if (n_trees != catalan)
+	test_fail ("wrong number of trees in forest");
+      catalan = catalan * 2 * (2 * n - 1) / (n + 1);
+      fprintf (stderr, "%d tokens: %ld trees\n", n, n_trees);
+    }
+  yaep_parser_flush_cache (parser);
+  yaep_free_parser (parser);
+  yaep_free_grammar (g);
+  g = create_grammar (expr_desc, 0, 0, 0);
+  if ((parser = yaep_create_parser (g)) == NULL)
+    test_fail (yaep_error_message (g));
+  yaep_parser_set_forest_flag (parser, 1);
+  catalan = 1;
+  for (i = 0; i < N_EXPR_INPUTS; i++)
+    {
+      n = (int) strlen (expr_inputs[i]);
+      for (j = 0; j < n; j++)
+	codes[j] = expr_inputs[i][j];
+      root = parse (parser, n, codes, attrs);
+      n_trees = count_trees (parser, root);
+      if (n_trees != catalan)
+	test_fail ("wrong number of trees in forest");
+      catalan = catalan * 2 * (2 * i + 1) / (i + 2);
+      fprintf (stderr, "%d operators: %ld trees\n", i, n_trees);
+    }
+  yaep_free_parser (parser);
+  yaep_free_grammar (g);
+  for (i = 0; i < TEST_N_NULLABLE_INPUTS; i++)
+    {
+      g = create_grammar (test_nullable_descs[test_nullable_inputs[i].desc],
+			  1, 0, 0);
+      if ((parser = yaep_create_parser (g)) == NULL)
+	test_fail (yaep_error_message (g));
+      n = (int) strlen (test_nullable_inputs[i].input);
+      for (j = 0; j < n; j++)
+	codes[j] = test_nullable_inputs[i].input[j];
+      tree_root = parse (parser, n, codes, attrs);
+      yaep_parser_set_forest_flag (parser, 1);
+      root = parse (parser, n, codes, attrs);
+      expand_all (parser, root);
+      if (!tree_in_forest_p (root, tree_root))
+	test_fail ("different forest for nullable grammar");
+      n_trees = count_trees (parser, root);
+      if (n_trees != test_nullable_inputs[i].n_derivs)
+	test_fail ("wrong number of trees in nullable grammar forest");
+      fprintf (stderr, "nullable input %d: %ld trees\n", i, n_trees);
+      yaep_free_tree (tree_root, test_parse_free, NULL);
+      yaep_free_parser (parser);
+      yaep_free_grammar (g);
+    }
+  exit (0);
+}
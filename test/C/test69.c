@@ -0,0 +1,350 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/* Shared packed parse forests: the SPPF iteration visits each node
+   once with children before their parents, the SPPF of an
+   unambiguous input (including ones after error recovery) has one
+   packed node for each symbol and intermediate node, the SPPF
+   represents the same number of parses as the lazy forest of a
+   grammar with unique translations, the SPPF size of a grammar with a
+   long rule is small even when the number of parses grows as the
+   fifth power of the input length, the SPPF of a nullable grammar
+   contains all derivations of the empty string, and the SPPF lives
+   until the next parse. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define MAX_INPUT_LEN 100
+
+static const char *desc = "TERM;\n"
+  "S : L               # 0\n"
+  "  ;\n"
+  "L : E               # list (0)\n"
+  "  | L ',' E         # list (0 2)\n"
+  "  ;\n"
+  "E : 'a'             # 0\n"
+  "  | '(' L ')'       # paren (1)\n"
+  "  | '[' E E ']'     # swap (2 1)\n"
+  "  | '<' O '>'       # angle (1 -)\n"
+  "  | E '!'           # -\n"
+  "  | error           # 0\n"
+  "  ;\n"
+  "O :                 # opt\n"
+  "  | 'o'             # 0\n"
+  "  ;\n";
+
+static const char *inputs[] = {
+  "a", "a,a", "(a,a),a", "[a(a)]", "<>", "<o>!", "a!,[<>a]",
+  "a,,a", "(a", "a)a,a",
+};
+
+#define N_INPUTS ((int) (sizeof (inputs) / sizeof (inputs[0])))
+
+static const char *expr_desc = "TERM;\n"
+  "E : E '+' E         # plus (0 2)\n"
+  "  | E '*' E         # mult (0 2)\n"
+  "  | '(' E ')'       # paren (1)\n"
+  "  | 'a'             # a\n"
+  "  ;\n";
+
+static const char *expr_inputs[] = {
+  "a", "a+a", "a+a*a", "(a+a)*a", "a+a*a+a", "a*(a+a)*a+a",
+  "a+a+a+a+a+a+a+a",
+};
+
+#define N_EXPR_INPUTS ((int) (sizeof (expr_inputs) / sizeof (expr_inputs[0])))
+
+static const char *long_rule_desc = "TERM;\n"
+  "S : A A A A A A     # s (0 1 2 3 4 5)\n"
+  "  ;\n"
+  "A : 'a'             # a\n"
+  "  | A 'a'           # 0\n"
+  "  ;\n";
+
+/* Return the number of parses represented by the SPPF of PARSER and
+   check the node order, numbers and spans.  Set up *N_NODES to the
+   number of the SPPF nodes and *AMBIGUOUS_P if there is a node with
+   several packed nodes. */
+static double
+count_parses (struct yaep_parser *parser, int *n_nodes, int *ambiguous_p)
+{
+  struct yaep_sppf_node *node, *packed, *root;
+  double *counts, result;
+  int n;
+
+  root = yaep_parser_sppf_root (parser);
+  if (root == NULL || root->type != YAEP_SPPF_SYMBOL
+      || strcmp (root->name, "$S") != 0 || root->start != 0)
+    test_fail ("wrong SPPF root");
+  counts = (double *) malloc (sizeof (double) * (size_t) (root->num + 1));
+  *ambiguous_p = 0;
+  for (n = 0, node = yaep_parser_sppf_first (parser);
+       node != NULL;
+       n++, node = yaep_parser_sppf_next (parser, node))
+    {
+      if (node->num != n || n > root->num)
+	test_fail ("wrong SPPF node number");
+      if (node->type == YAEP_SPPF_PACKED)
+	{
+	  if ((node->left != NULL
+	       && (node->left->num >= n || node->left->start != node->start
+		   || node->left->end != node->split))
+	      || (node->right != NULL
+		  && (node->right->num >= n
+		      || node->right->start != node->split
+		      || node->right->end != node->end)))
+	    test_fail ("wrong SPPF packed node children");
+	  counts[n] = ((node->left == NULL ? 1 : counts[node->left->num])
+		       * (node->right == NULL ? 1 : counts[node->right->num]));
+	}
+      else if (node->packed == NULL)
+	{
+	  if (node->type != YAEP_SPPF_SYMBOL
+	      || (node->end != node->start + 1))
+	    test_fail ("wrong SPPF leaf");
+	  counts[n] = 1;
+	}
+      else
+	{
+	  counts[n] = 0;
+	  if (node->packed->next != NULL)
+	    *ambiguous_p = 1;
+	  for (packed = node->packed; packed != NULL; packed = packed->next)
+	    {
+	      if (packed->type != YAEP_SPPF_PACKED || packed->num >= n
+		  || packed->start != node->start || packed->end != node->end
+		  || strcmp (packed->name, node->name) != 0
+		  || (node->type == YAEP_SPPF_INTERMEDIATE
+		      && (packed->rule != node->rule
+			  || packed->pos != node->pos)))
+		test_fail ("wrong SPPF packed node");
+	      counts[n] += counts[packed->num];
+	    }
+	}
+    }
+  if (n != root->num + 1)
+    test_fail ("wrong number of SPPF nodes");
+  result = counts[root->num];
+  free (counts);
+  *n_nodes = n;
+  return result;
+}
+
+/* Return the number of trees represented by NODE of the forest of
+   PARSER. */
+static double
+count_trees (struct yaep_parser *parser, struct yaep_tree_node *node)
+{
+  double n;
+  int i;
+
+  yaep_parser_expand_forest_node (parser, node);
+  switch (node->type)
+    {
+    case YAEP_ANODE:
+      for (n = 1, i = 0; node->val.anode.children[i] != NULL; i++)
+	n *= count_trees (parser, node->val.anode.children[i]);
+      return n;
+    case YAEP_ALT:
+      for (n = 0; node != NULL; node = node->val.alt.next)
+	n += count_trees (parser, node->val.alt.node);
+      return n;
+    default:
+      return 1;
+    }
+}
+
+/* Create and return a grammar with GRAMMAR_DESCRIPTION and
+   ERROR_RECOVERY_P. */
+static struct grammar *
+create_grammar (const char *grammar_description, int error_recovery_p)
+{
+  struct grammar *g;
+
+  g = test_create_grammar ();
+  yaep_set_one_parse_flag (g, 0);
+  yaep_set_error_recovery_flag (g, error_recovery_p);
+  test_parse_grammar (g, grammar_description);
+  return g;
+}
+
+/* Parse N tokens CODES with ATTRS by PARSER, set up *AMBIGUOUS_P, and
+   return the root. */
+static struct yaep_tree_node *
+parse (struct yaep_parser *parser, int n, const int *codes,
+       void *const *attrs, int *ambiguous_p)
+{
+  struct yaep_tree_node *root;
+
+  if (yaep_parser_parse_tokens (parser, n, codes, attrs,
+				test_silent_syntax_error, test_parse_alloc,
+				test_parse_free, &root, ambiguous_p) != 0)
+    test_fail (yaep_parser_error_message (parser));
+  return root;
+}
+
+/* Set CODES to the characters of STR and return their number. */
+static int
+set_codes (int *codes, const char *str)
+{
+  int i, n = (int) strlen (str);
+
+  for (i = 0; i < n; i++)
+    codes[i] = str[i];
+  return n;
+}
+
+int
+main (void)
+{
+  struct grammar *g;
+  struct yaep_parser *parser;
+  struct yaep_tree_node *root;
+  struct yaep_sppf_node *node;
+  int codes[MAX_INPUT_LEN], tok_nums[MAX_INPUT_LEN];
+  void *attrs[MAX_INPUT_LEN];
+  int i, n, recovery_p, ambiguous_p, sppf_ambiguous_p, n_nodes;
+  double n_parses, n_trees;
+
+  for (i = 0; i < MAX_INPUT_LEN; i++)
+    {
+      tok_nums[i] = i;
+      attrs[i] = &tok_nums[i];
+    }
+  for (recovery_p = 0; recovery_p <= 1; recovery_p++)
+    {
+      g = create_grammar (desc, recovery_p);
+      if ((parser = yaep_create_parser (g)) == NULL)
+	test_fail (yaep_error_message (g));
+      if (yaep_parser_set_sppf_flag (parser, 1) != 0)
+	test_fail ("wrong SPPF flag");
+      for (i = 0; i < N_INPUTS; i++)
+	{
+	  n = set_codes (codes, inputs[i]);
+	  root = parse (parser, n, codes, attrs, &ambiguous_p);
+	  if (root == NULL)
+	    {
+	      if (yaep_parser_sppf_root (parser) != NULL
+		  || yaep_parser_sppf_first (parser) != NULL)
+		test_fail ("SPPF of unrecognized input");
+	      fprintf (stderr, "recovery %d: input %d: no parse\n",
+		       recovery_p, i);
+	      continue;
+	    }
+	  if (root->type != YAEP_NIL)
+	    test_fail ("wrong SPPF parse root");
+	  yaep_free_tree (root, test_parse_free, NULL);
+	  n_parses = count_parses (parser, &n_nodes, &sppf_ambiguous_p);
+	  if (sppf_ambiguous_p != ambiguous_p)
+	    test_fail ("wrong ambiguity");
+	  if (!recovery_p)
+	    for (node = yaep_parser_sppf_first (parser);
+		 node != NULL;
+		 node = yaep_parser_sppf_next (parser, node))
+	      if (node->type == YAEP_SPPF_SYMBOL && node->code >= 0
+		  && (node->code != codes[node->start]
+		      || node->attr != attrs[node->start]))
+		test_fail ("wrong SPPF terminal");
+	  fprintf (stderr, "recovery %d: input %d: %.0f parses, %d nodes\n",
+		   recovery_p, i, n_parses, n_nodes);
+	}
+      yaep_free_parser (parser);
+      yaep_free_grammar (g);
+    }
+  g = create_grammar (expr_desc, 0);
+  if ((parser = yaep_create_parser (g)) == NULL)
+    test_fail (yaep_error_message (g));
+  for (i = 0; i < N_EXPR_INPUTS; i++)
+    {
+      n = set_codes (codes, expr_inputs[i]);
+      yaep_parser_set_sppf_flag (parser, 0);
+      yaep_parser_set_forest_flag (parser, 1);
+      root = parse (parser, n, codes, attrs, &ambiguous_p);
+      n_trees = count_trees (parser, root);
+      yaep_parser_set_sppf_flag (parser, 1);
+      root = parse (parser, n, codes, attrs, &ambiguous_p);
+      yaep_free_tree (root, test_parse_free, NULL);
+      n_parses = count_parses (parser, &n_nodes, &sppf_ambiguous_p);
+      if (n_parses != n_trees || ambiguous_p != (n_parses > 1))
+	test_fail ("different numbers of parses in SPPF and forest");
+      fprintf (stderr, "expression %d: %.0f parses\n", i, n_parses);
+    }
+  /* The SPPF is freed by the next parse. */
+  yaep_parser_set_sppf_flag (parser, 0);
+  yaep_parser_set_forest_flag (parser, 0);
+  root = parse (parser, 1, codes, attrs, &ambiguous_p);
+  yaep_free_tree (root, test_parse_free, NULL);
+  if (yaep_parser_sppf_root (parser) != NULL)
+    test_fail ("SPPF after parse without it");
+  yaep_free_parser (parser);
+  yaep_free_grammar (g);
+  g = create_grammar (long_rule_desc, 0);
+  if ((parser = yaep_create_parser (g)) == NULL)
+    test_fail (yaep_error_message (g));
+  yaep_parser_set_sppf_flag (parser, 1);
+  for (n = 10; n <= 80; n *= 2)
+    {
+      for (i = 0; i < n; i++)
+	codes[i] = 'a';
+      root = parse (parser, n, codes, attrs, &ambiguous_p);
+      yaep_free_tree (root, test_parse_free, NULL);
+      n_parses = count_parses (parser, &n_nodes, &sppf_ambiguous_p);
+      /* The SPPF size for the grammar is quadratic. */
+      if (n_nodes > 4 * n * n)
+	test_fail ("too big SPPF");
+      fprintf (stderr, "%d tokens: %.0f parses, %d nodes\n",
+	       n, n_parses, n_nodes);
+    }
+  yaep_parser_flush_cache (parser);
+  if (yaep_parser_sppf_root (parser) != NULL)
+    test_fail ("SPPF after cache flush");
+  yaep_free_parser (parser);
+  yaep_free_grammar (g);
+  for (i = 0; i < TEST_N_NULLABLE_INPUTS; i++)
+    {
+      g = create_grammar (test_nullable_descs[test_nullable_inputs[i].desc],
+			  0);
+      if ((parser = yaep_create_parser (g)) == NULL)
+	test_fail (yaep_error_message (g));
+      yaep_parser_set_sppf_flag (parser, 1);
+      n = set_codes (codes, test_nullable_inputs[i].input);
+      root = parse (parser, n, codes, attrs, &ambiguous_p);
+      yaep_free_tree (root, test_parse_free, NULL);
+      n_parses = count_parses (parser, &n_nodes, &sppf_ambiguous_p);
+      if (n_parses != (double) test_nullable_inputs[i].n_derivs
+	  || sppf_ambiguous_p != ambiguous_p
+	  || ambiguous_p != (n_parses > 1))
+	test_fail ("wrong SPPF of nullable grammar");
+      fprintf (stderr, "nullable input %d: %.0f parses\n", i, n_parses);
+      yaep_free_parser (parser);
+      yaep_free_grammar (g);
+    }
+  exit (0);
+}
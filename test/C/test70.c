@@ -0,0 +1,380 @@
+/*
+   YAEP (Yet Another Earley Parser)
+
+   Copyright (c) 1997-2018  Vladimir Makarov <vmakarov@gcc.gnu.org>
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the
+   "Software"), to deal in the Software without restriction, including
+   without limitation the rights to use, copy, modify, merge, publish,
+   distribute, sublicense, and/or sell copies of the Software, and to
+   permit persons to whom the Software is furnished to do so, subject to
+   the following conditions:
+
+   The above copyright notice and this permission notice shall be included
+   in all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+   OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+   CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+   TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+   SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+
+/* Minimal cost parses with one parse: the parse cost is the minimal
+   one found by a separate dynamic programming on the input (including
+   inputs with error recovery and inputs with too many parses to build
+   all of them), the abstract node costs are the costs of their
+   translations for ambiguous inputs and their own costs otherwise,
+   the ambiguity is reported (including grammars whose nonterminals
+   derive the empty string in several ways), and the memory allocated
+   by parse_alloc is only the memory of the tree. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include"common.h"
+
+#define MAX_STMT_LEN 64
+#define MAX_INPUT_LEN 400
+
+static const char *desc = "TERM;\n"
+  "S : L                   # 0\n"
+  "  ;\n"
+  "L :                     # -\n"
+  "  | L E ';'             # list 0 (0 1)\n"
+  "  | L error ';'         # list 0 (0 1)\n"
+  "  ;\n"
+  "E : E '+' E             # add 1 (0 2)\n"
+  "  | E '*' E             # mul 3 (0 2)\n"
+  "  | E '+' E '*' E       # madd 3 (0 2 4)\n"
+  "  | E '+' 'c'           # addi 1 (0 2)\n"
+  "  | '[' E ']'           # load 2 (1)\n"
+  "  | '[' E '+' 'c' ']'   # loadoff 2 (1 3)\n"
+  "  | '(' E ')'           # 1\n"
+  "  | 'r'                 # 0\n"
+  "  | 'c'                 # imm 1 (0 -)\n"
+  "  ;\n";
+
+/* The abstract nodes with their costs and numbers of children. */
+static const struct
+{
+  const char *name;
+  int cost, n_children;
+} anodes[] = {
+  {"list", 0, 2}, {"add", 1, 2}, {"mul", 3, 2}, {"madd", 3, 3},
+  {"addi", 1, 2}, {"load", 2, 1}, {"loadoff", 2, 2}, {"imm", 1, 2},
+};
+
+#define N_ANODES ((int) (sizeof (anodes) / sizeof (anodes[0])))
+
+static const char *inputs[] = {
+  "r;", "c;", "r+c;", "r*c;", "r+r*r;", "[r+c]*r+r;", "(r+r)*(c+r)+r*r*r;",
+  "[r+c+c]+r*[r];", "r;c+r;r*r+[c];", "r+*r;r+c*r;", "c+c+c+c+c+c*c;",
+  NULL,
+};
+
+/* The minimal costs and the numbers of parses (up to 2) of E for the
+   tokens from I to J - 1 of the current statement. */
+static int best[MAX_STMT_LEN][MAX_STMT_LEN + 1];
+static int counts[MAX_STMT_LEN][MAX_STMT_LEN + 1];
+
+static int n_allocs;
+
+static void *
+count_parse_alloc (int size)
+{
+  n_allocs++;
+  return test_parse_alloc (size);
+}
+
+static void
+count_parse_free (void *mem)
+{
+  n_allocs--;
+  test_parse_free (mem);
+}
+
+/* Add a derivation with COST of the children costs sum of E for the
+   tokens from I to J - 1 whose children have COUNT parses. */
+static void
+add_deriv (int i, int j, int cost, int count)
+{
+  if (count == 0)
+    return;
+  if (counts[i][j] == 0 || cost < best[i][j])
+    best[i][j] = cost;
+  counts[i][j] = counts[i][j] + count > 2 ? 2 : counts[i][j] + count;
+}
+
+/* Compute the minimal costs and the numbers of parses of E for all
+   parts of statement STMT of LEN tokens. */
+static void
+compute_costs (const char *stmt, int len)
+{
+  int i, j, k, m, l;
+
+  for (l = 1; l <= len; l++)
+    for (i = 0; i + l <= len; i++)
+      {
+	j = i + l;
+	counts[i][j] = 0;
+	if (l == 1)
+	  {
+	    if (stmt[i] == 'r')
+	      add_deriv (i, j, 0, 1);
+	    else if (stmt[i] == 'c')
+	      add_deriv (i, j, 1, 1);
+	    continue;
+	  }
+	if (l >= 3 && stmt[i] == '(' && stmt[j - 1] == ')')
+	  add_deriv (i, j, best[i + 1][j - 1], counts[i + 1][j - 1]);
+	if (l >= 3 && stmt[i] == '[' && stmt[j - 1] == ']')
+	  add_deriv (i, j, 2 + best[i + 1][j - 1], counts[i + 1][j - 1]);
+	if (l >= 5 && stmt[i] == '[' && stmt[j - 1] == ']'
+	    && stmt[j - 2] == 'c' && stmt[j - 3] == '+')
+	  add_deriv (i, j, 2 + best[i + 1][j - 3], counts[i + 1][j - 3]);
+	if (l >= 3 && stmt[j - 1] == 'c' && stmt[j - 2] == '+')
+	  add_deriv (i, j, 1 + best[i][j - 2], counts[i][j - 2]);
+	for (k = i + 1; k < j - 1; k++)
+	  if (stmt[k] == '+' || stmt[k] == '*')
+	    add_deriv (i, j, (stmt[k] == '+' ? 1 : 3) + best[i][k] + best[k + 1][j],
+		       counts[i][k] * counts[k + 1][j]);
+	for (k = i + 1; k < j - 1; k++)
+	  if (stmt[k] == '+')
+	    for (m = k + 2; m < j - 1; m++)
+	      if (stmt[m] == '*')
+		add_deriv (i, j,
+			   3 + best[i][k] + best[k + 1][m] + best[m + 1][j],
+			   counts[i][k] * counts[k + 1][m] * counts[m + 1][j]);
+      }
+}
+
+/* Return the minimal cost of the statements of STR and set up
+   *AMBIGUOUS_P if some statement has several parses.  Set up LEAVES
+   to the expected leaves of the tree: the operands and `e' for a
+   statement which is not parsed. */
+static int
+input_cost (const char *str, int *ambiguous_p, char *leaves)
+{
+  const char *end;
+  int i, len, cost = 0;
+
+  *ambiguous_p = 0;
+  for (; *str != '\0'; str = end + 1)
+    {
+      end = strchr (str, ';');
+      len = (int) (end - str);
+      if (len > MAX_STMT_LEN)
+	test_fail ("too long statement");
+      compute_costs (str, len);
+      if (counts[0][len] == 0)
+	{
+	  *leaves++ = 'e';
+	  continue;
+	}
+      cost += best[0][len];
+      if (counts[0][len] > 1)
+	*ambiguous_p = 1;
+      for (i = 0; i < len; i++)
+	if (str[i] == 'r' || str[i] == 'c')
+	  *leaves++ = str[i];
+    }
+  *leaves = '\0';
+  return cost;
+}
+
+/* Check the tree with ROOT whose leaves should be *LEAVES and return
+   its cost.  The abstract node costs should be the costs of their
+   translations if TOTAL_COST_P. */
+static int
+check_tree (struct yaep_tree_node *node, const char **leaves,
+	    int total_cost_p)
+{
+  int i, j, cost;
+
+  switch (node->type)
+    {
+    case YAEP_NIL:
+      return 0;
+    case YAEP_ERROR:
+      if (*(*leaves)++ != 'e')
+	test_fail ("wrong error node");
+      return 0;
+    case YAEP_TERM:
+      if (*(*leaves)++ != node->val.term.code)
+	test_fail ("wrong terminal");
+      return 0;
+    case YAEP_ANODE:
+      for (i = 0; i < N_ANODES; i++)
+	if (strcmp (anodes[i].name, node->val.anode.name) == 0)
+	  break;
+      if (i >= N_ANODES)
+	test_fail ("wrong abstract node");
+      cost = anodes[i].cost;
+      for (j = 0; node->val.anode.children[j] != NULL; j++)
+	cost += check_tree (node->val.anode.children[j], leaves,
+			    total_cost_p);
+      if (j != anodes[i].n_children)
+	test_fail ("wrong number of children");
+      if (node->val.anode.cost != (total_cost_p ? cost : anodes[i].cost))
+	test_fail ("wrong abstract node cost");
+      return cost;
+    default:
+      test_fail ("alternatives in the minimal cost parse");
+    }
+  return 0;
+}
+
+/* Return the number of nodes of the tree with ROOT. */
+static int
+tree_size (struct yaep_tree_node *node)
+{
+  int i, n = 1;
+
+  if (node->type == YAEP_ANODE)
+    for (i = 0; node->val.anode.children[i] != NULL; i++)
+      n += tree_size (node->val.anode.children[i]);
+  return n;
+}
+
+/* Parse STR by G and check the minimal cost tree.  Print the cost
+   and the ambiguity with NAME. */
+static void
+check_input (struct grammar *g, const char *name, const char *str)
+{
+  struct yaep_tree_node *root;
+  char leaves[MAX_INPUT_LEN + 1];
+  const char *leaves_ptr = leaves;
+  int i, n = (int) strlen (str), codes[MAX_INPUT_LEN];
+  int cost, ambiguous_p, reference_ambiguous_p;
+
+  for (i = 0; i < n; i++)
+    codes[i] = str[i];
+  n_allocs = 0;
+  if (yaep_parse_tokens (g, n, codes, NULL, test_silent_syntax_error,
+			 count_parse_alloc, count_parse_free, &root,
+			 &ambiguous_p) != 0)
+    test_fail (yaep_error_message (g));
+  cost = input_cost (str, &reference_ambiguous_p, leaves);
+  if (ambiguous_p != reference_ambiguous_p)
+    test_fail ("wrong ambiguity");
+  if (check_tree (root, &leaves_ptr, ambiguous_p) != cost
+      || *leaves_ptr != '\0')
+    test_fail ("wrong minimal cost parse");
+  /* The nodes and the abstract node names (the names are shared by
+     the nodes and the empty node by the nodes of nil
+     translations). */
+  if (n_allocs > tree_size (root) + N_ANODES)
+    test_fail ("too much memory for the tree");
+  yaep_free_tree (root, count_parse_free, NULL);
+  fprintf (stderr, "%s: cost %d, ambiguous %d\n", name, cost, ambiguous_p);
+}
+
+/* The abstract nodes of the nullable grammars (see common.h) with
+   their costs. */
+static const struct
+{
+  const char *name;
+  int cost;
+} nullable_anodes[] = {
+  {"ca", 1}, {"bb1", 2}, {"bb2", 3}, {"ac", 1}, {"b0", 1}, {"a1", 1},
+  {"a0", 2}, {"ab", 1}, {"dbb", 1}, {"c0", 1}, {"c1", 2}, {"cac", 1},
+  {"dc", 1}, {"dab", 1}, {"db", 1},
+};
+
+#define N_NULLABLE_ANODES						\
+  ((int) (sizeof (nullable_anodes) / sizeof (nullable_anodes[0])))
+
+/* Check the minimal cost tree with ROOT of a nullable grammar whose
+   leaves should be *LEAVES and return its cost.  The abstract node
+   costs should be the costs of their translations. */
+static int
+check_nullable_tree (struct yaep_tree_node *node, const char **leaves)
+{
+  int i, j, cost;
+
+  if (node->type == YAEP_TERM)
+    {
+      if (*(*leaves)++ != node->val.term.code)
+	test_fail ("wrong terminal");
+      return 0;
+    }
+  if (node->type != YAEP_ANODE)
+    test_fail ("wrong node of nullable grammar tree");
+  for (i = 0; i < N_NULLABLE_ANODES; i++)
+    if (strcmp (nullable_anodes[i].name, node->val.anode.name) == 0)
+      break;
+  if (i >= N_NULLABLE_ANODES)
+    test_fail ("wrong abstract node");
+  cost = nullable_anodes[i].cost;
+  for (j = 0; node->val.anode.children[j] != NULL; j++)
+    cost += check_nullable_tree (node->val.anode.children[j], leaves);
+  if (node->val.anode.cost != cost)
+    test_fail ("wrong abstract node cost");
+  return cost;
+}
+
+/* Parse the nullable grammar input with number I (see common.h) and
+   check the minimal cost tree. */
+static void
+check_nullable_input (int i)
+{
+  struct grammar *g;
+  struct yaep_tree_node *root;
+  const char *str = test_nullable_inputs[i].input, *leaves_ptr = str;
+  int j, n = (int) strlen (str), codes[MAX_INPUT_LEN], cost, ambiguous_p;
+
+  g = test_create_grammar ();
+  yaep_set_cost_flag (g, 1);
+  yaep_set_one_parse_flag (g, 1);
+  test_parse_grammar (g, test_nullable_descs[test_nullable_inputs[i].desc]);
+  for (j = 0; j < n; j++)
+    codes[j] = str[j];
+  if (yaep_parse_tokens (g, n, codes, NULL, test_silent_syntax_error,
+			 test_parse_alloc, test_parse_free, &root,
+			 &ambiguous_p) != 0)
+    test_fail (yaep_error_message (g));
+  /* All the inputs have several parses. */
+  if (!ambiguous_p)
+    test_fail ("wrong ambiguity");
+  cost = check_nullable_tree (root, &leaves_ptr);
+  if (cost != test_nullable_inputs[i].min_cost || *leaves_ptr != '\0')
+    test_fail ("wrong minimal cost parse of nullable grammar");
+  yaep_free_tree (root, test_parse_free, NULL);
+  fprintf (stderr, "nullable input %d: cost %d\n", i, cost);
+  yaep_free_grammar (g);
+}
+
+int
+main (void)
+{
+  struct grammar *g;
+  char name[40], str[MAX_INPUT_LEN + 1];
+  int i;
+
+  g = test_create_grammar ();
+  yaep_set_cost_flag (g, 1);
+  yaep_set_one_parse_flag (g, 1);
+  test_parse_grammar (g, desc);
+  for (i = 0; inputs[i] != NULL; i++)
+    {
+      sprintf (name, "input %d", i);
+      check_input (g, name, inputs[i]);
+    }
+  /* Statements with billions of parses. */
+  for (i = 0; i < 60; i++)
+    str[i] = i % 2 != 0 ? (i % 4 == 1 ? '+' : '*') : (i % 3 == 0 ? 'c' : 'r');
+  str[59] = ';';
+  memcpy (str + 60, str, 60);
+  str[120] = '\0';
+  check_input (g, "long input", str);
+  yaep_free_grammar (g);
+  for (i = 0; i < TEST_N_NULLABLE_INPUTS; i++)
+    check_nullable_input (i);
+  exit (0);
+}